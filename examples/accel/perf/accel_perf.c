@@ -524,24 +524,34 @@ dump_result(void)
 	uint64_t total_failed = 0;
 	uint64_t total_miscompared = 0;
 	uint64_t total_xfer_per_sec, total_bw_in_MiBps;
+	uint64_t total_ns_per_op = 0;
+	uint32_t num_workers = 0;
 	struct worker_thread *worker = g_workers;
 
-	printf("\nCore,Thread   Transfers     Bandwidth     Failed     Miscompares\n");
-	printf("------------------------------------------------------------------------\n");
+	printf("\nCore,Thread   Transfers     Bandwidth     Failed     Miscompares     ns/op\n");
+	printf("----------------------------------------------------------------------------------\n");
 	while (worker != NULL) {
 
 		uint64_t xfer_per_sec = worker->xfer_completed / g_time_in_sec;
 		uint64_t bw_in_MiBps = (worker->xfer_completed * g_xfer_size_bytes) /
 				       (g_time_in_sec * 1024 * 1024);
+		uint64_t ns_per_op = 0;
 
 		total_completed += worker->xfer_completed;
 		total_failed += worker->xfer_failed;
 		total_miscompared += worker->injected_miscompares;
+		num_workers++;
+
+		if (worker->xfer_completed) {
+			/* Time the worker's core spent per operation, i.e. the per-task cost of
+			 * the engine including submission and completion overhead. */
+			ns_per_op = (uint64_t)g_time_in_sec * SPDK_SEC_TO_NSEC / worker->xfer_completed;
+		}
 
 		if (xfer_per_sec) {
-			printf("%u,%u%17" PRIu64 "/s%9" PRIu64 " MiB/s%7" PRIu64 " %11" PRIu64 "\n",
+			printf("%u,%u%17" PRIu64 "/s%9" PRIu64 " MiB/s%7" PRIu64 " %11" PRIu64 " %9" PRIu64 "\n",
 			       worker->display.core, worker->display.thread, xfer_per_sec,
-			       bw_in_MiBps, worker->xfer_failed, worker->injected_miscompares);
+			       bw_in_MiBps, worker->xfer_failed, worker->injected_miscompares, ns_per_op);
 		}
 
 		worker = worker->next;
@@ -550,10 +560,15 @@ dump_result(void)
 	total_xfer_per_sec = total_completed / g_time_in_sec;
 	total_bw_in_MiBps = (total_completed * g_xfer_size_bytes) /
 			    (g_time_in_sec * 1024 * 1024);
+	if (total_completed) {
+		total_ns_per_op = (uint64_t)num_workers * g_time_in_sec * SPDK_SEC_TO_NSEC / total_completed;
+	}
 
-	printf("=========================================================================\n");
-	printf("Total:%15" PRIu64 "/s%9" PRIu64 " MiB/s%6" PRIu64 " %11" PRIu64"\n\n",
-	       total_xfer_per_sec, total_bw_in_MiBps, total_failed, total_miscompared);
+	printf("==================================================================================\n");
+	printf("Total:%15" PRIu64 "/s%9" PRIu64 " MiB/s%6" PRIu64 " %11" PRIu64 " %9" PRIu64 "\n\n",
+	       total_xfer_per_sec, total_bw_in_MiBps, total_failed, total_miscompared, total_ns_per_op);
+	printf("%s, %d bytes: %" PRIu64 " ns/op\n\n", g_workload_type, g_xfer_size_bytes,
+	       total_ns_per_op);
 
 	return total_failed ? 1 : 0;
 }
@@ -11,6 +11,7 @@
 #define SPDK_ACCEL_H
 
 #include "spdk/stdinc.h"
+#include "spdk/dif.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,7 +29,42 @@ enum accel_opcode {
 	ACCEL_OPC_COPY_CRC32C		= 5,
 	ACCEL_OPC_COMPRESS		= 6,
 	ACCEL_OPC_DECOMPRESS		= 7,
-	ACCEL_OPC_LAST			= 8,
+	ACCEL_OPC_ENCRYPT		= 8,
+	ACCEL_OPC_DECRYPT		= 9,
+	ACCEL_OPC_DIF_VERIFY		= 10,
+	ACCEL_OPC_DIF_GENERATE		= 11,
+	ACCEL_OPC_DIF_GENERATE_COPY	= 12,
+	ACCEL_OPC_DIF_VERIFY_COPY	= 13,
+	ACCEL_OPC_XOR			= 14,
+	ACCEL_OPC_LAST			= 15,
+};
+
+/** Compression algorithms of the compress and decompress operations */
+enum spdk_accel_comp_algo {
+	SPDK_ACCEL_COMP_ALGO_DEFLATE	= 0,
+	SPDK_ACCEL_COMP_ALGO_LZ4	= 1,
+	SPDK_ACCEL_COMP_ALGO_ZSTD	= 2,
+	SPDK_ACCEL_COMP_ALGO_LAST	= 3,
+};
+
+/** Cipher supported by the encrypt and decrypt operations */
+#define ACCEL_AES_XTS "AES_XTS"
+
+/** Key for the encrypt and decrypt operations, see spdk_accel_crypto_key_create() */
+struct spdk_accel_crypto_key;
+
+/** Parameters to create a crypto key with */
+struct spdk_accel_crypto_key_create_param {
+	/** Unique name of the key */
+	const char	*key_name;
+	/** Cipher the key is used with, ACCEL_AES_XTS */
+	const char	*cipher;
+	/** Data key. 16 bytes for AES-128-XTS, 32 bytes for AES-256-XTS. */
+	const uint8_t	*key;
+	size_t		key_size;
+	/** Tweak key, same size as the data key */
+	const uint8_t	*key2;
+	size_t		key2_size;
 };
 
 /**
@@ -39,6 +75,13 @@ enum accel_opcode {
  */
 typedef void (*spdk_accel_completion_cb)(void *ref, int status);
 
+/**
+ * Acceleration sequence step callback.
+ *
+ * \param cb_arg Callback argument.
+ */
+typedef void (*spdk_accel_step_cb)(void *cb_arg);
+
 /**
  * Acceleration framework finish callback.
  *
@@ -258,6 +301,518 @@ int spdk_accel_submit_decompress(struct spdk_io_channel *ch, void *dst, void *sr
 				 uint64_t nbytes_dst, uint64_t nbytes_src, int flags,
 				 spdk_accel_completion_cb cb_fn, void *cb_arg);
 
+/**
+ * Build and submit a memory compress request with a given algorithm and level.
+ *
+ * spdk_accel_submit_compress() uses the algorithm and level set with
+ * spdk_accel_set_compress_opts().
+ *
+ * \param ch I/O channel associated with this call
+ * \param dst Destination to compress to.
+ * \param src Source to read from.
+ * \param nbytes_dst Length in bytes of output buffer.
+ * \param nbytes_src Length in bytes of input buffer.
+ * \param output_size The size of the compressed data
+ * \param algo Compression algorithm.
+ * \param level Compression level. 0 is the fastest level of the algorithm, higher
+ * levels trade throughput for a better compression ratio. Levels above the highest
+ * one the engine supports for the algorithm are capped to it.
+ * \param flags Flags, optional flags that can vary per operation.
+ * \param cb_fn Callback function which will be called when the request is complete.
+ * Its status is -ENOSPC if the compressed data doesn't fit in the output buffer.
+ * \param cb_arg Opaque value which will be passed back as the arg parameter in
+ * the completion callback.
+ *
+ * \return 0 on success, -ENOTSUP if the engine assigned to ACCEL_OPC_COMPRESS
+ * doesn't support the algorithm, other negative errno on failure.
+ */
+int spdk_accel_submit_compress_ext(struct spdk_io_channel *ch, void *dst, void *src,
+				   uint64_t nbytes_dst, uint64_t nbytes_src, uint32_t *output_size,
+				   enum spdk_accel_comp_algo algo, uint32_t level, int flags,
+				   spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Build and submit a memory decompress request for data compressed with a given
+ * algorithm.
+ *
+ * \param ch I/O channel associated with this call
+ * \param dst Destination. Must be large enough to hold decompressed data.
+ * \param src Source to read from.
+ * \param nbytes_dst Length in bytes of output buffer.
+ * \param nbytes_src Length in bytes of input buffer.
+ * \param output_size The size of the decompressed data. May be NULL.
+ * \param algo Algorithm the data was compressed with.
+ * \param flags Flags, optional flags that can vary per operation.
+ * \param cb_fn Callback function which will be called when the request is complete.
+ * \param cb_arg Opaque value which will be passed back as the arg parameter in
+ * the completion callback.
+ *
+ * \return 0 on success, -ENOTSUP if the engine assigned to ACCEL_OPC_DECOMPRESS
+ * doesn't support the algorithm, other negative errno on failure.
+ */
+int spdk_accel_submit_decompress_ext(struct spdk_io_channel *ch, void *dst, void *src,
+				     uint64_t nbytes_dst, uint64_t nbytes_src, uint32_t *output_size,
+				     enum spdk_accel_comp_algo algo, int flags,
+				     spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Set the algorithm and level of the compress and decompress operations that
+ * don't specify them, i.e. spdk_accel_submit_compress(), spdk_accel_submit_decompress(),
+ * spdk_accel_append_compress() and spdk_accel_append_decompress(). The default
+ * is SPDK_ACCEL_COMP_ALGO_DEFLATE with level 1.
+ *
+ * Data compressed before a change of algorithm must still be decompressed
+ * with the algorithm it was compressed with.
+ *
+ * \param algo Compression algorithm.
+ * \param level Compression level, see spdk_accel_submit_compress_ext().
+ *
+ * \return 0 on success, -EINVAL if the algorithm is invalid.
+ */
+int spdk_accel_set_compress_opts(enum spdk_accel_comp_algo algo, uint32_t level);
+
+/**
+ * Get the algorithm and level set with spdk_accel_set_compress_opts().
+ *
+ * \param algo Filled with the compression algorithm.
+ * \param level Filled with the compression level.
+ */
+void spdk_accel_get_compress_opts(enum spdk_accel_comp_algo *algo, uint32_t *level);
+
+/**
+ * Check whether the engines assigned to the compress and decompress operations
+ * support a compression algorithm.
+ *
+ * \param algo Compression algorithm.
+ *
+ * \return true if both engines support it, false otherwise.
+ */
+bool spdk_accel_compress_algo_supported(enum spdk_accel_comp_algo algo);
+
+/**
+ * Get the name of a compression algorithm.
+ *
+ * \param algo Compression algorithm.
+ *
+ * \return "deflate", "lz4" or "zstd", NULL if the algorithm is invalid.
+ */
+const char *spdk_accel_comp_algo_get_name(enum spdk_accel_comp_algo algo);
+
+/**
+ * Get a compression algorithm by name.
+ *
+ * \param name Name of the algorithm, see spdk_accel_comp_algo_get_name().
+ * \param algo Filled with the algorithm.
+ *
+ * \return 0 on success, -EINVAL if there is no algorithm with this name.
+ */
+int spdk_accel_comp_algo_get_by_name(const char *name, enum spdk_accel_comp_algo *algo);
+
+/**
+ * Create a crypto key.
+ *
+ * The key is prepared by the engine assigned to ACCEL_OPC_ENCRYPT, which must
+ * also be the engine assigned to ACCEL_OPC_DECRYPT. The key material is copied,
+ * so the caller may wipe its own copy right after this call.
+ *
+ * \param param Key parameters.
+ * \param key Filled out with the new key on success.
+ *
+ * \return 0 on success, -EEXIST if a key with the same name exists, -EINVAL if
+ * the parameters are invalid, -ENOTSUP if the engine cannot use this cipher or
+ * negative errno on other failures.
+ */
+int spdk_accel_crypto_key_create(const struct spdk_accel_crypto_key_create_param *param,
+				 struct spdk_accel_crypto_key **key);
+
+/**
+ * Look up a crypto key by name.
+ *
+ * \param name Name of the key.
+ *
+ * \return the key or NULL if there is no key with this name.
+ */
+struct spdk_accel_crypto_key *spdk_accel_crypto_key_get(const char *name);
+
+/**
+ * Destroy a crypto key. The key must not be used by any outstanding operation.
+ *
+ * \param key Key to destroy.
+ */
+void spdk_accel_crypto_key_destroy(struct spdk_accel_crypto_key *key);
+
+/**
+ * Submit an encrypt request.
+ *
+ * The data is split into data units of block_size bytes, each of which is
+ * encrypted with its own tweak. The first unit uses iv as its tweak, the next
+ * one iv + 1 and so on, e.g. iv is the LBA of the first block written.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param key Key to encrypt with.
+ * \param dst_iovs Destination I/O vector array. May describe the same buffers
+ * as src_iovs to encrypt in place.
+ * \param dst_iovcnt Size of the destination I/O vector array.
+ * \param src_iovs Source I/O vector array.
+ * \param src_iovcnt Size of the source I/O vector array.
+ * \param iv Tweak of the first data unit.
+ * \param block_size Size of a data unit in bytes, a multiple of 16. The length
+ * of the data must be a multiple of it.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_encrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			      struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			      struct iovec *src_iovs, uint32_t src_iovcnt,
+			      uint64_t iv, uint32_t block_size, int flags,
+			      spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a decrypt request.
+ *
+ * See spdk_accel_submit_encrypt() for the meaning of iv and block_size.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param key Key to decrypt with.
+ * \param dst_iovs Destination I/O vector array. May describe the same buffers
+ * as src_iovs to decrypt in place.
+ * \param dst_iovcnt Size of the destination I/O vector array.
+ * \param src_iovs Source I/O vector array.
+ * \param src_iovcnt Size of the source I/O vector array.
+ * \param iv Tweak of the first data unit.
+ * \param block_size Size of a data unit in bytes.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_decrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			      struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			      struct iovec *src_iovs, uint32_t src_iovcnt,
+			      uint64_t iv, uint32_t block_size, int flags,
+			      spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a DIF verify request.
+ *
+ * Checks the protection information interleaved with the data, as
+ * spdk_dif_verify() does. The DIF context and error structure must remain
+ * valid until the operation completes.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param iovs I/O vector array describing the extended LBA payload.
+ * \param iovcnt Size of the I/O vector array.
+ * \param num_blocks Number of blocks of the payload.
+ * \param ctx DIF context.
+ * \param err Filled with the details of the first error found. The operation
+ * completes with a negative status in that case.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_dif_verify(struct spdk_io_channel *ch, struct iovec *iovs, uint32_t iovcnt,
+				 uint32_t num_blocks, const struct spdk_dif_ctx *ctx,
+				 struct spdk_dif_error *err, spdk_accel_completion_cb cb_fn,
+				 void *cb_arg);
+
+/**
+ * Submit a DIF generate request.
+ *
+ * Fills in the protection information interleaved with the data, as
+ * spdk_dif_generate() does. The DIF context must remain valid until the
+ * operation completes.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param iovs I/O vector array describing the extended LBA payload.
+ * \param iovcnt Size of the I/O vector array.
+ * \param num_blocks Number of blocks of the payload.
+ * \param ctx DIF context.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_dif_generate(struct spdk_io_channel *ch, struct iovec *iovs,
+				   uint32_t iovcnt, uint32_t num_blocks,
+				   const struct spdk_dif_ctx *ctx,
+				   spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a DIF insert request.
+ *
+ * Copies the data to a buffer laid out as an extended LBA payload and generates
+ * its protection information, as spdk_dif_generate_copy() does. The DIF context
+ * must remain valid until the operation completes.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst_iovs I/O vector array describing the extended LBA payload. Each
+ * element must hold a multiple of the extended block size.
+ * \param dst_iovcnt Size of the destination I/O vector array.
+ * \param src_iovs I/O vector array describing the data only.
+ * \param src_iovcnt Size of the source I/O vector array.
+ * \param num_blocks Number of blocks of the payload.
+ * \param ctx DIF context.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_dif_generate_copy(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+					uint32_t dst_iovcnt, struct iovec *src_iovs,
+					uint32_t src_iovcnt, uint32_t num_blocks,
+					const struct spdk_dif_ctx *ctx,
+					spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a DIF strip request.
+ *
+ * Verifies the protection information of an extended LBA payload and copies
+ * out the data only, as spdk_dif_verify_copy() does. The DIF context and error
+ * structure must remain valid until the operation completes.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst_iovs I/O vector array describing the data only.
+ * \param dst_iovcnt Size of the destination I/O vector array.
+ * \param src_iovs I/O vector array describing the extended LBA payload. Each
+ * element must hold a multiple of the extended block size.
+ * \param src_iovcnt Size of the source I/O vector array.
+ * \param num_blocks Number of blocks of the payload.
+ * \param ctx DIF context.
+ * \param err Filled with the details of the first error found. The operation
+ * completes with a negative status in that case.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_dif_verify_copy(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+				      uint32_t dst_iovcnt, struct iovec *src_iovs,
+				      uint32_t src_iovcnt, uint32_t num_blocks,
+				      const struct spdk_dif_ctx *ctx, struct spdk_dif_error *err,
+				      spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit an xor request.
+ *
+ * Computes the exclusive or of the source buffers into the destination buffer,
+ * e.g. the parity of a RAID stripe. The destination may be one of the sources.
+ * The source array must remain valid until the operation completes.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst Destination to write the result to.
+ * \param sources Array of source buffers.
+ * \param nsrcs Number of source buffers, at least 2.
+ * \param nbytes Length in bytes of each buffer.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_xor(struct spdk_io_channel *ch, void *dst, void **sources, uint32_t nsrcs,
+			  uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/** Chain of accel operations executed one after the other. */
+struct spdk_accel_sequence;
+
+/**
+ * Append a copy operation to a sequence.
+ *
+ * A sequence is started by passing a pointer to a NULL sequence to any of the
+ * spdk_accel_append_* functions and is executed with spdk_accel_sequence_finish().
+ * The buffers of all operations must stay valid until the sequence completes.
+ * The iovecs are split into contiguous segments, each of which is copied by the
+ * engine assigned to ACCEL_OPC_COPY.
+ *
+ * \param seq Sequence object. If NULL, a new sequence will be created.
+ * \param ch I/O channel associated with this call.
+ * \param dst_iovs Destination I/O vector array.
+ * \param dst_iovcnt Size of the destination I/O vector array.
+ * \param src_iovs Source I/O vector array.
+ * \param src_iovcnt Size of the source I/O vector array.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called once this step has completed, before the next one starts.
+ * May be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_copy(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			   struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			   struct iovec *src_iovs, uint32_t src_iovcnt, int flags,
+			   spdk_accel_step_cb cb_fn, void *cb_arg);
+
+/**
+ * Append a fill operation to a sequence.
+ *
+ * \param seq Sequence object. If NULL, a new sequence will be created.
+ * \param ch I/O channel associated with this call.
+ * \param dst Destination to fill.
+ * \param nbytes Length in bytes to fill.
+ * \param pattern Constant byte to fill to the destination.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called once this step has completed, before the next one starts.
+ * May be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_fill(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			   void *dst, uint64_t nbytes, uint8_t pattern, int flags,
+			   spdk_accel_step_cb cb_fn, void *cb_arg);
+
+/**
+ * Append a CRC-32C calculation to a sequence.
+ *
+ * The length of the data is taken from the iovecs when the step is executed, so
+ * the callback of a previous step may set it, e.g. to the output size of a
+ * compress operation. A CRC-32C of the data copied by the copy operation appended
+ * right before it is merged with that copy into a single ACCEL_OPC_COPY_CRC32C
+ * operation, unless the copy has a step callback.
+ *
+ * \param seq Sequence object. If NULL, a new sequence will be created.
+ * \param ch I/O channel associated with this call.
+ * \param crc_dst Destination to write the CRC-32C to.
+ * \param iovs The io vector array which stores the src data and len.
+ * \param iovcnt The size of the iov.
+ * \param seed Four byte seed value.
+ * \param cb_fn Called once this step has completed, before the next one starts.
+ * May be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_crc32c(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			     uint32_t *crc_dst, struct iovec *iovs, uint32_t iovcnt, uint32_t seed,
+			     spdk_accel_step_cb cb_fn, void *cb_arg);
+
+/**
+ * Append a compress operation to a sequence.
+ *
+ * \param seq Sequence object. If NULL, a new sequence will be created.
+ * \param ch I/O channel associated with this call.
+ * \param dst Destination to compress to.
+ * \param src Source to read from.
+ * \param nbytes_dst Length in bytes of output buffer.
+ * \param nbytes_src Length in bytes of input buffer.
+ * \param output_size The size of the compressed data. It is valid in the
+ * callback of this step.
+ * \param flags Flags, optional flags that can vary per operation.
+ * \param cb_fn Called once this step has completed, before the next one starts.
+ * May be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_compress(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			       void *dst, void *src, uint64_t nbytes_dst, uint64_t nbytes_src,
+			       uint32_t *output_size, int flags,
+			       spdk_accel_step_cb cb_fn, void *cb_arg);
+
+/**
+ * Append a decompress operation to a sequence.
+ *
+ * \param seq Sequence object. If NULL, a new sequence will be created.
+ * \param ch I/O channel associated with this call.
+ * \param dst Destination. Must be large enough to hold decompressed data.
+ * \param src Source to read from.
+ * \param nbytes_dst Length in bytes of output buffer.
+ * \param nbytes_src Length in bytes of input buffer.
+ * \param flags Flags, optional flags that can vary per operation.
+ * \param cb_fn Called once this step has completed, before the next one starts.
+ * May be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_decompress(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+				 void *dst, void *src, uint64_t nbytes_dst, uint64_t nbytes_src,
+				 int flags, spdk_accel_step_cb cb_fn, void *cb_arg);
+
+/**
+ * Append an encrypt operation to a sequence.
+ *
+ * See spdk_accel_submit_encrypt() for the description of the parameters.
+ *
+ * \param seq Sequence object. If NULL, a new sequence will be created.
+ * \param ch I/O channel associated with this call.
+ * \param key Key to encrypt with.
+ * \param dst_iovs Destination I/O vector array.
+ * \param dst_iovcnt Size of the destination I/O vector array.
+ * \param src_iovs Source I/O vector array.
+ * \param src_iovcnt Size of the source I/O vector array.
+ * \param iv Tweak of the first data unit.
+ * \param block_size Size of a data unit in bytes.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called once this step has completed, before the next one starts.
+ * May be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_encrypt(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			      struct spdk_accel_crypto_key *key,
+			      struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			      struct iovec *src_iovs, uint32_t src_iovcnt,
+			      uint64_t iv, uint32_t block_size, int flags,
+			      spdk_accel_step_cb cb_fn, void *cb_arg);
+
+/**
+ * Append a decrypt operation to a sequence.
+ *
+ * See spdk_accel_submit_encrypt() for the description of the parameters.
+ *
+ * \param seq Sequence object. If NULL, a new sequence will be created.
+ * \param ch I/O channel associated with this call.
+ * \param key Key to decrypt with.
+ * \param dst_iovs Destination I/O vector array.
+ * \param dst_iovcnt Size of the destination I/O vector array.
+ * \param src_iovs Source I/O vector array.
+ * \param src_iovcnt Size of the source I/O vector array.
+ * \param iv Tweak of the first data unit.
+ * \param block_size Size of a data unit in bytes.
+ * \param flags Accel framework flags for operations.
+ * \param cb_fn Called once this step has completed, before the next one starts.
+ * May be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_append_decrypt(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+			      struct spdk_accel_crypto_key *key,
+			      struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			      struct iovec *src_iovs, uint32_t src_iovcnt,
+			      uint64_t iv, uint32_t block_size, int flags,
+			      spdk_accel_step_cb cb_fn, void *cb_arg);
+
+/**
+ * Execute a sequence.
+ *
+ * The operations are executed in the order they were appended, each one starting
+ * as soon as the previous one has completed. Operations handled by the software
+ * engine run back to back without returning to the poller in between. The
+ * sequence stops at the first operation that fails and the sequence object is
+ * released before cb_fn is called.
+ *
+ * \param seq Sequence to execute.
+ * \param cb_fn Called when the sequence has completed, never from within this
+ * function.
+ * \param cb_arg Callback argument.
+ */
+void spdk_accel_sequence_finish(struct spdk_accel_sequence *seq,
+				spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Release a sequence without executing any of its operations.
+ *
+ * \param seq Sequence to abort. May be NULL.
+ */
+void spdk_accel_sequence_abort(struct spdk_accel_sequence *seq);
+
 /**
  * Return the name of the engine assigned to a specfic opcode.
  *
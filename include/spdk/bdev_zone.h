@@ -277,4 +277,107 @@ int spdk_bdev_zone_appendv_with_md(struct spdk_bdev_desc *desc, struct spdk_io_c
  */
 uint64_t spdk_bdev_io_get_append_location(struct spdk_bdev_io *bdev_io);
 
+/**
+ * Zone write staging. Coalesces small sequential writes to the zones of a bdev in staging buffers
+ * and writes them out in large chunks aligned to the buffer size. A staging object is used on a
+ * single thread with a single I/O channel.
+ */
+struct spdk_bdev_zone_stage;
+
+/**
+ * Zone write staging options.
+ */
+struct spdk_bdev_zone_stage_opts {
+	/**
+	 * The size of spdk_bdev_zone_stage_opts according to the caller of this library is used
+	 * for ABI compatibility. The library uses this field to know how many fields in this
+	 * structure are valid. New added fields should be put at the end of the struct.
+	 */
+	size_t opts_size;
+
+	/** Size of a staging buffer in blocks. Staged data is written in chunks aligned to it. */
+	uint32_t buffer_blocks;
+
+	/** Number of staging buffers, limiting the number of zones staged at the same time. */
+	uint32_t num_buffers;
+
+	/** Maximum number of outstanding staged writes. */
+	uint32_t num_requests;
+
+	/* Hole at bytes 20-23. */
+	uint8_t reserved20[4];
+
+	/** Time in microseconds after which a partially filled staging buffer is written out. */
+	uint64_t flush_timeout_us;
+} __attribute__((packed));
+SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_zone_stage_opts) == 32, "Incorrect size");
+
+/**
+ * Zone staged write completion callback.
+ *
+ * \param cb_arg Callback argument specified upon write.
+ * \param status 0 if the write's data was written to the bdev, negated errno otherwise.
+ */
+typedef void (*spdk_bdev_zone_stage_cb)(void *cb_arg, int status);
+
+/**
+ * Initialize zone write staging options with default values.
+ *
+ * \param opts Options to initialize.
+ * \param opts_size Must be set to sizeof(struct spdk_bdev_zone_stage_opts).
+ */
+void spdk_bdev_zone_stage_opts_init(struct spdk_bdev_zone_stage_opts *opts, size_t opts_size);
+
+/**
+ * Create a zone write staging object. Has to be called on the thread the I/O channel belongs to.
+ *
+ * \param desc Block device descriptor of a zoned bdev opened for writing.
+ * \param ch I/O channel. Obtained by calling spdk_bdev_get_io_channel().
+ * \param opts Staging options, NULL to use the defaults.
+ *
+ * \return Zone write staging object or NULL on failure.
+ */
+struct spdk_bdev_zone_stage *spdk_bdev_zone_stage_create(struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, const struct spdk_bdev_zone_stage_opts *opts);
+
+/**
+ * Free a zone write staging object. It can be called from the completion callback of the last
+ * outstanding write, in which case the object is freed once the callback returns. The object
+ * can't be used anymore after this function returns 0.
+ *
+ * \param stage Zone write staging object.
+ *
+ * \return 0 on success, -EBUSY if there are outstanding writes.
+ */
+int spdk_bdev_zone_stage_free(struct spdk_bdev_zone_stage *stage);
+
+/**
+ * Submit a write to be staged. Writes to a zone have to be sequential, as if they were submitted
+ * to the bdev directly. The data is copied, so the buffer can be reused once this function
+ * returns, but the callback is only called once the data was written to the bdev, i.e. after the
+ * staging buffer filled up, the flush timeout expired or spdk_bdev_zone_stage_flush() was called.
+ *
+ * \param stage Zone write staging object.
+ * \param buf Data buffer to be written from.
+ * \param offset_blocks The offset in blocks from the start of the bdev.
+ * \param num_blocks The number of blocks to write, the write can't cross a zone boundary.
+ * \param cb Called when the data was written.
+ * \param cb_arg Argument passed to cb.
+ *
+ * \return 0 on success, in which case the callback will always be called. Negated errno on
+ * failure, in which case the callback will not be called:
+ *   * -EINVAL - the write is empty or crosses a zone boundary
+ *   * -ENOMEM - all the staging requests are in use
+ */
+int spdk_bdev_zone_stage_write(struct spdk_bdev_zone_stage *stage, void *buf,
+			       uint64_t offset_blocks, uint64_t num_blocks,
+			       spdk_bdev_zone_stage_cb cb, void *cb_arg);
+
+/**
+ * Write out all partially filled staging buffers without waiting for the flush timeout.
+ *
+ * \param stage Zone write staging object.
+ */
+void spdk_bdev_zone_stage_flush(struct spdk_bdev_zone_stage *stage);
+
 #endif /* SPDK_BDEV_ZONE_H */
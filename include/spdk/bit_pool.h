@@ -103,6 +103,17 @@ bool spdk_bit_pool_is_allocated(const struct spdk_bit_pool *pool, uint32_t bit_i
  */
 uint32_t spdk_bit_pool_allocate_bit(struct spdk_bit_pool *pool);
 
+/**
+ * Allocate a specific bit from the bit pool.
+ *
+ * \param pool Bit pool to allocate a bit from
+ * \param bit_index The index of the bit to allocate.
+ *
+ * \return 0 on success, -EINVAL if bit_index is beyond the end of the pool or
+ * -EEXIST if the bit is already allocated.
+ */
+int spdk_bit_pool_allocate_bit_at(struct spdk_bit_pool *pool, uint32_t bit_index);
+
 /**
  * Free a bit back to the bit pool.
  *
@@ -663,6 +663,28 @@ void spdk_bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *ch
 void spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
 				  spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Defragment a blob.
+ *
+ * Clusters of the blob are relocated on the blobstore device so that
+ * consecutive clusters of the blob end up in contiguous runs of device
+ * clusters. The blob may stay open and in use, I/O to it is briefly frozen
+ * while each cluster is moved.
+ *
+ * This call must be made on the blobstore metadata thread.
+ *
+ * \param bs blobstore.
+ * \param channel IO channel used to copy the clusters.
+ * \param blobid The id of the blob to defragment.
+ * \param max_mbytes_per_sec Upper limit on the copy bandwidth in MiB/s,
+ * 0 means unlimited.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_blob_defrag(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			 spdk_blob_id blobid, uint64_t max_mbytes_per_sec,
+			 spdk_blob_op_complete cb_fn, void *cb_arg);
+
 struct spdk_blob_open_opts {
 	enum blob_clear_method  clear_method;
 
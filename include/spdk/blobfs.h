@@ -332,6 +332,58 @@ int spdk_file_write(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 int64_t spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 		       void *payload, uint64_t offset, uint64_t length);
 
+/**
+ * One read of a batch submitted with spdk_file_multi_read().
+ */
+struct spdk_file_read_req {
+	/** Buffer to store the data in. */
+	void		*payload;
+
+	/** Position in the file to read from. */
+	uint64_t	offset;
+
+	/** Size in bytes of data to read. */
+	uint64_t	length;
+
+	/** Set on completion to the number of bytes read, or negated errno on failure. */
+	int64_t		result;
+};
+
+/**
+ * Read several ranges of the given file at once.
+ *
+ * The parts of the ranges found in the cache are copied right away and all the
+ * others are sent to disk together, so the reads are served in parallel instead
+ * of one after the other. The call returns once all of them are done.
+ *
+ * \param file File to read.
+ * \param ctx The thread context for this operation
+ * \param reqs Array of reads. The result of each one is stored in its result field.
+ * \param num_reqs Number of elements in reqs.
+ *
+ * \return 0 if all the reads succeeded, the negated errno of the first one that
+ * failed otherwise.
+ */
+int spdk_file_multi_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+			 struct spdk_file_read_req *reqs, uint32_t num_reqs);
+
+/**
+ * Start loading a range of the given file into the cache.
+ *
+ * The call does not wait for the data to be read. Reads of the range that come
+ * after it completes are served from the cache.
+ *
+ * \param file File to prefetch.
+ * \param ctx The thread context for this operation
+ * \param offset The beginning position of the range.
+ * \param length The size in bytes of the range.
+ *
+ * \return 0 on success, -ENOMEM if the cache or the thread context ran out of
+ * resources before the whole range could be requested.
+ */
+int spdk_file_prefetch(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+		       uint64_t offset, uint64_t length);
+
 /**
  * Set cache size for the blobstore filesystem.
  *
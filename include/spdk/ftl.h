@@ -54,6 +54,41 @@ enum ftl_stats_type {
 	FTL_STATS_TYPE_MAX,
 };
 
+/* Internal FTL stages, whose latency is tracked */
+enum ftl_stats_stage {
+	/* User write to the NV cache, from space reservation to completion */
+	FTL_STATS_STAGE_NV_CACHE_WRITE = 0,
+	/* Compaction of a request worth of NV cache data to the base device */
+	FTL_STATS_STAGE_COMPACTION,
+	/* Relocation of a request worth of valid data of a GC victim band */
+	FTL_STATS_STAGE_RELOC,
+	/* L2P page read from the cache device */
+	FTL_STATS_STAGE_L2P_PAGE_IN,
+	/* User writes held back due to NV cache throttling or lack of free chunks */
+	FTL_STATS_STAGE_USER_WRITE_STALL,
+	FTL_STATS_STAGE_MAX,
+};
+
+/*
+ * Number of buckets of the latency histograms. The first bucket counts operations shorter
+ * than 1us, bucket i counts operations within [2^(i-1), 2^i) us and the last one all longer.
+ */
+#define FTL_STATS_LATENCY_BUCKETS	24
+
+struct ftl_stats_latency {
+	/* Number of completed operations */
+	uint64_t count;
+
+	/* Number of blocks processed by the operations */
+	uint64_t blocks;
+
+	/* Total and maximum latency in microseconds */
+	uint64_t total_us;
+	uint64_t max_us;
+
+	uint64_t buckets[FTL_STATS_LATENCY_BUCKETS];
+};
+
 struct ftl_stats {
 	/* Number of times write limits were triggered by FTL writers
 	 * (gc and compaction) dependent on number of free bands. GC starts at
@@ -69,6 +104,38 @@ struct ftl_stats {
 	uint64_t		io_activity_total;
 
 	struct ftl_stats_entry	entries[FTL_STATS_TYPE_MAX];
+
+	/* Garbage collection victim selection */
+	struct {
+		/* Number of bands picked for relocation */
+		uint64_t	bands;
+
+		/* Number of valid blocks the bands held when picked */
+		uint64_t	valid_blocks;
+	} gc;
+
+	struct ftl_stats_latency	latency[FTL_STATS_STAGE_MAX];
+
+	/* L2P page lookups when pinning LBAs */
+	struct {
+		uint64_t	hits;
+		uint64_t	misses;
+	} l2p_cache;
+
+	/* NV cache chunk states, sampled when the statistics are retrieved */
+	struct {
+		uint64_t	chunks_total;
+		uint64_t	chunks_free;
+		uint64_t	chunks_open;
+		uint64_t	chunks_full;
+		uint64_t	chunks_compacting;
+	} nv_cache;
+
+	/* User blocks read from the NV cache, served from its DRAM write cache or not */
+	struct {
+		uint64_t	hits;
+		uint64_t	misses;
+	} wr_cache;
 };
 
 typedef void (*spdk_ftl_stats_fn)(struct ftl_stats *stats, void *cb_arg);
@@ -132,8 +199,72 @@ struct spdk_ftl_conf {
 	 * structure are valid. And the library will populate any remaining fields with default values.
 	 */
 	size_t					conf_size;
+
+	/* Garbage collection victim selection policy, see spdk_ftl_gc_policy enum */
+	uint32_t				gc_policy;
+
+	/* L2P cache page eviction policy, see spdk_ftl_l2p_evict_policy enum */
+	uint32_t				l2p_evict_policy;
+
+	/*
+	 * Placement of the device within a set of FTL devices the LBA space of a single bdev is
+	 * striped across. It's recorded in the superblock and checked when the device is loaded.
+	 */
+	struct {
+		/* UUID of the first device of the set, ignored for the first device itself */
+		struct spdk_uuid		set_uuid;
+
+		/* Index of the device within the set */
+		uint32_t			idx;
+
+		/* Number of devices in the set, 0 if the device isn't part of one */
+		uint32_t			count;
+
+		/* Size of the LBA stripe routed to a single device in MiB */
+		uint32_t			stripe_mib;
+
+		/* Hole at bytes 0xac - 0xaf. */
+		uint8_t				reserved[4];
+	} __attribute__((packed)) shard;
+
+	/*
+	 * Number of recently written user blocks whose copies are kept in DRAM, serving reads
+	 * without going to the NV cache device. 0 disables the write cache.
+	 */
+	uint32_t				wr_cache_blocks;
+
+	/* Hole at bytes 0xb4 - 0xb7. */
+	uint8_t					reserved3[4];
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_ftl_conf) == 136, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_ftl_conf) == 184, "Incorrect size");
+
+enum spdk_ftl_gc_policy {
+	/* Relocate the bands with the most invalid blocks first */
+	SPDK_FTL_GC_POLICY_GREEDY = 0,
+
+	/*
+	 * Weigh the space reclaimed against the cost of moving the valid blocks, scaled by the
+	 * time since the band was closed (age * invalidity / (1 - invalidity)). Recently written
+	 * bands, likely to hold hot data, are given time to be invalidated further.
+	 */
+	SPDK_FTL_GC_POLICY_COST_BENEFIT,
+
+	SPDK_FTL_GC_POLICY_MAX
+};
+
+enum spdk_ftl_l2p_evict_policy {
+	/* Evict the least recently used L2P page */
+	SPDK_FTL_L2P_EVICT_LRU = 0,
+
+	/*
+	 * Evict the least recently used page among the ones not modified since they were last
+	 * persisted, if there is any close to the cold end of the LRU list. Such pages are dropped
+	 * without writing them back, freeing cache space faster under page-in heavy workloads.
+	 */
+	SPDK_FTL_L2P_EVICT_CLEAN_FIRST,
+
+	SPDK_FTL_L2P_EVICT_MAX
+};
 
 enum spdk_ftl_mode {
 	/* Create new device */
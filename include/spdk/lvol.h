@@ -276,6 +276,20 @@ void spdk_lvol_inflate(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void
  */
 void spdk_lvol_decouple_parent(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Defragment lvol
+ *
+ * Relocates clusters of the lvol so that they are laid out contiguously on
+ * the lvol store device. The lvol remains usable during the operation.
+ *
+ * \param lvol Handle to lvol
+ * \param max_mbytes_per_sec Upper limit on the copy bandwidth in MiB/s, 0 means unlimited
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ */
+void spdk_lvol_defrag(struct spdk_lvol *lvol, uint64_t max_mbytes_per_sec,
+		      spdk_lvol_op_complete cb_fn, void *cb_arg);
+
 #ifdef __cplusplus
 }
 #endif
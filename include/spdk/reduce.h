@@ -15,6 +15,29 @@
 
 #define REDUCE_MAX_IOVECS	33
 
+/**
+ * Flags of an spdk_reduce_vol, see spdk_reduce_vol_params.flags.
+ */
+enum spdk_reduce_vol_flags {
+	/**
+	 * Store compressed chunks back to back instead of in whole backing
+	 *  io units.  The end of a compressed chunk that does not fill a whole
+	 *  io unit shares an io unit with the ends of other chunks.  Space left
+	 *  behind in those io units by overwrites is reclaimed with
+	 *  spdk_reduce_vol_compact().
+	 */
+	SPDK_REDUCE_VOL_FLAG_PACKED	= 1u << 0,
+
+	/**
+	 * Keep the logical and chunk maps in memory instead of in a persistent
+	 *  memory file.  Updates to the maps are persisted through a write-ahead
+	 *  log on the backing device, and the maps are checkpointed next to the
+	 *  log whenever it fills up and when the volume is unloaded.  Loading the
+	 *  volume replays at most one log's worth of updates.
+	 */
+	SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD	= 1u << 1,
+};
+
 /**
  * Describes the parameters of an spdk_reduce_vol.
  */
@@ -54,6 +77,22 @@ struct spdk_reduce_vol_params {
 	 *  of the chunk size.
 	 */
 	uint64_t		vol_size;
+
+	/**
+	 * Compression algorithm and level of the volume.  libreduce does
+	 *  not interpret them, it stores them with the volume for the
+	 *  backing device's compress and decompress functions.  They are
+	 *  0 for volumes created before they were added.
+	 */
+	uint32_t		comp_algo;
+	uint32_t		comp_level;
+
+	/**
+	 * Flags of the volume, see enum spdk_reduce_vol_flags.  They
+	 *  are set when the volume is initialized and cannot be changed
+	 *  afterwards.
+	 */
+	uint32_t		flags;
 };
 
 struct spdk_reduce_vol;
@@ -80,6 +119,9 @@ typedef void (*spdk_reduce_dev_cpl)(void *cb_arg, int reduce_errno);
 struct spdk_reduce_vol_cb_args {
 	spdk_reduce_dev_cpl	cb_fn;
 	void			*cb_arg;
+	/* Scratch space for the backing device to store the output size of a
+	 *  compress or decompress operation in */
+	uint32_t		output_size;
 };
 
 struct spdk_reduce_backing_dev {
@@ -123,7 +165,8 @@ const struct spdk_uuid *spdk_reduce_vol_get_uuid(struct spdk_reduce_vol *vol);
  * \param backing_dev Structure describing the backing device to use for the new volume.
  * \param pm_file_dir Directory to use for creation of the persistent memory file to
  *                    use for the new volume.  This function will append the UUID as
- *		      the filename to create in this directory.
+ *		      the filename to create in this directory.  Not used, and may be
+ *		      NULL, if SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD is set in params.
  * \param cb_fn Callback function to signal completion of the initialization process.
  * \param cb_arg Argument to pass to the callback function.
  */
@@ -207,6 +250,25 @@ void spdk_reduce_vol_writev(struct spdk_reduce_vol *vol,
 			    struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length,
 			    spdk_reduce_vol_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Compact a packed libreduce compressed volume.
+ *
+ * Overwrites can leave the end of a compressed chunk alone in a backing io unit
+ *  that used to be shared with other chunks.  This function looks at up to
+ *  max_chunks chunks, starting where the previous call stopped, and moves such
+ *  chunk ends into io units shared with other chunks, freeing the io units they
+ *  occupied.  Chunks with reads or writes in progress are skipped.
+ *
+ * \param vol Volume to compact.
+ * \param max_chunks Maximum number of chunks to look at.
+ * \param cb_fn Callback function to signal completion of the compaction.  It is
+ *  called with -ENOTSUP if the volume is not packed and -EBUSY if a compaction is
+ *  already in progress.
+ * \param cb_arg Argument to pass to the callback function.
+ */
+void spdk_reduce_vol_compact(struct spdk_reduce_vol *vol, uint64_t max_chunks,
+			     spdk_reduce_vol_op_complete cb_fn, void *cb_arg);
+
 /**
  * Get the params structure for a libreduce compressed volume.
  *
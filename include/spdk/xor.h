@@ -0,0 +1,43 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+/**
+ * \file
+ * XOR utility functions
+ */
+
+#ifndef SPDK_XOR_H
+#define SPDK_XOR_H
+
+#include "spdk/stdinc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Generate XOR from multiple source buffers.
+ *
+ * \param dest Destination buffer. May be one of the sources.
+ * \param sources Array of source buffers.
+ * \param n Number of source buffers, at least 2.
+ * \param len Length of each buffer in bytes.
+ * \return 0 on success, negative error code otherwise.
+ */
+int spdk_xor_gen(void *dest, void **sources, uint32_t n, size_t len);
+
+/**
+ * Get the buffer alignment in bytes that gives the best performance of
+ * spdk_xor_gen(). The length should be a multiple of it as well.
+ *
+ * \return Alignment in bytes.
+ */
+size_t spdk_xor_get_optimal_alignment(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPDK_XOR_H */
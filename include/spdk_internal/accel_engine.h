@@ -14,6 +14,10 @@
 
 struct spdk_accel_task;
 
+/*
+ * Complete a task. Steps of a sequence (task->seq != NULL) may be completed from
+ * within submit_tasks, the framework then moves on to the next step right away.
+ */
 void spdk_accel_task_complete(struct spdk_accel_task *task, int status);
 
 struct spdk_accel_task {
@@ -31,21 +35,59 @@ struct spdk_accel_task {
 		void			*dst;
 		void			*src2;
 	};
+	struct {
+		struct iovec		*iovs; /* dst iovs for encrypt/decrypt and DIF copies */
+		uint32_t		iovcnt;
+	} d;
+	struct {
+		const struct spdk_dif_ctx	*ctx;
+		struct spdk_dif_error		*err;
+		uint32_t			num_blocks;
+	} dif;
+	struct {
+		void			**srcs;
+		uint32_t		cnt;
+	} nsrcs;
 	union {
 		void				*dst2;
 		uint32_t			seed;
 		uint64_t			fill_pattern;
+		uint64_t			iv;
 	};
 	union {
 		uint32_t		*crc_dst;
 		uint32_t		*output_size;
+		struct spdk_accel_crypto_key	*crypto_key;
 	};
+	struct {
+		enum spdk_accel_comp_algo	algo;
+		uint32_t			level;
+	} comp;
 	enum accel_opcode		op_code;
 	uint64_t			nbytes;
 	uint64_t			nbytes_dst;
+	uint32_t			block_size;
 	int				flags;
 	int				status;
+	/* Sequence this task is a step of, NULL for standalone tasks */
+	struct spdk_accel_sequence	*seq;
+	spdk_accel_step_cb		step_cb_fn;
 	TAILQ_ENTRY(spdk_accel_task)	link;
+	TAILQ_ENTRY(spdk_accel_task)	seq_link;
+};
+
+struct spdk_accel_crypto_key {
+	/* Engine the key was prepared by */
+	struct spdk_accel_module_if		*module_if;
+	/* Engine private data, e.g. expanded round keys */
+	void					*priv;
+	char					*name;
+	char					*cipher;
+	uint8_t					*key;
+	size_t					key_size;
+	uint8_t					*key2;
+	size_t					key2_size;
+	TAILQ_ENTRY(spdk_accel_crypto_key)	link;
 };
 
 struct spdk_accel_module_if {
@@ -78,6 +120,19 @@ struct spdk_accel_module_if {
 	struct spdk_io_channel *(*get_io_channel)(void);
 	int (*submit_tasks)(struct spdk_io_channel *ch, struct spdk_accel_task *accel_task);
 
+	/**
+	 * Prepare a key for ACCEL_OPC_ENCRYPT/DECRYPT, e.g. expand it or load it to
+	 * the device. Required by modules supporting those opcodes.
+	 */
+	int (*crypto_key_init)(struct spdk_accel_crypto_key *key);
+	void (*crypto_key_deinit)(struct spdk_accel_crypto_key *key);
+
+	/**
+	 * Compression algorithms supported by ACCEL_OPC_COMPRESS/DECOMPRESS. Modules
+	 * not defining it only support SPDK_ACCEL_COMP_ALGO_DEFLATE.
+	 */
+	bool (*compress_supports_algo)(enum spdk_accel_comp_algo algo);
+
 	TAILQ_ENTRY(spdk_accel_module_if)	tailq;
 };
 
@@ -26,6 +26,7 @@
 
 #define ALIGN_4K			0x1000
 #define MAX_TASKS_PER_CHANNEL		0x800
+#define MAX_SEQUENCES_PER_CHANNEL	0x400
 
 /* Largest context size for all accel modules */
 static size_t g_max_accel_module_size = sizeof(struct spdk_accel_task);
@@ -43,12 +44,40 @@ static TAILQ_HEAD(, spdk_accel_module_if) spdk_accel_module_list =
 static struct spdk_accel_module_if *g_engines_opc[ACCEL_OPC_LAST] = {};
 static char *g_engines_opc_override[ACCEL_OPC_LAST] = {};
 
+/* Algorithm and level of the compress operations that don't specify them */
+static enum spdk_accel_comp_algo g_comp_algo = SPDK_ACCEL_COMP_ALGO_DEFLATE;
+static uint32_t g_comp_level = 1;
+
+static const char *g_comp_algo_names[SPDK_ACCEL_COMP_ALGO_LAST] = {
+	"deflate", "lz4", "zstd"
+};
+
+/* Crypto keys, by name */
+static TAILQ_HEAD(, spdk_accel_crypto_key) g_keys = TAILQ_HEAD_INITIALIZER(g_keys);
+static pthread_mutex_t g_keys_lock = PTHREAD_MUTEX_INITIALIZER;
+
 struct accel_io_channel {
 	struct spdk_io_channel		*engine_ch[ACCEL_OPC_LAST];
 	void				*task_pool_base;
 	TAILQ_HEAD(, spdk_accel_task)	task_pool;
+	void				*seq_pool_base;
+	TAILQ_HEAD(, spdk_accel_sequence) seq_pool;
 };
 
+struct spdk_accel_sequence {
+	struct accel_io_channel			*ch;
+	/* Steps left to execute, linked through seq_link */
+	TAILQ_HEAD(accel_sequence_tasks, spdk_accel_task) tasks;
+	spdk_accel_completion_cb		cb_fn;
+	void					*cb_arg;
+	int					status;
+	/* Set while accel_process_sequence() is submitting steps */
+	bool					in_process;
+	TAILQ_ENTRY(spdk_accel_sequence)	link;
+};
+
+static void accel_sequence_task_complete(struct spdk_accel_task *task, int status);
+
 int
 spdk_accel_get_opc_engine_name(enum accel_opcode opcode, const char **engine_name)
 {
@@ -113,6 +142,11 @@ spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 	spdk_accel_completion_cb	cb_fn = accel_task->cb_fn;
 	void				*cb_arg = accel_task->cb_arg;
 
+	if (accel_task->seq != NULL) {
+		accel_sequence_task_complete(accel_task, status);
+		return;
+	}
+
 	/* We should put the accel_task into the list firstly in order to avoid
 	 * the accel task list is exhausted when there is recursive call to
 	 * allocate accel_task in user's call back function (cb_fn)
@@ -139,6 +173,7 @@ _get_task(struct accel_io_channel *accel_ch, spdk_accel_completion_cb cb_fn, voi
 	accel_task->cb_fn = cb_fn;
 	accel_task->cb_arg = cb_arg;
 	accel_task->accel_ch = accel_ch;
+	accel_task->seq = NULL;
 
 	return accel_task;
 }
@@ -387,16 +422,35 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst,
 	return engine->submit_tasks(engine_ch, accel_task);
 }
 
+static bool
+accel_engine_supports_algo(struct spdk_accel_module_if *engine, enum spdk_accel_comp_algo algo)
+{
+	if (engine == NULL || algo >= SPDK_ACCEL_COMP_ALGO_LAST) {
+		return false;
+	}
+
+	if (engine->compress_supports_algo == NULL) {
+		return algo == SPDK_ACCEL_COMP_ALGO_DEFLATE;
+	}
+
+	return engine->compress_supports_algo(algo);
+}
+
 int
-spdk_accel_submit_compress(struct spdk_io_channel *ch, void *dst, void *src, uint64_t nbytes_dst,
-			   uint64_t nbytes_src, uint32_t *output_size, int flags,
-			   spdk_accel_completion_cb cb_fn, void *cb_arg)
+spdk_accel_submit_compress_ext(struct spdk_io_channel *ch, void *dst, void *src,
+			       uint64_t nbytes_dst, uint64_t nbytes_src, uint32_t *output_size,
+			       enum spdk_accel_comp_algo algo, uint32_t level, int flags,
+			       spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
 	struct spdk_accel_module_if *engine = g_engines_opc[ACCEL_OPC_COMPRESS];
 	struct spdk_io_channel *engine_ch = accel_ch->engine_ch[ACCEL_OPC_COMPRESS];
 
+	if (!accel_engine_supports_algo(engine, algo)) {
+		return -ENOTSUP;
+	}
+
 	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
 	if (accel_task == NULL) {
 		return -ENOMEM;
@@ -407,40 +461,828 @@ spdk_accel_submit_compress(struct spdk_io_channel *ch, void *dst, void *src, uin
 	accel_task->dst = dst;
 	accel_task->nbytes = nbytes_src;
 	accel_task->nbytes_dst = nbytes_dst;
+	accel_task->comp.algo = algo;
+	accel_task->comp.level = level;
 	accel_task->flags = flags;
 	accel_task->op_code = ACCEL_OPC_COMPRESS;
 
 	return engine->submit_tasks(engine_ch, accel_task);
+}
 
-	return 0;
+int
+spdk_accel_submit_compress(struct spdk_io_channel *ch, void *dst, void *src, uint64_t nbytes_dst,
+			   uint64_t nbytes_src, uint32_t *output_size, int flags,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return spdk_accel_submit_compress_ext(ch, dst, src, nbytes_dst, nbytes_src, output_size,
+					      g_comp_algo, g_comp_level, flags, cb_fn, cb_arg);
 }
 
 int
-spdk_accel_submit_decompress(struct spdk_io_channel *ch, void *dst, void *src, uint64_t nbytes_dst,
-			     uint64_t nbytes_src, int flags, spdk_accel_completion_cb cb_fn, void *cb_arg)
+spdk_accel_submit_decompress_ext(struct spdk_io_channel *ch, void *dst, void *src,
+				 uint64_t nbytes_dst, uint64_t nbytes_src, uint32_t *output_size,
+				 enum spdk_accel_comp_algo algo, int flags,
+				 spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
 	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
 	struct spdk_accel_module_if *engine = g_engines_opc[ACCEL_OPC_DECOMPRESS];
 	struct spdk_io_channel *engine_ch = accel_ch->engine_ch[ACCEL_OPC_DECOMPRESS];
 
+	if (!accel_engine_supports_algo(engine, algo)) {
+		return -ENOTSUP;
+	}
+
 	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
 	if (accel_task == NULL) {
 		return -ENOMEM;
 	}
 
+	accel_task->output_size = output_size;
 	accel_task->src = src;
 	accel_task->dst = dst;
 	accel_task->nbytes = nbytes_src;
 	accel_task->nbytes_dst = nbytes_dst;
+	accel_task->comp.algo = algo;
 	accel_task->flags = flags;
 	accel_task->op_code = ACCEL_OPC_DECOMPRESS;
 
 	return engine->submit_tasks(engine_ch, accel_task);
+}
+
+int
+spdk_accel_submit_decompress(struct spdk_io_channel *ch, void *dst, void *src, uint64_t nbytes_dst,
+			     uint64_t nbytes_src, int flags, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return spdk_accel_submit_decompress_ext(ch, dst, src, nbytes_dst, nbytes_src, NULL,
+						g_comp_algo, flags, cb_fn, cb_arg);
+}
+
+int
+spdk_accel_set_compress_opts(enum spdk_accel_comp_algo algo, uint32_t level)
+{
+	if (algo >= SPDK_ACCEL_COMP_ALGO_LAST) {
+		return -EINVAL;
+	}
+
+	g_comp_algo = algo;
+	g_comp_level = level;
+
+	return 0;
+}
+
+void
+spdk_accel_get_compress_opts(enum spdk_accel_comp_algo *algo, uint32_t *level)
+{
+	*algo = g_comp_algo;
+	*level = g_comp_level;
+}
+
+bool
+spdk_accel_compress_algo_supported(enum spdk_accel_comp_algo algo)
+{
+	return accel_engine_supports_algo(g_engines_opc[ACCEL_OPC_COMPRESS], algo) &&
+	       accel_engine_supports_algo(g_engines_opc[ACCEL_OPC_DECOMPRESS], algo);
+}
+
+const char *
+spdk_accel_comp_algo_get_name(enum spdk_accel_comp_algo algo)
+{
+	if (algo >= SPDK_ACCEL_COMP_ALGO_LAST) {
+		return NULL;
+	}
+
+	return g_comp_algo_names[algo];
+}
+
+int
+spdk_accel_comp_algo_get_by_name(const char *name, enum spdk_accel_comp_algo *algo)
+{
+	enum spdk_accel_comp_algo i;
+
+	for (i = 0; i < SPDK_ACCEL_COMP_ALGO_LAST; i++) {
+		if (strcmp(g_comp_algo_names[i], name) == 0) {
+			*algo = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static void
+accel_crypto_key_free(struct spdk_accel_crypto_key *key)
+{
+	if (key->key != NULL) {
+		memset(key->key, 0, key->key_size);
+	}
+	if (key->key2 != NULL) {
+		memset(key->key2, 0, key->key2_size);
+	}
+	free(key->key);
+	free(key->key2);
+	free(key->cipher);
+	free(key->name);
+	free(key);
+}
+
+static struct spdk_accel_crypto_key *
+accel_crypto_key_find(const char *name)
+{
+	struct spdk_accel_crypto_key *key;
+
+	TAILQ_FOREACH(key, &g_keys, link) {
+		if (strcmp(key->name, name) == 0) {
+			return key;
+		}
+	}
+
+	return NULL;
+}
+
+int
+spdk_accel_crypto_key_create(const struct spdk_accel_crypto_key_create_param *param,
+			     struct spdk_accel_crypto_key **_key)
+{
+	struct spdk_accel_module_if *engine = g_engines_opc[ACCEL_OPC_ENCRYPT];
+	struct spdk_accel_crypto_key *key;
+	int rc;
+
+	if (param->key_name == NULL || param->cipher == NULL || param->key == NULL ||
+	    param->key2 == NULL) {
+		return -EINVAL;
+	}
+
+	if (strcmp(param->cipher, ACCEL_AES_XTS) != 0) {
+		SPDK_ERRLOG("Cipher %s is not supported\n", param->cipher);
+		return -EINVAL;
+	}
+
+	if ((param->key_size != 16 && param->key_size != 32) || param->key2_size != param->key_size) {
+		SPDK_ERRLOG("Invalid key sizes %zu and %zu for %s\n", param->key_size, param->key2_size,
+			    param->cipher);
+		return -EINVAL;
+	}
+
+	if (engine == NULL || engine != g_engines_opc[ACCEL_OPC_DECRYPT]) {
+		SPDK_ERRLOG("Encrypt and decrypt must be assigned to the same engine\n");
+		return -EINVAL;
+	}
+
+	if (engine->crypto_key_init == NULL) {
+		SPDK_ERRLOG("Engine %s cannot prepare crypto keys\n", engine->name);
+		return -ENOTSUP;
+	}
+
+	key = calloc(1, sizeof(*key));
+	if (key == NULL) {
+		return -ENOMEM;
+	}
+
+	key->name = strdup(param->key_name);
+	key->cipher = strdup(param->cipher);
+	key->key = malloc(param->key_size);
+	key->key2 = malloc(param->key2_size);
+	if (key->name == NULL || key->cipher == NULL || key->key == NULL || key->key2 == NULL) {
+		accel_crypto_key_free(key);
+		return -ENOMEM;
+	}
+
+	memcpy(key->key, param->key, param->key_size);
+	key->key_size = param->key_size;
+	memcpy(key->key2, param->key2, param->key2_size);
+	key->key2_size = param->key2_size;
+	key->module_if = engine;
+
+	pthread_mutex_lock(&g_keys_lock);
+	if (accel_crypto_key_find(key->name) != NULL) {
+		pthread_mutex_unlock(&g_keys_lock);
+		accel_crypto_key_free(key);
+		return -EEXIST;
+	}
 
+	rc = engine->crypto_key_init(key);
+	if (rc != 0) {
+		pthread_mutex_unlock(&g_keys_lock);
+		SPDK_ERRLOG("Engine %s failed to prepare key %s: %d\n", engine->name, param->key_name, rc);
+		accel_crypto_key_free(key);
+		return rc;
+	}
+
+	TAILQ_INSERT_TAIL(&g_keys, key, link);
+	pthread_mutex_unlock(&g_keys_lock);
+
+	*_key = key;
 	return 0;
 }
 
+struct spdk_accel_crypto_key *
+spdk_accel_crypto_key_get(const char *name)
+{
+	struct spdk_accel_crypto_key *key;
+
+	pthread_mutex_lock(&g_keys_lock);
+	key = accel_crypto_key_find(name);
+	pthread_mutex_unlock(&g_keys_lock);
+
+	return key;
+}
+
+void
+spdk_accel_crypto_key_destroy(struct spdk_accel_crypto_key *key)
+{
+	if (key == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&g_keys_lock);
+	TAILQ_REMOVE(&g_keys, key, link);
+	pthread_mutex_unlock(&g_keys_lock);
+
+	if (key->module_if->crypto_key_deinit != NULL) {
+		key->module_if->crypto_key_deinit(key);
+	}
+	accel_crypto_key_free(key);
+}
+
+static int
+accel_submit_crypto(struct spdk_io_channel *ch, enum accel_opcode opcode,
+		    struct spdk_accel_crypto_key *key,
+		    struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		    struct iovec *src_iovs, uint32_t src_iovcnt,
+		    uint64_t iv, uint32_t block_size, int flags,
+		    spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+	struct spdk_accel_module_if *engine = g_engines_opc[opcode];
+	struct spdk_io_channel *engine_ch = accel_ch->engine_ch[opcode];
+
+	if (spdk_unlikely(key == NULL || dst_iovs == NULL || dst_iovcnt == 0 ||
+			  src_iovs == NULL || src_iovcnt == 0 || block_size == 0)) {
+		return -EINVAL;
+	}
+
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->crypto_key = key;
+	accel_task->v.iovs = src_iovs;
+	accel_task->v.iovcnt = src_iovcnt;
+	accel_task->d.iovs = dst_iovs;
+	accel_task->d.iovcnt = dst_iovcnt;
+	accel_task->iv = iv;
+	accel_task->block_size = block_size;
+	accel_task->flags = flags;
+	accel_task->op_code = opcode;
+
+	return engine->submit_tasks(engine_ch, accel_task);
+}
+
+int
+spdk_accel_submit_encrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return accel_submit_crypto(ch, ACCEL_OPC_ENCRYPT, key, dst_iovs, dst_iovcnt, src_iovs,
+				   src_iovcnt, iv, block_size, flags, cb_fn, cb_arg);
+}
+
+int
+spdk_accel_submit_decrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return accel_submit_crypto(ch, ACCEL_OPC_DECRYPT, key, dst_iovs, dst_iovcnt, src_iovs,
+				   src_iovcnt, iv, block_size, flags, cb_fn, cb_arg);
+}
+
+static int
+accel_submit_dif(struct spdk_io_channel *ch, enum accel_opcode opcode,
+		 struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		 struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t num_blocks,
+		 const struct spdk_dif_ctx *ctx, struct spdk_dif_error *err,
+		 spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+	struct spdk_accel_module_if *engine = g_engines_opc[opcode];
+	struct spdk_io_channel *engine_ch = accel_ch->engine_ch[opcode];
+
+	if (spdk_unlikely(ctx == NULL || src_iovs == NULL || src_iovcnt == 0)) {
+		return -EINVAL;
+	}
+
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->v.iovs = src_iovs;
+	accel_task->v.iovcnt = src_iovcnt;
+	accel_task->d.iovs = dst_iovs;
+	accel_task->d.iovcnt = dst_iovcnt;
+	accel_task->dif.ctx = ctx;
+	accel_task->dif.err = err;
+	accel_task->dif.num_blocks = num_blocks;
+	accel_task->nbytes = (uint64_t)num_blocks * ctx->block_size;
+	accel_task->flags = 0;
+	accel_task->op_code = opcode;
+
+	return engine->submit_tasks(engine_ch, accel_task);
+}
+
+int
+spdk_accel_submit_dif_verify(struct spdk_io_channel *ch, struct iovec *iovs, uint32_t iovcnt,
+			     uint32_t num_blocks, const struct spdk_dif_ctx *ctx,
+			     struct spdk_dif_error *err, spdk_accel_completion_cb cb_fn,
+			     void *cb_arg)
+{
+	return accel_submit_dif(ch, ACCEL_OPC_DIF_VERIFY, NULL, 0, iovs, iovcnt, num_blocks, ctx,
+				err, cb_fn, cb_arg);
+}
+
+int
+spdk_accel_submit_dif_generate(struct spdk_io_channel *ch, struct iovec *iovs,
+			       uint32_t iovcnt, uint32_t num_blocks,
+			       const struct spdk_dif_ctx *ctx,
+			       spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return accel_submit_dif(ch, ACCEL_OPC_DIF_GENERATE, NULL, 0, iovs, iovcnt, num_blocks, ctx,
+				NULL, cb_fn, cb_arg);
+}
+
+int
+spdk_accel_submit_dif_generate_copy(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+				    uint32_t dst_iovcnt, struct iovec *src_iovs,
+				    uint32_t src_iovcnt, uint32_t num_blocks,
+				    const struct spdk_dif_ctx *ctx,
+				    spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	if (spdk_unlikely(dst_iovs == NULL || dst_iovcnt == 0)) {
+		return -EINVAL;
+	}
+
+	return accel_submit_dif(ch, ACCEL_OPC_DIF_GENERATE_COPY, dst_iovs, dst_iovcnt, src_iovs,
+				src_iovcnt, num_blocks, ctx, NULL, cb_fn, cb_arg);
+}
+
+int
+spdk_accel_submit_dif_verify_copy(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+				  uint32_t dst_iovcnt, struct iovec *src_iovs,
+				  uint32_t src_iovcnt, uint32_t num_blocks,
+				  const struct spdk_dif_ctx *ctx, struct spdk_dif_error *err,
+				  spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	if (spdk_unlikely(dst_iovs == NULL || dst_iovcnt == 0)) {
+		return -EINVAL;
+	}
+
+	return accel_submit_dif(ch, ACCEL_OPC_DIF_VERIFY_COPY, dst_iovs, dst_iovcnt, src_iovs,
+				src_iovcnt, num_blocks, ctx, err, cb_fn, cb_arg);
+}
+
+/* Accel framework public API for xor function */
+int
+spdk_accel_submit_xor(struct spdk_io_channel *ch, void *dst, void **sources, uint32_t nsrcs,
+		      uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+	struct spdk_accel_module_if *engine = g_engines_opc[ACCEL_OPC_XOR];
+	struct spdk_io_channel *engine_ch = accel_ch->engine_ch[ACCEL_OPC_XOR];
+
+	if (spdk_unlikely(nsrcs < 2)) {
+		return -EINVAL;
+	}
+
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->nsrcs.srcs = sources;
+	accel_task->nsrcs.cnt = nsrcs;
+	accel_task->dst = dst;
+	accel_task->nbytes = nbytes;
+	accel_task->op_code = ACCEL_OPC_XOR;
+
+	return engine->submit_tasks(engine_ch, accel_task);
+}
+
+static void
+accel_sequence_put_tasks(struct spdk_accel_sequence *seq)
+{
+	struct accel_io_channel *accel_ch = seq->ch;
+	struct spdk_accel_task *task;
+
+	while ((task = TAILQ_FIRST(&seq->tasks)) != NULL) {
+		TAILQ_REMOVE(&seq->tasks, task, seq_link);
+		TAILQ_INSERT_HEAD(&accel_ch->task_pool, task, link);
+	}
+}
+
+static void
+accel_sequence_complete(struct spdk_accel_sequence *seq)
+{
+	struct accel_io_channel *accel_ch = seq->ch;
+	spdk_accel_completion_cb cb_fn = seq->cb_fn;
+	void *cb_arg = seq->cb_arg;
+	int status = seq->status;
+
+	/* Only a failed sequence has steps left */
+	accel_sequence_put_tasks(seq);
+	TAILQ_INSERT_HEAD(&accel_ch->seq_pool, seq, link);
+
+	cb_fn(cb_arg, status);
+}
+
+static void
+accel_sequence_complete_msg(void *ctx)
+{
+	accel_sequence_complete(ctx);
+}
+
+/* Submit the steps of a sequence one after the other. Steps completed from within
+ * submit_tasks, like the ones of the software engine, are followed by the next step
+ * right away. Otherwise the sequence is resumed from the completion of the step. */
+static void
+accel_process_sequence(struct spdk_accel_sequence *seq, bool defer_completion)
+{
+	struct accel_io_channel *accel_ch = seq->ch;
+	struct spdk_accel_module_if *engine;
+	struct spdk_accel_task *task;
+	int rc;
+
+	seq->in_process = true;
+	while (seq->status == 0 && (task = TAILQ_FIRST(&seq->tasks)) != NULL) {
+		engine = g_engines_opc[task->op_code];
+		rc = engine->submit_tasks(accel_ch->engine_ch[task->op_code], task);
+		if (spdk_unlikely(rc != 0)) {
+			accel_sequence_task_complete(task, rc);
+			break;
+		}
+
+		if (TAILQ_FIRST(&seq->tasks) == task) {
+			/* Still in flight */
+			seq->in_process = false;
+			return;
+		}
+	}
+	seq->in_process = false;
+
+	if (defer_completion) {
+		spdk_thread_send_msg(spdk_get_thread(), accel_sequence_complete_msg, seq);
+	} else {
+		accel_sequence_complete(seq);
+	}
+}
+
+static void
+accel_sequence_task_complete(struct spdk_accel_task *task, int status)
+{
+	struct spdk_accel_sequence *seq = task->seq;
+	struct accel_io_channel *accel_ch = task->accel_ch;
+	spdk_accel_step_cb step_cb_fn = task->step_cb_fn;
+	void *step_cb_arg = task->cb_arg;
+
+	TAILQ_REMOVE(&seq->tasks, task, seq_link);
+	TAILQ_INSERT_HEAD(&accel_ch->task_pool, task, link);
+
+	if (spdk_unlikely(status != 0)) {
+		seq->status = status;
+	} else if (step_cb_fn != NULL) {
+		step_cb_fn(step_cb_arg);
+	}
+
+	if (!seq->in_process) {
+		accel_process_sequence(seq, false);
+	}
+}
+
+/* Get a task for a new step of seq, starting a new sequence if seq is NULL. */
+static struct spdk_accel_task *
+accel_sequence_get_task(struct accel_io_channel *accel_ch, struct spdk_accel_sequence *seq,
+			spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_task *accel_task;
+	bool new_seq = false;
+
+	if (seq == NULL) {
+		seq = TAILQ_FIRST(&accel_ch->seq_pool);
+		if (seq == NULL) {
+			return NULL;
+		}
+
+		TAILQ_REMOVE(&accel_ch->seq_pool, seq, link);
+		TAILQ_INIT(&seq->tasks);
+		seq->ch = accel_ch;
+		seq->cb_fn = NULL;
+		seq->cb_arg = NULL;
+		seq->status = 0;
+		seq->in_process = false;
+		new_seq = true;
+	}
+
+	assert(seq->ch == accel_ch);
+
+	accel_task = _get_task(accel_ch, NULL, cb_arg);
+	if (accel_task == NULL) {
+		if (new_seq) {
+			TAILQ_INSERT_HEAD(&accel_ch->seq_pool, seq, link);
+		}
+		return NULL;
+	}
+
+	accel_task->seq = seq;
+	accel_task->step_cb_fn = cb_fn;
+
+	return accel_task;
+}
+
+static void
+accel_sequence_append_task(struct spdk_accel_sequence **pseq, struct spdk_accel_task *accel_task)
+{
+	TAILQ_INSERT_TAIL(&accel_task->seq->tasks, accel_task, seq_link);
+	*pseq = accel_task->seq;
+}
+
+int
+spdk_accel_append_copy(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+		       struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		       struct iovec *src_iovs, uint32_t src_iovcnt, int flags,
+		       spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct accel_sequence_tasks tasks = TAILQ_HEAD_INITIALIZER(tasks);
+	struct spdk_accel_sequence *seq = *pseq;
+	struct spdk_accel_task *accel_task;
+	struct spdk_ioviter iter;
+	void *src, *dst;
+	size_t len;
+
+	/* None of the engines takes iovecs for a plain copy, so every contiguous
+	 * segment is a step of its own. */
+	for (len = spdk_ioviter_first(&iter, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, &src, &dst);
+	     len != 0;
+	     len = spdk_ioviter_next(&iter, &src, &dst)) {
+		accel_task = accel_sequence_get_task(accel_ch, seq, NULL, NULL);
+		if (accel_task == NULL) {
+			goto err;
+		}
+
+		seq = accel_task->seq;
+		accel_task->dst = dst;
+		accel_task->src = src;
+		accel_task->v.iovcnt = 0;
+		accel_task->nbytes = len;
+		accel_task->flags = flags;
+		accel_task->op_code = ACCEL_OPC_COPY;
+		TAILQ_INSERT_TAIL(&tasks, accel_task, seq_link);
+	}
+
+	if (TAILQ_EMPTY(&tasks)) {
+		return -EINVAL;
+	}
+
+	accel_task = TAILQ_LAST(&tasks, accel_sequence_tasks);
+	accel_task->step_cb_fn = cb_fn;
+	accel_task->cb_arg = cb_arg;
+
+	TAILQ_CONCAT(&seq->tasks, &tasks, seq_link);
+	*pseq = seq;
+
+	return 0;
+err:
+	while ((accel_task = TAILQ_FIRST(&tasks)) != NULL) {
+		TAILQ_REMOVE(&tasks, accel_task, seq_link);
+		TAILQ_INSERT_HEAD(&accel_ch->task_pool, accel_task, link);
+	}
+	if (*pseq == NULL && seq != NULL) {
+		TAILQ_INSERT_HEAD(&accel_ch->seq_pool, seq, link);
+	}
+
+	return -ENOMEM;
+}
+
+int
+spdk_accel_append_fill(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+		       void *dst, uint64_t nbytes, uint8_t pattern, int flags,
+		       spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	accel_task = accel_sequence_get_task(accel_ch, *pseq, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->dst = dst;
+	memset(&accel_task->fill_pattern, pattern, sizeof(uint64_t));
+	accel_task->nbytes = nbytes;
+	accel_task->flags = flags;
+	accel_task->op_code = ACCEL_OPC_FILL;
+	accel_sequence_append_task(pseq, accel_task);
+
+	return 0;
+}
+
+/* Check whether a copy step moves exactly the data described by iov. */
+static bool
+accel_copy_covers_iov(struct spdk_accel_task *accel_task, struct iovec *iov)
+{
+	if (accel_task->op_code != ACCEL_OPC_COPY || accel_task->nbytes != iov->iov_len) {
+		return false;
+	}
+
+	return accel_task->src == iov->iov_base || accel_task->dst == iov->iov_base;
+}
+
+int
+spdk_accel_append_crc32c(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+			 uint32_t *crc_dst, struct iovec *iovs, uint32_t iovcnt, uint32_t seed,
+			 spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	if (iovs == NULL || iovcnt == 0) {
+		return -EINVAL;
+	}
+
+	/* The CRC of the data just copied is computed by the copy itself, which
+	 * engines like DSA do in a single descriptor. The source and destination
+	 * hold the same data once the copy is done, so either one matches. */
+	if (*pseq != NULL && iovcnt == 1) {
+		accel_task = TAILQ_LAST(&(*pseq)->tasks, accel_sequence_tasks);
+		if (accel_task != NULL && accel_task->step_cb_fn == NULL &&
+		    accel_copy_covers_iov(accel_task, iovs)) {
+			accel_task->crc_dst = crc_dst;
+			accel_task->seed = seed;
+			accel_task->op_code = ACCEL_OPC_COPY_CRC32C;
+			accel_task->step_cb_fn = cb_fn;
+			accel_task->cb_arg = cb_arg;
+			return 0;
+		}
+	}
+
+	accel_task = accel_sequence_get_task(accel_ch, *pseq, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->v.iovs = iovs;
+	accel_task->v.iovcnt = iovcnt;
+	accel_task->crc_dst = crc_dst;
+	accel_task->seed = seed;
+	accel_task->op_code = ACCEL_OPC_CRC32C;
+	accel_sequence_append_task(pseq, accel_task);
+
+	return 0;
+}
+
+int
+spdk_accel_append_compress(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+			   void *dst, void *src, uint64_t nbytes_dst, uint64_t nbytes_src,
+			   uint32_t *output_size, int flags,
+			   spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	accel_task = accel_sequence_get_task(accel_ch, *pseq, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->output_size = output_size;
+	accel_task->src = src;
+	accel_task->dst = dst;
+	accel_task->nbytes = nbytes_src;
+	accel_task->nbytes_dst = nbytes_dst;
+	accel_task->comp.algo = g_comp_algo;
+	accel_task->comp.level = g_comp_level;
+	accel_task->flags = flags;
+	accel_task->op_code = ACCEL_OPC_COMPRESS;
+	accel_sequence_append_task(pseq, accel_task);
+
+	return 0;
+}
+
+int
+spdk_accel_append_decompress(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+			     void *dst, void *src, uint64_t nbytes_dst, uint64_t nbytes_src,
+			     int flags, spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	accel_task = accel_sequence_get_task(accel_ch, *pseq, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->output_size = NULL;
+	accel_task->src = src;
+	accel_task->dst = dst;
+	accel_task->nbytes = nbytes_src;
+	accel_task->nbytes_dst = nbytes_dst;
+	accel_task->comp.algo = g_comp_algo;
+	accel_task->flags = flags;
+	accel_task->op_code = ACCEL_OPC_DECOMPRESS;
+	accel_sequence_append_task(pseq, accel_task);
+
+	return 0;
+}
+
+static int
+accel_append_crypto(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+		    enum accel_opcode opcode, struct spdk_accel_crypto_key *key,
+		    struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		    struct iovec *src_iovs, uint32_t src_iovcnt,
+		    uint64_t iv, uint32_t block_size, int flags,
+		    spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	if (key == NULL || dst_iovs == NULL || dst_iovcnt == 0 || src_iovs == NULL ||
+	    src_iovcnt == 0 || block_size == 0) {
+		return -EINVAL;
+	}
+
+	accel_task = accel_sequence_get_task(accel_ch, *pseq, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->crypto_key = key;
+	accel_task->v.iovs = src_iovs;
+	accel_task->v.iovcnt = src_iovcnt;
+	accel_task->d.iovs = dst_iovs;
+	accel_task->d.iovcnt = dst_iovcnt;
+	accel_task->iv = iv;
+	accel_task->block_size = block_size;
+	accel_task->flags = flags;
+	accel_task->op_code = opcode;
+	accel_sequence_append_task(pseq, accel_task);
+
+	return 0;
+}
+
+int
+spdk_accel_append_encrypt(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+			  struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	return accel_append_crypto(pseq, ch, ACCEL_OPC_ENCRYPT, key, dst_iovs, dst_iovcnt,
+				   src_iovs, src_iovcnt, iv, block_size, flags, cb_fn, cb_arg);
+}
+
+int
+spdk_accel_append_decrypt(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+			  struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	return accel_append_crypto(pseq, ch, ACCEL_OPC_DECRYPT, key, dst_iovs, dst_iovcnt,
+				   src_iovs, src_iovcnt, iv, block_size, flags, cb_fn, cb_arg);
+}
+
+void
+spdk_accel_sequence_finish(struct spdk_accel_sequence *seq,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	assert(seq != NULL);
+
+	seq->cb_fn = cb_fn;
+	seq->cb_arg = cb_arg;
+
+	accel_process_sequence(seq, true);
+}
+
+void
+spdk_accel_sequence_abort(struct spdk_accel_sequence *seq)
+{
+	if (seq == NULL) {
+		return;
+	}
+
+	accel_sequence_put_tasks(seq);
+	TAILQ_INSERT_HEAD(&seq->ch->seq_pool, seq, link);
+}
 
 static struct spdk_accel_module_if *
 _module_find_by_name(const char *name)
@@ -487,6 +1329,7 @@ accel_create_channel(void *io_device, void *ctx_buf)
 {
 	struct accel_io_channel	*accel_ch = ctx_buf;
 	struct spdk_accel_task *accel_task;
+	struct spdk_accel_sequence *seq;
 	uint8_t *task_mem;
 	int i, j;
 
@@ -495,6 +1338,12 @@ accel_create_channel(void *io_device, void *ctx_buf)
 		return -ENOMEM;
 	}
 
+	accel_ch->seq_pool_base = calloc(MAX_SEQUENCES_PER_CHANNEL, sizeof(struct spdk_accel_sequence));
+	if (accel_ch->seq_pool_base == NULL) {
+		free(accel_ch->task_pool_base);
+		return -ENOMEM;
+	}
+
 	TAILQ_INIT(&accel_ch->task_pool);
 	task_mem = accel_ch->task_pool_base;
 	for (i = 0 ; i < MAX_TASKS_PER_CHANNEL; i++) {
@@ -503,6 +1352,12 @@ accel_create_channel(void *io_device, void *ctx_buf)
 		task_mem += g_max_accel_module_size;
 	}
 
+	TAILQ_INIT(&accel_ch->seq_pool);
+	seq = accel_ch->seq_pool_base;
+	for (i = 0; i < MAX_SEQUENCES_PER_CHANNEL; i++) {
+		TAILQ_INSERT_TAIL(&accel_ch->seq_pool, &seq[i], link);
+	}
+
 	/* Assign engines and get IO channels for each */
 	for (i = 0; i < ACCEL_OPC_LAST; i++) {
 		accel_ch->engine_ch[i] = g_engines_opc[i]->get_io_channel();
@@ -517,6 +1372,7 @@ err:
 	for (j = 0; j < i; j++) {
 		spdk_put_io_channel(accel_ch->engine_ch[j]);
 	}
+	free(accel_ch->seq_pool_base);
 	free(accel_ch->task_pool_base);
 	return -ENOMEM;
 }
@@ -534,6 +1390,7 @@ accel_destroy_channel(void *io_device, void *ctx_buf)
 		accel_ch->engine_ch[i] = NULL;
 	}
 
+	free(accel_ch->seq_pool_base);
 	free(accel_ch->task_pool_base);
 }
 
@@ -624,10 +1481,17 @@ spdk_accel_write_config_json(struct spdk_json_write_ctx *w)
 	struct spdk_accel_module_if *accel_engine_module;
 
 	/*
-	 * The accel fw has no config, there may be some in
-	 * the engines/modules though.
+	 * The only accel fw config is the default compression algorithm and
+	 * level, there may be more in the engines/modules though.
 	 */
 	spdk_json_write_array_begin(w);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "accel_set_compress_opts");
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "algo", g_comp_algo_names[g_comp_algo]);
+	spdk_json_write_named_uint32(w, "level", g_comp_level);
+	spdk_json_write_object_end(w);
+	spdk_json_write_object_end(w);
 	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
 		if (accel_engine_module->write_config_json) {
 			accel_engine_module->write_config_json(w);
@@ -675,6 +1539,10 @@ spdk_accel_finish(spdk_accel_fini_cb cb_fn, void *cb_arg)
 		g_engines_opc[op] = NULL;
 	}
 
+	while (!TAILQ_EMPTY(&g_keys)) {
+		spdk_accel_crypto_key_destroy(TAILQ_FIRST(&g_keys));
+	}
+
 	spdk_io_device_unregister(&spdk_accel_module_list, NULL);
 	spdk_accel_module_finish();
 }
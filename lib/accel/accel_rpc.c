@@ -7,13 +7,15 @@
 
 #include "spdk/rpc.h"
 #include "spdk/util.h"
+#include "spdk/string.h"
 #include "spdk/event.h"
 #include "spdk/stdinc.h"
 #include "spdk/env.h"
 
 const char *g_opcode_strings[ACCEL_OPC_LAST] = {
 	"copy", "fill", "dualcast", "compare", "crc32c", "copy_crc32c",
-	"compress", "decompress"
+	"compress", "decompress", "encrypt", "decrypt", "dif_verify", "dif_generate",
+	"dif_generate_copy", "dif_verify_copy", "xor"
 };
 
 static int
@@ -187,3 +189,52 @@ cleanup:
 
 }
 SPDK_RPC_REGISTER("accel_assign_opc", rpc_accel_assign_opc, SPDK_RPC_STARTUP)
+
+struct rpc_accel_set_compress_opts {
+	char *algo;
+	uint32_t level;
+};
+
+static const struct spdk_json_object_decoder rpc_accel_set_compress_opts_decoders[] = {
+	{"algo", offsetof(struct rpc_accel_set_compress_opts, algo), spdk_json_decode_string},
+	{"level", offsetof(struct rpc_accel_set_compress_opts, level), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_accel_set_compress_opts(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_accel_set_compress_opts req = {};
+	enum spdk_accel_comp_algo algo;
+	int rc;
+
+	spdk_accel_get_compress_opts(&algo, &req.level);
+	if (spdk_json_decode_object(params, rpc_accel_set_compress_opts_decoders,
+				    SPDK_COUNTOF(rpc_accel_set_compress_opts_decoders),
+				    &req)) {
+		SPDK_DEBUGLOG(accel, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_accel_comp_algo_get_by_name(req.algo, &algo);
+	if (rc) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Invalid compression algorithm: %s", req.algo);
+		goto cleanup;
+	}
+
+	rc = spdk_accel_set_compress_opts(algo, req.level);
+	if (rc) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free(req.algo);
+}
+SPDK_RPC_REGISTER("accel_set_compress_opts", rpc_accel_set_compress_opts,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
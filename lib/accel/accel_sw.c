@@ -14,6 +14,7 @@
 #include "spdk/json.h"
 #include "spdk/crc32.h"
 #include "spdk/util.h"
+#include "spdk/xor.h"
 
 #ifdef SPDK_CONFIG_PMDK
 #include "libpmem.h"
@@ -23,24 +24,55 @@
 #include "../isa-l/include/igzip_lib.h"
 #endif
 
+#ifdef SPDK_CONFIG_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#ifdef SPDK_CONFIG_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
+#if defined(__x86_64__)
+#include <wmmintrin.h>
+#define SW_ACCEL_AES_NI
+#define SW_ACCEL_AES_MAX_ROUNDS	14
+#define SW_ACCEL_AES_BLOCK_SIZE	16
+
+/* Expanded AES-XTS key. The data key is used for both directions, the tweak
+ * key only ever encrypts. */
+struct sw_accel_xts_key {
+	__m128i		enc[SW_ACCEL_AES_MAX_ROUNDS + 1];
+	__m128i		dec[SW_ACCEL_AES_MAX_ROUNDS + 1];
+	__m128i		tweak[SW_ACCEL_AES_MAX_ROUNDS + 1];
+	int		rounds;
+};
+#endif
+
 struct sw_accel_io_channel {
 	/* for ISAL */
 #ifdef SPDK_CONFIG_ISAL
 	struct isal_zstream		stream;
 	struct inflate_state		state;
+	/* Buffer of each deflate level, allocated on first use */
+	uint8_t				*isal_level_buf[ISAL_DEF_MAX_LEVEL + 1];
+#endif
+#ifdef SPDK_CONFIG_LZ4
+	void				*lz4_state;
+	void				*lz4hc_state;
+#endif
+#ifdef SPDK_CONFIG_ZSTD
+	ZSTD_CCtx			*zstd_cctx;
+	ZSTD_DCtx			*zstd_dctx;
 #endif
 	struct spdk_poller		*completion_poller;
+	TAILQ_HEAD(, spdk_accel_task)	tasks_to_execute;
 	TAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
 };
 
-/* Post SW completions to a list and complete in a poller as we don't want to
- * complete them on the caller's stack as they'll likely submit another. */
-inline static void
-_add_to_comp_list(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task, int status)
-{
-	accel_task->status = status;
-	TAILQ_INSERT_TAIL(&sw_ch->tasks_to_complete, accel_task, link);
-}
+/* Bytes of each buffer of the next task prefetched while the current one executes */
+#define SW_ACCEL_PREFETCH_BYTES		256
 
 /* Used when the SW engine is selected and the durable flag is set. */
 inline static int
@@ -68,6 +100,13 @@ sw_accel_supports_opcode(enum accel_opcode opc)
 	case ACCEL_OPC_COPY_CRC32C:
 	case ACCEL_OPC_COMPRESS:
 	case ACCEL_OPC_DECOMPRESS:
+	case ACCEL_OPC_ENCRYPT:
+	case ACCEL_OPC_DECRYPT:
+	case ACCEL_OPC_DIF_VERIFY:
+	case ACCEL_OPC_DIF_GENERATE:
+	case ACCEL_OPC_DIF_GENERATE_COPY:
+	case ACCEL_OPC_DIF_VERIFY_COPY:
+	case ACCEL_OPC_XOR:
 		return true;
 	default:
 		return false;
@@ -171,32 +210,58 @@ _sw_accel_crc32cv(uint32_t *crc_dst, struct iovec *iov, uint32_t iovcnt, uint32_
 	*crc_dst = spdk_crc32c_iov_update(iov, iovcnt, ~seed);
 }
 
+/*
+ * Compression levels are those of the underlying library, capped at its
+ * highest one, except for level 0 which is always the fastest setting:
+ *  - deflate: ISA-L levels 0 to 3,
+ *  - lz4: level 0 is the LZ4 fast compressor, levels 1 and up are LZ4 HC levels,
+ *  - zstd: level 0 is zstd level 1, higher ones are zstd levels.
+ */
+#ifdef SPDK_CONFIG_ISAL
+static const uint32_t g_isal_level_buf_size[ISAL_DEF_MAX_LEVEL + 1] = {
+	ISAL_DEF_LVL0_DEFAULT, ISAL_DEF_LVL1_DEFAULT, ISAL_DEF_LVL2_DEFAULT, ISAL_DEF_LVL3_DEFAULT
+};
+
 static int
-_sw_accel_compress(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+_sw_accel_compress_deflate(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
 {
-#ifdef SPDK_CONFIG_ISAL
+	uint32_t level = spdk_min(accel_task->comp.level, ISAL_DEF_MAX_LEVEL);
+	int rc;
+
+	if (sw_ch->isal_level_buf[level] == NULL && g_isal_level_buf_size[level] != 0) {
+		sw_ch->isal_level_buf[level] = calloc(1, g_isal_level_buf_size[level]);
+		if (sw_ch->isal_level_buf[level] == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	sw_ch->stream.level = level;
+	sw_ch->stream.level_buf = sw_ch->isal_level_buf[level];
+	sw_ch->stream.level_buf_size = g_isal_level_buf_size[level];
 	sw_ch->stream.next_in = accel_task->src;
 	sw_ch->stream.next_out = accel_task->dst;
 	sw_ch->stream.avail_in = accel_task->nbytes;
 	sw_ch->stream.avail_out = accel_task->nbytes_dst;
 
-	isal_deflate_stateless(&sw_ch->stream);
+	rc = isal_deflate_stateless(&sw_ch->stream);
+	if (rc == STATELESS_OVERFLOW) {
+		return -ENOSPC;
+	} else if (rc != COMP_OK) {
+		SPDK_ERRLOG("isal_deflate_stateless returned error %d.\n", rc);
+		return -EINVAL;
+	}
+
 	if (accel_task->output_size != NULL) {
 		assert(accel_task->nbytes_dst > sw_ch->stream.avail_out);
 		*accel_task->output_size = accel_task->nbytes_dst - sw_ch->stream.avail_out;
 	}
 
 	return 0;
-#else
-	SPDK_ERRLOG("ISAL option is required to use software compression.\n");
-	return -EINVAL;
-#endif
 }
 
 static int
-_sw_accel_decompress(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+_sw_accel_decompress_deflate(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
 {
-#ifdef SPDK_CONFIG_ISAL
 	int rc;
 
 	sw_ch->state.next_in = accel_task->src;
@@ -207,78 +272,706 @@ _sw_accel_decompress(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *
 	rc = isal_inflate_stateless(&sw_ch->state);
 	if (rc) {
 		SPDK_ERRLOG("isal_inflate_stateless retunred error %d.\n", rc);
+		return rc;
 	}
-	return rc;
-#else
-	SPDK_ERRLOG("ISAL option is required to use software decompression.\n");
-	return -EINVAL;
-#endif
+
+	if (accel_task->output_size != NULL) {
+		*accel_task->output_size = accel_task->nbytes_dst - sw_ch->state.avail_out;
+	}
+
+	return 0;
 }
+#endif
 
+#ifdef SPDK_CONFIG_LZ4
 static int
-sw_accel_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *accel_task)
+_sw_accel_compress_lz4(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
 {
-	struct sw_accel_io_channel *sw_ch = spdk_io_channel_get_ctx(ch);
-	struct spdk_accel_task *tmp;
-	int rc = 0;
+	int dst_capacity = spdk_min(accel_task->nbytes_dst, INT_MAX);
+	int rc;
 
-	do {
-		switch (accel_task->op_code) {
-		case ACCEL_OPC_COPY:
-			rc = _check_flags(accel_task->flags);
-			if (rc == 0) {
-				_sw_accel_copy(accel_task->dst, accel_task->src, accel_task->nbytes, accel_task->flags);
+	if (accel_task->nbytes > LZ4_MAX_INPUT_SIZE) {
+		return -EINVAL;
+	}
+
+	if (accel_task->comp.level == 0) {
+		if (sw_ch->lz4_state == NULL) {
+			sw_ch->lz4_state = calloc(1, LZ4_sizeofState());
+			if (sw_ch->lz4_state == NULL) {
+				return -ENOMEM;
 			}
-			break;
-		case ACCEL_OPC_FILL:
-			rc = _check_flags(accel_task->flags);
-			if (rc == 0) {
-				_sw_accel_fill(accel_task->dst, accel_task->fill_pattern, accel_task->nbytes, accel_task->flags);
+		}
+		rc = LZ4_compress_fast_extState(sw_ch->lz4_state, accel_task->src, accel_task->dst,
+						accel_task->nbytes, dst_capacity, 1);
+	} else {
+		if (sw_ch->lz4hc_state == NULL) {
+			sw_ch->lz4hc_state = calloc(1, LZ4_sizeofStateHC());
+			if (sw_ch->lz4hc_state == NULL) {
+				return -ENOMEM;
 			}
-			break;
-		case ACCEL_OPC_DUALCAST:
-			rc = _check_flags(accel_task->flags);
-			if (rc == 0) {
-				_sw_accel_dualcast(accel_task->dst, accel_task->dst2, accel_task->src, accel_task->nbytes,
-						   accel_task->flags);
+		}
+		rc = LZ4_compress_HC_extStateHC(sw_ch->lz4hc_state, accel_task->src, accel_task->dst,
+						accel_task->nbytes, dst_capacity,
+						spdk_min(accel_task->comp.level, LZ4HC_CLEVEL_MAX));
+	}
+
+	/* LZ4 only fails if the output doesn't fit */
+	if (rc <= 0) {
+		return -ENOSPC;
+	}
+
+	if (accel_task->output_size != NULL) {
+		*accel_task->output_size = rc;
+	}
+
+	return 0;
+}
+
+static int
+_sw_accel_decompress_lz4(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	int rc;
+
+	if (accel_task->nbytes > INT_MAX) {
+		return -EINVAL;
+	}
+
+	rc = LZ4_decompress_safe(accel_task->src, accel_task->dst, accel_task->nbytes,
+				 spdk_min(accel_task->nbytes_dst, INT_MAX));
+	if (rc < 0) {
+		SPDK_ERRLOG("LZ4_decompress_safe returned error %d.\n", rc);
+		return -EINVAL;
+	}
+
+	if (accel_task->output_size != NULL) {
+		*accel_task->output_size = rc;
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef SPDK_CONFIG_ZSTD
+static int
+_sw_accel_compress_zstd(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	int level = spdk_min(spdk_max(accel_task->comp.level, 1), (uint32_t)ZSTD_maxCLevel());
+	size_t rc;
+
+	if (sw_ch->zstd_cctx == NULL) {
+		sw_ch->zstd_cctx = ZSTD_createCCtx();
+		if (sw_ch->zstd_cctx == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	rc = ZSTD_compressCCtx(sw_ch->zstd_cctx, accel_task->dst, accel_task->nbytes_dst,
+			       accel_task->src, accel_task->nbytes, level);
+	if (ZSTD_isError(rc)) {
+		if (ZSTD_getErrorCode(rc) == ZSTD_error_dstSize_tooSmall) {
+			return -ENOSPC;
+		}
+		SPDK_ERRLOG("ZSTD_compressCCtx returned error %s.\n", ZSTD_getErrorName(rc));
+		return -EINVAL;
+	}
+
+	if (accel_task->output_size != NULL) {
+		*accel_task->output_size = rc;
+	}
+
+	return 0;
+}
+
+static int
+_sw_accel_decompress_zstd(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	size_t rc;
+
+	if (sw_ch->zstd_dctx == NULL) {
+		sw_ch->zstd_dctx = ZSTD_createDCtx();
+		if (sw_ch->zstd_dctx == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	rc = ZSTD_decompressDCtx(sw_ch->zstd_dctx, accel_task->dst, accel_task->nbytes_dst,
+				 accel_task->src, accel_task->nbytes);
+	if (ZSTD_isError(rc)) {
+		SPDK_ERRLOG("ZSTD_decompressDCtx returned error %s.\n", ZSTD_getErrorName(rc));
+		return -EINVAL;
+	}
+
+	if (accel_task->output_size != NULL) {
+		*accel_task->output_size = rc;
+	}
+
+	return 0;
+}
+#endif
+
+static bool
+sw_accel_compress_supports_algo(enum spdk_accel_comp_algo algo)
+{
+	switch (algo) {
+#ifdef SPDK_CONFIG_ISAL
+	case SPDK_ACCEL_COMP_ALGO_DEFLATE:
+		return true;
+#endif
+#ifdef SPDK_CONFIG_LZ4
+	case SPDK_ACCEL_COMP_ALGO_LZ4:
+		return true;
+#endif
+#ifdef SPDK_CONFIG_ZSTD
+	case SPDK_ACCEL_COMP_ALGO_ZSTD:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+static int
+_sw_accel_compress(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	switch (accel_task->comp.algo) {
+#ifdef SPDK_CONFIG_ISAL
+	case SPDK_ACCEL_COMP_ALGO_DEFLATE:
+		return _sw_accel_compress_deflate(sw_ch, accel_task);
+#endif
+#ifdef SPDK_CONFIG_LZ4
+	case SPDK_ACCEL_COMP_ALGO_LZ4:
+		return _sw_accel_compress_lz4(sw_ch, accel_task);
+#endif
+#ifdef SPDK_CONFIG_ZSTD
+	case SPDK_ACCEL_COMP_ALGO_ZSTD:
+		return _sw_accel_compress_zstd(sw_ch, accel_task);
+#endif
+	default:
+		SPDK_ERRLOG("Compression algorithm %d is not built into the software engine.\n",
+			    accel_task->comp.algo);
+		return -ENOTSUP;
+	}
+}
+
+static int
+_sw_accel_decompress(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	switch (accel_task->comp.algo) {
+#ifdef SPDK_CONFIG_ISAL
+	case SPDK_ACCEL_COMP_ALGO_DEFLATE:
+		return _sw_accel_decompress_deflate(sw_ch, accel_task);
+#endif
+#ifdef SPDK_CONFIG_LZ4
+	case SPDK_ACCEL_COMP_ALGO_LZ4:
+		return _sw_accel_decompress_lz4(sw_ch, accel_task);
+#endif
+#ifdef SPDK_CONFIG_ZSTD
+	case SPDK_ACCEL_COMP_ALGO_ZSTD:
+		return _sw_accel_decompress_zstd(sw_ch, accel_task);
+#endif
+	default:
+		SPDK_ERRLOG("Compression algorithm %d is not built into the software engine.\n",
+			    accel_task->comp.algo);
+		return -ENOTSUP;
+	}
+}
+
+#ifdef SW_ACCEL_AES_NI
+/* AES key expansion with AES-NI. The round constant of aeskeygenassist must be
+ * an immediate, hence the macros. */
+__attribute__((target("aes"))) static inline __m128i
+_aes_expand_step(__m128i key, __m128i assist)
+{
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	return _mm_xor_si128(key, assist);
+}
+
+#define AES_128_EXPAND(rk, i, rcon) \
+	rk[i] = _aes_expand_step(rk[i - 1], \
+				 _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[i - 1], rcon), 0xff))
+
+#define AES_256_EXPAND(rk, i, rcon) \
+	rk[i] = _aes_expand_step(rk[i - 2], \
+				 _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[i - 1], rcon), 0xff))
+
+#define AES_256_EXPAND_ODD(rk, i) \
+	rk[i] = _aes_expand_step(rk[i - 2], \
+				 _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[i - 1], 0), 0xaa))
+
+__attribute__((target("aes"))) static int
+_sw_aes_expand_key(__m128i *rk, const uint8_t *key, size_t key_size)
+{
+	if (key_size == 16) {
+		rk[0] = _mm_loadu_si128((const __m128i *)key);
+		AES_128_EXPAND(rk, 1, 0x01);
+		AES_128_EXPAND(rk, 2, 0x02);
+		AES_128_EXPAND(rk, 3, 0x04);
+		AES_128_EXPAND(rk, 4, 0x08);
+		AES_128_EXPAND(rk, 5, 0x10);
+		AES_128_EXPAND(rk, 6, 0x20);
+		AES_128_EXPAND(rk, 7, 0x40);
+		AES_128_EXPAND(rk, 8, 0x80);
+		AES_128_EXPAND(rk, 9, 0x1b);
+		AES_128_EXPAND(rk, 10, 0x36);
+		return 10;
+	}
+
+	assert(key_size == 32);
+	rk[0] = _mm_loadu_si128((const __m128i *)key);
+	rk[1] = _mm_loadu_si128((const __m128i *)(key + 16));
+	AES_256_EXPAND(rk, 2, 0x01);
+	AES_256_EXPAND_ODD(rk, 3);
+	AES_256_EXPAND(rk, 4, 0x02);
+	AES_256_EXPAND_ODD(rk, 5);
+	AES_256_EXPAND(rk, 6, 0x04);
+	AES_256_EXPAND_ODD(rk, 7);
+	AES_256_EXPAND(rk, 8, 0x08);
+	AES_256_EXPAND_ODD(rk, 9);
+	AES_256_EXPAND(rk, 10, 0x10);
+	AES_256_EXPAND_ODD(rk, 11);
+	AES_256_EXPAND(rk, 12, 0x20);
+	AES_256_EXPAND_ODD(rk, 13);
+	AES_256_EXPAND(rk, 14, 0x40);
+	return 14;
+}
+
+__attribute__((target("aes"))) static inline __m128i
+_sw_aes_encrypt_block(const __m128i *rk, int rounds, __m128i block)
+{
+	int i;
+
+	block = _mm_xor_si128(block, rk[0]);
+	for (i = 1; i < rounds; i++) {
+		block = _mm_aesenc_si128(block, rk[i]);
+	}
+	return _mm_aesenclast_si128(block, rk[rounds]);
+}
+
+__attribute__((target("aes"))) static inline __m128i
+_sw_aes_decrypt_block(const __m128i *rk, int rounds, __m128i block)
+{
+	int i;
+
+	block = _mm_xor_si128(block, rk[0]);
+	for (i = 1; i < rounds; i++) {
+		block = _mm_aesdec_si128(block, rk[i]);
+	}
+	return _mm_aesdeclast_si128(block, rk[rounds]);
+}
+
+__attribute__((target("aes"))) static void
+_sw_xts_key_init(struct sw_accel_xts_key *xkey, const uint8_t *key, const uint8_t *key2,
+		 size_t key_size)
+{
+	int i;
+
+	xkey->rounds = _sw_aes_expand_key(xkey->enc, key, key_size);
+	_sw_aes_expand_key(xkey->tweak, key2, key_size);
+
+	/* Equivalent inverse cipher: reversed round keys, InvMixColumns applied
+	 * to all but the first and last one. */
+	xkey->dec[0] = xkey->enc[xkey->rounds];
+	for (i = 1; i < xkey->rounds; i++) {
+		xkey->dec[i] = _mm_aesimc_si128(xkey->enc[xkey->rounds - i]);
+	}
+	xkey->dec[xkey->rounds] = xkey->enc[0];
+}
+
+/* Multiply the tweak by x in GF(2^128), IEEE 1619 little endian convention. */
+static inline __m128i
+_sw_xts_next_tweak(__m128i tweak)
+{
+	uint64_t t[2], carry;
+
+	_mm_storeu_si128((__m128i *)t, tweak);
+	carry = t[1] >> 63;
+	t[1] = (t[1] << 1) | (t[0] >> 63);
+	t[0] = (t[0] << 1) ^ (carry * 0x87);
+
+	return _mm_loadu_si128((const __m128i *)t);
+}
+
+/* Walks an iovec array a fixed size chunk at a time. */
+struct sw_iov_cursor {
+	struct iovec	*iovs;
+	uint32_t	iovcnt;
+	uint32_t	idx;
+	size_t		off;
+};
+
+static inline void
+_sw_iov_cursor_read(struct sw_iov_cursor *c, uint8_t *buf, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		assert(c->idx < c->iovcnt);
+		n = spdk_min(len, c->iovs[c->idx].iov_len - c->off);
+		memcpy(buf, (uint8_t *)c->iovs[c->idx].iov_base + c->off, n);
+		buf += n;
+		len -= n;
+		c->off += n;
+		if (c->off == c->iovs[c->idx].iov_len) {
+			c->idx++;
+			c->off = 0;
+		}
+	}
+}
+
+static inline void
+_sw_iov_cursor_write(struct sw_iov_cursor *c, const uint8_t *buf, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		assert(c->idx < c->iovcnt);
+		n = spdk_min(len, c->iovs[c->idx].iov_len - c->off);
+		memcpy((uint8_t *)c->iovs[c->idx].iov_base + c->off, buf, n);
+		buf += n;
+		len -= n;
+		c->off += n;
+		if (c->off == c->iovs[c->idx].iov_len) {
+			c->idx++;
+			c->off = 0;
+		}
+	}
+}
+
+__attribute__((target("aes"))) static void
+_sw_xts_crypt(struct sw_accel_xts_key *xkey, bool encrypt, struct sw_iov_cursor *src,
+	      struct sw_iov_cursor *dst, uint64_t num_units, uint32_t block_size, uint64_t iv)
+{
+	const __m128i *rk = encrypt ? xkey->enc : xkey->dec;
+	uint8_t buf[SW_ACCEL_AES_BLOCK_SIZE];
+	__m128i tweak, block;
+	uint64_t unit;
+	uint32_t off;
+
+	for (unit = 0; unit < num_units; unit++) {
+		tweak = _sw_aes_encrypt_block(xkey->tweak, xkey->rounds,
+					      _mm_set_epi64x(0, (int64_t)(iv + unit)));
+
+		for (off = 0; off < block_size; off += SW_ACCEL_AES_BLOCK_SIZE) {
+			_sw_iov_cursor_read(src, buf, sizeof(buf));
+			block = _mm_xor_si128(_mm_loadu_si128((const __m128i *)buf), tweak);
+			if (encrypt) {
+				block = _sw_aes_encrypt_block(rk, xkey->rounds, block);
+			} else {
+				block = _sw_aes_decrypt_block(rk, xkey->rounds, block);
 			}
-			break;
-		case ACCEL_OPC_COMPARE:
-			rc = _sw_accel_compare(accel_task->src, accel_task->src2, accel_task->nbytes);
-			break;
-		case ACCEL_OPC_CRC32C:
+			block = _mm_xor_si128(block, tweak);
+			_mm_storeu_si128((__m128i *)buf, block);
+			_sw_iov_cursor_write(dst, buf, sizeof(buf));
+
+			tweak = _sw_xts_next_tweak(tweak);
+		}
+	}
+}
+#endif
+
+static int
+_sw_accel_crypto(struct spdk_accel_task *accel_task, bool encrypt)
+{
+#ifdef SW_ACCEL_AES_NI
+	struct sw_iov_cursor src = { .iovs = accel_task->v.iovs, .iovcnt = accel_task->v.iovcnt };
+	struct sw_iov_cursor dst = { .iovs = accel_task->d.iovs, .iovcnt = accel_task->d.iovcnt };
+	uint64_t src_len = 0, dst_len = 0;
+	uint32_t i;
+
+	for (i = 0; i < accel_task->v.iovcnt; i++) {
+		src_len += accel_task->v.iovs[i].iov_len;
+	}
+	for (i = 0; i < accel_task->d.iovcnt; i++) {
+		dst_len += accel_task->d.iovs[i].iov_len;
+	}
+
+	if (spdk_unlikely(accel_task->block_size % SW_ACCEL_AES_BLOCK_SIZE != 0 ||
+			  src_len % accel_task->block_size != 0 || dst_len < src_len)) {
+		SPDK_ERRLOG("Invalid crypto request: %" PRIu64 " bytes to %" PRIu64 " bytes, block size %u\n",
+			    src_len, dst_len, accel_task->block_size);
+		return -EINVAL;
+	}
+
+	/* Each 16 byte block is read out before its result is written back, so the
+	 * source and destination may overlap exactly for in place operation. */
+	_sw_xts_crypt(accel_task->crypto_key->priv, encrypt, &src, &dst,
+		      src_len / accel_task->block_size, accel_task->block_size, accel_task->iv);
+
+	return 0;
+#else
+	SPDK_ERRLOG("AES-NI is required to use software encryption.\n");
+	return -ENOTSUP;
+#endif
+}
+
+/* The guard CRCs are computed by ISA-L when it is available, and the copies
+ * are fused with them. */
+static int
+_sw_accel_dif(struct spdk_accel_task *accel_task)
+{
+	int rc;
+
+	switch (accel_task->op_code) {
+	case ACCEL_OPC_DIF_VERIFY:
+		rc = spdk_dif_verify(accel_task->v.iovs, accel_task->v.iovcnt,
+				     accel_task->dif.num_blocks, accel_task->dif.ctx,
+				     accel_task->dif.err);
+		break;
+	case ACCEL_OPC_DIF_GENERATE:
+		rc = spdk_dif_generate(accel_task->v.iovs, accel_task->v.iovcnt,
+				       accel_task->dif.num_blocks, accel_task->dif.ctx);
+		break;
+	case ACCEL_OPC_DIF_GENERATE_COPY:
+		rc = spdk_dif_generate_copy(accel_task->v.iovs, accel_task->v.iovcnt,
+					    accel_task->d.iovs, accel_task->d.iovcnt,
+					    accel_task->dif.num_blocks, accel_task->dif.ctx);
+		break;
+	case ACCEL_OPC_DIF_VERIFY_COPY:
+		rc = spdk_dif_verify_copy(accel_task->d.iovs, accel_task->d.iovcnt,
+					  accel_task->v.iovs, accel_task->v.iovcnt,
+					  accel_task->dif.num_blocks, accel_task->dif.ctx,
+					  accel_task->dif.err);
+		break;
+	default:
+		assert(false);
+		return -EINVAL;
+	}
+
+	/* A protection information mismatch is reported as -1, details are in dif.err */
+	return rc == -1 ? -EIO : rc;
+}
+
+static int
+sw_accel_crypto_key_init(struct spdk_accel_crypto_key *key)
+{
+#ifdef SW_ACCEL_AES_NI
+	struct sw_accel_xts_key *xkey;
+
+	if (!__builtin_cpu_supports("aes")) {
+		SPDK_ERRLOG("The CPU does not support AES-NI\n");
+		return -ENOTSUP;
+	}
+
+	/* aligned to 16 bytes like any allocation on x86_64 */
+	xkey = calloc(1, sizeof(*xkey));
+	if (xkey == NULL) {
+		return -ENOMEM;
+	}
+
+	_sw_xts_key_init(xkey, key->key, key->key2, key->key_size);
+	key->priv = xkey;
+
+	return 0;
+#else
+	SPDK_ERRLOG("AES-NI is required to use software encryption.\n");
+	return -ENOTSUP;
+#endif
+}
+
+static void
+sw_accel_crypto_key_deinit(struct spdk_accel_crypto_key *key)
+{
+#ifdef SW_ACCEL_AES_NI
+	if (key->priv != NULL) {
+		memset(key->priv, 0, sizeof(struct sw_accel_xts_key));
+		free(key->priv);
+		key->priv = NULL;
+	}
+#endif
+}
+
+static int
+_sw_accel_execute(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	int rc = 0;
+
+	switch (accel_task->op_code) {
+	case ACCEL_OPC_COPY:
+		rc = _check_flags(accel_task->flags);
+		if (rc == 0) {
+			_sw_accel_copy(accel_task->dst, accel_task->src, accel_task->nbytes, accel_task->flags);
+		}
+		break;
+	case ACCEL_OPC_FILL:
+		rc = _check_flags(accel_task->flags);
+		if (rc == 0) {
+			_sw_accel_fill(accel_task->dst, accel_task->fill_pattern, accel_task->nbytes, accel_task->flags);
+		}
+		break;
+	case ACCEL_OPC_DUALCAST:
+		rc = _check_flags(accel_task->flags);
+		if (rc == 0) {
+			_sw_accel_dualcast(accel_task->dst, accel_task->dst2, accel_task->src, accel_task->nbytes,
+					   accel_task->flags);
+		}
+		break;
+	case ACCEL_OPC_COMPARE:
+		rc = _sw_accel_compare(accel_task->src, accel_task->src2, accel_task->nbytes);
+		break;
+	case ACCEL_OPC_CRC32C:
+		if (accel_task->v.iovcnt == 0) {
+			_sw_accel_crc32c(accel_task->crc_dst, accel_task->src, accel_task->seed, accel_task->nbytes);
+		} else {
+			_sw_accel_crc32cv(accel_task->crc_dst, accel_task->v.iovs, accel_task->v.iovcnt, accel_task->seed);
+		}
+		break;
+	case ACCEL_OPC_COPY_CRC32C:
+		rc = _check_flags(accel_task->flags);
+		if (rc == 0) {
 			if (accel_task->v.iovcnt == 0) {
+				_sw_accel_copy(accel_task->dst, accel_task->src, accel_task->nbytes, accel_task->flags);
 				_sw_accel_crc32c(accel_task->crc_dst, accel_task->src, accel_task->seed, accel_task->nbytes);
 			} else {
+				_sw_accel_copyv(accel_task->dst, accel_task->v.iovs, accel_task->v.iovcnt, accel_task->flags);
 				_sw_accel_crc32cv(accel_task->crc_dst, accel_task->v.iovs, accel_task->v.iovcnt, accel_task->seed);
 			}
-			break;
-		case ACCEL_OPC_COPY_CRC32C:
-			rc = _check_flags(accel_task->flags);
-			if (rc == 0) {
-				if (accel_task->v.iovcnt == 0) {
-					_sw_accel_copy(accel_task->dst, accel_task->src, accel_task->nbytes, accel_task->flags);
-					_sw_accel_crc32c(accel_task->crc_dst, accel_task->src, accel_task->seed, accel_task->nbytes);
-				} else {
-					_sw_accel_copyv(accel_task->dst, accel_task->v.iovs, accel_task->v.iovcnt, accel_task->flags);
-					_sw_accel_crc32cv(accel_task->crc_dst, accel_task->v.iovs, accel_task->v.iovcnt, accel_task->seed);
-				}
-			}
-			break;
-		case ACCEL_OPC_COMPRESS:
-			rc = _sw_accel_compress(sw_ch, accel_task);
-			break;
-		case ACCEL_OPC_DECOMPRESS:
-			rc = _sw_accel_decompress(sw_ch, accel_task);
-			break;
-		default:
-			assert(false);
-			break;
 		}
+		break;
+	case ACCEL_OPC_COMPRESS:
+		rc = _sw_accel_compress(sw_ch, accel_task);
+		break;
+	case ACCEL_OPC_DECOMPRESS:
+		rc = _sw_accel_decompress(sw_ch, accel_task);
+		break;
+	case ACCEL_OPC_ENCRYPT:
+		rc = _sw_accel_crypto(accel_task, true);
+		break;
+	case ACCEL_OPC_DECRYPT:
+		rc = _sw_accel_crypto(accel_task, false);
+		break;
+	case ACCEL_OPC_DIF_VERIFY:
+	case ACCEL_OPC_DIF_GENERATE:
+	case ACCEL_OPC_DIF_GENERATE_COPY:
+	case ACCEL_OPC_DIF_VERIFY_COPY:
+		rc = _sw_accel_dif(accel_task);
+		break;
+	case ACCEL_OPC_XOR:
+		rc = spdk_xor_gen(accel_task->dst, accel_task->nsrcs.srcs, accel_task->nsrcs.cnt,
+				  accel_task->nbytes);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+
+	return rc;
+}
+
+static inline void
+_sw_accel_prefetch_read(const void *buf, uint64_t nbytes)
+{
+	uint64_t len = spdk_min(nbytes, SW_ACCEL_PREFETCH_BYTES);
+	uint64_t offset;
+
+	for (offset = 0; offset < len; offset += SPDK_CACHE_LINE_SIZE) {
+		__builtin_prefetch((const uint8_t *)buf + offset, 0);
+	}
+}
+
+static inline void
+_sw_accel_prefetch_write(void *buf, uint64_t nbytes)
+{
+	uint64_t len = spdk_min(nbytes, SW_ACCEL_PREFETCH_BYTES);
+	uint64_t offset;
+
+	for (offset = 0; offset < len; offset += SPDK_CACHE_LINE_SIZE) {
+		__builtin_prefetch((uint8_t *)buf + offset, 1);
+	}
+}
+
+/* Start loading the head of the buffers of a small task into the cache. Larger
+ * operations are left to the hardware prefetcher once they run. */
+static void
+_sw_accel_prefetch_task(struct spdk_accel_task *accel_task)
+{
+	const void *src;
+	uint64_t nbytes;
+
+	switch (accel_task->op_code) {
+	case ACCEL_OPC_COPY:
+		_sw_accel_prefetch_read(accel_task->src, accel_task->nbytes);
+		_sw_accel_prefetch_write(accel_task->dst, accel_task->nbytes);
+		break;
+	case ACCEL_OPC_FILL:
+		_sw_accel_prefetch_write(accel_task->dst, accel_task->nbytes);
+		break;
+	case ACCEL_OPC_DUALCAST:
+		_sw_accel_prefetch_read(accel_task->src, accel_task->nbytes);
+		_sw_accel_prefetch_write(accel_task->dst, accel_task->nbytes);
+		_sw_accel_prefetch_write(accel_task->dst2, accel_task->nbytes);
+		break;
+	case ACCEL_OPC_COMPARE:
+		_sw_accel_prefetch_read(accel_task->src, accel_task->nbytes);
+		_sw_accel_prefetch_read(accel_task->src2, accel_task->nbytes);
+		break;
+	case ACCEL_OPC_CRC32C:
+	case ACCEL_OPC_COPY_CRC32C:
+		if (accel_task->v.iovcnt == 0) {
+			src = accel_task->src;
+			nbytes = accel_task->nbytes;
+		} else {
+			src = accel_task->v.iovs[0].iov_base;
+			nbytes = accel_task->v.iovs[0].iov_len;
+		}
+		_sw_accel_prefetch_read(src, nbytes);
+		if (accel_task->op_code == ACCEL_OPC_COPY_CRC32C) {
+			_sw_accel_prefetch_write(accel_task->dst, nbytes);
+		}
+		break;
+	default:
+		break;
+	}
+}
 
+/*
+ * Execute the tasks submitted since the last poll in one pass. The buffers of
+ * each task are prefetched while the previous one executes, so that batches of
+ * small operations don't stall on cache misses at the start of every task.
+ */
+static void
+_sw_accel_execute_tasks(struct sw_accel_io_channel *sw_ch)
+{
+	struct spdk_accel_task *accel_task, *next;
+
+	accel_task = TAILQ_FIRST(&sw_ch->tasks_to_execute);
+	if (accel_task == NULL) {
+		return;
+	}
+
+	_sw_accel_prefetch_task(accel_task);
+	for (; accel_task != NULL; accel_task = next) {
+		next = TAILQ_NEXT(accel_task, link);
+		if (next != NULL) {
+			_sw_accel_prefetch_task(next);
+		}
+		accel_task->status = _sw_accel_execute(sw_ch, accel_task);
+	}
+
+	TAILQ_CONCAT(&sw_ch->tasks_to_complete, &sw_ch->tasks_to_execute, link);
+}
+
+static int
+sw_accel_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *accel_task)
+{
+	struct sw_accel_io_channel *sw_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *tmp;
+
+	do {
 		tmp = TAILQ_NEXT(accel_task, link);
 
-		_add_to_comp_list(sw_ch, accel_task, rc);
+		if (accel_task->seq != NULL) {
+			/* The framework runs the next step of the sequence right away
+			 * and defers the completion of the sequence itself. */
+			spdk_accel_task_complete(accel_task, _sw_accel_execute(sw_ch, accel_task));
+		} else {
+			/* Execute and complete the task from the poller, together with
+			 * the others submitted in the meantime. Completing it on the
+			 * caller's stack would also recurse as callers likely submit
+			 * another one. */
+			TAILQ_INSERT_TAIL(&sw_ch->tasks_to_execute, accel_task, link);
+		}
 
 		accel_task = tmp;
 	} while (accel_task);
@@ -299,7 +992,10 @@ static struct spdk_accel_module_if g_sw_module = {
 	.name			= "software",
 	.supports_opcode	= sw_accel_supports_opcode,
 	.get_io_channel		= sw_accel_get_io_channel,
-	.submit_tasks		= sw_accel_submit_tasks
+	.submit_tasks		= sw_accel_submit_tasks,
+	.crypto_key_init	= sw_accel_crypto_key_init,
+	.crypto_key_deinit	= sw_accel_crypto_key_deinit,
+	.compress_supports_algo	= sw_accel_compress_supports_algo,
 };
 
 static int
@@ -309,6 +1005,8 @@ accel_comp_poll(void *arg)
 	TAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
 	struct spdk_accel_task		*accel_task;
 
+	_sw_accel_execute_tasks(sw_ch);
+
 	if (TAILQ_EMPTY(&sw_ch->tasks_to_complete)) {
 		return SPDK_POLLER_IDLE;
 	}
@@ -329,18 +1027,18 @@ sw_accel_create_cb(void *io_device, void *ctx_buf)
 {
 	struct sw_accel_io_channel *sw_ch = ctx_buf;
 
+	TAILQ_INIT(&sw_ch->tasks_to_execute);
 	TAILQ_INIT(&sw_ch->tasks_to_complete);
 	sw_ch->completion_poller = SPDK_POLLER_REGISTER(accel_comp_poll, sw_ch, 0);
 
 #ifdef SPDK_CONFIG_ISAL
 	isal_deflate_stateless_init(&sw_ch->stream);
-	sw_ch->stream.level = 1;
-	sw_ch->stream.level_buf = calloc(1, ISAL_DEF_LVL1_DEFAULT);
-	if (sw_ch->stream.level_buf == NULL) {
+	/* Level 1 is the default, the buffers of other levels are allocated on first use */
+	sw_ch->isal_level_buf[1] = calloc(1, ISAL_DEF_LVL1_DEFAULT);
+	if (sw_ch->isal_level_buf[1] == NULL) {
 		SPDK_ERRLOG("Could not allocate isal internal buffer\n");
 		return -ENOMEM;
 	}
-	sw_ch->stream.level_buf_size = ISAL_DEF_LVL1_DEFAULT;
 	isal_inflate_init(&sw_ch->state);
 #endif
 
@@ -353,7 +1051,19 @@ sw_accel_destroy_cb(void *io_device, void *ctx_buf)
 	struct sw_accel_io_channel *sw_ch = ctx_buf;
 
 #ifdef SPDK_CONFIG_ISAL
-	free(sw_ch->stream.level_buf);
+	uint32_t level;
+
+	for (level = 0; level <= ISAL_DEF_MAX_LEVEL; level++) {
+		free(sw_ch->isal_level_buf[level]);
+	}
+#endif
+#ifdef SPDK_CONFIG_LZ4
+	free(sw_ch->lz4_state);
+	free(sw_ch->lz4hc_state);
+#endif
+#ifdef SPDK_CONFIG_ZSTD
+	ZSTD_freeCCtx(sw_ch->zstd_cctx);
+	ZSTD_freeDCtx(sw_ch->zstd_dctx);
 #endif
 
 	spdk_poller_unregister(&sw_ch->completion_poller);
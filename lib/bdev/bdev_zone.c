@@ -7,7 +7,11 @@
 
 #include "spdk/bdev_zone.h"
 #include "spdk/bdev_module.h"
+#include "spdk/env.h"
 #include "spdk/likely.h"
+#include "spdk/log.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
 
 #include "bdev_internal.h"
 
@@ -206,3 +210,589 @@ spdk_bdev_io_get_append_location(struct spdk_bdev_io *bdev_io)
 {
 	return bdev_io->u.bdev.offset_blocks;
 }
+
+#define ZONE_STAGE_DEFAULT_BUFFER_BLOCKS	32
+#define ZONE_STAGE_DEFAULT_NUM_BUFFERS		8
+#define ZONE_STAGE_DEFAULT_NUM_REQUESTS		512
+#define ZONE_STAGE_DEFAULT_FLUSH_TIMEOUT_US	1000
+
+struct zone_stage_request {
+	struct spdk_bdev_zone_stage		*stage;
+	void					*buf;
+	uint64_t				zone_id;
+	uint64_t				offset_blocks;
+	uint64_t				num_blocks;
+	/* Number of blocks already copied to staging buffers */
+	uint64_t				num_staged;
+	/*
+	 * IDs of the first and last staging buffers holding the request's blocks. They're
+	 * consecutive among the buffers of the zone, as a request is copied in one go.
+	 */
+	uint64_t				first_buf_id;
+	uint64_t				last_buf_id;
+	/* Number of staging buffers holding the request's blocks that aren't written yet */
+	uint32_t				num_bufs;
+	int					status;
+	spdk_bdev_zone_stage_cb			cb;
+	void					*cb_arg;
+	TAILQ_ENTRY(zone_stage_request)		tailq;
+};
+
+struct zone_stage_buf {
+	struct spdk_bdev_zone_stage		*stage;
+	void					*data;
+	/* Unique ID, assigned each time the buffer is taken */
+	uint64_t				id;
+	uint64_t				zone_id;
+	uint64_t				offset_blocks;
+	uint64_t				num_blocks;
+	/* Block at which the buffer is full, aligned to the buffer size within the zone */
+	uint64_t				end_blocks;
+	/* Tick count at which the first block was staged */
+	uint64_t				tsc;
+	/* Set while the buffer is being written to the bdev */
+	bool					writing;
+	TAILQ_ENTRY(zone_stage_buf)		tailq;
+};
+
+struct spdk_bdev_zone_stage {
+	struct spdk_bdev_desc			*desc;
+	struct spdk_io_channel			*ch;
+	struct spdk_bdev			*bdev;
+	struct spdk_bdev_zone_stage_opts	opts;
+	uint64_t				flush_timeout_ticks;
+	struct spdk_poller			*poller;
+
+	struct zone_stage_request		*requests;
+	uint32_t				num_outstanding;
+	TAILQ_HEAD(, zone_stage_request)	free_requests;
+	/* Requests not (completely) copied to the staging buffers yet, in submission order */
+	TAILQ_HEAD(, zone_stage_request)	wait_requests;
+	/* Requests copied to the staging buffers, waiting for the buffers to be written */
+	TAILQ_HEAD(, zone_stage_request)	staged_requests;
+
+	struct zone_stage_buf			*bufs;
+	uint64_t				next_buf_id;
+	TAILQ_HEAD(, zone_stage_buf)		free_bufs;
+	/* Buffers being filled, in the order they were taken */
+	TAILQ_HEAD(, zone_stage_buf)		filling_bufs;
+	/*
+	 * Buffers to be written, in the order they were filled. Only one buffer per zone is
+	 * written at a time, as zoned bdevs require the writes to a zone to be sequential.
+	 */
+	TAILQ_HEAD(zone_stage_buf_list, zone_stage_buf)	flush_bufs;
+
+	struct spdk_bdev_io_wait_entry		io_wait;
+	bool					io_wait_pending;
+	/* Set while copying requests, completions can't start copying them again */
+	bool					processing;
+	/*
+	 * Depth of the calls that may complete requests. A stage freed from a completion callback
+	 * is only marked, and freed once the outermost of these calls returns.
+	 */
+	uint32_t				depth;
+	bool					free_pending;
+};
+
+void
+spdk_bdev_zone_stage_opts_init(struct spdk_bdev_zone_stage_opts *opts, size_t opts_size)
+{
+	if (!opts) {
+		SPDK_ERRLOG("opts should not be NULL\n");
+		return;
+	}
+
+	if (!opts_size) {
+		SPDK_ERRLOG("opts_size should not be zero value\n");
+		return;
+	}
+
+	memset(opts, 0, opts_size);
+	opts->opts_size = opts_size;
+
+#define SET_FIELD(field, value) \
+	if (offsetof(struct spdk_bdev_zone_stage_opts, field) + \
+	    sizeof(opts->field) <= opts_size) { \
+		opts->field = value; \
+	} \
+
+	SET_FIELD(buffer_blocks, ZONE_STAGE_DEFAULT_BUFFER_BLOCKS);
+	SET_FIELD(num_buffers, ZONE_STAGE_DEFAULT_NUM_BUFFERS);
+	SET_FIELD(num_requests, ZONE_STAGE_DEFAULT_NUM_REQUESTS);
+	SET_FIELD(flush_timeout_us, ZONE_STAGE_DEFAULT_FLUSH_TIMEOUT_US);
+
+	/* Update this statement and add a SET_FIELD statement when adding a new field */
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_zone_stage_opts) == 32, "Incorrect size");
+
+#undef SET_FIELD
+}
+
+static void zone_stage_submit_bufs(struct spdk_bdev_zone_stage *stage);
+static void zone_stage_process_requests(struct spdk_bdev_zone_stage *stage);
+static void zone_stage_free(struct spdk_bdev_zone_stage *stage);
+
+static void
+zone_stage_enter(struct spdk_bdev_zone_stage *stage)
+{
+	stage->depth++;
+}
+
+static void
+zone_stage_leave(struct spdk_bdev_zone_stage *stage)
+{
+	assert(stage->depth > 0);
+	if (--stage->depth == 0 && stage->free_pending) {
+		zone_stage_free(stage);
+	}
+}
+
+static void
+zone_stage_queue_buf(struct zone_stage_buf *buf)
+{
+	struct spdk_bdev_zone_stage *stage = buf->stage;
+
+	TAILQ_REMOVE(&stage->filling_bufs, buf, tailq);
+	TAILQ_INSERT_TAIL(&stage->flush_bufs, buf, tailq);
+	zone_stage_submit_bufs(stage);
+}
+
+static void
+zone_stage_complete_request(struct zone_stage_request *req)
+{
+	struct spdk_bdev_zone_stage *stage = req->stage;
+	spdk_bdev_zone_stage_cb cb = req->cb;
+	void *cb_arg = req->cb_arg;
+	int status = req->status;
+
+	TAILQ_INSERT_TAIL(&stage->free_requests, req, tailq);
+	stage->num_outstanding--;
+
+	cb(cb_arg, status);
+}
+
+static bool
+zone_stage_buf_holds(struct zone_stage_buf *buf, struct zone_stage_request *req)
+{
+	return req->num_staged && req->zone_id == buf->zone_id &&
+	       req->first_buf_id <= buf->id && buf->id <= req->last_buf_id;
+}
+
+static void
+zone_stage_buf_done(struct zone_stage_buf *buf, int status)
+{
+	struct spdk_bdev_zone_stage *stage = buf->stage;
+	struct zone_stage_request *req, *treq;
+	TAILQ_HEAD(, zone_stage_request) done = TAILQ_HEAD_INITIALIZER(done);
+
+	/*
+	 * Requests are complete once all the buffers holding their blocks are written. The
+	 * writes to a zone don't need to be sequential, so the offsets can't tell that.
+	 */
+	TAILQ_FOREACH_SAFE(req, &stage->staged_requests, tailq, treq) {
+		if (!zone_stage_buf_holds(buf, req)) {
+			continue;
+		}
+
+		if (status) {
+			req->status = status;
+		}
+
+		assert(req->num_bufs > 0);
+		if (--req->num_bufs == 0) {
+			TAILQ_REMOVE(&stage->staged_requests, req, tailq);
+			TAILQ_INSERT_TAIL(&done, req, tailq);
+		}
+	}
+
+	/* The partially staged request is completed once it's moved to the staged ones */
+	req = TAILQ_FIRST(&stage->wait_requests);
+	if (req && zone_stage_buf_holds(buf, req)) {
+		if (status) {
+			req->status = status;
+		}
+
+		assert(req->num_bufs > 0);
+		req->num_bufs--;
+	}
+
+	buf->writing = false;
+	TAILQ_REMOVE(&stage->flush_bufs, buf, tailq);
+	TAILQ_INSERT_TAIL(&stage->free_bufs, buf, tailq);
+
+	while ((req = TAILQ_FIRST(&done))) {
+		TAILQ_REMOVE(&done, req, tailq);
+		zone_stage_complete_request(req);
+	}
+
+	zone_stage_submit_bufs(stage);
+	zone_stage_process_requests(stage);
+}
+
+static void
+zone_stage_write_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct zone_stage_buf *buf = cb_arg;
+	struct spdk_bdev_zone_stage *stage = buf->stage;
+
+	spdk_bdev_free_io(bdev_io);
+	zone_stage_enter(stage);
+	zone_stage_buf_done(buf, success ? 0 : -EIO);
+	zone_stage_leave(stage);
+}
+
+static void
+zone_stage_io_wait_cb(void *arg)
+{
+	struct spdk_bdev_zone_stage *stage = arg;
+
+	stage->io_wait_pending = false;
+	zone_stage_enter(stage);
+	zone_stage_submit_bufs(stage);
+	zone_stage_leave(stage);
+}
+
+static bool
+zone_stage_zone_busy(struct spdk_bdev_zone_stage *stage, struct zone_stage_buf *buf)
+{
+	struct zone_stage_buf *prev = buf;
+
+	while ((prev = TAILQ_PREV(prev, zone_stage_buf_list, tailq))) {
+		if (prev->zone_id == buf->zone_id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+zone_stage_submit_bufs(struct spdk_bdev_zone_stage *stage)
+{
+	struct zone_stage_buf *buf, *tbuf;
+	int rc;
+
+	if (stage->io_wait_pending) {
+		return;
+	}
+
+	TAILQ_FOREACH_SAFE(buf, &stage->flush_bufs, tailq, tbuf) {
+		if (buf->writing || zone_stage_zone_busy(stage, buf)) {
+			continue;
+		}
+
+		rc = spdk_bdev_write_blocks(stage->desc, stage->ch, buf->data, buf->offset_blocks,
+					    buf->num_blocks, zone_stage_write_cb, buf);
+		if (spdk_unlikely(rc == -ENOMEM)) {
+			stage->io_wait.bdev = stage->bdev;
+			stage->io_wait.cb_fn = zone_stage_io_wait_cb;
+			stage->io_wait.cb_arg = stage;
+			stage->io_wait_pending = true;
+			spdk_bdev_queue_io_wait(stage->bdev, stage->ch, &stage->io_wait);
+			return;
+		} else if (spdk_unlikely(rc != 0)) {
+			zone_stage_buf_done(buf, rc);
+			return;
+		}
+
+		buf->writing = true;
+	}
+}
+
+static struct zone_stage_buf *
+zone_stage_get_buf(struct spdk_bdev_zone_stage *stage, uint64_t zone_id, uint64_t offset_blocks)
+{
+	struct zone_stage_buf *buf;
+	uint64_t zone_size = spdk_bdev_get_zone_size(stage->bdev);
+	uint64_t buffer_blocks = stage->opts.buffer_blocks;
+	uint64_t end_blocks;
+
+	TAILQ_FOREACH(buf, &stage->filling_bufs, tailq) {
+		if (buf->zone_id != zone_id) {
+			continue;
+		}
+
+		if (buf->offset_blocks + buf->num_blocks == offset_blocks) {
+			return buf;
+		}
+
+		/* Not a continuation of the staged data, let the bdev judge the write on its own */
+		zone_stage_queue_buf(buf);
+		break;
+	}
+
+	buf = TAILQ_FIRST(&stage->free_bufs);
+	if (!buf) {
+		return NULL;
+	}
+
+	TAILQ_REMOVE(&stage->free_bufs, buf, tailq);
+	buf->id = stage->next_buf_id++;
+	buf->zone_id = zone_id;
+	buf->offset_blocks = offset_blocks;
+	buf->num_blocks = 0;
+	end_blocks = ((offset_blocks - zone_id) / buffer_blocks + 1) * buffer_blocks;
+	buf->end_blocks = zone_id + spdk_min(zone_size, end_blocks);
+	buf->tsc = spdk_get_ticks();
+	TAILQ_INSERT_TAIL(&stage->filling_bufs, buf, tailq);
+
+	return buf;
+}
+
+static bool
+zone_stage_copy_request(struct spdk_bdev_zone_stage *stage, struct zone_stage_request *req)
+{
+	struct zone_stage_buf *buf;
+	uint32_t blocklen = stage->bdev->blocklen;
+	uint64_t num_blocks;
+
+	while (req->num_staged < req->num_blocks) {
+		buf = zone_stage_get_buf(stage, req->zone_id, req->offset_blocks + req->num_staged);
+		if (!buf) {
+			return false;
+		}
+
+		if (req->num_staged == 0) {
+			req->first_buf_id = buf->id;
+			req->last_buf_id = buf->id;
+			req->num_bufs = 1;
+		} else if (buf->id != req->last_buf_id) {
+			req->last_buf_id = buf->id;
+			req->num_bufs++;
+		}
+
+		num_blocks = spdk_min(req->num_blocks - req->num_staged,
+				      buf->end_blocks - buf->offset_blocks - buf->num_blocks);
+		memcpy((char *)buf->data + buf->num_blocks * blocklen,
+		       (char *)req->buf + req->num_staged * blocklen, num_blocks * blocklen);
+		buf->num_blocks += num_blocks;
+		req->num_staged += num_blocks;
+
+		if (buf->offset_blocks + buf->num_blocks == buf->end_blocks) {
+			zone_stage_queue_buf(buf);
+		}
+	}
+
+	return true;
+}
+
+static void
+zone_stage_process_requests(struct spdk_bdev_zone_stage *stage)
+{
+	struct zone_stage_request *req;
+
+	if (stage->processing) {
+		return;
+	}
+
+	stage->processing = true;
+	while ((req = TAILQ_FIRST(&stage->wait_requests))) {
+		if (!zone_stage_copy_request(stage, req)) {
+			/* Out of buffers, write out the oldest one to make room */
+			if (!TAILQ_EMPTY(&stage->filling_bufs)) {
+				zone_stage_queue_buf(TAILQ_FIRST(&stage->filling_bufs));
+			}
+			break;
+		}
+
+		TAILQ_REMOVE(&stage->wait_requests, req, tailq);
+		if (req->num_bufs == 0) {
+			/* All of its buffers failed to be submitted while it was being copied */
+			zone_stage_complete_request(req);
+			continue;
+		}
+
+		TAILQ_INSERT_TAIL(&stage->staged_requests, req, tailq);
+	}
+	stage->processing = false;
+}
+
+static int
+zone_stage_poller(void *ctx)
+{
+	struct spdk_bdev_zone_stage *stage = ctx;
+	struct zone_stage_buf *buf;
+	uint64_t now = spdk_get_ticks();
+	int rc = SPDK_POLLER_IDLE;
+
+	zone_stage_enter(stage);
+	while (!stage->free_pending && (buf = TAILQ_FIRST(&stage->filling_bufs))) {
+		if (buf->tsc + stage->flush_timeout_ticks > now) {
+			break;
+		}
+
+		zone_stage_queue_buf(buf);
+		rc = SPDK_POLLER_BUSY;
+	}
+	zone_stage_leave(stage);
+
+	return rc;
+}
+
+void
+spdk_bdev_zone_stage_flush(struct spdk_bdev_zone_stage *stage)
+{
+	struct zone_stage_buf *buf;
+
+	zone_stage_enter(stage);
+	while (!stage->free_pending && (buf = TAILQ_FIRST(&stage->filling_bufs))) {
+		zone_stage_queue_buf(buf);
+	}
+	zone_stage_leave(stage);
+}
+
+int
+spdk_bdev_zone_stage_write(struct spdk_bdev_zone_stage *stage, void *buf,
+			   uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_zone_stage_cb cb, void *cb_arg)
+{
+	struct zone_stage_request *req;
+	uint64_t zone_id = spdk_bdev_get_zone_id(stage->bdev, offset_blocks);
+
+	if (num_blocks == 0 ||
+	    zone_id != spdk_bdev_get_zone_id(stage->bdev, offset_blocks + num_blocks - 1)) {
+		return -EINVAL;
+	}
+
+	req = TAILQ_FIRST(&stage->free_requests);
+	if (!req) {
+		return -ENOMEM;
+	}
+
+	TAILQ_REMOVE(&stage->free_requests, req, tailq);
+	stage->num_outstanding++;
+
+	req->buf = buf;
+	req->zone_id = zone_id;
+	req->offset_blocks = offset_blocks;
+	req->num_blocks = num_blocks;
+	req->num_staged = 0;
+	req->status = 0;
+	req->cb = cb;
+	req->cb_arg = cb_arg;
+
+	/* Keep the submission order, the request can't skip the ones waiting for a buffer */
+	TAILQ_INSERT_TAIL(&stage->wait_requests, req, tailq);
+	zone_stage_enter(stage);
+	zone_stage_process_requests(stage);
+	zone_stage_leave(stage);
+
+	return 0;
+}
+
+struct spdk_bdev_zone_stage *
+spdk_bdev_zone_stage_create(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    const struct spdk_bdev_zone_stage_opts *opts)
+{
+	struct spdk_bdev_zone_stage *stage;
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+	struct zone_stage_buf *buf;
+	uint32_t i;
+
+	if (!bdev->zoned || (bdev->md_len && !bdev->md_interleave)) {
+		SPDK_ERRLOG("Zone write staging requires a zoned bdev without separate metadata\n");
+		return NULL;
+	}
+
+	stage = calloc(1, sizeof(*stage));
+	if (!stage) {
+		return NULL;
+	}
+
+	spdk_bdev_zone_stage_opts_init(&stage->opts, sizeof(stage->opts));
+	if (opts) {
+		memcpy(&stage->opts, opts, spdk_min(opts->opts_size, sizeof(stage->opts)));
+		stage->opts.opts_size = sizeof(stage->opts);
+	}
+
+	if (!stage->opts.buffer_blocks || !stage->opts.num_buffers || !stage->opts.num_requests ||
+	    !stage->opts.flush_timeout_us) {
+		SPDK_ERRLOG("Invalid zone write staging options\n");
+		free(stage);
+		return NULL;
+	}
+
+	stage->desc = desc;
+	stage->ch = ch;
+	stage->bdev = bdev;
+	stage->flush_timeout_ticks = stage->opts.flush_timeout_us * spdk_get_ticks_hz() /
+				     SPDK_SEC_TO_USEC;
+	TAILQ_INIT(&stage->free_requests);
+	TAILQ_INIT(&stage->wait_requests);
+	TAILQ_INIT(&stage->staged_requests);
+	TAILQ_INIT(&stage->free_bufs);
+	TAILQ_INIT(&stage->filling_bufs);
+	TAILQ_INIT(&stage->flush_bufs);
+
+	stage->requests = calloc(stage->opts.num_requests, sizeof(*stage->requests));
+	stage->bufs = calloc(stage->opts.num_buffers, sizeof(*stage->bufs));
+	if (!stage->requests || !stage->bufs) {
+		goto error;
+	}
+
+	for (i = 0; i < stage->opts.num_requests; i++) {
+		stage->requests[i].stage = stage;
+		TAILQ_INSERT_TAIL(&stage->free_requests, &stage->requests[i], tailq);
+	}
+
+	for (i = 0; i < stage->opts.num_buffers; i++) {
+		buf = &stage->bufs[i];
+		buf->stage = stage;
+		buf->data = spdk_dma_zmalloc((uint64_t)stage->opts.buffer_blocks * bdev->blocklen,
+					     spdk_bdev_get_buf_align(bdev), NULL);
+		if (!buf->data) {
+			goto error;
+		}
+		TAILQ_INSERT_TAIL(&stage->free_bufs, buf, tailq);
+	}
+
+	stage->poller = SPDK_POLLER_REGISTER(zone_stage_poller, stage,
+					     spdk_max(stage->opts.flush_timeout_us / 2, 1));
+	if (!stage->poller) {
+		goto error;
+	}
+
+	return stage;
+error:
+	SPDK_ERRLOG("Failed to allocate zone write staging resources\n");
+	spdk_bdev_zone_stage_free(stage);
+	return NULL;
+}
+
+static void
+zone_stage_free(struct spdk_bdev_zone_stage *stage)
+{
+	uint32_t i;
+
+	spdk_poller_unregister(&stage->poller);
+	if (stage->bufs) {
+		for (i = 0; i < stage->opts.num_buffers; i++) {
+			spdk_dma_free(stage->bufs[i].data);
+		}
+	}
+	free(stage->bufs);
+	free(stage->requests);
+	free(stage);
+}
+
+int
+spdk_bdev_zone_stage_free(struct spdk_bdev_zone_stage *stage)
+{
+	if (!stage) {
+		return 0;
+	}
+
+	if (stage->num_outstanding) {
+		return -EBUSY;
+	}
+
+	if (stage->depth) {
+		/* Called from a completion callback, the stage is still in use up the stack */
+		spdk_poller_unregister(&stage->poller);
+		stage->free_pending = true;
+		return 0;
+	}
+
+	zone_stage_free(stage);
+
+	return 0;
+}
@@ -21,6 +21,7 @@
 #include "spdk/log.h"
 
 #include "blobstore.h"
+#include "cluster_alloc.h"
 
 #define BLOB_CRC32C_INITIAL    0xffffffffUL
 
@@ -39,6 +40,7 @@ static int blob_remove_xattr(struct spdk_blob *blob, const char *name, bool inte
 
 static void blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster_num,
 				   struct spdk_blob_md_page *page, spdk_blob_op_complete cb_fn, void *cb_arg);
+static void blob_sync_md(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg);
 
 static int
 blob_id_cmp(struct spdk_blob *blob1, struct spdk_blob *blob2)
@@ -88,20 +90,62 @@ bs_release_md_page(struct spdk_blob_store *bs, uint32_t page)
 	spdk_bit_array_clear(bs->used_md_pages, page);
 }
 
+/* Claim a run of up to count consecutive clusters, starting at hint if it is
+ * free. Returns the first cluster of the run and its length in run_len. */
 static uint32_t
-bs_claim_cluster(struct spdk_blob_store *bs)
+bs_claim_cluster_run(struct spdk_blob_store *bs, uint32_t hint, uint32_t count,
+		     uint32_t *run_len)
 {
-	uint32_t cluster_num;
+	uint32_t cluster_num, i;
+	int rc __attribute__((unused));
 
-	cluster_num = spdk_bit_pool_allocate_bit(bs->used_clusters);
+	cluster_num = bs_cluster_alloc_get(bs->cluster_alloc, hint, count, run_len);
 	if (cluster_num == UINT32_MAX) {
-		return UINT32_MAX;
+		/* The index may have lost track of clusters on a failed node
+		 * allocation, the bit pool never does. */
+		cluster_num = spdk_bit_pool_allocate_bit(bs->used_clusters);
+		if (cluster_num == UINT32_MAX) {
+			return UINT32_MAX;
+		}
+		*run_len = 1;
+	} else {
+		for (i = 0; i < *run_len; i++) {
+			rc = spdk_bit_pool_allocate_bit_at(bs->used_clusters, cluster_num + i);
+			assert(rc == 0);
+		}
+	}
+
+	SPDK_DEBUGLOG(blob, "Claiming clusters %u-%u\n", cluster_num, cluster_num + *run_len - 1);
+	bs->num_free_clusters -= *run_len;
+
+	return cluster_num;
+}
+
+static uint32_t
+bs_claim_cluster(struct spdk_blob_store *bs, uint32_t hint)
+{
+	uint32_t run_len;
+
+	return bs_claim_cluster_run(bs, hint, 1, &run_len);
+}
+
+static bool
+bs_claim_cluster_at(struct spdk_blob_store *bs, uint32_t cluster_num)
+{
+	if (!bs_cluster_alloc_get_at(bs->cluster_alloc, cluster_num, 1)) {
+		return false;
+	}
+
+	if (spdk_bit_pool_allocate_bit_at(bs->used_clusters, cluster_num) != 0) {
+		assert(false);
+		bs_cluster_alloc_put(bs->cluster_alloc, cluster_num, 1);
+		return false;
 	}
 
 	SPDK_DEBUGLOG(blob, "Claiming cluster %u\n", cluster_num);
 	bs->num_free_clusters--;
 
-	return cluster_num;
+	return true;
 }
 
 static void
@@ -114,9 +158,28 @@ bs_release_cluster(struct spdk_blob_store *bs, uint32_t cluster_num)
 	SPDK_DEBUGLOG(blob, "Releasing cluster %u\n", cluster_num);
 
 	spdk_bit_pool_free_bit(bs->used_clusters, cluster_num);
+	bs_cluster_alloc_put(bs->cluster_alloc, cluster_num, 1);
 	bs->num_free_clusters++;
 }
 
+/* Cluster to start looking for free clusters from when allocating the given
+ * cluster of the blob: right after the physical cluster backing the previous
+ * one, or after the last cluster allocated to the blob. */
+static uint32_t
+blob_cluster_hint(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	uint64_t lba;
+
+	if (cluster_num > 0) {
+		lba = blob->active.clusters[cluster_num - 1];
+		if (lba != 0) {
+			return bs_lba_to_cluster(blob->bs, lba) + 1;
+		}
+	}
+
+	return blob->cluster_hint;
+}
+
 static int
 blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster)
 {
@@ -132,18 +195,14 @@ blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t clust
 	return 0;
 }
 
+/* Claim an extent page for the given cluster of the blob if it does not have
+ * one yet, and optionally map the already claimed cluster into the blob. */
 static int
-bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
-		    uint64_t *cluster, uint32_t *lowest_free_md_page, bool update_map)
+blob_map_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster,
+		 uint32_t *lowest_free_md_page, bool update_map)
 {
 	uint32_t *extent_page = 0;
 
-	*cluster = bs_claim_cluster(blob->bs);
-	if (*cluster == UINT32_MAX) {
-		/* No more free clusters. Cannot satisfy the request */
-		return -ENOSPC;
-	}
-
 	if (blob->use_extent_table) {
 		extent_page = bs_cluster_to_extent_page(blob, cluster_num);
 		if (*extent_page == 0) {
@@ -156,17 +215,18 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 					       *lowest_free_md_page);
 			if (*lowest_free_md_page == UINT32_MAX) {
 				/* No more free md pages. Cannot satisfy the request */
-				bs_release_cluster(blob->bs, *cluster);
 				return -ENOSPC;
 			}
 			bs_claim_md_page(blob->bs, *lowest_free_md_page);
 		}
 	}
 
-	SPDK_DEBUGLOG(blob, "Claiming cluster %" PRIu64 " for blob %" PRIu64 "\n", *cluster, blob->id);
+	SPDK_DEBUGLOG(blob, "Claiming cluster %" PRIu64 " for blob %" PRIu64 "\n", cluster, blob->id);
+
+	blob->cluster_hint = cluster + 1;
 
 	if (update_map) {
-		blob_insert_cluster(blob, cluster_num, *cluster);
+		blob_insert_cluster(blob, cluster_num, cluster);
 		if (blob->use_extent_table && *extent_page == 0) {
 			*extent_page = *lowest_free_md_page;
 		}
@@ -175,6 +235,26 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 	return 0;
 }
 
+static int
+bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
+		    uint64_t *cluster, uint32_t *lowest_free_md_page, bool update_map)
+{
+	int rc;
+
+	*cluster = bs_claim_cluster(blob->bs, blob_cluster_hint(blob, cluster_num));
+	if (*cluster == UINT32_MAX) {
+		/* No more free clusters. Cannot satisfy the request */
+		return -ENOSPC;
+	}
+
+	rc = blob_map_cluster(blob, cluster_num, *cluster, lowest_free_md_page, update_map);
+	if (rc != 0) {
+		bs_release_cluster(blob->bs, *cluster);
+	}
+
+	return rc;
+}
+
 static void
 blob_xattrs_init(struct spdk_blob_xattr_opts *xattrs)
 {
@@ -266,6 +346,7 @@ blob_alloc(struct spdk_blob_store *bs, spdk_blob_id id)
 	blob->bs = bs;
 
 	blob->parent_id = SPDK_BLOBID_INVALID;
+	blob->cluster_hint = UINT32_MAX;
 
 	blob->state = SPDK_BLOB_STATE_DIRTY;
 	blob->extent_rle_found = false;
@@ -1774,8 +1855,9 @@ blob_persist_clear_clusters(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ct
 	uint64_t			lba;
 	uint64_t			lba_count;
 
-	/* Clusters don't move around in blobs. The list shrinks or grows
-	 * at the end, but no changes ever occur in the middle of the list.
+	/* The list shrinks or grows at the end. Clusters in the middle of the
+	 * list may only be relocated by defragmentation, which never happens
+	 * concurrently with a resize.
 	 */
 
 	batch = bs_sequence_to_batch(seq, blob_persist_clear_clusters_cpl, ctx);
@@ -1966,6 +2048,7 @@ blob_resize(struct spdk_blob *blob, uint64_t sz)
 	uint64_t	i;
 	uint64_t	*tmp;
 	uint64_t	cluster;
+	uint32_t	j, run_len;
 	uint32_t	lfmd; /*  lowest free md page */
 	uint64_t	num_clusters;
 	uint32_t	*ep_tmp;
@@ -2042,12 +2125,17 @@ blob_resize(struct spdk_blob *blob, uint64_t sz)
 	blob->state = SPDK_BLOB_STATE_DIRTY;
 
 	if (spdk_blob_is_thin_provisioned(blob) == false) {
-		cluster = 0;
 		lfmd = 0;
 		pthread_mutex_lock(&blob->bs->used_clusters_mutex);
-		for (i = num_clusters; i < sz; i++) {
-			bs_allocate_cluster(blob, i, &cluster, &lfmd, true);
-			lfmd++;
+		for (i = num_clusters; i < sz; i += run_len) {
+			/* Enough free clusters and md pages were checked for above */
+			cluster = bs_claim_cluster_run(bs, blob_cluster_hint(blob, i),
+						       spdk_min(sz - i, UINT32_MAX), &run_len);
+			assert(cluster != UINT32_MAX);
+			for (j = 0; j < run_len; j++) {
+				blob_map_cluster(blob, i + j, cluster + j, &lfmd, true);
+				lfmd++;
+			}
 		}
 		pthread_mutex_unlock(&blob->bs->used_clusters_mutex);
 	}
@@ -2303,6 +2391,8 @@ struct spdk_blob_copy_cluster_ctx {
 	uint32_t new_extent_page;
 	spdk_bs_sequence_t *seq;
 	struct spdk_blob_md_page *new_cluster_page;
+	/* User op whose data is written to the new cluster along with the copy, if any */
+	spdk_bs_user_op_t *op;
 };
 
 static void
@@ -2319,10 +2409,13 @@ blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
 	while (!TAILQ_EMPTY(&requests)) {
 		op = TAILQ_FIRST(&requests);
 		TAILQ_REMOVE(&requests, op, link);
-		if (bserrno == 0) {
-			bs_user_op_execute(op);
-		} else {
+		if (bserrno != 0) {
 			bs_user_op_abort(op, bserrno);
+		} else if (op == ctx->op) {
+			/* Its data is already in the cluster, so just complete it */
+			bs_user_op_abort(op, 0);
+		} else {
+			bs_user_op_execute(op);
 		}
 	}
 
@@ -2339,8 +2432,10 @@ blob_insert_cluster_cpl(void *cb_arg, int bserrno)
 		if (bserrno == -EEXIST) {
 			/* The metadata insert failed because another thread
 			 * allocated the cluster first. Free our cluster
-			 * but continue without error. */
+			 * but continue without error. The user op written
+			 * along with our cluster has to be executed again. */
 			bserrno = 0;
+			ctx->op = NULL;
 		}
 		pthread_mutex_lock(&ctx->blob->bs->used_clusters_mutex);
 		bs_release_cluster(ctx->blob->bs, ctx->new_cluster);
@@ -2371,6 +2466,34 @@ blob_write_copy_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 					 ctx->new_extent_page, ctx->new_cluster_page, blob_insert_cluster_cpl, ctx);
 }
 
+/* Copy the data of the user op over the cluster read from the backing device. */
+static void
+blob_merge_user_op(struct spdk_blob_copy_cluster_ctx *ctx)
+{
+	struct spdk_bs_user_op_args *args = &ctx->op->u.user_op;
+	uint64_t io_unit_size = ctx->blob->bs->io_unit_size;
+	uint8_t *buf;
+	size_t len;
+
+	buf = ctx->buf + (args->offset % bs_io_units_per_cluster(ctx->blob)) * io_unit_size;
+	len = args->length * io_unit_size;
+
+	switch (args->type) {
+	case SPDK_BLOB_WRITE:
+		memcpy(buf, args->payload, len);
+		break;
+	case SPDK_BLOB_WRITEV:
+		spdk_copy_iovs_to_buf(buf, len, args->payload, args->iovcnt);
+		break;
+	case SPDK_BLOB_WRITE_ZEROES:
+		memset(buf, 0, len);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
 static void
 blob_write_copy(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
@@ -2382,6 +2505,10 @@ blob_write_copy(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 		return;
 	}
 
+	if (ctx->op != NULL) {
+		blob_merge_user_op(ctx);
+	}
+
 	/* Write whole cluster */
 	bs_sequence_write_dev(seq, ctx->buf,
 			      bs_cluster_to_lba(ctx->blob->bs, ctx->new_cluster),
@@ -2389,6 +2516,59 @@ blob_write_copy(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 			      blob_write_copy_cpl, ctx);
 }
 
+/* Write a user op that overwrites the whole cluster straight to the new cluster. */
+static void
+blob_write_user_op(struct spdk_blob_copy_cluster_ctx *ctx)
+{
+	struct spdk_bs_user_op_args *args = &ctx->op->u.user_op;
+	struct spdk_blob_store *bs = ctx->blob->bs;
+	uint64_t lba = bs_cluster_to_lba(bs, ctx->new_cluster);
+	uint64_t lba_count = bs_cluster_to_lba(bs, 1);
+
+	switch (args->type) {
+	case SPDK_BLOB_WRITE:
+		bs_sequence_write_dev(ctx->seq, args->payload, lba, lba_count, blob_write_copy_cpl, ctx);
+		break;
+	case SPDK_BLOB_WRITEV:
+		ctx->seq->ext_io_opts = ctx->op->ext_io_opts;
+		bs_sequence_writev_dev(ctx->seq, args->payload, args->iovcnt, lba, lba_count,
+				       blob_write_copy_cpl, ctx);
+		break;
+	case SPDK_BLOB_WRITE_ZEROES:
+		bs_sequence_write_zeroes_dev(ctx->seq, lba, lba_count, blob_write_copy_cpl, ctx);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+/*
+ * Check whether the user op that needs the cluster can be written along with the
+ *  copy of the cluster, instead of after it.  Sets full if it overwrites the whole
+ *  cluster, in which case nothing has to be copied.
+ */
+static bool
+blob_user_op_can_merge(struct spdk_blob *blob, spdk_bs_user_op_t *op, bool *full)
+{
+	struct spdk_bs_user_op_args *args = &op->u.user_op;
+
+	if (args->type != SPDK_BLOB_WRITE && args->type != SPDK_BLOB_WRITEV &&
+	    args->type != SPDK_BLOB_WRITE_ZEROES) {
+		return false;
+	}
+
+	*full = args->length == bs_io_units_per_cluster(blob);
+	if (*full) {
+		assert(args->offset % bs_io_units_per_cluster(blob) == 0);
+		return true;
+	}
+
+	/* The payload cannot be copied into the cluster buffer if it is in another memory domain */
+	return args->type != SPDK_BLOB_WRITEV || op->ext_io_opts == NULL ||
+	       op->ext_io_opts->memory_domain == NULL;
+}
+
 static void
 bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 			     struct spdk_io_channel *_ch,
@@ -2399,7 +2579,7 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	struct spdk_blob_copy_cluster_ctx *ctx;
 	uint32_t cluster_start_page;
 	uint32_t cluster_number;
-	bool is_zeroes;
+	bool is_zeroes, copy, full = false;
 	int rc;
 
 	ch = spdk_io_channel_get_ctx(_ch);
@@ -2435,7 +2615,14 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	is_zeroes = blob->back_bs_dev->is_zeroes(blob->back_bs_dev,
 			bs_dev_page_to_lba(blob->back_bs_dev, cluster_start_page),
 			bs_dev_byte_to_lba(blob->back_bs_dev, blob->bs->cluster_sz));
-	if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes) {
+	copy = blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes;
+	if (copy && blob_user_op_can_merge(blob, op, &full)) {
+		/* Write the user data along with the copy, or instead of it if the
+		 * whole cluster is overwritten, so the cluster is written only once. */
+		ctx->op = op;
+		copy = !full;
+	}
+	if (copy) {
 		ctx->buf = spdk_malloc(blob->bs->cluster_sz, blob->back_bs_dev->blocklen,
 				       NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
 		if (!ctx->buf) {
@@ -2476,12 +2663,14 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	/* Queue the user op to block other incoming operations */
 	TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
 
-	if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes) {
+	if (copy) {
 		/* Read cluster from backing device */
 		bs_sequence_read_bs_dev(ctx->seq, blob->back_bs_dev, ctx->buf,
 					bs_dev_page_to_lba(blob->back_bs_dev, cluster_start_page),
 					bs_dev_byte_to_lba(blob->back_bs_dev, blob->bs->cluster_sz),
 					blob_write_copy, ctx);
+	} else if (full) {
+		blob_write_user_op(ctx);
 	} else {
 		blob_insert_cluster_on_md_thread(ctx->blob, cluster_number, ctx->new_cluster,
 						 ctx->new_extent_page, ctx->new_cluster_page, blob_insert_cluster_cpl, ctx);
@@ -2706,6 +2895,8 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 			return;
 		}
 
+		batch->io_blob = blob;
+
 		if (is_allocated) {
 			/* Read from the blob */
 			bs_batch_read_dev(batch, payload, lba, lba_count);
@@ -2734,6 +2925,8 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 				return;
 			}
 
+			batch->io_blob = blob;
+
 			if (op_type == SPDK_BLOB_WRITE) {
 				bs_batch_write_dev(batch, payload, lba, lba_count);
 			} else {
@@ -2764,6 +2957,8 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 			return;
 		}
 
+		batch->io_blob = blob;
+
 		if (is_allocated) {
 			bs_batch_unmap_dev(batch, lba, lba_count);
 		}
@@ -2979,6 +3174,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 			}
 
 			seq->ext_io_opts = ext_io_opts;
+			seq->io_blob = blob;
 
 			if (is_allocated) {
 				bs_sequence_readv_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
@@ -2997,6 +3193,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 				}
 
 				seq->ext_io_opts = ext_io_opts;
+				seq->io_blob = blob;
 
 				bs_sequence_writev_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
 			} else {
@@ -3172,6 +3369,7 @@ bs_dev_destroy(void *io_device)
 	spdk_bit_array_free(&bs->used_blobids);
 	spdk_bit_array_free(&bs->used_md_pages);
 	spdk_bit_pool_free(&bs->used_clusters);
+	bs_cluster_alloc_free(&bs->cluster_alloc);
 	/*
 	 * If this function is called for any reason except a successful unload,
 	 * the unload_cpl type will be NONE and this will be a nop.
@@ -3779,6 +3977,11 @@ static void bs_dump_read_md_page(spdk_bs_sequence_t *seq, void *cb_arg);
 static void
 bs_load_complete(struct spdk_bs_load_ctx *ctx)
 {
+	ctx->bs->cluster_alloc = bs_cluster_alloc_create(ctx->used_clusters);
+	if (ctx->bs->cluster_alloc == NULL) {
+		bs_load_ctx_fail(ctx, -ENOMEM);
+		return;
+	}
 	ctx->bs->used_clusters = spdk_bit_pool_create_from_array(ctx->used_clusters);
 	if (ctx->dumping) {
 		bs_dump_read_md_page(ctx->seq, ctx);
@@ -5164,6 +5367,16 @@ spdk_bs_init(struct spdk_bs_dev *dev, struct spdk_bs_opts *o,
 	bs->num_free_clusters -= num_md_clusters;
 	bs->total_data_clusters = bs->num_free_clusters;
 
+	bs->cluster_alloc = bs_cluster_alloc_create(ctx->used_clusters);
+	if (bs->cluster_alloc == NULL) {
+		spdk_free(ctx->super);
+		spdk_bit_array_free(&ctx->used_clusters);
+		free(ctx);
+		bs_free(bs);
+		cb_fn(cb_arg, NULL, -ENOMEM);
+		return;
+	}
+
 	cpl.type = SPDK_BS_CPL_TYPE_BS_HANDLE;
 	cpl.u.bs_handle.cb_fn = cb_fn;
 	cpl.u.bs_handle.cb_arg = cb_arg;
@@ -6551,6 +6764,544 @@ spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel
 }
 /* END spdk_bs_inflate_blob */
 
+/* START spdk_bs_blob_defrag */
+
+#define BLOB_DEFRAG_RETRY_US	100
+/* Clusters examined in one go before yielding the metadata thread */
+#define BLOB_DEFRAG_CLUSTERS_PER_POLL	1024
+
+struct spdk_bs_defrag_ctx {
+	struct spdk_blob_store		*bs;
+	struct spdk_io_channel		*channel;
+	spdk_blob_id			blobid;
+	struct spdk_blob		*blob;
+	spdk_blob_op_complete		cb_fn;
+	void				*cb_arg;
+	int				bserrno;
+
+	/* Index of the next cluster in the blob to examine */
+	uint64_t			cluster_num;
+	/* Allocated clusters of the blob not examined yet. The blob stays writable, so this is
+	 * recounted whenever the blob may have changed under it, see bs_defrag_refresh(). */
+	uint64_t			clusters_remaining;
+	/* Number of clusters of the blob when clusters_remaining was counted */
+	uint64_t			num_clusters;
+	/* End of the run of clusters laid out contiguously on disk which covers cluster_num */
+	uint64_t			in_place_end;
+	/* Cluster on disk backing the previous allocated cluster of the blob */
+	uint32_t			prev_cluster;
+	/* Cluster being relocated and its destination */
+	uint32_t			old_cluster;
+	uint32_t			new_cluster;
+
+	uint8_t				*buf;
+	struct spdk_blob_md_page	*extent_page;
+	uint32_t			inflight_io;
+
+	struct spdk_poller		*poller;
+	void (*resume_fn)(struct spdk_bs_defrag_ctx *ctx);
+	uint64_t			ticks_per_cluster;
+	uint64_t			next_move_tsc;
+};
+
+static void bs_defrag_next(struct spdk_bs_defrag_ctx *ctx);
+
+static void
+bs_defrag_close_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	ctx->cb_fn(ctx->cb_arg, ctx->bserrno);
+	free(ctx);
+}
+
+static void
+bs_defrag_finish(struct spdk_bs_defrag_ctx *ctx, int bserrno)
+{
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	spdk_free(ctx->buf);
+	spdk_free(ctx->extent_page);
+
+	if (ctx->blob == NULL) {
+		bs_defrag_close_cpl(ctx, 0);
+		return;
+	}
+
+	spdk_blob_close(ctx->blob, bs_defrag_close_cpl, ctx);
+}
+
+static int
+bs_defrag_resume_poll(void *arg)
+{
+	struct spdk_bs_defrag_ctx *ctx = arg;
+
+	spdk_poller_unregister(&ctx->poller);
+	ctx->resume_fn(ctx);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+bs_defrag_resume_later(struct spdk_bs_defrag_ctx *ctx, uint64_t delay_us,
+		       void (*resume_fn)(struct spdk_bs_defrag_ctx *ctx))
+{
+	ctx->resume_fn = resume_fn;
+	ctx->poller = SPDK_POLLER_REGISTER(bs_defrag_resume_poll, ctx, delay_us);
+	if (ctx->poller == NULL) {
+		bs_defrag_finish(ctx, -ENOMEM);
+	}
+}
+
+/* Find a run of free clusters, preferring the smallest one that is at least
+ * need clusters long and falling back to the longest one otherwise. Returns
+ * the length of the run, capped at need. */
+static uint64_t
+bs_defrag_find_free_run(struct spdk_blob_store *bs, uint64_t need, uint32_t *run_start)
+{
+	uint32_t run_len = 0;
+
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	*run_start = bs_cluster_alloc_find(bs->cluster_alloc, spdk_min(need, UINT32_MAX), &run_len);
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+
+	return run_len;
+}
+
+/* Count free clusters right after the given one, up to need. */
+static uint64_t
+bs_defrag_free_run_at(struct spdk_blob_store *bs, uint32_t cluster, uint64_t need)
+{
+	uint64_t len;
+
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	len = bs_cluster_alloc_free_run_at(bs->cluster_alloc, cluster);
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+
+	return spdk_min(len, need);
+}
+
+/* Count how many allocated clusters of the blob, starting at cluster_num, are
+ * already laid out contiguously on disk. The end of the run is remembered, so
+ * the clusters of a run are only scanned once while it is being moved. */
+static uint64_t
+bs_defrag_run_in_place(struct spdk_bs_defrag_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t cluster_num = ctx->cluster_num;
+	uint64_t lba = blob->active.clusters[cluster_num];
+	uint64_t lba_per_cluster = bs_cluster_to_lba(blob->bs, 1);
+	uint64_t i;
+
+	if (cluster_num < ctx->in_place_end) {
+		return ctx->in_place_end - cluster_num;
+	}
+
+	for (i = cluster_num + 1; i < blob->active.num_clusters; i++) {
+		if (blob->active.clusters[i] != lba + lba_per_cluster * (i - cluster_num)) {
+			break;
+		}
+	}
+
+	ctx->in_place_end = i;
+	return i - cluster_num;
+}
+
+/* Recount the allocated clusters left to examine. Needed when the blob was resized
+ * or when thin provisioned clusters were allocated beyond the ones counted. */
+static void
+bs_defrag_recount(struct spdk_bs_defrag_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t i;
+
+	ctx->clusters_remaining = 0;
+	for (i = ctx->cluster_num; i < blob->active.num_clusters; i++) {
+		if (blob->active.clusters[i] != 0) {
+			ctx->clusters_remaining++;
+		}
+	}
+
+	ctx->num_clusters = blob->active.num_clusters;
+	ctx->in_place_end = 0;
+}
+
+/* Called for every allocated cluster before picking its destination */
+static void
+bs_defrag_refresh(struct spdk_bs_defrag_ctx *ctx)
+{
+	/* A resize changes the number of clusters, an allocation in the meantime may
+	 * make the count run out before the last allocated cluster is reached. */
+	if (ctx->num_clusters != ctx->blob->active.num_clusters || ctx->clusters_remaining == 0) {
+		bs_defrag_recount(ctx);
+	}
+
+	assert(ctx->clusters_remaining > 0);
+}
+
+/* Pick the destination for the cluster at ctx->cluster_num, or UINT32_MAX if it
+ * should stay where it is. A cluster is moved right after the previous one if
+ * there is room to continue the run there, or to the start of a free run that
+ * is longer than the run the cluster is already part of. */
+static uint32_t
+bs_defrag_pick_target(struct spdk_bs_defrag_ctx *ctx, uint32_t cluster)
+{
+	struct spdk_blob_store *bs = ctx->bs;
+	uint64_t in_place, run_len;
+	uint32_t run_start = 0;
+
+	if (ctx->prev_cluster != UINT32_MAX && cluster == ctx->prev_cluster + 1) {
+		return UINT32_MAX;
+	}
+
+	in_place = bs_defrag_run_in_place(ctx);
+
+	if (ctx->prev_cluster != UINT32_MAX) {
+		run_len = bs_defrag_free_run_at(bs, ctx->prev_cluster + 1, ctx->clusters_remaining);
+		if (run_len > 0 && run_len >= in_place) {
+			return ctx->prev_cluster + 1;
+		}
+	}
+
+	if (in_place >= ctx->clusters_remaining) {
+		return UINT32_MAX;
+	}
+
+	run_len = bs_defrag_find_free_run(bs, ctx->clusters_remaining, &run_start);
+	if (run_len > in_place) {
+		return run_start;
+	}
+
+	return UINT32_MAX;
+}
+
+static void
+bs_defrag_cluster_done(struct spdk_bs_defrag_ctx *ctx, uint32_t cluster)
+{
+	ctx->prev_cluster = cluster;
+	ctx->cluster_num++;
+	assert(ctx->clusters_remaining > 0);
+	ctx->clusters_remaining--;
+}
+
+static void
+bs_defrag_abort_unfreeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+
+	ctx->blob->locked_operation_in_progress = false;
+	bs_defrag_finish(ctx, bserrno);
+}
+
+static void
+bs_defrag_move_abort(struct spdk_bs_defrag_ctx *ctx, int bserrno)
+{
+	struct spdk_blob_store *bs = ctx->bs;
+
+	ctx->bserrno = bserrno;
+
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	bs_release_cluster(bs, ctx->new_cluster);
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+
+	blob_unfreeze_io(ctx->blob, bs_defrag_abort_unfreeze_cpl, ctx);
+}
+
+static void
+bs_defrag_unfreeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+
+	ctx->blob->locked_operation_in_progress = false;
+
+	if (bserrno != 0) {
+		bs_defrag_finish(ctx, bserrno);
+		return;
+	}
+
+	bs_defrag_cluster_done(ctx, ctx->new_cluster);
+	bs_defrag_next(ctx);
+}
+
+static void
+bs_defrag_update_md_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_store *bs = ctx->bs;
+
+	if (bserrno != 0) {
+		/* Point the blob back at the original copy of the data */
+		blob->active.clusters[ctx->cluster_num] = bs_cluster_to_lba(bs, ctx->old_cluster);
+		if (!blob->use_extent_table) {
+			blob->state = SPDK_BLOB_STATE_DIRTY;
+		}
+		bs_defrag_move_abort(ctx, bserrno);
+		return;
+	}
+
+	SPDK_DEBUGLOG(blob, "Moved cluster %" PRIu64 " of blob %" PRIx64 " from %" PRIu32 " to %" PRIu32 "\n",
+		      ctx->cluster_num, blob->id, ctx->old_cluster, ctx->new_cluster);
+
+	/* The metadata no longer references the old cluster, so it can be reused */
+	pthread_mutex_lock(&bs->used_clusters_mutex);
+	bs_release_cluster(bs, ctx->old_cluster);
+	pthread_mutex_unlock(&bs->used_clusters_mutex);
+
+	blob_unfreeze_io(blob, bs_defrag_unfreeze_cpl, ctx);
+}
+
+static void
+bs_defrag_copy_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint32_t *extent_page;
+
+	if (bserrno != 0) {
+		bs_defrag_move_abort(ctx, bserrno);
+		return;
+	}
+
+	blob->active.clusters[ctx->cluster_num] = bs_cluster_to_lba(ctx->bs, ctx->new_cluster);
+
+	if (blob->use_extent_table) {
+		extent_page = bs_cluster_to_extent_page(blob, ctx->cluster_num);
+		assert(*extent_page != 0);
+		blob_write_extent_page(blob, *extent_page, ctx->cluster_num, ctx->extent_page,
+				       bs_defrag_update_md_cpl, ctx);
+	} else {
+		blob->state = SPDK_BLOB_STATE_DIRTY;
+		blob_sync_md(blob, bs_defrag_update_md_cpl, ctx);
+	}
+}
+
+static void
+bs_defrag_write_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	bs_sequence_finish(seq, bserrno);
+}
+
+static void
+bs_defrag_write(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	bs_sequence_write_dev(seq, ctx->buf, bs_cluster_to_lba(ctx->bs, ctx->new_cluster),
+			      bs_cluster_to_lba(ctx->bs, 1), bs_defrag_write_cpl, ctx);
+}
+
+static void
+bs_defrag_copy(struct spdk_bs_defrag_ctx *ctx)
+{
+	struct spdk_bs_cpl cpl;
+	spdk_bs_sequence_t *seq;
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = bs_defrag_copy_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	seq = bs_sequence_start(ctx->channel, &cpl);
+	if (!seq) {
+		bs_defrag_move_abort(ctx, -ENOMEM);
+		return;
+	}
+
+	bs_sequence_read_dev(seq, ctx->buf, bs_cluster_to_lba(ctx->bs, ctx->old_cluster),
+			     bs_cluster_to_lba(ctx->bs, 1), bs_defrag_write, ctx);
+}
+
+static void bs_defrag_drain(struct spdk_bs_defrag_ctx *ctx);
+
+static void
+bs_defrag_drain_check(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct spdk_bs_defrag_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	uint32_t j;
+
+	for (j = 0; j < ch->bs->max_channel_ops; j++) {
+		if (ch->req_mem[j].io_blob == ctx->blob) {
+			ctx->inflight_io++;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+bs_defrag_drain_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bs_defrag_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	if (ctx->inflight_io > 0) {
+		/* New I/O is queued by the freeze, wait for the rest to complete */
+		bs_defrag_resume_later(ctx, BLOB_DEFRAG_RETRY_US, bs_defrag_drain);
+		return;
+	}
+
+	bs_defrag_copy(ctx);
+}
+
+static void
+bs_defrag_drain(struct spdk_bs_defrag_ctx *ctx)
+{
+	ctx->inflight_io = 0;
+	spdk_for_each_channel(ctx->bs, bs_defrag_drain_check, ctx, bs_defrag_drain_done);
+}
+
+static void
+bs_defrag_freeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		ctx->bserrno = bserrno;
+		pthread_mutex_lock(&ctx->bs->used_clusters_mutex);
+		bs_release_cluster(ctx->bs, ctx->new_cluster);
+		pthread_mutex_unlock(&ctx->bs->used_clusters_mutex);
+		ctx->blob->locked_operation_in_progress = false;
+		bs_defrag_finish(ctx, bserrno);
+		return;
+	}
+
+	bs_defrag_drain(ctx);
+}
+
+static void
+bs_defrag_next(struct spdk_bs_defrag_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_store *bs = ctx->bs;
+	uint64_t now, lba, examined = 0;
+	uint32_t cluster, target;
+	bool claimed;
+
+	while (ctx->cluster_num < blob->active.num_clusters) {
+		if (++examined > BLOB_DEFRAG_CLUSTERS_PER_POLL) {
+			bs_defrag_resume_later(ctx, 0, bs_defrag_next);
+			return;
+		}
+
+		lba = blob->active.clusters[ctx->cluster_num];
+		if (lba == 0) {
+			ctx->cluster_num++;
+			continue;
+		}
+
+		bs_defrag_refresh(ctx);
+
+		cluster = bs_lba_to_cluster(bs, lba);
+		target = bs_defrag_pick_target(ctx, cluster);
+		if (target == UINT32_MAX) {
+			bs_defrag_cluster_done(ctx, cluster);
+			continue;
+		}
+
+		if (blob->locked_operation_in_progress) {
+			/* Let snapshot, resize or other locked operations go first */
+			bs_defrag_resume_later(ctx, BLOB_DEFRAG_RETRY_US, bs_defrag_next);
+			return;
+		}
+
+		if (ctx->ticks_per_cluster != 0) {
+			now = spdk_get_ticks();
+			if (now < ctx->next_move_tsc) {
+				bs_defrag_resume_later(ctx, (ctx->next_move_tsc - now) * SPDK_SEC_TO_USEC /
+						       spdk_get_ticks_hz(), bs_defrag_next);
+				return;
+			}
+			ctx->next_move_tsc = now + ctx->ticks_per_cluster;
+		}
+
+		pthread_mutex_lock(&bs->used_clusters_mutex);
+		claimed = bs_claim_cluster_at(bs, target);
+		pthread_mutex_unlock(&bs->used_clusters_mutex);
+		if (!claimed) {
+			/* Lost the cluster to a concurrent allocation, look again */
+			bs_defrag_resume_later(ctx, 0, bs_defrag_next);
+			return;
+		}
+
+		blob->locked_operation_in_progress = true;
+		ctx->old_cluster = cluster;
+		ctx->new_cluster = target;
+		blob_freeze_io(blob, bs_defrag_freeze_cpl, ctx);
+		return;
+	}
+
+	bs_defrag_finish(ctx, 0);
+}
+
+static void
+bs_defrag_open_cpl(void *cb_arg, struct spdk_blob *blob, int bserrno)
+{
+	struct spdk_bs_defrag_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		bs_defrag_finish(ctx, bserrno);
+		return;
+	}
+
+	ctx->blob = blob;
+
+	ctx->buf = spdk_malloc(ctx->bs->cluster_sz, ctx->bs->dev->blocklen, NULL,
+			       SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	ctx->extent_page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
+					SPDK_MALLOC_DMA);
+	if (!ctx->buf || !ctx->extent_page) {
+		bs_defrag_finish(ctx, -ENOMEM);
+		return;
+	}
+
+	ctx->cluster_num = 0;
+	ctx->prev_cluster = UINT32_MAX;
+	bs_defrag_recount(ctx);
+	ctx->next_move_tsc = spdk_get_ticks();
+
+	bs_defrag_next(ctx);
+}
+
+void
+spdk_bs_blob_defrag(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		    spdk_blob_id blobid, uint64_t max_mbytes_per_sec,
+		    spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_bs_defrag_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->bs = bs;
+	ctx->channel = channel;
+	ctx->blobid = blobid;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	if (max_mbytes_per_sec != 0) {
+		ctx->ticks_per_cluster = (uint64_t)bs->cluster_sz * spdk_get_ticks_hz() /
+					 (max_mbytes_per_sec * 1024 * 1024);
+	}
+
+	spdk_bs_open_blob(bs, blobid, bs_defrag_open_cpl, ctx);
+}
+/* END spdk_bs_blob_defrag */
+
 /* START spdk_blob_resize */
 struct spdk_bs_resize_ctx {
 	spdk_blob_op_complete cb_fn;
@@ -15,6 +15,8 @@
 
 #include "request.h"
 
+struct bs_cluster_alloc;
+
 /* In Memory Data Structures
  *
  * The following data structures exist only in memory.
@@ -147,6 +149,10 @@ struct spdk_blob {
 	/* Number of data clusters retrieved from extent table,
 	 * that many have to be read from extent pages. */
 	uint64_t	remaining_clusters_in_et;
+
+	/* Cluster following the last one allocated to this blob, used as a
+	 * locality hint for the next allocation. In memory only. */
+	uint32_t	cluster_hint;
 };
 
 struct spdk_blob_store {
@@ -162,6 +168,8 @@ struct spdk_blob_store {
 
 	struct spdk_bit_array		*used_md_pages;
 	struct spdk_bit_pool		*used_clusters;
+	/* Free extents of used_clusters, protected by used_clusters_mutex */
+	struct bs_cluster_alloc		*cluster_alloc;
 	struct spdk_bit_array		*used_blobids;
 	struct spdk_bit_array		*open_blobids;
 
@@ -0,0 +1,350 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/log.h"
+#include "spdk/tree.h"
+#include "spdk/util.h"
+
+#include "cluster_alloc.h"
+
+struct bs_free_extent {
+	uint32_t				start;
+	uint32_t				len;
+
+	RB_ENTRY(bs_free_extent)		offset_link;
+	RB_ENTRY(bs_free_extent)		size_link;
+};
+
+RB_HEAD(bs_extent_offset_tree, bs_free_extent);
+RB_HEAD(bs_extent_size_tree, bs_free_extent);
+
+struct bs_cluster_alloc {
+	struct bs_extent_offset_tree		by_offset;
+	struct bs_extent_size_tree		by_size;
+
+	uint32_t				num_free;
+	uint32_t				num_extents;
+};
+
+static int
+extent_offset_cmp(struct bs_free_extent *e1, struct bs_free_extent *e2)
+{
+	return (e1->start < e2->start ? -1 : e1->start > e2->start);
+}
+
+static int
+extent_size_cmp(struct bs_free_extent *e1, struct bs_free_extent *e2)
+{
+	if (e1->len != e2->len) {
+		return e1->len < e2->len ? -1 : 1;
+	}
+
+	return extent_offset_cmp(e1, e2);
+}
+
+RB_GENERATE_STATIC(bs_extent_offset_tree, bs_free_extent, offset_link, extent_offset_cmp);
+RB_GENERATE_STATIC(bs_extent_size_tree, bs_free_extent, size_link, extent_size_cmp);
+
+static struct bs_free_extent *
+extent_insert(struct bs_cluster_alloc *alloc, uint32_t start, uint32_t len)
+{
+	struct bs_free_extent *extent;
+
+	extent = calloc(1, sizeof(*extent));
+	if (extent == NULL) {
+		return NULL;
+	}
+
+	extent->start = start;
+	extent->len = len;
+	RB_INSERT(bs_extent_offset_tree, &alloc->by_offset, extent);
+	RB_INSERT(bs_extent_size_tree, &alloc->by_size, extent);
+	alloc->num_extents++;
+
+	return extent;
+}
+
+static void
+extent_remove(struct bs_cluster_alloc *alloc, struct bs_free_extent *extent)
+{
+	RB_REMOVE(bs_extent_offset_tree, &alloc->by_offset, extent);
+	RB_REMOVE(bs_extent_size_tree, &alloc->by_size, extent);
+	alloc->num_extents--;
+	free(extent);
+}
+
+/* Return the extent holding the given cluster, or NULL if it is allocated. */
+static struct bs_free_extent *
+extent_lookup(struct bs_cluster_alloc *alloc, uint32_t cluster, struct bs_free_extent **next)
+{
+	struct bs_free_extent key = { .start = cluster };
+	struct bs_free_extent *extent, *prev;
+
+	extent = RB_NFIND(bs_extent_offset_tree, &alloc->by_offset, &key);
+	if (next != NULL) {
+		*next = extent;
+	}
+	if (extent != NULL && extent->start == cluster) {
+		return extent;
+	}
+
+	prev = extent ? RB_PREV(bs_extent_offset_tree, &alloc->by_offset, extent) :
+	       RB_MAX(bs_extent_offset_tree, &alloc->by_offset);
+	if (prev != NULL && cluster - prev->start < prev->len) {
+		return prev;
+	}
+
+	return NULL;
+}
+
+/* Smallest extent holding at least count clusters, or the largest one. */
+static struct bs_free_extent *
+extent_best_fit(struct bs_cluster_alloc *alloc, uint32_t count)
+{
+	struct bs_free_extent key = { .start = 0, .len = count };
+	struct bs_free_extent *extent;
+
+	extent = RB_NFIND(bs_extent_size_tree, &alloc->by_size, &key);
+	if (extent == NULL) {
+		extent = RB_MAX(bs_extent_size_tree, &alloc->by_size);
+	}
+
+	return extent;
+}
+
+/* Take count clusters starting at start out of the extent. Returns false if
+ * the extent had to be split but there was no memory to do so. */
+static bool
+extent_carve(struct bs_cluster_alloc *alloc, struct bs_free_extent *extent,
+	     uint32_t start, uint32_t count)
+{
+	uint32_t head = start - extent->start;
+	uint32_t tail = extent->len - head - count;
+
+	assert(start >= extent->start);
+	assert(count <= extent->len - head);
+
+	if (head != 0 && tail != 0) {
+		if (extent_insert(alloc, start + count, tail) == NULL) {
+			return false;
+		}
+		tail = 0;
+	}
+
+	if (head == 0 && tail == 0) {
+		extent_remove(alloc, extent);
+	} else {
+		/* Trimming the extent does not change its position among the other
+		 * extents by offset, only by size. */
+		RB_REMOVE(bs_extent_size_tree, &alloc->by_size, extent);
+		if (head == 0) {
+			extent->start = start + count;
+		}
+		extent->len = head + tail;
+		RB_INSERT(bs_extent_size_tree, &alloc->by_size, extent);
+	}
+
+	alloc->num_free -= count;
+	return true;
+}
+
+struct bs_cluster_alloc *
+bs_cluster_alloc_create(const struct spdk_bit_array *used_clusters)
+{
+	struct bs_cluster_alloc *alloc;
+	uint32_t capacity = spdk_bit_array_capacity(used_clusters);
+	uint32_t start, end;
+
+	alloc = calloc(1, sizeof(*alloc));
+	if (alloc == NULL) {
+		return NULL;
+	}
+
+	RB_INIT(&alloc->by_offset);
+	RB_INIT(&alloc->by_size);
+
+	start = spdk_bit_array_find_first_clear(used_clusters, 0);
+	while (start < capacity) {
+		end = spdk_bit_array_find_first_set(used_clusters, start);
+		if (end > capacity) {
+			end = capacity;
+		}
+
+		if (extent_insert(alloc, start, end - start) == NULL) {
+			bs_cluster_alloc_free(&alloc);
+			return NULL;
+		}
+		alloc->num_free += end - start;
+
+		if (end == capacity) {
+			break;
+		}
+		start = spdk_bit_array_find_first_clear(used_clusters, end);
+	}
+
+	return alloc;
+}
+
+void
+bs_cluster_alloc_free(struct bs_cluster_alloc **_alloc)
+{
+	struct bs_cluster_alloc *alloc = *_alloc;
+	struct bs_free_extent *extent, *tmp;
+
+	if (alloc == NULL) {
+		return;
+	}
+
+	RB_FOREACH_SAFE(extent, bs_extent_offset_tree, &alloc->by_offset, tmp) {
+		extent_remove(alloc, extent);
+	}
+
+	free(alloc);
+	*_alloc = NULL;
+}
+
+uint32_t
+bs_cluster_alloc_get(struct bs_cluster_alloc *alloc, uint32_t hint, uint32_t count,
+		     uint32_t *run_len)
+{
+	struct bs_free_extent *extent = NULL, *next = NULL;
+	uint32_t start;
+
+	assert(count > 0);
+
+	if (hint != UINT32_MAX) {
+		extent = extent_lookup(alloc, hint, &next);
+		if (extent == NULL && count == 1) {
+			extent = next;
+		}
+	}
+
+	if (extent != NULL) {
+		start = spdk_max(hint, extent->start);
+	} else if (hint == UINT32_MAX && count == 1) {
+		/* First cluster of a run that is likely to grow one cluster at a
+		 * time, e.g. a thin provisioned blob. Start it halfway through the
+		 * largest extent, so that it can grow without running into the
+		 * run started before it. */
+		extent = RB_MAX(bs_extent_size_tree, &alloc->by_size);
+		if (extent == NULL) {
+			return UINT32_MAX;
+		}
+		start = extent->start + extent->len / 2;
+	} else {
+		extent = extent_best_fit(alloc, count);
+		if (extent == NULL) {
+			return UINT32_MAX;
+		}
+		start = extent->start;
+	}
+
+	count = spdk_min(count, extent->len - (start - extent->start));
+	if (!extent_carve(alloc, extent, start, count)) {
+		/* Cannot split the extent, take its head instead */
+		start = extent->start;
+		count = spdk_min(count, extent->len);
+		extent_carve(alloc, extent, start, count);
+	}
+
+	*run_len = count;
+	return start;
+}
+
+bool
+bs_cluster_alloc_get_at(struct bs_cluster_alloc *alloc, uint32_t start, uint32_t count)
+{
+	struct bs_free_extent *extent;
+
+	extent = extent_lookup(alloc, start, NULL);
+	if (extent == NULL || extent->len - (start - extent->start) < count) {
+		return false;
+	}
+
+	return extent_carve(alloc, extent, start, count);
+}
+
+void
+bs_cluster_alloc_put(struct bs_cluster_alloc *alloc, uint32_t start, uint32_t count)
+{
+	struct bs_free_extent key = { .start = start };
+	struct bs_free_extent *prev, *next;
+
+	next = RB_NFIND(bs_extent_offset_tree, &alloc->by_offset, &key);
+	prev = next ? RB_PREV(bs_extent_offset_tree, &alloc->by_offset, next) :
+	       RB_MAX(bs_extent_offset_tree, &alloc->by_offset);
+
+	assert(next == NULL || next->start >= start + count);
+	assert(prev == NULL || prev->start + prev->len <= start);
+
+	alloc->num_free += count;
+
+	if (prev != NULL && prev->start + prev->len == start) {
+		RB_REMOVE(bs_extent_size_tree, &alloc->by_size, prev);
+		prev->len += count;
+		if (next != NULL && next->start == start + count) {
+			prev->len += next->len;
+			extent_remove(alloc, next);
+		}
+		RB_INSERT(bs_extent_size_tree, &alloc->by_size, prev);
+		return;
+	}
+
+	if (next != NULL && next->start == start + count) {
+		RB_REMOVE(bs_extent_size_tree, &alloc->by_size, next);
+		next->start = start;
+		next->len += count;
+		RB_INSERT(bs_extent_size_tree, &alloc->by_size, next);
+		return;
+	}
+
+	if (extent_insert(alloc, start, count) == NULL) {
+		/* The clusters stay free in the used clusters mask, they just won't
+		 * be handed out until the index is rebuilt on the next load. */
+		SPDK_ERRLOG("Cannot track %u free clusters at %u\n", count, start);
+		alloc->num_free -= count;
+	}
+}
+
+uint32_t
+bs_cluster_alloc_find(struct bs_cluster_alloc *alloc, uint32_t count, uint32_t *run_len)
+{
+	struct bs_free_extent *extent;
+
+	extent = extent_best_fit(alloc, count);
+	if (extent == NULL) {
+		return UINT32_MAX;
+	}
+
+	*run_len = spdk_min(count, extent->len);
+	return extent->start;
+}
+
+uint32_t
+bs_cluster_alloc_free_run_at(struct bs_cluster_alloc *alloc, uint32_t start)
+{
+	struct bs_free_extent *extent;
+
+	extent = extent_lookup(alloc, start, NULL);
+	if (extent == NULL) {
+		return 0;
+	}
+
+	return extent->len - (start - extent->start);
+}
+
+uint32_t
+bs_cluster_alloc_num_free(struct bs_cluster_alloc *alloc)
+{
+	return alloc->num_free;
+}
+
+uint32_t
+bs_cluster_alloc_num_extents(struct bs_cluster_alloc *alloc)
+{
+	return alloc->num_extents;
+}
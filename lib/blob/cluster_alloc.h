@@ -0,0 +1,77 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_BS_CLUSTER_ALLOC_H
+#define SPDK_BS_CLUSTER_ALLOC_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bit_array.h"
+
+/*
+ * Index of the free clusters of a blobstore, kept as a set of free extents
+ * (runs of consecutive free clusters). Extents are ordered both by offset,
+ * to merge neighbours on release and to honour locality hints, and by size,
+ * to pick the smallest extent able to hold a request.
+ *
+ * The index does no locking and does not touch the used_clusters bit pool,
+ * which remains the persistent record of allocations. Callers keep the two
+ * in sync under the used_clusters_mutex.
+ */
+struct bs_cluster_alloc;
+
+/*
+ * Create the index from a used clusters mask. A cleared bit is a free cluster.
+ */
+struct bs_cluster_alloc *bs_cluster_alloc_create(const struct spdk_bit_array *used_clusters);
+
+void bs_cluster_alloc_free(struct bs_cluster_alloc **alloc);
+
+/*
+ * Allocate a run of at most count consecutive clusters.
+ *
+ * hint is the cluster the caller would like the run to start at, usually the
+ * one following the last cluster of a blob, or UINT32_MAX for no preference.
+ * If hint is free, the run starts there. Otherwise a single cluster is taken
+ * from the first free extent after hint, while longer runs are taken from the
+ * smallest extent that fits count clusters, or the largest extent if none
+ * does. A single cluster without a hint starts a new run in the middle of the
+ * largest extent, leaving room on both sides for runs that grow one cluster
+ * at a time.
+ *
+ * Returns the first cluster of the run and stores its length in run_len, or
+ * UINT32_MAX if no cluster is free.
+ */
+uint32_t bs_cluster_alloc_get(struct bs_cluster_alloc *alloc, uint32_t hint, uint32_t count,
+			      uint32_t *run_len);
+
+/*
+ * Allocate the given range of clusters. Returns false without allocating
+ * anything if any of them is not free.
+ */
+bool bs_cluster_alloc_get_at(struct bs_cluster_alloc *alloc, uint32_t start, uint32_t count);
+
+/*
+ * Return a range of clusters to the index.
+ */
+void bs_cluster_alloc_put(struct bs_cluster_alloc *alloc, uint32_t start, uint32_t count);
+
+/*
+ * Look up, without allocating, the run the allocator would pick for count
+ * clusters without a hint. Returns the first cluster of the run and stores its
+ * length, capped at count, in run_len. Returns UINT32_MAX if no cluster is free.
+ */
+uint32_t bs_cluster_alloc_find(struct bs_cluster_alloc *alloc, uint32_t count, uint32_t *run_len);
+
+/*
+ * Number of consecutive free clusters starting at the given cluster.
+ */
+uint32_t bs_cluster_alloc_free_run_at(struct bs_cluster_alloc *alloc, uint32_t start);
+
+uint32_t bs_cluster_alloc_num_free(struct bs_cluster_alloc *alloc);
+
+uint32_t bs_cluster_alloc_num_extents(struct bs_cluster_alloc *alloc);
+
+#endif
@@ -114,6 +114,9 @@ struct spdk_bs_request_set {
 	} u;
 	/* Pointer to ext_io_opts passed by the user */
 	struct spdk_blob_ext_io_opts *ext_io_opts;
+	/* Blob targeted by the user I/O in flight on this set, NULL otherwise.
+	 * Used to drain I/O before the blob's clusters are relocated. */
+	struct spdk_blob		*io_blob;
 	TAILQ_ENTRY(spdk_bs_request_set) link;
 };
 
@@ -29,9 +29,35 @@
 
 #define SPDK_BLOBFS_SIGNATURE	"BLOBFS"
 
+/*
+ * The cache is split into shards, each with its own pool of buffers and its own
+ *  eviction clock, so that threads reading different files do not contend on a
+ *  single pool.  Reactor threads use the shard of their core, other threads
+ *  (e.g. RocksDB background threads) are spread over the shards round-robin.
+ */
+struct cache_shard {
+	struct spdk_mempool		*pool;
+	uint32_t			num_buffers;
+
+	/* Protects the clock */
+	pthread_spinlock_t		lock;
+	TAILQ_HEAD(, cache_buffer)	clock;
+	uint32_t			clock_size;
+	struct cache_buffer		*hand;
+};
+
+#define BLOBFS_CACHE_MAX_SHARDS 64
+#define BLOBFS_CACHE_MIN_SHARD_BUFFERS 64
+/* Number of buffers a writer or reader evicts itself when its shard runs dry */
+#define BLOBFS_CACHE_EVICT_BATCH 8
+/* Maximum number of buffers the clock hand passes in one eviction call */
+#define BLOBFS_CACHE_EVICT_SCAN_MAX 1024
+
 static uint64_t g_fs_cache_size = BLOBFS_DEFAULT_CACHE_SIZE;
-static struct spdk_mempool *g_cache_pool;
-static TAILQ_HEAD(, spdk_file) g_caches = TAILQ_HEAD_INITIALIZER(g_caches);
+static struct cache_shard *g_cache_shards;
+static uint32_t g_cache_num_shards;
+static uint32_t g_cache_next_shard;
+static __thread uint32_t g_cache_local_shard = UINT32_MAX;
 static struct spdk_poller *g_cache_pool_mgmt_poller;
 static struct spdk_thread *g_cache_pool_thread;
 #define BLOBFS_CACHE_POOL_POLL_PERIOD_IN_US 1000ULL
@@ -76,14 +102,62 @@ SPDK_TRACE_REGISTER_FN(blobfs_trace, "blobfs", TRACE_GROUP_BLOBFS)
 	spdk_trace_register_description_ext(opts, SPDK_COUNTOF(opts));
 }
 
+static void
+cache_shard_link(struct cache_shard *shard, struct cache_buffer *cache_buffer)
+{
+	pthread_spin_lock(&shard->lock);
+	/* Insert behind the hand, so a new buffer survives a full turn of the clock */
+	if (shard->hand != NULL) {
+		TAILQ_INSERT_BEFORE(shard->hand, cache_buffer, clock_link);
+	} else {
+		TAILQ_INSERT_TAIL(&shard->clock, cache_buffer, clock_link);
+	}
+	shard->clock_size++;
+	cache_buffer->on_clock = true;
+	pthread_spin_unlock(&shard->lock);
+}
+
+/* Must be called with the shard lock held. */
+static void
+cache_shard_unlink(struct cache_shard *shard, struct cache_buffer *cache_buffer)
+{
+	assert(cache_buffer->on_clock);
+
+	if (shard->hand == cache_buffer) {
+		shard->hand = TAILQ_NEXT(cache_buffer, clock_link);
+	}
+	TAILQ_REMOVE(&shard->clock, cache_buffer, clock_link);
+	shard->clock_size--;
+	cache_buffer->on_clock = false;
+}
+
 void
 cache_buffer_free(struct cache_buffer *cache_buffer)
 {
-	spdk_mempool_put(g_cache_pool, cache_buffer->buf);
+	struct cache_shard *shard = cache_buffer->shard;
+
+	/* Only buffers that never got any memory have no shard */
+	if (shard != NULL) {
+		/* Buffers evicted by the clock have already been unlinked */
+		if (cache_buffer->on_clock) {
+			pthread_spin_lock(&shard->lock);
+			cache_shard_unlink(shard, cache_buffer);
+			pthread_spin_unlock(&shard->lock);
+		}
+		spdk_mempool_put(shard->pool, cache_buffer->buf);
+	}
 	free(cache_buffer);
 }
 
 #define CACHE_READAHEAD_THRESHOLD	(128 * 1024)
+/*
+ * Once a file is read sequentially, readahead starts with a window of
+ *  CACHE_READAHEAD_MIN_WINDOW bytes after the current read.  The window doubles
+ *  every time the reader consumes a buffer that was filled by readahead, up to
+ *  CACHE_READAHEAD_MAX_WINDOW, and is reset by a non-sequential read.
+ */
+#define CACHE_READAHEAD_MIN_WINDOW	(2 * CACHE_BUFFER_SIZE)
+#define CACHE_READAHEAD_MAX_WINDOW	(32 * CACHE_BUFFER_SIZE)
 
 struct spdk_file {
 	struct spdk_filesystem	*fs;
@@ -97,6 +171,7 @@ struct spdk_file {
 	uint64_t		append_pos;
 	uint64_t		seq_byte_count;
 	uint64_t		next_seq_offset;
+	uint64_t		readahead_window;
 	uint32_t		priority;
 	TAILQ_ENTRY(spdk_file)	tailq;
 	spdk_blob_id		blobid;
@@ -106,7 +181,6 @@ struct spdk_file {
 	struct cache_tree	*tree;
 	TAILQ_HEAD(open_requests_head, spdk_fs_request) open_requests;
 	TAILQ_HEAD(sync_requests_head, spdk_fs_request) sync_requests;
-	TAILQ_ENTRY(spdk_file)	cache_tailq;
 };
 
 struct spdk_deleted_file {
@@ -228,45 +302,164 @@ spdk_fs_opts_init(struct spdk_blobfs_opts *opts)
 	opts->cluster_sz = SPDK_BLOBFS_DEFAULT_OPTS_CLUSTER_SZ;
 }
 
-static int _blobfs_cache_pool_reclaim(void *arg);
+static struct cache_shard *
+cache_local_shard(void)
+{
+	uint32_t core;
 
-static bool
-blobfs_cache_pool_need_reclaim(void)
+	if (g_cache_local_shard == UINT32_MAX) {
+		core = spdk_env_get_current_core();
+		if (core == UINT32_MAX) {
+			core = __atomic_fetch_add(&g_cache_next_shard, 1, __ATOMIC_RELAXED);
+		}
+		g_cache_local_shard = core;
+	}
+
+	return &g_cache_shards[g_cache_local_shard % g_cache_num_shards];
+}
+
+/*
+ * Move the clock hand over the shard and evict up to count buffers.  A buffer
+ *  that was hit since the hand last passed it gets a second chance.  Buffers
+ *  holding dirty data, being read or written, or belonging to a file that is
+ *  locked by another thread are skipped.  locked_file is a file whose lock the
+ *  caller already holds, or NULL.  The scan is bounded, so the shard lock is not
+ *  held over the whole clock; the hand carries on from where it stopped next
+ *  time.  Returns the number of evicted buffers.
+ */
+static uint32_t
+cache_shard_evict(struct cache_shard *shard, uint32_t count, struct spdk_file *locked_file)
 {
-	size_t count;
+	struct cache_buffer *buf;
+	struct spdk_file *file;
+	uint32_t evicted = 0, scanned = 0;
 
-	count = spdk_mempool_count(g_cache_pool);
-	/* We define a aggressive policy here as the requirements from db_bench are batched, so start the poller
-	 *  when the number of available cache buffer is less than 1/5 of total buffers.
+	pthread_spin_lock(&shard->lock);
+	/* The first turn may only clear the referenced bits, so allow two */
+	while (evicted < count &&
+	       scanned++ < spdk_min(2 * shard->clock_size, BLOBFS_CACHE_EVICT_SCAN_MAX)) {
+		buf = shard->hand != NULL ? shard->hand : TAILQ_FIRST(&shard->clock);
+		if (buf == NULL) {
+			break;
+		}
+		shard->hand = TAILQ_NEXT(buf, clock_link);
+
+		if (buf->referenced) {
+			buf->referenced = false;
+			continue;
+		}
+
+		/* The file lock is taken before the shard lock everywhere else */
+		file = buf->file;
+		if (file != locked_file && pthread_spin_trylock(&file->lock) != 0) {
+			continue;
+		}
+
+		if (buf->in_progress || buf->bytes_flushed != buf->bytes_filled ||
+		    (buf == file->last && file->open_for_writing)) {
+			if (file != locked_file) {
+				pthread_spin_unlock(&file->lock);
+			}
+			continue;
+		}
+
+		cache_shard_unlink(shard, buf);
+		pthread_spin_unlock(&shard->lock);
+
+		BLOBFS_TRACE(file, "evict offset=%jx\n", buf->offset);
+		if (buf == file->last) {
+			file->last = NULL;
+		}
+		tree_remove_buffer(file->tree, buf);
+		if (file != locked_file) {
+			pthread_spin_unlock(&file->lock);
+		}
+		evicted++;
+
+		pthread_spin_lock(&shard->lock);
+	}
+	pthread_spin_unlock(&shard->lock);
+
+	return evicted;
+}
+
+static uint32_t
+cache_shard_reclaim_target(struct cache_shard *shard)
+{
+	size_t count, low_watermark;
+
+	count = spdk_mempool_count(shard->pool);
+	/* We define a aggressive policy here as the requirements from db_bench are batched, so start
+	 *  reclaiming when the number of available cache buffers is less than 1/5 of the shard.
 	 */
-	if (count > (size_t)g_fs_cache_size / CACHE_BUFFER_SIZE / 5) {
-		return false;
+	low_watermark = shard->num_buffers / 5;
+	if (count > low_watermark) {
+		return 0;
+	}
+
+	return low_watermark - count + 1;
+}
+
+static int
+_blobfs_cache_pool_reclaim(void *arg)
+{
+	struct cache_shard *shard;
+	uint32_t i, target, evicted = 0;
+
+	for (i = 0; i < g_cache_num_shards; i++) {
+		shard = &g_cache_shards[i];
+		target = cache_shard_reclaim_target(shard);
+		if (target > 0) {
+			evicted += cache_shard_evict(shard, target, NULL);
+		}
 	}
 
-	return true;
+	return evicted > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
 static void
 __start_cache_pool_mgmt(void *ctx)
 {
-	assert(g_cache_pool == NULL);
-
-	g_cache_pool = spdk_mempool_create("spdk_fs_cache",
-					   g_fs_cache_size / CACHE_BUFFER_SIZE,
-					   CACHE_BUFFER_SIZE,
-					   SPDK_MEMPOOL_DEFAULT_CACHE_SIZE,
-					   SPDK_ENV_SOCKET_ID_ANY);
-	if (!g_cache_pool) {
-		if (spdk_mempool_lookup("spdk_fs_cache") != NULL) {
-			SPDK_ERRLOG("Unable to allocate mempool: already exists\n");
-			SPDK_ERRLOG("Probably running in multiprocess environment, which is "
-				    "unsupported by the blobfs library\n");
-		} else {
-			SPDK_ERRLOG("Create mempool failed, you may "
-				    "increase the memory and try again\n");
-		}
+	struct cache_shard *shard;
+	uint64_t num_buffers = g_fs_cache_size / CACHE_BUFFER_SIZE;
+	uint32_t num_shards, i;
+	char name[32];
+
+	assert(g_cache_shards == NULL);
+
+	num_shards = spdk_min(spdk_env_get_core_count(), BLOBFS_CACHE_MAX_SHARDS);
+	num_shards = spdk_min(num_shards, num_buffers / BLOBFS_CACHE_MIN_SHARD_BUFFERS);
+	num_shards = spdk_max(num_shards, 1);
+
+	g_cache_shards = calloc(num_shards, sizeof(*g_cache_shards));
+	if (!g_cache_shards) {
+		SPDK_ERRLOG("Cannot allocate cache shards\n");
 		assert(false);
+		return;
+	}
+
+	for (i = 0; i < num_shards; i++) {
+		shard = &g_cache_shards[i];
+		shard->num_buffers = num_buffers / num_shards + (i < num_buffers % num_shards);
+		snprintf(name, sizeof(name), "spdk_fs_cache_%u", i);
+		shard->pool = spdk_mempool_create(name, shard->num_buffers, CACHE_BUFFER_SIZE,
+						  SPDK_MEMPOOL_DEFAULT_CACHE_SIZE,
+						  SPDK_ENV_SOCKET_ID_ANY);
+		if (!shard->pool) {
+			if (spdk_mempool_lookup(name) != NULL) {
+				SPDK_ERRLOG("Unable to allocate mempool: already exists\n");
+				SPDK_ERRLOG("Probably running in multiprocess environment, which is "
+					    "unsupported by the blobfs library\n");
+			} else {
+				SPDK_ERRLOG("Create mempool failed, you may "
+					    "increase the memory and try again\n");
+			}
+			assert(false);
+		}
+		pthread_spin_init(&shard->lock, 0);
+		TAILQ_INIT(&shard->clock);
 	}
+	g_cache_num_shards = num_shards;
 
 	assert(g_cache_pool_mgmt_poller == NULL);
 	g_cache_pool_mgmt_poller = SPDK_POLLER_REGISTER(_blobfs_cache_pool_reclaim, NULL,
@@ -276,12 +469,22 @@ __start_cache_pool_mgmt(void *ctx)
 static void
 __stop_cache_pool_mgmt(void *ctx)
 {
+	struct cache_shard *shard;
+	uint32_t i;
+
 	spdk_poller_unregister(&g_cache_pool_mgmt_poller);
 
-	assert(g_cache_pool != NULL);
-	assert(spdk_mempool_count(g_cache_pool) == g_fs_cache_size / CACHE_BUFFER_SIZE);
-	spdk_mempool_free(g_cache_pool);
-	g_cache_pool = NULL;
+	assert(g_cache_shards != NULL);
+	for (i = 0; i < g_cache_num_shards; i++) {
+		shard = &g_cache_shards[i];
+		assert(TAILQ_EMPTY(&shard->clock));
+		assert(spdk_mempool_count(shard->pool) == shard->num_buffers);
+		spdk_mempool_free(shard->pool);
+		pthread_spin_destroy(&shard->lock);
+	}
+	free(g_cache_shards);
+	g_cache_shards = NULL;
+	g_cache_num_shards = 0;
 
 	spdk_thread_exit(g_cache_pool_thread);
 }
@@ -1969,7 +2172,7 @@ spdk_fs_set_cache_size(uint64_t size_in_mb)
 	/* setting g_fs_cache_size is only permitted if cache pool
 	 * is already freed or hasn't been initialized
 	 */
-	if (g_cache_pool != NULL) {
+	if (g_cache_shards != NULL) {
 		return -EPERM;
 	}
 
@@ -1986,112 +2189,43 @@ spdk_fs_get_cache_size(void)
 
 static void __file_flush(void *ctx);
 
-/* Try to free some cache buffers from this file.
- */
-static int
-reclaim_cache_buffers(struct spdk_file *file)
+/* Must be called with the lock of file held. */
+static void *
+cache_get_buffer(struct spdk_file *file, struct cache_shard **_shard)
 {
-	int rc;
-
-	BLOBFS_TRACE(file, "free=%s\n", file->name);
-
-	/* The function is safe to be called with any threads, while the file
-	 * lock maybe locked by other thread for now, so try to get the file
-	 * lock here.
-	 */
-	rc = pthread_spin_trylock(&file->lock);
-	if (rc != 0) {
-		return -1;
-	}
-
-	if (file->tree->present_mask == 0) {
-		pthread_spin_unlock(&file->lock);
-		return -1;
-	}
-	tree_free_buffers(file->tree);
-
-	TAILQ_REMOVE(&g_caches, file, cache_tailq);
-	/* If not freed, put it in the end of the queue */
-	if (file->tree->present_mask != 0) {
-		TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
-	} else {
-		file->last = NULL;
-	}
-	pthread_spin_unlock(&file->lock);
-
-	return 0;
-}
-
-static int
-_blobfs_cache_pool_reclaim(void *arg)
-{
-	struct spdk_file *file, *tmp;
-	int rc;
+	struct cache_shard *local, *shard;
+	uint32_t i;
+	void *buf;
 
-	if (!blobfs_cache_pool_need_reclaim()) {
-		return SPDK_POLLER_IDLE;
+	local = cache_local_shard();
+	buf = spdk_mempool_get(local->pool);
+	if (buf == NULL && cache_shard_evict(local, BLOBFS_CACHE_EVICT_BATCH, file) > 0) {
+		buf = spdk_mempool_get(local->pool);
 	}
-
-	TAILQ_FOREACH_SAFE(file, &g_caches, cache_tailq, tmp) {
-		if (!file->open_for_writing &&
-		    file->priority == SPDK_FILE_PRIORITY_LOW) {
-			rc = reclaim_cache_buffers(file);
-			if (rc < 0) {
-				continue;
-			}
-			if (!blobfs_cache_pool_need_reclaim()) {
-				return SPDK_POLLER_BUSY;
-			}
-			break;
-		}
+	if (buf != NULL) {
+		*_shard = local;
+		return buf;
 	}
 
-	TAILQ_FOREACH_SAFE(file, &g_caches, cache_tailq, tmp) {
-		if (!file->open_for_writing) {
-			rc = reclaim_cache_buffers(file);
-			if (rc < 0) {
-				continue;
-			}
-			if (!blobfs_cache_pool_need_reclaim()) {
-				return SPDK_POLLER_BUSY;
-			}
-			break;
+	/* Borrow a buffer from the other shards rather than wait for the reclaim poller */
+	for (i = 1; i < g_cache_num_shards; i++) {
+		shard = &g_cache_shards[(local - g_cache_shards + i) % g_cache_num_shards];
+		buf = spdk_mempool_get(shard->pool);
+		if (buf != NULL) {
+			*_shard = shard;
+			return buf;
 		}
 	}
 
-	TAILQ_FOREACH_SAFE(file, &g_caches, cache_tailq, tmp) {
-		rc = reclaim_cache_buffers(file);
-		if (rc < 0) {
-			continue;
-		}
-		break;
-	}
-
-	return SPDK_POLLER_BUSY;
-}
-
-static void
-_add_file_to_cache_pool(void *ctx)
-{
-	struct spdk_file *file = ctx;
-
-	TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
-}
-
-static void
-_remove_file_from_cache_pool(void *ctx)
-{
-	struct spdk_file *file = ctx;
-
-	TAILQ_REMOVE(&g_caches, file, cache_tailq);
+	return NULL;
 }
 
 static struct cache_buffer *
 cache_insert_buffer(struct spdk_file *file, uint64_t offset)
 {
 	struct cache_buffer *buf;
+	struct cache_shard *shard;
 	int count = 0;
-	bool need_update = false;
 
 	buf = calloc(1, sizeof(*buf));
 	if (buf == NULL) {
@@ -2100,7 +2234,7 @@ cache_insert_buffer(struct spdk_file *file, uint64_t offset)
 	}
 
 	do {
-		buf->buf = spdk_mempool_get(g_cache_pool);
+		buf->buf = cache_get_buffer(file, &shard);
 		if (buf->buf) {
 			break;
 		}
@@ -2115,15 +2249,13 @@ cache_insert_buffer(struct spdk_file *file, uint64_t offset)
 
 	buf->buf_size = CACHE_BUFFER_SIZE;
 	buf->offset = offset;
+	buf->file = file;
+	buf->shard = shard;
+	/* Give buffers of high priority files a head start on the clock */
+	buf->referenced = file->priority == SPDK_FILE_PRIORITY_HIGH;
 
-	if (file->tree->present_mask == 0) {
-		need_update = true;
-	}
 	file->tree = tree_insert_buffer(file->tree, buf);
-
-	if (need_update) {
-		spdk_thread_send_msg(g_cache_pool_thread, _add_file_to_cache_pool, file);
-	}
+	cache_shard_link(shard, buf);
 
 	return buf;
 }
@@ -2553,21 +2685,24 @@ __next_cache_buffer_offset(uint64_t offset)
 	return (offset + CACHE_BUFFER_SIZE) & ~(CACHE_TREE_LEVEL_MASK(0));
 }
 
-static void
-check_readahead(struct spdk_file *file, uint64_t offset,
-		struct spdk_fs_channel *channel)
+/*
+ * Read the cache buffer at the given offset from disk in the background, unless
+ *  it is already cached.  Must be called with the file lock held.
+ */
+static int
+cache_fill_buffer(struct spdk_file *file, uint64_t offset, struct spdk_fs_channel *channel,
+		  bool readahead)
 {
 	struct spdk_fs_request *req;
 	struct spdk_fs_cb_args *args;
 
-	offset = __next_cache_buffer_offset(offset);
-	if (tree_find_buffer(file->tree, offset) != NULL || file->length <= offset) {
-		return;
+	if (tree_find_buffer(file->tree, offset) != NULL) {
+		return 0;
 	}
 
 	req = alloc_fs_request(channel);
 	if (req == NULL) {
-		return;
+		return -ENOMEM;
 	}
 	args = &req->args;
 
@@ -2579,37 +2714,65 @@ check_readahead(struct spdk_file *file, uint64_t offset,
 	if (!args->op.readahead.cache_buffer) {
 		BLOBFS_TRACE(file, "Cannot allocate buf for offset=%jx\n", offset);
 		free_fs_request(req);
-		return;
+		return -ENOMEM;
 	}
 
 	args->op.readahead.cache_buffer->in_progress = true;
+	args->op.readahead.cache_buffer->readahead = readahead;
 	if (file->length < (offset + CACHE_BUFFER_SIZE)) {
 		args->op.readahead.length = file->length & (CACHE_BUFFER_SIZE - 1);
 	} else {
 		args->op.readahead.length = CACHE_BUFFER_SIZE;
 	}
 	file->fs->send_request(__readahead, req);
+	return 0;
 }
 
-int64_t
-spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
-	       void *payload, uint64_t offset, uint64_t length)
+/* Returns false if no further readahead is possible for now. */
+static bool
+check_readahead(struct spdk_file *file, uint64_t offset,
+		struct spdk_fs_channel *channel)
 {
-	struct spdk_fs_channel *channel = (struct spdk_fs_channel *)ctx;
-	uint64_t final_offset, final_length;
-	uint32_t sub_reads = 0;
-	struct cache_buffer *buf;
-	uint64_t read_len;
-	struct rw_from_file_arg arg = {};
+	offset = __next_cache_buffer_offset(offset);
+	if (file->length <= offset) {
+		return false;
+	}
 
-	pthread_spin_lock(&file->lock);
+	return cache_fill_buffer(file, offset, channel, true) == 0;
+}
 
-	BLOBFS_TRACE_RW(file, "offset=%ju length=%ju\n", offset, length);
+static void
+file_readahead(struct spdk_file *file, uint64_t offset, struct spdk_fs_channel *channel)
+{
+	uint64_t ra_offset, end;
 
-	file->open_for_writing = false;
+	if (file->readahead_window == 0) {
+		file->readahead_window = CACHE_READAHEAD_MIN_WINDOW;
+	}
+
+	end = offset + file->readahead_window;
+	for (ra_offset = offset; ra_offset < end; ra_offset += CACHE_BUFFER_SIZE) {
+		if (!check_readahead(file, ra_offset, channel)) {
+			break;
+		}
+	}
+}
+
+/*
+ * Copy the cached parts of a read and send the rest to disk.  Must be called with
+ *  the file lock held, which is dropped and retaken while sending.  The number of
+ *  reads sent is added to sub_reads, each of them posts channel->sem when done.
+ *  Returns the number of bytes read.
+ */
+static uint64_t
+__file_read(struct spdk_file *file, void *payload, uint64_t offset, uint64_t length,
+	    struct rw_from_file_arg *arg, uint32_t *sub_reads)
+{
+	uint64_t final_offset, final_length;
+	struct cache_buffer *buf;
+	uint64_t read_len;
 
 	if (length == 0 || offset >= file->append_pos) {
-		pthread_spin_unlock(&file->lock);
 		return 0;
 	}
 
@@ -2619,16 +2782,14 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 
 	if (offset != file->next_seq_offset) {
 		file->seq_byte_count = 0;
+		file->readahead_window = 0;
 	}
 	file->seq_byte_count += length;
 	file->next_seq_offset = offset + length;
 	if (file->seq_byte_count >= CACHE_READAHEAD_THRESHOLD) {
-		check_readahead(file, offset, channel);
-		check_readahead(file, offset + CACHE_BUFFER_SIZE, channel);
+		file_readahead(file, offset, arg->channel);
 	}
 
-	arg.channel = channel;
-	arg.rwerrno = 0;
 	final_length = 0;
 	final_offset = offset + length;
 	while (offset < final_offset) {
@@ -2641,10 +2802,10 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 		buf = tree_find_filled_buffer(file->tree, offset);
 		if (buf == NULL) {
 			pthread_spin_unlock(&file->lock);
-			ret = __send_rw_from_file(file, payload, offset, length, true, &arg);
+			ret = __send_rw_from_file(file, payload, offset, length, true, arg);
 			pthread_spin_lock(&file->lock);
 			if (ret == 0) {
-				sub_reads++;
+				(*sub_reads)++;
 			}
 		} else {
 			read_len = length;
@@ -2653,23 +2814,57 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 			}
 			BLOBFS_TRACE(file, "read %p offset=%ju length=%ju\n", payload, offset, read_len);
 			memcpy(payload, &buf->buf[offset - buf->offset], read_len);
-			if ((offset + read_len) % CACHE_BUFFER_SIZE == 0) {
-				tree_remove_buffer(file->tree, buf);
-				if (file->tree->present_mask == 0) {
-					spdk_thread_send_msg(g_cache_pool_thread, _remove_file_from_cache_pool, file);
+			if (buf->readahead) {
+				/* The reader caught up with readahead, so look further ahead */
+				buf->readahead = false;
+				if (file->readahead_window != 0) {
+					file->readahead_window = spdk_min(2 * file->readahead_window,
+									  CACHE_READAHEAD_MAX_WINDOW);
+				}
+			}
+			if ((offset + read_len) % CACHE_BUFFER_SIZE == 0 &&
+			    file->seq_byte_count >= CACHE_READAHEAD_THRESHOLD) {
+				/* A sequential stream is done with this buffer */
+				if (buf == file->last) {
+					file->last = NULL;
 				}
+				tree_remove_buffer(file->tree, buf);
+			} else {
+				buf->referenced = true;
 			}
 		}
 
 		if (ret == 0) {
 			final_length += length;
 		} else {
-			arg.rwerrno = ret;
+			arg->rwerrno = ret;
 			break;
 		}
 		payload += length;
 		offset += length;
 	}
+
+	return final_length;
+}
+
+int64_t
+spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+	       void *payload, uint64_t offset, uint64_t length)
+{
+	struct spdk_fs_channel *channel = (struct spdk_fs_channel *)ctx;
+	uint64_t final_length;
+	uint32_t sub_reads = 0;
+	struct rw_from_file_arg arg = {};
+
+	pthread_spin_lock(&file->lock);
+
+	BLOBFS_TRACE_RW(file, "offset=%ju length=%ju\n", offset, length);
+
+	file->open_for_writing = false;
+
+	arg.channel = channel;
+	arg.rwerrno = 0;
+	final_length = __file_read(file, payload, offset, length, &arg, &sub_reads);
 	pthread_spin_unlock(&file->lock);
 	while (sub_reads > 0) {
 		sem_wait(&channel->sem);
@@ -2682,6 +2877,84 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 	}
 }
 
+int
+spdk_file_multi_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+		     struct spdk_file_read_req *reqs, uint32_t num_reqs)
+{
+	struct spdk_fs_channel *channel = (struct spdk_fs_channel *)ctx;
+	struct rw_from_file_arg *args;
+	uint32_t i, sub_reads = 0;
+	int rc = 0;
+
+	if (num_reqs == 0) {
+		return 0;
+	}
+
+	args = calloc(num_reqs, sizeof(*args));
+	if (args == NULL) {
+		for (i = 0; i < num_reqs; i++) {
+			reqs[i].result = -ENOMEM;
+		}
+		return -ENOMEM;
+	}
+
+	pthread_spin_lock(&file->lock);
+
+	file->open_for_writing = false;
+
+	/* Send all the reads that miss the cache before waiting for any of them */
+	for (i = 0; i < num_reqs; i++) {
+		BLOBFS_TRACE_RW(file, "offset=%ju length=%ju\n", reqs[i].offset, reqs[i].length);
+		args[i].channel = channel;
+		reqs[i].result = __file_read(file, reqs[i].payload, reqs[i].offset, reqs[i].length,
+					     &args[i], &sub_reads);
+	}
+	pthread_spin_unlock(&file->lock);
+
+	while (sub_reads > 0) {
+		sem_wait(&channel->sem);
+		sub_reads--;
+	}
+
+	for (i = 0; i < num_reqs; i++) {
+		if (args[i].rwerrno != 0) {
+			reqs[i].result = args[i].rwerrno;
+			if (rc == 0) {
+				rc = args[i].rwerrno;
+			}
+		}
+	}
+	free(args);
+
+	return rc;
+}
+
+int
+spdk_file_prefetch(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+		   uint64_t offset, uint64_t length)
+{
+	struct spdk_fs_channel *channel = (struct spdk_fs_channel *)ctx;
+	uint64_t buf_offset, end;
+	int rc = 0;
+
+	pthread_spin_lock(&file->lock);
+
+	BLOBFS_TRACE_RW(file, "offset=%ju length=%ju\n", offset, length);
+
+	end = spdk_min(offset + length, file->length);
+	for (buf_offset = offset & ~(CACHE_TREE_LEVEL_MASK(0)); buf_offset < end;
+	     buf_offset += CACHE_BUFFER_SIZE) {
+		rc = cache_fill_buffer(file, buf_offset, channel, false);
+		if (rc != 0) {
+			break;
+		}
+	}
+
+	pthread_spin_unlock(&file->lock);
+
+	return rc;
+}
+
 static void
 _file_sync(struct spdk_file *file, struct spdk_fs_channel *channel,
 	   spdk_file_op_complete cb_fn, void *cb_arg)
@@ -2890,35 +3163,24 @@ spdk_file_get_id(struct spdk_file *file, void *id, size_t size)
 	return sizeof(spdk_blob_id);
 }
 
-static void
-_file_free(void *ctx)
-{
-	struct spdk_file *file = ctx;
-
-	TAILQ_REMOVE(&g_caches, file, cache_tailq);
-
-	free(file->name);
-	free(file->tree);
-	free(file);
-}
-
 static void
 file_free(struct spdk_file *file)
 {
 	BLOBFS_TRACE(file, "free=%s\n", file->name);
 	pthread_spin_lock(&file->lock);
-	if (file->tree->present_mask == 0) {
-		pthread_spin_unlock(&file->lock);
-		free(file->name);
-		free(file->tree);
-		free(file);
-		return;
+	if (file->tree->present_mask != 0) {
+		/*
+		 * Unlinking the buffers from the clocks under the file lock makes sure
+		 *  the eviction is not looking at this file anymore.
+		 */
+		tree_free_buffers(file->tree);
+		assert(file->tree->present_mask == 0);
 	}
-
-	tree_free_buffers(file->tree);
-	assert(file->tree->present_mask == 0);
-	spdk_thread_send_msg(g_cache_pool_thread, _file_free, file);
 	pthread_spin_unlock(&file->lock);
+
+	free(file->name);
+	free(file->tree);
+	free(file);
 }
 
 SPDK_LOG_REGISTER_COMPONENT(blobfs)
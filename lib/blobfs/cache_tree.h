@@ -6,6 +6,11 @@
 #ifndef SPDK_TREE_H_
 #define SPDK_TREE_H_
 
+#include "spdk/queue.h"
+
+struct spdk_file;
+struct cache_shard;
+
 struct cache_buffer {
 	uint8_t			*buf;
 	uint64_t		offset;
@@ -13,6 +18,15 @@ struct cache_buffer {
 	uint32_t		bytes_filled;
 	uint32_t		bytes_flushed;
 	bool			in_progress;
+	/* Set on every hit, cleared by the eviction clock as it passes by. */
+	bool			referenced;
+	/* Filled by readahead and not read since. */
+	bool			readahead;
+	/* Linked into the clock of its shard. */
+	bool			on_clock;
+	struct spdk_file	*file;
+	struct cache_shard	*shard;
+	TAILQ_ENTRY(cache_buffer) clock_link;
 };
 
 #define CACHE_BUFFER_SHIFT (18)
@@ -469,14 +469,23 @@ is_band_relocateable(struct ftl_band *band)
 	return true;
 }
 
+struct band_phys_info {
+	uint64_t	phys_id;
+	double		invalidity;
+	double		wr_cnt;
+	/* Number of sequence IDs handed out since the bands were closed */
+	double		age;
+};
+
 static void
-get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id,
-		   double *invalidity, double *wr_cnt)
+get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id, struct band_phys_info *info)
 {
 	struct ftl_band *band;
 	uint64_t band_id = phys_id * dev->num_logical_bands_in_physical;
+	uint64_t seq_id = dev->sb->seq_id;
 
-	*wr_cnt = *invalidity = 0.0L;
+	info->phys_id = phys_id;
+	info->wr_cnt = info->invalidity = info->age = 0.0L;
 	for (; band_id < ftl_get_num_bands(dev); band_id++) {
 		band = &dev->bands[band_id];
 
@@ -484,27 +493,42 @@ get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id,
 			break;
 		}
 
-		*wr_cnt += band->md->wr_cnt;
+		info->wr_cnt += band->md->wr_cnt;
 
 		if (!is_band_relocateable(band)) {
 			continue;
 		}
 
-		*invalidity += _band_invalidity(band);
+		info->invalidity += _band_invalidity(band);
+		if (seq_id > band->md->close_seq_id) {
+			info->age += seq_id - band->md->close_seq_id;
+		}
+	}
+
+	info->invalidity /= dev->num_logical_bands_in_physical;
+	info->wr_cnt /= dev->num_logical_bands_in_physical;
+	info->age /= dev->num_logical_bands_in_physical;
+}
+
+/* Returns true when band a should be relocated before band b */
+typedef bool (*band_cmp_fn)(const struct band_phys_info *a, const struct band_phys_info *b);
+
+static bool
+band_cmp_wr_cnt(const struct band_phys_info *a, const struct band_phys_info *b)
+{
+	if (a->wr_cnt != b->wr_cnt) {
+		return a->wr_cnt < b->wr_cnt;
 	}
 
-	*invalidity /= dev->num_logical_bands_in_physical;
-	*wr_cnt /= dev->num_logical_bands_in_physical;
+	return a->phys_id < b->phys_id;
 }
 
 static bool
-band_cmp(double a_invalidity, double a_wr_cnt,
-	 double b_invalidity, double b_wr_cnt,
-	 uint64_t a_id, uint64_t b_id)
+band_cmp_greedy(const struct band_phys_info *a, const struct band_phys_info *b)
 {
-	assert(a_id != FTL_BAND_PHYS_ID_INVALID);
-	assert(b_id != FTL_BAND_PHYS_ID_INVALID);
-	double diff = a_invalidity - b_invalidity;
+	assert(a->phys_id != FTL_BAND_PHYS_ID_INVALID);
+	assert(b->phys_id != FTL_BAND_PHYS_ID_INVALID);
+	double diff = a->invalidity - b->invalidity;
 	if (diff < 0.0L) {
 		diff *= -1.0L;
 	}
@@ -515,16 +539,45 @@ band_cmp(double a_invalidity, double a_wr_cnt,
 	 * - if write count is equal, then pick based on their placement on base device (lower LBAs win)
 	 */
 	if (diff > 0.1L) {
-		return a_invalidity > b_invalidity;
+		return a->invalidity > b->invalidity;
+	}
+
+	return band_cmp_wr_cnt(a, b);
+}
+
+static double
+band_cost_benefit(const struct band_phys_info *info)
+{
+	/* Relocating a band without valid blocks costs nothing */
+	if (info->invalidity >= 1.0L) {
+		return HUGE_VAL;
 	}
 
-	if (a_wr_cnt != b_wr_cnt) {
-		return a_wr_cnt < b_wr_cnt;
+	return info->age * info->invalidity / (1.0L - info->invalidity);
+}
+
+static bool
+band_cmp_cost_benefit(const struct band_phys_info *a, const struct band_phys_info *b)
+{
+	double a_score, b_score;
+
+	assert(a->phys_id != FTL_BAND_PHYS_ID_INVALID);
+	assert(b->phys_id != FTL_BAND_PHYS_ID_INVALID);
+
+	a_score = band_cost_benefit(a);
+	b_score = band_cost_benefit(b);
+	if (a_score != b_score) {
+		return a_score > b_score;
 	}
 
-	return a_id < b_id;
+	return band_cmp_wr_cnt(a, b);
 }
 
+static const band_cmp_fn g_band_cmp[SPDK_FTL_GC_POLICY_MAX] = {
+	[SPDK_FTL_GC_POLICY_GREEDY]		= band_cmp_greedy,
+	[SPDK_FTL_GC_POLICY_COST_BENEFIT]	= band_cmp_cost_benefit,
+};
+
 static void
 band_start_gc(struct spdk_ftl_dev *dev, struct ftl_band *band)
 {
@@ -533,6 +586,9 @@ band_start_gc(struct spdk_ftl_dev *dev, struct ftl_band *band)
 	TAILQ_REMOVE(&dev->shut_bands, band, queue_entry);
 	band->reloc = true;
 
+	dev->stats.gc.bands++;
+	dev->stats.gc.valid_blocks += band->p2l_map.num_valid;
+
 	FTL_DEBUGLOG(dev, "Band to GC, id %u\n", band->id);
 }
 
@@ -570,9 +626,8 @@ ftl_band_reset_gc_iter(struct spdk_ftl_dev *dev)
 struct ftl_band *
 ftl_band_search_next_to_reloc(struct spdk_ftl_dev *dev)
 {
-	double invalidity, max_invalidity = 0.0L;
-	double wr_cnt, max_wr_cnt = 0.0L;
-	uint64_t phys_id = FTL_BAND_PHYS_ID_INVALID;
+	struct band_phys_info info, max_info = { .phys_id = FTL_BAND_PHYS_ID_INVALID };
+	band_cmp_fn band_cmp = g_band_cmp[dev->conf.gc_policy];
 	struct ftl_band *band;
 	uint64_t i, band_count;
 	uint64_t phys_count;
@@ -604,24 +659,20 @@ ftl_band_search_next_to_reloc(struct spdk_ftl_dev *dev)
 		band = &dev->bands[i];
 
 		/* Calculate entire band physical group invalidity */
-		get_band_phys_info(dev, band->phys_id, &invalidity, &wr_cnt);
-
-		if (invalidity != 0.0L) {
-			if (phys_id == FTL_BAND_PHYS_ID_INVALID ||
-			    band_cmp(invalidity, wr_cnt, max_invalidity, max_wr_cnt,
-				     band->phys_id, phys_id)) {
-				max_invalidity = invalidity;
-				max_wr_cnt = wr_cnt;
-				phys_id = band->phys_id;
+		get_band_phys_info(dev, band->phys_id, &info);
+
+		if (info.invalidity != 0.0L) {
+			if (max_info.phys_id == FTL_BAND_PHYS_ID_INVALID || band_cmp(&info, &max_info)) {
+				max_info = info;
 			}
 		}
 	}
 
-	if (FTL_BAND_PHYS_ID_INVALID != phys_id) {
-		FTL_DEBUGLOG(dev, "Band physical id %"PRIu64" to GC\n", phys_id);
+	if (FTL_BAND_PHYS_ID_INVALID != max_info.phys_id) {
+		FTL_DEBUGLOG(dev, "Band physical id %"PRIu64" to GC\n", max_info.phys_id);
 		dev->sb_shm->gc_info.is_valid = 0;
-		dev->sb_shm->gc_info.current_band_id = phys_id * phys_count;
-		dev->sb_shm->gc_info.band_phys_id = phys_id;
+		dev->sb_shm->gc_info.current_band_id = max_info.phys_id * phys_count;
+		dev->sb_shm->gc_info.band_phys_id = max_info.phys_id;
 		dev->sb_shm->gc_info.is_valid = 1;
 		dump_bands_under_relocation(dev);
 		return ftl_band_search_next_to_reloc(dev);
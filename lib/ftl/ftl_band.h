@@ -149,6 +149,12 @@ struct ftl_band {
 	/* For writing metadata */
 	struct ftl_md_io_entry_ctx	md_persist_entry_ctx;
 
+	/* For resetting the band's zone on zoned base devices */
+	struct spdk_bdev_io_wait_entry	zone_reset_wait;
+
+	/* Tail md found already written to the band's zone during recovery */
+	bool				zone_tail_md_written;
+
 	/* Callback function for validate md */
 	ftl_band_validate_md_cb		validate_cb;
 };
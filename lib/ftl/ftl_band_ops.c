@@ -22,6 +22,14 @@ write_rq_end(struct spdk_bdev_io *bdev_io, bool success, void *arg)
 
 	rq->success = success;
 
+	/*
+	 * On zoned devices the data lands wherever the zone's write pointer was when the append got
+	 * processed, the P2L and L2P need to be updated with the actual location.
+	 */
+	if (dev->is_zoned && spdk_likely(success)) {
+		rq->io.addr = spdk_bdev_io_get_append_location(bdev_io);
+	}
+
 	ftl_p2l_ckpt_issue(rq);
 
 	spdk_bdev_free_io(bdev_io);
@@ -35,10 +43,21 @@ ftl_band_rq_bdev_write(void *_rq)
 	struct spdk_ftl_dev *dev = band->dev;
 	int rc;
 
-	rc = spdk_bdev_writev_blocks(dev->base_bdev_desc, dev->base_ioch,
-				     rq->io_vec, rq->io_vec_size,
-				     rq->io.addr, rq->num_blocks,
-				     write_rq_end, rq);
+	if (dev->is_zoned) {
+		/*
+		 * Appends don't need to be serialized on the zone's write pointer, so any number of
+		 * them can be in flight to the same band
+		 */
+		rc = spdk_bdev_zone_appendv(dev->base_bdev_desc, dev->base_ioch,
+					    rq->io_vec, rq->io_vec_size,
+					    band->start_addr, rq->num_blocks,
+					    write_rq_end, rq);
+	} else {
+		rc = spdk_bdev_writev_blocks(dev->base_bdev_desc, dev->base_ioch,
+					     rq->io_vec, rq->io_vec_size,
+					     rq->io.addr, rq->num_blocks,
+					     write_rq_end, rq);
+	}
 
 	if (spdk_unlikely(rc)) {
 		if (rc == -ENOMEM) {
@@ -161,6 +180,10 @@ write_brq_end(struct spdk_bdev_io *bdev_io, bool success, void *arg)
 	spdk_bdev_free_io(bdev_io);
 }
 
+/*
+ * On zoned devices the tail md is the last write to the band's zone and it's only issued once
+ * all the data appends completed, so a regular write lands exactly at the zone's write pointer.
+ */
 static void
 ftl_band_brq_bdev_write(void *_brq)
 {
@@ -275,21 +298,71 @@ band_open_cb(int status, void *cb_arg)
 	ftl_band_set_state(band, FTL_BAND_STATE_OPEN);
 }
 
-void
-ftl_band_open(struct ftl_band *band, enum ftl_band_type type)
+static void
+band_open_persist_md(struct ftl_band *band)
 {
 	struct spdk_ftl_dev *dev = band->dev;
 	struct ftl_md *md = dev->layout.md[FTL_LAYOUT_REGION_TYPE_BAND_MD];
 	struct ftl_layout_region *region = &dev->layout.region[FTL_LAYOUT_REGION_TYPE_BAND_MD];
 	struct ftl_p2l_map *p2l_map = &band->p2l_map;
 
-	ftl_band_set_type(band, type);
-	ftl_band_set_state(band, FTL_BAND_STATE_OPENING);
-
 	memcpy(p2l_map->band_dma_md, band->md, region->entry_size * FTL_BLOCK_SIZE);
 	p2l_map->band_dma_md->state = FTL_BAND_STATE_OPEN;
 	p2l_map->band_dma_md->p2l_map_checksum = 0;
 
+	ftl_md_persist_entry(md, band->id, p2l_map->band_dma_md, NULL,
+			     band_open_cb, band, &band->md_persist_entry_ctx);
+}
+
+static void ftl_band_zone_reset(void *_band);
+
+static void
+zone_reset_end(struct spdk_bdev_io *bdev_io, bool success, void *arg)
+{
+	struct ftl_band *band = arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (spdk_unlikely(!success)) {
+#ifdef SPDK_FTL_RETRY_ON_ERROR
+		ftl_band_zone_reset(band);
+		return;
+#else
+		ftl_abort();
+#endif
+	}
+
+	band_open_persist_md(band);
+}
+
+static void
+ftl_band_zone_reset(void *_band)
+{
+	struct ftl_band *band = _band;
+	struct spdk_ftl_dev *dev = band->dev;
+	int rc;
+
+	rc = spdk_bdev_zone_management(dev->base_bdev_desc, dev->base_ioch, band->start_addr,
+				       SPDK_BDEV_ZONE_RESET, zone_reset_end, band);
+	if (spdk_unlikely(rc)) {
+		if (rc == -ENOMEM) {
+			struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(dev->base_bdev_desc);
+			band->zone_reset_wait.bdev = bdev;
+			band->zone_reset_wait.cb_fn = ftl_band_zone_reset;
+			band->zone_reset_wait.cb_arg = band;
+			spdk_bdev_queue_io_wait(bdev, dev->base_ioch, &band->zone_reset_wait);
+		} else {
+			ftl_abort();
+		}
+	}
+}
+
+void
+ftl_band_open(struct ftl_band *band, enum ftl_band_type type)
+{
+	ftl_band_set_type(band, type);
+	ftl_band_set_state(band, FTL_BAND_STATE_OPENING);
+
 	if (spdk_unlikely(0 != band->p2l_map.num_valid)) {
 		/*
 		 * This is inconsistent state, a band with valid block,
@@ -299,8 +372,16 @@ ftl_band_open(struct ftl_band *band, enum ftl_band_type type)
 		ftl_abort();
 	}
 
-	ftl_md_persist_entry(md, band->id, p2l_map->band_dma_md, NULL,
-			     band_open_cb, band, &band->md_persist_entry_ctx);
+	if (band->dev->is_zoned) {
+		/*
+		 * Zone reset takes the place of trim - the zone is rewound right before the band
+		 * gets reused. Doing it on open (instead of on free) also covers zones of bands
+		 * which were freed, but not reset before a dirty shutdown.
+		 */
+		ftl_band_zone_reset(band);
+	} else {
+		band_open_persist_md(band);
+	}
 }
 
 static void
@@ -322,25 +403,34 @@ band_close_cb(int status, void *cb_arg)
 }
 
 static void
-band_map_write_cb(struct ftl_basic_rq *brq)
+band_close_persist_md(struct ftl_band *band, uint32_t band_map_crc)
 {
-	struct ftl_band *band = brq->io.band;
 	struct ftl_p2l_map *p2l_map = &band->p2l_map;
 	struct spdk_ftl_dev *dev = band->dev;
 	struct ftl_layout_region *region = &dev->layout.region[FTL_LAYOUT_REGION_TYPE_BAND_MD];
 	struct ftl_md *md = dev->layout.md[FTL_LAYOUT_REGION_TYPE_BAND_MD];
+
+	memcpy(p2l_map->band_dma_md, band->md, region->entry_size * FTL_BLOCK_SIZE);
+	p2l_map->band_dma_md->state = FTL_BAND_STATE_CLOSED;
+	p2l_map->band_dma_md->p2l_map_checksum = band_map_crc;
+
+	ftl_md_persist_entry(md, band->id, p2l_map->band_dma_md, NULL,
+			     band_close_cb, band, &band->md_persist_entry_ctx);
+}
+
+static void
+band_map_write_cb(struct ftl_basic_rq *brq)
+{
+	struct ftl_band *band = brq->io.band;
+	struct ftl_p2l_map *p2l_map = &band->p2l_map;
+	struct spdk_ftl_dev *dev = band->dev;
 	uint32_t band_map_crc;
 
 	if (spdk_likely(brq->success)) {
 
 		band_map_crc = spdk_crc32c_update(p2l_map->band_map,
 						  ftl_tail_md_num_blocks(dev) * FTL_BLOCK_SIZE, 0);
-		memcpy(p2l_map->band_dma_md, band->md, region->entry_size * FTL_BLOCK_SIZE);
-		p2l_map->band_dma_md->state = FTL_BAND_STATE_CLOSED;
-		p2l_map->band_dma_md->p2l_map_checksum = band_map_crc;
-
-		ftl_md_persist_entry(md, band->id, p2l_map->band_dma_md, NULL,
-				     band_close_cb, band, &band->md_persist_entry_ctx);
+		band_close_persist_md(band, band_map_crc);
 	} else {
 #ifdef SPDK_FTL_RETRY_ON_ERROR
 		/* Try to retry in case of failure */
@@ -365,6 +455,16 @@ ftl_band_close(struct ftl_band *band)
 	ftl_basic_rq_init(dev, &band->metadata_rq, metadata, num_blocks);
 	ftl_basic_rq_set_owner(&band->metadata_rq, band_map_write_cb, band);
 
+	if (spdk_unlikely(band->zone_tail_md_written)) {
+		/*
+		 * The zone is full already and can't be written again, only update the band md. The
+		 * checksum was calculated by recovery from the P2L map as it's stored on the zone.
+		 */
+		band->zone_tail_md_written = false;
+		band_close_persist_md(band, band->md->p2l_map_checksum);
+		return;
+	}
+
 	ftl_band_basic_rq_write(band, &band->metadata_rq);
 }
 
@@ -244,6 +244,15 @@ ftl_submit_read(struct ftl_io *io)
 
 		assert(num_blocks > 0);
 
+		/* Copy recently written blocks from DRAM instead of reading the cache device */
+		if (ftl_addr_in_nvc(dev, addr)) {
+			rc = ftl_nv_cache_read_wr_cache(io, addr, num_blocks);
+			if (rc) {
+				ftl_io_advance(io, rc);
+				continue;
+			}
+		}
+
 		ftl_trace_submission(dev, io, addr, num_blocks);
 
 		if (ftl_addr_in_nvc(dev, addr)) {
@@ -630,6 +639,22 @@ ftl_process_unmap(struct ftl_io *io)
 	return true;
 }
 
+static void
+ftl_stats_user_write_stall(struct spdk_ftl_dev *dev, bool stalled)
+{
+	if (stalled == (dev->wr_stall_tsc != 0)) {
+		return;
+	}
+
+	if (stalled) {
+		dev->wr_stall_tsc = spdk_get_ticks();
+	} else {
+		ftl_stats_stage_completed(dev, FTL_STATS_STAGE_USER_WRITE_STALL,
+					  dev->wr_stall_tsc, 0);
+		dev->wr_stall_tsc = 0;
+	}
+}
+
 static void
 ftl_process_io_queue(struct spdk_ftl_dev *dev)
 {
@@ -656,6 +681,9 @@ ftl_process_io_queue(struct spdk_ftl_dev *dev)
 		}
 	}
 
+	/* Writes left in the queue are held back by the throttling or lack of NV cache space */
+	ftl_stats_user_write_stall(dev, !TAILQ_EMPTY(&dev->wr_sq));
+
 	if (!TAILQ_EMPTY(&dev->unmap_sq) && dev->unmap_qd == 0) {
 		io = TAILQ_FIRST(&dev->unmap_sq);
 		TAILQ_REMOVE(&dev->unmap_sq, io, queue_entry);
@@ -768,6 +796,7 @@ ftl_stats_bdev_io_completed(struct spdk_ftl_dev *dev, enum ftl_stats_type type,
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_ZONE_APPEND:
 		stats_group = &stats_entry->write;
 		break;
 	default:
@@ -802,6 +831,27 @@ ftl_stats_crc_error(struct spdk_ftl_dev *dev, enum ftl_stats_type type)
 	stats_group->errors.crc++;
 }
 
+void
+ftl_stats_stage_completed(struct spdk_ftl_dev *dev, enum ftl_stats_stage stage,
+			  uint64_t start_tsc, uint64_t num_blocks)
+{
+	struct ftl_stats_latency *latency = &dev->stats.latency[stage];
+	uint64_t us = (spdk_get_ticks() - start_tsc) * SPDK_SEC_TO_USEC / spdk_get_ticks_hz();
+	uint32_t bucket = 0;
+
+	if (us) {
+		bucket = spdk_min(spdk_u64log2(us) + 1, FTL_STATS_LATENCY_BUCKETS - 1);
+	}
+
+	latency->count++;
+	latency->blocks += num_blocks;
+	latency->total_us += us;
+	latency->max_us = spdk_max(latency->max_us, us);
+	latency->buckets[bucket]++;
+
+	ftl_trace_stage(dev, stage, us, num_blocks);
+}
+
 struct ftl_get_stats_ctx {
 	struct spdk_ftl_dev *dev;
 	struct ftl_stats *stats;
@@ -813,8 +863,16 @@ static void
 _ftl_get_stats(void *_ctx)
 {
 	struct ftl_get_stats_ctx *stats_ctx = _ctx;
+	struct ftl_nv_cache *nv_cache = &stats_ctx->dev->nv_cache;
+	struct ftl_stats *stats = stats_ctx->stats;
+
+	*stats = stats_ctx->dev->stats;
 
-	*stats_ctx->stats = stats_ctx->dev->stats;
+	stats->nv_cache.chunks_total = nv_cache->chunk_count;
+	stats->nv_cache.chunks_free = nv_cache->chunk_free_count;
+	stats->nv_cache.chunks_open = nv_cache->chunk_open_count;
+	stats->nv_cache.chunks_full = nv_cache->chunk_full_count;
+	stats->nv_cache.chunks_compacting = nv_cache->chunk_comp_count;
 
 	stats_ctx->cb_fn(stats_ctx->stats, stats_ctx->cb_arg);
 	free(stats_ctx);
@@ -158,6 +158,9 @@ struct spdk_ftl_dev {
 	/* Write submission queue */
 	TAILQ_HEAD(, ftl_io)		wr_sq;
 
+	/* Time since which the head of the write submission queue is held back (0 if it isn't) */
+	uint64_t			wr_stall_tsc;
+
 	/* Trim submission queue */
 	TAILQ_HEAD(, ftl_io)		unmap_sq;
 
@@ -211,6 +214,17 @@ void ftl_stats_bdev_io_completed(struct spdk_ftl_dev *dev, enum ftl_stats_type t
 
 void ftl_stats_crc_error(struct spdk_ftl_dev *dev, enum ftl_stats_type type);
 
+/**
+ * @brief Accounts completion of an FTL stage operation in the latency statistics
+ *
+ * @param dev FTL device
+ * @param stage The stage
+ * @param start_tsc Time (in ticks) at which the operation started
+ * @param num_blocks Number of blocks processed by the operation
+ */
+void ftl_stats_stage_completed(struct spdk_ftl_dev *dev, enum ftl_stats_stage stage,
+			       uint64_t start_tsc, uint64_t num_blocks);
+
 int ftl_unmap(struct spdk_ftl_dev *dev, struct ftl_io *io, struct spdk_io_channel *ch,
 	      uint64_t lba, size_t lba_cnt, spdk_ftl_fn cb_fn, void *cb_arg);
 
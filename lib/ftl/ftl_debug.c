@@ -214,6 +214,13 @@ ftl_dev_dump_stats(const struct spdk_ftl_dev *dev)
 	FTL_NOTICELOG(dev, "total writes:        %"PRIu64"\n", write_total);
 	FTL_NOTICELOG(dev, "user writes:         %"PRIu64"\n", write_user);
 	FTL_NOTICELOG(dev, "WAF:                 %.4lf\n", waf);
+	FTL_NOTICELOG(dev, "GC bands:            %"PRIu64"\n", dev->stats.gc.bands);
+	FTL_NOTICELOG(dev, "L2P cache hits:      %"PRIu64"\n", dev->stats.l2p_cache.hits);
+	FTL_NOTICELOG(dev, "L2P cache misses:    %"PRIu64"\n", dev->stats.l2p_cache.misses);
+	FTL_NOTICELOG(dev, "write cache hits:    %"PRIu64"\n", dev->stats.wr_cache.hits);
+	FTL_NOTICELOG(dev, "write cache misses:  %"PRIu64"\n", dev->stats.wr_cache.misses);
+	FTL_NOTICELOG(dev, "user write stalls:   %"PRIu64"\n",
+		      dev->stats.latency[FTL_STATS_STAGE_USER_WRITE_STALL].count);
 #ifdef DEBUG
 	FTL_NOTICELOG(dev, "limits:\n");
 	for (i = 0; i < SPDK_FTL_LIMIT_MAX; ++i) {
@@ -147,6 +147,8 @@ int ftl_mngt_p2l_ckpt_restore(struct ftl_band *band, uint32_t md_region, uint64_
 
 int ftl_mngt_p2l_ckpt_restore_clean(struct ftl_band *band);
 
+void ftl_mngt_p2l_ckpt_restore_zone_wp(struct ftl_band *band, uint64_t num_blocks);
+
 void ftl_mngt_p2l_ckpt_restore_shm_clean(struct ftl_band *band);
 
 void ftl_mngt_persist_bands_p2l(struct ftl_mngt_process *mngt);
@@ -116,6 +116,9 @@ struct ftl_io {
 	/* Trace group id */
 	uint64_t			trace;
 
+	/* Start time (in ticks) of the NV cache write, for the latency statistics */
+	uint64_t			stage_tsc;
+
 	/* Used by retry and write completion queues */
 	TAILQ_ENTRY(ftl_io)		queue_entry;
 
@@ -205,6 +208,9 @@ struct ftl_rq {
 	/* Request result status */
 	bool success;
 
+	/* Time (in ticks) at which the request started being filled, for the latency statistics */
+	uint64_t stage_tsc;
+
 	/* Fields for owner of this request */
 	struct {
 		/* End request callback */
@@ -17,6 +17,7 @@
 #include "ftl_l2p_cache.h"
 #include "ftl_layout.h"
 #include "ftl_nv_cache_io.h"
+#include "mngt/ftl_mngt.h"
 #include "mngt/ftl_mngt_steps.h"
 #include "utils/ftl_defs.h"
 #include "utils/ftl_addr_utils.h"
@@ -49,6 +50,7 @@ struct ftl_l2p_page {
 	void *page_buffer;
 	uint64_t ckpt_seq_id;
 	ftl_df_obj_id obj_id;
+	uint64_t page_in_tsc; /* Time the page read was issued, for the latency statistics */
 };
 
 struct ftl_l2p_page_set;
@@ -84,6 +86,41 @@ struct ftl_l2p_l1_map_entry {
 	ftl_df_obj_id page_obj_id;
 };
 
+/*
+ * Read-ahead of L2P pages. Two consecutive page misses start a sequential stream, for which the
+ * following pages are paged in ahead of use, FTL_L2P_CACHE_READAHEAD_MIN at first, doubling up to
+ * FTL_L2P_CACHE_READAHEAD_MAX with each window. The next window is issued when the middle page of
+ * the current one gets pinned. Runs of missing pages are read with a single IO.
+ */
+#define FTL_L2P_CACHE_READAHEAD_MIN	4
+#define FTL_L2P_CACHE_READAHEAD_MAX	32
+#define FTL_L2P_CACHE_READAHEAD_QD	4
+
+struct ftl_l2p_cache_readahead_io {
+	struct ftl_l2p_cache *cache;
+	uint32_t num_pages;
+	struct ftl_l2p_page *pages[FTL_L2P_CACHE_READAHEAD_MAX];
+	struct iovec iov[FTL_L2P_CACHE_READAHEAD_MAX];
+	TAILQ_ENTRY(ftl_l2p_cache_readahead_io) entry;
+};
+
+/*
+ * Incremental L2P checkpoint. Every page dirty at the start of a checkpoint is written to the L2P
+ * region in the background (staying in the cache) and then the sequence ID from before the start
+ * is recorded in the superblock. Dirty shutdown recovery begins with the checkpointed L2P and
+ * only replays chunks and bands closed after it, and a clean shutdown has fewer pages to flush.
+ * A checkpoint is started when the number of sequence IDs allocated since the previous one reaches
+ * the number of NV cache chunks.
+ */
+#define FTL_L2P_CACHE_CKPT_QD		8
+#define FTL_L2P_CACHE_CKPT_SCAN		1024
+
+enum ftl_l2p_cache_ckpt_state {
+	L2P_CACHE_CKPT_IDLE,
+	L2P_CACHE_CKPT_SCAN,		/* Dirty pages are being persisted */
+	L2P_CACHE_CKPT_RECORD,		/* Superblock is being persisted */
+};
+
 enum ftl_l2p_cache_state {
 	L2P_CACHE_INIT,
 	L2P_CACHE_RUNNING,
@@ -132,6 +169,34 @@ struct ftl_l2p_cache {
 		struct ftl_l2p_pin_ctx pin_ctx;
 	} lazy_unmap;
 
+	/* Sequential access detection and read-ahead */
+	struct {
+		/* Last page paged in on demand */
+		uint64_t last_page_no;
+		/* Pinning this page issues the next window */
+		uint64_t trigger_page_no;
+		/* First page after the current window */
+		uint64_t next_page_no;
+		/* Size of the next window in pages */
+		uint32_t window;
+		TAILQ_HEAD(, ftl_l2p_cache_readahead_io) free_list;
+		struct ftl_l2p_cache_readahead_io io[FTL_L2P_CACHE_READAHEAD_QD];
+	} readahead;
+
+	/* Incremental L2P checkpoint */
+	struct {
+		enum ftl_l2p_cache_ckpt_state state;
+		/* Superblock sequence ID when the last checkpoint was started */
+		uint64_t last_seq_id;
+		/* Sequence ID recorded once the checkpoint completes */
+		uint64_t seq_id;
+		/* Next page to check */
+		uint64_t page_no;
+		/* Page writes in progress */
+		uint32_t qd;
+		int status;
+	} ckpt;
+
 	/* This is a context for a management process */
 	struct ftl_l2p_cache_process_ctx mctx;
 
@@ -155,6 +220,8 @@ static void page_set_end(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 			 struct ftl_l2p_page_set *page_set);
 static void page_out_io_retry(void *arg);
 static void page_in_io_retry(void *arg);
+static void readahead_issue(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
+			    uint64_t page_no);
 
 static inline void
 ftl_l2p_page_queue_wait_ctx(struct ftl_l2p_page *page,
@@ -347,8 +414,12 @@ static inline void
 ftl_l2p_cache_page_unpin(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
 {
 	page->pin_ref_cnt--;
-	if (!page->pin_ref_cnt && !page->on_lru_list && page->state != L2P_CACHE_PAGE_FLUSHING) {
-		/* L2P_CACHE_PAGE_FLUSHING: the page is currently being evicted.
+	if (!page->pin_ref_cnt && !page->on_lru_list && page->state != L2P_CACHE_PAGE_FLUSHING &&
+	    page->state != L2P_CACHE_PAGE_PERSISTING) {
+		/* L2P_CACHE_PAGE_PERSISTING: the page is being checkpointed, it's returned to
+		 * the rank list when the write completes - see ckpt_page_out_cb().
+		 *
+		 * L2P_CACHE_PAGE_FLUSHING: the page is currently being evicted.
 		 * In such a case, the page can't be returned to the rank list, because
 		 * the ongoing eviction will remove it if no pg updates had happened.
 		 * Moreover, the page could make it to the top of the rank list and be
@@ -383,6 +454,7 @@ _ftl_l2p_cache_init(struct spdk_ftl_dev *dev, size_t addr_size, uint64_t l2p_siz
 	struct ftl_l2p_cache *cache;
 	uint64_t l2_pages = spdk_divide_round_up(l2p_size, ftl_l2p_cache_get_l1_page_size());
 	size_t l2_size = l2_pages * sizeof(struct ftl_l2p_l1_map_entry);
+	int i;
 
 	cache = calloc(1, sizeof(struct ftl_l2p_cache));
 	if (cache == NULL) {
@@ -403,6 +475,15 @@ _ftl_l2p_cache_init(struct spdk_ftl_dev *dev, size_t addr_size, uint64_t l2p_siz
 	cache->lbas_in_page = dev->layout.l2p.lbas_in_page;
 	cache->num_pages = l2_pages;
 
+	cache->readahead.last_page_no = UINT64_MAX;
+	cache->readahead.trigger_page_no = UINT64_MAX;
+	cache->readahead.window = FTL_L2P_CACHE_READAHEAD_MIN;
+	TAILQ_INIT(&cache->readahead.free_list);
+	for (i = 0; i < FTL_L2P_CACHE_READAHEAD_QD; i++) {
+		cache->readahead.io[i].cache = cache;
+		TAILQ_INSERT_TAIL(&cache->readahead.free_list, &cache->readahead.io[i], entry);
+	}
+
 	return cache;
 fail_l2_md:
 	free(cache);
@@ -504,6 +585,8 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 	cache->cache_layout_bdev_desc = reg->bdev_desc;
 	cache->cache_layout_ioch = reg->ioch;
 
+	cache->ckpt.last_seq_id = dev->sb->ckpt_seq_id;
+
 	cache->state = L2P_CACHE_RUNNING;
 	return 0;
 }
@@ -1029,6 +1112,7 @@ ftl_l2p_cache_pin(struct spdk_ftl_dev *dev, struct ftl_l2p_pin_ctx *pin_ctx)
 		/* Try get page and pin */
 		page = get_l2p_page_by_df_id(cache, i);
 		if (page) {
+			dev->stats.l2p_cache.hits++;
 			if (ftl_l2p_cache_page_is_pinnable(page)) {
 				/* Page available and we can pin it */
 				page_set->pinned_cnt++;
@@ -1043,10 +1127,18 @@ ftl_l2p_cache_pin(struct spdk_ftl_dev *dev, struct ftl_l2p_pin_ctx *pin_ctx)
 			}
 		} else {
 			/* The page is not in the cache, queue the page_set to page in */
+			dev->stats.l2p_cache.misses++;
 			defer_pin = true;
 		}
 	}
 
+	/* Sequential stream reached the middle of the read-ahead window, issue the next one */
+	if (spdk_unlikely(cache->readahead.trigger_page_no >= start &&
+			  cache->readahead.trigger_page_no <= end)) {
+		cache->readahead.trigger_page_no = UINT64_MAX;
+		readahead_issue(dev, cache, cache->readahead.next_page_no);
+	}
+
 	/* Check if page set is done */
 	if (page_set_is_done(page_set)) {
 		page_set_end(dev, cache, page_set);
@@ -1126,6 +1218,7 @@ page_allocate(struct ftl_l2p_cache *cache, uint64_t page_no)
 {
 	struct ftl_l2p_page *page = ftl_l2p_cache_page_alloc(cache, page_no);
 	ftl_l2p_cache_page_insert(cache, page);
+	page->page_in_tsc = spdk_get_ticks();
 
 	return page;
 }
@@ -1187,14 +1280,13 @@ page_in_io_complete(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	struct ftl_l2p_page_set *page_set;
 	struct ftl_l2p_page_wait_ctx *pentry;
 
-	cache->ios_in_flight--;
-
 	assert(0 == page->pin_ref_cnt);
 	assert(L2P_CACHE_PAGE_INIT == page->state);
 	assert(false == page->on_lru_list);
 
 	if (spdk_likely(success)) {
 		page->state = L2P_CACHE_PAGE_READY;
+		ftl_stats_stage_completed(dev, FTL_STATS_STAGE_L2P_PAGE_IN, page->page_in_tsc, 1);
 	}
 
 	while ((pentry = TAILQ_FIRST(&page->ppe_list))) {
@@ -1221,6 +1313,9 @@ page_in_io_complete(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	if (spdk_unlikely(!success)) {
 		ftl_bug(page->on_lru_list);
 		ftl_l2p_cache_page_remove(cache, page);
+	} else if (!page->pin_ref_cnt && !page->on_lru_list) {
+		/* Page read ahead, not used yet */
+		ftl_l2p_cache_lru_add_page(cache, page);
 	}
 }
 
@@ -1233,6 +1328,7 @@ page_in_io_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 
 	ftl_stats_bdev_io_completed(dev, FTL_STATS_TYPE_L2P, bdev_io);
 	spdk_bdev_free_io(bdev_io);
+	cache->ios_in_flight--;
 	page_in_io_complete(dev, cache, page, success);
 }
 
@@ -1280,6 +1376,130 @@ page_in_io_retry(void *arg)
 	page_in_io(dev, cache, page);
 }
 
+static void
+readahead_io_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ftl_l2p_cache_readahead_io *io = cb_arg;
+	struct ftl_l2p_cache *cache = io->cache;
+	struct spdk_ftl_dev *dev = cache->dev;
+	uint32_t i;
+
+	ftl_stats_bdev_io_completed(dev, FTL_STATS_TYPE_L2P, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+	cache->ios_in_flight--;
+
+	for (i = 0; i < io->num_pages; i++) {
+		page_in_io_complete(dev, cache, io->pages[i], success);
+	}
+
+	TAILQ_INSERT_TAIL(&cache->readahead.free_list, io, entry);
+}
+
+static bool
+readahead_io(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
+	     struct ftl_l2p_cache_readahead_io *io, uint64_t page_no, uint32_t num_pages)
+{
+	struct ftl_l2p_page *page;
+	uint32_t i;
+	int rc;
+
+	assert(num_pages <= FTL_L2P_CACHE_READAHEAD_MAX);
+
+	for (i = 0; i < num_pages; i++) {
+		page = page_allocate(cache, page_no + i);
+		io->pages[i] = page;
+		io->iov[i].iov_base = page->page_buffer;
+		io->iov[i].iov_len = FTL_BLOCK_SIZE;
+	}
+	io->num_pages = num_pages;
+
+	rc = ftl_nv_cache_bdev_readv_blocks_with_md(dev, ftl_l2p_cache_get_bdev_desc(cache),
+			ftl_l2p_cache_get_bdev_iochannel(cache),
+			io->iov, num_pages, NULL, ftl_l2p_cache_page_get_bdev_offset(cache, io->pages[0]),
+			num_pages, readahead_io_cb, io);
+	if (spdk_unlikely(rc)) {
+		/* Read-ahead is optional, just drop the pages */
+		for (i = 0; i < num_pages; i++) {
+			ftl_l2p_cache_page_remove(cache, io->pages[i]);
+		}
+		return false;
+	}
+
+	TAILQ_REMOVE(&cache->readahead.free_list, io, entry);
+	cache->ios_in_flight++;
+	return true;
+}
+
+static void
+readahead_issue(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache, uint64_t page_no)
+{
+	struct ftl_l2p_cache_readahead_io *io;
+	uint64_t start = page_no, end, run_end;
+	uint64_t reserve, budget;
+
+	/* Leave enough pages for the demand page-ins */
+	reserve = spdk_max(cache->evict_keep / 2, L2P_MAX_PAGES_TO_PIN);
+	if (cache->l2_pgs_avail <= reserve || cache->ios_in_flight > 512) {
+		return;
+	}
+	budget = cache->l2_pgs_avail - reserve;
+
+	end = spdk_min(page_no + cache->readahead.window, cache->num_pages);
+	while (page_no < end && budget) {
+		if (get_l2p_page_by_df_id(cache, page_no)) {
+			/* Already resident or being paged in */
+			page_no++;
+			continue;
+		}
+
+		io = TAILQ_FIRST(&cache->readahead.free_list);
+		if (!io) {
+			break;
+		}
+
+		/* Read the run of missing pages at once */
+		run_end = page_no + 1;
+		while (run_end < end && run_end - page_no < budget &&
+		       !get_l2p_page_by_df_id(cache, run_end)) {
+			run_end++;
+		}
+
+		if (!readahead_io(dev, cache, io, page_no, run_end - page_no)) {
+			break;
+		}
+
+		budget -= run_end - page_no;
+		page_no = run_end;
+	}
+
+	if (page_no == start) {
+		return;
+	}
+
+	/* Continue the stream from the end of the window, whether by a pin of its middle page or a miss */
+	cache->readahead.last_page_no = page_no - 1;
+	cache->readahead.next_page_no = page_no;
+	cache->readahead.trigger_page_no = start + (page_no - start) / 2;
+	cache->readahead.window = spdk_min(cache->readahead.window * 2, FTL_L2P_CACHE_READAHEAD_MAX);
+}
+
+static void
+readahead_on_miss(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache, uint64_t page_no)
+{
+	bool sequential = cache->readahead.last_page_no != UINT64_MAX &&
+			  page_no == cache->readahead.last_page_no + 1;
+
+	cache->readahead.last_page_no = page_no;
+
+	if (!sequential) {
+		cache->readahead.window = FTL_L2P_CACHE_READAHEAD_MIN;
+		cache->readahead.trigger_page_no = UINT64_MAX;
+		return;
+	}
+
+	readahead_issue(dev, cache, page_no + 1);
+}
+
 static void
 page_in(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	struct ftl_l2p_page_set *page_set, struct ftl_l2p_page_wait_ctx *pentry)
@@ -1307,6 +1527,7 @@ page_in(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 
 	if (page_in) {
 		page_in_io(dev, cache, page);
+		readahead_on_miss(dev, cache, pentry->pg_no);
 	}
 }
 
@@ -1355,7 +1576,7 @@ ftl_l2p_cache_process_page_sets(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *
 }
 
 static struct ftl_l2p_page *
-eviction_get_page(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+eviction_get_page_lru(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
 {
 	uint64_t i = 0;
 	struct ftl_l2p_page *page = ftl_l2p_cache_get_coldest_page(cache);
@@ -1381,6 +1602,57 @@ eviction_get_page(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
 	return NULL;
 }
 
+/* Number of the coldest pages searched for a clean one */
+#define FTL_L2P_CACHE_EVICT_CLEAN_SCAN	64
+
+static struct ftl_l2p_page *
+eviction_get_page_clean_first(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+{
+	struct ftl_l2p_page *page = ftl_l2p_cache_get_coldest_page(cache);
+	struct ftl_l2p_page *victim = NULL;
+	uint64_t i;
+
+	for (i = 0; page && i < FTL_L2P_CACHE_EVICT_CLEAN_SCAN; i++) {
+		ftl_bug(L2P_CACHE_PAGE_READY != page->state);
+		ftl_bug(page->pin_ref_cnt);
+
+		if (ftl_l2p_cache_page_can_evict(page)) {
+			if (!page->updates) {
+				victim = page;
+				break;
+			}
+
+			/* Fall back to the coldest page if no clean one is found */
+			if (!victim) {
+				victim = page;
+			}
+		}
+
+		page = ftl_l2p_cache_get_hotter_page(page);
+	}
+
+	if (victim) {
+		ftl_l2p_cache_lru_remove_page(cache, victim);
+	}
+
+	return victim;
+}
+
+typedef struct ftl_l2p_page *(*eviction_get_page_fn)(struct spdk_ftl_dev *dev,
+		struct ftl_l2p_cache *cache);
+
+static const eviction_get_page_fn g_eviction_get_page[SPDK_FTL_L2P_EVICT_MAX] = {
+	[SPDK_FTL_L2P_EVICT_LRU]		= eviction_get_page_lru,
+	[SPDK_FTL_L2P_EVICT_CLEAN_FIRST]	= eviction_get_page_clean_first,
+};
+
+static struct ftl_l2p_page *
+eviction_get_page(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+{
+	assert(dev->conf.l2p_evict_policy < SPDK_FTL_L2P_EVICT_MAX);
+	return g_eviction_get_page[dev->conf.l2p_evict_policy](dev, cache);
+}
+
 static void
 page_out_io_complete(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 		     struct ftl_l2p_page *page, bool success)
@@ -1554,6 +1826,181 @@ ftl_l2p_lazy_unmap_process(struct spdk_ftl_dev *dev)
 	ftl_l2p_cache_pin(dev, pin_ctx);
 }
 
+static void ckpt_page_out(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page);
+
+static void
+ckpt_page_out_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ftl_l2p_page *page = cb_arg;
+	struct ftl_l2p_cache *cache = page->ctx.cache;
+	struct spdk_ftl_dev *dev = cache->dev;
+
+	ftl_stats_bdev_io_completed(dev, FTL_STATS_TYPE_L2P, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+	cache->ios_in_flight--;
+	cache->ckpt.qd--;
+
+	assert(L2P_CACHE_PAGE_PERSISTING == page->state);
+	ftl_bug(page->ctx.updates > page->updates);
+	ftl_bug(page->on_lru_list);
+
+	if (spdk_likely(success)) {
+		page->updates -= page->ctx.updates;
+	} else {
+		cache->ckpt.status = -EIO;
+	}
+
+	page->state = L2P_CACHE_PAGE_READY;
+	if (!page->pin_ref_cnt) {
+		ftl_l2p_cache_lru_add_page(cache, page);
+	}
+}
+
+static void
+ckpt_page_out_retry(void *arg)
+{
+	struct ftl_l2p_page *page = arg;
+
+	ckpt_page_out(page->ctx.cache, page);
+}
+
+static void
+ckpt_page_out(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
+{
+	struct spdk_io_channel *ioch;
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_io_wait_entry *bdev_io_wait;
+	int rc;
+
+	rc = ftl_nv_cache_bdev_write_blocks_with_md(cache->dev, ftl_l2p_cache_get_bdev_desc(cache),
+			ftl_l2p_cache_get_bdev_iochannel(cache),
+			page->page_buffer, NULL, ftl_l2p_cache_page_get_bdev_offset(cache, page),
+			1, ckpt_page_out_cb, page);
+
+	if (spdk_likely(0 == rc)) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		ioch = ftl_l2p_cache_get_bdev_iochannel(cache);
+		bdev = spdk_bdev_desc_get_bdev(ftl_l2p_cache_get_bdev_desc(cache));
+		bdev_io_wait = &page->ctx.bdev_io_wait;
+		bdev_io_wait->bdev = bdev;
+		bdev_io_wait->cb_fn = ckpt_page_out_retry;
+		bdev_io_wait->cb_arg = page;
+
+		rc = spdk_bdev_queue_io_wait(bdev, ioch, bdev_io_wait);
+		ftl_bug(rc);
+	} else {
+		ftl_abort();
+	}
+}
+
+static void
+ckpt_record_cb(struct spdk_ftl_dev *dev, void *ctx, int status)
+{
+	struct ftl_l2p_cache *cache = ctx;
+
+	/*
+	 * On failure the superblock on the disk still holds an older checkpoint, which
+	 * remains valid as the L2P region only gets newer
+	 */
+	if (status) {
+		FTL_ERRLOG(dev, "L2P checkpoint ERROR, cannot persist superblock\n");
+	}
+
+	cache->ios_in_flight--;
+	cache->ckpt.state = L2P_CACHE_CKPT_IDLE;
+}
+
+static void
+ckpt_start(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+{
+	if (dev->sb->seq_id - cache->ckpt.last_seq_id < dev->nv_cache.chunk_count) {
+		return;
+	}
+
+	/* Pending unmaps haven't been applied to the L2P pages yet, they wouldn't be persisted */
+	if (dev->unmap_in_progress) {
+		return;
+	}
+
+	cache->ckpt.last_seq_id = dev->sb->seq_id;
+	cache->ckpt.seq_id = ftl_nv_cache_get_ckpt_seq_id(&dev->nv_cache);
+	cache->ckpt.page_no = 0;
+	cache->ckpt.status = 0;
+	cache->ckpt.state = L2P_CACHE_CKPT_SCAN;
+}
+
+static void
+ckpt_scan(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+{
+	struct ftl_l2p_page *page;
+	uint64_t end = spdk_min(cache->num_pages, cache->ckpt.page_no + FTL_L2P_CACHE_CKPT_SCAN);
+
+	while (cache->ckpt.page_no < end && cache->ckpt.qd < FTL_L2P_CACHE_CKPT_QD) {
+		page = get_l2p_page_by_df_id(cache, cache->ckpt.page_no);
+
+		if (page && page->state == L2P_CACHE_PAGE_FLUSHING) {
+			/* Wait for the eviction to finish, the page may be left dirty */
+			return;
+		}
+
+		cache->ckpt.page_no++;
+
+		if (!page || !page->updates || page->state != L2P_CACHE_PAGE_READY) {
+			continue;
+		}
+
+		if (page->on_lru_list) {
+			ftl_l2p_cache_lru_remove_page(cache, page);
+		}
+
+		page->state = L2P_CACHE_PAGE_PERSISTING;
+		page->ctx.updates = page->updates;
+		page->ctx.cache = cache;
+
+		cache->ckpt.qd++;
+		cache->ios_in_flight++;
+		ckpt_page_out(cache, page);
+	}
+
+	if (cache->ckpt.page_no < cache->num_pages || cache->ckpt.qd) {
+		return;
+	}
+
+	if (cache->ckpt.status) {
+		/* Try again on the next checkpoint */
+		FTL_ERRLOG(dev, "L2P checkpoint ERROR, cannot persist L2P pages\n");
+		cache->ckpt.state = L2P_CACHE_CKPT_IDLE;
+		return;
+	}
+
+	dev->sb->ckpt_seq_id = cache->ckpt.seq_id;
+	cache->ckpt.state = L2P_CACHE_CKPT_RECORD;
+	cache->ios_in_flight++;
+
+	if (ftl_mngt_l2p_ckpt(dev, ckpt_record_cb, cache)) {
+		cache->ios_in_flight--;
+		cache->ckpt.state = L2P_CACHE_CKPT_IDLE;
+	}
+}
+
+static void
+ftl_l2p_cache_process_ckpt(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+{
+	switch (cache->ckpt.state) {
+	case L2P_CACHE_CKPT_IDLE:
+		ckpt_start(dev, cache);
+		break;
+	case L2P_CACHE_CKPT_SCAN:
+		ckpt_scan(dev, cache);
+		break;
+	case L2P_CACHE_CKPT_RECORD:
+		break;
+	}
+}
+
 void
 ftl_l2p_cache_process(struct spdk_ftl_dev *dev)
 {
@@ -1572,4 +2019,5 @@ ftl_l2p_cache_process(struct spdk_ftl_dev *dev)
 
 	ftl_l2p_cache_process_eviction(dev, cache);
 	ftl_l2p_lazy_unmap_process(dev);
+	ftl_l2p_cache_process_ckpt(dev, cache);
 }
@@ -124,6 +124,20 @@ set_region_bdev_btm(struct ftl_layout_region *reg, struct spdk_ftl_dev *dev)
 	reg->vss_blksz = 0;
 }
 
+static void
+setup_layout_valid_map(struct spdk_ftl_dev *dev, struct ftl_layout_region *region,
+		       uint64_t offset)
+{
+	struct ftl_layout *layout = &dev->layout;
+
+	region->type = FTL_LAYOUT_REGION_TYPE_VALID_MAP;
+	region->name = "vmap";
+	region->current.version = region->prev.version = 0;
+	region->current.offset = offset;
+	region->current.blocks = blocks_region(spdk_divide_round_up(
+			layout->base.total_blocks + layout->nvc.total_blocks, 8));
+}
+
 static int
 setup_layout_nvc(struct spdk_ftl_dev *dev)
 {
@@ -152,6 +166,12 @@ setup_layout_nvc(struct spdk_ftl_dev *dev)
 	region = &layout->region[FTL_LAYOUT_REGION_TYPE_SB];
 	offset += region->current.blocks;
 
+	/* Zoned base devices keep the superblock mirror on the NV cache, right after the SB */
+	if (dev->is_zoned) {
+		region = &layout->region[FTL_LAYOUT_REGION_TYPE_SB_BASE];
+		offset += region->current.blocks;
+	}
+
 	/* Initialize L2P region */
 	if (offset >= layout->nvc.total_blocks) {
 		goto error;
@@ -254,6 +274,19 @@ setup_layout_nvc(struct spdk_ftl_dev *dev)
 	mirror->current.offset += region->current.blocks;
 	offset += mirror->current.blocks;
 
+	/*
+	 * Initialize validity map of zoned base devices, it can't be overwritten in place there
+	 */
+	if (dev->is_zoned) {
+		if (offset >= layout->nvc.total_blocks) {
+			goto error;
+		}
+		region = &layout->region[FTL_LAYOUT_REGION_TYPE_VALID_MAP];
+		setup_layout_valid_map(dev, region, offset);
+		set_region_bdev_nvc(region, dev);
+		offset += region->current.blocks;
+	}
+
 	/*
 	 * Initialize NV Cache metadata
 	 */
@@ -358,8 +391,13 @@ setup_layout_base(struct spdk_ftl_dev *dev)
 	 * - data
 	 * - valid map
 	 */
-	offset = layout->region[FTL_LAYOUT_REGION_TYPE_SB_BASE].current.blocks;
-	offset = SPDK_ALIGN_CEIL(offset, data_base_alignment);
+	if (dev->is_zoned) {
+		/* Superblock mirror and validity map live on the NV cache, bands start at zone 0 */
+		offset = 0;
+	} else {
+		offset = layout->region[FTL_LAYOUT_REGION_TYPE_SB_BASE].current.blocks;
+		offset = SPDK_ALIGN_CEIL(offset, data_base_alignment);
+	}
 
 	/* Setup data region on base device */
 	region = &layout->region[FTL_LAYOUT_REGION_TYPE_DATA_BASE];
@@ -373,15 +411,12 @@ setup_layout_base(struct spdk_ftl_dev *dev)
 	offset += region->current.blocks;
 
 	/* Setup validity map */
-	region = &layout->region[FTL_LAYOUT_REGION_TYPE_VALID_MAP];
-	region->type = FTL_LAYOUT_REGION_TYPE_VALID_MAP;
-	region->name = "vmap";
-	region->current.version = region->prev.version = 0;
-	region->current.offset = offset;
-	region->current.blocks = blocks_region(spdk_divide_round_up(
-			layout->base.total_blocks + layout->nvc.total_blocks, 8));
-	set_region_bdev_btm(region, dev);
-	offset += region->current.blocks;
+	if (!dev->is_zoned) {
+		region = &layout->region[FTL_LAYOUT_REGION_TYPE_VALID_MAP];
+		setup_layout_valid_map(dev, region, offset);
+		set_region_bdev_btm(region, dev);
+		offset += region->current.blocks;
+	}
 
 	/* Checking for underflow */
 	left = layout->base.total_blocks - offset;
@@ -498,6 +533,7 @@ ftl_layout_setup_superblock(struct spdk_ftl_dev *dev)
 {
 	struct ftl_layout *layout = &dev->layout;
 	struct ftl_layout_region *region = &layout->region[FTL_LAYOUT_REGION_TYPE_SB];
+	struct ftl_layout_region *sb;
 	uint64_t total_blocks, offset, left;
 
 	assert(layout->md[FTL_LAYOUT_REGION_TYPE_SB] == NULL);
@@ -536,9 +572,17 @@ ftl_layout_setup_superblock(struct spdk_ftl_dev *dev)
 	region->current.blocks = blocks_region(FTL_SUPERBLOCK_SIZE);
 	set_region_bdev_btm(region, dev);
 
-	/* Check if SB can be stored at the end of base device */
-	total_blocks = spdk_bdev_get_num_blocks(
-			       spdk_bdev_desc_get_bdev(dev->base_bdev_desc));
+	if (dev->is_zoned) {
+		/* Zones can't be overwritten in place, keep the mirror on the NV cache instead */
+		sb = &layout->region[FTL_LAYOUT_REGION_TYPE_SB];
+		region->current.offset = sb->current.offset + sb->current.blocks;
+		region->bdev_desc = sb->bdev_desc;
+		region->ioch = sb->ioch;
+		region->vss_blksz = 0;
+	}
+
+	/* Check if SB mirror can be stored on its device */
+	total_blocks = spdk_bdev_get_num_blocks(spdk_bdev_desc_get_bdev(region->bdev_desc));
 	offset = region->current.offset + region->current.blocks;
 	left = total_blocks - offset;
 	if ((left > total_blocks) || (offset > total_blocks)) {
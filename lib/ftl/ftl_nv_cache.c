@@ -14,6 +14,7 @@
 #include "ftl_core.h"
 #include "ftl_band.h"
 #include "utils/ftl_addr_utils.h"
+#include "utils/ftl_sketch.h"
 #include "mngt/ftl_mngt.h"
 
 static inline uint64_t nvc_data_blocks(struct ftl_nv_cache *nv_cache) __attribute__((unused));
@@ -92,7 +93,7 @@ ftl_nv_cache_init(struct spdk_ftl_dev *dev)
 	struct ftl_nv_cache_chunk *chunk;
 	struct ftl_nv_cache_chunk_md *md;
 	struct ftl_nv_cache_compactor *compactor;
-	uint64_t i, offset;
+	uint64_t i, offset, cache_blocks;
 
 	nv_cache->halt = true;
 
@@ -117,6 +118,30 @@ ftl_nv_cache_init(struct spdk_ftl_dev *dev)
 	nv_cache->chunk_count = dev->layout.nvc.chunk_count;
 	nv_cache->tail_md_chunk_blocks = ftl_nv_cache_chunk_tail_md_num_blocks(nv_cache);
 
+	/* Write frequency is aged once per each pass over the whole cache */
+	cache_blocks = nv_cache->chunk_count * nv_cache->chunk_blocks;
+	nv_cache->wr_freq = ftl_sketch_create(spdk_min(cache_blocks, FTL_NV_CACHE_WR_FREQ_MAX_WIDTH),
+					      cache_blocks);
+	if (!nv_cache->wr_freq) {
+		FTL_ERRLOG(dev, "Failed to initialize NV cache write frequency tracking\n");
+		return -1;
+	}
+
+	nv_cache->wr_cache.num_blocks = dev->conf.wr_cache_blocks;
+	if (nv_cache->wr_cache.num_blocks) {
+		nv_cache->wr_cache.buf = calloc(nv_cache->wr_cache.num_blocks, FTL_BLOCK_SIZE);
+		nv_cache->wr_cache.addr = calloc(nv_cache->wr_cache.num_blocks,
+						 sizeof(nv_cache->wr_cache.addr[0]));
+		if (!nv_cache->wr_cache.buf || !nv_cache->wr_cache.addr) {
+			FTL_ERRLOG(dev, "Failed to initialize NV cache write cache\n");
+			return -1;
+		}
+
+		for (i = 0; i < nv_cache->wr_cache.num_blocks; i++) {
+			nv_cache->wr_cache.addr[i] = FTL_ADDR_INVALID;
+		}
+	}
+
 	/* Allocate chunks */
 	nv_cache->chunks = calloc(nv_cache->chunk_count,
 				  sizeof(nv_cache->chunks[0]));
@@ -227,6 +252,15 @@ ftl_nv_cache_deinit(struct spdk_ftl_dev *dev)
 	nv_cache->chunk_md_pool = NULL;
 	nv_cache->free_chunk_md_pool = NULL;
 
+	ftl_sketch_destroy(nv_cache->wr_freq);
+	nv_cache->wr_freq = NULL;
+
+	free(nv_cache->wr_cache.buf);
+	free(nv_cache->wr_cache.addr);
+	nv_cache->wr_cache.buf = NULL;
+	nv_cache->wr_cache.addr = NULL;
+	nv_cache->wr_cache.num_blocks = 0;
+
 	free(nv_cache->chunks);
 	nv_cache->chunks = NULL;
 }
@@ -741,13 +775,52 @@ compaction_submit_read(struct ftl_nv_cache_compactor *compactor, ftl_addr addr,
 			compactor);
 }
 
+static struct ftl_writer *
+compaction_stream_writer(struct spdk_ftl_dev *dev, enum ftl_nv_cache_stream stream)
+{
+	/*
+	 * Cold data goes to the GC writer's band, next to relocated data. When the free bands
+	 * are running out and the user writer is stopped, keep it there as well, so compaction
+	 * doesn't take bands away from GC.
+	 */
+	if (stream == FTL_NV_CACHE_STREAM_COLD && dev->limit >= dev->writer_user.limit) {
+		return &dev->writer_gc;
+	}
+
+	return &dev->writer_user;
+}
+
+static enum ftl_nv_cache_stream
+compaction_get_stream(struct ftl_nv_cache *nv_cache, uint64_t lba)
+{
+	if (ftl_sketch_estimate(nv_cache->wr_freq, lba) >= FTL_NV_CACHE_HOT_WRITE_COUNT) {
+		return FTL_NV_CACHE_STREAM_HOT;
+	}
+
+	return FTL_NV_CACHE_STREAM_COLD;
+}
+
+static enum ftl_nv_cache_stream
+compactor_rq_stream(struct ftl_nv_cache_compactor *compactor, struct ftl_rq *rq)
+{
+	if (rq == compactor->wr[FTL_NV_CACHE_STREAM_COLD]) {
+		return FTL_NV_CACHE_STREAM_COLD;
+	}
+
+	assert(rq == compactor->wr[FTL_NV_CACHE_STREAM_HOT]);
+	return FTL_NV_CACHE_STREAM_HOT;
+}
+
 static void
-compaction_process_pad(struct ftl_nv_cache_compactor *compactor)
+compaction_process_pad(struct ftl_rq *wr)
 {
-	struct ftl_rq *wr = compactor->wr;
 	const uint64_t num_entries = wr->num_blocks;
 	struct ftl_rq_entry *iter;
 
+	if (!wr->iter.idx) {
+		wr->stage_tsc = spdk_thread_get_last_tsc(spdk_get_thread());
+	}
+
 	iter = &wr->entries[wr->iter.idx];
 
 	while (wr->iter.idx < num_entries) {
@@ -767,6 +840,7 @@ compaction_process(struct ftl_nv_cache_compactor *compactor)
 	struct spdk_ftl_dev *dev = SPDK_CONTAINEROF(nv_cache,
 				   struct spdk_ftl_dev, nv_cache);
 	struct ftl_nv_cache_chunk *chunk;
+	enum ftl_nv_cache_stream stream;
 	uint64_t to_read, addr, begin, end, offset;
 	int rc;
 
@@ -782,9 +856,15 @@ compaction_process(struct ftl_nv_cache_compactor *compactor)
 	 */
 	chunk = get_chunk_for_compaction(nv_cache);
 	if (!chunk) {
-		/* No chunks to compact, pad this request */
-		compaction_process_pad(compactor);
-		ftl_writer_queue_rq(&dev->writer_user, compactor->wr);
+		/* No chunks to compact, pad the request with cold data first (if any) */
+		if (compactor->wr[FTL_NV_CACHE_STREAM_COLD]->iter.idx) {
+			stream = FTL_NV_CACHE_STREAM_COLD;
+		} else {
+			stream = FTL_NV_CACHE_STREAM_HOT;
+		}
+
+		compaction_process_pad(compactor->wr[stream]);
+		ftl_writer_queue_rq(compaction_stream_writer(dev, stream), compactor->wr[stream]);
 		return;
 	}
 
@@ -863,7 +943,7 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 	if (spdk_unlikely(false == rq->success)) {
 		/* IO error retry writing */
 #ifdef SPDK_FTL_RETRY_ON_ERROR
-		ftl_writer_queue_rq(&dev->writer_user, rq);
+		ftl_writer_queue_rq(compaction_stream_writer(dev, compactor_rq_stream(compactor, rq)), rq);
 		return;
 #else
 		ftl_abort();
@@ -888,7 +968,8 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 		addr = ftl_band_next_addr(band, addr, 1);
 	}
 
-	compactor->wr->iter.idx = 0;
+	ftl_stats_stage_completed(dev, FTL_STATS_STAGE_COMPACTION, rq->stage_tsc, rq->num_blocks);
+	rq->iter.idx = 0;
 
 	if (is_compaction_required(nv_cache)) {
 		compaction_process(compactor);
@@ -900,15 +981,15 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 static void
 compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 {
-	struct ftl_rq *wr = compactor->wr;
+	struct ftl_rq *wr;
 	struct ftl_rq *rd = compactor->rd;
 	ftl_addr cache_addr = rd->io.addr;
 	struct ftl_nv_cache_chunk *chunk = rd->owner.priv;
 	struct spdk_ftl_dev *dev;
 	struct ftl_rq_entry *iter;
 	union ftl_md_vss *md;
+	enum ftl_nv_cache_stream stream;
 	ftl_addr current_addr;
-	const uint64_t num_entries = wr->num_blocks;
 	uint64_t tsc = spdk_thread_get_last_tsc(spdk_get_thread());
 
 	chunk->compaction_length_tsc += tsc - chunk->compaction_start_tsc;
@@ -917,13 +998,15 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 	dev = SPDK_CONTAINEROF(compactor->nv_cache,
 			       struct spdk_ftl_dev, nv_cache);
 
-	assert(wr->iter.idx < num_entries);
+	assert(compactor->wr[FTL_NV_CACHE_STREAM_HOT]->iter.idx <
+	       compactor->wr[FTL_NV_CACHE_STREAM_HOT]->num_blocks);
+	assert(compactor->wr[FTL_NV_CACHE_STREAM_COLD]->iter.idx <
+	       compactor->wr[FTL_NV_CACHE_STREAM_COLD]->num_blocks);
 	assert(rd->iter.idx < rd->iter.count);
 
 	cache_addr += rd->iter.idx;
-	iter = &wr->entries[wr->iter.idx];
 
-	while (wr->iter.idx < num_entries && rd->iter.idx < rd->iter.count) {
+	while (rd->iter.idx < rd->iter.count) {
 		/* Get metadata */
 		md = rd->entries[rd->iter.idx].io_md;
 		if (md->nv_cache.lba == FTL_LBA_INVALID || md->nv_cache.seq_id != chunk->md->seq_id) {
@@ -934,45 +1017,55 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 		}
 
 		current_addr = ftl_l2p_get(dev, md->nv_cache.lba);
-		if (current_addr == cache_addr) {
-			/* Swap payload */
-			ftl_rq_swap_payload(wr, wr->iter.idx, rd, rd->iter.idx);
-
-			/*
-			 * Address still the same, we may continue to compact it
-			 * back to  FTL, set valid number of entries within
-			 * this batch
-			 */
-			iter->addr = current_addr;
-			iter->owner.priv = chunk;
-			iter->lba = md->nv_cache.lba;
-			iter->seq_id = chunk->md->seq_id;
-
-			/* Advance within batch */
-			iter++;
-			wr->iter.idx++;
-		} else {
+		if (current_addr != cache_addr) {
 			/* This address already invalidated, just omit this block */
 			chunk_compaction_advance(chunk, 1);
 			ftl_l2p_unpin(dev, md->nv_cache.lba, 1);
+			rd->iter.idx++;
+			cache_addr++;
+			continue;
+		}
+
+		/* Place the block in the request matching its write frequency */
+		stream = compaction_get_stream(compactor->nv_cache, md->nv_cache.lba);
+		wr = compactor->wr[stream];
+		iter = &wr->entries[wr->iter.idx];
+		if (!wr->iter.idx) {
+			wr->stage_tsc = tsc;
 		}
 
-		/* Advance within reader */
+		/* Swap payload */
+		ftl_rq_swap_payload(wr, wr->iter.idx, rd, rd->iter.idx);
+
+		/*
+		 * Address still the same, we may continue to compact it
+		 * back to  FTL, set valid number of entries within
+		 * this batch
+		 */
+		iter->addr = current_addr;
+		iter->owner.priv = chunk;
+		iter->lba = md->nv_cache.lba;
+		iter->seq_id = chunk->md->seq_id;
+
+		/* Advance within batch and reader */
+		wr->iter.idx++;
 		rd->iter.idx++;
 		cache_addr++;
+
+		if (wr->num_blocks == wr->iter.idx) {
+			/*
+			 * Request contains data to be placed on FTL, compact it. The other stream's
+			 * request is not full, so only one write per compactor is in flight.
+			 */
+			ftl_writer_queue_rq(compaction_stream_writer(dev, stream), wr);
+			return;
+		}
 	}
 
-	if (num_entries == wr->iter.idx) {
-		/*
-		 * Request contains data to be placed on FTL, compact it
-		 */
-		ftl_writer_queue_rq(&dev->writer_user, wr);
+	if (is_compaction_required(compactor->nv_cache)) {
+		compaction_process(compactor);
 	} else {
-		if (is_compaction_required(compactor->nv_cache)) {
-			compaction_process(compactor);
-		} else {
-			compactor_deactivate(compactor);
-		}
+		compactor_deactivate(compactor);
 	}
 }
 
@@ -983,7 +1076,8 @@ compactor_free(struct spdk_ftl_dev *dev, struct ftl_nv_cache_compactor *compacto
 		return;
 	}
 
-	ftl_rq_del(compactor->wr);
+	ftl_rq_del(compactor->wr[FTL_NV_CACHE_STREAM_HOT]);
+	ftl_rq_del(compactor->wr[FTL_NV_CACHE_STREAM_COLD]);
 	ftl_rq_del(compactor->rd);
 	free(compactor);
 }
@@ -992,16 +1086,25 @@ static struct ftl_nv_cache_compactor *
 compactor_alloc(struct spdk_ftl_dev *dev)
 {
 	struct ftl_nv_cache_compactor *compactor;
+	struct ftl_rq *wr;
+	int i;
 
 	compactor = calloc(1, sizeof(*compactor));
 	if (!compactor) {
 		goto error;
 	}
 
-	/* Allocate help request for writing */
-	compactor->wr = ftl_rq_new(dev, dev->md_size);
-	if (!compactor->wr) {
-		goto error;
+	/* Allocate help requests for writing, one per data stream */
+	for (i = 0; i < FTL_NV_CACHE_STREAM_MAX; i++) {
+		wr = ftl_rq_new(dev, dev->md_size);
+		if (!wr) {
+			goto error;
+		}
+
+		wr->owner.priv = compactor;
+		wr->owner.cb = compaction_process_ftl_done;
+		wr->owner.compaction = true;
+		compactor->wr[i] = wr;
 	}
 
 	/* Allocate help request for reading */
@@ -1011,9 +1114,6 @@ compactor_alloc(struct spdk_ftl_dev *dev)
 	}
 
 	compactor->nv_cache = &dev->nv_cache;
-	compactor->wr->owner.priv = compactor;
-	compactor->wr->owner.cb = compaction_process_ftl_done;
-	compactor->wr->owner.compaction = true;
 
 	return compactor;
 
@@ -1030,6 +1130,9 @@ ftl_nv_cache_submit_cb_done(struct ftl_io *io)
 	chunk_advance_blocks(nv_cache, io->nv_cache_chunk, io->num_blocks);
 	io->nv_cache_chunk = NULL;
 
+	ftl_stats_stage_completed(io->dev, FTL_STATS_STAGE_NV_CACHE_WRITE, io->stage_tsc,
+				  io->num_blocks);
+
 	ftl_mempool_put(nv_cache->md_pool, io->md);
 	ftl_io_complete(io);
 }
@@ -1049,6 +1152,59 @@ ftl_nv_cache_l2p_update(struct ftl_io *io)
 	ftl_nv_cache_submit_cb_done(io);
 }
 
+static void
+ftl_nv_cache_wr_cache_fill(struct ftl_io *io)
+{
+	struct ftl_nv_cache *nv_cache = &io->dev->nv_cache;
+	ftl_addr addr = io->addr;
+	uint64_t slot;
+	size_t i, offset;
+
+	if (!nv_cache->wr_cache.num_blocks) {
+		return;
+	}
+
+	for (i = 0; i < io->iov_cnt; i++) {
+		for (offset = 0; offset < io->iov[i].iov_len; offset += FTL_BLOCK_SIZE, addr++) {
+			slot = addr % nv_cache->wr_cache.num_blocks;
+			memcpy((char *)nv_cache->wr_cache.buf + slot * FTL_BLOCK_SIZE,
+			       (char *)io->iov[i].iov_base + offset, FTL_BLOCK_SIZE);
+			nv_cache->wr_cache.addr[slot] = addr;
+		}
+	}
+}
+
+uint32_t
+ftl_nv_cache_read_wr_cache(struct ftl_io *io, ftl_addr addr, uint32_t num_blocks)
+{
+	struct ftl_nv_cache *nv_cache = &io->dev->nv_cache;
+	char *payload = ftl_io_iovec_addr(io);
+	uint64_t slot;
+	uint32_t i;
+
+	if (!nv_cache->wr_cache.num_blocks) {
+		return 0;
+	}
+
+	for (i = 0; i < num_blocks; i++, addr++) {
+		slot = addr % nv_cache->wr_cache.num_blocks;
+		if (nv_cache->wr_cache.addr[slot] != addr) {
+			break;
+		}
+
+		memcpy(payload + i * FTL_BLOCK_SIZE,
+		       (char *)nv_cache->wr_cache.buf + slot * FTL_BLOCK_SIZE, FTL_BLOCK_SIZE);
+	}
+
+	/* Blocks following a hit are looked up again, only count the ones read from the device */
+	io->dev->stats.wr_cache.hits += i;
+	if (i == 0) {
+		io->dev->stats.wr_cache.misses += num_blocks;
+	}
+
+	return i;
+}
+
 static void
 ftl_nv_cache_submit_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -1064,6 +1220,8 @@ ftl_nv_cache_submit_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		io->status = -EIO;
 		ftl_nv_cache_submit_cb_done(io);
 	} else {
+		/* Copies have to be in place before reads can find the new address in the L2P */
+		ftl_nv_cache_wr_cache_fill(io);
 		ftl_nv_cache_l2p_update(io);
 	}
 }
@@ -1125,7 +1283,7 @@ bool
 ftl_nv_cache_write(struct ftl_io *io)
 {
 	struct spdk_ftl_dev *dev = io->dev;
-	uint64_t cache_offset;
+	uint64_t cache_offset, lba, i;
 
 	io->md = ftl_mempool_get(dev->nv_cache.md_pool);
 	if (spdk_unlikely(!io->md)) {
@@ -1141,8 +1299,15 @@ ftl_nv_cache_write(struct ftl_io *io)
 	}
 	io->addr = ftl_addr_from_nvc_offset(dev, cache_offset);
 	io->nv_cache_chunk = dev->nv_cache.chunk_current;
+	io->stage_tsc = spdk_get_ticks();
 
 	ftl_nv_cache_fill_md(io);
+
+	lba = ftl_io_get_lba(io, 0);
+	for (i = 0; i < io->num_blocks; i++) {
+		ftl_sketch_add(dev->nv_cache.wr_freq, lba + i);
+	}
+
 	ftl_l2p_pin(io->dev, io->lba, io->num_blocks,
 		    ftl_nv_cache_pin_cb, io,
 		    &io->l2p_pin_ctx);
@@ -1178,7 +1343,9 @@ ftl_nv_cache_is_halted(struct ftl_nv_cache *nv_cache)
 	}
 
 	TAILQ_FOREACH(compactor, &nv_cache->compactor_list, entry) {
-		if (compactor->rd->iter.idx != 0 || compactor->wr->iter.idx != 0) {
+		if (compactor->rd->iter.idx != 0 ||
+		    compactor->wr[FTL_NV_CACHE_STREAM_HOT]->iter.idx != 0 ||
+		    compactor->wr[FTL_NV_CACHE_STREAM_COLD]->iter.idx != 0) {
 			return false;
 		}
 	}
@@ -1194,9 +1361,10 @@ static void
 ftl_nv_cache_compaction_reset(struct ftl_nv_cache_compactor *compactor)
 {
 	struct ftl_rq *rd = compactor->rd;
-	struct ftl_rq *wr = compactor->wr;
+	struct ftl_rq *wr;
 	uint64_t lba;
 	uint64_t i;
+	int stream;
 
 	for (i = rd->iter.idx; i < rd->iter.count; i++) {
 		lba = ((union ftl_md_vss *)rd->entries[i].io_md)->nv_cache.lba;
@@ -1208,13 +1376,17 @@ ftl_nv_cache_compaction_reset(struct ftl_nv_cache_compactor *compactor)
 	rd->iter.idx = 0;
 	rd->iter.count = 0;
 
-	for (i = 0; i < wr->iter.idx; i++) {
-		lba = wr->entries[i].lba;
-		assert(lba != FTL_LBA_INVALID);
-		ftl_l2p_unpin(wr->dev, lba, 1);
-	}
+	for (stream = 0; stream < FTL_NV_CACHE_STREAM_MAX; stream++) {
+		wr = compactor->wr[stream];
+
+		for (i = 0; i < wr->iter.idx; i++) {
+			lba = wr->entries[i].lba;
+			assert(lba != FTL_LBA_INVALID);
+			ftl_l2p_unpin(wr->dev, lba, 1);
+		}
 
-	wr->iter.idx = 0;
+		wr->iter.idx = 0;
+	}
 }
 
 void
@@ -1611,6 +1783,30 @@ ftl_nv_cache_get_max_seq_id(struct ftl_nv_cache *nv_cache, uint64_t *open_seq_id
 	*close_seq_id = c_seq_id;
 }
 
+uint64_t
+ftl_nv_cache_get_ckpt_seq_id(struct ftl_nv_cache *nv_cache)
+{
+	struct spdk_ftl_dev *dev = SPDK_CONTAINEROF(nv_cache, struct spdk_ftl_dev, nv_cache);
+	struct ftl_nv_cache_chunk *chunk;
+	uint64_t i, seq_id = dev->sb->seq_id;
+
+	/* Chunks on the open list may still be waiting for their open state to be persisted */
+	TAILQ_FOREACH(chunk, &nv_cache->chunk_open_list, entry) {
+		seq_id = spdk_min(seq_id, chunk->md->seq_id);
+	}
+
+	chunk = nv_cache->chunks;
+	assert(chunk);
+
+	for (i = 0; i < nv_cache->chunk_count; i++, chunk++) {
+		if (chunk->md->state == FTL_CHUNK_STATE_OPEN) {
+			seq_id = spdk_min(seq_id, chunk->md->seq_id);
+		}
+	}
+
+	return seq_id;
+}
+
 typedef void (*ftl_chunk_ops_cb)(struct ftl_nv_cache_chunk *chunk, void *cntx, bool status);
 
 static void
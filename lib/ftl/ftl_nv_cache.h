@@ -28,6 +28,15 @@
 
 #define FTL_NV_CACHE_NUM_COMPACTORS 8
 
+/*
+ * Compaction separates hot and cold data into different open bands. An LBA is considered hot if
+ * it has been written at least FTL_NV_CACHE_HOT_WRITE_COUNT times recently, where "recently" is
+ * tracked by a write frequency sketch aged every time the whole NV cache data area is written
+ * over. The sketch uses one counter per cached block, up to FTL_NV_CACHE_WR_FREQ_MAX_WIDTH.
+ */
+#define FTL_NV_CACHE_HOT_WRITE_COUNT	2
+#define FTL_NV_CACHE_WR_FREQ_MAX_WIDTH	(1ULL << 20)
+
 /*
  * Parameters controlling nv cache write throttling.
  *
@@ -47,6 +56,7 @@
 #define FTL_NV_CACHE_THROTTLE_MODIFIER_MAX	0.5
 
 struct ftl_nvcache_restore;
+struct ftl_sketch;
 typedef void (*ftl_nv_cache_restore_fn)(struct ftl_nvcache_restore *, int, void *cb_arg);
 
 enum ftl_chunk_state {
@@ -121,9 +131,19 @@ struct ftl_nv_cache_chunk {
 	struct ftl_md_io_entry_ctx md_persist_entry_ctx;
 };
 
+enum ftl_nv_cache_stream {
+	/* Frequently written data, compacted by the user writer */
+	FTL_NV_CACHE_STREAM_HOT,
+
+	/* Rarely written data, placed alongside relocated data by the GC writer */
+	FTL_NV_CACHE_STREAM_COLD,
+
+	FTL_NV_CACHE_STREAM_MAX
+};
+
 struct ftl_nv_cache_compactor {
 	struct ftl_nv_cache *nv_cache;
-	struct ftl_rq *wr;
+	struct ftl_rq *wr[FTL_NV_CACHE_STREAM_MAX];
 	struct ftl_rq *rd;
 	TAILQ_ENTRY(ftl_nv_cache_compactor) entry;
 	struct spdk_bdev_io_wait_entry bdev_io_wait;
@@ -154,6 +174,21 @@ struct ftl_nv_cache {
 	/* Block Metadata size */
 	uint64_t md_size;
 
+	/* Recent write frequency of LBAs */
+	struct ftl_sketch *wr_freq;
+
+	/*
+	 * Copies of the most recently written user blocks are kept in DRAM (if enabled by
+	 * spdk_ftl_conf.wr_cache_blocks), so that reads closely following the writes of the same
+	 * LBAs don't have to go to the cache device. The copies are direct mapped by their cache
+	 * address and refreshed when the write completes, before the L2P points to the address.
+	 */
+	struct {
+		void *buf;
+		ftl_addr *addr;
+		uint64_t num_blocks;
+	} wr_cache;
+
 	/* NV cache metadata object handle */
 	struct ftl_md *md;
 
@@ -225,6 +260,7 @@ bool ftl_nv_cache_write(struct ftl_io *io);
 void ftl_nv_cache_fill_md(struct ftl_io *io);
 int ftl_nv_cache_read(struct ftl_io *io, ftl_addr addr, uint32_t num_blocks,
 		      spdk_bdev_io_completion_cb cb, void *cb_arg);
+uint32_t ftl_nv_cache_read_wr_cache(struct ftl_io *io, ftl_addr addr, uint32_t num_blocks);
 bool ftl_nv_cache_throttle(struct spdk_ftl_dev *dev);
 void ftl_nv_cache_process(struct spdk_ftl_dev *dev);
 
@@ -263,6 +299,18 @@ uint64_t chunk_tail_md_offset(struct ftl_nv_cache *nv_cache);
 void ftl_nv_cache_get_max_seq_id(struct ftl_nv_cache *nv_cache, uint64_t *open_seq_id,
 				 uint64_t *close_seq_id);
 
+/**
+ * @brief Returns the sequence ID with which an L2P checkpoint started now can be recorded
+ *
+ * @details Data written from now on can only go to the currently open chunks or to the ones
+ * opened later, so the returned value is not higher than the sequence ID of any of them.
+ *
+ * @param nv_cache FTL NV cache
+ *
+ * @return L2P checkpoint sequence ID
+ */
+uint64_t ftl_nv_cache_get_ckpt_seq_id(struct ftl_nv_cache *nv_cache);
+
 void ftl_mngt_nv_cache_restore_chunk_state(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt);
 
 void ftl_mngt_nv_cache_recover_open_chunk(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt);
@@ -436,6 +436,21 @@ ftl_mngt_p2l_ckpt_restore(struct ftl_band *band, uint32_t md_region, uint64_t se
 	return 0;
 }
 
+void
+ftl_mngt_p2l_ckpt_restore_zone_wp(struct ftl_band *band, uint64_t num_blocks)
+{
+#ifdef DEBUG
+	/* Blocks appended without their P2L checkpointed count as written too */
+	struct ftl_p2l_ckpt *ckpt = band->p2l_map.p2l_ckpt;
+	for (uint64_t i = 0; i < num_blocks / FTL_NUM_LBA_IN_BLOCK; i++) {
+		ftl_bitmap_set(ckpt->bmp, i);
+	}
+#endif
+
+	ftl_band_iter_init(band);
+	ftl_band_iter_set(band, num_blocks);
+}
+
 enum ftl_layout_region_type
 ftl_p2l_ckpt_region_type(const struct ftl_p2l_ckpt *ckpt) {
 	return ckpt->layout_region->type;
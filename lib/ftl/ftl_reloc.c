@@ -421,6 +421,10 @@ move_read(struct ftl_reloc *reloc, struct ftl_reloc_move *mv, struct ftl_band *b
 	band_left = ftl_band_user_blocks_left(band, band->md->iter.offset);
 	rq->iter.count = spdk_min(rq_left, band_left);
 
+	if (!rq->iter.idx) {
+		rq->stage_tsc = spdk_get_ticks();
+	}
+
 	ftl_band_rq_read(band, rq);
 
 	move_advance_rq(rq);
@@ -523,6 +527,8 @@ move_write_cb(struct ftl_rq *rq)
 
 	if (spdk_likely(rq->success)) {
 		move_finish_write(rq);
+		ftl_stats_stage_completed(rq->dev, FTL_STATS_STAGE_RELOC, rq->stage_tsc,
+					  rq->num_blocks);
 		move_set_state(mv, FTL_RELOC_STATE_READ);
 	} else {
 		/* Write failed, repeat write */
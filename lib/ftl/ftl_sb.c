@@ -167,7 +167,10 @@ ftl_superblock_md_layout_build(struct spdk_ftl_dev *dev)
 		superblock_md_layout_add_free(dev, &sb_reg, FTL_LAYOUT_REGION_LAST_NVC,
 					      FTL_LAYOUT_REGION_TYPE_FREE_NVC, layout->nvc.total_blocks);
 
-		superblock_md_layout_add_free(dev, &sb_reg, FTL_LAYOUT_REGION_LAST_BASE,
+		/* Zoned base devices hold nothing but data, the validity map is on the NV cache */
+		superblock_md_layout_add_free(dev, &sb_reg,
+					      dev->is_zoned ? FTL_LAYOUT_REGION_TYPE_DATA_BASE :
+					      FTL_LAYOUT_REGION_LAST_BASE,
 					      FTL_LAYOUT_REGION_TYPE_FREE_BASE, layout->base.total_blocks);
 	}
 
@@ -55,6 +55,19 @@ struct ftl_superblock_md_region {
 SPDK_STATIC_ASSERT(sizeof(struct ftl_superblock_md_region) == 32,
 		   "ftl_superblock_md_region incorrect size");
 
+struct ftl_superblock_shard {
+	/* First 64 bits of the set UUID xor-ed with the remaining ones, 0 if not sharded */
+	uint64_t		set_id;
+	/* Index of the device within the set */
+	uint16_t		idx;
+	/* Number of devices in the set, 0 if not sharded */
+	uint16_t		count;
+	/* Size of the LBA stripe routed to a single device in MiB */
+	uint32_t		stripe_mib;
+} __attribute__((packed));
+SPDK_STATIC_ASSERT(sizeof(struct ftl_superblock_shard) == 16,
+		   "ftl_superblock_shard incorrect size");
+
 struct ftl_superblock_shm {
 	/* SHM initialization completed */
 	bool				shm_ready;
@@ -32,8 +32,8 @@ struct ftl_superblock {
 	/* Maximum IO depth per band relocate */
 	uint64_t			max_reloc_qdepth;
 
-	/* Reserved field */
-	uint8_t				reserved3[16];
+	/* Placement within a sharded bdev, zeroed (reserved) on older devices */
+	struct ftl_superblock_shard	shard;
 
 	/* Last L2P checkpoint +1 (i.e. min_seq_id, 0:no ckpt) */
 	uint64_t			ckpt_seq_id;
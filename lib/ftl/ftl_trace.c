@@ -11,8 +11,6 @@
 #include "ftl_io.h"
 #include "ftl_band.h"
 
-#if defined(DEBUG)
-
 enum ftl_trace_source {
 	FTL_TRACE_SOURCE_INTERNAL,
 	FTL_TRACE_SOURCE_USER,
@@ -49,14 +47,42 @@ enum ftl_trace_source {
 #define FTL_TRACE_UNMAP_SUBMISSION(src)		FTL_TPOINT_ID(20, src)
 #define FTL_TRACE_UNMAP_COMPLETION(src)		FTL_TPOINT_ID(21, src)
 
+#define FTL_TRACE_STAGE(stage)		FTL_TPOINT_ID(22 + (stage), FTL_TRACE_SOURCE_INTERNAL)
+
+static void
+ftl_trace_register_stages(void)
+{
+	static const char *stage_names[] = {
+		[FTL_STATS_STAGE_NV_CACHE_WRITE] = "nvc_write_cmpl",
+		[FTL_STATS_STAGE_COMPACTION] = "compaction_cmpl",
+		[FTL_STATS_STAGE_RELOC] = "reloc_cmpl",
+		[FTL_STATS_STAGE_L2P_PAGE_IN] = "l2p_page_in_cmpl",
+		[FTL_STATS_STAGE_USER_WRITE_STALL] = "write_stall_end",
+	};
+	char descbuf[128];
+	int i;
+
+	SPDK_STATIC_ASSERT(SPDK_COUNTOF(stage_names) == FTL_STATS_STAGE_MAX, "Missing stage name");
+
+	for (i = 0; i < FTL_STATS_STAGE_MAX; ++i) {
+		snprintf(descbuf, sizeof(descbuf), "i %s", stage_names[i]);
+		spdk_trace_register_description(descbuf, FTL_TRACE_STAGE(i), OWNER_FTL, OBJECT_NONE,
+						0, 0, "lat_us: ");
+	}
+}
+
 SPDK_TRACE_REGISTER_FN(ftl_trace_func, "ftl", TRACE_GROUP_FTL)
 {
+#if defined(DEBUG)
 	const char source[] = { 'i', 'u' };
 	char descbuf[128];
 	int i;
+#endif
 
 	spdk_trace_register_owner(OWNER_FTL, 'f');
+	ftl_trace_register_stages();
 
+#if defined(DEBUG)
 	for (i = 0; i < FTL_TRACE_SOURCE_MAX; ++i) {
 		snprintf(descbuf, sizeof(descbuf), "%c %s", source[i], "band_reloc");
 		spdk_trace_register_description(descbuf, FTL_TRACE_BAND_RELOC(i), OWNER_FTL, OBJECT_NONE, 0, 0,
@@ -120,8 +146,18 @@ SPDK_TRACE_REGISTER_FN(ftl_trace_func, "ftl", TRACE_GROUP_FTL)
 		spdk_trace_register_description(descbuf, FTL_TRACE_WRITE_COMPLETION(i), OWNER_FTL, OBJECT_NONE, 0,
 						0, "lba: ");
 	}
+#endif
 }
 
+void
+ftl_trace_stage(struct spdk_ftl_dev *dev, enum ftl_stats_stage stage, uint64_t latency_us,
+		uint64_t num_blocks)
+{
+	spdk_trace_record(FTL_TRACE_STAGE(stage), 0, num_blocks, 0, latency_us);
+}
+
+#if defined(DEBUG)
+
 static uint64_t
 ftl_trace_next_id(struct ftl_trace *trace)
 {
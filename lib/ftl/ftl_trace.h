@@ -47,4 +47,8 @@ void ftl_trace_limits(struct spdk_ftl_dev *dev, int limit, size_t num_free);
 #define ftl_trace_limits(dev, limits, num_free)
 #endif
 
+/* Stage trace points are recorded in release builds too, to allow tuning FTL under load */
+void ftl_trace_stage(struct spdk_ftl_dev *dev, enum ftl_stats_stage stage, uint64_t latency_us,
+		     uint64_t num_blocks);
+
 #endif /* FTL_TRACE_H */
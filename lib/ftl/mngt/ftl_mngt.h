@@ -320,6 +320,19 @@ int ftl_mngt_call_dev_startup(struct spdk_ftl_dev *dev, ftl_mngt_completion cb,
 int ftl_mngt_unmap(struct spdk_ftl_dev *dev, uint64_t lba, uint64_t num_blocks, spdk_ftl_fn cb,
 		   void *cb_cntx);
 
+/**
+ * @brief Records a completed L2P checkpoint by persisting the superblock
+ *
+ * @param dev FTL device
+ * @param cb Caller callback
+ * @param cb_cntx Caller context
+ *
+ * @return Operation result
+ * @retval 0 The operation successful has started
+ * @retval Non-zero Operation failure
+ */
+int ftl_mngt_l2p_ckpt(struct spdk_ftl_dev *dev, ftl_mngt_completion cb, void *cb_cntx);
+
 /**
  * @brief Shuts down a FTL instance
  *
@@ -236,6 +236,8 @@ ftl_recover_max_seq(struct spdk_ftl_dev *dev)
 	max = spdk_max(max, band_close_seq_id);
 	max = spdk_max(max, chunk_open_seq_id);
 	max = spdk_max(max, chunk_close_seq_id);
+	/* The band or chunk the checkpoint sequence ID was taken from may have been freed */
+	max = spdk_max(max, dev->sb->ckpt_seq_id);
 
 	dev->sb->seq_id = max;
 }
@@ -24,6 +24,13 @@ static struct spdk_bdev_module g_ftl_bdev_module = {
 static inline uint64_t
 ftl_calculate_num_blocks_in_band(struct spdk_bdev_desc *desc)
 {
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+
+	/* Bands of a zoned base device map directly onto its zones */
+	if (spdk_bdev_is_zoned(bdev)) {
+		return spdk_bdev_get_zone_size(bdev);
+	}
+
 	/* TODO: this should be passed via input parameter */
 #ifdef SPDK_FTL_ZONE_EMU_BLOCKS
 	return SPDK_FTL_ZONE_EMU_BLOCKS;
@@ -44,10 +51,40 @@ base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void
 	}
 }
 
+static void
+base_bdev_zone_info_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ftl_mngt_process *mngt = cb_arg;
+	struct spdk_ftl_dev *dev = ftl_mngt_get_dev(mngt);
+	struct spdk_bdev_zone_info *info = ftl_mngt_get_step_ctx(mngt);
+	uint64_t i;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		FTL_ERRLOG(dev, "Unable to get zone info\n");
+		ftl_mngt_fail_step(mngt);
+		return;
+	}
+
+	/* Bands span whole zones, so none of their blocks may be left unwritable */
+	for (i = 0; i < dev->num_bands; i++) {
+		if (info[i].capacity != dev->num_blocks_in_band) {
+			FTL_ERRLOG(dev, "Unsupported zone capacity (%"PRIu64"), must be equal "
+				   "to the zone size (%"PRIu64")\n", info[i].capacity,
+				   dev->num_blocks_in_band);
+			ftl_mngt_fail_step(mngt);
+			return;
+		}
+	}
+
+	ftl_mngt_next_step(mngt);
+}
+
 void
 ftl_mngt_open_base_bdev(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
-	uint32_t block_size;
+	uint32_t block_size, max_append_size;
 	uint64_t num_blocks;
 	const char *bdev_name = dev->conf.base_bdev;
 	struct spdk_bdev *bdev;
@@ -102,17 +139,46 @@ ftl_mngt_open_base_bdev(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 	dev->is_zoned = spdk_bdev_is_zoned(spdk_bdev_desc_get_bdev(dev->base_bdev_desc));
 
 	if (dev->is_zoned) {
-		/* TODO - current FTL code isn't fully compatible with ZNS drives */
-		FTL_ERRLOG(dev, "Creating FTL on Zoned devices is not supported\n");
-		goto error;
+		/*
+		 * Band writes are zone appends of xfer_size blocks each, so the zone needs to hold
+		 * a whole number of them and the device has to accept appends of that size
+		 */
+		if (dev->num_blocks_in_band % dev->xfer_size) {
+			FTL_ERRLOG(dev, "Unsupported zone size (%"PRIu64")\n",
+				   dev->num_blocks_in_band);
+			goto error;
+		}
+
+		max_append_size = spdk_bdev_get_max_zone_append_size(bdev);
+		if (max_append_size && max_append_size < dev->xfer_size) {
+			FTL_ERRLOG(dev, "Unsupported max zone append size (%"PRIu32")\n",
+				   max_append_size);
+			goto error;
+		}
 	}
 
 	dev->num_bands = num_blocks / ftl_get_num_blocks_in_band(dev);
 
-	/* Save a band worth of space for metadata */
-	dev->num_bands--;
+	/*
+	 * Save a band worth of space for metadata. Zoned devices keep the base device metadata on
+	 * the NV cache instead, as it can't be overwritten in place.
+	 */
+	if (!dev->is_zoned) {
+		dev->num_bands--;
+		ftl_mngt_next_step(mngt);
+		return;
+	}
+
+	if (ftl_mngt_alloc_step_ctx(mngt, dev->num_bands * sizeof(struct spdk_bdev_zone_info))) {
+		goto error;
+	}
+
+	if (spdk_bdev_get_zone_info(dev->base_bdev_desc, dev->base_ioch, 0, dev->num_bands,
+				    ftl_mngt_get_step_ctx(mngt), base_bdev_zone_info_cb, mngt)) {
+		FTL_ERRLOG(dev, "Unable to get zone info\n");
+		goto error;
+	}
 
-	ftl_mngt_next_step(mngt);
 	return;
 error:
 	ftl_mngt_fail_step(mngt);
@@ -360,6 +360,31 @@ ftl_mngt_fast_persist_md(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt
 	ftl_mngt_call_process(mngt, &desc_fast_persist);
 }
 
+static void
+init_sb_shard(const struct spdk_ftl_dev *dev, struct ftl_superblock_shard *shard)
+{
+	const struct spdk_uuid *set_uuid = &dev->conf.shard.set_uuid;
+	uint64_t set_id[2];
+
+	SPDK_STATIC_ASSERT(sizeof(set_id) == sizeof(*set_uuid), "Invalid set_id size");
+
+	memset(shard, 0, sizeof(*shard));
+	if (!dev->conf.shard.count) {
+		return;
+	}
+
+	/* The set is identified by the UUID of its first device */
+	if (dev->conf.shard.idx == 0) {
+		set_uuid = &dev->conf.uuid;
+	}
+
+	memcpy(set_id, set_uuid, sizeof(set_id));
+	shard->set_id = set_id[0] ^ set_id[1];
+	shard->idx = dev->conf.shard.idx;
+	shard->count = dev->conf.shard.count;
+	shard->stripe_mib = dev->conf.shard.stripe_mib;
+}
+
 void
 ftl_mngt_init_default_sb(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
@@ -377,6 +402,8 @@ ftl_mngt_init_default_sb(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt
 
 	sb->overprovisioning = dev->conf.overprovisioning;
 
+	init_sb_shard(dev, &sb->shard);
+
 	ftl_band_init_gc_iter(dev);
 
 	/* md layout isn't initialized yet.
@@ -407,6 +434,8 @@ ftl_mngt_set_clean(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 
 	sb->clean = 1;
 	dev->sb_shm->shm_clean = false;
+	/* The whole L2P has been persisted, it's a checkpoint for a later dirty shutdown */
+	sb->ckpt_seq_id = ftl_nv_cache_get_ckpt_seq_id(&dev->nv_cache);
 	sb->header.crc = get_sb_crc(sb);
 	persist(dev, mngt, FTL_LAYOUT_REGION_TYPE_SB);
 
@@ -446,6 +475,7 @@ void
 ftl_mngt_validate_sb(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
 	struct ftl_superblock *sb = dev->sb;
+	struct ftl_superblock_shard shard;
 
 	if (!ftl_superblock_check_magic(sb)) {
 		FTL_ERRLOG(dev, "Invalid FTL superblock magic\n");
@@ -486,6 +516,17 @@ ftl_mngt_validate_sb(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 	}
 	dev->conf.overprovisioning = sb->overprovisioning;
 
+	init_sb_shard(dev, &shard);
+	if (memcmp(&sb->shard, &shard, sizeof(shard))) {
+		FTL_ERRLOG(dev, "Invalid FTL superblock shard %"PRIu16"/%"PRIu16" of set %"PRIx64
+			   " with %"PRIu32" MiB stripe (expected %"PRIu16"/%"PRIu16" of set %"PRIx64
+			   " with %"PRIu32" MiB stripe)\n", sb->shard.idx, sb->shard.count,
+			   sb->shard.set_id, sb->shard.stripe_mib, shard.idx, shard.count,
+			   shard.set_id, shard.stripe_mib);
+		ftl_mngt_fail_step(mngt);
+		return;
+	}
+
 	ftl_mngt_next_step(mngt);
 }
 
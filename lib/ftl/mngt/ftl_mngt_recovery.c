@@ -118,7 +118,7 @@ ftl_mngt_recovery_init(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 	FTL_NOTICELOG(dev, "L2P resident size: %"PRIu64"MiB\n", (uint64_t)(l2p_limit / MiB));
 	FTL_NOTICELOG(dev, "Seq ID resident size: %"PRIu64"MiB\n", (uint64_t)(seq_limit / MiB));
 	FTL_NOTICELOG(dev, "Recovery iterations: %"PRIu64"\n", iterations);
-	dev->sb->ckpt_seq_id = 0;
+	FTL_NOTICELOG(dev, "L2P checkpoint seq ID: %"PRIu64"\n", dev->sb->ckpt_seq_id);
 
 	/* Initialize region */
 	ctx->l2p_snippet.region = dev->layout.region[FTL_LAYOUT_REGION_TYPE_L2P];
@@ -317,6 +317,30 @@ ftl_mngt_recovery_walk_band_tail_md(struct spdk_ftl_dev *dev, struct ftl_mngt_pr
 	}
 }
 
+/*
+ * Checks if an address loaded from the L2P checkpoint still holds the data it was set for, i.e. its
+ * band or chunk hasn't been freed and opened again after the checkpoint was started
+ */
+static bool
+recovery_ckpt_addr_valid(struct spdk_ftl_dev *dev, ftl_addr addr)
+{
+	uint64_t ckpt_seq_id = dev->sb->ckpt_seq_id;
+
+	if (addr == FTL_ADDR_INVALID) {
+		return true;
+	}
+
+	if (ftl_addr_in_nvc(dev, addr)) {
+		struct ftl_nv_cache_chunk *chunk = ftl_nv_cache_get_chunk_from_addr(dev, addr);
+
+		return chunk->md->state != FTL_CHUNK_STATE_FREE && chunk->md->seq_id <= ckpt_seq_id;
+	} else {
+		struct ftl_band *band = ftl_band_from_addr(dev, addr);
+
+		return band->md->state != FTL_BAND_STATE_FREE && band->md->seq <= ckpt_seq_id;
+	}
+}
+
 static void
 ftl_mngt_recovery_iteration_init_seq_ids(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
@@ -324,14 +348,10 @@ ftl_mngt_recovery_iteration_init_seq_ids(struct spdk_ftl_dev *dev, struct ftl_mn
 	struct ftl_md *md = dev->layout.md[FTL_LAYOUT_REGION_TYPE_TRIM_MD];
 	uint64_t *trim_map = ftl_md_get_buffer(md);
 	uint64_t page_id, trim_seq_id;
+	uint64_t ckpt_seq_id = dev->sb->ckpt_seq_id;
 	uint32_t lbas_in_page = FTL_BLOCK_SIZE / dev->layout.l2p.addr_size;
 	uint64_t lba, lba_off;
-
-	if (dev->sb->ckpt_seq_id) {
-		FTL_ERRLOG(dev, "Checkpoint recovery not supported!\n");
-		ftl_mngt_fail_step(mngt);
-		return;
-	}
+	ftl_addr addr;
 
 	for (lba = ctx->iter.lba_first; lba < ctx->iter.lba_last; lba++) {
 		lba_off = lba - ctx->iter.lba_first;
@@ -343,6 +363,19 @@ ftl_mngt_recovery_iteration_init_seq_ids(struct spdk_ftl_dev *dev, struct ftl_mn
 
 		trim_seq_id = trim_map[page_id];
 
+		/*
+		 * All data with sequence ID from the checkpoint on is replayed from the chunks
+		 * and bands closed after it, so keep the checkpointed entry as the older one,
+		 * unless it was unmapped or its location was reused in the meantime.
+		 */
+		if (ckpt_seq_id && trim_seq_id < ckpt_seq_id) {
+			addr = ftl_addr_load(dev, ctx->l2p_snippet.l2p, lba_off);
+			if (recovery_ckpt_addr_valid(dev, addr)) {
+				ctx->l2p_snippet.seq_id[lba_off] = ckpt_seq_id;
+				continue;
+			}
+		}
+
 		ctx->l2p_snippet.seq_id[lba_off] = trim_seq_id;
 		ftl_addr_store(dev, ctx->l2p_snippet.l2p, lba_off, FTL_ADDR_INVALID);
 	}
@@ -708,6 +741,115 @@ ftl_mngt_recovery_open_bands_p2l(struct spdk_ftl_dev *dev, struct ftl_mngt_proce
 	ftl_mngt_continue_step(mngt);
 }
 
+struct zone_wp_ctx {
+	uint64_t id;
+	struct spdk_bdev_zone_info info;
+};
+
+static void
+recovery_zone_tail_md_cb(struct ftl_band *band, void *cntx, enum ftl_md_status status)
+{
+	struct ftl_mngt_process *mngt = cntx;
+	struct zone_wp_ctx *sctx = ftl_mngt_get_step_ctx(mngt);
+
+	if (status != FTL_MD_SUCCESS) {
+		FTL_ERRLOG(band->dev, "Open band recovery ERROR, Cannot read tail md\n");
+		ftl_mngt_fail_step(mngt);
+		return;
+	}
+
+	/* The band only needs its metadata updated to be closed, see ftl_band_close() */
+	ftl_mngt_p2l_ckpt_restore_zone_wp(band, ftl_band_user_blocks(band));
+	band->md->state = FTL_BAND_STATE_FULL;
+	band->md->p2l_map_checksum = spdk_crc32c_update(band->p2l_map.band_map,
+				     ftl_tail_md_num_blocks(band->dev) * FTL_BLOCK_SIZE, 0);
+	band->zone_tail_md_written = true;
+
+	FTL_NOTICELOG(band->dev, "Open band zone full, id = %u, P2L map read from tail md\n",
+		      band->id);
+
+	sctx->id++;
+	ftl_mngt_continue_step(mngt);
+}
+
+static void
+recovery_zone_info_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ftl_mngt_process *mngt = cb_arg;
+	struct spdk_ftl_dev *dev = ftl_mngt_get_dev(mngt);
+	struct zone_wp_ctx *sctx = ftl_mngt_get_step_ctx(mngt);
+	struct ftl_band *band = &dev->bands[sctx->id];
+	uint64_t offset;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		FTL_ERRLOG(dev, "Open band recovery ERROR, Cannot get zone info\n");
+		ftl_mngt_fail_step(mngt);
+		return;
+	}
+
+	if (sctx->info.state == SPDK_BDEV_ZONE_STATE_FULL) {
+		/* Dirty shutdown after writing the tail md, but before the band md was updated */
+		ftl_band_read_tail_brq_md(band, recovery_zone_tail_md_cb, mngt);
+		return;
+	}
+
+	/*
+	 * Appends, which completed on the device but didn't get their P2L checkpointed, still
+	 * moved the write pointer. The band needs to continue from there and the blocks in between
+	 * are left without valid P2L entries.
+	 */
+	offset = sctx->info.write_pointer - band->start_addr;
+	if (offset > band->md->iter.offset) {
+		assert(offset % dev->xfer_size == 0);
+		assert(offset <= ftl_band_user_blocks(band));
+
+		ftl_mngt_p2l_ckpt_restore_zone_wp(band, offset);
+		if (ftl_band_filled(band, band->md->iter.offset)) {
+			band->md->state = FTL_BAND_STATE_FULL;
+		}
+
+		FTL_NOTICELOG(dev, "Open band write pointer moved, id = %u, write offset %"
+			      PRIu64"\n", band->id, band->md->iter.offset);
+	}
+
+	sctx->id++;
+	ftl_mngt_continue_step(mngt);
+}
+
+static void
+ftl_mngt_recovery_zone_wp(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
+{
+	struct zone_wp_ctx *sctx = ftl_mngt_get_step_ctx(mngt);
+	struct ftl_band *band;
+	int rc;
+
+	if (!dev->is_zoned) {
+		ftl_mngt_skip_step(mngt);
+		return;
+	}
+
+	for (; sctx->id < ftl_get_num_bands(dev); sctx->id++) {
+		band = &dev->bands[sctx->id];
+
+		if (FTL_BAND_STATE_OPEN != band->md->state &&
+		    FTL_BAND_STATE_FULL != band->md->state) {
+			continue;
+		}
+
+		rc = spdk_bdev_get_zone_info(dev->base_bdev_desc, dev->base_ioch, band->start_addr,
+					     1, &sctx->info, recovery_zone_info_cb, mngt);
+		if (rc) {
+			FTL_ERRLOG(dev, "Open band recovery ERROR, Cannot get zone info\n");
+			ftl_mngt_fail_step(mngt);
+		}
+		return;
+	}
+
+	ftl_mngt_next_step(mngt);
+}
+
 static void
 ftl_mngt_restore_valid_counters(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
@@ -890,6 +1032,11 @@ static const struct ftl_mngt_process_desc g_desc_recovery = {
 			.name = "Recover open bands P2L",
 			.action = ftl_mngt_recovery_open_bands_p2l
 		},
+		{
+			.name = "Recover zone write pointers",
+			.ctx_size = sizeof(struct zone_wp_ctx),
+			.action = ftl_mngt_recovery_zone_wp
+		},
 		{
 			.name = "Recover chunk state",
 			.action = ftl_mngt_nv_cache_restore_chunk_state
@@ -161,5 +161,18 @@ ftl_conf_is_valid(const struct spdk_ftl_conf *conf)
 		return false;
 	}
 
+	if (conf->gc_policy >= SPDK_FTL_GC_POLICY_MAX) {
+		return false;
+	}
+
+	if (conf->l2p_evict_policy >= SPDK_FTL_L2P_EVICT_MAX) {
+		return false;
+	}
+
+	if (conf->shard.count && (conf->shard.idx >= conf->shard.count ||
+				  conf->shard.count > UINT16_MAX || conf->shard.stripe_mib == 0)) {
+		return false;
+	}
+
 	return true;
 }
@@ -0,0 +1,149 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/util.h"
+
+#include "ftl_sketch.h"
+
+struct ftl_sketch {
+	/* FTL_SKETCH_DEPTH rows of counters */
+	uint8_t *counters;
+
+	/* Number of counters per row (power of two) */
+	uint64_t width;
+
+	/* log2(width), used to take the top bits of the hash */
+	uint32_t width_shift;
+
+	/* Number of added keys after which all counters have been halved */
+	uint64_t window;
+
+	/* Next counter to be halved */
+	uint64_t age_pos;
+
+	/*
+	 * Counters are halved a slice at a time, spread evenly over the window. Each added key
+	 * earns FTL_SKETCH_DEPTH * width credit and halving a counter costs window of it.
+	 */
+	uint64_t age_credit;
+};
+
+/* Odd multipliers for the multiply-shift hash, one per row */
+static const uint64_t g_sketch_seeds[FTL_SKETCH_DEPTH] = {
+	0x9e3779b97f4a7c15ULL,
+	0xc2b2ae3d27d4eb4fULL,
+	0x165667b19e3779f9ULL,
+	0xd6e8feb86659fd93ULL,
+};
+
+static inline uint8_t *
+sketch_counter(const struct ftl_sketch *sketch, uint32_t row, uint64_t key)
+{
+	uint64_t idx = (key * g_sketch_seeds[row]) >> (64 - sketch->width_shift);
+
+	return &sketch->counters[row * sketch->width + idx];
+}
+
+struct ftl_sketch *
+ftl_sketch_create(uint64_t width, uint64_t window)
+{
+	struct ftl_sketch *sketch;
+
+	sketch = calloc(1, sizeof(*sketch));
+	if (!sketch) {
+		return NULL;
+	}
+
+	sketch->width = spdk_align64pow2(spdk_max(width, 2));
+	sketch->width_shift = spdk_u64log2(sketch->width);
+	sketch->window = spdk_max(window, 1);
+
+	sketch->counters = calloc(FTL_SKETCH_DEPTH, sketch->width);
+	if (!sketch->counters) {
+		free(sketch);
+		return NULL;
+	}
+
+	return sketch;
+}
+
+void
+ftl_sketch_destroy(struct ftl_sketch *sketch)
+{
+	if (!sketch) {
+		return;
+	}
+
+	free(sketch->counters);
+	free(sketch);
+}
+
+/*
+ * Halves the next slice of counters, at most ceil(FTL_SKETCH_DEPTH * width / window) of them,
+ * so that each counter is halved exactly once per window without stalling a single add.
+ */
+static void
+sketch_age(struct ftl_sketch *sketch)
+{
+	uint64_t num_counters = FTL_SKETCH_DEPTH * sketch->width;
+
+	sketch->age_credit += num_counters;
+	while (sketch->age_credit >= sketch->window) {
+		sketch->age_credit -= sketch->window;
+		sketch->counters[sketch->age_pos] >>= 1;
+
+		if (++sketch->age_pos == num_counters) {
+			sketch->age_pos = 0;
+		}
+	}
+}
+
+void
+ftl_sketch_add(struct ftl_sketch *sketch, uint64_t key)
+{
+	uint8_t *counter[FTL_SKETCH_DEPTH];
+	uint8_t min = UINT8_MAX;
+	uint32_t i;
+
+	for (i = 0; i < FTL_SKETCH_DEPTH; i++) {
+		counter[i] = sketch_counter(sketch, i, key);
+		min = spdk_min(min, *counter[i]);
+	}
+
+	/*
+	 * Conservative update - only the counters holding the current estimate are incremented,
+	 * the others already overestimate the key due to collisions.
+	 */
+	if (min < UINT8_MAX) {
+		for (i = 0; i < FTL_SKETCH_DEPTH; i++) {
+			if (*counter[i] == min) {
+				(*counter[i])++;
+			}
+		}
+	}
+
+	sketch_age(sketch);
+}
+
+uint8_t
+ftl_sketch_estimate(const struct ftl_sketch *sketch, uint64_t key)
+{
+	uint8_t min = UINT8_MAX;
+	uint32_t i;
+
+	for (i = 0; i < FTL_SKETCH_DEPTH; i++) {
+		min = spdk_min(min, *sketch_counter(sketch, i, key));
+	}
+
+	return min;
+}
+
+void
+ftl_sketch_reset(struct ftl_sketch *sketch)
+{
+	memset(sketch->counters, 0, FTL_SKETCH_DEPTH * sketch->width);
+	sketch->age_pos = 0;
+	sketch->age_credit = 0;
+}
@@ -0,0 +1,64 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef FTL_SKETCH_H_
+#define FTL_SKETCH_H_
+
+#include "spdk/stdinc.h"
+
+/*
+ * Count-min sketch estimating how often a key (e.g. an LBA) has been seen recently. Each key maps
+ * to one saturating counter in each of the FTL_SKETCH_DEPTH rows and the estimate is the minimum of
+ * them, so it can only overestimate. Counters are halved gradually, a slice on each added key, so
+ * that all of them are halved once per the configured number of added keys. This lets the sketch
+ * forget about keys that are no longer accessed.
+ */
+#define FTL_SKETCH_DEPTH	4
+
+struct ftl_sketch;
+
+/**
+ * @brief Creates a sketch object
+ *
+ * @param width Number of counters per row, rounded up to a power of two
+ * @param window Number of added keys over which all counters are halved once
+ *
+ * @return On success - pointer to the allocated sketch object, otherwise NULL
+ */
+struct ftl_sketch *ftl_sketch_create(uint64_t width, uint64_t window);
+
+/**
+ * @brief Destroys the sketch object
+ *
+ * @param sketch The sketch
+ */
+void ftl_sketch_destroy(struct ftl_sketch *sketch);
+
+/**
+ * @brief Records an occurrence of the key
+ *
+ * @param sketch The sketch
+ * @param key The key
+ */
+void ftl_sketch_add(struct ftl_sketch *sketch, uint64_t key);
+
+/**
+ * @brief Estimates the number of recent occurrences of the key
+ *
+ * @param sketch The sketch
+ * @param key The key
+ *
+ * @return Estimated count (never lower than the real count since its counters were halved)
+ */
+uint8_t ftl_sketch_estimate(const struct ftl_sketch *sketch, uint64_t key);
+
+/**
+ * @brief Clears all counters
+ *
+ * @param sketch The sketch
+ */
+void ftl_sketch_reset(struct ftl_sketch *sketch);
+
+#endif /* FTL_SKETCH_H_ */
@@ -10,6 +10,7 @@
 #include "spdk/env.h"
 #include "spdk/string.h"
 #include "spdk/bit_array.h"
+#include "spdk/crc32.h"
 #include "spdk/util.h"
 #include "spdk/log.h"
 #include "spdk/memory.h"
@@ -26,11 +27,14 @@
 
 #define REDUCE_NUM_VOL_REQUESTS	256
 
+#define REDUCE_VOL_SUPPORTED_FLAGS	(SPDK_REDUCE_VOL_FLAG_PACKED | \
+					 SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD)
+
 /* Structure written to offset 0 of both the pm file and the backing device. */
 struct spdk_reduce_vol_superblock {
 	uint8_t				signature[8];
 	struct spdk_reduce_vol_params	params;
-	uint8_t				reserved[4048];
+	uint8_t				reserved[4032];
 };
 SPDK_STATIC_ASSERT(sizeof(struct spdk_reduce_vol_superblock) == 4096, "size incorrect");
 
@@ -54,15 +58,149 @@ struct spdk_reduce_pm_file {
 	uint64_t		size;
 };
 
+/*
+ * Volumes with SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD keep the contents of the pm file in memory.
+ *  They are persisted to a region of the backing device following the last backing io unit,
+ *  made of a header page, a write-ahead log of updates to the maps and a checkpoint of the
+ *  maps (the pm file without its superblock).
+ */
+#define REDUCE_MD_PAGE_SIZE	4096
+#define REDUCE_MD_LOG_SIZE	(1024 * 1024)
+#define REDUCE_MD_LOG_OFFSET	REDUCE_MD_PAGE_SIZE
+#define REDUCE_MD_IMAGE_OFFSET	(REDUCE_MD_LOG_OFFSET + REDUCE_MD_LOG_SIZE)
+/* Size of the buffer used to read and write the checkpoint, and to read the log at load. */
+#define REDUCE_MD_IO_BUF_SIZE	REDUCE_MD_LOG_SIZE
+
+#define REDUCE_MD_SIGNATURE "SPDKRDMD"
+
+struct reduce_md_header {
+	uint8_t			signature[8];
+	struct spdk_uuid	uuid;
+	/* Sequence number of the first log page to replay on top of the checkpoint */
+	uint64_t		log_start_seq;
+	uint32_t		crc;
+	uint8_t			reserved[4060];
+};
+SPDK_STATIC_ASSERT(sizeof(struct reduce_md_header) == REDUCE_MD_PAGE_SIZE, "size incorrect");
+
+/* Log page with sequence number seq is stored at page seq % number of log pages. */
+struct reduce_md_log_page {
+	uint64_t		seq;
+	struct spdk_uuid	uuid;
+	/* Number of bytes of records following the header */
+	uint32_t		length;
+	uint32_t		crc;
+	uint8_t			records[];
+};
+
+#define REDUCE_MD_LOG_CHUNK_MAP		1
+#define REDUCE_MD_LOG_LOGICAL_MAP	2
+
+struct reduce_md_log_record {
+	uint32_t		type;
+	uint32_t		length;
+	/* Chunk map or logical map index */
+	uint64_t		index;
+	/* Chunk map, or chunk map index of the logical map entry */
+	uint8_t			data[];
+};
+
+/* Records appended while the previous ones are written, committed by a single write. */
+struct reduce_md_log_buf {
+	uint8_t					*buf;
+	uint32_t				num_pages;
+	/* Offset of the next record in the last page */
+	uint32_t				offset;
+	TAILQ_HEAD(, spdk_reduce_vol_request)	reqs;
+};
+
+typedef void (*reduce_md_op_complete)(void *cb_arg, int reduce_errno);
+
+struct reduce_md {
+	/* Offset of the region on the backing device, in bytes */
+	uint64_t				offset;
+	uint64_t				image_size;
+	uint32_t				image_pages;
+	uint32_t				log_pages;
+	uint32_t				log_buf_pages;
+
+	/* Sequence number of the next log page to write */
+	uint64_t				head_seq;
+	/* Sequence number of the first log page needed by the checkpoint on disk */
+	uint64_t				tail_seq;
+	struct reduce_md_log_buf		log_bufs[2];
+	struct reduce_md_log_buf		*open_buf;
+	struct reduce_md_log_buf		*flush_buf;
+	bool					log_full;
+	/* A log write failed at log_failed_seq. Nothing more is logged until a checkpoint
+	 *  started after it completes, as the log on disk has a hole there.
+	 */
+	bool					log_failed;
+	uint64_t				log_failed_seq;
+	/* Nesting depth of _reduce_md_log_flush_done() */
+	uint32_t				flush_done_depth;
+	int					num_log_ios;
+	int					log_errno;
+	struct iovec				log_iov[2];
+	struct spdk_reduce_vol_cb_args		log_cb_args[2];
+
+	/* Pages of the maps modified since the last checkpoint started */
+	struct spdk_bit_array			*dirty_pages;
+	/* Pages left to write by the checkpoint in progress */
+	struct spdk_bit_array			*cp_pages;
+	bool					cp_running;
+	uint64_t				cp_start_seq;
+	uint32_t				cp_next_page;
+	uint32_t				cp_run_pages;
+	reduce_md_op_complete			cp_cb_fn;
+	void					*cp_cb_arg;
+	reduce_md_op_complete			close_cb_fn;
+	void					*close_cb_arg;
+
+	uint8_t					*io_buf;
+	struct reduce_md_header			*header;
+	struct iovec				iov;
+	struct spdk_reduce_vol_cb_args		backing_cb_args;
+};
+
 #define REDUCE_IO_READV		1
 #define REDUCE_IO_WRITEV	2
+#define REDUCE_IO_COMPACT	3
 
 struct spdk_reduce_chunk_map {
 	uint32_t		compressed_size;
-	uint32_t		reserved;
+	/* Packed volumes only - offset in bytes of the fragment, the end of the
+	 *  compressed data that does not fill a whole io unit, in the last io unit.
+	 */
+	uint32_t		fragment_offset;
 	uint64_t		io_unit_index[0];
 };
 
+/* Number of io units a packed volume can be writing fragments to at the same time. */
+#define REDUCE_NUM_PACK_UNITS	8
+
+/**
+ * Backing io unit collecting the fragments of compressed chunks in a packed volume.
+ *  Only the open pack unit of a volume accepts new fragments.  Fragments are copied
+ *  to buf and written with the whole io unit, one write at a time, so that a write
+ *  never races with an older write of the same io unit.  A fragment's chunk
+ *  is complete once a write that included the fragment has completed.
+ */
+struct reduce_pack_unit {
+	struct spdk_reduce_vol			*vol;
+	uint8_t					*buf;
+	uint64_t				io_unit_index;
+	uint32_t				offset;
+	bool					flushing;
+	/* Requests whose fragments are not part of a write yet */
+	TAILQ_HEAD(, spdk_reduce_vol_request)	pending;
+	/* Requests whose fragments are part of the write in progress */
+	TAILQ_HEAD(, spdk_reduce_vol_request)	flushing_reqs;
+	struct iovec				iov;
+	struct spdk_reduce_vol_cb_args		backing_cb_args;
+	TAILQ_ENTRY(reduce_pack_unit)		link;
+};
+
 struct spdk_reduce_vol_request {
 	/**
 	 *  Scratch buffer used for uncompressed chunk.  This is used for:
@@ -110,6 +248,24 @@ struct spdk_reduce_vol_request {
 	void					*cb_arg;
 	TAILQ_ENTRY(spdk_reduce_vol_request)	tailq;
 	struct spdk_reduce_vol_cb_args		backing_cb_args;
+	/* Pack unit the chunk's fragment is written to, packed volumes only */
+	struct reduce_pack_unit			*pack_unit;
+	TAILQ_ENTRY(spdk_reduce_vol_request)	pack_tailq;
+	/* Link in the log buffer holding the request's metadata updates */
+	TAILQ_ENTRY(spdk_reduce_vol_request)	md_tailq;
+};
+
+/*
+ * Number of decompressed chunks kept per volume, so that small reads within a chunk
+ *  do not read and decompress it again.
+ */
+#define REDUCE_NUM_CACHE_CHUNKS	8
+
+struct reduce_cache_entry {
+	/* Logical map index of the chunk, REDUCE_EMPTY_MAP_ENTRY if the entry is unused */
+	uint64_t				logical_map_index;
+	uint8_t					*buf;
+	TAILQ_ENTRY(reduce_cache_entry)		tailq;
 };
 
 struct spdk_reduce_vol {
@@ -123,10 +279,32 @@ struct spdk_reduce_vol {
 	struct spdk_reduce_vol_superblock	*pm_super;
 	uint64_t				*pm_logical_map;
 	uint64_t				*pm_chunk_maps;
+	/* Volumes with metadata on the backing device only */
+	struct reduce_md			*md;
 
 	struct spdk_bit_array			*allocated_chunk_maps;
 	struct spdk_bit_array			*allocated_backing_io_units;
 
+	/* Packed volumes only - number of chunk maps referencing each backing io unit,
+	 *  plus one while it is a pack unit.
+	 */
+	uint8_t					*io_unit_refs;
+	struct reduce_pack_unit			*pack_units;
+	uint8_t					*pack_buf_mem;
+	TAILQ_HEAD(, reduce_pack_unit)		free_pack_units;
+	struct reduce_pack_unit			*open_pack_unit;
+
+	struct {
+		spdk_reduce_vol_op_complete	cb_fn;
+		void				*cb_arg;
+		/* Logical map index the next compaction starts at */
+		uint64_t			next_index;
+		uint32_t			outstanding;
+		int				status;
+	} compact;
+	spdk_reduce_vol_op_complete		unload_cb_fn;
+	void					*unload_cb_arg;
+
 	struct spdk_reduce_vol_request		*request_mem;
 	TAILQ_HEAD(, spdk_reduce_vol_request)	free_requests;
 	TAILQ_HEAD(, spdk_reduce_vol_request)	executing_requests;
@@ -135,6 +313,11 @@ struct spdk_reduce_vol {
 	/* Single contiguous buffer used for all request buffers for this volume. */
 	uint8_t					*buf_mem;
 	struct iovec				*buf_iov_mem;
+
+	/* Cached chunks, most recently used first */
+	TAILQ_HEAD(reduce_cache_lru, reduce_cache_entry)	cache_lru;
+	struct reduce_cache_entry		*cache_entries;
+	uint8_t					*cache_buf_mem;
 };
 
 static void _start_readv_request(struct spdk_reduce_vol_request *req);
@@ -150,10 +333,15 @@ static int g_vol_count = 0;
  */
 #define REDUCE_NUM_EXTRA_CHUNKS 128
 
+static void _reduce_md_set_dirty(struct spdk_reduce_vol *vol, const void *addr, size_t len);
+
 static void
 _reduce_persist(struct spdk_reduce_vol *vol, const void *addr, size_t len)
 {
-	if (vol->pm_file.pm_is_pmem) {
+	if (vol->md != NULL) {
+		/* Written by the next checkpoint, updates are made durable by the log. */
+		_reduce_md_set_dirty(vol, addr, len);
+	} else if (vol->pm_file.pm_is_pmem) {
 		pmem_persist(addr, len);
 	} else {
 		pmem_msync(addr, len);
@@ -218,6 +406,70 @@ _reduce_vol_get_chunk_map(struct spdk_reduce_vol *vol, uint64_t chunk_map_index)
 	return (struct spdk_reduce_chunk_map *)chunk_map_addr;
 }
 
+static inline bool
+_reduce_vol_is_packed(struct spdk_reduce_vol *vol)
+{
+	return vol->params.flags & SPDK_REDUCE_VOL_FLAG_PACKED;
+}
+
+/* Size of the fragment of a chunk, 0 if the volume isn't packed or the compressed data
+ *  of the chunk fills whole io units.
+ */
+static inline uint32_t
+_reduce_vol_fragment_size(struct spdk_reduce_vol *vol, struct spdk_reduce_chunk_map *chunk)
+{
+	if (!_reduce_vol_is_packed(vol)) {
+		return 0;
+	}
+
+	return chunk->compressed_size % vol->params.backing_io_unit_size;
+}
+
+/* Blocks of the backing device holding the fragment of a chunk, stored in the given io unit. */
+static void
+_reduce_vol_get_fragment_blocks(struct spdk_reduce_vol *vol, struct spdk_reduce_chunk_map *chunk,
+				uint32_t io_unit, uint32_t fragment_size,
+				uint64_t *lba, uint32_t *lba_count)
+{
+	uint32_t blocklen = vol->backing_dev->blocklen;
+	uint32_t first_block = chunk->fragment_offset / blocklen;
+
+	*lba = chunk->io_unit_index[io_unit] * vol->backing_lba_per_io_unit + first_block;
+	*lba_count = spdk_divide_round_up(chunk->fragment_offset + fragment_size, blocklen) -
+		     first_block;
+}
+
+static uint64_t
+_reduce_vol_get_io_unit(struct spdk_reduce_vol *vol)
+{
+	uint64_t io_unit_index;
+
+	io_unit_index = spdk_bit_array_find_first_clear(vol->allocated_backing_io_units, 0);
+	/* TODO: fail if no backing block found - but really this should also not
+	 * happen (see comment in _reduce_vol_write_chunk).
+	 */
+	assert(io_unit_index != UINT32_MAX);
+	spdk_bit_array_set(vol->allocated_backing_io_units, io_unit_index);
+	if (vol->io_unit_refs != NULL) {
+		vol->io_unit_refs[io_unit_index] = 1;
+	}
+
+	return io_unit_index;
+}
+
+static void
+_reduce_vol_put_io_unit(struct spdk_reduce_vol *vol, uint64_t io_unit_index)
+{
+	assert(spdk_bit_array_get(vol->allocated_backing_io_units, io_unit_index) == true);
+	if (vol->io_unit_refs != NULL) {
+		assert(vol->io_unit_refs[io_unit_index] > 0);
+		if (--vol->io_unit_refs[io_unit_index] > 0) {
+			return;
+		}
+	}
+	spdk_bit_array_clear(vol->allocated_backing_io_units, io_unit_index);
+}
+
 static int
 _validate_vol_params(struct spdk_reduce_vol_params *params)
 {
@@ -244,6 +496,10 @@ _validate_vol_params(struct spdk_reduce_vol_params *params)
 		return -1;
 	}
 
+	if ((params->flags & ~REDUCE_VOL_SUPPORTED_FLAGS) != 0) {
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -273,6 +529,35 @@ _get_pm_file_size(struct spdk_reduce_vol_params *params)
 	return total_pm_size;
 }
 
+static inline bool
+_reduce_vol_md_on_backing_dev(const struct spdk_reduce_vol_params *params)
+{
+	return params->flags & SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD;
+}
+
+/* Size of the checkpoint of the maps, i.e. the pm file without the superblock. */
+static uint64_t
+_get_md_image_size(struct spdk_reduce_vol_params *params)
+{
+	uint64_t size;
+
+	size = _get_pm_file_size(params) - sizeof(struct spdk_reduce_vol_superblock);
+	return spdk_divide_round_up(size, REDUCE_MD_PAGE_SIZE) * REDUCE_MD_PAGE_SIZE;
+}
+
+static uint64_t
+_get_backing_dev_md_size(struct spdk_reduce_vol_params *params)
+{
+	return REDUCE_MD_IMAGE_OFFSET + _get_md_image_size(params);
+}
+
+/* The metadata region follows the last backing io unit. */
+static uint64_t
+_get_backing_dev_md_offset(struct spdk_reduce_vol_params *params)
+{
+	return _get_total_chunks(params->vol_size, params->chunk_size) * params->chunk_size;
+}
+
 const struct spdk_uuid *
 spdk_reduce_vol_get_uuid(struct spdk_reduce_vol *vol)
 {
@@ -295,6 +580,438 @@ _initialize_vol_pm_pointers(struct spdk_reduce_vol *vol)
 	vol->pm_chunk_maps = (uint64_t *)((uint8_t *)vol->pm_logical_map + logical_map_size);
 }
 
+static inline uint8_t *
+_reduce_md_image(struct spdk_reduce_vol *vol)
+{
+	return (uint8_t *)vol->pm_file.pm_buf + sizeof(struct spdk_reduce_vol_superblock);
+}
+
+static inline uint64_t
+_reduce_md_lba(struct spdk_reduce_vol *vol, uint64_t offset)
+{
+	return (vol->md->offset + offset) / vol->backing_dev->blocklen;
+}
+
+static inline uint32_t
+_reduce_md_lba_count(struct spdk_reduce_vol *vol, uint64_t length)
+{
+	return length / vol->backing_dev->blocklen;
+}
+
+static void
+_reduce_md_set_dirty(struct spdk_reduce_vol *vol, const void *addr, size_t len)
+{
+	uint64_t offset = (const uint8_t *)addr - _reduce_md_image(vol);
+	uint32_t page;
+
+	assert(offset + len <= vol->md->image_size);
+	for (page = offset / REDUCE_MD_PAGE_SIZE; page * REDUCE_MD_PAGE_SIZE < offset + len; page++) {
+		spdk_bit_array_set(vol->md->dirty_pages, page);
+	}
+}
+
+static void
+_reduce_md_free(struct spdk_reduce_vol *vol)
+{
+	struct reduce_md *md = vol->md;
+	int i;
+
+	if (md == NULL) {
+		return;
+	}
+
+	for (i = 0; i < 2; i++) {
+		spdk_free(md->log_bufs[i].buf);
+	}
+	spdk_bit_array_free(&md->dirty_pages);
+	spdk_bit_array_free(&md->cp_pages);
+	spdk_free(md->io_buf);
+	spdk_free(md->header);
+	free(md);
+	vol->md = NULL;
+}
+
+/* Allocates the in memory copy of the pm file and the state of the log and checkpoints. */
+static int
+_reduce_md_alloc(struct spdk_reduce_vol *vol)
+{
+	struct reduce_md *md;
+	uint32_t chunk_struct_size, max_record, page_space;
+	int i;
+
+	md = calloc(1, sizeof(*md));
+	if (md == NULL) {
+		return -ENOMEM;
+	}
+	vol->md = md;
+
+	if (REDUCE_MD_PAGE_SIZE % vol->backing_dev->blocklen != 0) {
+		return -EINVAL;
+	}
+
+	/* The chunk map and logical map records of a request must fit in a log page. */
+	chunk_struct_size = _reduce_vol_get_chunk_struct_size(vol->backing_io_units_per_chunk);
+	max_record = sizeof(struct reduce_md_log_record) + chunk_struct_size;
+	page_space = REDUCE_MD_PAGE_SIZE - sizeof(struct reduce_md_log_page);
+	if (2 * max_record > page_space) {
+		return -EINVAL;
+	}
+
+	md->offset = _get_backing_dev_md_offset(&vol->params);
+	md->image_size = _get_md_image_size(&vol->params);
+	md->image_pages = md->image_size / REDUCE_MD_PAGE_SIZE;
+	md->log_pages = REDUCE_MD_LOG_SIZE / REDUCE_MD_PAGE_SIZE;
+	/* Enough for the records of all requests, a page may leave up to a record unused. */
+	md->log_buf_pages = spdk_divide_round_up(REDUCE_NUM_VOL_REQUESTS * 2 * max_record,
+			    page_space - max_record);
+
+	for (i = 0; i < 2; i++) {
+		md->log_bufs[i].buf = spdk_zmalloc(md->log_buf_pages * REDUCE_MD_PAGE_SIZE,
+						   REDUCE_MD_PAGE_SIZE, NULL, SPDK_ENV_LCORE_ID_ANY,
+						   SPDK_MALLOC_DMA);
+		if (md->log_bufs[i].buf == NULL) {
+			return -ENOMEM;
+		}
+		TAILQ_INIT(&md->log_bufs[i].reqs);
+	}
+	md->open_buf = &md->log_bufs[0];
+
+	md->dirty_pages = spdk_bit_array_create(md->image_pages);
+	md->cp_pages = spdk_bit_array_create(md->image_pages);
+	md->io_buf = spdk_zmalloc(REDUCE_MD_IO_BUF_SIZE, REDUCE_MD_PAGE_SIZE, NULL,
+				  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	md->header = spdk_zmalloc(sizeof(*md->header), REDUCE_MD_PAGE_SIZE, NULL,
+				  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (md->dirty_pages == NULL || md->cp_pages == NULL || md->io_buf == NULL ||
+	    md->header == NULL) {
+		return -ENOMEM;
+	}
+
+	/* The checkpoint is written in whole pages, so the last one is allocated in full. */
+	vol->pm_file.size = _get_pm_file_size(&vol->params);
+	vol->pm_file.pm_buf = calloc(1, sizeof(struct spdk_reduce_vol_superblock) + md->image_size);
+	if (vol->pm_file.pm_buf == NULL) {
+		return -ENOMEM;
+	}
+
+	_initialize_vol_pm_pointers(vol);
+	return 0;
+}
+
+static void _reduce_md_log_flush(struct spdk_reduce_vol *vol);
+static void _reduce_md_try_close(struct spdk_reduce_vol *vol);
+
+static void
+_reduce_md_checkpoint_done(struct spdk_reduce_vol *vol, int reduce_errno)
+{
+	struct reduce_md *md = vol->md;
+	reduce_md_op_complete cb_fn = md->cp_cb_fn;
+	void *cb_arg = md->cp_cb_arg;
+
+	md->cp_running = false;
+	md->cp_cb_fn = NULL;
+	if (reduce_errno == 0) {
+		/* The log before the checkpoint is not needed anymore. */
+		md->tail_seq = md->cp_start_seq;
+		if (md->log_failed && md->cp_start_seq >= md->log_failed_seq) {
+			md->log_failed = false;
+		}
+	} else {
+		SPDK_ERRLOG("could not write metadata checkpoint: %d\n", reduce_errno);
+	}
+
+	if (md->log_full) {
+		md->log_full = false;
+		_reduce_md_log_flush(vol);
+	}
+	_reduce_md_try_close(vol);
+
+	if (cb_fn != NULL) {
+		cb_fn(cb_arg, reduce_errno);
+	}
+}
+
+static void
+_reduce_md_write_header_done(void *cb_arg, int reduce_errno)
+{
+	_reduce_md_checkpoint_done(cb_arg, reduce_errno);
+}
+
+static void
+_reduce_md_write_header(struct spdk_reduce_vol *vol)
+{
+	struct reduce_md *md = vol->md;
+	struct reduce_md_header *header = md->header;
+
+	memset(header, 0, sizeof(*header));
+	memcpy(header->signature, REDUCE_MD_SIGNATURE, sizeof(header->signature));
+	header->uuid = vol->params.uuid;
+	header->log_start_seq = md->cp_start_seq;
+	header->crc = spdk_crc32c_update(header, offsetof(struct reduce_md_header, crc), ~0);
+
+	md->iov.iov_base = header;
+	md->iov.iov_len = sizeof(*header);
+	md->backing_cb_args.cb_fn = _reduce_md_write_header_done;
+	md->backing_cb_args.cb_arg = vol;
+	vol->backing_dev->writev(vol->backing_dev, &md->iov, 1, _reduce_md_lba(vol, 0),
+				 _reduce_md_lba_count(vol, sizeof(*header)), &md->backing_cb_args);
+}
+
+static void _reduce_md_checkpoint_write(struct spdk_reduce_vol *vol);
+
+static void
+_reduce_md_checkpoint_write_done(void *cb_arg, int reduce_errno)
+{
+	struct spdk_reduce_vol *vol = cb_arg;
+	struct reduce_md *md = vol->md;
+	uint32_t page;
+
+	if (reduce_errno != 0) {
+		/* Leave what was not written to the next checkpoint. */
+		page = md->cp_next_page - md->cp_run_pages;
+		while (page != UINT32_MAX) {
+			spdk_bit_array_set(md->dirty_pages, page);
+			spdk_bit_array_clear(md->cp_pages, page);
+			page = spdk_bit_array_find_first_set(md->cp_pages, page + 1);
+		}
+		_reduce_md_checkpoint_done(vol, reduce_errno);
+		return;
+	}
+
+	_reduce_md_checkpoint_write(vol);
+}
+
+/* Writes the next run of pages modified before the checkpoint started. */
+static void
+_reduce_md_checkpoint_write(struct spdk_reduce_vol *vol)
+{
+	struct reduce_md *md = vol->md;
+	uint32_t first, count, max_count = REDUCE_MD_IO_BUF_SIZE / REDUCE_MD_PAGE_SIZE;
+
+	first = spdk_bit_array_find_first_set(md->cp_pages, md->cp_next_page);
+	if (first == UINT32_MAX) {
+		_reduce_md_write_header(vol);
+		return;
+	}
+
+	for (count = 0; count < max_count && first + count < md->image_pages; count++) {
+		if (!spdk_bit_array_get(md->cp_pages, first + count)) {
+			break;
+		}
+		spdk_bit_array_clear(md->cp_pages, first + count);
+	}
+	md->cp_next_page = first + count;
+	md->cp_run_pages = count;
+
+	/* Copied so the maps can change while the pages are written. */
+	memcpy(md->io_buf, _reduce_md_image(vol) + (uint64_t)first * REDUCE_MD_PAGE_SIZE,
+	       (uint64_t)count * REDUCE_MD_PAGE_SIZE);
+	md->iov.iov_base = md->io_buf;
+	md->iov.iov_len = (uint64_t)count * REDUCE_MD_PAGE_SIZE;
+	md->backing_cb_args.cb_fn = _reduce_md_checkpoint_write_done;
+	md->backing_cb_args.cb_arg = vol;
+	vol->backing_dev->writev(vol->backing_dev, &md->iov, 1,
+				 _reduce_md_lba(vol, REDUCE_MD_IMAGE_OFFSET +
+						(uint64_t)first * REDUCE_MD_PAGE_SIZE),
+				 _reduce_md_lba_count(vol, md->iov.iov_len), &md->backing_cb_args);
+}
+
+/*
+ * Writes the pages of the maps modified since the previous checkpoint, then the header
+ *  pointing at the log written from now on.  Must be started with no log write in
+ *  progress, so that all the updates logged before are already applied to the maps.
+ */
+static void
+_reduce_md_checkpoint(struct spdk_reduce_vol *vol, reduce_md_op_complete cb_fn, void *cb_arg)
+{
+	struct reduce_md *md = vol->md;
+	struct spdk_bit_array *pages;
+
+	assert(!md->cp_running);
+	assert(md->flush_buf == NULL);
+
+	md->cp_running = true;
+	md->cp_cb_fn = cb_fn;
+	md->cp_cb_arg = cb_arg;
+	md->cp_start_seq = md->head_seq;
+	md->cp_next_page = 0;
+	pages = md->cp_pages;
+	md->cp_pages = md->dirty_pages;
+	md->dirty_pages = pages;
+
+	_reduce_md_checkpoint_write(vol);
+}
+
+static void _write_md_done(struct spdk_reduce_vol_request *req, int reduce_errno);
+
+static void
+_reduce_md_log_flush_done(void *cb_arg, int reduce_errno)
+{
+	struct spdk_reduce_vol *vol = cb_arg;
+	struct reduce_md *md = vol->md;
+	struct reduce_md_log_buf *lb = md->flush_buf;
+	struct spdk_reduce_vol_request *req;
+
+	if (reduce_errno != 0) {
+		md->log_errno = reduce_errno;
+	}
+
+	assert(md->num_log_ios > 0);
+	if (--md->num_log_ios > 0) {
+		return;
+	}
+
+	if (md->log_errno != 0) {
+		/* Part of the pages may have been written, so their sequence numbers are never
+		 *  used again: replay would go on with these after the pages reusing them.
+		 *  Replay stops at the hole instead, the log is resumed after a checkpoint.
+		 */
+		SPDK_ERRLOG("could not write metadata log: %d\n", md->log_errno);
+		md->log_failed = true;
+		md->log_failed_seq = md->head_seq;
+	}
+
+	/* Requests completing here may log more updates, they are written once this is done. */
+	md->flush_done_depth++;
+	while ((req = TAILQ_FIRST(&lb->reqs)) != NULL) {
+		TAILQ_REMOVE(&lb->reqs, req, md_tailq);
+		_write_md_done(req, md->log_errno);
+	}
+	lb->num_pages = 0;
+	md->flush_buf = NULL;
+
+	/* Bound the amount of log to replay at load. */
+	if (!md->cp_running &&
+	    (md->log_failed || md->head_seq - md->tail_seq >= md->log_pages / 2)) {
+		_reduce_md_checkpoint(vol, NULL, NULL);
+	}
+
+	_reduce_md_log_flush(vol);
+	md->flush_done_depth--;
+	_reduce_md_try_close(vol);
+}
+
+/* Writes all the records appended since the last write, unless a write is in progress. */
+static void
+_reduce_md_log_flush(struct spdk_reduce_vol *vol)
+{
+	struct reduce_md *md = vol->md;
+	struct reduce_md_log_buf *lb = md->open_buf;
+	struct reduce_md_log_page *page;
+	uint32_t i, first_page, count;
+
+	if (md->flush_buf != NULL || lb->num_pages == 0) {
+		return;
+	}
+
+	if (md->log_failed || md->head_seq + lb->num_pages - md->tail_seq > md->log_pages) {
+		/* Wait for a checkpoint to free the oldest part of the log, or to skip the hole
+		 *  left by a failed write.
+		 */
+		md->log_full = true;
+		if (!md->cp_running) {
+			_reduce_md_checkpoint(vol, NULL, NULL);
+		}
+		return;
+	}
+
+	for (i = 0; i < lb->num_pages; i++) {
+		page = (struct reduce_md_log_page *)(lb->buf + i * REDUCE_MD_PAGE_SIZE);
+		page->seq = md->head_seq + i;
+		page->uuid = vol->params.uuid;
+		page->crc = 0;
+		page->crc = spdk_crc32c_update(page, sizeof(*page) + page->length, ~0);
+	}
+
+	md->flush_buf = lb;
+	md->open_buf = lb == &md->log_bufs[0] ? &md->log_bufs[1] : &md->log_bufs[0];
+	md->log_errno = 0;
+
+	/* The pages may wrap around the end of the log. */
+	first_page = md->head_seq % md->log_pages;
+	count = spdk_min(lb->num_pages, md->log_pages - first_page);
+	md->num_log_ios = count < lb->num_pages ? 2 : 1;
+	md->head_seq += lb->num_pages;
+
+	md->log_iov[0].iov_base = lb->buf;
+	md->log_iov[0].iov_len = count * REDUCE_MD_PAGE_SIZE;
+	md->log_iov[1].iov_base = lb->buf + count * REDUCE_MD_PAGE_SIZE;
+	md->log_iov[1].iov_len = (lb->num_pages - count) * REDUCE_MD_PAGE_SIZE;
+	for (i = 0; i < (uint32_t)md->num_log_ios; i++) {
+		md->log_cb_args[i].cb_fn = _reduce_md_log_flush_done;
+		md->log_cb_args[i].cb_arg = vol;
+		vol->backing_dev->writev(vol->backing_dev, &md->log_iov[i], 1,
+					 _reduce_md_lba(vol, REDUCE_MD_LOG_OFFSET +
+							(i == 0 ? first_page * REDUCE_MD_PAGE_SIZE : 0)),
+					 _reduce_md_lba_count(vol, md->log_iov[i].iov_len),
+					 &md->log_cb_args[i]);
+	}
+}
+
+static void
+_reduce_md_log_append(struct spdk_reduce_vol *vol, uint32_t type, uint64_t index,
+		      const void *data, uint32_t length)
+{
+	struct reduce_md_log_buf *lb = vol->md->open_buf;
+	struct reduce_md_log_page *page;
+	struct reduce_md_log_record *record;
+	uint32_t size = sizeof(*record) + length;
+
+	if (lb->num_pages == 0 || lb->offset + size > REDUCE_MD_PAGE_SIZE) {
+		assert(lb->num_pages < vol->md->log_buf_pages);
+		lb->num_pages++;
+		lb->offset = sizeof(*page);
+	}
+
+	page = (struct reduce_md_log_page *)(lb->buf + (lb->num_pages - 1) * REDUCE_MD_PAGE_SIZE);
+	record = (struct reduce_md_log_record *)((uint8_t *)page + lb->offset);
+	record->type = type;
+	record->length = length;
+	record->index = index;
+	memcpy(record->data, data, length);
+	lb->offset += size;
+	page->length = lb->offset - sizeof(*page);
+}
+
+/* Logs the new chunk map of a write request, the request goes on once it is durable. */
+static void
+_reduce_md_log_chunk_map(struct spdk_reduce_vol_request *req)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+
+	_reduce_md_log_append(vol, REDUCE_MD_LOG_CHUNK_MAP, req->chunk_map_index, req->chunk,
+			      _reduce_vol_get_chunk_struct_size(vol->backing_io_units_per_chunk));
+	_reduce_md_log_append(vol, REDUCE_MD_LOG_LOGICAL_MAP, req->logical_map_index,
+			      &req->chunk_map_index, sizeof(req->chunk_map_index));
+	TAILQ_INSERT_TAIL(&vol->md->open_buf->reqs, req, md_tailq);
+	_reduce_md_log_flush(vol);
+}
+
+static void
+_reduce_md_try_close(struct spdk_reduce_vol *vol)
+{
+	struct reduce_md *md = vol->md;
+	reduce_md_op_complete cb_fn = md->close_cb_fn;
+
+	if (cb_fn == NULL || md->flush_buf != NULL || md->cp_running ||
+	    md->flush_done_depth > 0) {
+		return;
+	}
+
+	/* A last checkpoint, so that the next load has nothing to replay. */
+	md->close_cb_fn = NULL;
+	_reduce_md_checkpoint(vol, cb_fn, md->close_cb_arg);
+}
+
+/* Waits for the log writes and checkpoint in progress, then checkpoints the maps. */
+static void
+_reduce_md_close(struct spdk_reduce_vol *vol, reduce_md_op_complete cb_fn, void *cb_arg)
+{
+	vol->md->close_cb_fn = cb_fn;
+	vol->md->close_cb_arg = cb_arg;
+	_reduce_md_try_close(vol);
+}
+
 /* We need 2 iovs during load - one for the superblock, another for the path */
 #define LOAD_IOV_COUNT	2
 
@@ -305,6 +1022,9 @@ struct reduce_init_load_ctx {
 	void					*cb_arg;
 	struct iovec				iov[LOAD_IOV_COUNT];
 	void					*path;
+	/* Next page and number of pages of the metadata checkpoint read at load */
+	uint32_t				md_page;
+	uint32_t				md_page_count;
 };
 
 static inline bool
@@ -427,6 +1147,29 @@ _allocate_vol_requests(struct spdk_reduce_vol *vol)
 	return rc;
 }
 
+static int
+_allocate_vol_cache(struct spdk_reduce_vol *vol)
+{
+	struct reduce_cache_entry *entry;
+	int i;
+
+	TAILQ_INIT(&vol->cache_lru);
+	vol->cache_entries = calloc(REDUCE_NUM_CACHE_CHUNKS, sizeof(*vol->cache_entries));
+	vol->cache_buf_mem = malloc(REDUCE_NUM_CACHE_CHUNKS * vol->params.chunk_size);
+	if (vol->cache_entries == NULL || vol->cache_buf_mem == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < REDUCE_NUM_CACHE_CHUNKS; i++) {
+		entry = &vol->cache_entries[i];
+		entry->logical_map_index = REDUCE_EMPTY_MAP_ENTRY;
+		entry->buf = vol->cache_buf_mem + i * vol->params.chunk_size;
+		TAILQ_INSERT_TAIL(&vol->cache_lru, entry, tailq);
+	}
+
+	return 0;
+}
+
 static void
 _init_load_cleanup(struct spdk_reduce_vol *vol, struct reduce_init_load_ctx *ctx)
 {
@@ -436,16 +1179,24 @@ _init_load_cleanup(struct spdk_reduce_vol *vol, struct reduce_init_load_ctx *ctx
 	}
 
 	if (vol != NULL) {
-		if (vol->pm_file.pm_buf != NULL) {
+		if (vol->md != NULL) {
+			free(vol->pm_file.pm_buf);
+			_reduce_md_free(vol);
+		} else if (vol->pm_file.pm_buf != NULL) {
 			pmem_unmap(vol->pm_file.pm_buf, vol->pm_file.size);
 		}
 
 		spdk_free(vol->backing_super);
 		spdk_bit_array_free(&vol->allocated_chunk_maps);
 		spdk_bit_array_free(&vol->allocated_backing_io_units);
+		free(vol->io_unit_refs);
+		free(vol->pack_units);
+		spdk_free(vol->pack_buf_mem);
 		free(vol->request_mem);
 		free(vol->buf_iov_mem);
 		spdk_free(vol->buf_mem);
+		free(vol->cache_entries);
+		free(vol->cache_buf_mem);
 		free(vol);
 	}
 }
@@ -477,6 +1228,9 @@ _init_write_super_cpl(void *cb_arg, int reduce_errno)
 	int rc;
 
 	rc = _allocate_vol_requests(init_ctx->vol);
+	if (rc == 0) {
+		rc = _allocate_vol_cache(init_ctx->vol);
+	}
 	if (rc != 0) {
 		init_ctx->cb_fn(init_ctx->cb_arg, NULL, rc);
 		_init_load_cleanup(init_ctx->vol, init_ctx);
@@ -512,6 +1266,41 @@ _init_write_path_cpl(void *cb_arg, int reduce_errno)
 				 &init_ctx->backing_cb_args);
 }
 
+static void
+_init_write_path(struct reduce_init_load_ctx *init_ctx)
+{
+	struct spdk_reduce_vol *vol = init_ctx->vol;
+
+	memcpy(init_ctx->path, vol->pm_file.path, REDUCE_PATH_MAX);
+	init_ctx->iov[0].iov_base = init_ctx->path;
+	init_ctx->iov[0].iov_len = REDUCE_PATH_MAX;
+	init_ctx->backing_cb_args.cb_fn = _init_write_path_cpl;
+	init_ctx->backing_cb_args.cb_arg = init_ctx;
+	/* Write path to offset 4K on backing device - just after where the super
+	 *  block will be written.  We wait until this is committed before writing the
+	 *  super block to guarantee we don't get the super block written without the
+	 *  the path if the system crashed in the middle of a write operation.
+	 */
+	vol->backing_dev->writev(vol->backing_dev, init_ctx->iov, 1,
+				 REDUCE_BACKING_DEV_PATH_OFFSET / vol->backing_dev->blocklen,
+				 REDUCE_PATH_MAX / vol->backing_dev->blocklen,
+				 &init_ctx->backing_cb_args);
+}
+
+static void
+_init_md_checkpoint_done(void *cb_arg, int reduce_errno)
+{
+	struct reduce_init_load_ctx *init_ctx = cb_arg;
+
+	if (reduce_errno != 0) {
+		init_ctx->cb_fn(init_ctx->cb_arg, NULL, reduce_errno);
+		_init_load_cleanup(init_ctx->vol, init_ctx);
+		return;
+	}
+
+	_init_write_path(init_ctx);
+}
+
 static int
 _allocate_bit_arrays(struct spdk_reduce_vol *vol)
 {
@@ -527,6 +1316,13 @@ _allocate_bit_arrays(struct spdk_reduce_vol *vol)
 		return -ENOMEM;
 	}
 
+	if (_reduce_vol_is_packed(vol)) {
+		vol->io_unit_refs = calloc(total_backing_io_units, sizeof(*vol->io_unit_refs));
+		if (vol->io_unit_refs == NULL) {
+			return -ENOMEM;
+		}
+	}
+
 	/* Set backing io unit bits associated with metadata. */
 	num_metadata_io_units = (sizeof(*vol->backing_super) + REDUCE_PATH_MAX) /
 				vol->backing_dev->blocklen;
@@ -537,6 +1333,37 @@ _allocate_bit_arrays(struct spdk_reduce_vol *vol)
 	return 0;
 }
 
+static int
+_allocate_pack_units(struct spdk_reduce_vol *vol)
+{
+	struct reduce_pack_unit *pu;
+	uint32_t i;
+
+	TAILQ_INIT(&vol->free_pack_units);
+	if (!_reduce_vol_is_packed(vol)) {
+		return 0;
+	}
+
+	vol->pack_units = calloc(REDUCE_NUM_PACK_UNITS, sizeof(*vol->pack_units));
+	vol->pack_buf_mem = spdk_zmalloc(REDUCE_NUM_PACK_UNITS * vol->params.backing_io_unit_size,
+					 64, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (vol->pack_units == NULL || vol->pack_buf_mem == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < REDUCE_NUM_PACK_UNITS; i++) {
+		pu = &vol->pack_units[i];
+		pu->vol = vol;
+		pu->buf = vol->pack_buf_mem + i * vol->params.backing_io_unit_size;
+		pu->io_unit_index = REDUCE_EMPTY_MAP_ENTRY;
+		TAILQ_INIT(&pu->pending);
+		TAILQ_INIT(&pu->flushing_reqs);
+		TAILQ_INSERT_TAIL(&vol->free_pack_units, pu, link);
+	}
+
+	return 0;
+}
+
 void
 spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 		     struct spdk_reduce_backing_dev *backing_dev,
@@ -545,25 +1372,33 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 {
 	struct spdk_reduce_vol *vol;
 	struct reduce_init_load_ctx *init_ctx;
-	uint64_t backing_dev_size;
+	uint64_t backing_dev_size, md_size;
 	size_t mapped_len;
-	int dir_len, max_dir_len, rc;
+	int dir_len = 0, max_dir_len, rc;
 
-	/* We need to append a path separator and the UUID to the supplied
-	 * path.
-	 */
-	max_dir_len = REDUCE_PATH_MAX - SPDK_UUID_STRING_LEN - 1;
-	dir_len = strnlen(pm_file_dir, max_dir_len);
-	/* Strip trailing slash if the user provided one - we will add it back
-	 * later when appending the filename.
-	 */
-	if (pm_file_dir[dir_len - 1] == '/') {
-		dir_len--;
-	}
-	if (dir_len == max_dir_len) {
-		SPDK_ERRLOG("pm_file_dir (%s) too long\n", pm_file_dir);
-		cb_fn(cb_arg, NULL, -EINVAL);
-		return;
+	if (!_reduce_vol_md_on_backing_dev(params)) {
+		if (pm_file_dir == NULL) {
+			SPDK_ERRLOG("pm_file_dir not specified\n");
+			cb_fn(cb_arg, NULL, -EINVAL);
+			return;
+		}
+
+		/* We need to append a path separator and the UUID to the supplied
+		 * path.
+		 */
+		max_dir_len = REDUCE_PATH_MAX - SPDK_UUID_STRING_LEN - 1;
+		dir_len = strnlen(pm_file_dir, max_dir_len);
+		/* Strip trailing slash if the user provided one - we will add it back
+		 * later when appending the filename.
+		 */
+		if (pm_file_dir[dir_len - 1] == '/') {
+			dir_len--;
+		}
+		if (dir_len == max_dir_len) {
+			SPDK_ERRLOG("pm_file_dir (%s) too long\n", pm_file_dir);
+			cb_fn(cb_arg, NULL, -EINVAL);
+			return;
+		}
 	}
 
 	rc = _validate_vol_params(params);
@@ -575,6 +1410,12 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 
 	backing_dev_size = backing_dev->blockcnt * backing_dev->blocklen;
 	params->vol_size = _get_vol_size(params->chunk_size, backing_dev_size);
+	if (params->vol_size != 0 && _reduce_vol_md_on_backing_dev(params)) {
+		/* Leave room for the metadata, sized for the volume before making room. */
+		md_size = _get_backing_dev_md_size(params);
+		params->vol_size = md_size < backing_dev_size ?
+				   _get_vol_size(params->chunk_size, backing_dev_size - md_size) : 0;
+	}
 	if (params->vol_size == 0) {
 		SPDK_ERRLOG("backing device is too small\n");
 		cb_fn(cb_arg, NULL, -EINVAL);
@@ -625,28 +1466,30 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 		spdk_uuid_generate(&params->uuid);
 	}
 
-	memcpy(vol->pm_file.path, pm_file_dir, dir_len);
-	vol->pm_file.path[dir_len] = '/';
-	spdk_uuid_fmt_lower(&vol->pm_file.path[dir_len + 1], SPDK_UUID_STRING_LEN,
-			    &params->uuid);
-	vol->pm_file.size = _get_pm_file_size(params);
-	vol->pm_file.pm_buf = pmem_map_file(vol->pm_file.path, vol->pm_file.size,
-					    PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0600,
-					    &mapped_len, &vol->pm_file.pm_is_pmem);
-	if (vol->pm_file.pm_buf == NULL) {
-		SPDK_ERRLOG("could not pmem_map_file(%s): %s\n",
-			    vol->pm_file.path, strerror(errno));
-		cb_fn(cb_arg, NULL, -errno);
-		_init_load_cleanup(vol, init_ctx);
-		return;
-	}
+	if (!_reduce_vol_md_on_backing_dev(params)) {
+		memcpy(vol->pm_file.path, pm_file_dir, dir_len);
+		vol->pm_file.path[dir_len] = '/';
+		spdk_uuid_fmt_lower(&vol->pm_file.path[dir_len + 1], SPDK_UUID_STRING_LEN,
+				    &params->uuid);
+		vol->pm_file.size = _get_pm_file_size(params);
+		vol->pm_file.pm_buf = pmem_map_file(vol->pm_file.path, vol->pm_file.size,
+						    PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0600,
+						    &mapped_len, &vol->pm_file.pm_is_pmem);
+		if (vol->pm_file.pm_buf == NULL) {
+			SPDK_ERRLOG("could not pmem_map_file(%s): %s\n",
+				    vol->pm_file.path, strerror(errno));
+			cb_fn(cb_arg, NULL, -errno);
+			_init_load_cleanup(vol, init_ctx);
+			return;
+		}
 
-	if (vol->pm_file.size != mapped_len) {
-		SPDK_ERRLOG("could not map entire pmem file (size=%" PRIu64 " mapped=%" PRIu64 ")\n",
-			    vol->pm_file.size, mapped_len);
-		cb_fn(cb_arg, NULL, -ENOMEM);
-		_init_load_cleanup(vol, init_ctx);
-		return;
+		if (vol->pm_file.size != mapped_len) {
+			SPDK_ERRLOG("could not map entire pmem file (size=%" PRIu64 " mapped=%" PRIu64 ")\n",
+				    vol->pm_file.size, mapped_len);
+			cb_fn(cb_arg, NULL, -ENOMEM);
+			_init_load_cleanup(vol, init_ctx);
+			return;
+		}
 	}
 
 	vol->backing_io_units_per_chunk = params->chunk_size / params->backing_io_unit_size;
@@ -657,6 +1500,12 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 	vol->backing_dev = backing_dev;
 
 	rc = _allocate_bit_arrays(vol);
+	if (rc == 0) {
+		rc = _allocate_pack_units(vol);
+	}
+	if (rc == 0 && _reduce_vol_md_on_backing_dev(params)) {
+		rc = _reduce_md_alloc(vol);
+	}
 	if (rc != 0) {
 		cb_fn(cb_arg, NULL, rc);
 		_init_load_cleanup(vol, init_ctx);
@@ -674,40 +1523,278 @@ spdk_reduce_vol_init(struct spdk_reduce_vol_params *params,
 	 * Note that this writes 0xFF to not just the logical map but the chunk maps as well.
 	 */
 	memset(vol->pm_logical_map, 0xFF, vol->pm_file.size - sizeof(*vol->backing_super));
-	_reduce_persist(vol, vol->pm_file.pm_buf, vol->pm_file.size);
 
 	init_ctx->vol = vol;
 	init_ctx->cb_fn = cb_fn;
 	init_ctx->cb_arg = cb_arg;
 
-	memcpy(init_ctx->path, vol->pm_file.path, REDUCE_PATH_MAX);
-	init_ctx->iov[0].iov_base = init_ctx->path;
-	init_ctx->iov[0].iov_len = REDUCE_PATH_MAX;
-	init_ctx->backing_cb_args.cb_fn = _init_write_path_cpl;
-	init_ctx->backing_cb_args.cb_arg = init_ctx;
-	/* Write path to offset 4K on backing device - just after where the super
-	 *  block will be written.  We wait until this is committed before writing the
-	 *  super block to guarantee we don't get the super block written without the
-	 *  the path if the system crashed in the middle of a write operation.
-	 */
-	vol->backing_dev->writev(vol->backing_dev, init_ctx->iov, 1,
-				 REDUCE_BACKING_DEV_PATH_OFFSET / vol->backing_dev->blocklen,
-				 REDUCE_PATH_MAX / vol->backing_dev->blocklen,
-				 &init_ctx->backing_cb_args);
+	if (vol->md != NULL) {
+		/* The first checkpoint writes the whole maps, before the superblock. */
+		_reduce_persist(vol, vol->pm_logical_map,
+				vol->pm_file.size - sizeof(*vol->backing_super));
+		_reduce_md_checkpoint(vol, _init_md_checkpoint_done, init_ctx);
+		return;
+	}
+
+	_reduce_persist(vol, vol->pm_file.pm_buf, vol->pm_file.size);
+	_init_write_path(init_ctx);
 }
 
 static void destroy_load_cb(void *cb_arg, struct spdk_reduce_vol *vol, int reduce_errno);
 
+static void
+_load_complete(struct reduce_init_load_ctx *load_ctx)
+{
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	uint64_t i, num_chunks, logical_map_index;
+	struct spdk_reduce_chunk_map *chunk;
+	uint32_t j;
+	int rc;
+
+	rc = _allocate_vol_requests(vol);
+	if (rc == 0) {
+		rc = _allocate_vol_cache(vol);
+	}
+	if (rc != 0) {
+		load_ctx->cb_fn(load_ctx->cb_arg, NULL, rc);
+		_init_load_cleanup(vol, load_ctx);
+		return;
+	}
+
+	_initialize_vol_pm_pointers(vol);
+
+	num_chunks = vol->params.vol_size / vol->params.chunk_size;
+	for (i = 0; i < num_chunks; i++) {
+		logical_map_index = vol->pm_logical_map[i];
+		if (logical_map_index == REDUCE_EMPTY_MAP_ENTRY) {
+			continue;
+		}
+		spdk_bit_array_set(vol->allocated_chunk_maps, logical_map_index);
+		chunk = _reduce_vol_get_chunk_map(vol, logical_map_index);
+		for (j = 0; j < vol->backing_io_units_per_chunk; j++) {
+			if (chunk->io_unit_index[j] != REDUCE_EMPTY_MAP_ENTRY) {
+				spdk_bit_array_set(vol->allocated_backing_io_units, chunk->io_unit_index[j]);
+				if (vol->io_unit_refs != NULL) {
+					vol->io_unit_refs[chunk->io_unit_index[j]]++;
+				}
+			}
+		}
+	}
+
+	load_ctx->cb_fn(load_ctx->cb_arg, vol, 0);
+	/* Only clean up the ctx - the vol has been passed to the application
+	 *  for use now that volume load was successful.
+	 */
+	_init_load_cleanup(NULL, load_ctx);
+}
+
+/* Applies the log pages following the checkpoint, up to the first one missing or torn. */
+static int
+_reduce_md_replay(struct spdk_reduce_vol *vol, uint64_t *end_seq)
+{
+	struct reduce_md *md = vol->md;
+	struct reduce_md_log_page *page;
+	struct reduce_md_log_record *record;
+	struct spdk_reduce_chunk_map *chunk;
+	uint64_t seq, num_chunks, total_chunks, chunk_map_index;
+	uint32_t offset, crc, chunk_struct_size;
+
+	num_chunks = vol->params.vol_size / vol->params.chunk_size;
+	total_chunks = _get_total_chunks(vol->params.vol_size, vol->params.chunk_size);
+	chunk_struct_size = _reduce_vol_get_chunk_struct_size(vol->backing_io_units_per_chunk);
+
+	for (seq = md->head_seq; seq < md->head_seq + md->log_pages; seq++) {
+		page = (struct reduce_md_log_page *)(md->io_buf +
+						     (seq % md->log_pages) * REDUCE_MD_PAGE_SIZE);
+		if (page->seq != seq || spdk_uuid_compare(&page->uuid, &vol->params.uuid) != 0 ||
+		    page->length > REDUCE_MD_PAGE_SIZE - sizeof(*page)) {
+			break;
+		}
+		crc = page->crc;
+		page->crc = 0;
+		if (spdk_crc32c_update(page, sizeof(*page) + page->length, ~0) != crc) {
+			break;
+		}
+
+		for (offset = 0; offset < page->length; offset += sizeof(*record) + record->length) {
+			record = (struct reduce_md_log_record *)(page->records + offset);
+			if (page->length - offset < sizeof(*record) ||
+			    page->length - offset - sizeof(*record) < record->length) {
+				return -EILSEQ;
+			}
+
+			switch (record->type) {
+			case REDUCE_MD_LOG_CHUNK_MAP:
+				if (record->index >= total_chunks || record->length != chunk_struct_size) {
+					return -EILSEQ;
+				}
+				chunk = _reduce_vol_get_chunk_map(vol, record->index);
+				memcpy(chunk, record->data, chunk_struct_size);
+				_reduce_persist(vol, chunk, chunk_struct_size);
+				break;
+			case REDUCE_MD_LOG_LOGICAL_MAP:
+				if (record->index >= num_chunks || record->length != sizeof(uint64_t)) {
+					return -EILSEQ;
+				}
+				memcpy(&chunk_map_index, record->data, sizeof(chunk_map_index));
+				if (chunk_map_index != REDUCE_EMPTY_MAP_ENTRY &&
+				    chunk_map_index >= total_chunks) {
+					return -EILSEQ;
+				}
+				vol->pm_logical_map[record->index] = chunk_map_index;
+				_reduce_persist(vol, &vol->pm_logical_map[record->index], sizeof(uint64_t));
+				break;
+			default:
+				return -EILSEQ;
+			}
+		}
+	}
+
+	*end_seq = seq;
+	return 0;
+}
+
+static void
+_load_md_checkpoint_done(void *cb_arg, int reduce_errno)
+{
+	struct reduce_init_load_ctx *load_ctx = cb_arg;
+
+	if (reduce_errno != 0) {
+		load_ctx->cb_fn(load_ctx->cb_arg, NULL, reduce_errno);
+		_init_load_cleanup(load_ctx->vol, load_ctx);
+		return;
+	}
+
+	_load_complete(load_ctx);
+}
+
+static void
+_load_read_md_log_cpl(void *cb_arg, int reduce_errno)
+{
+	struct reduce_init_load_ctx *load_ctx = cb_arg;
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	struct reduce_md *md = vol->md;
+	uint64_t end_seq;
+
+	if (reduce_errno == 0) {
+		reduce_errno = _reduce_md_replay(vol, &end_seq);
+	}
+	if (reduce_errno != 0) {
+		load_ctx->cb_fn(load_ctx->cb_arg, NULL, reduce_errno);
+		_init_load_cleanup(vol, load_ctx);
+		return;
+	}
+
+	if (end_seq != md->head_seq) {
+		SPDK_NOTICELOG("replayed %" PRIu64 " metadata log pages\n", end_seq - md->head_seq);
+	}
+
+	/* Pages past the end of the log may be left from before, skip them so that they are
+	 *  all overwritten before the log gets to their sequence numbers.
+	 */
+	md->head_seq = end_seq + md->log_pages;
+	md->tail_seq = md->head_seq;
+	_reduce_md_checkpoint(vol, _load_md_checkpoint_done, load_ctx);
+}
+
+static void _load_read_md_image(struct reduce_init_load_ctx *load_ctx);
+
+static void
+_load_read_md_image_cpl(void *cb_arg, int reduce_errno)
+{
+	struct reduce_init_load_ctx *load_ctx = cb_arg;
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+
+	if (reduce_errno != 0) {
+		load_ctx->cb_fn(load_ctx->cb_arg, NULL, reduce_errno);
+		_init_load_cleanup(vol, load_ctx);
+		return;
+	}
+
+	memcpy(_reduce_md_image(vol) + (uint64_t)load_ctx->md_page * REDUCE_MD_PAGE_SIZE,
+	       vol->md->io_buf, (uint64_t)load_ctx->md_page_count * REDUCE_MD_PAGE_SIZE);
+	load_ctx->md_page += load_ctx->md_page_count;
+	_load_read_md_image(load_ctx);
+}
+
+/* Reads the checkpoint in pieces the size of the io buffer, then the whole log. */
+static void
+_load_read_md_image(struct reduce_init_load_ctx *load_ctx)
+{
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	struct reduce_md *md = vol->md;
+	uint64_t offset;
+
+	md->iov.iov_base = md->io_buf;
+	md->backing_cb_args.cb_arg = load_ctx;
+
+	if (load_ctx->md_page == md->image_pages) {
+		md->iov.iov_len = REDUCE_MD_LOG_SIZE;
+		md->backing_cb_args.cb_fn = _load_read_md_log_cpl;
+		vol->backing_dev->readv(vol->backing_dev, &md->iov, 1,
+					_reduce_md_lba(vol, REDUCE_MD_LOG_OFFSET),
+					_reduce_md_lba_count(vol, REDUCE_MD_LOG_SIZE), &md->backing_cb_args);
+		return;
+	}
+
+	load_ctx->md_page_count = spdk_min(md->image_pages - load_ctx->md_page,
+					   REDUCE_MD_IO_BUF_SIZE / REDUCE_MD_PAGE_SIZE);
+	offset = (uint64_t)load_ctx->md_page * REDUCE_MD_PAGE_SIZE;
+	md->iov.iov_len = (uint64_t)load_ctx->md_page_count * REDUCE_MD_PAGE_SIZE;
+	md->backing_cb_args.cb_fn = _load_read_md_image_cpl;
+	vol->backing_dev->readv(vol->backing_dev, &md->iov, 1,
+				_reduce_md_lba(vol, REDUCE_MD_IMAGE_OFFSET + offset),
+				_reduce_md_lba_count(vol, md->iov.iov_len), &md->backing_cb_args);
+}
+
+static void
+_load_read_md_header_cpl(void *cb_arg, int reduce_errno)
+{
+	struct reduce_init_load_ctx *load_ctx = cb_arg;
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	struct reduce_md *md = vol->md;
+	struct reduce_md_header *header = md->header;
+
+	if (reduce_errno == 0 &&
+	    (memcmp(header->signature, REDUCE_MD_SIGNATURE, sizeof(header->signature)) != 0 ||
+	     spdk_uuid_compare(&header->uuid, &vol->params.uuid) != 0 ||
+	     spdk_crc32c_update(header, offsetof(struct reduce_md_header, crc), ~0) != header->crc)) {
+		SPDK_ERRLOG("invalid metadata header on the backing device\n");
+		reduce_errno = -EILSEQ;
+	}
+	if (reduce_errno != 0) {
+		load_ctx->cb_fn(load_ctx->cb_arg, NULL, reduce_errno);
+		_init_load_cleanup(vol, load_ctx);
+		return;
+	}
+
+	md->head_seq = header->log_start_seq;
+	md->tail_seq = header->log_start_seq;
+	load_ctx->md_page = 0;
+	_load_read_md_image(load_ctx);
+}
+
+static void
+_load_read_md_header(struct reduce_init_load_ctx *load_ctx)
+{
+	struct spdk_reduce_vol *vol = load_ctx->vol;
+	struct reduce_md *md = vol->md;
+
+	md->iov.iov_base = md->header;
+	md->iov.iov_len = sizeof(*md->header);
+	md->backing_cb_args.cb_fn = _load_read_md_header_cpl;
+	md->backing_cb_args.cb_arg = load_ctx;
+	vol->backing_dev->readv(vol->backing_dev, &md->iov, 1, _reduce_md_lba(vol, 0),
+				_reduce_md_lba_count(vol, sizeof(*md->header)), &md->backing_cb_args);
+}
+
 static void
 _load_read_super_and_path_cpl(void *cb_arg, int reduce_errno)
 {
 	struct reduce_init_load_ctx *load_ctx = cb_arg;
 	struct spdk_reduce_vol *vol = load_ctx->vol;
 	uint64_t backing_dev_size;
-	uint64_t i, num_chunks, logical_map_index;
-	struct spdk_reduce_chunk_map *chunk;
 	size_t mapped_len;
-	uint32_t j;
 	int rc;
 
 	rc = _alloc_zero_buff();
@@ -736,23 +1823,44 @@ _load_read_super_and_path_cpl(void *cb_arg, int reduce_errno)
 	}
 
 	memcpy(&vol->params, &vol->backing_super->params, sizeof(vol->params));
+	if ((vol->params.flags & ~REDUCE_VOL_SUPPORTED_FLAGS) != 0) {
+		SPDK_ERRLOG("unsupported volume flags 0x%x\n", vol->params.flags);
+		rc = -ENOTSUP;
+		goto error;
+	}
+
 	vol->backing_io_units_per_chunk = vol->params.chunk_size / vol->params.backing_io_unit_size;
 	vol->logical_blocks_per_chunk = vol->params.chunk_size / vol->params.logical_block_size;
 	vol->backing_lba_per_io_unit = vol->params.backing_io_unit_size / vol->backing_dev->blocklen;
 
 	rc = _allocate_bit_arrays(vol);
+	if (rc == 0) {
+		rc = _allocate_pack_units(vol);
+	}
 	if (rc != 0) {
 		goto error;
 	}
 
 	backing_dev_size = vol->backing_dev->blockcnt * vol->backing_dev->blocklen;
-	if (_get_vol_size(vol->params.chunk_size, backing_dev_size) < vol->params.vol_size) {
+	if (_get_vol_size(vol->params.chunk_size, backing_dev_size) < vol->params.vol_size ||
+	    (_reduce_vol_md_on_backing_dev(&vol->params) &&
+	     _get_backing_dev_md_offset(&vol->params) + _get_backing_dev_md_size(&vol->params) >
+	     backing_dev_size)) {
 		SPDK_ERRLOG("backing device size %" PRIi64 " smaller than expected\n",
 			    backing_dev_size);
 		rc = -EILSEQ;
 		goto error;
 	}
 
+	if (_reduce_vol_md_on_backing_dev(&vol->params)) {
+		rc = _reduce_md_alloc(vol);
+		if (rc != 0) {
+			goto error;
+		}
+		_load_read_md_header(load_ctx);
+		return;
+	}
+
 	vol->pm_file.size = _get_pm_file_size(&vol->params);
 	vol->pm_file.pm_buf = pmem_map_file(vol->pm_file.path, 0, 0, 0, &mapped_len,
 					    &vol->pm_file.pm_is_pmem);
@@ -769,33 +1877,7 @@ _load_read_super_and_path_cpl(void *cb_arg, int reduce_errno)
 		goto error;
 	}
 
-	rc = _allocate_vol_requests(vol);
-	if (rc != 0) {
-		goto error;
-	}
-
-	_initialize_vol_pm_pointers(vol);
-
-	num_chunks = vol->params.vol_size / vol->params.chunk_size;
-	for (i = 0; i < num_chunks; i++) {
-		logical_map_index = vol->pm_logical_map[i];
-		if (logical_map_index == REDUCE_EMPTY_MAP_ENTRY) {
-			continue;
-		}
-		spdk_bit_array_set(vol->allocated_chunk_maps, logical_map_index);
-		chunk = _reduce_vol_get_chunk_map(vol, logical_map_index);
-		for (j = 0; j < vol->backing_io_units_per_chunk; j++) {
-			if (chunk->io_unit_index[j] != REDUCE_EMPTY_MAP_ENTRY) {
-				spdk_bit_array_set(vol->allocated_backing_io_units, chunk->io_unit_index[j]);
-			}
-		}
-	}
-
-	load_ctx->cb_fn(load_ctx->cb_arg, vol, 0);
-	/* Only clean up the ctx - the vol has been passed to the application
-	 *  for use now that volume load was successful.
-	 */
-	_init_load_cleanup(NULL, load_ctx);
+	_load_complete(load_ctx);
 	return;
 
 error:
@@ -868,6 +1950,35 @@ spdk_reduce_vol_load(struct spdk_reduce_backing_dev *backing_dev,
 				&load_ctx->backing_cb_args);
 }
 
+static void
+_reduce_vol_unload_done(void *cb_arg, int reduce_errno)
+{
+	struct spdk_reduce_vol *vol = cb_arg;
+	spdk_reduce_vol_op_complete cb_fn = vol->unload_cb_fn;
+
+	cb_arg = vol->unload_cb_arg;
+	if (--g_vol_count == 0) {
+		spdk_free(g_zero_buf);
+	}
+	assert(g_vol_count >= 0);
+	_init_load_cleanup(vol, NULL);
+	cb_fn(cb_arg, reduce_errno);
+}
+
+static void
+_reduce_vol_unload(struct spdk_reduce_vol *vol,
+		   spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+{
+	vol->unload_cb_fn = cb_fn;
+	vol->unload_cb_arg = cb_arg;
+	if (vol->md != NULL) {
+		_reduce_md_close(vol, _reduce_vol_unload_done, vol);
+		return;
+	}
+
+	_reduce_vol_unload_done(vol, 0);
+}
+
 void
 spdk_reduce_vol_unload(struct spdk_reduce_vol *vol,
 		       spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
@@ -879,12 +1990,14 @@ spdk_reduce_vol_unload(struct spdk_reduce_vol *vol,
 		return;
 	}
 
-	if (--g_vol_count == 0) {
-		spdk_free(g_zero_buf);
+	if (vol->compact.outstanding > 0) {
+		/* Finish unloading when the compaction in progress is done. */
+		vol->unload_cb_fn = cb_fn;
+		vol->unload_cb_arg = cb_arg;
+		return;
 	}
-	assert(g_vol_count >= 0);
-	_init_load_cleanup(vol, NULL);
-	cb_fn(cb_arg, 0);
+
+	_reduce_vol_unload(vol, cb_fn, cb_arg);
 }
 
 struct reduce_destroy_ctx {
@@ -903,7 +2016,8 @@ destroy_unload_cpl(void *cb_arg, int reduce_errno)
 {
 	struct reduce_destroy_ctx *destroy_ctx = cb_arg;
 
-	if (destroy_ctx->reduce_errno == 0) {
+	/* Volumes with their metadata on the backing device have no pm file. */
+	if (destroy_ctx->reduce_errno == 0 && destroy_ctx->pm_path[0] != '\0') {
 		if (unlink(destroy_ctx->pm_path)) {
 			SPDK_ERRLOG("%s could not be unlinked: %s\n",
 				    destroy_ctx->pm_path, strerror(errno));
@@ -989,13 +2103,99 @@ _request_spans_chunk_boundary(struct spdk_reduce_vol *vol, uint64_t offset, uint
 
 typedef void (*reduce_request_fn)(void *_req, int reduce_errno);
 
+static struct reduce_cache_entry *
+_reduce_vol_cache_lookup(struct spdk_reduce_vol *vol, uint64_t logical_map_index)
+{
+	struct reduce_cache_entry *entry;
+
+	TAILQ_FOREACH(entry, &vol->cache_lru, tailq) {
+		if (entry->logical_map_index == logical_map_index) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/* Copies the blocks read from the cached chunk, if there is one. */
+static bool
+_reduce_vol_cache_read(struct spdk_reduce_vol *vol, struct iovec *iov, int iovcnt,
+		       uint64_t offset)
+{
+	struct reduce_cache_entry *entry;
+	uint8_t *buf;
+	int i;
+
+	entry = _reduce_vol_cache_lookup(vol, offset / vol->logical_blocks_per_chunk);
+	if (entry == NULL) {
+		return false;
+	}
+
+	buf = entry->buf + (offset % vol->logical_blocks_per_chunk) * vol->params.logical_block_size;
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(iov[i].iov_base, buf, iov[i].iov_len);
+		buf += iov[i].iov_len;
+	}
+
+	TAILQ_REMOVE(&vol->cache_lru, entry, tailq);
+	TAILQ_INSERT_HEAD(&vol->cache_lru, entry, tailq);
+	return true;
+}
+
+/* Caches a chunk, iov holding all its data, in place of the least recently used one. */
+static void
+_reduce_vol_cache_insert(struct spdk_reduce_vol *vol, uint64_t logical_map_index,
+			 struct iovec *iov, int iovcnt)
+{
+	struct reduce_cache_entry *entry;
+	uint8_t *buf;
+	int i;
+
+	entry = _reduce_vol_cache_lookup(vol, logical_map_index);
+	if (entry == NULL) {
+		entry = TAILQ_LAST(&vol->cache_lru, reduce_cache_lru);
+		if (entry == NULL) {
+			return;
+		}
+	}
+
+	buf = entry->buf;
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(buf, iov[i].iov_base, iov[i].iov_len);
+		buf += iov[i].iov_len;
+	}
+	assert(buf == entry->buf + vol->params.chunk_size);
+
+	entry->logical_map_index = logical_map_index;
+	TAILQ_REMOVE(&vol->cache_lru, entry, tailq);
+	TAILQ_INSERT_HEAD(&vol->cache_lru, entry, tailq);
+}
+
+static void
+_reduce_vol_cache_invalidate(struct spdk_reduce_vol *vol, uint64_t logical_map_index)
+{
+	struct reduce_cache_entry *entry;
+
+	entry = _reduce_vol_cache_lookup(vol, logical_map_index);
+	if (entry != NULL) {
+		entry->logical_map_index = REDUCE_EMPTY_MAP_ENTRY;
+		TAILQ_REMOVE(&vol->cache_lru, entry, tailq);
+		TAILQ_INSERT_TAIL(&vol->cache_lru, entry, tailq);
+	}
+}
+
+static void _reduce_vol_compact_put(struct spdk_reduce_vol *vol, int reduce_errno);
+
 static void
 _reduce_vol_complete_req(struct spdk_reduce_vol_request *req, int reduce_errno)
 {
 	struct spdk_reduce_vol_request *next_req;
 	struct spdk_reduce_vol *vol = req->vol;
+	int type = req->type;
 
-	req->cb_fn(req->cb_arg, reduce_errno);
+	if (type != REDUCE_IO_COMPACT) {
+		req->cb_fn(req->cb_arg, reduce_errno);
+	}
 	TAILQ_REMOVE(&vol->executing_requests, req, tailq);
 
 	TAILQ_FOREACH(next_req, &vol->queued_requests, tailq) {
@@ -1012,28 +2212,23 @@ _reduce_vol_complete_req(struct spdk_reduce_vol_request *req, int reduce_errno)
 	}
 
 	TAILQ_INSERT_HEAD(&vol->free_requests, req, tailq);
+
+	/* The end of a compaction may unload the volume, so it is completed last. */
+	if (type == REDUCE_IO_COMPACT) {
+		_reduce_vol_compact_put(vol, reduce_errno);
+	}
 }
 
 static void
-_write_write_done(void *_req, int reduce_errno)
+_write_md_done(struct spdk_reduce_vol_request *req, int reduce_errno)
 {
-	struct spdk_reduce_vol_request *req = _req;
 	struct spdk_reduce_vol *vol = req->vol;
 	uint64_t old_chunk_map_index;
 	struct spdk_reduce_chunk_map *old_chunk;
 	uint32_t i;
 
 	if (reduce_errno != 0) {
-		req->reduce_errno = reduce_errno;
-	}
-
-	assert(req->num_backing_ops > 0);
-	if (--req->num_backing_ops > 0) {
-		return;
-	}
-
-	if (req->reduce_errno != 0) {
-		_reduce_vol_complete_req(req, req->reduce_errno);
+		_reduce_vol_complete_req(req, reduce_errno);
 		return;
 	}
 
@@ -1044,8 +2239,7 @@ _write_write_done(void *_req, int reduce_errno)
 			if (old_chunk->io_unit_index[i] == REDUCE_EMPTY_MAP_ENTRY) {
 				break;
 			}
-			assert(spdk_bit_array_get(vol->allocated_backing_io_units, old_chunk->io_unit_index[i]) == true);
-			spdk_bit_array_clear(vol->allocated_backing_io_units, old_chunk->io_unit_index[i]);
+			_reduce_vol_put_io_unit(vol, old_chunk->io_unit_index[i]);
 			old_chunk->io_unit_index[i] = REDUCE_EMPTY_MAP_ENTRY;
 		}
 		spdk_bit_array_clear(vol->allocated_chunk_maps, old_chunk_map_index);
@@ -1057,15 +2251,159 @@ _write_write_done(void *_req, int reduce_errno)
 	 * longer have a reference to it in the logical map.
 	 */
 
+	vol->pm_logical_map[req->logical_map_index] = req->chunk_map_index;
+
+	_reduce_persist(vol, &vol->pm_logical_map[req->logical_map_index], sizeof(uint64_t));
+
+	_reduce_vol_complete_req(req, 0);
+}
+
+static void
+_write_write_done(void *_req, int reduce_errno)
+{
+	struct spdk_reduce_vol_request *req = _req;
+	struct spdk_reduce_vol *vol = req->vol;
+
+	if (reduce_errno != 0) {
+		req->reduce_errno = reduce_errno;
+	}
+
+	assert(req->num_backing_ops > 0);
+	if (--req->num_backing_ops > 0) {
+		return;
+	}
+
+	if (req->reduce_errno != 0) {
+		_reduce_vol_complete_req(req, req->reduce_errno);
+		return;
+	}
+
 	/* Persist the new chunk map.  This must be persisted before we update the logical map. */
 	_reduce_persist(vol, req->chunk,
 			_reduce_vol_get_chunk_struct_size(vol->backing_io_units_per_chunk));
 
-	vol->pm_logical_map[req->logical_map_index] = req->chunk_map_index;
+	if (vol->md != NULL) {
+		/* The old chunk map and its io units may only be reused once the update is logged. */
+		_reduce_md_log_chunk_map(req);
+		return;
+	}
 
-	_reduce_persist(vol, &vol->pm_logical_map[req->logical_map_index], sizeof(uint64_t));
+	_write_md_done(req, 0);
+}
 
-	_reduce_vol_complete_req(req, 0);
+static void
+_reduce_pack_unit_release(struct reduce_pack_unit *pu)
+{
+	struct spdk_reduce_vol *vol = pu->vol;
+
+	/* A pack unit is released once it stopped accepting fragments and all of its
+	 *  fragments were written.
+	 */
+	if (pu == vol->open_pack_unit || pu->io_unit_index == REDUCE_EMPTY_MAP_ENTRY ||
+	    pu->flushing || !TAILQ_EMPTY(&pu->pending)) {
+		return;
+	}
+
+	_reduce_vol_put_io_unit(vol, pu->io_unit_index);
+	pu->io_unit_index = REDUCE_EMPTY_MAP_ENTRY;
+	TAILQ_INSERT_TAIL(&vol->free_pack_units, pu, link);
+}
+
+static void _reduce_pack_unit_flush_done(void *cb_arg, int reduce_errno);
+
+static void
+_reduce_pack_unit_flush(struct reduce_pack_unit *pu)
+{
+	struct spdk_reduce_vol *vol = pu->vol;
+
+	if (pu->flushing || TAILQ_EMPTY(&pu->pending)) {
+		return;
+	}
+
+	pu->flushing = true;
+	TAILQ_CONCAT(&pu->flushing_reqs, &pu->pending, pack_tailq);
+	pu->iov.iov_base = pu->buf;
+	pu->iov.iov_len = vol->params.backing_io_unit_size;
+	pu->backing_cb_args.cb_fn = _reduce_pack_unit_flush_done;
+	pu->backing_cb_args.cb_arg = pu;
+	/* This also writes the fragments of chunks already in the io unit again, with the
+	 *  same data, so they are not affected even if the write is torn.
+	 */
+	vol->backing_dev->writev(vol->backing_dev, &pu->iov, 1,
+				 pu->io_unit_index * vol->backing_lba_per_io_unit,
+				 vol->backing_lba_per_io_unit, &pu->backing_cb_args);
+}
+
+static void
+_reduce_pack_unit_flush_done(void *cb_arg, int reduce_errno)
+{
+	struct reduce_pack_unit *pu = cb_arg;
+	struct spdk_reduce_vol_request *req;
+	TAILQ_HEAD(, spdk_reduce_vol_request) done_reqs = TAILQ_HEAD_INITIALIZER(done_reqs);
+
+	TAILQ_CONCAT(&done_reqs, &pu->flushing_reqs, pack_tailq);
+	pu->flushing = false;
+
+	/* Write the fragments added while this write was in progress. */
+	_reduce_pack_unit_flush(pu);
+	_reduce_pack_unit_release(pu);
+
+	while ((req = TAILQ_FIRST(&done_reqs)) != NULL) {
+		TAILQ_REMOVE(&done_reqs, req, pack_tailq);
+		req->pack_unit = NULL;
+		req->backing_cb_args.cb_fn(req->backing_cb_args.cb_arg, reduce_errno);
+	}
+}
+
+/* Find room for a fragment of the given size.  It goes to the open pack unit if it
+ *  fits, to a new pack unit otherwise, and whichever of the two has the most room left
+ *  stays open.  Returns NULL if all pack units are busy.
+ */
+static struct reduce_pack_unit *
+_reduce_vol_pack_reserve(struct spdk_reduce_vol *vol, uint32_t fragment_size,
+			 uint64_t *io_unit_index, uint32_t *offset)
+{
+	struct reduce_pack_unit *pu = vol->open_pack_unit, *prev;
+
+	if (pu == NULL || pu->offset + fragment_size > vol->params.backing_io_unit_size ||
+	    vol->io_unit_refs[pu->io_unit_index] == UINT8_MAX) {
+		pu = TAILQ_FIRST(&vol->free_pack_units);
+		if (pu == NULL) {
+			return NULL;
+		}
+
+		TAILQ_REMOVE(&vol->free_pack_units, pu, link);
+		pu->io_unit_index = _reduce_vol_get_io_unit(vol);
+		pu->offset = 0;
+		memset(pu->buf, 0, vol->params.backing_io_unit_size);
+
+		prev = vol->open_pack_unit;
+		if (prev == NULL || vol->io_unit_refs[prev->io_unit_index] == UINT8_MAX ||
+		    fragment_size <= prev->offset) {
+			vol->open_pack_unit = pu;
+			if (prev != NULL) {
+				_reduce_pack_unit_release(prev);
+			}
+		}
+	}
+
+	*io_unit_index = pu->io_unit_index;
+	*offset = pu->offset;
+	pu->offset += fragment_size;
+	vol->io_unit_refs[pu->io_unit_index]++;
+
+	return pu;
+}
+
+static void
+_reduce_vol_pack_submit(struct spdk_reduce_vol_request *req, const uint8_t *fragment,
+			uint32_t fragment_size)
+{
+	struct reduce_pack_unit *pu = req->pack_unit;
+
+	memcpy(pu->buf + req->chunk->fragment_offset, fragment, fragment_size);
+	TAILQ_INSERT_TAIL(&pu->pending, req, pack_tailq);
+	_reduce_pack_unit_flush(pu);
 }
 
 static void
@@ -1074,7 +2412,8 @@ _issue_backing_ops(struct spdk_reduce_vol_request *req, struct spdk_reduce_vol *
 {
 	struct iovec *iov;
 	uint8_t *buf;
-	uint32_t i;
+	uint64_t lba;
+	uint32_t i, lba_count, fragment_size;
 
 	if (req->chunk_is_compressed) {
 		iov = req->comp_buf_iov;
@@ -1084,30 +2423,57 @@ _issue_backing_ops(struct spdk_reduce_vol_request *req, struct spdk_reduce_vol *
 		buf = req->decomp_buf;
 	}
 
+	fragment_size = _reduce_vol_fragment_size(vol, req->chunk);
 	req->num_backing_ops = req->num_io_units;
 	req->backing_cb_args.cb_fn = next_fn;
 	req->backing_cb_args.cb_arg = req;
 	for (i = 0; i < req->num_io_units; i++) {
 		iov[i].iov_base = buf + i * vol->params.backing_io_unit_size;
 		iov[i].iov_len = vol->params.backing_io_unit_size;
+		lba = req->chunk->io_unit_index[i] * vol->backing_lba_per_io_unit;
+		lba_count = vol->backing_lba_per_io_unit;
+		if (fragment_size != 0 && i == req->num_io_units - 1) {
+			if (is_write && req->pack_unit != NULL) {
+				_reduce_vol_pack_submit(req, iov[i].iov_base, fragment_size);
+				continue;
+			}
+			/* Only the blocks holding the fragment are needed. */
+			_reduce_vol_get_fragment_blocks(vol, req->chunk, i, fragment_size,
+							&lba, &lba_count);
+			iov[i].iov_len = lba_count * vol->backing_dev->blocklen;
+		}
 		if (is_write) {
-			vol->backing_dev->writev(vol->backing_dev, &iov[i], 1,
-						 req->chunk->io_unit_index[i] * vol->backing_lba_per_io_unit,
-						 vol->backing_lba_per_io_unit, &req->backing_cb_args);
+			vol->backing_dev->writev(vol->backing_dev, &iov[i], 1, lba, lba_count,
+						 &req->backing_cb_args);
 		} else {
-			vol->backing_dev->readv(vol->backing_dev, &iov[i], 1,
-						req->chunk->io_unit_index[i] * vol->backing_lba_per_io_unit,
-						vol->backing_lba_per_io_unit, &req->backing_cb_args);
+			vol->backing_dev->readv(vol->backing_dev, &iov[i], 1, lba, lba_count,
+						&req->backing_cb_args);
 		}
 	}
 }
 
+/* Move the fragment read by _issue_backing_ops() right after the rest of the compressed data. */
+static void
+_reduce_vol_gather_fragment(struct spdk_reduce_vol_request *req)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	uint32_t fragment_size = _reduce_vol_fragment_size(vol, req->chunk);
+	uint8_t *buf;
+
+	if (fragment_size == 0) {
+		return;
+	}
+
+	buf = req->comp_buf + (req->num_io_units - 1) * vol->params.backing_io_unit_size;
+	memmove(buf, buf + req->chunk->fragment_offset % vol->backing_dev->blocklen, fragment_size);
+}
+
 static void
 _reduce_vol_write_chunk(struct spdk_reduce_vol_request *req, reduce_request_fn next_fn,
 			uint32_t compressed_size)
 {
 	struct spdk_reduce_vol *vol = req->vol;
-	uint32_t i;
+	uint32_t i, fragment_size;
 	uint64_t chunk_offset, remainder, total_len = 0;
 	uint8_t *buf;
 	int j;
@@ -1155,13 +2521,20 @@ _reduce_vol_write_chunk(struct spdk_reduce_vol_request *req, reduce_request_fn n
 		assert(total_len == vol->params.chunk_size);
 	}
 
+	req->pack_unit = NULL;
+	req->chunk->fragment_offset = 0;
+	fragment_size = _reduce_vol_fragment_size(vol, req->chunk);
 	for (i = 0; i < req->num_io_units; i++) {
-		req->chunk->io_unit_index[i] = spdk_bit_array_find_first_clear(vol->allocated_backing_io_units, 0);
-		/* TODO: fail if no backing block found - but really this should also not
-		 * happen (see comment above).
-		 */
-		assert(req->chunk->io_unit_index[i] != UINT32_MAX);
-		spdk_bit_array_set(vol->allocated_backing_io_units, req->chunk->io_unit_index[i]);
+		if (fragment_size != 0 && i == req->num_io_units - 1) {
+			req->pack_unit = _reduce_vol_pack_reserve(vol, fragment_size,
+					 &req->chunk->io_unit_index[i],
+					 &req->chunk->fragment_offset);
+			if (req->pack_unit != NULL) {
+				break;
+			}
+			/* All pack units are busy, the fragment gets an io unit of its own. */
+		}
+		req->chunk->io_unit_index[i] = _reduce_vol_get_io_unit(vol);
 	}
 
 	_issue_backing_ops(req, vol, next_fn, true /* write */);
@@ -1425,6 +2798,7 @@ _write_read_done(void *_req, int reduce_errno)
 	}
 
 	if (req->chunk_is_compressed) {
+		_reduce_vol_gather_fragment(req);
 		_reduce_vol_decompress_chunk_scratch(req, _write_decompress_done);
 	} else {
 		_write_decompress_done(req, req->chunk->compressed_size);
@@ -1436,6 +2810,7 @@ _read_decompress_done(void *_req, int reduce_errno)
 {
 	struct spdk_reduce_vol_request *req = _req;
 	struct spdk_reduce_vol *vol = req->vol;
+	struct iovec iov;
 
 	/* Negative reduce_errno indicates failure for compression operations. */
 	if (reduce_errno < 0) {
@@ -1464,6 +2839,18 @@ _read_decompress_done(void *_req, int reduce_errno)
 		}
 	}
 
+	/* The whole chunk is in the decompression iovs, or the scratch buffer if it was
+	 *  stored uncompressed.
+	 */
+	if (req->chunk_is_compressed) {
+		_reduce_vol_cache_insert(vol, req->logical_map_index, req->decomp_iov,
+					 req->decomp_iovcnt);
+	} else {
+		iov.iov_base = req->decomp_buf;
+		iov.iov_len = vol->params.chunk_size;
+		_reduce_vol_cache_insert(vol, req->logical_map_index, &iov, 1);
+	}
+
 	_reduce_vol_complete_req(req, 0);
 }
 
@@ -1490,6 +2877,7 @@ _read_read_done(void *_req, int reduce_errno)
 	}
 
 	if (req->chunk_is_compressed) {
+		_reduce_vol_gather_fragment(req);
 		_reduce_vol_decompress_chunk(req, _read_decompress_done);
 	} else {
 
@@ -1559,6 +2947,12 @@ static void
 _start_readv_request(struct spdk_reduce_vol_request *req)
 {
 	TAILQ_INSERT_TAIL(&req->vol->executing_requests, req, tailq);
+	/* Reads queued behind a read of the same chunk find it cached. */
+	if (_reduce_vol_cache_read(req->vol, req->iov, req->iovcnt, req->offset)) {
+		_reduce_vol_complete_req(req, 0);
+		return;
+	}
+
 	_reduce_vol_read_chunk(req, _read_read_done);
 }
 
@@ -1603,6 +2997,11 @@ spdk_reduce_vol_readv(struct spdk_reduce_vol *vol,
 		return;
 	}
 
+	if (!overlapped && _reduce_vol_cache_read(vol, iov, iovcnt, offset)) {
+		cb_fn(cb_arg, 0);
+		return;
+	}
+
 	req = TAILQ_FIRST(&vol->free_requests);
 	if (req == NULL) {
 		cb_fn(cb_arg, -ENOMEM);
@@ -1634,6 +3033,7 @@ _start_writev_request(struct spdk_reduce_vol_request *req)
 	struct spdk_reduce_vol *vol = req->vol;
 
 	TAILQ_INSERT_TAIL(&req->vol->executing_requests, req, tailq);
+	_reduce_vol_cache_invalidate(vol, req->logical_map_index);
 	if (vol->pm_logical_map[req->logical_map_index] != REDUCE_EMPTY_MAP_ENTRY) {
 		if ((req->length * vol->params.logical_block_size) < vol->params.chunk_size) {
 			/* Read old chunk, then overwrite with data from this write
@@ -1703,6 +3103,181 @@ spdk_reduce_vol_writev(struct spdk_reduce_vol *vol,
 	}
 }
 
+static void
+_reduce_vol_compact_put(struct spdk_reduce_vol *vol, int reduce_errno)
+{
+	spdk_reduce_vol_op_complete cb_fn = vol->compact.cb_fn;
+
+	if (reduce_errno != 0 && vol->compact.status == 0) {
+		vol->compact.status = reduce_errno;
+	}
+
+	assert(vol->compact.outstanding > 0);
+	if (--vol->compact.outstanding > 0) {
+		return;
+	}
+
+	vol->compact.cb_fn = NULL;
+	cb_fn(vol->compact.cb_arg, vol->compact.status);
+
+	if (vol->unload_cb_fn != NULL) {
+		_reduce_vol_unload(vol, vol->unload_cb_fn, vol->unload_cb_arg);
+	}
+}
+
+static void
+_compact_read_done(void *_req, int reduce_errno)
+{
+	struct spdk_reduce_vol_request *req = _req;
+	struct spdk_reduce_vol *vol = req->vol;
+	struct spdk_reduce_chunk_map *old_chunk;
+	uint32_t i, last, fragment_size;
+
+	if (reduce_errno != 0) {
+		_reduce_vol_complete_req(req, reduce_errno);
+		return;
+	}
+
+	old_chunk = _reduce_vol_get_chunk_map(vol, vol->pm_logical_map[req->logical_map_index]);
+	fragment_size = _reduce_vol_fragment_size(vol, old_chunk);
+	last = req->num_io_units - 1;
+
+	req->chunk_map_index = spdk_bit_array_find_first_clear(vol->allocated_chunk_maps, 0);
+	assert(req->chunk_map_index != UINT32_MAX);
+	req->chunk = _reduce_vol_get_chunk_map(vol, req->chunk_map_index);
+	req->pack_unit = _reduce_vol_pack_reserve(vol, fragment_size,
+			 &req->chunk->io_unit_index[last],
+			 &req->chunk->fragment_offset);
+	if (req->pack_unit == NULL) {
+		/* All pack units are busy, leave the chunk where it is. */
+		_reduce_vol_complete_req(req, 0);
+		return;
+	}
+
+	spdk_bit_array_set(vol->allocated_chunk_maps, req->chunk_map_index);
+	req->chunk->compressed_size = old_chunk->compressed_size;
+	for (i = 0; i < last; i++) {
+		/* The whole io units are shared with the old chunk map until it is released. */
+		req->chunk->io_unit_index[i] = old_chunk->io_unit_index[i];
+		vol->io_unit_refs[req->chunk->io_unit_index[i]]++;
+	}
+
+	/* Completing the write of the fragment releases the old chunk map and its io unit. */
+	req->num_backing_ops = 1;
+	req->backing_cb_args.cb_fn = _write_write_done;
+	req->backing_cb_args.cb_arg = req;
+	_reduce_vol_pack_submit(req,
+				req->comp_buf + old_chunk->fragment_offset % vol->backing_dev->blocklen,
+				fragment_size);
+}
+
+static void
+_reduce_vol_compact_chunk(struct spdk_reduce_vol_request *req)
+{
+	struct spdk_reduce_vol *vol = req->vol;
+	struct spdk_reduce_chunk_map *chunk;
+	uint32_t fragment_size, lba_count;
+	uint64_t lba;
+
+	chunk = _reduce_vol_get_chunk_map(vol, vol->pm_logical_map[req->logical_map_index]);
+	fragment_size = _reduce_vol_fragment_size(vol, chunk);
+	req->num_io_units = spdk_divide_round_up(chunk->compressed_size,
+			    vol->params.backing_io_unit_size);
+	req->chunk_is_compressed = true;
+
+	/* Only the fragment moves, read it. */
+	_reduce_vol_get_fragment_blocks(vol, chunk, req->num_io_units - 1, fragment_size,
+					&lba, &lba_count);
+	req->comp_buf_iov[0].iov_base = req->comp_buf;
+	req->comp_buf_iov[0].iov_len = lba_count * vol->backing_dev->blocklen;
+	req->backing_cb_args.cb_fn = _compact_read_done;
+	req->backing_cb_args.cb_arg = req;
+	vol->backing_dev->readv(vol->backing_dev, req->comp_buf_iov, 1, lba, lba_count,
+				&req->backing_cb_args);
+}
+
+/* A chunk is worth compacting if its fragment is alone in an io unit it fills at most
+ *  half of.  Moving the fragment to a pack unit frees the whole io unit.
+ */
+static bool
+_reduce_vol_chunk_needs_compaction(struct spdk_reduce_vol *vol, uint64_t logical_map_index)
+{
+	struct spdk_reduce_chunk_map *chunk;
+	uint64_t chunk_map_index;
+	uint32_t fragment_size, num_io_units;
+
+	chunk_map_index = vol->pm_logical_map[logical_map_index];
+	if (chunk_map_index == REDUCE_EMPTY_MAP_ENTRY || _check_overlap(vol, logical_map_index)) {
+		return false;
+	}
+
+	chunk = _reduce_vol_get_chunk_map(vol, chunk_map_index);
+	fragment_size = _reduce_vol_fragment_size(vol, chunk);
+	if (fragment_size == 0 || fragment_size > vol->params.backing_io_unit_size / 2) {
+		return false;
+	}
+
+	num_io_units = spdk_divide_round_up(chunk->compressed_size,
+					    vol->params.backing_io_unit_size);
+	return vol->io_unit_refs[chunk->io_unit_index[num_io_units - 1]] == 1;
+}
+
+void
+spdk_reduce_vol_compact(struct spdk_reduce_vol *vol, uint64_t max_chunks,
+			spdk_reduce_vol_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_reduce_vol_request *req;
+	uint64_t i, num_chunks, logical_map_index;
+
+	if (!_reduce_vol_is_packed(vol)) {
+		cb_fn(cb_arg, -ENOTSUP);
+		return;
+	}
+
+	if (vol->compact.cb_fn != NULL || vol->unload_cb_fn != NULL) {
+		cb_fn(cb_arg, -EBUSY);
+		return;
+	}
+
+	vol->compact.cb_fn = cb_fn;
+	vol->compact.cb_arg = cb_arg;
+	vol->compact.status = 0;
+	/* Hold a reference until all the chunks were looked at. */
+	vol->compact.outstanding = 1;
+
+	num_chunks = vol->params.vol_size / vol->params.chunk_size;
+	max_chunks = spdk_min(max_chunks, num_chunks);
+	for (i = 0; i < max_chunks; i++) {
+		logical_map_index = vol->compact.next_index;
+		if (_reduce_vol_chunk_needs_compaction(vol, logical_map_index)) {
+			req = TAILQ_FIRST(&vol->free_requests);
+			if (req == NULL) {
+				/* Look at this chunk again next time. */
+				break;
+			}
+
+			TAILQ_REMOVE(&vol->free_requests, req, tailq);
+			req->type = REDUCE_IO_COMPACT;
+			req->vol = vol;
+			req->iov = NULL;
+			req->iovcnt = 0;
+			req->offset = logical_map_index * vol->logical_blocks_per_chunk;
+			req->logical_map_index = logical_map_index;
+			req->length = 0;
+			req->copy_after_decompress = false;
+			req->cb_fn = NULL;
+			req->cb_arg = NULL;
+
+			vol->compact.outstanding++;
+			TAILQ_INSERT_TAIL(&vol->executing_requests, req, tailq);
+			_reduce_vol_compact_chunk(req);
+		}
+		vol->compact.next_index = (logical_map_index + 1) % num_chunks;
+	}
+
+	_reduce_vol_compact_put(vol, 0);
+}
+
 const struct spdk_reduce_vol_params *
 spdk_reduce_vol_get_params(struct spdk_reduce_vol *vol)
 {
@@ -1721,6 +3296,7 @@ spdk_reduce_vol_print_info(struct spdk_reduce_vol *vol)
 	SPDK_NOTICELOG("\tvol->params.logical_block_size = 0x%x\n", vol->params.logical_block_size);
 	SPDK_NOTICELOG("\tvol->params.chunk_size = 0x%x\n", vol->params.chunk_size);
 	SPDK_NOTICELOG("\tvol->params.vol_size = 0x%" PRIx64 "\n", vol->params.vol_size);
+	SPDK_NOTICELOG("\tvol->params.flags = 0x%x\n", vol->params.flags);
 	num_chunks = _get_total_chunks(vol->params.vol_size, vol->params.chunk_size);
 	SPDK_NOTICELOG("\ttotal chunks (including extra) = 0x%" PRIx64 "\n", num_chunks);
 	SPDK_NOTICELOG("\ttotal chunks (excluding extra) = 0x%" PRIx64 "\n",
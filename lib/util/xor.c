@@ -0,0 +1,166 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/xor.h"
+#include "spdk/config.h"
+#include "spdk/assert.h"
+#include "spdk/util.h"
+
+/* xor_gen_basic() works on words, the vectorized kernels on 32 byte lanes. */
+#define SPDK_XOR_BUF_ALIGN 32
+
+static inline bool
+is_aligned(void *ptr, size_t alignment)
+{
+	return ((uintptr_t)ptr & (alignment - 1)) == 0;
+}
+
+static bool
+buffers_aligned(void *dest, void **sources, uint32_t n, size_t len, size_t alignment)
+{
+	uint32_t i;
+
+	if (!is_aligned(dest, alignment) || (len & (alignment - 1)) != 0) {
+		return false;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!is_aligned(sources[i], alignment)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+xor_gen_unaligned(void *dest, void **sources, uint32_t n, size_t len)
+{
+	uint32_t i;
+	size_t off;
+	uint8_t b;
+
+	for (off = 0; off < len; off++) {
+		b = ((uint8_t *)sources[0])[off];
+		for (i = 1; i < n; i++) {
+			b ^= ((uint8_t *)sources[i])[off];
+		}
+		((uint8_t *)dest)[off] = b;
+	}
+}
+
+static void
+xor_gen_basic(void *dest, void **sources, uint32_t n, size_t len)
+{
+	uint32_t shift = spdk_u32log2(sizeof(uint64_t));
+	uint64_t *src, *dst = dest;
+	size_t i, len64 = len >> shift;
+	uint32_t j;
+
+	/* The destination may be one of the sources, so each word of the result
+	 * is computed in full before it is stored. */
+	for (i = 0; i < len64; i++) {
+		uint64_t w = ((uint64_t *)sources[0])[i];
+
+		for (j = 1; j < n; j++) {
+			src = sources[j];
+			w ^= src[i];
+		}
+		dst[i] = w;
+	}
+}
+
+#ifdef SPDK_CONFIG_ISAL
+#include "isa-l/include/raid.h"
+#elif defined(__x86_64__)
+#include <immintrin.h>
+#define XOR_GEN_AVX2
+
+/* Four 256 bit lanes per iteration to keep the load ports busy. */
+__attribute__((target("avx2"))) static void
+xor_gen_avx2(void *dest, void **sources, uint32_t n, size_t len)
+{
+	__m256i r0, r1, r2, r3;
+	uint8_t *src;
+	size_t off;
+	uint32_t j;
+
+	assert(len % (4 * sizeof(__m256i)) == 0);
+
+	for (off = 0; off < len; off += 4 * sizeof(__m256i)) {
+		src = (uint8_t *)sources[0] + off;
+		r0 = _mm256_load_si256((const __m256i *)src);
+		r1 = _mm256_load_si256((const __m256i *)(src + 32));
+		r2 = _mm256_load_si256((const __m256i *)(src + 64));
+		r3 = _mm256_load_si256((const __m256i *)(src + 96));
+		for (j = 1; j < n; j++) {
+			src = (uint8_t *)sources[j] + off;
+			r0 = _mm256_xor_si256(r0, _mm256_load_si256((const __m256i *)src));
+			r1 = _mm256_xor_si256(r1, _mm256_load_si256((const __m256i *)(src + 32)));
+			r2 = _mm256_xor_si256(r2, _mm256_load_si256((const __m256i *)(src + 64)));
+			r3 = _mm256_xor_si256(r3, _mm256_load_si256((const __m256i *)(src + 96)));
+		}
+		_mm256_store_si256((__m256i *)((uint8_t *)dest + off), r0);
+		_mm256_store_si256((__m256i *)((uint8_t *)dest + off + 32), r1);
+		_mm256_store_si256((__m256i *)((uint8_t *)dest + off + 64), r2);
+		_mm256_store_si256((__m256i *)((uint8_t *)dest + off + 96), r3);
+	}
+}
+#endif
+
+static int
+do_xor_gen(void *dest, void **sources, uint32_t n, size_t len)
+{
+	bool aligned = buffers_aligned(dest, sources, n, len, SPDK_XOR_BUF_ALIGN);
+
+#ifdef SPDK_CONFIG_ISAL
+	/* ISA-L picks the widest kernel the CPU supports, AVX-512 included. */
+	if (aligned && len <= INT_MAX) {
+		void *buffers[n + 1];
+
+		memcpy(buffers, sources, n * sizeof(buffers[0]));
+		buffers[n] = dest;
+
+		if (xor_gen(n + 1, len, buffers) == 0) {
+			return 0;
+		}
+	}
+#elif defined(XOR_GEN_AVX2)
+	if (aligned && len % (4 * SPDK_XOR_BUF_ALIGN) == 0 && __builtin_cpu_supports("avx2")) {
+		xor_gen_avx2(dest, sources, n, len);
+		return 0;
+	}
+#endif
+	if (!aligned && !buffers_aligned(dest, sources, n, len, sizeof(uint64_t))) {
+		return -EINVAL;
+	}
+
+	xor_gen_basic(dest, sources, n, len);
+	return 0;
+}
+
+int
+spdk_xor_gen(void *dest, void **sources, uint32_t n, size_t len)
+{
+	if (n < 2) {
+		return -EINVAL;
+	}
+
+	if (do_xor_gen(dest, sources, n, len) != 0) {
+		/* Unaligned buffers or length */
+		xor_gen_unaligned(dest, sources, n, len);
+	}
+
+	return 0;
+}
+
+size_t
+spdk_xor_get_optimal_alignment(void)
+{
+	return SPDK_XOR_BUF_ALIGN;
+}
+
+SPDK_STATIC_ASSERT(SPDK_XOR_BUF_ALIGN > 0 && !(SPDK_XOR_BUF_ALIGN & (SPDK_XOR_BUF_ALIGN - 1)),
+		   "Must be power of 2");
@@ -161,6 +161,14 @@ LDFLAGS += -L$(CONFIG_URING_PATH)
 endif
 endif
 
+ifeq ($(CONFIG_LZ4),y)
+SYS_LIBS += -llz4
+endif
+
+ifeq ($(CONFIG_ZSTD),y)
+SYS_LIBS += -lzstd
+endif
+
 IPSEC_MB_DIR=$(CONFIG_IPSEC_MB_DIR)
 
 ISAL_DIR=$(SPDK_ROOT_DIR)/isa-l
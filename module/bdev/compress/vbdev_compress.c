@@ -8,6 +8,7 @@
 
 #include "spdk/reduce.h"
 #include "spdk/stdinc.h"
+#include "spdk/accel.h"
 #include "spdk/rpc.h"
 #include "spdk/env.h"
 #include "spdk/endian.h"
@@ -44,10 +45,14 @@ static int g_mbuf_offset;
 #define CHUNK_SIZE (1024 * 16)
 #define COMP_BDEV_NAME "compress"
 #define BACKING_IO_SZ (4 * 1024)
+/* Packed volumes are compacted in the background, a batch of chunks at a time. */
+#define COMPACT_PERIOD_US (100 * 1000)
+#define COMPACT_CHUNKS 256
 
 #define ISAL_PMD "compress_isal"
 #define QAT_PMD "compress_qat"
 #define MLX5_PMD "mlx5_pci"
+#define ACCEL_PMD "accel"
 #define NUM_MBUFS		8192
 #define POOL_CACHE_SIZE		256
 
@@ -107,11 +112,16 @@ struct vbdev_compress {
 	struct comp_io_channel		*comp_ch;	/* channel associated with this bdev */
 	char				*drv_name;	/* name of the compression device driver */
 	struct comp_device_qp		*device_qp;
+	bool				use_accel;	/* compress through the accel framework */
+	struct spdk_io_channel		*accel_ch;	/* accel channel on the reduce thread */
 	struct spdk_thread		*reduce_thread;
 	pthread_mutex_t			reduce_lock;
 	uint32_t			ch_count;
 	TAILQ_HEAD(, spdk_bdev_io)	pending_comp_ios;	/* outstanding operations to a comp library */
 	struct spdk_poller		*poller;	/* completion poller */
+	struct spdk_poller		*compact_poller;
+	bool				compacting;
+	bool				cleanup_deferred; /* waiting for the compaction */
 	struct spdk_reduce_vol_params	params;		/* params for the reduce volume */
 	struct spdk_reduce_backing_dev	backing_dev;	/* backing device info for the reduce volume */
 	struct spdk_reduce_vol		*vol;		/* the reduce volume */
@@ -716,6 +726,51 @@ comp_dev_poller(void *args)
 	return num_deq == 0 ? SPDK_POLLER_IDLE : SPDK_POLLER_BUSY;
 }
 
+static void
+_accel_compress_done(void *arg, int status)
+{
+	struct spdk_reduce_vol_cb_args *reduce_args = arg;
+
+	if (status == 0) {
+		reduce_args->cb_fn(reduce_args->cb_arg, reduce_args->output_size);
+	} else {
+		/* Reduce will simply store uncompressed on neg errno value. */
+		reduce_args->cb_fn(reduce_args->cb_arg, status);
+	}
+}
+
+/* Compress or decompress with the algorithm and level of the volume through the
+ * accel framework. The backing device doesn't report SGL support, so reduce only
+ * hands out single buffers. */
+static int
+_accel_compress_operation(struct spdk_reduce_backing_dev *backing_dev, struct iovec *src_iovs,
+			  int src_iovcnt, struct iovec *dst_iovs,
+			  int dst_iovcnt, bool compress, void *cb_arg)
+{
+	struct vbdev_compress *comp_bdev = SPDK_CONTAINEROF(backing_dev, struct vbdev_compress,
+					   backing_dev);
+	struct spdk_reduce_vol_cb_args *reduce_args = cb_arg;
+
+	if (src_iovcnt != 1 || dst_iovcnt != 1) {
+		SPDK_ERRLOG("accel compression doesn't support SGL\n");
+		return -EINVAL;
+	}
+
+	if (compress) {
+		return spdk_accel_submit_compress_ext(comp_bdev->accel_ch, dst_iovs[0].iov_base,
+						      src_iovs[0].iov_base, dst_iovs[0].iov_len,
+						      src_iovs[0].iov_len, &reduce_args->output_size,
+						      comp_bdev->params.comp_algo, comp_bdev->params.comp_level,
+						      0, _accel_compress_done, reduce_args);
+	} else {
+		return spdk_accel_submit_decompress_ext(comp_bdev->accel_ch, dst_iovs[0].iov_base,
+							src_iovs[0].iov_base, dst_iovs[0].iov_len,
+							src_iovs[0].iov_len, &reduce_args->output_size,
+							comp_bdev->params.comp_algo, 0,
+							_accel_compress_done, reduce_args);
+	}
+}
+
 /* Entry point for reduce lib to issue a compress operation. */
 static void
 _comp_reduce_compress(struct spdk_reduce_backing_dev *dev,
@@ -723,9 +778,14 @@ _comp_reduce_compress(struct spdk_reduce_backing_dev *dev,
 		      struct iovec *dst_iovs, int dst_iovcnt,
 		      struct spdk_reduce_vol_cb_args *cb_arg)
 {
+	struct vbdev_compress *comp_bdev = SPDK_CONTAINEROF(dev, struct vbdev_compress, backing_dev);
 	int rc;
 
-	rc = _compress_operation(dev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, true, cb_arg);
+	if (comp_bdev->use_accel) {
+		rc = _accel_compress_operation(dev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, true, cb_arg);
+	} else {
+		rc = _compress_operation(dev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, true, cb_arg);
+	}
 	if (rc) {
 		SPDK_ERRLOG("with compress operation code %d (%s)\n", rc, spdk_strerror(-rc));
 		cb_arg->cb_fn(cb_arg->cb_arg, rc);
@@ -739,9 +799,14 @@ _comp_reduce_decompress(struct spdk_reduce_backing_dev *dev,
 			struct iovec *dst_iovs, int dst_iovcnt,
 			struct spdk_reduce_vol_cb_args *cb_arg)
 {
+	struct vbdev_compress *comp_bdev = SPDK_CONTAINEROF(dev, struct vbdev_compress, backing_dev);
 	int rc;
 
-	rc = _compress_operation(dev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, false, cb_arg);
+	if (comp_bdev->use_accel) {
+		rc = _accel_compress_operation(dev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, false, cb_arg);
+	} else {
+		rc = _compress_operation(dev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, false, cb_arg);
+	}
 	if (rc) {
 		SPDK_ERRLOG("with decompress operation code %d (%s)\n", rc, spdk_strerror(-rc));
 		cb_arg->cb_fn(cb_arg->cb_arg, rc);
@@ -1084,6 +1149,11 @@ vbdev_compress_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&comp_bdev->comp_bdev));
 	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(comp_bdev->base_bdev));
 	spdk_json_write_named_string(w, "compression_pmd", comp_bdev->drv_name);
+	spdk_json_write_named_string(w, "comp_algo",
+				     spdk_accel_comp_algo_get_name(comp_bdev->params.comp_algo));
+	spdk_json_write_named_uint32(w, "comp_level", comp_bdev->params.comp_level);
+	spdk_json_write_named_bool(w, "packed",
+				   comp_bdev->params.flags & SPDK_REDUCE_VOL_FLAG_PACKED);
 	spdk_json_write_object_end(w);
 
 	return 0;
@@ -1344,7 +1414,17 @@ _prepare_for_load_init(struct spdk_bdev_desc *bdev_desc, uint32_t lb_size)
 static bool
 _set_pmd(struct vbdev_compress *comp_dev)
 {
-	if (g_opts == COMPRESS_PMD_AUTO) {
+	/* Only deflate has DPDK compression drivers */
+	if (comp_dev->params.comp_algo != SPDK_ACCEL_COMP_ALGO_DEFLATE ||
+	    g_opts == COMPRESS_PMD_ACCEL_ONLY) {
+		if (!spdk_accel_compress_algo_supported(comp_dev->params.comp_algo)) {
+			SPDK_ERRLOG("Compression algorithm %u is not supported by the accel framework.\n",
+				    comp_dev->params.comp_algo);
+			return false;
+		}
+		comp_dev->drv_name = ACCEL_PMD;
+		comp_dev->use_accel = true;
+	} else if (g_opts == COMPRESS_PMD_AUTO) {
 		if (g_qat_available) {
 			comp_dev->drv_name = QAT_PMD;
 		} else if (g_mlx5_pci_available) {
@@ -1368,7 +1448,8 @@ _set_pmd(struct vbdev_compress *comp_dev)
 
 /* Call reducelib to initialize a new volume */
 static int
-vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size)
+vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size,
+		  enum spdk_accel_comp_algo comp_algo, uint32_t comp_level, bool packed)
 {
 	struct spdk_bdev_desc *bdev_desc = NULL;
 	struct vbdev_compress *meta_ctx;
@@ -1387,6 +1468,15 @@ vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size)
 		return -EINVAL;
 	}
 
+	meta_ctx->params.comp_algo = comp_algo;
+	meta_ctx->params.comp_level = comp_level;
+	if (packed) {
+		meta_ctx->params.flags |= SPDK_REDUCE_VOL_FLAG_PACKED;
+	}
+	if (pm_path == NULL) {
+		meta_ctx->params.flags |= SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD;
+	}
+
 	if (_set_pmd(meta_ctx) == false) {
 		SPDK_ERRLOG("could not find required pmd\n");
 		free(meta_ctx);
@@ -1406,6 +1496,49 @@ vbdev_init_reduce(const char *bdev_name, const char *pm_path, uint32_t lb_size)
 	return 0;
 }
 
+static void _channel_cleanup(struct vbdev_compress *comp_bdev);
+static int comp_compact_poller(void *args);
+
+static void
+comp_compact_done(void *cb_arg, int reduce_errno)
+{
+	struct vbdev_compress *comp_bdev = cb_arg;
+
+	if (reduce_errno != 0) {
+		SPDK_ERRLOG("compaction of %s failed: %d\n",
+			    spdk_bdev_get_name(&comp_bdev->comp_bdev), reduce_errno);
+	}
+
+	pthread_mutex_lock(&comp_bdev->reduce_lock);
+	comp_bdev->compacting = false;
+	if (comp_bdev->cleanup_deferred) {
+		comp_bdev->cleanup_deferred = false;
+		_channel_cleanup(comp_bdev);
+	} else if (comp_bdev->compact_poller == NULL) {
+		/* A channel was created again while the compaction kept the last one. */
+		comp_bdev->compact_poller = SPDK_POLLER_REGISTER(comp_compact_poller,
+					    comp_bdev, COMPACT_PERIOD_US);
+	}
+	pthread_mutex_unlock(&comp_bdev->reduce_lock);
+}
+
+/* Runs on the reduce thread to free the backing io units left over by overwrites
+ * of a packed volume.
+ */
+static int
+comp_compact_poller(void *args)
+{
+	struct vbdev_compress *comp_bdev = args;
+
+	if (comp_bdev->compacting) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	comp_bdev->compacting = true;
+	spdk_reduce_vol_compact(comp_bdev->vol, COMPACT_CHUNKS, comp_compact_done, comp_bdev);
+	return SPDK_POLLER_BUSY;
+}
+
 /* We provide this callback for the SPDK channel code to create a channel using
  * the channel struct we provided in our module get_io_channel() entry point. Here
  * we get and save off an underlying base channel of the device below us so that
@@ -1420,7 +1553,10 @@ comp_bdev_ch_create_cb(void *io_device, void *ctx_buf)
 
 	/* Now set the reduce channel if it's not already set. */
 	pthread_mutex_lock(&comp_bdev->reduce_lock);
-	if (comp_bdev->ch_count == 0) {
+	if (comp_bdev->ch_count == 0 && comp_bdev->cleanup_deferred) {
+		/* The last channel is still in use by a compaction, keep using it. */
+		comp_bdev->cleanup_deferred = false;
+	} else if (comp_bdev->ch_count == 0) {
 		/* We use this queue to track outstanding IO in our layer. */
 		TAILQ_INIT(&comp_bdev->pending_comp_ios);
 
@@ -1429,28 +1565,42 @@ comp_bdev_ch_create_cb(void *io_device, void *ctx_buf)
 
 		comp_bdev->base_ch = spdk_bdev_get_io_channel(comp_bdev->base_desc);
 		comp_bdev->reduce_thread = spdk_get_thread();
-		comp_bdev->poller = SPDK_POLLER_REGISTER(comp_dev_poller, comp_bdev, 0);
-		/* Now assign a q pair */
-		pthread_mutex_lock(&g_comp_device_qp_lock);
-		TAILQ_FOREACH(device_qp, &g_comp_device_qp, link) {
-			if (strcmp(device_qp->device->cdev_info.driver_name, comp_bdev->drv_name) == 0) {
-				if (device_qp->thread == spdk_get_thread()) {
-					comp_bdev->device_qp = device_qp;
-					break;
-				}
-				if (device_qp->thread == NULL) {
-					comp_bdev->device_qp = device_qp;
-					device_qp->thread = spdk_get_thread();
-					break;
+		if (comp_bdev->use_accel) {
+			comp_bdev->accel_ch = spdk_accel_get_io_channel();
+		} else {
+			comp_bdev->poller = SPDK_POLLER_REGISTER(comp_dev_poller, comp_bdev, 0);
+			/* Now assign a q pair */
+			pthread_mutex_lock(&g_comp_device_qp_lock);
+			TAILQ_FOREACH(device_qp, &g_comp_device_qp, link) {
+				if (strcmp(device_qp->device->cdev_info.driver_name, comp_bdev->drv_name) == 0) {
+					if (device_qp->thread == spdk_get_thread()) {
+						comp_bdev->device_qp = device_qp;
+						break;
+					}
+					if (device_qp->thread == NULL) {
+						comp_bdev->device_qp = device_qp;
+						device_qp->thread = spdk_get_thread();
+						break;
+					}
 				}
 			}
+			pthread_mutex_unlock(&g_comp_device_qp_lock);
+		}
+		if (comp_bdev->params.flags & SPDK_REDUCE_VOL_FLAG_PACKED) {
+			comp_bdev->compact_poller = SPDK_POLLER_REGISTER(comp_compact_poller, comp_bdev,
+						    COMPACT_PERIOD_US);
 		}
-		pthread_mutex_unlock(&g_comp_device_qp_lock);
 	}
 	comp_bdev->ch_count++;
 	pthread_mutex_unlock(&comp_bdev->reduce_lock);
 
-	if (comp_bdev->device_qp != NULL) {
+	if (comp_bdev->use_accel) {
+		if (comp_bdev->accel_ch == NULL) {
+			SPDK_ERRLOG("could not get an accel channel for comp_bdev %p\n", comp_bdev);
+			return -ENOMEM;
+		}
+		return 0;
+	} else if (comp_bdev->device_qp != NULL) {
 		uint64_t comp_feature_flags =
 			comp_bdev->device_qp->device->cdev_info.capabilities[RTE_COMP_ALGO_DEFLATE].comp_feature_flags;
 
@@ -1475,7 +1625,18 @@ _channel_cleanup(struct vbdev_compress *comp_bdev)
 	 * on the same thread so we leave the device_qp element
 	 * alone for this comp_bdev and just clear the reduce thread.
 	 */
+	spdk_poller_unregister(&comp_bdev->compact_poller);
+	if (comp_bdev->compacting) {
+		/* The compaction still does I/O on the base channel. */
+		comp_bdev->cleanup_deferred = true;
+		return;
+	}
+
 	spdk_put_io_channel(comp_bdev->base_ch);
+	if (comp_bdev->accel_ch != NULL) {
+		spdk_put_io_channel(comp_bdev->accel_ch);
+		comp_bdev->accel_ch = NULL;
+	}
 	comp_bdev->reduce_thread = NULL;
 	spdk_poller_unregister(&comp_bdev->poller);
 }
@@ -1516,22 +1677,29 @@ comp_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
 
 /* RPC entry point for compression vbdev creation. */
 int
-create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size)
+create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size,
+		     const char *comp_algo, uint32_t comp_level, bool packed)
 {
 	struct vbdev_compress *comp_bdev = NULL;
+	enum spdk_accel_comp_algo algo = SPDK_ACCEL_COMP_ALGO_DEFLATE;
 
 	if ((lb_size != 0) && (lb_size != LB_SIZE_4K) && (lb_size != LB_SIZE_512B)) {
 		SPDK_ERRLOG("Logical block size must be 512 or 4096\n");
 		return -EINVAL;
 	}
 
+	if (comp_algo != NULL && spdk_accel_comp_algo_get_by_name(comp_algo, &algo) != 0) {
+		SPDK_ERRLOG("Invalid compression algorithm %s\n", comp_algo);
+		return -EINVAL;
+	}
+
 	TAILQ_FOREACH(comp_bdev, &g_vbdev_comp, link) {
 		if (strcmp(bdev_name, comp_bdev->base_bdev->name) == 0) {
 			SPDK_ERRLOG("Bass bdev %s already being used for a compress bdev\n", bdev_name);
 			return -EBUSY;
 		}
 	}
-	return vbdev_init_reduce(bdev_name, pm_path, lb_size);
+	return vbdev_init_reduce(bdev_name, pm_path, lb_size, algo, comp_level, packed);
 }
 
 /* On init, just init the compress drivers. All metadata is stored on disk. */
@@ -50,6 +50,7 @@ enum compress_pmd {
 	COMPRESS_PMD_QAT_ONLY,
 	COMPRESS_PMD_ISAL_ONLY,
 	COMPRESS_PMD_MLX5_PCI_ONLY,
+	COMPRESS_PMD_ACCEL_ONLY,
 	COMPRESS_PMD_MAX
 };
 
@@ -61,11 +62,18 @@ typedef void (*spdk_delete_compress_complete)(void *cb_arg, int bdeverrno);
  * Create new compression bdev.
  *
  * \param bdev_name Bdev on which compression bdev will be created.
- * \param pm_path Path to persistent memory.
+ * \param pm_path Path to persistent memory. NULL to keep the volume metadata in memory, made
+ * persistent by a log and checkpoints on the base bdev.
  * \param lb_size Logical block size for the compressed volume in bytes. Must be 4K or 512.
+ * \param comp_algo Compression algorithm of the volume, "deflate", "lz4" or "zstd". NULL
+ * for deflate. Volumes not compressed with deflate are compressed through the accel framework.
+ * \param comp_level Compression level used through the accel framework, see
+ * spdk_accel_submit_compress_ext().
+ * \param packed Pack the compressed chunks of the volume into shared backing io units.
  * \return 0 on success, other on failure.
  */
-int create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size);
+int create_compress_bdev(const char *bdev_name, const char *pm_path, uint32_t lb_size,
+			 const char *comp_algo, uint32_t comp_level, bool packed);
 
 /**
  * Delete compress bdev.
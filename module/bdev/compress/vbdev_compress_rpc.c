@@ -116,6 +116,9 @@ struct rpc_construct_compress {
 	char *base_bdev_name;
 	char *pm_path;
 	uint32_t lb_size;
+	char *comp_algo;
+	uint32_t comp_level;
+	bool packed;
 };
 
 /* Free the allocated memory resource after the RPC handling. */
@@ -124,13 +127,17 @@ free_rpc_construct_compress(struct rpc_construct_compress *r)
 {
 	free(r->base_bdev_name);
 	free(r->pm_path);
+	free(r->comp_algo);
 }
 
 /* Structure to decode the input parameters for this RPC method. */
 static const struct spdk_json_object_decoder rpc_construct_compress_decoders[] = {
 	{"base_bdev_name", offsetof(struct rpc_construct_compress, base_bdev_name), spdk_json_decode_string},
-	{"pm_path", offsetof(struct rpc_construct_compress, pm_path), spdk_json_decode_string},
+	{"pm_path", offsetof(struct rpc_construct_compress, pm_path), spdk_json_decode_string, true},
 	{"lb_size", offsetof(struct rpc_construct_compress, lb_size), spdk_json_decode_uint32, true},
+	{"comp_algo", offsetof(struct rpc_construct_compress, comp_algo), spdk_json_decode_string, true},
+	{"comp_level", offsetof(struct rpc_construct_compress, comp_level), spdk_json_decode_uint32, true},
+	{"packed", offsetof(struct rpc_construct_compress, packed), spdk_json_decode_bool, true},
 };
 
 /* Decode the parameters for this RPC method and properly construct the compress
@@ -145,6 +152,7 @@ rpc_bdev_compress_create(struct spdk_jsonrpc_request *request,
 	char *name;
 	int rc;
 
+	req.comp_level = 1;
 	if (spdk_json_decode_object(params, rpc_construct_compress_decoders,
 				    SPDK_COUNTOF(rpc_construct_compress_decoders),
 				    &req)) {
@@ -154,7 +162,8 @@ rpc_bdev_compress_create(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
-	rc = create_compress_bdev(req.base_bdev_name, req.pm_path, req.lb_size);
+	rc = create_compress_bdev(req.base_bdev_name, req.pm_path, req.lb_size, req.comp_algo,
+				  req.comp_level, req.packed);
 	if (rc != 0) {
 		if (rc == -EBUSY) {
 			spdk_jsonrpc_send_error_response(request, rc, "Base bdev already in use for compression.");
@@ -7,6 +7,7 @@
 
 #include "vbdev_crypto.h"
 
+#include "spdk/accel.h"
 #include "spdk/env.h"
 #include "spdk/likely.h"
 #include "spdk/endian.h"
@@ -150,6 +151,7 @@ struct vbdev_crypto {
 	struct rte_cryptodev_sym_session *session_encrypt;	/* encryption session for this bdev */
 	struct rte_cryptodev_sym_session *session_decrypt;	/* decryption session for this bdev */
 	struct rte_crypto_sym_xform	cipher_xform;		/* crypto control struct for this bdev */
+	struct spdk_accel_crypto_key	*accel_key;		/* key for the ACCEL_FW driver */
 	TAILQ_ENTRY(vbdev_crypto)	link;
 	struct spdk_thread		*thread;		/* thread where base device is opened */
 };
@@ -188,6 +190,7 @@ struct crypto_io_channel {
 	TAILQ_HEAD(, spdk_bdev_io)	pending_cry_ios;	/* outstanding operations to the crypto device */
 	struct spdk_io_channel_iter	*iter;			/* used with for_each_channel in reset */
 	TAILQ_HEAD(, vbdev_crypto_op)	queued_cry_ops;		/* queued for re-submission to CryptoDev */
+	struct spdk_io_channel		*accel_ch;		/* accel channel, used instead of device_qp */
 };
 
 /* This is the crypto per IO context that the bdev layer allocates for us opaquely and attaches to
@@ -1090,6 +1093,82 @@ error_get_dst:
 	return rc;
 }
 
+/* Completion callback for encrypt and decrypt operations done by the accel framework. */
+static void
+_crypto_accel_operation_complete(void *cb_arg, int status)
+{
+	struct spdk_bdev_io *bdev_io = cb_arg;
+	struct crypto_bdev_io *io_ctx = (struct crypto_bdev_io *)bdev_io->driver_ctx;
+	struct crypto_io_channel *crypto_ch = io_ctx->crypto_ch;
+
+	TAILQ_REMOVE(&crypto_ch->pending_cry_ios, bdev_io, module_link);
+	io_ctx->on_pending_list = false;
+
+	if (status != 0) {
+		io_ctx->bdev_io_status = SPDK_BDEV_IO_STATUS_FAILED;
+		if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+			spdk_bdev_io_put_aux_buf(bdev_io, io_ctx->aux_buf_raw);
+		}
+	}
+
+	_crypto_operation_complete(bdev_io);
+
+	if (crypto_ch->iter && TAILQ_EMPTY(&crypto_ch->pending_cry_ios)) {
+		spdk_for_each_channel_continue(crypto_ch->iter, 0);
+		crypto_ch->iter = NULL;
+	}
+}
+
+/* Encrypt or decrypt a bdev_io through the accel framework, the counterpart of
+ * _crypto_operation() for the ACCEL_FW driver. The whole IO is a single operation,
+ * the framework advances the IV (the LBA) for each block.
+ */
+static int
+_crypto_accel_operation(struct spdk_bdev_io *bdev_io, enum rte_crypto_cipher_operation crypto_op,
+			void *aux_buf)
+{
+	struct crypto_bdev_io *io_ctx = (struct crypto_bdev_io *)bdev_io->driver_ctx;
+	struct crypto_io_channel *crypto_ch = io_ctx->crypto_ch;
+	struct vbdev_crypto *crypto_bdev = io_ctx->crypto_bdev;
+	uint32_t blocklen = crypto_bdev->crypto_bdev.blocklen;
+	uint64_t alignment = spdk_bdev_get_buf_align(&crypto_bdev->crypto_bdev);
+	int rc;
+
+	/* Tracked so that a reset can wait for the operation to finish. Added
+	 * up front as an engine may complete the operation before returning.
+	 */
+	TAILQ_INSERT_TAIL(&crypto_ch->pending_cry_ios, bdev_io, module_link);
+	io_ctx->on_pending_list = true;
+
+	if (crypto_op == RTE_CRYPTO_CIPHER_OP_ENCRYPT) {
+		/* Same as _crypto_operation(), don't encrypt the host buffers in place. */
+		io_ctx->aux_buf_iov.iov_len = bdev_io->u.bdev.num_blocks * blocklen;
+		io_ctx->aux_buf_raw = aux_buf;
+		io_ctx->aux_buf_iov.iov_base = (void *)(((uintptr_t)aux_buf + (alignment - 1)) & ~(alignment - 1));
+		io_ctx->aux_offset_blocks = bdev_io->u.bdev.offset_blocks;
+		io_ctx->aux_num_blocks = bdev_io->u.bdev.num_blocks;
+
+		rc = spdk_accel_submit_encrypt(crypto_ch->accel_ch, crypto_bdev->accel_key,
+					       &io_ctx->aux_buf_iov, 1,
+					       bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+					       bdev_io->u.bdev.offset_blocks, blocklen, 0,
+					       _crypto_accel_operation_complete, bdev_io);
+	} else {
+		rc = spdk_accel_submit_decrypt(crypto_ch->accel_ch, crypto_bdev->accel_key,
+					       bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+					       bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+					       bdev_io->u.bdev.offset_blocks, blocklen, 0,
+					       _crypto_accel_operation_complete, bdev_io);
+	}
+
+	if (rc != 0) {
+		TAILQ_REMOVE(&crypto_ch->pending_cry_ios, bdev_io, module_link);
+		io_ctx->on_pending_list = false;
+	}
+
+	return rc;
+}
+
 /* This function is called after all channels have been quiesced following
  * a bdev reset.
  */
@@ -1113,6 +1192,14 @@ _ch_quiesce(struct spdk_io_channel_iter *i)
 	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
 	struct crypto_io_channel *crypto_ch = spdk_io_channel_get_ctx(ch);
 
+	/* Without a poller, the last outstanding accel operation continues
+	 * the iteration when it completes.
+	 */
+	if (crypto_ch->accel_ch != NULL && TAILQ_EMPTY(&crypto_ch->pending_cry_ios)) {
+		spdk_for_each_channel_continue(i, 0);
+		return;
+	}
+
 	crypto_ch->iter = i;
 	/* When the poller runs, it will see the non-NULL iter and handle
 	 * the quiesce.
@@ -1166,13 +1253,19 @@ _complete_internal_read(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg
 {
 	struct spdk_bdev_io *orig_io = cb_arg;
 	struct crypto_bdev_io *orig_ctx = (struct crypto_bdev_io *)orig_io->driver_ctx;
+	int rc;
 
 	if (success) {
 
 		/* Save off this bdev_io so it can be freed after decryption. */
 		orig_ctx->read_io = bdev_io;
 
-		if (!_crypto_operation(orig_io, RTE_CRYPTO_CIPHER_OP_DECRYPT, NULL)) {
+		if (orig_ctx->crypto_bdev->accel_key != NULL) {
+			rc = _crypto_accel_operation(orig_io, RTE_CRYPTO_CIPHER_OP_DECRYPT, NULL);
+		} else {
+			rc = _crypto_operation(orig_io, RTE_CRYPTO_CIPHER_OP_DECRYPT, NULL);
+		}
+		if (!rc) {
 			return;
 		} else {
 			SPDK_ERRLOG("Failed to decrypt!\n");
@@ -1257,7 +1350,11 @@ crypto_write_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io
 	struct crypto_bdev_io *io_ctx = (struct crypto_bdev_io *)bdev_io->driver_ctx;
 	int rc = 0;
 
-	rc = _crypto_operation(bdev_io, RTE_CRYPTO_CIPHER_OP_ENCRYPT, aux_buf);
+	if (io_ctx->crypto_bdev->accel_key != NULL) {
+		rc = _crypto_accel_operation(bdev_io, RTE_CRYPTO_CIPHER_OP_ENCRYPT, aux_buf);
+	} else {
+		rc = _crypto_operation(bdev_io, RTE_CRYPTO_CIPHER_OP_ENCRYPT, aux_buf);
+	}
 	if (rc != 0) {
 		spdk_bdev_io_put_aux_buf(bdev_io, aux_buf);
 		if (rc == -ENOMEM) {
@@ -1371,8 +1468,12 @@ _device_unregister_cb(void *io_device)
 	struct vbdev_crypto *crypto_bdev = io_device;
 
 	/* Done with this crypto_bdev. */
-	rte_cryptodev_sym_session_free(crypto_bdev->session_decrypt);
-	rte_cryptodev_sym_session_free(crypto_bdev->session_encrypt);
+	if (crypto_bdev->accel_key != NULL) {
+		spdk_accel_crypto_key_destroy(crypto_bdev->accel_key);
+	} else {
+		rte_cryptodev_sym_session_free(crypto_bdev->session_decrypt);
+		rte_cryptodev_sym_session_free(crypto_bdev->session_encrypt);
+	}
 	crypto_bdev->opts = NULL;
 	free(crypto_bdev->crypto_bdev.name);
 	free(crypto_bdev);
@@ -1591,12 +1692,23 @@ crypto_bdev_ch_create_cb(void *io_device, void *ctx_buf)
 	struct device_qp *device_qp = NULL;
 
 	crypto_ch->base_ch = spdk_bdev_get_io_channel(crypto_bdev->base_desc);
-	crypto_ch->poller = SPDK_POLLER_REGISTER(crypto_dev_poller, crypto_ch, 0);
 	crypto_ch->device_qp = NULL;
 
-	/* Assign a device/qp combination that is unique per channel per PMD. */
-	_assign_device_qp(crypto_bdev, device_qp, crypto_ch);
-	assert(crypto_ch->device_qp);
+	if (crypto_bdev->accel_key != NULL) {
+		/* The accel framework completes operations through callbacks. */
+		crypto_ch->accel_ch = spdk_accel_get_io_channel();
+		if (crypto_ch->accel_ch == NULL) {
+			SPDK_ERRLOG("Failed to get accel channel for %s\n", crypto_bdev->crypto_bdev.name);
+			spdk_put_io_channel(crypto_ch->base_ch);
+			return -ENOMEM;
+		}
+	} else {
+		crypto_ch->poller = SPDK_POLLER_REGISTER(crypto_dev_poller, crypto_ch, 0);
+
+		/* Assign a device/qp combination that is unique per channel per PMD. */
+		_assign_device_qp(crypto_bdev, device_qp, crypto_ch);
+		assert(crypto_ch->device_qp);
+	}
 
 	/* We use this queue to track outstanding IO in our layer. */
 	TAILQ_INIT(&crypto_ch->pending_cry_ios);
@@ -1616,11 +1728,15 @@ crypto_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
 {
 	struct crypto_io_channel *crypto_ch = ctx_buf;
 
-	pthread_mutex_lock(&g_device_qp_lock);
-	crypto_ch->device_qp->in_use = false;
-	pthread_mutex_unlock(&g_device_qp_lock);
+	if (crypto_ch->accel_ch != NULL) {
+		spdk_put_io_channel(crypto_ch->accel_ch);
+	} else {
+		pthread_mutex_lock(&g_device_qp_lock);
+		crypto_ch->device_qp->in_use = false;
+		pthread_mutex_unlock(&g_device_qp_lock);
 
-	spdk_poller_unregister(&crypto_ch->poller);
+		spdk_poller_unregister(&crypto_ch->poller);
+	}
 	spdk_put_io_channel(crypto_ch->base_ch);
 }
 
@@ -1643,10 +1759,10 @@ vbdev_crypto_insert_name(struct vbdev_crypto_opts *opts, struct bdev_names **out
 		}
 	}
 
-	for (j = 0; j < MAX_NUM_DRV_TYPES ; j++) {
+	found = strcmp(opts->drv_name, ACCEL_FW) == 0;
+	for (j = 0; j < MAX_NUM_DRV_TYPES && !found; j++) {
 		if (strcmp(opts->drv_name, g_driver_names[j]) == 0) {
 			found = true;
-			break;
 		}
 	}
 	if (!found) {
@@ -1911,6 +2027,9 @@ vbdev_crypto_claim(const char *bdev_name)
 		} else if (strcmp(name->opts->drv_name, MLX5) == 0) {
 			vbdev->crypto_bdev.required_alignment = bdev->required_alignment;
 			SPDK_NOTICELOG("MLX5 using cipher: %s\n", name->opts->cipher);
+		} else if (strcmp(name->opts->drv_name, ACCEL_FW) == 0) {
+			vbdev->crypto_bdev.required_alignment = bdev->required_alignment;
+			SPDK_NOTICELOG("Accel framework using cipher: %s\n", name->opts->cipher);
 		} else {
 			vbdev->crypto_bdev.required_alignment = bdev->required_alignment;
 			SPDK_NOTICELOG("AESNI_MB using cipher: %s\n", name->opts->cipher);
@@ -1955,6 +2074,26 @@ vbdev_crypto_claim(const char *bdev_name)
 			goto error_claim;
 		}
 
+		if (strcmp(vbdev->opts->drv_name, ACCEL_FW) == 0) {
+			/* No cryptodev sessions, the key is prepared by the accel engine. The
+			 * key must exist before the first channel is created. */
+			struct spdk_accel_crypto_key_create_param param = {
+				.key_name = vbdev->opts->vbdev_name,
+				.cipher = vbdev->opts->cipher,
+				.key = vbdev->opts->key,
+				.key_size = vbdev->opts->key_size,
+				.key2 = vbdev->opts->key2,
+				.key2_size = vbdev->opts->key2_size,
+			};
+
+			rc = spdk_accel_crypto_key_create(&param, &vbdev->accel_key);
+			if (rc) {
+				SPDK_ERRLOG("Failed to create accel crypto key: error %d\n", rc);
+				goto error_cant_find_devid;
+			}
+			goto register_bdev;
+		}
+
 		/* To init the session we have to get the cryptoDev device ID for this vbdev */
 		TAILQ_FOREACH(device, &g_vbdev_devs, link) {
 			if (strcmp(device->cdev_info.driver_name, vbdev->opts->drv_name) == 0) {
@@ -2022,6 +2161,7 @@ vbdev_crypto_claim(const char *bdev_name)
 			goto error_session_init;
 		}
 
+register_bdev:
 		rc = spdk_bdev_register(&vbdev->crypto_bdev);
 		if (rc < 0) {
 			SPDK_ERRLOG("Failed to register vbdev: error %d\n", rc);
@@ -2037,6 +2177,10 @@ vbdev_crypto_claim(const char *bdev_name)
 
 	/* Error cleanup paths. */
 error_bdev_register:
+	if (vbdev->accel_key != NULL) {
+		spdk_accel_crypto_key_destroy(vbdev->accel_key);
+		goto error_cant_find_devid;
+	}
 error_session_init:
 	rte_cryptodev_sym_session_free(vbdev->session_decrypt);
 error_session_de_create:
@@ -19,10 +19,11 @@
 #define QAT "crypto_qat"
 #define QAT_ASYM "crypto_qat_asym"
 #define MLX5 "mlx5_pci"
+#define ACCEL_FW "accel" /* not a DPDK PMD, crypto is done through the accel framework */
 
 /* Supported ciphers */
 #define AES_CBC "AES_CBC" /* QAT and AESNI_MB */
-#define AES_XTS "AES_XTS" /* QAT and MLX5 */
+#define AES_XTS "AES_XTS" /* QAT, MLX5 and ACCEL_FW */
 
 /* Specific to AES_CBC. */
 #define AES_CBC_KEY_LENGTH	     16
@@ -69,6 +69,13 @@ create_crypto_opts(struct rpc_construct_crypto *rpc,
 		return NULL;
 	}
 
+	if (strcmp(rpc->crypto_pmd, ACCEL_FW) == 0 && strcmp(rpc->cipher, AES_XTS) != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Invalid cipher. %s is not available on the accel framework.",
+						     rpc->cipher);
+		return NULL;
+	}
+
 	if (strcmp(rpc->cipher, AES_XTS) == 0 && rpc->key2 == NULL) {
 		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
 						 "Invalid key. A 2nd key is needed for AES_XTS.");
@@ -126,7 +133,7 @@ create_crypto_opts(struct rpc_construct_crypto *rpc,
 		}
 	} else {
 		if (strncmp(rpc->cipher, AES_XTS, sizeof(AES_XTS)) == 0) {
-			/* AES_XTS for qat uses 128bit key. */
+			/* AES_XTS for qat and the accel framework uses 128bit key. */
 			key_size = strnlen(rpc->key, (AES_XTS_128_BLOCK_KEY_LENGTH * 2) + 1);
 			if (key_size != AES_XTS_128_BLOCK_KEY_LENGTH * 2) {
 				spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
@@ -0,0 +1,1842 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Inline deduplication virtual bdev.
+ *
+ * The base bdev is split into fixed-size physical chunks. Every logical chunk of the vbdev
+ * maps to a physical chunk, or to none if it was never written or only holds zeroes. On a
+ * write, the chunk is fingerprinted with CRC-32C through the accel framework and looked up
+ * in an index of the fingerprints of all physical chunks in use. A chunk with a matching
+ * fingerprint is read back and compared, and on a match the logical chunk simply points to
+ * it, so no data is written. Physical chunks are reference counted and freed when the last
+ * logical chunk pointing to them is overwritten.
+ *
+ * On-disk layout, in bytes from the start of the base bdev:
+ *
+ *   0            superblock (DEDUP_MD_BLOCK_SIZE)
+ *   map_offset   logical map, one uint32_t physical chunk index per logical chunk
+ *   fp_offset    fingerprint table, one uint32_t CRC-32C per physical chunk
+ *   data_offset  physical chunks, aligned to the chunk size
+ *
+ * The metadata is kept in memory and written back one DEDUP_MD_BLOCK_SIZE block at a time.
+ * A new physical chunk and its fingerprint are written before the logical map points to it,
+ * and the previous physical chunk is only released once the new mapping is persisted, so a
+ * crash never leaves the map pointing at a chunk that was reused. Reference counts and the
+ * fingerprint index are not persisted, they are rebuilt from the map when the bdev is
+ * examined.
+ *
+ * Like the compress vbdev, all I/O is processed on the thread that created the first
+ * channel.
+ */
+
+#include "vbdev_dedup.h"
+
+#include "spdk/stdinc.h"
+#include "spdk/accel.h"
+#include "spdk/bit_array.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+#include "spdk/uuid.h"
+#include "spdk/bdev_module.h"
+#include "spdk/likely.h"
+
+#include "spdk/log.h"
+
+#define DEDUP_BDEV_NAME		"dedup"
+#define DEDUP_SIGNATURE		"SPDKDEDU"
+#define DEDUP_VERSION		1
+#define DEDUP_MD_BLOCK_SIZE	0x1000
+/* Size of the I/Os used to read and write the whole metadata on create and examine. */
+#define DEDUP_MD_IO_SIZE	(1024 * 1024)
+/* Chunk buffers for read-modify-write and for comparing chunks with matching fingerprints. */
+#define DEDUP_NUM_BUFS		64
+/* Metadata blocks that can be written back at the same time. */
+#define DEDUP_NUM_MD_IOS	32
+/* Map entry of a logical chunk that reads as zeroes. */
+#define DEDUP_CHUNK_EMPTY	UINT32_MAX
+#define DEDUP_INDEX_END		UINT32_MAX
+
+struct dedup_sb {
+	uint8_t			signature[8];
+	uint32_t		version;
+	uint32_t		chunk_size;
+	uint32_t		block_size;
+	uint32_t		reserved;
+	struct spdk_uuid	uuid;
+	uint64_t		num_logical_chunks;
+	uint64_t		num_physical_chunks;
+	uint64_t		map_offset;
+	uint64_t		fp_offset;
+	uint64_t		data_offset;
+	uint8_t			reserved2[4012];
+	uint32_t		crc;
+};
+SPDK_STATIC_ASSERT(sizeof(struct dedup_sb) == DEDUP_MD_BLOCK_SIZE, "Incorrect size");
+
+struct vbdev_dedup;
+struct dedup_bdev_io;
+
+/* A read or write of the base bdev, resubmitted when the base bdev runs out of bdev_ios. */
+struct dedup_io_op {
+	struct vbdev_dedup		*dedup;
+	struct spdk_io_channel		*ch;
+	bool				write;
+	struct iovec			iov;
+	struct iovec			*iovs;
+	int				iovcnt;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	void				(*cb_fn)(void *cb_arg, int status);
+	void				*cb_arg;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+typedef void (*dedup_md_cb)(struct dedup_bdev_io *io_ctx, int status);
+
+/* Write back of one metadata block. Requests that modified the block while it was being
+ * written wait for the next write of the same block.
+ */
+struct dedup_md_io {
+	uint64_t				block;
+	struct dedup_io_op			op;
+	TAILQ_HEAD(, dedup_bdev_io)		waiters;
+	TAILQ_HEAD(, dedup_bdev_io)		next_waiters;
+	TAILQ_ENTRY(dedup_md_io)		link;
+};
+
+struct vbdev_dedup_delete_ctx {
+	spdk_delete_dedup_complete	cb_fn;
+	void				*cb_arg;
+	int				cb_rc;
+	struct spdk_thread		*orig_thread;
+	struct dedup_io_op		op;
+	void				*zero_buf;
+};
+
+/* List of virtual bdevs and associated info for each. */
+struct vbdev_dedup {
+	struct spdk_bdev		*base_bdev;	/* the thing we're attaching to */
+	struct spdk_bdev_desc		*base_desc;	/* its descriptor we get from open */
+	struct spdk_io_channel		*base_ch;	/* IO channel of base device */
+	struct spdk_bdev		dedup_bdev;	/* the dedup virtual bdev */
+	struct spdk_io_channel		*accel_ch;	/* accel channel on the dedup thread */
+	struct spdk_thread		*dedup_thread;	/* thread processing all I/O */
+	pthread_mutex_t			dedup_lock;
+	uint32_t			ch_count;
+	struct spdk_thread		*thread;	/* thread where base device is opened */
+
+	/* Geometry, from the superblock */
+	uint32_t			chunk_size;
+	uint64_t			blocks_per_chunk;
+	uint64_t			data_offset_blocks;
+	uint64_t			num_logical_chunks;
+	uint32_t			num_physical_chunks;
+	uint64_t			md_size;
+
+	/* In-memory copy of the metadata region */
+	void				*md_buf;
+	struct dedup_sb			*sb;
+	uint32_t			*map;
+	uint32_t			*fps;
+
+	/* Fingerprint index and reference counts of the physical chunks */
+	uint32_t			*refcnt;
+	uint32_t			*buckets;
+	uint32_t			*next;
+	uint32_t			bucket_mask;
+	struct spdk_bit_array		*allocated;
+	uint32_t			alloc_hint;
+	uint32_t			used_chunks;
+	uint32_t			zero_crc;
+
+	TAILQ_HEAD(, dedup_bdev_io)	executing;	/* writes in progress */
+	TAILQ_HEAD(, dedup_bdev_io)	queued;		/* writes waiting for the same chunk */
+	TAILQ_HEAD(, dedup_bdev_io)	buf_waiters;
+	TAILQ_HEAD(, dedup_bdev_io)	md_waiters;
+
+	void				*buf_mem;
+	void				*free_bufs[DEDUP_NUM_BUFS];
+	uint32_t			num_free_bufs;
+
+	struct dedup_md_io		md_ios[DEDUP_NUM_MD_IOS];
+	TAILQ_HEAD(, dedup_md_io)	free_md_ios;
+	TAILQ_HEAD(, dedup_md_io)	md_ios_inflight;
+
+	/* Statistics */
+	uint64_t			chunks_written;
+	uint64_t			chunks_deduplicated;
+	uint64_t			zero_chunks;
+
+	/* Reading or writing the whole metadata region on create and examine */
+	struct dedup_io_op		md_op;
+	uint64_t			md_op_offset;
+	void				(*md_op_cb)(struct vbdev_dedup *dedup, int status);
+	spdk_create_dedup_complete	create_cb_fn;
+	void				*create_cb_arg;
+
+	struct vbdev_dedup_delete_ctx	*delete_ctx;
+	TAILQ_ENTRY(vbdev_dedup)	link;
+};
+static TAILQ_HEAD(, vbdev_dedup) g_vbdev_dedup = TAILQ_HEAD_INITIALIZER(g_vbdev_dedup);
+
+/* The dedup vbdev channel struct. It is allocated and freed on my behalf by the io channel code.
+ */
+struct dedup_io_channel {
+	struct spdk_io_channel_iter	*iter;
+};
+
+/* Per I/O context for the dedup vbdev. */
+struct dedup_bdev_io {
+	struct dedup_io_channel		*dedup_ch;	/* used in completion handling */
+	struct vbdev_dedup		*dedup;		/* vbdev associated with this IO */
+	struct spdk_bdev_io		*orig_io;	/* the original IO */
+	int				status;
+
+	uint64_t			chunk;		/* logical chunk */
+	uint32_t			old_phys;	/* physical chunk mapped before the write */
+	uint32_t			new_phys;	/* physical chunk mapped by the write */
+	uint32_t			cand_phys;	/* chunk with a matching fingerprint */
+	uint32_t			crc;
+	uint32_t			num_bufs;
+	void				*data_buf;
+	void				*verify_buf;
+	struct iovec			iov;
+	struct iovec			*data_iovs;
+	int				data_iovcnt;
+	int				outstanding;
+	struct dedup_io_op		op;
+
+	uint64_t			md_block;
+	dedup_md_cb			md_cb;
+
+	TAILQ_ENTRY(dedup_bdev_io)	link;		/* executing or queued */
+	TAILQ_ENTRY(dedup_bdev_io)	wait_link;	/* waiting for buffers or metadata */
+};
+
+static struct spdk_bdev_module dedup_if;
+static void vbdev_dedup_base_bdev_event_cb(enum spdk_bdev_event_type type,
+		struct spdk_bdev *bdev, void *event_ctx);
+static void _dedup_write_fill(struct dedup_bdev_io *io_ctx);
+
+static void _dedup_io_op_submit(struct dedup_io_op *op);
+
+static void
+_dedup_io_op_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_io_op *op = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+	op->cb_fn(op->cb_arg, success ? 0 : -EIO);
+}
+
+static void
+_dedup_io_op_resubmit(void *arg)
+{
+	_dedup_io_op_submit(arg);
+}
+
+static void
+_dedup_io_op_submit(struct dedup_io_op *op)
+{
+	struct vbdev_dedup *dedup = op->dedup;
+	int rc;
+
+	if (op->write) {
+		rc = spdk_bdev_writev_blocks(dedup->base_desc, op->ch, op->iovs, op->iovcnt,
+					     op->offset_blocks, op->num_blocks, _dedup_io_op_done, op);
+	} else {
+		rc = spdk_bdev_readv_blocks(dedup->base_desc, op->ch, op->iovs, op->iovcnt,
+					    op->offset_blocks, op->num_blocks, _dedup_io_op_done, op);
+	}
+
+	if (rc == -ENOMEM) {
+		op->bdev_io_wait.bdev = dedup->base_bdev;
+		op->bdev_io_wait.cb_fn = _dedup_io_op_resubmit;
+		op->bdev_io_wait.cb_arg = op;
+		rc = spdk_bdev_queue_io_wait(dedup->base_bdev, op->ch, &op->bdev_io_wait);
+	}
+
+	if (rc != 0) {
+		SPDK_ERRLOG("base bdev I/O failed with %d\n", rc);
+		op->cb_fn(op->cb_arg, rc);
+	}
+}
+
+/* Read or write the base bdev from a single buffer. */
+static void
+_dedup_io_op_buf(struct vbdev_dedup *dedup, struct dedup_io_op *op, bool write, void *buf,
+		 uint64_t offset_blocks, uint64_t len, void (*cb_fn)(void *, int), void *cb_arg)
+{
+	op->dedup = dedup;
+	op->ch = dedup->base_ch;
+	op->write = write;
+	op->iov.iov_base = buf;
+	op->iov.iov_len = len;
+	op->iovs = &op->iov;
+	op->iovcnt = 1;
+	op->offset_blocks = offset_blocks;
+	op->num_blocks = len / dedup->base_bdev->blocklen;
+	op->cb_fn = cb_fn;
+	op->cb_arg = cb_arg;
+	_dedup_io_op_submit(op);
+}
+
+static inline uint64_t
+_dedup_phys_offset_blocks(struct vbdev_dedup *dedup, uint32_t phys)
+{
+	return dedup->data_offset_blocks + (uint64_t)phys * dedup->blocks_per_chunk;
+}
+
+static inline uint64_t
+_dedup_md_offset_blocks(struct vbdev_dedup *dedup, uint64_t offset)
+{
+	return offset / dedup->base_bdev->blocklen;
+}
+
+/*
+ * Fingerprint index. Physical chunks in use are chained in buckets selected by the low bits
+ * of their fingerprint, the chains are threaded through the next array.
+ */
+static void
+_dedup_index_insert(struct vbdev_dedup *dedup, uint32_t phys)
+{
+	uint32_t bucket = dedup->fps[phys] & dedup->bucket_mask;
+
+	dedup->next[phys] = dedup->buckets[bucket];
+	dedup->buckets[bucket] = phys;
+}
+
+static void
+_dedup_index_remove(struct vbdev_dedup *dedup, uint32_t phys)
+{
+	uint32_t *slot = &dedup->buckets[dedup->fps[phys] & dedup->bucket_mask];
+
+	while (*slot != DEDUP_INDEX_END) {
+		if (*slot == phys) {
+			*slot = dedup->next[phys];
+			return;
+		}
+		slot = &dedup->next[*slot];
+	}
+}
+
+static uint32_t
+_dedup_index_lookup(struct vbdev_dedup *dedup, uint32_t crc)
+{
+	uint32_t phys = dedup->buckets[crc & dedup->bucket_mask];
+
+	while (phys != DEDUP_INDEX_END) {
+		if (dedup->fps[phys] == crc) {
+			return phys;
+		}
+		phys = dedup->next[phys];
+	}
+
+	return DEDUP_INDEX_END;
+}
+
+static uint32_t
+_dedup_alloc_chunk(struct vbdev_dedup *dedup)
+{
+	uint32_t phys;
+
+	phys = spdk_bit_array_find_first_clear(dedup->allocated, dedup->alloc_hint);
+	if (phys >= dedup->num_physical_chunks) {
+		phys = spdk_bit_array_find_first_clear(dedup->allocated, 0);
+		if (phys >= dedup->num_physical_chunks) {
+			return DEDUP_CHUNK_EMPTY;
+		}
+	}
+
+	spdk_bit_array_set(dedup->allocated, phys);
+	dedup->alloc_hint = phys + 1;
+	dedup->used_chunks++;
+	dedup->refcnt[phys] = 1;
+
+	return phys;
+}
+
+static inline void
+_dedup_get_chunk(struct vbdev_dedup *dedup, uint32_t phys)
+{
+	assert(dedup->refcnt[phys] > 0);
+	dedup->refcnt[phys]++;
+}
+
+static void
+_dedup_put_chunk(struct vbdev_dedup *dedup, uint32_t phys)
+{
+	assert(dedup->refcnt[phys] > 0);
+	if (--dedup->refcnt[phys] > 0) {
+		return;
+	}
+
+	_dedup_index_remove(dedup, phys);
+	spdk_bit_array_clear(dedup->allocated, phys);
+	dedup->used_chunks--;
+}
+
+/*
+ * Metadata write back.
+ */
+static void _dedup_persist_md(struct vbdev_dedup *dedup, struct dedup_bdev_io *io_ctx,
+			      uint64_t md_block, dedup_md_cb cb_fn);
+
+static void
+_dedup_md_io_submit(struct vbdev_dedup *dedup, struct dedup_md_io *md_io)
+{
+	_dedup_io_op_buf(dedup, &md_io->op, true,
+			 (uint8_t *)dedup->md_buf + md_io->block * DEDUP_MD_BLOCK_SIZE,
+			 _dedup_md_offset_blocks(dedup, md_io->block * DEDUP_MD_BLOCK_SIZE),
+			 DEDUP_MD_BLOCK_SIZE,
+			 md_io->op.cb_fn, md_io);
+}
+
+static void
+_dedup_md_io_done(void *cb_arg, int status)
+{
+	struct dedup_md_io *md_io = cb_arg;
+	struct vbdev_dedup *dedup = md_io->op.dedup;
+	struct dedup_bdev_io *io_ctx;
+	TAILQ_HEAD(, dedup_bdev_io) waiters;
+
+	TAILQ_INIT(&waiters);
+	TAILQ_SWAP(&waiters, &md_io->waiters, dedup_bdev_io, wait_link);
+
+	if (!TAILQ_EMPTY(&md_io->next_waiters)) {
+		/* The block changed while it was written, write it again. */
+		TAILQ_SWAP(&md_io->waiters, &md_io->next_waiters, dedup_bdev_io, wait_link);
+		_dedup_md_io_submit(dedup, md_io);
+	} else {
+		TAILQ_REMOVE(&dedup->md_ios_inflight, md_io, link);
+		TAILQ_INSERT_TAIL(&dedup->free_md_ios, md_io, link);
+	}
+
+	while ((io_ctx = TAILQ_FIRST(&waiters))) {
+		TAILQ_REMOVE(&waiters, io_ctx, wait_link);
+		io_ctx->md_cb(io_ctx, status);
+	}
+
+	if (!TAILQ_EMPTY(&dedup->free_md_ios) && !TAILQ_EMPTY(&dedup->md_waiters)) {
+		TAILQ_INIT(&waiters);
+		TAILQ_SWAP(&waiters, &dedup->md_waiters, dedup_bdev_io, wait_link);
+		while ((io_ctx = TAILQ_FIRST(&waiters))) {
+			TAILQ_REMOVE(&waiters, io_ctx, wait_link);
+			_dedup_persist_md(dedup, io_ctx, io_ctx->md_block, io_ctx->md_cb);
+		}
+	}
+}
+
+/* Write back a metadata block modified by the request. cb_fn is called once a write that
+ * started after the modification completes.
+ */
+static void
+_dedup_persist_md(struct vbdev_dedup *dedup, struct dedup_bdev_io *io_ctx, uint64_t md_block,
+		  dedup_md_cb cb_fn)
+{
+	struct dedup_md_io *md_io;
+
+	io_ctx->md_block = md_block;
+	io_ctx->md_cb = cb_fn;
+
+	TAILQ_FOREACH(md_io, &dedup->md_ios_inflight, link) {
+		if (md_io->block == md_block) {
+			TAILQ_INSERT_TAIL(&md_io->next_waiters, io_ctx, wait_link);
+			return;
+		}
+	}
+
+	md_io = TAILQ_FIRST(&dedup->free_md_ios);
+	if (md_io == NULL) {
+		TAILQ_INSERT_TAIL(&dedup->md_waiters, io_ctx, wait_link);
+		return;
+	}
+
+	TAILQ_REMOVE(&dedup->free_md_ios, md_io, link);
+	TAILQ_INSERT_TAIL(&dedup->md_ios_inflight, md_io, link);
+	md_io->block = md_block;
+	md_io->op.cb_fn = _dedup_md_io_done;
+	TAILQ_INIT(&md_io->waiters);
+	TAILQ_INIT(&md_io->next_waiters);
+	TAILQ_INSERT_TAIL(&md_io->waiters, io_ctx, wait_link);
+	_dedup_md_io_submit(dedup, md_io);
+}
+
+static inline uint64_t
+_dedup_map_md_block(struct vbdev_dedup *dedup, uint64_t chunk)
+{
+	return (dedup->sb->map_offset + chunk * sizeof(uint32_t)) / DEDUP_MD_BLOCK_SIZE;
+}
+
+static inline uint64_t
+_dedup_fp_md_block(struct vbdev_dedup *dedup, uint32_t phys)
+{
+	return (dedup->sb->fp_offset + (uint64_t)phys * sizeof(uint32_t)) / DEDUP_MD_BLOCK_SIZE;
+}
+
+/*
+ * Helpers comparing chunk contents.
+ */
+static bool
+_dedup_iovs_are_zero(struct iovec *iovs, int iovcnt)
+{
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (!spdk_mem_all_zero(iovs[i].iov_base, iovs[i].iov_len)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+_dedup_iovs_equal_buf(struct iovec *iovs, int iovcnt, const uint8_t *buf)
+{
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (memcmp(iovs[i].iov_base, buf, iovs[i].iov_len) != 0) {
+			return false;
+		}
+		buf += iovs[i].iov_len;
+	}
+
+	return true;
+}
+
+/* scheduled for completion on IO thread */
+static void
+_complete_dedup_io(void *arg)
+{
+	struct dedup_bdev_io *io_ctx = arg;
+
+	if (io_ctx->status == 0) {
+		spdk_bdev_io_complete(io_ctx->orig_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	} else if (io_ctx->status == -ENOMEM) {
+		spdk_bdev_io_complete(io_ctx->orig_io, SPDK_BDEV_IO_STATUS_NOMEM);
+	} else {
+		spdk_bdev_io_complete(io_ctx->orig_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+_dedup_complete_io(struct dedup_bdev_io *io_ctx, int status)
+{
+	struct spdk_thread *orig_thread;
+
+	io_ctx->status = status;
+	orig_thread = spdk_io_channel_get_thread(spdk_io_channel_from_ctx(io_ctx->dedup_ch));
+	if (orig_thread != spdk_get_thread()) {
+		spdk_thread_send_msg(orig_thread, _complete_dedup_io, io_ctx);
+	} else {
+		_complete_dedup_io(io_ctx);
+	}
+}
+
+/*
+ * Read path.
+ */
+static void
+_dedup_read_done(void *cb_arg, int status)
+{
+	struct dedup_bdev_io *io_ctx = cb_arg;
+
+	_dedup_put_chunk(io_ctx->dedup, io_ctx->cand_phys);
+	_dedup_complete_io(io_ctx, status);
+}
+
+static void
+_dedup_start_read(struct dedup_bdev_io *io_ctx)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	struct spdk_bdev_io *bdev_io = io_ctx->orig_io;
+	struct dedup_io_op *op = &io_ctx->op;
+	uint32_t phys;
+	int i;
+
+	phys = dedup->map[io_ctx->chunk];
+	if (phys == DEDUP_CHUNK_EMPTY) {
+		for (i = 0; i < bdev_io->u.bdev.iovcnt; i++) {
+			memset(bdev_io->u.bdev.iovs[i].iov_base, 0, bdev_io->u.bdev.iovs[i].iov_len);
+		}
+		_dedup_complete_io(io_ctx, 0);
+		return;
+	}
+
+	/* Hold the chunk, a write may remap the logical chunk while the read is in flight. */
+	_dedup_get_chunk(dedup, phys);
+	io_ctx->cand_phys = phys;
+
+	op->dedup = dedup;
+	op->ch = dedup->base_ch;
+	op->write = false;
+	op->iovs = bdev_io->u.bdev.iovs;
+	op->iovcnt = bdev_io->u.bdev.iovcnt;
+	op->offset_blocks = _dedup_phys_offset_blocks(dedup, phys) +
+			    bdev_io->u.bdev.offset_blocks % dedup->blocks_per_chunk;
+	op->num_blocks = bdev_io->u.bdev.num_blocks;
+	op->cb_fn = _dedup_read_done;
+	op->cb_arg = io_ctx;
+	_dedup_io_op_submit(op);
+}
+
+static void
+dedup_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to get data buffer\n");
+		_dedup_complete_io(io_ctx, -EIO);
+		return;
+	}
+
+	_dedup_start_read(io_ctx);
+}
+
+/*
+ * Write path: merge partial writes with the current chunk, fingerprint the chunk, look for
+ * a physical chunk with the same contents, otherwise write a new one, then update the map.
+ */
+static void
+_dedup_release_bufs(struct dedup_bdev_io *io_ctx)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	struct dedup_bdev_io *waiter;
+
+	if (io_ctx->verify_buf != NULL) {
+		dedup->free_bufs[dedup->num_free_bufs++] = io_ctx->verify_buf;
+		io_ctx->verify_buf = NULL;
+	}
+	if (io_ctx->data_buf != NULL) {
+		dedup->free_bufs[dedup->num_free_bufs++] = io_ctx->data_buf;
+		io_ctx->data_buf = NULL;
+	}
+
+	while ((waiter = TAILQ_FIRST(&dedup->buf_waiters)) &&
+	       waiter->num_bufs <= dedup->num_free_bufs) {
+		TAILQ_REMOVE(&dedup->buf_waiters, waiter, wait_link);
+		_dedup_write_fill(waiter);
+	}
+}
+
+static void
+_dedup_write_done(struct dedup_bdev_io *io_ctx, int status)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	struct dedup_bdev_io *next;
+
+	TAILQ_REMOVE(&dedup->executing, io_ctx, link);
+
+	/* Start the next write to the same chunk before releasing the buffers, so it is not
+	 * overtaken by a later write waiting for buffers.
+	 */
+	TAILQ_FOREACH(next, &dedup->queued, link) {
+		if (next->chunk == io_ctx->chunk) {
+			TAILQ_REMOVE(&dedup->queued, next, link);
+			TAILQ_INSERT_TAIL(&dedup->executing, next, link);
+			if (next->num_bufs <= dedup->num_free_bufs && TAILQ_EMPTY(&dedup->buf_waiters)) {
+				_dedup_write_fill(next);
+			} else {
+				TAILQ_INSERT_TAIL(&dedup->buf_waiters, next, wait_link);
+			}
+			break;
+		}
+	}
+
+	_dedup_release_bufs(io_ctx);
+	_dedup_complete_io(io_ctx, status);
+}
+
+static void
+_dedup_write_map_done(struct dedup_bdev_io *io_ctx, int status)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	uint32_t release;
+
+	if (status != 0) {
+		SPDK_ERRLOG("failed to persist the map of chunk %" PRIu64 ": %d\n", io_ctx->chunk, status);
+		dedup->map[io_ctx->chunk] = io_ctx->old_phys;
+		release = io_ctx->new_phys;
+	} else {
+		release = io_ctx->old_phys;
+	}
+
+	if (release != DEDUP_CHUNK_EMPTY) {
+		_dedup_put_chunk(dedup, release);
+	}
+	_dedup_write_done(io_ctx, status);
+}
+
+static void
+_dedup_write_map(struct dedup_bdev_io *io_ctx)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+
+	if (io_ctx->new_phys == io_ctx->old_phys) {
+		/* Same contents as before, drop the reference taken for the new mapping. */
+		if (io_ctx->new_phys != DEDUP_CHUNK_EMPTY) {
+			_dedup_put_chunk(dedup, io_ctx->new_phys);
+		}
+		_dedup_write_done(io_ctx, 0);
+		return;
+	}
+
+	dedup->map[io_ctx->chunk] = io_ctx->new_phys;
+	_dedup_persist_md(dedup, io_ctx, _dedup_map_md_block(dedup, io_ctx->chunk),
+			  _dedup_write_map_done);
+}
+
+static void
+_dedup_write_new_chunk_step(struct dedup_bdev_io *io_ctx, int status)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+
+	if (status != 0) {
+		io_ctx->status = status;
+	}
+	if (--io_ctx->outstanding > 0) {
+		return;
+	}
+
+	if (io_ctx->status != 0) {
+		_dedup_put_chunk(dedup, io_ctx->new_phys);
+		_dedup_write_done(io_ctx, io_ctx->status);
+		return;
+	}
+
+	/* Only index the chunk once its data is on disk, so a matching write never
+	 * compares against a chunk that is still being written.
+	 */
+	_dedup_index_insert(dedup, io_ctx->new_phys);
+	dedup->chunks_written++;
+	_dedup_write_map(io_ctx);
+}
+
+static void
+_dedup_write_data_done(void *cb_arg, int status)
+{
+	_dedup_write_new_chunk_step(cb_arg, status);
+}
+
+static void
+_dedup_write_new_chunk(struct dedup_bdev_io *io_ctx)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	struct dedup_io_op *op = &io_ctx->op;
+	uint32_t phys;
+
+	phys = _dedup_alloc_chunk(dedup);
+	if (phys == DEDUP_CHUNK_EMPTY) {
+		_dedup_write_done(io_ctx, -ENOSPC);
+		return;
+	}
+
+	io_ctx->new_phys = phys;
+	io_ctx->status = 0;
+	io_ctx->outstanding = 2;
+	dedup->fps[phys] = io_ctx->crc;
+
+	op->dedup = dedup;
+	op->ch = dedup->base_ch;
+	op->write = true;
+	op->iovs = io_ctx->data_iovs;
+	op->iovcnt = io_ctx->data_iovcnt;
+	op->offset_blocks = _dedup_phys_offset_blocks(dedup, phys);
+	op->num_blocks = dedup->blocks_per_chunk;
+	op->cb_fn = _dedup_write_data_done;
+	op->cb_arg = io_ctx;
+	_dedup_io_op_submit(op);
+
+	_dedup_persist_md(dedup, io_ctx, _dedup_fp_md_block(dedup, phys),
+			  _dedup_write_new_chunk_step);
+}
+
+static void
+_dedup_write_verify_done(void *cb_arg, int status)
+{
+	struct dedup_bdev_io *io_ctx = cb_arg;
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+
+	if (status == 0 &&
+	    _dedup_iovs_equal_buf(io_ctx->data_iovs, io_ctx->data_iovcnt, io_ctx->verify_buf)) {
+		/* Keep the reference taken for the comparison for the new mapping. */
+		io_ctx->new_phys = io_ctx->cand_phys;
+		dedup->chunks_deduplicated++;
+		_dedup_write_map(io_ctx);
+		return;
+	}
+
+	_dedup_put_chunk(dedup, io_ctx->cand_phys);
+	_dedup_write_new_chunk(io_ctx);
+}
+
+static void
+_dedup_write_fingerprint_done(void *cb_arg, int status)
+{
+	struct dedup_bdev_io *io_ctx = cb_arg;
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	uint32_t phys;
+
+	if (status != 0) {
+		io_ctx->crc = spdk_crc32c_iov_update(io_ctx->data_iovs, io_ctx->data_iovcnt, ~0u);
+	}
+
+	if (io_ctx->crc == dedup->zero_crc &&
+	    _dedup_iovs_are_zero(io_ctx->data_iovs, io_ctx->data_iovcnt)) {
+		io_ctx->new_phys = DEDUP_CHUNK_EMPTY;
+		dedup->zero_chunks++;
+		_dedup_write_map(io_ctx);
+		return;
+	}
+
+	/* A fingerprint match is only a hint, compare the contents before sharing the chunk.
+	 * Only the most recently written chunk with the fingerprint is tried, collisions of
+	 * CRC-32C between different chunks in use are rare enough to just write a new chunk.
+	 */
+	phys = _dedup_index_lookup(dedup, io_ctx->crc);
+	if (phys == DEDUP_INDEX_END) {
+		_dedup_write_new_chunk(io_ctx);
+		return;
+	}
+
+	_dedup_get_chunk(dedup, phys);
+	io_ctx->cand_phys = phys;
+	_dedup_io_op_buf(dedup, &io_ctx->op, false, io_ctx->verify_buf,
+			 _dedup_phys_offset_blocks(dedup, phys), dedup->chunk_size,
+			 _dedup_write_verify_done, io_ctx);
+}
+
+static void
+_dedup_write_fingerprint(struct dedup_bdev_io *io_ctx)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	int rc;
+
+	rc = spdk_accel_submit_crc32cv(dedup->accel_ch, &io_ctx->crc, io_ctx->data_iovs,
+				       io_ctx->data_iovcnt, 0, _dedup_write_fingerprint_done, io_ctx);
+	if (rc != 0) {
+		/* Out of accel tasks, compute it here rather than queueing. */
+		_dedup_write_fingerprint_done(io_ctx, rc);
+	}
+}
+
+static void
+_dedup_write_merge(void *cb_arg, int status)
+{
+	struct dedup_bdev_io *io_ctx = cb_arg;
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	struct spdk_bdev_io *bdev_io = io_ctx->orig_io;
+	uint64_t offset;
+
+	if (status != 0) {
+		_dedup_write_done(io_ctx, status);
+		return;
+	}
+
+	offset = (bdev_io->u.bdev.offset_blocks % dedup->blocks_per_chunk) * dedup->dedup_bdev.blocklen;
+	spdk_copy_iovs_to_buf((uint8_t *)io_ctx->data_buf + offset,
+			      bdev_io->u.bdev.num_blocks * dedup->dedup_bdev.blocklen,
+			      bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+	_dedup_write_fingerprint(io_ctx);
+}
+
+/* Called with the buffers of the request available. */
+static void
+_dedup_write_fill(struct dedup_bdev_io *io_ctx)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	struct spdk_bdev_io *bdev_io = io_ctx->orig_io;
+
+	assert(dedup->num_free_bufs >= io_ctx->num_bufs);
+	io_ctx->verify_buf = dedup->free_bufs[--dedup->num_free_bufs];
+	io_ctx->old_phys = dedup->map[io_ctx->chunk];
+
+	if (io_ctx->num_bufs == 1) {
+		io_ctx->data_iovs = bdev_io->u.bdev.iovs;
+		io_ctx->data_iovcnt = bdev_io->u.bdev.iovcnt;
+		_dedup_write_fingerprint(io_ctx);
+		return;
+	}
+
+	io_ctx->data_buf = dedup->free_bufs[--dedup->num_free_bufs];
+	io_ctx->iov.iov_base = io_ctx->data_buf;
+	io_ctx->iov.iov_len = dedup->chunk_size;
+	io_ctx->data_iovs = &io_ctx->iov;
+	io_ctx->data_iovcnt = 1;
+
+	if (io_ctx->old_phys == DEDUP_CHUNK_EMPTY) {
+		memset(io_ctx->data_buf, 0, dedup->chunk_size);
+		_dedup_write_merge(io_ctx, 0);
+		return;
+	}
+
+	/* Writes to the chunk are serialized, so the old chunk stays mapped during the read. */
+	_dedup_io_op_buf(dedup, &io_ctx->op, false, io_ctx->data_buf,
+			 _dedup_phys_offset_blocks(dedup, io_ctx->old_phys), dedup->chunk_size,
+			 _dedup_write_merge, io_ctx);
+}
+
+static void
+_dedup_start_write(struct dedup_bdev_io *io_ctx)
+{
+	struct vbdev_dedup *dedup = io_ctx->dedup;
+	struct spdk_bdev_io *bdev_io = io_ctx->orig_io;
+	struct dedup_bdev_io *tmp;
+
+	/* A full chunk write needs a buffer for the comparison, a partial one also needs a
+	 * buffer to merge the new data with the current chunk.
+	 */
+	io_ctx->num_bufs = bdev_io->u.bdev.num_blocks == dedup->blocks_per_chunk ? 1 : 2;
+
+	TAILQ_FOREACH(tmp, &dedup->executing, link) {
+		if (tmp->chunk == io_ctx->chunk) {
+			TAILQ_INSERT_TAIL(&dedup->queued, io_ctx, link);
+			return;
+		}
+	}
+	TAILQ_INSERT_TAIL(&dedup->executing, io_ctx, link);
+
+	if (io_ctx->num_bufs > dedup->num_free_bufs || !TAILQ_EMPTY(&dedup->buf_waiters)) {
+		TAILQ_INSERT_TAIL(&dedup->buf_waiters, io_ctx, wait_link);
+		return;
+	}
+
+	_dedup_write_fill(io_ctx);
+}
+
+/* scheduled for submission on the dedup thread */
+static void
+_dedup_bdev_io_submit(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, dedup_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		_dedup_start_write(io_ctx);
+		return;
+	default:
+		SPDK_ERRLOG("Unknown I/O type %d\n", bdev_io->type);
+		_dedup_complete_io(io_ctx, -ENOTSUP);
+	}
+}
+
+/* Called when someone above submits IO to this vbdev. */
+static void
+vbdev_dedup_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct vbdev_dedup *dedup = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_dedup, dedup_bdev);
+
+	memset(io_ctx, 0, sizeof(struct dedup_bdev_io));
+	io_ctx->dedup = dedup;
+	io_ctx->dedup_ch = spdk_io_channel_get_ctx(ch);
+	io_ctx->orig_io = bdev_io;
+	/* I/O is split on chunk boundaries, so it never spans two chunks. */
+	io_ctx->chunk = bdev_io->u.bdev.offset_blocks / dedup->blocks_per_chunk;
+
+	/* Send this request to the dedup_thread if that's not what we're on. */
+	if (spdk_get_thread() != dedup->dedup_thread) {
+		spdk_thread_send_msg(dedup->dedup_thread, _dedup_bdev_io_submit, bdev_io);
+	} else {
+		_dedup_bdev_io_submit(bdev_io);
+	}
+}
+
+static bool
+vbdev_dedup_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_dedup *dedup = (struct vbdev_dedup *)ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		return spdk_bdev_io_type_supported(dedup->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+/*
+ * Metadata setup.
+ */
+static int
+_dedup_init_geometry(struct dedup_sb *sb, uint64_t base_size, uint32_t chunk_size,
+		     uint64_t vol_size)
+{
+	uint64_t num_physical, num_logical = 0, map_size, fp_size, data_offset;
+
+	if (base_size <= DEDUP_MD_BLOCK_SIZE) {
+		return -ENOSPC;
+	}
+
+	/* Upper bound ignoring rounding, adjusted down below. */
+	if (vol_size != 0) {
+		num_logical = vol_size / chunk_size;
+		map_size = SPDK_ALIGN_CEIL(num_logical * sizeof(uint32_t), DEDUP_MD_BLOCK_SIZE);
+		if (base_size < DEDUP_MD_BLOCK_SIZE + map_size) {
+			return -ENOSPC;
+		}
+		num_physical = (base_size - DEDUP_MD_BLOCK_SIZE - map_size) /
+			       (chunk_size + sizeof(uint32_t));
+	} else {
+		num_physical = (base_size - DEDUP_MD_BLOCK_SIZE) / (chunk_size + 2 * sizeof(uint32_t));
+	}
+	num_physical = spdk_min(num_physical, (uint64_t)UINT32_MAX - 1);
+
+	for (; num_physical > 0; num_physical--) {
+		num_logical = vol_size != 0 ? vol_size / chunk_size : num_physical;
+		map_size = SPDK_ALIGN_CEIL(num_logical * sizeof(uint32_t), DEDUP_MD_BLOCK_SIZE);
+		fp_size = SPDK_ALIGN_CEIL(num_physical * sizeof(uint32_t), DEDUP_MD_BLOCK_SIZE);
+		data_offset = SPDK_ALIGN_CEIL(DEDUP_MD_BLOCK_SIZE + map_size + fp_size, chunk_size);
+		if (data_offset + num_physical * chunk_size <= base_size) {
+			break;
+		}
+	}
+
+	if (num_physical == 0 || num_logical == 0) {
+		return -ENOSPC;
+	}
+
+	sb->chunk_size = chunk_size;
+	sb->num_logical_chunks = num_logical;
+	sb->num_physical_chunks = num_physical;
+	sb->map_offset = DEDUP_MD_BLOCK_SIZE;
+	sb->fp_offset = DEDUP_MD_BLOCK_SIZE + map_size;
+	sb->data_offset = data_offset;
+
+	return 0;
+}
+
+static uint32_t
+_dedup_sb_crc(struct dedup_sb *sb)
+{
+	uint32_t crc, saved = sb->crc;
+
+	sb->crc = 0;
+	crc = spdk_crc32c_update(sb, sizeof(*sb), ~0u);
+	sb->crc = saved;
+
+	return crc;
+}
+
+static bool
+_dedup_sb_valid(struct dedup_sb *sb, struct spdk_bdev *base_bdev)
+{
+	uint64_t base_size = base_bdev->blockcnt * base_bdev->blocklen;
+
+	if (memcmp(sb->signature, DEDUP_SIGNATURE, sizeof(sb->signature)) != 0) {
+		return false;
+	}
+
+	if (sb->crc != _dedup_sb_crc(sb)) {
+		SPDK_ERRLOG("dedup superblock on %s is corrupted\n", spdk_bdev_get_name(base_bdev));
+		return false;
+	}
+
+	if (sb->version != DEDUP_VERSION || sb->block_size != base_bdev->blocklen ||
+	    !spdk_u32_is_pow2(sb->chunk_size) || sb->chunk_size < DEDUP_MIN_CHUNK_SIZE ||
+	    sb->chunk_size > DEDUP_MAX_CHUNK_SIZE || sb->num_physical_chunks >= UINT32_MAX ||
+	    sb->fp_offset < sb->map_offset + sb->num_logical_chunks * sizeof(uint32_t) ||
+	    sb->data_offset < sb->fp_offset + sb->num_physical_chunks * sizeof(uint32_t) ||
+	    sb->data_offset + sb->num_physical_chunks * sb->chunk_size > base_size) {
+		SPDK_ERRLOG("unsupported dedup superblock on %s\n", spdk_bdev_get_name(base_bdev));
+		return false;
+	}
+
+	return true;
+}
+
+/* Allocate the in-memory metadata and index. The index is kept in hugepage memory like the
+ * metadata, lookups walk it on every write.
+ */
+static int
+_dedup_alloc_mem(struct vbdev_dedup *dedup, struct dedup_sb *sb)
+{
+	uint32_t num_buckets, i;
+
+	dedup->chunk_size = sb->chunk_size;
+	dedup->blocks_per_chunk = sb->chunk_size / dedup->base_bdev->blocklen;
+	dedup->data_offset_blocks = sb->data_offset / dedup->base_bdev->blocklen;
+	dedup->num_logical_chunks = sb->num_logical_chunks;
+	dedup->num_physical_chunks = sb->num_physical_chunks;
+	dedup->md_size = SPDK_ALIGN_CEIL(sb->fp_offset + sb->num_physical_chunks * sizeof(uint32_t),
+					 DEDUP_MD_BLOCK_SIZE);
+
+	dedup->md_buf = spdk_zmalloc(dedup->md_size, DEDUP_MD_BLOCK_SIZE, NULL,
+				     SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (dedup->md_buf == NULL) {
+		return -ENOMEM;
+	}
+	dedup->sb = dedup->md_buf;
+	memcpy(dedup->sb, sb, sizeof(*sb));
+	dedup->map = (uint32_t *)((uint8_t *)dedup->md_buf + sb->map_offset);
+	dedup->fps = (uint32_t *)((uint8_t *)dedup->md_buf + sb->fp_offset);
+
+	num_buckets = 1;
+	while (num_buckets < dedup->num_physical_chunks && num_buckets < (1u << 31)) {
+		num_buckets <<= 1;
+	}
+	dedup->bucket_mask = num_buckets - 1;
+	dedup->buckets = spdk_malloc(num_buckets * sizeof(uint32_t), 0, NULL,
+				     SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	dedup->next = spdk_malloc(dedup->num_physical_chunks * sizeof(uint32_t), 0, NULL,
+				  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	dedup->refcnt = spdk_zmalloc(dedup->num_physical_chunks * sizeof(uint32_t), 0, NULL,
+				     SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	dedup->allocated = spdk_bit_array_create(dedup->num_physical_chunks);
+	dedup->buf_mem = spdk_zmalloc((size_t)DEDUP_NUM_BUFS * dedup->chunk_size, DEDUP_MD_BLOCK_SIZE,
+				      NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (dedup->buckets == NULL || dedup->next == NULL || dedup->refcnt == NULL ||
+	    dedup->allocated == NULL || dedup->buf_mem == NULL) {
+		return -ENOMEM;
+	}
+	memset(dedup->buckets, 0xFF, num_buckets * sizeof(uint32_t));
+
+	for (i = 0; i < DEDUP_NUM_BUFS; i++) {
+		dedup->free_bufs[i] = (uint8_t *)dedup->buf_mem + (size_t)i * dedup->chunk_size;
+	}
+	dedup->num_free_bufs = DEDUP_NUM_BUFS;
+	dedup->zero_crc = spdk_crc32c_update(dedup->buf_mem, dedup->chunk_size, ~0u);
+
+	for (i = 0; i < DEDUP_NUM_MD_IOS; i++) {
+		TAILQ_INSERT_TAIL(&dedup->free_md_ios, &dedup->md_ios[i], link);
+	}
+
+	return 0;
+}
+
+static void
+_dedup_free_mem(struct vbdev_dedup *dedup)
+{
+	spdk_free(dedup->md_buf);
+	spdk_free(dedup->buckets);
+	spdk_free(dedup->next);
+	spdk_free(dedup->refcnt);
+	spdk_free(dedup->buf_mem);
+	spdk_bit_array_free(&dedup->allocated);
+}
+
+/* Rebuild the reference counts and the fingerprint index from the logical map. */
+static int
+_dedup_rebuild_index(struct vbdev_dedup *dedup)
+{
+	uint64_t chunk;
+	uint32_t phys;
+
+	for (chunk = 0; chunk < dedup->num_logical_chunks; chunk++) {
+		phys = dedup->map[chunk];
+		if (phys == DEDUP_CHUNK_EMPTY) {
+			continue;
+		}
+		if (phys >= dedup->num_physical_chunks) {
+			SPDK_ERRLOG("chunk %" PRIu64 " maps to invalid physical chunk %u\n", chunk, phys);
+			return -EILSEQ;
+		}
+		if (dedup->refcnt[phys]++ == 0) {
+			spdk_bit_array_set(dedup->allocated, phys);
+			_dedup_index_insert(dedup, phys);
+			dedup->used_chunks++;
+		}
+	}
+
+	return 0;
+}
+
+static struct vbdev_dedup *
+_prepare_for_load_init(struct spdk_bdev_desc *bdev_desc)
+{
+	struct vbdev_dedup *dedup;
+
+	dedup = calloc(1, sizeof(struct vbdev_dedup));
+	if (dedup == NULL) {
+		SPDK_ERRLOG("failed to alloc init contexts\n");
+		return NULL;
+	}
+
+	dedup->base_desc = bdev_desc;
+	dedup->base_bdev = spdk_bdev_desc_get_bdev(bdev_desc);
+	TAILQ_INIT(&dedup->executing);
+	TAILQ_INIT(&dedup->queued);
+	TAILQ_INIT(&dedup->buf_waiters);
+	TAILQ_INIT(&dedup->md_waiters);
+	TAILQ_INIT(&dedup->free_md_ios);
+	TAILQ_INIT(&dedup->md_ios_inflight);
+	/* Save the thread where the base device is opened */
+	dedup->thread = spdk_get_thread();
+
+	return dedup;
+}
+
+/* Read or write the metadata region [offset, md_size) in DEDUP_MD_IO_SIZE pieces. */
+static void
+_dedup_md_bulk_io_done(void *cb_arg, int status)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	uint64_t len;
+
+	dedup->md_op_offset += dedup->md_op.iov.iov_len;
+	if (status != 0 || dedup->md_op_offset == dedup->md_size) {
+		dedup->md_op_cb(dedup, status);
+		return;
+	}
+
+	len = spdk_min(dedup->md_size - dedup->md_op_offset, DEDUP_MD_IO_SIZE);
+	_dedup_io_op_buf(dedup, &dedup->md_op, dedup->md_op.write,
+			 (uint8_t *)dedup->md_buf + dedup->md_op_offset,
+			 _dedup_md_offset_blocks(dedup, dedup->md_op_offset), len,
+			 _dedup_md_bulk_io_done, dedup);
+}
+
+static void
+_dedup_md_bulk_io(struct vbdev_dedup *dedup, bool write, uint64_t offset,
+		  void (*cb_fn)(struct vbdev_dedup *dedup, int status))
+{
+	dedup->md_op_cb = cb_fn;
+	dedup->md_op_offset = offset;
+	dedup->md_op.write = write;
+	dedup->md_op.iov.iov_len = 0;
+	_dedup_md_bulk_io_done(dedup, 0);
+}
+
+static void
+_dedup_free(struct vbdev_dedup *dedup)
+{
+	_dedup_free_mem(dedup);
+	free(dedup->dedup_bdev.name);
+	free(dedup);
+}
+
+/* Callback for unregistering the IO device. */
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_dedup *dedup = io_device;
+
+	/* Done with this dedup bdev. */
+	pthread_mutex_destroy(&dedup->dedup_lock);
+	_dedup_free(dedup);
+}
+
+static void
+_vbdev_dedup_destruct_cb(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	spdk_bdev_module_release_bdev(dedup->base_bdev);
+	/* Close the underlying bdev on its same opened thread. */
+	spdk_bdev_close(dedup->base_desc);
+	spdk_io_device_unregister(dedup, _device_unregister_cb);
+}
+
+/* Called after we've unregistered following a hot remove callback or a delete.
+ * Our finish entry point will be called next.
+ */
+static int
+vbdev_dedup_destruct(void *ctx)
+{
+	struct vbdev_dedup *dedup = (struct vbdev_dedup *)ctx;
+
+	TAILQ_REMOVE(&g_vbdev_dedup, dedup, link);
+	if (dedup->thread && dedup->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(dedup->thread, _vbdev_dedup_destruct_cb, dedup);
+	} else {
+		_vbdev_dedup_destruct_cb(dedup);
+	}
+
+	return 0;
+}
+
+/* We supplied this as an entry point for upper layers who want to communicate to this
+ * bdev.  This is how they get a channel.
+ */
+static struct spdk_io_channel *
+vbdev_dedup_get_io_channel(void *ctx)
+{
+	struct vbdev_dedup *dedup = (struct vbdev_dedup *)ctx;
+
+	return spdk_get_io_channel(dedup);
+}
+
+/* This is the output for bdev_get_bdevs() for this vbdev */
+static int
+vbdev_dedup_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedup *dedup = (struct vbdev_dedup *)ctx;
+
+	spdk_json_write_name(w, "dedup");
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&dedup->dedup_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(dedup->base_bdev));
+	spdk_json_write_named_uint32(w, "chunk_size", dedup->chunk_size);
+	spdk_json_write_named_uint64(w, "logical_chunks", dedup->num_logical_chunks);
+	spdk_json_write_named_uint32(w, "physical_chunks", dedup->num_physical_chunks);
+	spdk_json_write_named_uint32(w, "used_physical_chunks", dedup->used_chunks);
+	spdk_json_write_named_uint64(w, "chunks_written", dedup->chunks_written);
+	spdk_json_write_named_uint64(w, "chunks_deduplicated", dedup->chunks_deduplicated);
+	spdk_json_write_named_uint64(w, "zero_chunks", dedup->zero_chunks);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+/* The volume is described by its superblock and found again by examine, so there is
+ * nothing to replay.
+ */
+static int
+vbdev_dedup_config_json(struct spdk_json_write_ctx *w)
+{
+	return 0;
+}
+
+static void
+_channel_cleanup(struct vbdev_dedup *dedup)
+{
+	if (dedup->base_ch != NULL) {
+		spdk_put_io_channel(dedup->base_ch);
+		dedup->base_ch = NULL;
+	}
+	if (dedup->accel_ch != NULL) {
+		spdk_put_io_channel(dedup->accel_ch);
+		dedup->accel_ch = NULL;
+	}
+	dedup->dedup_thread = NULL;
+}
+
+/* We provide this callback for the SPDK channel code to create a channel using
+ * the channel struct we provided in our module get_io_channel() entry point. The
+ * first channel takes the base bdev and accel channels used by the dedup thread.
+ */
+static int
+dedup_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct vbdev_dedup *dedup = io_device;
+	int rc = 0;
+
+	pthread_mutex_lock(&dedup->dedup_lock);
+	if (dedup->ch_count == 0) {
+		dedup->base_ch = spdk_bdev_get_io_channel(dedup->base_desc);
+		dedup->accel_ch = spdk_accel_get_io_channel();
+		dedup->dedup_thread = spdk_get_thread();
+		if (dedup->base_ch == NULL || dedup->accel_ch == NULL) {
+			SPDK_ERRLOG("could not get channels for dedup bdev %p\n", dedup);
+			_channel_cleanup(dedup);
+			rc = -ENOMEM;
+		}
+	}
+	if (rc == 0) {
+		dedup->ch_count++;
+	}
+	pthread_mutex_unlock(&dedup->dedup_lock);
+
+	return rc;
+}
+
+/* Used to reroute destroy_ch to the correct thread */
+static void
+_dedup_bdev_ch_destroy_cb(void *arg)
+{
+	struct vbdev_dedup *dedup = arg;
+
+	pthread_mutex_lock(&dedup->dedup_lock);
+	_channel_cleanup(dedup);
+	pthread_mutex_unlock(&dedup->dedup_lock);
+}
+
+static void
+dedup_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct vbdev_dedup *dedup = io_device;
+
+	pthread_mutex_lock(&dedup->dedup_lock);
+	dedup->ch_count--;
+	if (dedup->ch_count == 0) {
+		/* Send this request to the thread where the channel was created. */
+		if (dedup->dedup_thread != spdk_get_thread()) {
+			spdk_thread_send_msg(dedup->dedup_thread, _dedup_bdev_ch_destroy_cb, dedup);
+		} else {
+			_channel_cleanup(dedup);
+		}
+	}
+	pthread_mutex_unlock(&dedup->dedup_lock);
+}
+
+/* During init we'll be asked how much memory we'd like passed to us
+ * in bev_io structures as context. Here's where we specify how
+ * much context we want per IO.
+ */
+static int
+vbdev_dedup_get_ctx_size(void)
+{
+	return sizeof(struct dedup_bdev_io);
+}
+
+/* When we register our bdev this is how we specify our entry points. */
+static const struct spdk_bdev_fn_table vbdev_dedup_fn_table = {
+	.destruct		= vbdev_dedup_destruct,
+	.submit_request		= vbdev_dedup_submit_request,
+	.io_type_supported	= vbdev_dedup_io_type_supported,
+	.get_io_channel		= vbdev_dedup_get_io_channel,
+	.dump_info_json		= vbdev_dedup_dump_info_json,
+	.write_config_json	= NULL,
+};
+
+static void vbdev_dedup_examine(struct spdk_bdev *bdev);
+
+static struct spdk_bdev_module dedup_if = {
+	.name = "dedup",
+	.get_ctx_size = vbdev_dedup_get_ctx_size,
+	.examine_disk = vbdev_dedup_examine,
+	.config_json = vbdev_dedup_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(dedup, &dedup_if)
+
+static int
+vbdev_dedup_claim(struct vbdev_dedup *dedup)
+{
+	struct spdk_bdev_alias *aliases;
+	int rc;
+
+	if (!TAILQ_EMPTY(spdk_bdev_get_aliases(dedup->base_bdev))) {
+		aliases = TAILQ_FIRST(spdk_bdev_get_aliases(dedup->base_bdev));
+		dedup->dedup_bdev.name = spdk_sprintf_alloc("DEDUP_%s", aliases->alias.name);
+	} else {
+		dedup->dedup_bdev.name = spdk_sprintf_alloc("DEDUP_%s", dedup->base_bdev->name);
+	}
+	if (!dedup->dedup_bdev.name) {
+		SPDK_ERRLOG("could not allocate dedup_bdev name\n");
+		return -ENOMEM;
+	}
+
+	dedup->dedup_bdev.product_name = DEDUP_BDEV_NAME;
+	dedup->dedup_bdev.write_cache = dedup->base_bdev->write_cache;
+	dedup->dedup_bdev.required_alignment = dedup->base_bdev->required_alignment;
+	dedup->dedup_bdev.optimal_io_boundary = dedup->blocks_per_chunk;
+	dedup->dedup_bdev.split_on_optimal_io_boundary = true;
+	dedup->dedup_bdev.blocklen = dedup->base_bdev->blocklen;
+	dedup->dedup_bdev.blockcnt = dedup->num_logical_chunks * dedup->blocks_per_chunk;
+	spdk_uuid_copy(&dedup->dedup_bdev.uuid, &dedup->sb->uuid);
+
+	/* This is the context that is passed to us when the bdev
+	 * layer calls in so we'll save our dedup node here.
+	 */
+	dedup->dedup_bdev.ctxt = dedup;
+	dedup->dedup_bdev.fn_table = &vbdev_dedup_fn_table;
+	dedup->dedup_bdev.module = &dedup_if;
+
+	pthread_mutex_init(&dedup->dedup_lock, NULL);
+
+	spdk_io_device_register(dedup, dedup_bdev_ch_create_cb, dedup_bdev_ch_destroy_cb,
+				sizeof(struct dedup_io_channel), dedup->dedup_bdev.name);
+
+	rc = spdk_bdev_module_claim_bdev(dedup->base_bdev, dedup->base_desc, dedup->dedup_bdev.module);
+	if (rc) {
+		SPDK_ERRLOG("could not claim bdev %s\n", spdk_bdev_get_name(dedup->base_bdev));
+		goto error_claim;
+	}
+
+	rc = spdk_bdev_register(&dedup->dedup_bdev);
+	if (rc < 0) {
+		SPDK_ERRLOG("trying to register bdev\n");
+		goto error_bdev_register;
+	}
+
+	TAILQ_INSERT_TAIL(&g_vbdev_dedup, dedup, link);
+
+	SPDK_NOTICELOG("registered io_device and virtual bdev for: %s\n", dedup->dedup_bdev.name);
+
+	return 0;
+
+	/* Error cleanup paths. */
+error_bdev_register:
+	spdk_bdev_module_release_bdev(dedup->base_bdev);
+error_claim:
+	spdk_io_device_unregister(dedup, NULL);
+	pthread_mutex_destroy(&dedup->dedup_lock);
+	free(dedup->dedup_bdev.name);
+	dedup->dedup_bdev.name = NULL;
+	return rc;
+}
+
+/*
+ * Create.
+ */
+static void
+_dedup_create_done(struct vbdev_dedup *dedup, int status)
+{
+	spdk_create_dedup_complete cb_fn = dedup->create_cb_fn;
+	void *cb_arg = dedup->create_cb_arg;
+
+	spdk_put_io_channel(dedup->base_ch);
+	dedup->base_ch = NULL;
+
+	if (status == 0) {
+		status = vbdev_dedup_claim(dedup);
+	}
+
+	if (status != 0) {
+		SPDK_ERRLOG("failed to create dedup bdev on %s: %d\n",
+			    spdk_bdev_get_name(dedup->base_bdev), status);
+		spdk_bdev_close(dedup->base_desc);
+		_dedup_free(dedup);
+		cb_fn(cb_arg, NULL, status);
+		return;
+	}
+
+	cb_fn(cb_arg, dedup->dedup_bdev.name, 0);
+}
+
+static void
+_dedup_create_sb_done(void *cb_arg, int status)
+{
+	_dedup_create_done(cb_arg, status);
+}
+
+static void
+_dedup_create_md_done(struct vbdev_dedup *dedup, int status)
+{
+	if (status != 0) {
+		_dedup_create_done(dedup, status);
+		return;
+	}
+
+	/* The superblock goes last, a format interrupted before this is not picked up. */
+	_dedup_io_op_buf(dedup, &dedup->md_op, true, dedup->md_buf, 0, DEDUP_MD_BLOCK_SIZE,
+			 _dedup_create_sb_done, dedup);
+}
+
+/* RPC entry point for dedup vbdev creation. */
+int
+create_dedup_bdev(const char *bdev_name, uint32_t chunk_size, uint64_t size_in_mib,
+		  spdk_create_dedup_complete cb_fn, void *cb_arg)
+{
+	struct spdk_bdev_desc *bdev_desc = NULL;
+	struct spdk_bdev *bdev;
+	struct vbdev_dedup *dedup;
+	struct dedup_sb sb = {};
+	int rc;
+
+	if (chunk_size == 0) {
+		chunk_size = DEDUP_DEFAULT_CHUNK_SIZE;
+	}
+	if (!spdk_u32_is_pow2(chunk_size) || chunk_size < DEDUP_MIN_CHUNK_SIZE ||
+	    chunk_size > DEDUP_MAX_CHUNK_SIZE) {
+		SPDK_ERRLOG("Chunk size must be a power of two between %u and %u\n",
+			    DEDUP_MIN_CHUNK_SIZE, DEDUP_MAX_CHUNK_SIZE);
+		return -EINVAL;
+	}
+
+	TAILQ_FOREACH(dedup, &g_vbdev_dedup, link) {
+		if (strcmp(bdev_name, dedup->base_bdev->name) == 0) {
+			SPDK_ERRLOG("Base bdev %s already being used for a dedup bdev\n", bdev_name);
+			return -EBUSY;
+		}
+	}
+
+	rc = spdk_bdev_open_ext(bdev_name, true, vbdev_dedup_base_bdev_event_cb, NULL, &bdev_desc);
+	if (rc) {
+		SPDK_ERRLOG("could not open bdev %s\n", bdev_name);
+		return rc;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(bdev_desc);
+	if (DEDUP_MD_BLOCK_SIZE % bdev->blocklen != 0) {
+		SPDK_ERRLOG("Block size of %s must divide %u\n", bdev_name, DEDUP_MD_BLOCK_SIZE);
+		spdk_bdev_close(bdev_desc);
+		return -EINVAL;
+	}
+
+	rc = _dedup_init_geometry(&sb, bdev->blockcnt * bdev->blocklen, chunk_size,
+				  size_in_mib * 1024 * 1024);
+	if (rc != 0) {
+		SPDK_ERRLOG("bdev %s is too small for a dedup bdev\n", bdev_name);
+		spdk_bdev_close(bdev_desc);
+		return rc;
+	}
+	memcpy(sb.signature, DEDUP_SIGNATURE, sizeof(sb.signature));
+	sb.version = DEDUP_VERSION;
+	sb.block_size = bdev->blocklen;
+	spdk_uuid_generate(&sb.uuid);
+	sb.crc = _dedup_sb_crc(&sb);
+
+	dedup = _prepare_for_load_init(bdev_desc);
+	if (dedup == NULL) {
+		spdk_bdev_close(bdev_desc);
+		return -ENOMEM;
+	}
+
+	rc = _dedup_alloc_mem(dedup, &sb);
+	if (rc != 0) {
+		spdk_bdev_close(bdev_desc);
+		_dedup_free(dedup);
+		return rc;
+	}
+	memset(dedup->map, 0xFF, dedup->num_logical_chunks * sizeof(uint32_t));
+
+	dedup->base_ch = spdk_bdev_get_io_channel(dedup->base_desc);
+	if (dedup->base_ch == NULL) {
+		SPDK_ERRLOG("could not get an io channel for bdev %s\n", bdev_name);
+		spdk_bdev_close(bdev_desc);
+		_dedup_free(dedup);
+		return -ENOMEM;
+	}
+
+	dedup->create_cb_fn = cb_fn;
+	dedup->create_cb_arg = cb_arg;
+	_dedup_md_bulk_io(dedup, true, DEDUP_MD_BLOCK_SIZE, _dedup_create_md_done);
+
+	return 0;
+}
+
+/*
+ * Examine.
+ */
+static void
+_dedup_examine_done(struct vbdev_dedup *dedup, int status)
+{
+	spdk_put_io_channel(dedup->base_ch);
+	dedup->base_ch = NULL;
+
+	if (status == 0) {
+		status = _dedup_rebuild_index(dedup);
+	}
+	if (status == 0) {
+		status = vbdev_dedup_claim(dedup);
+	}
+
+	if (status != 0) {
+		SPDK_ERRLOG("failed to load dedup bdev on %s: %d\n",
+			    spdk_bdev_get_name(dedup->base_bdev), status);
+		spdk_bdev_close(dedup->base_desc);
+		_dedup_free(dedup);
+	}
+
+	spdk_bdev_module_examine_done(&dedup_if);
+}
+
+static void
+_dedup_examine_sb_done(void *cb_arg, int status)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	struct dedup_sb *sb = dedup->md_op.iov.iov_base;
+
+	if (status != 0 || !_dedup_sb_valid(sb, dedup->base_bdev)) {
+		/* Not ours. */
+		spdk_free(sb);
+		spdk_put_io_channel(dedup->base_ch);
+		spdk_bdev_close(dedup->base_desc);
+		free(dedup);
+		spdk_bdev_module_examine_done(&dedup_if);
+		return;
+	}
+
+	status = _dedup_alloc_mem(dedup, sb);
+	spdk_free(sb);
+	if (status != 0) {
+		_dedup_examine_done(dedup, status);
+		return;
+	}
+
+	_dedup_md_bulk_io(dedup, false, DEDUP_MD_BLOCK_SIZE, _dedup_examine_done);
+}
+
+/* Examine_disk entry point: will do a metadata load to see if this is ours,
+ * and if so will go ahead and claim it.
+ */
+static void
+vbdev_dedup_examine(struct spdk_bdev *bdev)
+{
+	struct spdk_bdev_desc *bdev_desc = NULL;
+	struct vbdev_dedup *dedup;
+	void *sb;
+	int rc;
+
+	if (strcmp(bdev->product_name, DEDUP_BDEV_NAME) == 0 ||
+	    DEDUP_MD_BLOCK_SIZE % bdev->blocklen != 0) {
+		spdk_bdev_module_examine_done(&dedup_if);
+		return;
+	}
+
+	rc = spdk_bdev_open_ext(spdk_bdev_get_name(bdev), false,
+				vbdev_dedup_base_bdev_event_cb, NULL, &bdev_desc);
+	if (rc) {
+		SPDK_ERRLOG("could not open bdev %s\n", spdk_bdev_get_name(bdev));
+		spdk_bdev_module_examine_done(&dedup_if);
+		return;
+	}
+
+	dedup = _prepare_for_load_init(bdev_desc);
+	sb = spdk_zmalloc(DEDUP_MD_BLOCK_SIZE, DEDUP_MD_BLOCK_SIZE, NULL,
+			  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (dedup == NULL || sb == NULL) {
+		goto error;
+	}
+
+	dedup->base_ch = spdk_bdev_get_io_channel(dedup->base_desc);
+	if (dedup->base_ch == NULL) {
+		SPDK_ERRLOG("could not get an io channel for bdev %s\n", spdk_bdev_get_name(bdev));
+		goto error;
+	}
+
+	_dedup_io_op_buf(dedup, &dedup->md_op, false, sb, 0, DEDUP_MD_BLOCK_SIZE,
+			 _dedup_examine_sb_done, dedup);
+	return;
+
+error:
+	free(dedup);
+	spdk_free(sb);
+	spdk_bdev_close(bdev_desc);
+	spdk_bdev_module_examine_done(&dedup_if);
+}
+
+/*
+ * Delete and hot remove.
+ */
+static void
+_vbdev_dedup_delete_done(void *_ctx)
+{
+	struct vbdev_dedup_delete_ctx *ctx = _ctx;
+
+	ctx->cb_fn(ctx->cb_arg, ctx->cb_rc);
+
+	free(ctx);
+}
+
+static void
+vbdev_dedup_delete_done(void *cb_arg, int bdeverrno)
+{
+	struct vbdev_dedup_delete_ctx *ctx = cb_arg;
+
+	ctx->cb_rc = bdeverrno;
+
+	if (ctx->orig_thread != spdk_get_thread()) {
+		spdk_thread_send_msg(ctx->orig_thread, _vbdev_dedup_delete_done, ctx);
+	} else {
+		_vbdev_dedup_delete_done(ctx);
+	}
+}
+
+static void
+_dedup_delete_sb_done(void *cb_arg, int status)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	struct vbdev_dedup_delete_ctx *ctx = dedup->delete_ctx;
+
+	spdk_put_io_channel(ctx->op.ch);
+	spdk_free(ctx->zero_buf);
+	ctx->zero_buf = NULL;
+
+	if (status != 0) {
+		SPDK_ERRLOG("failed to erase the superblock of %s: %d\n",
+			    spdk_bdev_get_name(&dedup->dedup_bdev), status);
+		dedup->delete_ctx = NULL;
+		vbdev_dedup_delete_done(ctx, status);
+		return;
+	}
+
+	spdk_bdev_unregister(&dedup->dedup_bdev, vbdev_dedup_delete_done, ctx);
+}
+
+void
+bdev_dedup_delete(const char *name, spdk_delete_dedup_complete cb_fn, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = NULL;
+	struct vbdev_dedup_delete_ctx *ctx;
+	struct dedup_io_op *op;
+
+	TAILQ_FOREACH(dedup, &g_vbdev_dedup, link) {
+		if (strcmp(name, dedup->dedup_bdev.name) == 0) {
+			break;
+		}
+	}
+
+	if (dedup == NULL) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	if (dedup->delete_ctx != NULL) {
+		cb_fn(cb_arg, -EBUSY);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("Failed to allocate delete context\n");
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->orig_thread = spdk_get_thread();
+	ctx->zero_buf = spdk_zmalloc(DEDUP_MD_BLOCK_SIZE, DEDUP_MD_BLOCK_SIZE, NULL,
+				     SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (ctx->zero_buf == NULL) {
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	dedup->delete_ctx = ctx;
+
+	/* Erase the superblock on this thread, with a channel of its own. The metadata
+	 * writes of the I/O path never touch the superblock block.
+	 */
+	op = &ctx->op;
+	op->dedup = dedup;
+	op->ch = spdk_bdev_get_io_channel(dedup->base_desc);
+	op->write = true;
+	op->iov.iov_base = ctx->zero_buf;
+	op->iov.iov_len = DEDUP_MD_BLOCK_SIZE;
+	op->iovs = &op->iov;
+	op->iovcnt = 1;
+	op->offset_blocks = 0;
+	op->num_blocks = DEDUP_MD_BLOCK_SIZE / dedup->base_bdev->blocklen;
+	op->cb_fn = _dedup_delete_sb_done;
+	op->cb_arg = dedup;
+	_dedup_io_op_submit(op);
+}
+
+static void
+vbdev_dedup_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_dedup *dedup, *tmp;
+
+	TAILQ_FOREACH_SAFE(dedup, &g_vbdev_dedup, link, tmp) {
+		if (bdev_find == dedup->base_bdev) {
+			spdk_bdev_unregister(&dedup->dedup_bdev, NULL, NULL);
+		}
+	}
+}
+
+/* Called when the underlying base bdev triggers asynchronous event such as bdev removal. */
+static void
+vbdev_dedup_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			       void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_dedup_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_dedup)
@@ -0,0 +1,40 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_DEDUP_H
+#define SPDK_VBDEV_DEDUP_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+
+#define DEDUP_DEFAULT_CHUNK_SIZE	(16 * 1024)
+#define DEDUP_MIN_CHUNK_SIZE		(4 * 1024)
+#define DEDUP_MAX_CHUNK_SIZE		(128 * 1024)
+
+typedef void (*spdk_create_dedup_complete)(void *cb_arg, const char *name, int bdeverrno);
+typedef void (*spdk_delete_dedup_complete)(void *cb_arg, int bdeverrno);
+
+/**
+ * Format a base bdev as a deduplicating volume and register a vbdev on top of it.
+ *
+ * \param bdev_name Name of the base bdev.
+ * \param chunk_size Deduplication granularity in bytes, 0 for the default.
+ * \param size_in_mib Size of the vbdev in MiB, 0 to match the physical capacity. It may be
+ * larger than the base bdev, writes fail with -ENOSPC once all physical chunks are used.
+ * \param cb_fn Called with the name of the new vbdev once it is registered.
+ * \param cb_arg Argument passed to cb_fn.
+ *
+ * \return 0 if the format was started, cb_fn is then always called, negative errno otherwise.
+ */
+int create_dedup_bdev(const char *bdev_name, uint32_t chunk_size, uint64_t size_in_mib,
+		      spdk_create_dedup_complete cb_fn, void *cb_arg);
+
+/**
+ * Unregister a dedup vbdev and erase its superblock, so the base bdev is not claimed again.
+ */
+void bdev_dedup_delete(const char *bdev_name, spdk_delete_dedup_complete cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_DEDUP_H */
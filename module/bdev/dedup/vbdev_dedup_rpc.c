@@ -0,0 +1,127 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_dedup.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+/* Structure to hold the parameters for this RPC method. */
+struct rpc_construct_dedup {
+	char *base_bdev_name;
+	uint32_t chunk_size;
+	uint64_t size_in_mib;
+};
+
+/* Free the allocated memory resource after the RPC handling. */
+static void
+free_rpc_construct_dedup(struct rpc_construct_dedup *r)
+{
+	free(r->base_bdev_name);
+}
+
+/* Structure to decode the input parameters for this RPC method. */
+static const struct spdk_json_object_decoder rpc_construct_dedup_decoders[] = {
+	{"base_bdev_name", offsetof(struct rpc_construct_dedup, base_bdev_name), spdk_json_decode_string},
+	{"chunk_size", offsetof(struct rpc_construct_dedup, chunk_size), spdk_json_decode_uint32, true},
+	{"size_in_mib", offsetof(struct rpc_construct_dedup, size_in_mib), spdk_json_decode_uint64, true},
+};
+
+static void
+_rpc_bdev_dedup_create_cb(void *cb_arg, const char *name, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (bdeverrno != 0) {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_string(w, name);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+/* Decode the parameters for this RPC method and properly construct the dedup
+ * device. Error status returned in the failed cases.
+ */
+static void
+rpc_bdev_dedup_create(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_construct_dedup req = {NULL};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_construct_dedup_decoders,
+				    SPDK_COUNTOF(rpc_construct_dedup_decoders),
+				    &req)) {
+		SPDK_DEBUGLOG(vbdev_dedup, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = create_dedup_bdev(req.base_bdev_name, req.chunk_size, req.size_in_mib,
+			       _rpc_bdev_dedup_create_cb, request);
+	if (rc != 0) {
+		if (rc == -EBUSY) {
+			spdk_jsonrpc_send_error_response(request, rc, "Base bdev already in use for dedup.");
+		} else {
+			spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		}
+	}
+
+cleanup:
+	free_rpc_construct_dedup(&req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_create", rpc_bdev_dedup_create, SPDK_RPC_RUNTIME)
+
+struct rpc_delete_dedup {
+	char *name;
+};
+
+static void
+free_rpc_delete_dedup(struct rpc_delete_dedup *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_delete_dedup_decoders[] = {
+	{"name", offsetof(struct rpc_delete_dedup, name), spdk_json_decode_string},
+};
+
+static void
+_rpc_bdev_dedup_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno != 0) {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_dedup_delete(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_delete_dedup req = {NULL};
+
+	if (spdk_json_decode_object(params, rpc_delete_dedup_decoders,
+				    SPDK_COUNTOF(rpc_delete_dedup_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+	} else {
+		bdev_dedup_delete(req.name, _rpc_bdev_dedup_delete_cb, request);
+	}
+
+	free_rpc_delete_dedup(&req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_delete", rpc_bdev_dedup_delete, SPDK_RPC_RUNTIME)
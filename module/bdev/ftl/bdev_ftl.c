@@ -17,24 +17,63 @@
 
 #include "bdev_ftl.h"
 
+struct ftl_bdev_shard {
+	struct spdk_ftl_dev	*dev;
+	struct spdk_bdev_desc	*base_bdev_desc;
+	struct spdk_bdev_desc	*cache_bdev_desc;
+};
+
 struct ftl_bdev {
 	struct spdk_bdev	bdev;
-	struct spdk_ftl_dev	*dev;
+	struct ftl_bdev_conf	conf;
+	/*
+	 * Each shard is a separate FTL device with its own core thread, L2P, NV cache
+	 * and relocation. The LBA space is striped across them in stripe_blocks units.
+	 */
+	struct ftl_bdev_shard	shard[FTL_BDEV_MAX_SHARDS];
+	size_t			num_shards;
+	uint64_t		stripe_blocks;
+	/* Number of shards with an initialized FTL device */
+	size_t			num_shards_ready;
+	bool			io_device_registered;
+	void			(*release_cb)(struct ftl_bdev *ftl_bdev);
 	ftl_bdev_init_fn	init_cb;
 	void			*init_arg;
 	int			rc;
-	struct spdk_bdev_desc	*base_bdev_desc;
-	struct spdk_bdev_desc	*cache_bdev_desc;
+};
+
+/* IO channel of a sharded FTL bdev, holding an FTL IO channel of each shard */
+struct ftl_bdev_io_channel {
+	struct spdk_io_channel	*shard_ch[FTL_BDEV_MAX_SHARDS];
+};
+
+struct ftl_bdev_unmap_ctx {
+	spdk_ftl_fn		cb_fn;
+	void			*cb_arg;
+	size_t			outstanding;
+	int			status;
+	/* FTL IOs of each shard, only used for unmaps coming from the bdev layer */
+	uint8_t			ios[];
 };
 
 struct ftl_deferred_init {
-	struct spdk_ftl_conf		conf;
+	struct ftl_bdev_conf		conf;
 
 	LIST_ENTRY(ftl_deferred_init)	entry;
 };
 
 static LIST_HEAD(, ftl_deferred_init)	g_deferred_init = LIST_HEAD_INITIALIZER(g_deferred_init);
 
+static const char *const g_gc_policy_names[SPDK_FTL_GC_POLICY_MAX] = {
+	[SPDK_FTL_GC_POLICY_GREEDY]		= "greedy",
+	[SPDK_FTL_GC_POLICY_COST_BENEFIT]	= "cost_benefit",
+};
+
+static const char *const g_l2p_evict_policy_names[SPDK_FTL_L2P_EVICT_MAX] = {
+	[SPDK_FTL_L2P_EVICT_LRU]		= "lru",
+	[SPDK_FTL_L2P_EVICT_CLEAN_FIRST]	= "clean_first",
+};
+
 static int bdev_ftl_initialize(void);
 static void bdev_ftl_finish(void);
 static void bdev_ftl_examine(struct spdk_bdev *bdev);
@@ -55,21 +94,103 @@ static struct spdk_bdev_module g_ftl_if = {
 
 SPDK_BDEV_MODULE_REGISTER(ftl, &g_ftl_if)
 
+static void
+bdev_ftl_close_shards(struct spdk_bdev_desc **base_descs, struct spdk_bdev_desc **cache_descs,
+		      size_t num_shards)
+{
+	size_t i;
+
+	for (i = 0; i < num_shards; i++) {
+		if (base_descs[i]) {
+			spdk_bdev_close(base_descs[i]);
+		}
+		if (cache_descs[i]) {
+			spdk_bdev_close(cache_descs[i]);
+		}
+	}
+}
+
 static void
 bdev_ftl_free(struct ftl_bdev *ftl_bdev)
 {
-	spdk_bdev_close(ftl_bdev->base_bdev_desc);
-	spdk_bdev_close(ftl_bdev->cache_bdev_desc);
+	size_t i;
+
+	for (i = 0; i < ftl_bdev->num_shards; i++) {
+		spdk_bdev_close(ftl_bdev->shard[i].base_bdev_desc);
+		spdk_bdev_close(ftl_bdev->shard[i].cache_bdev_desc);
+	}
+	bdev_ftl_conf_deinit(&ftl_bdev->conf);
 	free(ftl_bdev->bdev.name);
 	free(ftl_bdev);
 }
 
+static void bdev_ftl_release_shards(struct ftl_bdev *ftl_bdev);
+
 static void
 bdev_ftl_dev_free_cb(void *ctx, int status)
 {
 	struct ftl_bdev *ftl_bdev = ctx;
 
-	spdk_bdev_destruct_done(&ftl_bdev->bdev, status);
+	if (status) {
+		SPDK_ERRLOG("Fatal ERROR of FTL cleanup, name %s\n", ftl_bdev->bdev.name);
+		if (!ftl_bdev->rc) {
+			ftl_bdev->rc = status;
+		}
+	}
+
+	bdev_ftl_release_shards(ftl_bdev);
+}
+
+/*
+ * Free the FTL devices of all initialized shards, one at a time, in reverse order
+ * of their initialization and call release_cb once done.
+ */
+static void
+bdev_ftl_release_shards(struct ftl_bdev *ftl_bdev)
+{
+	struct spdk_ftl_dev *dev;
+	int rc;
+
+	while (ftl_bdev->num_shards_ready > 0) {
+		dev = ftl_bdev->shard[--ftl_bdev->num_shards_ready].dev;
+
+		rc = spdk_ftl_dev_free(dev, bdev_ftl_dev_free_cb, ftl_bdev);
+		if (!rc) {
+			return;
+		}
+
+		SPDK_ERRLOG("Failed to free FTL device of %s (%d)\n", ftl_bdev->bdev.name, rc);
+		if (!ftl_bdev->rc) {
+			ftl_bdev->rc = rc;
+		}
+	}
+
+	ftl_bdev->release_cb(ftl_bdev);
+}
+
+static void
+bdev_ftl_io_device_unregister_cb(void *io_device)
+{
+	bdev_ftl_release_shards(io_device);
+}
+
+static void
+bdev_ftl_release(struct ftl_bdev *ftl_bdev, void (*release_cb)(struct ftl_bdev *ftl_bdev))
+{
+	ftl_bdev->release_cb = release_cb;
+
+	if (ftl_bdev->io_device_registered) {
+		ftl_bdev->io_device_registered = false;
+		spdk_io_device_unregister(ftl_bdev, bdev_ftl_io_device_unregister_cb);
+	} else {
+		bdev_ftl_release_shards(ftl_bdev);
+	}
+}
+
+static void
+bdev_ftl_destruct_done(struct ftl_bdev *ftl_bdev)
+{
+	spdk_bdev_destruct_done(&ftl_bdev->bdev, ftl_bdev->rc);
 	bdev_ftl_free(ftl_bdev);
 }
 
@@ -78,12 +199,123 @@ bdev_ftl_destruct(void *ctx)
 {
 	struct ftl_bdev *ftl_bdev = ctx;
 
-	spdk_ftl_dev_free(ftl_bdev->dev, bdev_ftl_dev_free_cb, ftl_bdev);
+	bdev_ftl_release(ftl_bdev, bdev_ftl_destruct_done);
 
 	/* return 1 to indicate that the destruction is asynchronous */
 	return 1;
 }
 
+static inline size_t
+bdev_ftl_shard_idx(const struct ftl_bdev *ftl_bdev, uint64_t lba)
+{
+	return (lba / ftl_bdev->stripe_blocks) % ftl_bdev->num_shards;
+}
+
+/*
+ * Returns the number of LBAs below lba which belong to the given shard. For an LBA routed
+ * to that shard, this is its address within the shard's FTL device.
+ */
+static inline uint64_t
+bdev_ftl_shard_lba(const struct ftl_bdev *ftl_bdev, size_t idx, uint64_t lba)
+{
+	uint64_t row_blocks = ftl_bdev->stripe_blocks * ftl_bdev->num_shards;
+	uint64_t offset = lba % row_blocks;
+	uint64_t start = idx * ftl_bdev->stripe_blocks;
+
+	offset = offset > start ? spdk_min(offset - start, ftl_bdev->stripe_blocks) : 0;
+
+	return (lba / row_blocks) * ftl_bdev->stripe_blocks + offset;
+}
+
+/*
+ * Translates the bdev IO channel and LBA to the ones of the shard the LBA is routed to.
+ * IOs never cross a stripe boundary, as it's a multiple of the bdev's optimal IO boundary.
+ */
+static inline struct spdk_ftl_dev *
+bdev_ftl_get_shard(struct ftl_bdev *ftl_bdev, struct spdk_io_channel **ch, uint64_t *lba)
+{
+	struct ftl_bdev_io_channel *ftl_ch;
+	size_t idx;
+
+	if (ftl_bdev->num_shards == 1) {
+		return ftl_bdev->shard[0].dev;
+	}
+
+	ftl_ch = spdk_io_channel_get_ctx(*ch);
+	idx = bdev_ftl_shard_idx(ftl_bdev, *lba);
+
+	*ch = ftl_ch->shard_ch[idx];
+	*lba = bdev_ftl_shard_lba(ftl_bdev, idx, *lba);
+
+	return ftl_bdev->shard[idx].dev;
+}
+
+static void
+bdev_ftl_unmap_shard_cb(void *cb_arg, int status)
+{
+	struct ftl_bdev_unmap_ctx *ctx = cb_arg;
+
+	if (status && !ctx->status) {
+		ctx->status = status;
+	}
+
+	assert(ctx->outstanding > 0);
+	if (--ctx->outstanding == 0) {
+		ctx->cb_fn(ctx->cb_arg, ctx->status);
+		free(ctx);
+	}
+}
+
+/*
+ * Unmaps an LBA range of a sharded bdev. Consecutive stripes of a shard are contiguous
+ * within its FTL device, so the range translates to at most one unmap per shard. When
+ * ftl_ch is NULL, the shards' management path is used (as for the unmap RPC).
+ */
+static int
+bdev_ftl_unmap_shards(struct ftl_bdev *ftl_bdev, struct ftl_bdev_io_channel *ftl_ch,
+		      uint64_t lba, uint64_t num_blocks, spdk_ftl_fn cb_fn, void *cb_arg)
+{
+	struct ftl_bdev_unmap_ctx *ctx;
+	size_t io_size = ftl_ch ? SPDK_ALIGN_CEIL(spdk_ftl_io_size(), sizeof(uint64_t)) : 0;
+	uint64_t start, end;
+	struct ftl_io *io;
+	size_t i;
+	int rc;
+
+	ctx = calloc(1, sizeof(*ctx) + io_size * ftl_bdev->num_shards);
+	if (!ctx) {
+		return -ENOMEM;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	/* Hold a reference until all the shards' unmaps are submitted */
+	ctx->outstanding = 1;
+
+	for (i = 0; i < ftl_bdev->num_shards; i++) {
+		start = bdev_ftl_shard_lba(ftl_bdev, i, lba);
+		end = bdev_ftl_shard_lba(ftl_bdev, i, lba + num_blocks);
+		if (start == end) {
+			continue;
+		}
+
+		io = ftl_ch ? (struct ftl_io *)&ctx->ios[i * io_size] : NULL;
+
+		ctx->outstanding++;
+		rc = spdk_ftl_unmap(ftl_bdev->shard[i].dev, io, ftl_ch ? ftl_ch->shard_ch[i] : NULL,
+				    start, end - start, bdev_ftl_unmap_shard_cb, ctx);
+		if (rc) {
+			ctx->outstanding--;
+			ctx->status = rc;
+			break;
+		}
+	}
+
+	bdev_ftl_unmap_shard_cb(ctx, 0);
+
+	return 0;
+}
+
 static void
 bdev_ftl_cb(void *arg, int rc)
 {
@@ -110,6 +342,8 @@ bdev_ftl_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		    bool success)
 {
 	struct ftl_bdev *ftl_bdev;
+	struct spdk_ftl_dev *dev;
+	uint64_t lba = bdev_io->u.bdev.offset_blocks;
 	int rc;
 
 	ftl_bdev = bdev_io->bdev->ctxt;
@@ -119,9 +353,9 @@ bdev_ftl_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		return;
 	}
 
-	rc = spdk_ftl_readv(ftl_bdev->dev, (struct ftl_io *)bdev_io->driver_ctx,
-			    ch,
-			    bdev_io->u.bdev.offset_blocks,
+	dev = bdev_ftl_get_shard(ftl_bdev, &ch, &lba);
+	rc = spdk_ftl_readv(dev, (struct ftl_io *)bdev_io->driver_ctx,
+			    ch, lba,
 			    bdev_io->u.bdev.num_blocks,
 			    bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, bdev_ftl_cb, bdev_io);
 
@@ -134,6 +368,8 @@ static int
 _bdev_ftl_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
 {
 	struct ftl_bdev *ftl_bdev = (struct ftl_bdev *)bdev_io->bdev->ctxt;
+	struct spdk_ftl_dev *dev;
+	uint64_t lba = bdev_io->u.bdev.offset_blocks;
 
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
@@ -142,15 +378,20 @@ _bdev_ftl_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 		return 0;
 
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		return spdk_ftl_writev(ftl_bdev->dev, (struct ftl_io *)bdev_io->driver_ctx,
-				       ch, bdev_io->u.bdev.offset_blocks,
+		dev = bdev_ftl_get_shard(ftl_bdev, &ch, &lba);
+		return spdk_ftl_writev(dev, (struct ftl_io *)bdev_io->driver_ctx,
+				       ch, lba,
 				       bdev_io->u.bdev.num_blocks, bdev_io->u.bdev.iovs,
 				       bdev_io->u.bdev.iovcnt, bdev_ftl_cb, bdev_io);
 
 	case SPDK_BDEV_IO_TYPE_UNMAP:
-		return spdk_ftl_unmap(ftl_bdev->dev, (struct ftl_io *)bdev_io->driver_ctx,
-				      ch, bdev_io->u.bdev.offset_blocks,
-				      bdev_io->u.bdev.num_blocks, bdev_ftl_cb, bdev_io);
+		if (ftl_bdev->num_shards > 1) {
+			return bdev_ftl_unmap_shards(ftl_bdev, spdk_io_channel_get_ctx(ch), lba,
+						     bdev_io->u.bdev.num_blocks, bdev_ftl_cb, bdev_io);
+		}
+
+		return spdk_ftl_unmap(ftl_bdev->shard[0].dev, (struct ftl_io *)bdev_io->driver_ctx,
+				      ch, lba, bdev_io->u.bdev.num_blocks, bdev_ftl_cb, bdev_io);
 	case SPDK_BDEV_IO_TYPE_FLUSH:
 		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
 		return 0;
@@ -188,7 +429,45 @@ bdev_ftl_get_io_channel(void *ctx)
 {
 	struct ftl_bdev *ftl_bdev = ctx;
 
-	return spdk_ftl_get_io_channel(ftl_bdev->dev);
+	if (ftl_bdev->num_shards > 1) {
+		return spdk_get_io_channel(ftl_bdev);
+	}
+
+	return spdk_ftl_get_io_channel(ftl_bdev->shard[0].dev);
+}
+
+static int
+bdev_ftl_io_channel_create_cb(void *io_device, void *ctx_buf)
+{
+	struct ftl_bdev *ftl_bdev = io_device;
+	struct ftl_bdev_io_channel *ftl_ch = ctx_buf;
+	size_t i;
+
+	for (i = 0; i < ftl_bdev->num_shards; i++) {
+		ftl_ch->shard_ch[i] = spdk_ftl_get_io_channel(ftl_bdev->shard[i].dev);
+		if (!ftl_ch->shard_ch[i]) {
+			SPDK_ERRLOG("Failed to get IO channel of %s shard %zu\n",
+				    ftl_bdev->bdev.name, i);
+			while (i-- > 0) {
+				spdk_put_io_channel(ftl_ch->shard_ch[i]);
+			}
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void
+bdev_ftl_io_channel_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct ftl_bdev *ftl_bdev = io_device;
+	struct ftl_bdev_io_channel *ftl_ch = ctx_buf;
+	size_t i;
+
+	for (i = 0; i < ftl_bdev->num_shards; i++) {
+		spdk_put_io_channel(ftl_ch->shard_ch[i]);
+	}
 }
 
 static void
@@ -197,8 +476,9 @@ bdev_ftl_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w
 	struct ftl_bdev *ftl_bdev = bdev->ctxt;
 	struct spdk_ftl_conf conf;
 	char uuid[SPDK_UUID_STRING_LEN];
+	size_t i;
 
-	spdk_ftl_dev_get_conf(ftl_bdev->dev, &conf, sizeof(conf));
+	spdk_ftl_dev_get_conf(ftl_bdev->shard[0].dev, &conf, sizeof(conf));
 
 	spdk_json_write_object_begin(w);
 
@@ -219,12 +499,40 @@ bdev_ftl_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w
 
 	spdk_json_write_named_bool(w, "fast_shutdown", conf.fast_shutdown);
 
+	spdk_json_write_named_string(w, "gc_policy", bdev_ftl_gc_policy_name(conf.gc_policy));
+
+	spdk_json_write_named_string(w, "l2p_evict_policy",
+				     bdev_ftl_l2p_evict_policy_name(conf.l2p_evict_policy));
+
+	spdk_json_write_named_uint32(w, "wr_cache_blocks", conf.wr_cache_blocks);
+
 	spdk_json_write_named_string(w, "base_bdev", conf.base_bdev);
 
 	if (conf.cache_bdev) {
 		spdk_json_write_named_string(w, "cache", conf.cache_bdev);
 	}
 
+	if (ftl_bdev->num_shards > 1) {
+		spdk_json_write_named_uint32(w, "shard_stripe_mib",
+					     ftl_bdev->conf.shard_stripe_mib);
+
+		spdk_json_write_named_array_begin(w, "shards");
+		for (i = 1; i < ftl_bdev->num_shards; i++) {
+			spdk_ftl_dev_get_conf(ftl_bdev->shard[i].dev, &conf, sizeof(conf));
+
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "base_bdev", conf.base_bdev);
+			spdk_json_write_named_string(w, "cache", conf.cache_bdev);
+			spdk_uuid_fmt_lower(uuid, sizeof(uuid), &conf.uuid);
+			spdk_json_write_named_string(w, "uuid", uuid);
+			if (conf.core_mask) {
+				spdk_json_write_named_string(w, "core_mask", conf.core_mask);
+			}
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_array_end(w);
+	}
+
 	spdk_json_write_object_end(w);
 	spdk_json_write_object_end(w);
 }
@@ -233,11 +541,10 @@ static int
 bdev_ftl_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 {
 	struct ftl_bdev *ftl_bdev = ctx;
-	struct spdk_ftl_attrs attrs;
 	struct spdk_ftl_conf conf;
+	size_t i;
 
-	spdk_ftl_dev_get_attrs(ftl_bdev->dev, &attrs, sizeof(attrs));
-	spdk_ftl_dev_get_conf(ftl_bdev->dev, &conf, sizeof(conf));
+	spdk_ftl_dev_get_conf(ftl_bdev->shard[0].dev, &conf, sizeof(conf));
 
 	spdk_json_write_named_object_begin(w, "ftl");
 
@@ -247,6 +554,21 @@ bdev_ftl_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 		spdk_json_write_named_string(w, "cache", conf.cache_bdev);
 	}
 
+	if (ftl_bdev->num_shards > 1) {
+		spdk_json_write_named_uint64(w, "shard_stripe_blocks", ftl_bdev->stripe_blocks);
+
+		spdk_json_write_named_array_begin(w, "shards");
+		for (i = 0; i < ftl_bdev->num_shards; i++) {
+			spdk_ftl_dev_get_conf(ftl_bdev->shard[i].dev, &conf, sizeof(conf));
+
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "base_bdev", conf.base_bdev);
+			spdk_json_write_named_string(w, "cache", conf.cache_bdev);
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_array_end(w);
+	}
+
 	/* ftl */
 	spdk_json_write_object_end(w);
 
@@ -276,54 +598,144 @@ bdev_ftl_create_err_complete(struct ftl_bdev *ftl_bdev)
 }
 
 static void
-bdev_ftl_create_err_cleanup_cb(void *ctx, int status)
+bdev_ftl_create_err(struct ftl_bdev *ftl_bdev)
 {
-	struct ftl_bdev *ftl_bdev = ctx;
+	size_t i;
 
-	if (status) {
-		SPDK_ERRLOG("Fatal ERROR of FTL cleanup, name %s\n", ftl_bdev->bdev.name);
+	/* FTL devices were created, but we have got an error, so we need to delete them */
+	for (i = 0; i < ftl_bdev->num_shards_ready; i++) {
+		spdk_ftl_dev_set_fast_shutdown(ftl_bdev->shard[i].dev, false);
 	}
 
-	bdev_ftl_create_err_complete(ftl_bdev);
+	bdev_ftl_release(ftl_bdev, bdev_ftl_create_err_complete);
 }
 
-static void
-bdev_ftl_create_cb(struct spdk_ftl_dev *dev, void *ctx, int status)
+static int
+bdev_ftl_register(struct ftl_bdev *ftl_bdev)
 {
-	struct ftl_bdev		*ftl_bdev = ctx;
-	struct ftl_bdev_info	info = {};
-	struct spdk_ftl_attrs	attrs;
+	struct spdk_ftl_attrs	attrs, shard_attrs;
 	struct spdk_ftl_conf	conf;
-	ftl_bdev_init_fn	init_cb = ftl_bdev->init_cb;
-	void			*init_arg = ftl_bdev->init_arg;
+	uint64_t		shard_blocks, optimum_io_size;
+	size_t			i;
+	int			rc;
 
-	if (status) {
-		SPDK_ERRLOG("Failed to create FTL device (%d)\n", status);
-		ftl_bdev->rc = status;
-		goto error;
-	}
+	spdk_ftl_dev_get_attrs(ftl_bdev->shard[0].dev, &attrs, sizeof(attrs));
+	spdk_ftl_dev_get_conf(ftl_bdev->shard[0].dev, &conf, sizeof(conf));
+
+	shard_blocks = attrs.num_blocks;
+	optimum_io_size = attrs.optimum_io_size;
+
+	if (ftl_bdev->num_shards > 1) {
+		ftl_bdev->stripe_blocks = (uint64_t)ftl_bdev->conf.shard_stripe_mib * 1024 * 1024 /
+					  attrs.block_size;
 
-	spdk_ftl_dev_get_attrs(dev, &attrs, sizeof(attrs));
-	spdk_ftl_dev_get_conf(dev, &conf, sizeof(conf));
+		for (i = 0; i < ftl_bdev->num_shards; i++) {
+			spdk_ftl_dev_get_attrs(ftl_bdev->shard[i].dev, &shard_attrs,
+					       sizeof(shard_attrs));
+
+			if (shard_attrs.block_size != attrs.block_size) {
+				SPDK_ERRLOG("Block size of %s shards doesn't match\n",
+					    ftl_bdev->bdev.name);
+				return -EINVAL;
+			}
+
+			if (ftl_bdev->stripe_blocks == 0 ||
+			    ftl_bdev->stripe_blocks % shard_attrs.optimum_io_size) {
+				SPDK_ERRLOG("Shard stripe of %s must be a multiple of %"PRIu64" blocks\n",
+					    ftl_bdev->bdev.name, shard_attrs.optimum_io_size);
+				return -EINVAL;
+			}
+
+			shard_blocks = spdk_min(shard_blocks, shard_attrs.num_blocks);
+			optimum_io_size = spdk_max(optimum_io_size, shard_attrs.optimum_io_size);
+		}
+
+		/* Only whole stripes are exposed, every shard gets the same number of them */
+		shard_blocks -= shard_blocks % ftl_bdev->stripe_blocks;
+		if (shard_blocks == 0) {
+			SPDK_ERRLOG("Shards of %s are smaller than the stripe\n",
+				    ftl_bdev->bdev.name);
+			return -EINVAL;
+		}
+
+		spdk_io_device_register(ftl_bdev, bdev_ftl_io_channel_create_cb,
+					bdev_ftl_io_channel_destroy_cb,
+					sizeof(struct ftl_bdev_io_channel), ftl_bdev->bdev.name);
+		ftl_bdev->io_device_registered = true;
+	}
 
-	ftl_bdev->dev = dev;
 	ftl_bdev->bdev.product_name = "FTL disk";
 	ftl_bdev->bdev.write_cache = 0;
 	ftl_bdev->bdev.blocklen = attrs.block_size;
-	ftl_bdev->bdev.blockcnt = attrs.num_blocks;
+	ftl_bdev->bdev.blockcnt = shard_blocks * ftl_bdev->num_shards;
 	ftl_bdev->bdev.uuid = conf.uuid;
-	ftl_bdev->bdev.optimal_io_boundary = attrs.optimum_io_size;
+	ftl_bdev->bdev.optimal_io_boundary = optimum_io_size;
 	ftl_bdev->bdev.split_on_optimal_io_boundary = true;
 
 	SPDK_DEBUGLOG(bdev_ftl, "Creating bdev %s:\n", ftl_bdev->bdev.name);
 	SPDK_DEBUGLOG(bdev_ftl, "\tblock_len:\t%zu\n", attrs.block_size);
-	SPDK_DEBUGLOG(bdev_ftl, "\tnum_blocks:\t%"PRIu64"\n", attrs.num_blocks);
+	SPDK_DEBUGLOG(bdev_ftl, "\tnum_blocks:\t%"PRIu64"\n", ftl_bdev->bdev.blockcnt);
+	SPDK_DEBUGLOG(bdev_ftl, "\tnum_shards:\t%zu\n", ftl_bdev->num_shards);
 
 	ftl_bdev->bdev.ctxt = ftl_bdev;
 	ftl_bdev->bdev.fn_table = &ftl_fn_table;
 	ftl_bdev->bdev.module = &g_ftl_if;
 
-	status = spdk_bdev_register(&ftl_bdev->bdev);
+	rc = spdk_bdev_register(&ftl_bdev->bdev);
+	if (rc) {
+		return rc;
+	}
+
+	return 0;
+}
+
+static void bdev_ftl_create_cb(struct spdk_ftl_dev *dev, void *ctx, int status);
+
+static int
+bdev_ftl_create_shard(struct ftl_bdev *ftl_bdev)
+{
+	return spdk_ftl_dev_init(&ftl_bdev->conf.shard[ftl_bdev->num_shards_ready],
+				 bdev_ftl_create_cb, ftl_bdev);
+}
+
+static void
+bdev_ftl_create_cb(struct spdk_ftl_dev *dev, void *ctx, int status)
+{
+	struct ftl_bdev		*ftl_bdev = ctx;
+	struct ftl_bdev_info	info = {};
+	struct spdk_ftl_conf	conf;
+	size_t			i;
+
+	if (status) {
+		SPDK_ERRLOG("Failed to create FTL device (%d)\n", status);
+		ftl_bdev->rc = status;
+		goto error;
+	}
+
+	/* Shards are initialized one after another */
+	ftl_bdev->shard[ftl_bdev->num_shards_ready++].dev = dev;
+	if (ftl_bdev->num_shards_ready < ftl_bdev->num_shards) {
+		/*
+		 * The set is identified by the UUID of its first shard (the bdev's one), which
+		 * is only known once that shard is up, as it's generated when creating it.
+		 */
+		if (ftl_bdev->num_shards_ready == 1) {
+			spdk_ftl_dev_get_conf(dev, &conf, sizeof(conf));
+			for (i = 1; i < ftl_bdev->num_shards; i++) {
+				ftl_bdev->conf.shard[i].shard.set_uuid = conf.uuid;
+			}
+		}
+
+		status = bdev_ftl_create_shard(ftl_bdev);
+		if (status) {
+			SPDK_ERRLOG("Could not create FTL device\n");
+			ftl_bdev->rc = status;
+			goto error;
+		}
+		return;
+	}
+
+	status = bdev_ftl_register(ftl_bdev);
 	if (status) {
 		ftl_bdev->rc = status;
 		goto error;
@@ -332,30 +744,55 @@ bdev_ftl_create_cb(struct spdk_ftl_dev *dev, void *ctx, int status)
 	info.name = ftl_bdev->bdev.name;
 	info.uuid = ftl_bdev->bdev.uuid;
 
-	init_cb(&info, init_arg, 0);
+	ftl_bdev->init_cb(&info, ftl_bdev->init_arg, 0);
 	return;
 
 error:
-	if (ftl_bdev->dev) {
-		/* Cleanup all FTL */
-		spdk_ftl_dev_set_fast_shutdown(ftl_bdev->dev, false);
-
-		/* FTL was created, but we have got an error, so we need to delete it */
-		spdk_ftl_dev_free(dev, bdev_ftl_create_err_cleanup_cb, ftl_bdev);
-	} else {
-		bdev_ftl_create_err_complete(ftl_bdev);
-	}
+	bdev_ftl_create_err(ftl_bdev);
 }
 
 static void
 bdev_ftl_defer_free(struct ftl_deferred_init *init)
 {
-	spdk_ftl_conf_deinit(&init->conf);
+	bdev_ftl_conf_deinit(&init->conf);
 	free(init);
 }
 
 int
-bdev_ftl_defer_init(const struct spdk_ftl_conf *conf)
+bdev_ftl_conf_copy(struct ftl_bdev_conf *dst, const struct ftl_bdev_conf *src)
+{
+	size_t i;
+	int rc;
+
+	for (i = 0; i < src->num_shards; i++) {
+		rc = spdk_ftl_conf_copy(&dst->shard[i], &src->shard[i]);
+		if (rc) {
+			while (i-- > 0) {
+				spdk_ftl_conf_deinit(&dst->shard[i]);
+			}
+			return rc;
+		}
+	}
+
+	dst->num_shards = src->num_shards;
+	dst->shard_stripe_mib = src->shard_stripe_mib;
+
+	return 0;
+}
+
+void
+bdev_ftl_conf_deinit(struct ftl_bdev_conf *conf)
+{
+	size_t i;
+
+	/* Unused entries are zeroed, this also releases partially decoded configurations */
+	for (i = 0; i < SPDK_COUNTOF(conf->shard); i++) {
+		spdk_ftl_conf_deinit(&conf->shard[i]);
+	}
+}
+
+int
+bdev_ftl_defer_init(const struct ftl_bdev_conf *conf)
 {
 	struct ftl_deferred_init *init;
 	int rc;
@@ -365,7 +802,7 @@ bdev_ftl_defer_init(const struct spdk_ftl_conf *conf)
 		return -ENOMEM;
 	}
 
-	rc = spdk_ftl_conf_copy(&init->conf, conf);
+	rc = bdev_ftl_conf_copy(&init->conf, conf);
 	if (rc) {
 		free(init);
 		return -ENOMEM;
@@ -382,45 +819,74 @@ bdev_ftl_create_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *
 }
 
 int
-bdev_ftl_create_bdev(const struct spdk_ftl_conf *conf, ftl_bdev_init_fn cb, void *cb_arg)
+bdev_ftl_create_bdev(const struct ftl_bdev_conf *conf, ftl_bdev_init_fn cb, void *cb_arg)
 {
 	struct ftl_bdev *ftl_bdev;
-	struct spdk_bdev_desc *base_bdev_desc, *cache_bdev_desc;
+	struct spdk_bdev_desc *base_bdev_desc[FTL_BDEV_MAX_SHARDS] = {};
+	struct spdk_bdev_desc *cache_bdev_desc[FTL_BDEV_MAX_SHARDS] = {};
+	size_t i;
 	int rc;
 
-	rc = spdk_bdev_open_ext(conf->base_bdev, false, bdev_ftl_create_bdev_event_cb, NULL,
-				&base_bdev_desc);
-	if (rc) {
-		return rc;
+	if (conf->num_shards == 0 || conf->num_shards > FTL_BDEV_MAX_SHARDS) {
+		return -EINVAL;
 	}
-	rc = spdk_bdev_open_ext(conf->cache_bdev, false, bdev_ftl_create_bdev_event_cb, NULL,
-				&cache_bdev_desc);
-	if (rc) {
-		spdk_bdev_close(base_bdev_desc);
-		return rc;
+
+	if (conf->num_shards > 1 && conf->shard_stripe_mib == 0) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < conf->num_shards; i++) {
+		rc = spdk_bdev_open_ext(conf->shard[i].base_bdev, false,
+					bdev_ftl_create_bdev_event_cb, NULL, &base_bdev_desc[i]);
+		if (rc) {
+			bdev_ftl_close_shards(base_bdev_desc, cache_bdev_desc, i);
+			return rc;
+		}
+		rc = spdk_bdev_open_ext(conf->shard[i].cache_bdev, false,
+					bdev_ftl_create_bdev_event_cb, NULL, &cache_bdev_desc[i]);
+		if (rc) {
+			bdev_ftl_close_shards(base_bdev_desc, cache_bdev_desc, i + 1);
+			return rc;
+		}
 	}
 
 	ftl_bdev = calloc(1, sizeof(*ftl_bdev));
 	if (!ftl_bdev) {
 		SPDK_ERRLOG("Could not allocate ftl_bdev\n");
-		spdk_bdev_close(base_bdev_desc);
-		spdk_bdev_close(cache_bdev_desc);
+		bdev_ftl_close_shards(base_bdev_desc, cache_bdev_desc, conf->num_shards);
 		return -ENOMEM;
 	}
 
-	ftl_bdev->base_bdev_desc = base_bdev_desc;
-	ftl_bdev->cache_bdev_desc = cache_bdev_desc;
+	ftl_bdev->num_shards = conf->num_shards;
+	for (i = 0; i < conf->num_shards; i++) {
+		ftl_bdev->shard[i].base_bdev_desc = base_bdev_desc[i];
+		ftl_bdev->shard[i].cache_bdev_desc = cache_bdev_desc[i];
+	}
 
-	ftl_bdev->bdev.name = strdup(conf->name);
+	ftl_bdev->bdev.name = strdup(conf->shard[0].name);
 	if (!ftl_bdev->bdev.name) {
 		rc = -ENOMEM;
 		goto error;
 	}
 
+	rc = bdev_ftl_conf_copy(&ftl_bdev->conf, conf);
+	if (rc) {
+		goto error;
+	}
+
+	/* Each shard records its place in the set, so that it can't be loaded in another one */
+	if (conf->num_shards > 1) {
+		for (i = 0; i < conf->num_shards; i++) {
+			ftl_bdev->conf.shard[i].shard.idx = i;
+			ftl_bdev->conf.shard[i].shard.count = conf->num_shards;
+			ftl_bdev->conf.shard[i].shard.stripe_mib = conf->shard_stripe_mib;
+		}
+	}
+
 	ftl_bdev->init_cb = cb;
 	ftl_bdev->init_arg = cb_arg;
 
-	rc = spdk_ftl_dev_init(conf, bdev_ftl_create_cb, ftl_bdev);
+	rc = bdev_ftl_create_shard(ftl_bdev);
 	if (rc) {
 		SPDK_ERRLOG("Could not create FTL device\n");
 		goto error;
@@ -451,6 +917,7 @@ bdev_ftl_delete_bdev(const char *name, bool fast_shutdown, spdk_bdev_unregister_
 	struct spdk_bdev_desc	*ftl_bdev_desc;
 	struct spdk_bdev *bdev;
 	struct ftl_bdev *ftl;
+	size_t i;
 	int rc;
 
 	rc = spdk_bdev_open_ext(name, false, bdev_ftl_event_cb, NULL, &ftl_bdev_desc);
@@ -467,7 +934,9 @@ bdev_ftl_delete_bdev(const char *name, bool fast_shutdown, spdk_bdev_unregister_
 
 	ftl = bdev->ctxt;
 	assert(ftl);
-	spdk_ftl_dev_set_fast_shutdown(ftl->dev, fast_shutdown);
+	for (i = 0; i < ftl->num_shards; i++) {
+		spdk_ftl_dev_set_fast_shutdown(ftl->shard[i].dev, fast_shutdown);
+	}
 	spdk_bdev_close(ftl_bdev_desc);
 
 	rc = spdk_bdev_unregister_by_name(name, &g_ftl_if, cb_fn, cb_arg);
@@ -532,8 +1001,19 @@ bdev_ftl_unmap(const char *name, uint64_t lba, uint64_t num_blocks, spdk_ftl_fn
 
 	ftl = bdev->ctxt;
 	assert(ftl);
-	/* It's ok to pass NULL as IO channel - FTL will detect this and use it's internal IO channel for management operations */
-	rc = spdk_ftl_unmap(ftl->dev, NULL, NULL, lba, num_blocks, bdev_ftl_unmap_cb, ctx);
+	if (ftl->num_shards > 1) {
+		if (num_blocks == 0 || lba + num_blocks < lba ||
+		    lba + num_blocks > bdev->blockcnt) {
+			rc = -EINVAL;
+			goto ctx_allocated;
+		}
+
+		rc = bdev_ftl_unmap_shards(ftl, NULL, lba, num_blocks, bdev_ftl_unmap_cb, ctx);
+	} else {
+		/* It's ok to pass NULL as IO channel - FTL will detect this and use it's internal IO channel for management operations */
+		rc = spdk_ftl_unmap(ftl->shard[0].dev, NULL, NULL, lba, num_blocks,
+				    bdev_ftl_unmap_cb, ctx);
+	}
 
 	if (rc) {
 		goto ctx_allocated;
@@ -549,7 +1029,68 @@ not_found:
 }
 
 static void
-bdev_ftl_get_stats_cb(struct ftl_stats *stats, void *ctx)
+bdev_ftl_stats_group_add(struct ftl_stats_group *dst, const struct ftl_stats_group *src)
+{
+	dst->ios += src->ios;
+	dst->blocks += src->blocks;
+	dst->errors.media += src->errors.media;
+	dst->errors.crc += src->errors.crc;
+	dst->errors.other += src->errors.other;
+}
+
+static void
+bdev_ftl_stats_latency_add(struct ftl_stats_latency *dst, const struct ftl_stats_latency *src)
+{
+	size_t i;
+
+	dst->count += src->count;
+	dst->blocks += src->blocks;
+	dst->total_us += src->total_us;
+	dst->max_us = spdk_max(dst->max_us, src->max_us);
+
+	for (i = 0; i < FTL_STATS_LATENCY_BUCKETS; i++) {
+		dst->buckets[i] += src->buckets[i];
+	}
+}
+
+static void
+bdev_ftl_stats_add(struct ftl_stats *dst, const struct ftl_stats *src)
+{
+	size_t i;
+
+	for (i = 0; i < SPDK_FTL_LIMIT_MAX; i++) {
+		dst->limits[i] += src->limits[i];
+	}
+
+	dst->io_activity_total += src->io_activity_total;
+
+	for (i = 0; i < FTL_STATS_TYPE_MAX; i++) {
+		bdev_ftl_stats_group_add(&dst->entries[i].read, &src->entries[i].read);
+		bdev_ftl_stats_group_add(&dst->entries[i].write, &src->entries[i].write);
+	}
+
+	dst->gc.bands += src->gc.bands;
+	dst->gc.valid_blocks += src->gc.valid_blocks;
+
+	for (i = 0; i < FTL_STATS_STAGE_MAX; i++) {
+		bdev_ftl_stats_latency_add(&dst->latency[i], &src->latency[i]);
+	}
+
+	dst->l2p_cache.hits += src->l2p_cache.hits;
+	dst->l2p_cache.misses += src->l2p_cache.misses;
+
+	dst->nv_cache.chunks_total += src->nv_cache.chunks_total;
+	dst->nv_cache.chunks_free += src->nv_cache.chunks_free;
+	dst->nv_cache.chunks_open += src->nv_cache.chunks_open;
+	dst->nv_cache.chunks_full += src->nv_cache.chunks_full;
+	dst->nv_cache.chunks_compacting += src->nv_cache.chunks_compacting;
+
+	dst->wr_cache.hits += src->wr_cache.hits;
+	dst->wr_cache.misses += src->wr_cache.misses;
+}
+
+static void
+bdev_ftl_get_stats_done(void *ctx)
 {
 	struct rpc_ftl_stats_ctx *ftl_stats_ctx = ctx;
 
@@ -559,6 +1100,36 @@ bdev_ftl_get_stats_cb(struct ftl_stats *stats, void *ctx)
 	free(ftl_stats_ctx);
 }
 
+/*
+ * Called on the core thread of each shard in turn, the statistics of the shards are
+ * summed up and reported back on the thread which requested them.
+ */
+static void
+bdev_ftl_get_stats_cb(struct ftl_stats *stats, void *ctx)
+{
+	struct rpc_ftl_stats_ctx *ftl_stats_ctx = ctx;
+	struct ftl_bdev *ftl = spdk_bdev_desc_get_bdev(ftl_stats_ctx->ftl_bdev_desc)->ctxt;
+	int rc;
+
+	bdev_ftl_stats_add(ftl_stats_ctx->ftl_stats, stats);
+
+	if (++ftl_stats_ctx->shard_idx < ftl->num_shards) {
+		rc = spdk_ftl_get_stats(ftl->shard[ftl_stats_ctx->shard_idx].dev,
+					&ftl_stats_ctx->shard_stats, bdev_ftl_get_stats_cb,
+					ftl_stats_ctx);
+		if (!rc) {
+			return;
+		}
+
+		SPDK_ERRLOG("Failed to get stats of %s shard %zu (%d)\n", ftl->bdev.name,
+			    ftl_stats_ctx->shard_idx, rc);
+		/* Don't report the sums of the other shards as the bdev's statistics */
+		ftl_stats_ctx->status = rc;
+	}
+
+	spdk_thread_send_msg(ftl_stats_ctx->thread, bdev_ftl_get_stats_done, ftl_stats_ctx);
+}
+
 
 int
 bdev_ftl_get_stats(const char *name, ftl_bdev_thread_fn cb, struct spdk_jsonrpc_request *request,
@@ -593,8 +1164,10 @@ bdev_ftl_get_stats(const char *name, ftl_bdev_thread_fn cb, struct spdk_jsonrpc_
 	ftl_stats_ctx->ftl_bdev_desc = ftl_bdev_desc;
 	ftl_stats_ctx->cb = cb;
 	ftl_stats_ctx->ftl_stats = stats;
+	ftl_stats_ctx->thread = spdk_get_thread();
 
-	rc = spdk_ftl_get_stats(ftl->dev, stats, bdev_ftl_get_stats_cb, ftl_stats_ctx);
+	rc = spdk_ftl_get_stats(ftl->shard[0].dev, &ftl_stats_ctx->shard_stats,
+				bdev_ftl_get_stats_cb, ftl_stats_ctx);
 	if (rc) {
 		goto stats_allocated;
 	}
@@ -608,6 +1181,26 @@ not_found:
 	return rc;
 }
 
+const char *
+bdev_ftl_gc_policy_name(uint32_t gc_policy)
+{
+	if (gc_policy >= SPDK_FTL_GC_POLICY_MAX) {
+		return NULL;
+	}
+
+	return g_gc_policy_names[gc_policy];
+}
+
+const char *
+bdev_ftl_l2p_evict_policy_name(uint32_t l2p_evict_policy)
+{
+	if (l2p_evict_policy >= SPDK_FTL_L2P_EVICT_MAX) {
+		return NULL;
+	}
+
+	return g_l2p_evict_policy_names[l2p_evict_policy];
+}
+
 static void
 bdev_ftl_finish(void)
 {
@@ -620,7 +1213,7 @@ bdev_ftl_create_defered_cb(const struct ftl_bdev_info *info, void *ctx, int stat
 	struct ftl_deferred_init *opts = ctx;
 
 	if (status) {
-		SPDK_ERRLOG("Failed to initialize FTL bdev '%s'\n", opts->conf.name);
+		SPDK_ERRLOG("Failed to initialize FTL bdev '%s'\n", opts->conf.shard[0].name);
 	}
 
 	bdev_ftl_defer_free(opts);
@@ -12,6 +12,26 @@
 
 #include "ftl_core.h"
 
+/* Maximum number of FTL devices a single FTL bdev can be sharded across */
+#define FTL_BDEV_MAX_SHARDS			32
+/* Default size of the LBA stripe routed to the same shard */
+#define FTL_BDEV_DEFAULT_SHARD_STRIPE_MIB	4
+
+struct ftl_bdev_conf {
+	/*
+	 * Configuration of each FTL device backing the bdev. The first shard's name and UUID
+	 * are the ones of the bdev itself, the remaining shards inherit its settings and only
+	 * differ in base/cache bdevs, UUID and core mask.
+	 */
+	struct spdk_ftl_conf	shard[FTL_BDEV_MAX_SHARDS];
+
+	/* Number of valid entries in shard[] */
+	size_t			num_shards;
+
+	/* LBA space is striped across the shards in chunks of this size */
+	uint32_t		shard_stripe_mib;
+};
+
 struct ftl_bdev_info {
 	const char		*name;
 	struct spdk_uuid	uuid;
@@ -24,17 +44,27 @@ struct rpc_ftl_stats_ctx {
 	ftl_bdev_thread_fn		cb;
 	struct spdk_jsonrpc_request	*request;
 	struct ftl_stats		*ftl_stats;
+	/* Statistics of a single shard, summed up into ftl_stats */
+	struct ftl_stats		shard_stats;
+	size_t				shard_idx;
+	/* Error of getting the statistics of one of the shards, stats are only valid if 0 */
+	int				status;
+	struct spdk_thread		*thread;
 };
 
 typedef void (*ftl_bdev_init_fn)(const struct ftl_bdev_info *, void *, int);
 
-int bdev_ftl_create_bdev(const struct spdk_ftl_conf *conf, ftl_bdev_init_fn cb, void *cb_arg);
+int bdev_ftl_create_bdev(const struct ftl_bdev_conf *conf, ftl_bdev_init_fn cb, void *cb_arg);
 void bdev_ftl_delete_bdev(const char *name, bool fast_shutdown, spdk_bdev_unregister_cb cb_fn,
 			  void *cb_arg);
-int bdev_ftl_defer_init(const struct spdk_ftl_conf *conf);
+int bdev_ftl_defer_init(const struct ftl_bdev_conf *conf);
+int bdev_ftl_conf_copy(struct ftl_bdev_conf *dst, const struct ftl_bdev_conf *src);
+void bdev_ftl_conf_deinit(struct ftl_bdev_conf *conf);
 void bdev_ftl_unmap(const char *name, uint64_t lba, uint64_t num_blocks, spdk_ftl_fn cb_fn,
 		    void *cb_arg);
 int bdev_ftl_get_stats(const char *name, ftl_bdev_thread_fn cb,
 		       struct spdk_jsonrpc_request *request, struct ftl_stats *stats);
+const char *bdev_ftl_gc_policy_name(uint32_t gc_policy);
+const char *bdev_ftl_l2p_evict_policy_name(uint32_t l2p_evict_policy);
 
 #endif /* SPDK_BDEV_FTL_H */
@@ -28,29 +28,148 @@ rpc_bdev_ftl_decode_uuid(const struct spdk_json_val *val, void *out)
 	return ret;
 }
 
-static const struct spdk_json_object_decoder rpc_bdev_ftl_create_decoders[] = {
-	{"name", offsetof(struct spdk_ftl_conf, name), spdk_json_decode_string},
+static int
+rpc_bdev_ftl_decode_gc_policy(const struct spdk_json_val *val, void *out)
+{
+	uint32_t *gc_policy = out;
+	uint32_t i;
+
+	for (i = 0; i < SPDK_FTL_GC_POLICY_MAX; i++) {
+		if (spdk_json_strequal(val, bdev_ftl_gc_policy_name(i))) {
+			*gc_policy = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int
+rpc_bdev_ftl_decode_l2p_evict_policy(const struct spdk_json_val *val, void *out)
+{
+	uint32_t *l2p_evict_policy = out;
+	uint32_t i;
+
+	for (i = 0; i < SPDK_FTL_L2P_EVICT_MAX; i++) {
+		if (spdk_json_strequal(val, bdev_ftl_l2p_evict_policy_name(i))) {
+			*l2p_evict_policy = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_ftl_shard_decoders[] = {
 	{"base_bdev", offsetof(struct spdk_ftl_conf, base_bdev), spdk_json_decode_string},
-	{"uuid", offsetof(struct spdk_ftl_conf, uuid), rpc_bdev_ftl_decode_uuid, true},
 	{"cache", offsetof(struct spdk_ftl_conf, cache_bdev), spdk_json_decode_string},
+	{"uuid", offsetof(struct spdk_ftl_conf, uuid), rpc_bdev_ftl_decode_uuid, true},
+	{"core_mask", offsetof(struct spdk_ftl_conf, core_mask), spdk_json_decode_string, true},
+};
+
+static int
+rpc_bdev_ftl_decode_shard(const struct spdk_json_val *val, void *out)
+{
+	return spdk_json_decode_object(val, rpc_bdev_ftl_shard_decoders,
+				       SPDK_COUNTOF(rpc_bdev_ftl_shard_decoders), out);
+}
+
+static int
+rpc_bdev_ftl_decode_shards(const struct spdk_json_val *val, void *out)
+{
+	struct ftl_bdev_conf *conf = out;
+	size_t num_shards = 0;
+	int rc;
+
+	/* The first shard is described by the top level parameters */
+	rc = spdk_json_decode_array(val, rpc_bdev_ftl_decode_shard, &conf->shard[1],
+				    FTL_BDEV_MAX_SHARDS - 1, &num_shards, sizeof(conf->shard[0]));
+	conf->num_shards = 1 + num_shards;
+
+	return rc;
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_ftl_create_decoders[] = {
+	{"name", offsetof(struct ftl_bdev_conf, shard[0].name), spdk_json_decode_string},
+	{"base_bdev", offsetof(struct ftl_bdev_conf, shard[0].base_bdev), spdk_json_decode_string},
+	{"uuid", offsetof(struct ftl_bdev_conf, shard[0].uuid), rpc_bdev_ftl_decode_uuid, true},
+	{"cache", offsetof(struct ftl_bdev_conf, shard[0].cache_bdev), spdk_json_decode_string},
 	{
-		"overprovisioning", offsetof(struct spdk_ftl_conf, overprovisioning),
+		"overprovisioning", offsetof(struct ftl_bdev_conf, shard[0].overprovisioning),
 		spdk_json_decode_uint64, true
 	},
 	{
-		"l2p_dram_limit", offsetof(struct spdk_ftl_conf, l2p_dram_limit),
+		"l2p_dram_limit", offsetof(struct ftl_bdev_conf, shard[0].l2p_dram_limit),
 		spdk_json_decode_uint64, true
 	},
 	{
-		"core_mask", offsetof(struct spdk_ftl_conf, core_mask),
+		"core_mask", offsetof(struct ftl_bdev_conf, shard[0].core_mask),
 		spdk_json_decode_string, true
 	},
 	{
-		"fast_shutdown", offsetof(struct spdk_ftl_conf, fast_shutdown),
+		"fast_shutdown", offsetof(struct ftl_bdev_conf, shard[0].fast_shutdown),
 		spdk_json_decode_bool, true
 	},
+	{
+		"gc_policy", offsetof(struct ftl_bdev_conf, shard[0].gc_policy),
+		rpc_bdev_ftl_decode_gc_policy, true
+	},
+	{
+		"l2p_evict_policy", offsetof(struct ftl_bdev_conf, shard[0].l2p_evict_policy),
+		rpc_bdev_ftl_decode_l2p_evict_policy, true
+	},
+	{
+		"wr_cache_blocks", offsetof(struct ftl_bdev_conf, shard[0].wr_cache_blocks),
+		spdk_json_decode_uint32, true
+	},
+	{"shards", 0, rpc_bdev_ftl_decode_shards, true},
+	{
+		"shard_stripe_mib", offsetof(struct ftl_bdev_conf, shard_stripe_mib),
+		spdk_json_decode_uint32, true
+	},
 };
 
+/*
+ * Additional shards inherit the settings of the first one, only their bdevs, UUID and
+ * core mask are given explicitly.
+ */
+static int
+rpc_bdev_ftl_init_shards(struct ftl_bdev_conf *conf)
+{
+	struct spdk_ftl_conf *shard;
+	size_t i;
+
+	for (i = 0; i < conf->num_shards; i++) {
+		shard = &conf->shard[i];
+
+		if (spdk_mem_all_zero(&shard->uuid, sizeof(shard->uuid))) {
+			shard->mode |= SPDK_FTL_MODE_CREATE;
+		}
+
+		if (i == 0) {
+			continue;
+		}
+
+		shard->name = spdk_sprintf_alloc("%s_shard%zu", conf->shard[0].name, i);
+		if (!shard->name) {
+			return -ENOMEM;
+		}
+
+		shard->overprovisioning = conf->shard[0].overprovisioning;
+		shard->l2p_dram_limit = conf->shard[0].l2p_dram_limit;
+		shard->user_io_pool_size = conf->shard[0].user_io_pool_size;
+		memcpy(shard->limits, conf->shard[0].limits, sizeof(shard->limits));
+		shard->nv_cache = conf->shard[0].nv_cache;
+		shard->fast_shutdown = conf->shard[0].fast_shutdown;
+		shard->gc_policy = conf->shard[0].gc_policy;
+		shard->l2p_evict_policy = conf->shard[0].l2p_evict_policy;
+		shard->wr_cache_blocks = conf->shard[0].wr_cache_blocks;
+		shard->conf_size = conf->shard[0].conf_size;
+	}
+
+	return 0;
+}
+
 static void
 rpc_bdev_ftl_create_cb(const struct ftl_bdev_info *bdev_info, void *ctx, int status)
 {
@@ -78,41 +197,54 @@ static void
 rpc_bdev_ftl_create(struct spdk_jsonrpc_request *request,
 		    const struct spdk_json_val *params)
 {
-	struct spdk_ftl_conf conf = {};
+	struct ftl_bdev_conf *conf;
 	struct spdk_json_write_ctx *w;
 	int rc;
 
-	spdk_ftl_get_default_conf(&conf, sizeof(conf));
+	conf = calloc(1, sizeof(*conf));
+	if (!conf) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(ENOMEM));
+		return;
+	}
+
+	spdk_ftl_get_default_conf(&conf->shard[0], sizeof(conf->shard[0]));
+	conf->num_shards = 1;
+	conf->shard_stripe_mib = FTL_BDEV_DEFAULT_SHARD_STRIPE_MIB;
 
 	if (spdk_json_decode_object(params, rpc_bdev_ftl_create_decoders,
 				    SPDK_COUNTOF(rpc_bdev_ftl_create_decoders),
-				    &conf)) {
+				    conf)) {
 		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
 						 "Invalid parameters");
 		goto out;
 	}
 
-	if (spdk_mem_all_zero(&conf.uuid, sizeof(conf.uuid))) {
-		conf.mode |= SPDK_FTL_MODE_CREATE;
+	rc = rpc_bdev_ftl_init_shards(conf);
+	if (rc) {
+		goto error;
 	}
 
-	rc = bdev_ftl_create_bdev(&conf, rpc_bdev_ftl_create_cb, request);
+	rc = bdev_ftl_create_bdev(conf, rpc_bdev_ftl_create_cb, request);
 	if (rc == -ENODEV) {
-		rc = bdev_ftl_defer_init(&conf);
+		rc = bdev_ftl_defer_init(conf);
 		if (rc == 0) {
 			w = spdk_jsonrpc_begin_result(request);
-			spdk_json_write_string_fmt(w, "FTL bdev: %s creation deferred", conf.name);
+			spdk_json_write_string_fmt(w, "FTL bdev: %s creation deferred",
+						   conf->shard[0].name);
 			spdk_jsonrpc_end_result(request, w);
 		}
 	}
 
+error:
 	if (rc) {
 		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
 						     "Failed to create FTL bdev: %s",
 						     spdk_strerror(-rc));
 	}
 out:
-	spdk_ftl_conf_deinit(&conf);
+	bdev_ftl_conf_deinit(conf);
+	free(conf);
 }
 SPDK_RPC_REGISTER("bdev_ftl_create", rpc_bdev_ftl_create, SPDK_RPC_RUNTIME)
 
@@ -219,14 +351,64 @@ static const struct spdk_json_object_decoder rpc_ftl_stats_decoders[] = {
 	{"name", offsetof(struct rpc_ftl_stats, name), spdk_json_decode_string},
 };
 
+static void
+_rpc_bdev_ftl_write_latency(struct spdk_json_write_ctx *w, enum ftl_stats_stage stage,
+			    const struct ftl_stats_latency *latency)
+{
+	uint64_t i;
+
+	switch (stage) {
+	case FTL_STATS_STAGE_NV_CACHE_WRITE:
+		spdk_json_write_named_object_begin(w, "nv_cache_write");
+		break;
+	case FTL_STATS_STAGE_COMPACTION:
+		spdk_json_write_named_object_begin(w, "compaction");
+		break;
+	case FTL_STATS_STAGE_RELOC:
+		spdk_json_write_named_object_begin(w, "reloc");
+		break;
+	case FTL_STATS_STAGE_L2P_PAGE_IN:
+		spdk_json_write_named_object_begin(w, "l2p_page_in");
+		break;
+	case FTL_STATS_STAGE_USER_WRITE_STALL:
+		spdk_json_write_named_object_begin(w, "user_write_stall");
+		break;
+	default:
+		assert(false);
+		return;
+	}
+
+	spdk_json_write_named_uint64(w, "count", latency->count);
+	spdk_json_write_named_uint64(w, "blocks", latency->blocks);
+	spdk_json_write_named_uint64(w, "total_us", latency->total_us);
+	spdk_json_write_named_uint64(w, "max_us", latency->max_us);
+
+	/* Log2 histogram of latencies in microseconds, see FTL_STATS_LATENCY_BUCKETS */
+	spdk_json_write_named_array_begin(w, "histogram");
+	for (i = 0; i < FTL_STATS_LATENCY_BUCKETS; i++) {
+		spdk_json_write_uint64(w, latency->buckets[i]);
+	}
+	spdk_json_write_array_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
 static void
 _rpc_bdev_ftl_get_stats(void *cntx)
 {
 	struct rpc_ftl_stats_ctx *ftl_stats = cntx;
 	struct spdk_jsonrpc_request *request = ftl_stats->request;
 	struct ftl_stats *stats = ftl_stats->ftl_stats;
-	struct spdk_json_write_ctx *w = spdk_jsonrpc_begin_result(request);
+	struct spdk_json_write_ctx *w;
 
+	if (ftl_stats->status) {
+		spdk_jsonrpc_send_error_response(request, ftl_stats->status,
+						 spdk_strerror(-ftl_stats->status));
+		free(stats);
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
 	spdk_json_write_object_begin(w);
 	spdk_json_write_named_string(w, "name", spdk_bdev_desc_get_bdev(ftl_stats->ftl_bdev_desc)->name);
 
@@ -278,6 +460,45 @@ _rpc_bdev_ftl_get_stats(void *cntx)
 		spdk_json_write_object_end(w);
 	}
 
+	spdk_json_write_named_object_begin(w, "gc_victims");
+	spdk_json_write_named_uint64(w, "bands", stats->gc.bands);
+	spdk_json_write_named_uint64(w, "valid_blocks", stats->gc.valid_blocks);
+	spdk_json_write_object_end(w);
+
+	/* Write amplification is base_blocks / user_blocks */
+	spdk_json_write_named_object_begin(w, "waf");
+	spdk_json_write_named_uint64(w, "user_blocks",
+				     stats->entries[FTL_STATS_TYPE_CMP].write.blocks);
+	spdk_json_write_named_uint64(w, "base_blocks",
+				     stats->entries[FTL_STATS_TYPE_CMP].write.blocks +
+				     stats->entries[FTL_STATS_TYPE_GC].write.blocks +
+				     stats->entries[FTL_STATS_TYPE_MD_BASE].write.blocks);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_named_object_begin(w, "latency");
+	for (uint64_t i = 0; i < FTL_STATS_STAGE_MAX; i++) {
+		_rpc_bdev_ftl_write_latency(w, i, &stats->latency[i]);
+	}
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_named_object_begin(w, "l2p_cache");
+	spdk_json_write_named_uint64(w, "hits", stats->l2p_cache.hits);
+	spdk_json_write_named_uint64(w, "misses", stats->l2p_cache.misses);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_named_object_begin(w, "nv_cache");
+	spdk_json_write_named_uint64(w, "chunks_total", stats->nv_cache.chunks_total);
+	spdk_json_write_named_uint64(w, "chunks_free", stats->nv_cache.chunks_free);
+	spdk_json_write_named_uint64(w, "chunks_open", stats->nv_cache.chunks_open);
+	spdk_json_write_named_uint64(w, "chunks_full", stats->nv_cache.chunks_full);
+	spdk_json_write_named_uint64(w, "chunks_compacting", stats->nv_cache.chunks_compacting);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_named_object_begin(w, "wr_cache");
+	spdk_json_write_named_uint64(w, "hits", stats->wr_cache.hits);
+	spdk_json_write_named_uint64(w, "misses", stats->wr_cache.misses);
+	spdk_json_write_object_end(w);
+
 	spdk_json_write_object_end(w);
 	spdk_jsonrpc_end_result(request, w);
 
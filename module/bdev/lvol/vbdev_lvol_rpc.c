@@ -709,6 +709,63 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_lvol_decouple_parent", rpc_bdev_lvol_decouple_parent, SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_lvol_defrag {
+	char *name;
+	uint64_t max_mbytes_per_sec;
+};
+
+static void
+free_rpc_bdev_lvol_defrag(struct rpc_bdev_lvol_defrag *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_defrag_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_lvol_defrag, name), spdk_json_decode_string},
+	{"max_mbytes_per_sec", offsetof(struct rpc_bdev_lvol_defrag, max_mbytes_per_sec), spdk_json_decode_uint64, true},
+};
+
+static void
+rpc_bdev_lvol_defrag(struct spdk_jsonrpc_request *request,
+		     const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_defrag req = {};
+	struct spdk_bdev *bdev;
+	struct spdk_lvol *lvol;
+
+	SPDK_INFOLOG(lvol_rpc, "Defragmenting lvol\n");
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_defrag_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_defrag_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	lvol = vbdev_lvol_get_from_bdev(bdev);
+	if (lvol == NULL) {
+		SPDK_ERRLOG("lvol does not exist\n");
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	spdk_lvol_defrag(lvol, req.max_mbytes_per_sec, rpc_bdev_lvol_inflate_cb, request);
+
+cleanup:
+	free_rpc_bdev_lvol_defrag(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_defrag", rpc_bdev_lvol_defrag, SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_lvol_resize {
 	char *name;
 	uint64_t size;
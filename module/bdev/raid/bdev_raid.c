@@ -126,6 +126,19 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 		}
 	}
 
+	if (raid_bdev->module->get_io_channel) {
+		raid_ch->module_channel = raid_bdev->module->get_io_channel(raid_bdev);
+		if (!raid_ch->module_channel) {
+			SPDK_ERRLOG("Unable to create io channel for raid module\n");
+			for (i = 0; i < raid_ch->num_channels; i++) {
+				spdk_put_io_channel(raid_ch->base_channel[i]);
+			}
+			free(raid_ch->base_channel);
+			raid_ch->base_channel = NULL;
+			return -ENOMEM;
+		}
+	}
+
 	return 0;
 }
 
@@ -149,6 +162,11 @@ raid_bdev_destroy_cb(void *io_device, void *ctx_buf)
 
 	assert(raid_ch != NULL);
 	assert(raid_ch->base_channel);
+
+	if (raid_ch->module_channel) {
+		spdk_put_io_channel(raid_ch->module_channel);
+	}
+
 	for (i = 0; i < raid_ch->num_channels; i++) {
 		/* Free base bdev channels */
 		assert(raid_ch->base_channel[i] != NULL);
@@ -5,13 +5,71 @@
 
 #include "bdev_raid.h"
 
+#include "spdk/accel.h"
 #include "spdk/env.h"
+#include "spdk/likely.h"
 #include "spdk/thread.h"
 #include "spdk/string.h"
 #include "spdk/util.h"
 
 #include "spdk/log.h"
 
+/* Maximum concurrent full stripe writes per io channel */
+#define RAID5F_MAX_STRIPES 32
+
+struct chunk {
+	/* Corresponds to base_bdev index */
+	uint8_t index;
+
+	/* Offset and length in blocks of the part of the strip accessed by the request */
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+
+	/* Array of iovecs */
+	struct iovec *iovs;
+
+	/* Number of used iovecs */
+	int iovcnt;
+
+	/* Total number of available iovecs in the array */
+	int iovcnt_max;
+
+	/* Position of the parity computation in the iovecs */
+	int xor_iov_idx;
+	size_t xor_iov_offset;
+};
+
+struct stripe_request {
+	struct raid5f_io_channel *r5ch;
+
+	/* The associated raid_bdev_io */
+	struct raid_bdev_io *raid_io;
+
+	/* The stripe's index in the raid array. */
+	uint64_t stripe_index;
+
+	/* The stripe's parity chunk */
+	struct chunk *parity_chunk;
+
+	/* Buffer for stripe parity */
+	void *parity_buf;
+
+	/* Sources of the xor operation in progress, one per data chunk */
+	void **xor_srcs;
+
+	/* Length of the xor operation in progress and total length of parity computed */
+	size_t xor_len;
+	size_t xor_done;
+
+	/* Used to retry submission of the chunks to the base bdevs */
+	struct spdk_bdev_io_wait_entry waitq_entry;
+
+	TAILQ_ENTRY(stripe_request) link;
+
+	/* Array of chunks corresponding to base_bdevs */
+	struct chunk chunks[0];
+};
+
 struct raid5f_info {
 	/* The parent raid bdev */
 	struct raid_bdev *raid_bdev;
@@ -21,26 +79,657 @@ struct raid5f_info {
 
 	/* Number of stripes on this array */
 	uint64_t total_stripes;
+
+	/* Alignment for buffer allocation */
+	size_t buf_alignment;
 };
 
+struct raid5f_io_channel {
+	/* All available stripe requests on this channel */
+	TAILQ_HEAD(, stripe_request) free_stripe_requests;
+
+	/* IOs waiting for a free stripe request */
+	TAILQ_HEAD(, spdk_bdev_io) waiting_ios;
+
+	/* Stripe requests waiting for a free accel task to compute their parity */
+	TAILQ_HEAD(, stripe_request) xor_retry_queue;
+	struct spdk_poller *xor_retry_poller;
+
+	/* accel_fw channel */
+	struct spdk_io_channel *accel_ch;
+};
+
+#define __CHUNK_IN_RANGE(req, c) \
+	c < req->chunks + raid5f_ch_to_r5f_info(req->r5ch)->raid_bdev->num_base_bdevs
+
+#define FOR_EACH_CHUNK_FROM(req, c, from) \
+	for (c = from; __CHUNK_IN_RANGE(req, c); c++)
+
+#define FOR_EACH_CHUNK(req, c) \
+	FOR_EACH_CHUNK_FROM(req, c, req->chunks)
+
+#define __NEXT_DATA_CHUNK(req, c) \
+	c == req->parity_chunk ? c+1 : c
+
+#define FOR_EACH_DATA_CHUNK(req, c) \
+	for (c = __NEXT_DATA_CHUNK(req, req->chunks); __CHUNK_IN_RANGE(req, c); \
+	     c = __NEXT_DATA_CHUNK(req, c+1))
+
+static inline struct raid5f_info *
+raid5f_ch_to_r5f_info(struct raid5f_io_channel *r5ch)
+{
+	return spdk_io_channel_get_io_device(spdk_io_channel_from_ctx(r5ch));
+}
+
+static inline struct stripe_request *
+raid5f_chunk_stripe_req(struct chunk *chunk)
+{
+	return SPDK_CONTAINEROF((chunk - chunk->index), struct stripe_request, chunks);
+}
+
 static inline uint8_t
 raid5f_stripe_data_chunks_num(const struct raid_bdev *raid_bdev)
 {
 	return raid_bdev->num_base_bdevs - raid_bdev->module->base_bdevs_max_degraded;
 }
 
+static inline uint8_t
+raid5f_stripe_parity_chunk_index(const struct raid_bdev *raid_bdev, uint64_t stripe_index)
+{
+	return raid5f_stripe_data_chunks_num(raid_bdev) - stripe_index % raid_bdev->num_base_bdevs;
+}
+
+static void raid5f_submit_rw_request(struct raid_bdev_io *raid_io);
+
 static void
-raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
+raid5f_stripe_request_release(struct stripe_request *stripe_req)
 {
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct spdk_bdev_io *bdev_io;
+
+	stripe_req->raid_io = NULL;
+	TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests, stripe_req, link);
+
+	bdev_io = TAILQ_FIRST(&r5ch->waiting_ios);
+	if (bdev_io != NULL) {
+		TAILQ_REMOVE(&r5ch->waiting_ios, bdev_io, module_link);
+		raid5f_submit_rw_request((struct raid_bdev_io *)bdev_io->driver_ctx);
+	}
+}
+
+static void
+raid5f_stripe_request_fail(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	raid5f_stripe_request_release(stripe_req);
 	raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
 }
 
+static void
+raid5f_chunk_complete_bdev_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct stripe_request *stripe_req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (raid_bdev_io_complete_part(stripe_req->raid_io, 1, success ?
+				       SPDK_BDEV_IO_STATUS_SUCCESS :
+				       SPDK_BDEV_IO_STATUS_FAILED)) {
+		raid5f_stripe_request_release(stripe_req);
+	}
+}
+
+static int
+raid5f_chunk_submit(struct chunk *chunk)
+{
+	struct stripe_request *stripe_req = raid5f_chunk_stripe_req(chunk);
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[chunk->index];
+	struct spdk_io_channel *base_ch = raid_io->raid_ch->base_channel[chunk->index];
+	uint64_t base_offset_blocks = (stripe_req->stripe_index << raid_bdev->strip_size_shift) +
+				      chunk->offset_blocks;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_READ) {
+		return spdk_bdev_readv_blocks_ext(base_info->desc, base_ch, chunk->iovs, chunk->iovcnt,
+						  base_offset_blocks, chunk->num_blocks,
+						  raid5f_chunk_complete_bdev_io, stripe_req,
+						  bdev_io->u.bdev.ext_opts);
+	} else {
+		return spdk_bdev_writev_blocks(base_info->desc, base_ch, chunk->iovs, chunk->iovcnt,
+					       base_offset_blocks, chunk->num_blocks,
+					       raid5f_chunk_complete_bdev_io, stripe_req);
+	}
+}
+
+static void
+raid5f_stripe_request_submit_chunks(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	struct chunk *start = &stripe_req->chunks[raid_io->base_bdev_io_submitted];
+	struct chunk *chunk;
+	int ret;
+
+	FOR_EACH_CHUNK_FROM(stripe_req, chunk, start) {
+		if (chunk->num_blocks == 0) {
+			raid_io->base_bdev_io_submitted++;
+			continue;
+		}
+
+		ret = raid5f_chunk_submit(chunk);
+		if (spdk_unlikely(ret != 0)) {
+			if (ret == -ENOMEM) {
+				struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+
+				stripe_req->waitq_entry.bdev = raid_bdev->base_bdev_info[chunk->index].bdev;
+				spdk_bdev_queue_io_wait(stripe_req->waitq_entry.bdev,
+							raid_io->raid_ch->base_channel[chunk->index],
+							&stripe_req->waitq_entry);
+			} else {
+				uint64_t not_submitted = 0;
+
+				SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+				assert(false);
+				FOR_EACH_CHUNK_FROM(stripe_req, chunk, chunk) {
+					if (chunk->num_blocks > 0) {
+						not_submitted++;
+					}
+				}
+				if (raid_bdev_io_complete_part(raid_io, not_submitted,
+							       SPDK_BDEV_IO_STATUS_FAILED)) {
+					raid5f_stripe_request_release(stripe_req);
+				}
+			}
+			return;
+		}
+		raid_io->base_bdev_io_submitted++;
+	}
+}
+
+static void
+_raid5f_stripe_request_submit_chunks(void *_stripe_req)
+{
+	raid5f_stripe_request_submit_chunks(_stripe_req);
+}
+
+static void raid5f_xor_stripe(struct stripe_request *stripe_req);
+
+static void
+raid5f_xor_stripe_done(void *_stripe_req, int status)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+	struct raid_bdev *raid_bdev = stripe_req->raid_io->raid_bdev;
+	struct chunk *chunk;
+
+	if (spdk_unlikely(status != 0)) {
+		SPDK_ERRLOG("stripe parity computation failed: %s\n", spdk_strerror(-status));
+		raid5f_stripe_request_fail(stripe_req);
+		return;
+	}
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		chunk->xor_iov_offset += stripe_req->xor_len;
+		if (chunk->xor_iov_offset == chunk->iovs[chunk->xor_iov_idx].iov_len) {
+			chunk->xor_iov_idx++;
+			chunk->xor_iov_offset = 0;
+		}
+	}
+
+	stripe_req->xor_done += stripe_req->xor_len;
+	if (stripe_req->xor_done < raid_bdev->strip_size << raid_bdev->blocklen_shift) {
+		raid5f_xor_stripe(stripe_req);
+	} else {
+		raid5f_stripe_request_submit_chunks(stripe_req);
+	}
+}
+
+static int
+raid5f_xor_retry_poll(void *arg)
+{
+	struct raid5f_io_channel *r5ch = arg;
+	struct stripe_request *stripe_req;
+	TAILQ_HEAD(, stripe_request) queue;
+	int count = 0;
+
+	TAILQ_INIT(&queue);
+	TAILQ_SWAP(&queue, &r5ch->xor_retry_queue, stripe_request, link);
+
+	while ((stripe_req = TAILQ_FIRST(&queue)) != NULL) {
+		TAILQ_REMOVE(&queue, stripe_req, link);
+		raid5f_xor_stripe(stripe_req);
+		if (!TAILQ_EMPTY(&r5ch->xor_retry_queue)) {
+			/* Out of accel tasks again, keep the order of the requests */
+			TAILQ_CONCAT(&r5ch->xor_retry_queue, &queue, link);
+			break;
+		}
+		count++;
+	}
+
+	if (TAILQ_EMPTY(&r5ch->xor_retry_queue)) {
+		spdk_poller_unregister(&r5ch->xor_retry_poller);
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+/*
+ * Computes the parity of the next piece of the stripe that is contiguous in all
+ * data chunks. When the data is in a single buffer per chunk, which is the usual
+ * case, the whole parity is computed by a single xor operation.
+ */
+static void
+raid5f_xor_stripe(struct stripe_request *stripe_req)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct raid_bdev *raid_bdev = stripe_req->raid_io->raid_bdev;
+	size_t len = (raid_bdev->strip_size << raid_bdev->blocklen_shift) - stripe_req->xor_done;
+	struct chunk *chunk;
+	uint8_t i = 0;
+	int ret;
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		struct iovec *iov = &chunk->iovs[chunk->xor_iov_idx];
+
+		stripe_req->xor_srcs[i++] = (uint8_t *)iov->iov_base + chunk->xor_iov_offset;
+		len = spdk_min(len, iov->iov_len - chunk->xor_iov_offset);
+	}
+	stripe_req->xor_len = len;
+
+	ret = spdk_accel_submit_xor(r5ch->accel_ch, (uint8_t *)stripe_req->parity_buf + stripe_req->xor_done,
+				    stripe_req->xor_srcs, i, len, raid5f_xor_stripe_done, stripe_req);
+	if (spdk_unlikely(ret != 0)) {
+		if (ret == -ENOMEM) {
+			TAILQ_INSERT_TAIL(&r5ch->xor_retry_queue, stripe_req, link);
+			if (r5ch->xor_retry_poller == NULL) {
+				r5ch->xor_retry_poller = SPDK_POLLER_REGISTER(raid5f_xor_retry_poll, r5ch, 0);
+			}
+		} else {
+			SPDK_ERRLOG("stripe parity computation failed: %s\n", spdk_strerror(-ret));
+			raid5f_stripe_request_fail(stripe_req);
+		}
+	}
+}
+
+/*
+ * Splits the iovecs of the raid_io between the data chunks, according to the
+ * number of blocks accessed in each chunk.
+ */
+static int
+raid5f_stripe_request_map_iovecs(struct stripe_request *stripe_req,
+				 const struct iovec *raid_io_iovs, int raid_io_iovcnt)
+{
+	struct raid_bdev *raid_bdev = stripe_req->raid_io->raid_bdev;
+	struct chunk *chunk;
+	int raid_io_iov_idx = 0;
+	size_t raid_io_iov_offset = 0;
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		size_t len = chunk->num_blocks << raid_bdev->blocklen_shift;
+		size_t remaining = len;
+		int iovcnt = 0;
+		int i;
+
+		chunk->iovcnt = 0;
+		chunk->xor_iov_idx = 0;
+		chunk->xor_iov_offset = 0;
+
+		if (len == 0) {
+			continue;
+		}
+
+		/* Count the iovecs covering the chunk */
+		for (i = raid_io_iov_idx; i < raid_io_iovcnt && remaining > 0; i++) {
+			size_t iov_len = raid_io_iovs[i].iov_len;
+
+			if (i == raid_io_iov_idx) {
+				iov_len -= raid_io_iov_offset;
+			}
+			remaining -= spdk_min(remaining, iov_len);
+			iovcnt++;
+		}
+
+		if (spdk_unlikely(remaining > 0)) {
+			return -EINVAL;
+		}
+
+		if (iovcnt > chunk->iovcnt_max) {
+			struct iovec *iovs;
+
+			iovs = realloc(chunk->iovs, iovcnt * sizeof(*iovs));
+			if (!iovs) {
+				return -ENOMEM;
+			}
+			chunk->iovs = iovs;
+			chunk->iovcnt_max = iovcnt;
+		}
+		chunk->iovcnt = iovcnt;
+
+		for (i = 0; i < iovcnt; i++) {
+			const struct iovec *raid_io_iov = &raid_io_iovs[raid_io_iov_idx];
+			struct iovec *chunk_iov = &chunk->iovs[i];
+
+			chunk_iov->iov_base = (uint8_t *)raid_io_iov->iov_base + raid_io_iov_offset;
+			chunk_iov->iov_len = spdk_min(len, raid_io_iov->iov_len - raid_io_iov_offset);
+			len -= chunk_iov->iov_len;
+
+			raid_io_iov_offset += chunk_iov->iov_len;
+			if (raid_io_iov_offset == raid_io_iov->iov_len) {
+				raid_io_iov_idx++;
+				raid_io_iov_offset = 0;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+raid5f_submit_stripe_request(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+			     uint64_t stripe_offset)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_io_channel *r5ch = spdk_io_channel_get_ctx(raid_io->raid_ch->module_channel);
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	struct stripe_request *stripe_req;
+	struct chunk *chunk;
+	int ret;
+
+	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests);
+	if (!stripe_req) {
+		return -ENOMEM;
+	}
+
+	stripe_req->stripe_index = stripe_index;
+	stripe_req->parity_chunk = stripe_req->chunks + raid5f_stripe_parity_chunk_index(raid_bdev,
+				   stripe_index);
+	stripe_req->raid_io = raid_io;
+	stripe_req->xor_done = 0;
+	raid_io->base_bdev_io_submitted = 0;
+
+	/* Set the range of each data chunk accessed by the request */
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		if (stripe_offset < raid_bdev->strip_size && num_blocks > 0) {
+			chunk->offset_blocks = stripe_offset;
+			chunk->num_blocks = spdk_min(num_blocks, raid_bdev->strip_size - stripe_offset);
+			num_blocks -= chunk->num_blocks;
+			stripe_offset = 0;
+		} else {
+			chunk->offset_blocks = 0;
+			chunk->num_blocks = 0;
+			stripe_offset -= spdk_min(stripe_offset, raid_bdev->strip_size);
+		}
+	}
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		chunk = stripe_req->parity_chunk;
+		chunk->offset_blocks = 0;
+		chunk->num_blocks = raid_bdev->strip_size;
+		chunk->iovs[0].iov_base = stripe_req->parity_buf;
+		chunk->iovs[0].iov_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
+		chunk->iovcnt = 1;
+		raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
+	} else {
+		stripe_req->parity_chunk->num_blocks = 0;
+		raid_io->base_bdev_io_remaining = 0;
+		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+			if (chunk->num_blocks > 0) {
+				raid_io->base_bdev_io_remaining++;
+			}
+		}
+	}
+
+	ret = raid5f_stripe_request_map_iovecs(stripe_req, bdev_io->u.bdev.iovs,
+					       bdev_io->u.bdev.iovcnt);
+	if (spdk_unlikely(ret)) {
+		stripe_req->raid_io = NULL;
+		/* Waiting I/Os are only retried when a stripe request completes, which
+		 * may never happen if none is in flight, so fail the I/O instead.
+		 */
+		return ret == -ENOMEM ? -EIO : ret;
+	}
+
+	TAILQ_REMOVE(&r5ch->free_stripe_requests, stripe_req, link);
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		raid5f_xor_stripe(stripe_req);
+	} else {
+		raid5f_stripe_request_submit_chunks(stripe_req);
+	}
+
+	return 0;
+}
+
+static void
+raid5f_chunk_read_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid_bdev_io_complete(raid_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+_raid5f_submit_rw_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid5f_submit_rw_request(raid_io);
+}
+
+/* Reads within a single chunk go directly to its base bdev with the original iovecs */
+static int
+raid5f_submit_chunk_read(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+			 uint64_t stripe_offset)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	uint8_t chunk_data_idx = stripe_offset >> raid_bdev->strip_size_shift;
+	uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index);
+	uint64_t chunk_offset = stripe_offset & (raid_bdev->strip_size - 1);
+	uint64_t base_offset_blocks = (stripe_index << raid_bdev->strip_size_shift) + chunk_offset;
+	uint8_t chunk_idx = chunk_data_idx < p_idx ? chunk_data_idx : chunk_data_idx + 1;
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[chunk_idx];
+	struct spdk_io_channel *base_ch = raid_io->raid_ch->base_channel[chunk_idx];
+	int ret;
+
+	ret = spdk_bdev_readv_blocks_ext(base_info->desc, base_ch, bdev_io->u.bdev.iovs,
+					 bdev_io->u.bdev.iovcnt, base_offset_blocks,
+					 bdev_io->u.bdev.num_blocks, raid5f_chunk_read_complete,
+					 raid_io, bdev_io->u.bdev.ext_opts);
+	if (spdk_unlikely(ret == -ENOMEM)) {
+		raid_bdev_queue_io_wait(raid_io, base_info->bdev, base_ch,
+					_raid5f_submit_rw_request);
+		return 0;
+	}
+
+	return ret;
+}
+
+static void
+raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid5f_io_channel *r5ch = spdk_io_channel_get_ctx(raid_io->raid_ch->module_channel);
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t stripe_index = offset_blocks / r5f_info->stripe_blocks;
+	uint64_t stripe_offset = offset_blocks % r5f_info->stripe_blocks;
+	int ret;
+
+	if (spdk_unlikely(stripe_offset + bdev_io->u.bdev.num_blocks > r5f_info->stripe_blocks)) {
+		SPDK_ERRLOG("I/O spans stripe boundary!\n");
+		assert(false);
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		if ((stripe_offset >> raid_bdev->strip_size_shift) ==
+		    ((stripe_offset + bdev_io->u.bdev.num_blocks - 1) >> raid_bdev->strip_size_shift)) {
+			ret = raid5f_submit_chunk_read(raid_io, stripe_index, stripe_offset);
+		} else {
+			ret = raid5f_submit_stripe_request(raid_io, stripe_index, stripe_offset);
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		/* Partial stripe writes would need a read-modify-write of the parity */
+		if (spdk_unlikely(stripe_offset != 0 ||
+				  bdev_io->u.bdev.num_blocks != r5f_info->stripe_blocks)) {
+			SPDK_ERRLOG("Only full stripe writes are supported\n");
+			ret = -EINVAL;
+			break;
+		}
+		/* The parity is computed from the data buffers, which must be in local memory */
+		if (spdk_unlikely(bdev_io->u.bdev.ext_opts != NULL &&
+				  bdev_io->u.bdev.ext_opts->memory_domain != NULL)) {
+			SPDK_ERRLOG("Writes to memory domains are not supported\n");
+			ret = -EINVAL;
+			break;
+		}
+		ret = raid5f_submit_stripe_request(raid_io, stripe_index, stripe_offset);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	if (spdk_unlikely(ret != 0)) {
+		if (ret == -ENOMEM) {
+			TAILQ_INSERT_TAIL(&r5ch->waiting_ios, bdev_io, module_link);
+		} else {
+			raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+	}
+}
+
+static void
+raid5f_stripe_request_free(struct stripe_request *stripe_req)
+{
+	struct chunk *chunk;
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		free(chunk->iovs);
+	}
+
+	spdk_dma_free(stripe_req->parity_buf);
+	free(stripe_req->xor_srcs);
+
+	free(stripe_req);
+}
+
+static struct stripe_request *
+raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(r5ch);
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	struct stripe_request *stripe_req;
+	struct chunk *chunk;
+
+	stripe_req = calloc(1, sizeof(*stripe_req) +
+			    sizeof(struct chunk) * raid_bdev->num_base_bdevs);
+	if (!stripe_req) {
+		return NULL;
+	}
+
+	stripe_req->r5ch = r5ch;
+	stripe_req->waitq_entry.cb_fn = _raid5f_stripe_request_submit_chunks;
+	stripe_req->waitq_entry.cb_arg = stripe_req;
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		chunk->index = chunk - stripe_req->chunks;
+		chunk->iovcnt_max = 4;
+		chunk->iovs = calloc(chunk->iovcnt_max, sizeof(chunk->iovs[0]));
+		if (!chunk->iovs) {
+			goto err;
+		}
+	}
+
+	stripe_req->parity_buf = spdk_dma_malloc(raid_bdev->strip_size << raid_bdev->blocklen_shift,
+				 r5f_info->buf_alignment, NULL);
+	if (!stripe_req->parity_buf) {
+		goto err;
+	}
+
+	stripe_req->xor_srcs = calloc(raid5f_stripe_data_chunks_num(raid_bdev),
+				      sizeof(stripe_req->xor_srcs[0]));
+	if (!stripe_req->xor_srcs) {
+		goto err;
+	}
+
+	return stripe_req;
+err:
+	raid5f_stripe_request_free(stripe_req);
+	return NULL;
+}
+
+static void
+raid5f_ioch_destroy(void *io_device, void *ctx_buf)
+{
+	struct raid5f_io_channel *r5ch = ctx_buf;
+	struct stripe_request *stripe_req;
+
+	assert(TAILQ_EMPTY(&r5ch->waiting_ios));
+	assert(TAILQ_EMPTY(&r5ch->xor_retry_queue));
+
+	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests))) {
+		TAILQ_REMOVE(&r5ch->free_stripe_requests, stripe_req, link);
+		raid5f_stripe_request_free(stripe_req);
+	}
+
+	spdk_poller_unregister(&r5ch->xor_retry_poller);
+
+	if (r5ch->accel_ch) {
+		spdk_put_io_channel(r5ch->accel_ch);
+	}
+}
+
+static int
+raid5f_ioch_create(void *io_device, void *ctx_buf)
+{
+	struct raid5f_io_channel *r5ch = ctx_buf;
+	int i;
+
+	TAILQ_INIT(&r5ch->free_stripe_requests);
+	TAILQ_INIT(&r5ch->waiting_ios);
+	TAILQ_INIT(&r5ch->xor_retry_queue);
+
+	for (i = 0; i < RAID5F_MAX_STRIPES; i++) {
+		struct stripe_request *stripe_req;
+
+		stripe_req = raid5f_stripe_request_alloc(r5ch);
+		if (!stripe_req) {
+			SPDK_ERRLOG("Failed to initialize io channel\n");
+			raid5f_ioch_destroy(io_device, ctx_buf);
+			return -ENOMEM;
+		}
+
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests, stripe_req, link);
+	}
+
+	r5ch->accel_ch = spdk_accel_get_io_channel();
+	if (!r5ch->accel_ch) {
+		SPDK_ERRLOG("Failed to get accel framework's IO channel\n");
+		raid5f_ioch_destroy(io_device, ctx_buf);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 static int
 raid5f_start(struct raid_bdev *raid_bdev)
 {
 	uint64_t min_blockcnt = UINT64_MAX;
 	struct raid_base_bdev_info *base_info;
 	struct raid5f_info *r5f_info;
+	size_t alignment = SPDK_CACHE_LINE_SIZE;
 
 	r5f_info = calloc(1, sizeof(*r5f_info));
 	if (!r5f_info) {
@@ -51,26 +740,48 @@ raid5f_start(struct raid_bdev *raid_bdev)
 
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		min_blockcnt = spdk_min(min_blockcnt, base_info->bdev->blockcnt);
+		alignment = spdk_max(alignment, 1UL << base_info->bdev->required_alignment);
 	}
 
 	r5f_info->total_stripes = min_blockcnt / raid_bdev->strip_size;
 	r5f_info->stripe_blocks = raid_bdev->strip_size * raid5f_stripe_data_chunks_num(raid_bdev);
+	r5f_info->buf_alignment = alignment;
 
 	raid_bdev->bdev.blockcnt = r5f_info->stripe_blocks * r5f_info->total_stripes;
 	raid_bdev->bdev.optimal_io_boundary = r5f_info->stripe_blocks;
 	raid_bdev->bdev.split_on_optimal_io_boundary = true;
+	raid_bdev->bdev.write_unit_size = r5f_info->stripe_blocks;
 
 	raid_bdev->module_private = r5f_info;
 
+	spdk_io_device_register(r5f_info, raid5f_ioch_create, raid5f_ioch_destroy,
+				sizeof(struct raid5f_io_channel), NULL);
+
 	return 0;
 }
 
+static void
+raid5f_io_device_unregister_done(void *io_device)
+{
+	struct raid5f_info *r5f_info = io_device;
+
+	free(r5f_info);
+}
+
 static void
 raid5f_stop(struct raid_bdev *raid_bdev)
 {
 	struct raid5f_info *r5f_info = raid_bdev->module_private;
 
-	free(r5f_info);
+	spdk_io_device_unregister(r5f_info, raid5f_io_device_unregister_done);
+}
+
+static struct spdk_io_channel *
+raid5f_get_io_channel(struct raid_bdev *raid_bdev)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+
+	return spdk_get_io_channel(r5f_info);
 }
 
 static struct raid_bdev_module g_raid5f_module = {
@@ -80,6 +791,7 @@ static struct raid_bdev_module g_raid5f_module = {
 	.start = raid5f_start,
 	.stop = raid5f_stop,
 	.submit_rw_request = raid5f_submit_rw_request,
+	.get_io_channel = raid5f_get_io_channel,
 };
 RAID_MODULE_REGISTER(&g_raid5f_module)
 
@@ -12,6 +12,7 @@
 #include "spdk/bdev_zone.h"
 
 #include "spdk/log.h"
+#include "spdk/util.h"
 
 static int zone_block_init(void);
 static int zone_block_get_ctx_size(void);
@@ -42,8 +43,15 @@ struct bdev_zone_block_config {
 };
 static TAILQ_HEAD(, bdev_zone_block_config) g_bdev_configs = TAILQ_HEAD_INITIALIZER(g_bdev_configs);
 
+struct zone_block_io;
+
 struct block_zone {
+	/* write_pointer is the end of the range reserved by writes submitted so far */
 	struct spdk_bdev_zone_info zone_info;
+	/* End of the range written to the base bdev, reported as the zone's write pointer */
+	uint64_t completed_wp;
+	/* Writes with a reserved range that weren't completed yet, in write pointer order */
+	TAILQ_HEAD(zone_block_io_list, zone_block_io) writes;
 	pthread_spinlock_t lock;
 };
 
@@ -67,6 +75,13 @@ struct zone_block_io_channel {
 struct zone_block_io {
 	/* vbdev to which IO was issued */
 	struct bdev_zone_block *bdev_zone_block;
+	/* Zone and range reserved by a write / append */
+	struct block_zone *zone;
+	uint64_t lba;
+	/* Set once the base bdev completes the write */
+	bool completed;
+	enum spdk_bdev_io_status status;
+	TAILQ_ENTRY(zone_block_io) tailq;
 };
 
 static int
@@ -208,7 +223,15 @@ zone_block_get_zone_info(struct bdev_zone_block *bdev_node, struct spdk_bdev_io
 		if (!zone) {
 			return -EINVAL;
 		}
+		pthread_spin_lock(&zone->lock);
 		memcpy(&zone_info[i], &zone->zone_info, sizeof(*zone_info));
+		/* Don't report blocks which are still being written */
+		zone_info[i].write_pointer = zone->completed_wp;
+		if (zone_info[i].state == SPDK_BDEV_ZONE_STATE_FULL &&
+		    zone->completed_wp < zone->zone_info.zone_id + zone->zone_info.capacity) {
+			zone_info[i].state = SPDK_BDEV_ZONE_STATE_OPEN;
+		}
+		pthread_spin_unlock(&zone->lock);
 	}
 
 	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
@@ -253,6 +276,13 @@ zone_block_reset_zone(struct bdev_zone_block *bdev_node, struct zone_block_io_ch
 {
 	pthread_spin_lock(&zone->lock);
 
+	if (!TAILQ_EMPTY(&zone->writes)) {
+		SPDK_ERRLOG("Trying to reset zone 0x%" PRIx64 " with outstanding writes\n",
+			    zone->zone_info.zone_id);
+		pthread_spin_unlock(&zone->lock);
+		return -EBUSY;
+	}
+
 	switch (zone->zone_info.state) {
 	case SPDK_BDEV_ZONE_STATE_EMPTY:
 		pthread_spin_unlock(&zone->lock);
@@ -263,6 +293,7 @@ zone_block_reset_zone(struct bdev_zone_block *bdev_node, struct zone_block_io_ch
 	case SPDK_BDEV_ZONE_STATE_CLOSED:
 		zone->zone_info.state = SPDK_BDEV_ZONE_STATE_EMPTY;
 		zone->zone_info.write_pointer = zone->zone_info.zone_id;
+		zone->completed_wp = zone->zone_info.zone_id;
 		pthread_spin_unlock(&zone->lock);
 
 		/* The unmap isn't necessary, so if the base bdev doesn't support it, we're done */
@@ -306,6 +337,7 @@ zone_block_finish_zone(struct block_zone *zone, struct spdk_bdev_io *bdev_io)
 
 	zone->zone_info.write_pointer = zone->zone_info.zone_id + zone->zone_info.capacity;
 	zone->zone_info.state = SPDK_BDEV_ZONE_STATE_FULL;
+	zone->completed_wp = zone->zone_info.write_pointer;
 
 	pthread_spin_unlock(&zone->lock);
 	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
@@ -337,20 +369,72 @@ zone_block_zone_management(struct bdev_zone_block *bdev_node, struct zone_block_
 	}
 }
 
+static void
+_zone_block_complete_write_msg(void *ctx)
+{
+	struct zone_block_io *io_ctx = ctx;
+
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io_ctx), io_ctx->status);
+}
+
+/*
+ * Writes reserve their range of the zone at submission, so any number of them (appends in
+ * particular) can be outstanding to the base bdev at once. They're completed in the order of their
+ * reservations though, so that the write pointer never runs ahead of data that was written.
+ * Writes to a zone may come from several threads, so each IO is completed on its own thread.
+ */
+static void
+zone_block_write_done(struct zone_block_io *io_ctx, enum spdk_bdev_io_status status)
+{
+	struct block_zone *zone = io_ctx->zone;
+	struct spdk_bdev_io *orig_io;
+	TAILQ_HEAD(, zone_block_io) done = TAILQ_HEAD_INITIALIZER(done);
+
+	pthread_spin_lock(&zone->lock);
+
+	io_ctx->completed = true;
+	io_ctx->status = status;
+
+	while ((io_ctx = TAILQ_FIRST(&zone->writes)) && io_ctx->completed) {
+		TAILQ_REMOVE(&zone->writes, io_ctx, tailq);
+		TAILQ_INSERT_TAIL(&done, io_ctx, tailq);
+
+		orig_io = spdk_bdev_io_from_ctx(io_ctx);
+		/* A failed write still consumes its range, same as on a zoned device */
+		zone->completed_wp = spdk_max(zone->completed_wp,
+					      io_ctx->lba + orig_io->u.bdev.num_blocks);
+	}
+
+	pthread_spin_unlock(&zone->lock);
+
+	while ((io_ctx = TAILQ_FIRST(&done))) {
+		TAILQ_REMOVE(&done, io_ctx, tailq);
+
+		orig_io = spdk_bdev_io_from_ctx(io_ctx);
+		if (io_ctx->status == SPDK_BDEV_IO_STATUS_SUCCESS &&
+		    orig_io->type == SPDK_BDEV_IO_TYPE_ZONE_APPEND) {
+			orig_io->u.bdev.offset_blocks = io_ctx->lba;
+		}
+
+		if (spdk_bdev_io_get_thread(orig_io) != spdk_get_thread()) {
+			spdk_thread_send_msg(spdk_bdev_io_get_thread(orig_io),
+					     _zone_block_complete_write_msg, io_ctx);
+		} else {
+			spdk_bdev_io_complete(orig_io, io_ctx->status);
+		}
+	}
+}
+
 static void
 _zone_block_complete_write(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
 	struct spdk_bdev_io *orig_io = cb_arg;
 	int status = success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED;
 
-	if (success && orig_io->type == SPDK_BDEV_IO_TYPE_ZONE_APPEND) {
-		orig_io->u.bdev.offset_blocks = bdev_io->u.bdev.offset_blocks;
-	}
-
 	/* Complete the original IO and then free the one that we created here
 	 * as a result of issuing an IO via submit_request.
 	 */
-	spdk_bdev_io_complete(orig_io, status);
+	zone_block_write_done((struct zone_block_io *)orig_io->driver_ctx, status);
 	spdk_bdev_free_io(bdev_io);
 }
 
@@ -358,10 +442,12 @@ static int
 zone_block_write(struct bdev_zone_block *bdev_node, struct zone_block_io_channel *ch,
 		 struct spdk_bdev_io *bdev_io)
 {
+	struct zone_block_io *io_ctx = (struct zone_block_io *)bdev_io->driver_ctx;
 	struct block_zone *zone;
 	uint64_t len = bdev_io->u.bdev.num_blocks;
 	uint64_t lba = bdev_io->u.bdev.offset_blocks;
 	uint64_t num_blocks_left, wp;
+	enum spdk_bdev_zone_state prev_state;
 	int rc = 0;
 	bool is_append = bdev_io->type == SPDK_BDEV_IO_TYPE_ZONE_APPEND;
 
@@ -377,6 +463,8 @@ zone_block_write(struct bdev_zone_block *bdev_node, struct zone_block_io_channel
 
 	pthread_spin_lock(&zone->lock);
 
+	/* Restored if the reservation is given back, so a failed first write leaves it empty */
+	prev_state = zone->zone_info.state;
 	switch (zone->zone_info.state) {
 	case SPDK_BDEV_ZONE_STATE_OPEN:
 	case SPDK_BDEV_ZONE_STATE_EMPTY:
@@ -409,6 +497,11 @@ zone_block_write(struct bdev_zone_block *bdev_node, struct zone_block_io_channel
 		goto write_fail;
 	}
 
+	io_ctx->zone = zone;
+	io_ctx->lba = lba;
+	io_ctx->completed = false;
+	TAILQ_INSERT_TAIL(&zone->writes, io_ctx, tailq);
+
 	zone->zone_info.write_pointer += bdev_io->u.bdev.num_blocks;
 	assert(zone->zone_info.write_pointer <= zone->zone_info.zone_id + zone->zone_info.capacity);
 	if (zone->zone_info.write_pointer == zone->zone_info.zone_id + zone->zone_info.capacity) {
@@ -429,7 +522,23 @@ zone_block_write(struct bdev_zone_block *bdev_node, struct zone_block_io_channel
 						     _zone_block_complete_write, bdev_io);
 	}
 
-	return rc;
+	if (rc != 0) {
+		pthread_spin_lock(&zone->lock);
+		/* Give back the reservation if no other write was placed after it */
+		if (TAILQ_LAST(&zone->writes, zone_block_io_list) == io_ctx) {
+			TAILQ_REMOVE(&zone->writes, io_ctx, tailq);
+			zone->zone_info.write_pointer = lba;
+			zone->zone_info.state = prev_state;
+			pthread_spin_unlock(&zone->lock);
+			return rc;
+		}
+		pthread_spin_unlock(&zone->lock);
+
+		/* Otherwise the range is lost and the IO is completed in order with the others */
+		zone_block_write_done(io_ctx, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+
+	return 0;
 
 write_fail:
 	pthread_spin_unlock(&zone->lock);
@@ -678,6 +787,8 @@ zone_block_init_zone_info(struct bdev_zone_block *bdev_node)
 		zone->zone_info.capacity = bdev_node->zone_capacity;
 		zone->zone_info.write_pointer = zone->zone_info.zone_id + zone->zone_info.capacity;
 		zone->zone_info.state = SPDK_BDEV_ZONE_STATE_FULL;
+		zone->completed_wp = zone->zone_info.write_pointer;
+		TAILQ_INIT(&zone->writes);
 		if (pthread_spin_init(&zone->lock, PTHREAD_PROCESS_PRIVATE)) {
 			SPDK_ERRLOG("pthread_spin_init() failed\n");
 			rc = -ENOMEM;
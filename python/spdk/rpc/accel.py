@@ -23,3 +23,18 @@ def accel_assign_opc(client, opname, engine):
     }
 
     return client.call('accel_assign_opc', params)
+
+
+def accel_set_compress_opts(client, algo, level=None):
+    """Set the algorithm and level of compress operations that don't specify them.
+
+    Args:
+        algo: compression algorithm: deflate, lz4 or zstd
+        level: compression level, 0 is the fastest one of the algorithm (optional)
+    """
+    params = {'algo': algo}
+
+    if level is not None:
+        params['level'] = level
+
+    return client.call('accel_set_compress_opts', params)
@@ -43,21 +43,33 @@ def bdev_wait_for_examine(client):
     return client.call('bdev_wait_for_examine')
 
 
-def bdev_compress_create(client, base_bdev_name, pm_path, lb_size):
+def bdev_compress_create(client, base_bdev_name, pm_path=None, lb_size=None, comp_algo=None,
+                         comp_level=None, packed=None):
     """Construct a compress virtual block device.
 
     Args:
         base_bdev_name: name of the underlying base bdev
-        pm_path: path to persistent memory
+        pm_path: path to persistent memory (optional, metadata is kept on the base bdev without it)
         lb_size: logical block size for the compressed vol in bytes.  Must be 4K or 512.
+        comp_algo: compression algorithm: deflate, lz4 or zstd (optional)
+        comp_level: compression level (optional)
+        packed: pack compressed chunks into shared backing io units (optional)
 
     Returns:
         Name of created virtual block device.
     """
-    params = {'base_bdev_name': base_bdev_name, 'pm_path': pm_path}
+    params = {'base_bdev_name': base_bdev_name}
 
+    if pm_path:
+        params['pm_path'] = pm_path
     if lb_size:
         params['lb_size'] = lb_size
+    if comp_algo:
+        params['comp_algo'] = comp_algo
+    if comp_level is not None:
+        params['comp_level'] = comp_level
+    if packed is not None:
+        params['packed'] = packed
 
     return client.call('bdev_compress_create', params)
 
@@ -76,7 +88,7 @@ def bdev_compress_set_pmd(client, pmd):
     """Set pmd options for the bdev compress.
 
     Args:
-        pmd: 0 = auto-select, 1 = QAT, 2 = ISAL, 3 = mlx5_pci
+        pmd: 0 = auto-select, 1 = QAT, 2 = ISAL, 3 = mlx5_pci, 4 = accel
     """
     params = {'pmd': pmd}
 
@@ -104,7 +116,7 @@ def bdev_crypto_create(client, base_bdev_name, name, crypto_pmd, key, cipher=Non
     Args:
         base_bdev_name: name of the underlying base bdev
         name: name for the crypto vbdev
-        crypto_pmd: name of of the DPDK crypto driver to use
+        crypto_pmd: name of of the DPDK crypto driver to use, or "accel" for the accel framework
         key: key
 
     Returns:
@@ -128,6 +140,37 @@ def bdev_crypto_delete(client, name):
     return client.call('bdev_crypto_delete', params)
 
 
+def bdev_dedup_create(client, base_bdev_name, chunk_size=None, size_in_mib=None):
+    """Construct a dedup virtual block device.
+
+    Args:
+        base_bdev_name: name of the underlying base bdev
+        chunk_size: deduplication chunk size in bytes, a power of two from 4096 to 131072 (optional)
+        size_in_mib: size of the dedup bdev in MiB, may exceed the base bdev capacity (optional)
+
+    Returns:
+        Name of created virtual block device.
+    """
+    params = {'base_bdev_name': base_bdev_name}
+
+    if chunk_size:
+        params['chunk_size'] = chunk_size
+    if size_in_mib:
+        params['size_in_mib'] = size_in_mib
+
+    return client.call('bdev_dedup_create', params)
+
+
+def bdev_dedup_delete(client, name):
+    """Delete dedup virtual block device.
+
+    Args:
+        name: name of dedup vbdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_dedup_delete', params)
+
+
 def bdev_ocf_create(client, name, mode, cache_line_size, cache_bdev_name, core_bdev_name):
     """Add an OCF block device
 
@@ -193,6 +193,21 @@ def bdev_lvol_decouple_parent(client, name):
     return client.call('bdev_lvol_decouple_parent', params)
 
 
+def bdev_lvol_defrag(client, name, max_mbytes_per_sec=None):
+    """Defragment a logical volume.
+
+    Args:
+        name: name of logical volume to defragment
+        max_mbytes_per_sec: maximum copy bandwidth in MiB/s, 0 means unlimited (optional)
+    """
+    params = {
+        'name': name,
+    }
+    if max_mbytes_per_sec is not None:
+        params['max_mbytes_per_sec'] = max_mbytes_per_sec
+    return client.call('bdev_lvol_defrag', params)
+
+
 def bdev_lvol_delete_lvstore(client, uuid=None, lvs_name=None):
     """Destroy a logical volume store.
 
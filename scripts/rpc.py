@@ -220,12 +220,21 @@ if __name__ == "__main__":
         print_json(rpc.bdev.bdev_compress_create(args.client,
                                                  base_bdev_name=args.base_bdev_name,
                                                  pm_path=args.pm_path,
-                                                 lb_size=args.lb_size))
+                                                 lb_size=args.lb_size,
+                                                 comp_algo=args.comp_algo,
+                                                 comp_level=args.comp_level,
+                                                 packed=args.packed))
 
     p = subparsers.add_parser('bdev_compress_create', help='Add a compress vbdev')
     p.add_argument('-b', '--base-bdev-name', help="Name of the base bdev")
-    p.add_argument('-p', '--pm-path', help="Path to persistent memory")
+    p.add_argument('-p', '--pm-path', help="""Path to persistent memory (optional, the volume
+    metadata is kept on the base bdev without it)""")
     p.add_argument('-l', '--lb-size', help="Compressed vol logical block size (optional, if used must be 512 or 4096)", type=int)
+    p.add_argument('-a', '--comp-algo', help="Compression algorithm (optional, default deflate)",
+                   choices=['deflate', 'lz4', 'zstd'])
+    p.add_argument('-c', '--comp-level', help="Compression level (optional, default 1)", type=int)
+    p.add_argument('-k', '--packed', help="Pack compressed chunks into shared backing io units",
+                   action='store_true')
     p.set_defaults(func=bdev_compress_create)
 
     def bdev_compress_delete(args):
@@ -240,7 +249,7 @@ if __name__ == "__main__":
         rpc.bdev.bdev_compress_set_pmd(args.client,
                                        pmd=args.pmd)
     p = subparsers.add_parser('bdev_compress_set_pmd', help='Set pmd option for a compress disk')
-    p.add_argument('-p', '--pmd', type=int, help='0 = auto-select, 1= QAT only, 2 = ISAL only, 3 = mlx5_pci only')
+    p.add_argument('-p', '--pmd', type=int, help='0 = auto-select, 1= QAT only, 2 = ISAL only, 3 = mlx5_pci only, 4 = accel only')
     p.set_defaults(func=bdev_compress_set_pmd)
 
     def bdev_compress_get_orphans(args):
@@ -262,7 +271,7 @@ if __name__ == "__main__":
     p = subparsers.add_parser('bdev_crypto_create', help='Add a crypto vbdev')
     p.add_argument('base_bdev_name', help="Name of the base bdev")
     p.add_argument('name', help="Name of the crypto vbdev")
-    p.add_argument('crypto_pmd', help="Name of the crypto device driver")
+    p.add_argument('crypto_pmd', help="Name of the crypto device driver, or accel to use the accel framework")
     p.add_argument('key', help="Key")
     p.add_argument('-c', '--cipher', help="cipher to use, AES_CBC or AES_XTS (QAT only)")
     p.add_argument('-k2', '--key2', help="2nd key for cipher AET_XTS", default=None)
@@ -276,6 +285,28 @@ if __name__ == "__main__":
     p.add_argument('name', help='crypto bdev name')
     p.set_defaults(func=bdev_crypto_delete)
 
+    def bdev_dedup_create(args):
+        print_json(rpc.bdev.bdev_dedup_create(args.client,
+                                              base_bdev_name=args.base_bdev_name,
+                                              chunk_size=args.chunk_size,
+                                              size_in_mib=args.size_in_mib))
+
+    p = subparsers.add_parser('bdev_dedup_create', help='Add a dedup vbdev')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the base bdev", required=True)
+    p.add_argument('-c', '--chunk-size', help="Deduplication chunk size in bytes (optional, default 16384)",
+                   type=int)
+    p.add_argument('-s', '--size-in-mib', help="""Size of the dedup bdev in MiB (optional, defaults to
+    the physical capacity)""", type=int)
+    p.set_defaults(func=bdev_dedup_create)
+
+    def bdev_dedup_delete(args):
+        rpc.bdev.bdev_dedup_delete(args.client,
+                                   name=args.name)
+
+    p = subparsers.add_parser('bdev_dedup_delete', help='Delete a dedup disk')
+    p.add_argument('name', help='dedup bdev name')
+    p.set_defaults(func=bdev_dedup_delete)
+
     def bdev_ocf_create(args):
         print_json(rpc.bdev.bdev_ocf_create(args.client,
                                             name=args.name,
@@ -1895,6 +1926,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='lvol bdev name')
     p.set_defaults(func=bdev_lvol_decouple_parent)
 
+    def bdev_lvol_defrag(args):
+        rpc.lvol.bdev_lvol_defrag(args.client,
+                                  name=args.name,
+                                  max_mbytes_per_sec=args.max_mbytes_per_sec)
+
+    p = subparsers.add_parser('bdev_lvol_defrag', help='Relocate clusters of lvol to make them contiguous')
+    p.add_argument('name', help='lvol bdev name')
+    p.add_argument('-b', '--max-mbytes-per-sec', help='Maximum copy bandwidth in MiB/s, 0 means unlimited',
+                   type=int, required=False)
+    p.set_defaults(func=bdev_lvol_defrag)
+
     def bdev_lvol_resize(args):
         rpc.lvol.bdev_lvol_resize(args.client,
                                   name=args.name,
@@ -2004,6 +2046,21 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.set_defaults(func=bdev_split_delete)
 
     # ftl
+    def parse_ftl_shards(shards):
+        if shards is None:
+            return None
+        params = []
+        for shard in shards:
+            fields = shard.split(':')
+            if len(fields) < 2 or len(fields) > 4 or not fields[0] or not fields[1]:
+                raise ValueError("Invalid shard '%s', expected base_bdev:cache[:core_mask[:uuid]]" % shard)
+            params.append({'base_bdev': fields[0], 'cache': fields[1]})
+            if len(fields) > 2 and fields[2]:
+                params[-1]['core_mask'] = fields[2]
+            if len(fields) > 3 and fields[3]:
+                params[-1]['uuid'] = fields[3]
+        return params
+
     def bdev_ftl_create(args):
         print_dict(rpc.bdev.bdev_ftl_create(args.client,
                                             name=args.name,
@@ -2013,7 +2070,12 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                             overprovisioning=args.overprovisioning,
                                             l2p_dram_limit=args.l2p_dram_limit,
                                             core_mask=args.core_mask,
-                                            fast_shutdown=args.fast_shutdown))
+                                            fast_shutdown=args.fast_shutdown,
+                                            gc_policy=args.gc_policy,
+                                            l2p_evict_policy=args.l2p_evict_policy,
+                                            wr_cache_blocks=args.wr_cache_blocks,
+                                            shards=parse_ftl_shards(args.shard),
+                                            shard_stripe_mib=args.shard_stripe_mib))
 
     p = subparsers.add_parser('bdev_ftl_create', help='Add FTL bdev')
     p.add_argument('-b', '--name', help="Name of the bdev", required=True)
@@ -2030,6 +2092,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('--core-mask', help='CPU core mask - which cores will be used for ftl core thread, '
                    'by default core thread will be set to the main application core (optional)')
     p.add_argument('-f', '--fast-shutdown', help="Enable fast shutdown", action='store_true')
+    p.add_argument('--gc-policy', help='Garbage collection victim selection policy (optional); default greedy',
+                   choices=['greedy', 'cost_benefit'])
+    p.add_argument('--l2p-evict-policy', help='L2P cache page eviction policy (optional); default lru',
+                   choices=['lru', 'clean_first'])
+    p.add_argument('--wr-cache-blocks', help='Number of recently written blocks kept in DRAM to '
+                   'serve reads from (optional); default 0 (disabled)', type=int)
+    p.add_argument('--shard', action='append', metavar='base_bdev:cache[:core_mask[:uuid]]',
+                   help='Additional FTL device to stripe the LBA space across, can be given multiple '
+                   'times; each one gets its own core thread when core_mask is set (optional)')
+    p.add_argument('--shard-stripe-mib', help='Size of the LBA stripe routed to a single shard in MiB '
+                   '(optional); default 4', type=int)
     p.set_defaults(func=bdev_ftl_create)
 
     def bdev_ftl_load(args):
@@ -2041,7 +2114,12 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                           overprovisioning=args.overprovisioning,
                                           l2p_dram_limit=args.l2p_dram_limit,
                                           core_mask=args.core_mask,
-                                          fast_shutdown=args.fast_shutdown))
+                                          fast_shutdown=args.fast_shutdown,
+                                          gc_policy=args.gc_policy,
+                                          l2p_evict_policy=args.l2p_evict_policy,
+                                          wr_cache_blocks=args.wr_cache_blocks,
+                                          shards=parse_ftl_shards(args.shard),
+                                          shard_stripe_mib=args.shard_stripe_mib))
 
     p = subparsers.add_parser('bdev_ftl_load', help='Load FTL bdev')
     p.add_argument('-b', '--name', help="Name of the bdev", required=True)
@@ -2057,6 +2135,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('--core-mask', help='CPU core mask - which cores will be used for ftl core thread, '
                    'by default core thread will be set to the main application core (optional)')
     p.add_argument('-f', '--fast-shutdown', help="Enable fast shutdown", action='store_true')
+    p.add_argument('--gc-policy', help='Garbage collection victim selection policy (optional); default greedy',
+                   choices=['greedy', 'cost_benefit'])
+    p.add_argument('--l2p-evict-policy', help='L2P cache page eviction policy (optional); default lru',
+                   choices=['lru', 'clean_first'])
+    p.add_argument('--wr-cache-blocks', help='Number of recently written blocks kept in DRAM to '
+                   'serve reads from (optional); default 0 (disabled)', type=int)
+    p.add_argument('--shard', action='append', metavar='base_bdev:cache[:core_mask[:uuid]]',
+                   help='Additional FTL device to stripe the LBA space across, can be given multiple '
+                   'times; each one gets its own core thread when core_mask is set (optional)')
+    p.add_argument('--shard-stripe-mib', help='Size of the LBA stripe routed to a single shard in MiB '
+                   '(optional); default 4', type=int)
     p.set_defaults(func=bdev_ftl_load)
 
     def bdev_ftl_unload(args):
@@ -2637,6 +2726,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-e', '--engine', help='name of engine')
     p.set_defaults(func=accel_assign_opc)
 
+    def accel_set_compress_opts(args):
+        rpc.accel.accel_set_compress_opts(args.client, algo=args.algo, level=args.level)
+
+    p = subparsers.add_parser('accel_set_compress_opts',
+                              help='Set the default algorithm and level of compress operations.')
+    p.add_argument('-a', '--algo', help='compression algorithm', choices=['deflate', 'lz4', 'zstd'],
+                   required=True)
+    p.add_argument('-l', '--level', help="""compression level, 0 is the fastest one of the algorithm,
+    higher levels trade throughput for compression ratio""", type=int)
+    p.set_defaults(func=accel_set_compress_opts)
+
     # ioat
     def ioat_scan_accel_engine(args):
         rpc.ioat.ioat_scan_accel_engine(args.client)
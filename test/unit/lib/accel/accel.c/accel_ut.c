@@ -8,7 +8,7 @@
 #include "spdk_internal/mock.h"
 #include "spdk_internal/accel_engine.h"
 #include "thread/thread_internal.h"
-#include "common/lib/test_env.c"
+#include "common/lib/ut_multithread.c"
 #include "accel/accel.c"
 #include "accel/accel_sw.c"
 #include "unit/lib/json_mock.c"
@@ -70,6 +70,7 @@ test_setup(void)
 	}
 	g_sw_ch = (struct sw_accel_io_channel *)((char *)g_engine_ch + sizeof(
 				struct spdk_io_channel));
+	TAILQ_INIT(&g_sw_ch->tasks_to_execute);
 	TAILQ_INIT(&g_sw_ch->tasks_to_complete);
 	g_accel_module.supports_opcode = _supports_opcode;
 	return 0;
@@ -78,6 +79,7 @@ test_setup(void)
 static int
 test_cleanup(void)
 {
+	sw_accel_destroy_cb(NULL, g_sw_ch);
 	free(g_ch);
 	free(g_engine_ch);
 
@@ -167,6 +169,7 @@ test_spdk_accel_submit_copy(void)
 	/* submission OK. */
 	rc = spdk_accel_submit_copy(g_ch, dst, src, nbytes, flags, NULL, cb_arg);
 	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
 	CU_ASSERT(task.dst == dst);
 	CU_ASSERT(task.src == src);
 	CU_ASSERT(task.op_code == ACCEL_OPC_COPY);
@@ -231,6 +234,7 @@ test_spdk_accel_submit_dualcast(void)
 	/* SW engine does the dualcast. */
 	rc = spdk_accel_submit_dualcast(g_ch, dst1, dst2, src, nbytes, flags, NULL, cb_arg);
 	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
 	CU_ASSERT(task.dst == dst1);
 	CU_ASSERT(task.dst2 == dst2);
 	CU_ASSERT(task.src == src);
@@ -275,6 +279,7 @@ test_spdk_accel_submit_compare(void)
 	/* accel submission OK. */
 	rc = spdk_accel_submit_compare(g_ch, src1, src2, nbytes, NULL, cb_arg);
 	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
 	CU_ASSERT(task.src == src1);
 	CU_ASSERT(task.src2 == src2);
 	CU_ASSERT(task.op_code == ACCEL_OPC_COMPARE);
@@ -288,6 +293,185 @@ test_spdk_accel_submit_compare(void)
 	free(src2);
 }
 
+static void
+test_spdk_accel_submit_xor(void)
+{
+	uint8_t src[3][TEST_SUBMIT_SIZE];
+	uint8_t dst[TEST_SUBMIT_SIZE];
+	void *sources[3] = { src[0], src[1], src[2] };
+	uint64_t nbytes = TEST_SUBMIT_SIZE;
+	struct spdk_accel_task task;
+	struct spdk_accel_task *expected_accel_task = NULL;
+	uint32_t i;
+	int rc;
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+
+	for (i = 0; i < TEST_SUBMIT_SIZE; i++) {
+		src[0][i] = i;
+		src[1][i] = 0xff;
+		src[2][i] = i * 3;
+	}
+	memset(dst, 0, sizeof(dst));
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 3, nbytes, NULL, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* At least two sources are needed */
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 1, nbytes, NULL, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* accel submission OK. */
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 3, nbytes, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.dst == dst);
+	CU_ASSERT(task.nsrcs.srcs == sources);
+	CU_ASSERT(task.nsrcs.cnt == 3);
+	CU_ASSERT(task.op_code == ACCEL_OPC_XOR);
+	CU_ASSERT(task.nbytes == nbytes);
+	CU_ASSERT(task.status == 0);
+	for (i = 0; i < TEST_SUBMIT_SIZE; i++) {
+		CU_ASSERT(dst[i] == (uint8_t)(src[0][i] ^ src[1][i] ^ src[2][i]));
+	}
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(expected_accel_task == &task);
+
+	/* The parity and all but one of the sources give back the missing source */
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	sources[0] = dst;
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 3, nbytes, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(memcmp(dst, src[0], TEST_SUBMIT_SIZE) == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(expected_accel_task == &task);
+}
+
+static void
+test_spdk_accel_submit_compress(void)
+{
+	uint8_t src[4096], comp[4096], decomp[4096];
+	uint32_t comp_size = 0, decomp_size = 0, level;
+	enum spdk_accel_comp_algo algo;
+	struct spdk_accel_task task;
+	struct spdk_accel_task *expected_accel_task = NULL;
+	uint32_t i;
+	int rc;
+
+	for (i = 0; i < sizeof(src); i++) {
+		src[i] = (i / 64) % 7;
+	}
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	task.accel_ch = g_accel_ch;
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* Algorithm names */
+	CU_ASSERT(strcmp(spdk_accel_comp_algo_get_name(SPDK_ACCEL_COMP_ALGO_LZ4), "lz4") == 0);
+	CU_ASSERT(spdk_accel_comp_algo_get_name(SPDK_ACCEL_COMP_ALGO_LAST) == NULL);
+	rc = spdk_accel_comp_algo_get_by_name("zstd", &algo);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(algo == SPDK_ACCEL_COMP_ALGO_ZSTD);
+	rc = spdk_accel_comp_algo_get_by_name("gzip", &algo);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Default options */
+	rc = spdk_accel_set_compress_opts(SPDK_ACCEL_COMP_ALGO_LAST, 0);
+	CU_ASSERT(rc == -EINVAL);
+	spdk_accel_get_compress_opts(&algo, &level);
+	CU_ASSERT(algo == SPDK_ACCEL_COMP_ALGO_DEFLATE);
+	CU_ASSERT(level == 1);
+
+	/* An engine without compress_supports_algo only does deflate */
+	rc = spdk_accel_submit_compress_ext(g_ch, comp, src, sizeof(comp), sizeof(src), &comp_size,
+					    SPDK_ACCEL_COMP_ALGO_LZ4, 0, 0, NULL, NULL);
+	CU_ASSERT(rc == -ENOTSUP);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->task_pool) == &task);
+	CU_ASSERT(spdk_accel_compress_algo_supported(SPDK_ACCEL_COMP_ALGO_DEFLATE));
+	CU_ASSERT(!spdk_accel_compress_algo_supported(SPDK_ACCEL_COMP_ALGO_ZSTD));
+
+	g_accel_module.compress_supports_algo = sw_accel_compress_supports_algo;
+
+	/* Round trip through each algorithm built into the software engine, at its
+	 * fastest and a higher level */
+	for (algo = 0; algo < SPDK_ACCEL_COMP_ALGO_LAST; algo++) {
+		if (!sw_accel_compress_supports_algo(algo)) {
+			rc = spdk_accel_submit_compress_ext(g_ch, comp, src, sizeof(comp), sizeof(src),
+							    &comp_size, algo, 0, 0, NULL, NULL);
+			CU_ASSERT(rc == -ENOTSUP);
+			continue;
+		}
+
+		for (level = 0; level < 16; level += 5) {
+			memset(comp, 0, sizeof(comp));
+			memset(decomp, 0, sizeof(decomp));
+
+			rc = spdk_accel_submit_compress_ext(g_ch, comp, src, sizeof(comp), sizeof(src),
+							    &comp_size, algo, level, 0, NULL, NULL);
+			CU_ASSERT(rc == 0);
+			_sw_accel_execute_tasks(g_sw_ch);
+			CU_ASSERT(task.status == 0);
+			CU_ASSERT(task.comp.algo == algo);
+			CU_ASSERT(task.comp.level == level);
+			CU_ASSERT(comp_size > 0 && comp_size < sizeof(src));
+			expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+			TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+			CU_ASSERT(expected_accel_task == &task);
+			TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+			rc = spdk_accel_submit_decompress_ext(g_ch, decomp, comp, sizeof(decomp), comp_size,
+							      &decomp_size, algo, 0, NULL, NULL);
+			CU_ASSERT(rc == 0);
+			_sw_accel_execute_tasks(g_sw_ch);
+			CU_ASSERT(task.status == 0);
+			CU_ASSERT(decomp_size == sizeof(src));
+			CU_ASSERT(memcmp(decomp, src, sizeof(src)) == 0);
+			expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+			TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+			CU_ASSERT(expected_accel_task == &task);
+			TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+		}
+
+		/* The compressed data doesn't fit in the output buffer */
+		rc = spdk_accel_submit_compress_ext(g_ch, comp, src, 8, sizeof(src), &comp_size, algo, 1,
+						    0, NULL, NULL);
+		CU_ASSERT(rc == 0);
+		_sw_accel_execute_tasks(g_sw_ch);
+		CU_ASSERT(task.status == -ENOSPC);
+		expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+		TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+		CU_ASSERT(expected_accel_task == &task);
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	}
+
+	/* spdk_accel_submit_compress() uses the default options */
+	if (sw_accel_compress_supports_algo(SPDK_ACCEL_COMP_ALGO_LZ4)) {
+		rc = spdk_accel_set_compress_opts(SPDK_ACCEL_COMP_ALGO_LZ4, 3);
+		CU_ASSERT(rc == 0);
+		rc = spdk_accel_submit_compress(g_ch, comp, src, sizeof(comp), sizeof(src), &comp_size, 0,
+						NULL, NULL);
+		CU_ASSERT(rc == 0);
+		CU_ASSERT(task.comp.algo == SPDK_ACCEL_COMP_ALGO_LZ4);
+		CU_ASSERT(task.comp.level == 3);
+		_sw_accel_execute_tasks(g_sw_ch);
+		CU_ASSERT(task.status == 0);
+		expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+		TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+		CU_ASSERT(expected_accel_task == &task);
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+		spdk_accel_set_compress_opts(SPDK_ACCEL_COMP_ALGO_DEFLATE, 1);
+	}
+
+	TAILQ_REMOVE(&g_accel_ch->task_pool, &task, link);
+	g_accel_module.compress_supports_algo = NULL;
+}
+
 static void
 test_spdk_accel_submit_fill(void)
 {
@@ -320,6 +504,7 @@ test_spdk_accel_submit_fill(void)
 	/* accel submission OK. */
 	rc = spdk_accel_submit_fill(g_ch, dst, fill, nbytes, flags, NULL, cb_arg);
 	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
 	CU_ASSERT(task.dst == dst);
 	CU_ASSERT(task.fill_pattern == fill64);
 	CU_ASSERT(task.op_code == ACCEL_OPC_FILL);
@@ -358,6 +543,7 @@ test_spdk_accel_submit_crc32c(void)
 	/* accel submission OK. */
 	rc = spdk_accel_submit_crc32c(g_ch, &crc_dst, src, seed, nbytes, NULL, cb_arg);
 	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
 	CU_ASSERT(task.crc_dst == &crc_dst);
 	CU_ASSERT(task.src == src);
 	CU_ASSERT(task.v.iovcnt == 0);
@@ -396,6 +582,7 @@ test_spdk_accel_submit_crc32cv(void)
 	/* accel submission OK. */
 	rc = spdk_accel_submit_crc32cv(g_ch, &crc_dst, iov, iov_cnt, seed, NULL, cb_arg);
 	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
 	CU_ASSERT(task.v.iovs == iov);
 	CU_ASSERT(task.v.iovcnt == iov_cnt);
 	CU_ASSERT(task.crc_dst == &crc_dst);
@@ -439,6 +626,7 @@ test_spdk_accel_submit_copy_crc32c(void)
 	rc = spdk_accel_submit_copy_crc32c(g_ch, dst, src, &crc_dst, seed, nbytes, flags,
 					   NULL, cb_arg);
 	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
 	CU_ASSERT(task.dst == dst);
 	CU_ASSERT(task.src == src);
 	CU_ASSERT(task.crc_dst == &crc_dst);
@@ -452,6 +640,552 @@ test_spdk_accel_submit_copy_crc32c(void)
 	CU_ASSERT(expected_accel_task == &task);
 }
 
+static int g_seq_status;
+static bool g_seq_done;
+static int g_step_count;
+static struct spdk_accel_task *g_pending_task;
+
+static void
+ut_sequence_cb(void *cb_arg, int status)
+{
+	g_seq_done = true;
+	g_seq_status = status;
+}
+
+static void
+ut_step_cb(void *cb_arg)
+{
+	g_step_count++;
+}
+
+static int
+ut_submit_tasks_fail(struct spdk_io_channel *ch, struct spdk_accel_task *task)
+{
+	return -EIO;
+}
+
+static int
+ut_submit_tasks_pending(struct spdk_io_channel *ch, struct spdk_accel_task *task)
+{
+	g_pending_task = task;
+	return 0;
+}
+
+#define UT_SEQ_NUM_TASKS 8
+static void
+ut_sequence_init_pools(struct spdk_accel_task *tasks, struct spdk_accel_sequence *seq)
+{
+	int i;
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	for (i = 0; i < UT_SEQ_NUM_TASKS; i++) {
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[i], link);
+	}
+	TAILQ_INIT(&g_accel_ch->seq_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->seq_pool, seq, link);
+}
+
+static int
+ut_sequence_num_free_tasks(void)
+{
+	struct spdk_accel_task *task;
+	int count = 0;
+
+	TAILQ_FOREACH(task, &g_accel_ch->task_pool, link) {
+		count++;
+	}
+
+	return count;
+}
+
+#define UT_BATCH_TASKS 3
+static int g_batch_order[UT_BATCH_TASKS + 1];
+static int g_batch_completed;
+static uint8_t g_batch_dst[UT_BATCH_TASKS + 1][TEST_SUBMIT_SIZE];
+static uint8_t g_batch_src[UT_BATCH_TASKS + 1][TEST_SUBMIT_SIZE];
+
+static void
+ut_batch_cb(void *cb_arg, int status)
+{
+	int idx = (int)(uintptr_t)cb_arg;
+	int rc;
+
+	CU_ASSERT(status == 0);
+	/* The data of every task of the pass is in place before the first completion */
+	CU_ASSERT(memcmp(g_batch_dst, g_batch_src, UT_BATCH_TASKS * TEST_SUBMIT_SIZE) == 0);
+	g_batch_order[g_batch_completed++] = idx;
+
+	if (idx == 0) {
+		/* Submitted from a completion, runs in the next pass */
+		rc = spdk_accel_submit_copy(g_ch, g_batch_dst[UT_BATCH_TASKS],
+					    g_batch_src[UT_BATCH_TASKS], TEST_SUBMIT_SIZE, 0,
+					    ut_batch_cb, (void *)(uintptr_t)UT_BATCH_TASKS);
+		CU_ASSERT(rc == 0);
+	}
+}
+
+static void
+test_sw_batch(void)
+{
+	struct spdk_accel_task task[UT_BATCH_TASKS];
+	int i, rc;
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	for (i = 0; i < UT_BATCH_TASKS; i++) {
+		task[i].accel_ch = g_accel_ch;
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task[i], link);
+		memset(g_batch_src[i], i + 1, TEST_SUBMIT_SIZE);
+		memset(g_batch_dst[i], 0, TEST_SUBMIT_SIZE);
+	}
+	memset(g_batch_src[UT_BATCH_TASKS], 0xa5, TEST_SUBMIT_SIZE);
+	memset(g_batch_dst[UT_BATCH_TASKS], 0, TEST_SUBMIT_SIZE);
+	g_batch_completed = 0;
+
+	/* Submission only queues the tasks */
+	for (i = 0; i < UT_BATCH_TASKS; i++) {
+		rc = spdk_accel_submit_copy(g_ch, g_batch_dst[i], g_batch_src[i], TEST_SUBMIT_SIZE,
+					    0, ut_batch_cb, (void *)(uintptr_t)i);
+		CU_ASSERT(rc == 0);
+		CU_ASSERT(memcmp(g_batch_dst[i], g_batch_src[i], TEST_SUBMIT_SIZE) != 0);
+	}
+	CU_ASSERT(TAILQ_EMPTY(&g_accel_ch->task_pool));
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+
+	/* One pass executes all of them, then completes them in submission order */
+	rc = accel_comp_poll(g_sw_ch);
+	CU_ASSERT(rc == SPDK_POLLER_BUSY);
+	CU_ASSERT(g_batch_completed == UT_BATCH_TASKS);
+	for (i = 0; i < UT_BATCH_TASKS; i++) {
+		CU_ASSERT(g_batch_order[i] == i);
+	}
+
+	/* The task submitted by the first completion waits for the next pass */
+	CU_ASSERT(TAILQ_FIRST(&g_sw_ch->tasks_to_execute) == &task[0]);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+	CU_ASSERT(memcmp(g_batch_dst[UT_BATCH_TASKS], g_batch_src[UT_BATCH_TASKS],
+			 TEST_SUBMIT_SIZE) != 0);
+
+	rc = accel_comp_poll(g_sw_ch);
+	CU_ASSERT(rc == SPDK_POLLER_BUSY);
+	CU_ASSERT(g_batch_completed == UT_BATCH_TASKS + 1);
+	CU_ASSERT(g_batch_order[UT_BATCH_TASKS] == UT_BATCH_TASKS);
+	CU_ASSERT(memcmp(g_batch_dst[UT_BATCH_TASKS], g_batch_src[UT_BATCH_TASKS],
+			 TEST_SUBMIT_SIZE) == 0);
+
+	rc = accel_comp_poll(g_sw_ch);
+	CU_ASSERT(rc == SPDK_POLLER_IDLE);
+	CU_ASSERT(g_batch_completed == UT_BATCH_TASKS + 1);
+}
+
+static void
+test_sequence(void)
+{
+	struct spdk_accel_task tasks[UT_SEQ_NUM_TASKS];
+	struct spdk_accel_sequence _seq, *seq;
+	struct spdk_accel_module_if module = {};
+	uint8_t src[TEST_SUBMIT_SIZE], dst[TEST_SUBMIT_SIZE], expected[TEST_SUBMIT_SIZE];
+	struct iovec src_iovs[2], dst_iov, crc_iov;
+	uint32_t crc = 0, expected_crc;
+	int rc;
+
+	allocate_threads(1);
+	set_thread(0);
+	ut_sequence_init_pools(tasks, &_seq);
+
+	memset(expected, 0xa5, sizeof(expected));
+	expected_crc = spdk_crc32c_update(expected, sizeof(expected), ~0u);
+
+	/* fill, then a copy from two source iovecs, then a CRC-32C of the copy.  The
+	 * copy is split in two steps and only the last one reports its completion. */
+	memset(src, 0, sizeof(src));
+	memset(dst, 0, sizeof(dst));
+	src_iovs[0].iov_base = src;
+	src_iovs[0].iov_len = TEST_SUBMIT_SIZE / 2;
+	src_iovs[1].iov_base = src + TEST_SUBMIT_SIZE / 2;
+	src_iovs[1].iov_len = TEST_SUBMIT_SIZE / 2;
+	dst_iov.iov_base = dst;
+	dst_iov.iov_len = TEST_SUBMIT_SIZE;
+	crc_iov = dst_iov;
+	g_step_count = 0;
+	g_seq_done = false;
+	seq = NULL;
+
+	rc = spdk_accel_append_fill(&seq, g_ch, src, TEST_SUBMIT_SIZE, 0xa5, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(seq == &_seq);
+	rc = spdk_accel_append_copy(&seq, g_ch, &dst_iov, 1, src_iovs, 2, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_crc32c(&seq, g_ch, &crc, &crc_iov, 1, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS - 4);
+
+	/* All steps run within finish, but the sequence completes from a message. */
+	spdk_accel_sequence_finish(seq, ut_sequence_cb, NULL);
+	CU_ASSERT(g_step_count == 3);
+	CU_ASSERT(g_seq_done == false);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+	poll_threads();
+	CU_ASSERT(g_seq_done == true);
+	CU_ASSERT(g_seq_status == 0);
+	CU_ASSERT(memcmp(dst, expected, sizeof(expected)) == 0);
+	CU_ASSERT(crc == expected_crc);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->seq_pool) == &_seq);
+
+	/* A CRC-32C of a contiguous copy is merged into the copy. */
+	memset(dst, 0, sizeof(dst));
+	crc = 0;
+	g_step_count = 0;
+	g_seq_done = false;
+	seq = NULL;
+	src_iovs[0].iov_len = TEST_SUBMIT_SIZE;
+	rc = spdk_accel_append_copy(&seq, g_ch, &dst_iov, 1, src_iovs, 1, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_crc32c(&seq, g_ch, &crc, &crc_iov, 1, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(seq == &_seq);
+	SPDK_CU_ASSERT_FATAL(!TAILQ_EMPTY(&seq->tasks));
+	CU_ASSERT(TAILQ_FIRST(&seq->tasks)->op_code == ACCEL_OPC_COPY_CRC32C);
+	CU_ASSERT(TAILQ_NEXT(TAILQ_FIRST(&seq->tasks), seq_link) == NULL);
+	spdk_accel_sequence_finish(seq, ut_sequence_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_seq_done == true);
+	CU_ASSERT(g_seq_status == 0);
+	CU_ASSERT(g_step_count == 1);
+	CU_ASSERT(memcmp(dst, expected, sizeof(expected)) == 0);
+	CU_ASSERT(crc == expected_crc);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS);
+
+	/* Not merged when the copy has a callback of its own. */
+	seq = NULL;
+	rc = spdk_accel_append_copy(&seq, g_ch, &dst_iov, 1, src_iovs, 1, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_crc32c(&seq, g_ch, &crc, &crc_iov, 1, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(seq != NULL);
+	CU_ASSERT(TAILQ_FIRST(&seq->tasks)->op_code == ACCEL_OPC_COPY);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS - 2);
+
+	/* Abort returns everything without running it. */
+	spdk_accel_sequence_abort(seq);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->seq_pool) == &_seq);
+
+	/* No sequence left */
+	TAILQ_INIT(&g_accel_ch->seq_pool);
+	seq = NULL;
+	rc = spdk_accel_append_fill(&seq, g_ch, src, TEST_SUBMIT_SIZE, 0, 0, NULL, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+	CU_ASSERT(seq == NULL);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS);
+	TAILQ_INSERT_TAIL(&g_accel_ch->seq_pool, &_seq, link);
+
+	/* A failed step ends the sequence, the following steps are not executed. */
+	module.submit_tasks = ut_submit_tasks_fail;
+	g_engines_opc[ACCEL_OPC_FILL] = &module;
+	memset(dst, 0, sizeof(dst));
+	g_step_count = 0;
+	g_seq_done = false;
+	seq = NULL;
+	rc = spdk_accel_append_fill(&seq, g_ch, src, TEST_SUBMIT_SIZE, 0, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_copy(&seq, g_ch, &dst_iov, 1, src_iovs, 1, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	spdk_accel_sequence_finish(seq, ut_sequence_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_seq_done == true);
+	CU_ASSERT(g_seq_status == -EIO);
+	CU_ASSERT(g_step_count == 0);
+	CU_ASSERT(dst[0] == 0);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS);
+
+	/* A step completed asynchronously resumes the sequence from its completion. */
+	module.submit_tasks = ut_submit_tasks_pending;
+	g_pending_task = NULL;
+	g_step_count = 0;
+	g_seq_done = false;
+	seq = NULL;
+	rc = spdk_accel_append_fill(&seq, g_ch, src, TEST_SUBMIT_SIZE, 0, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_append_copy(&seq, g_ch, &dst_iov, 1, src_iovs, 1, 0, ut_step_cb, NULL);
+	CU_ASSERT(rc == 0);
+	spdk_accel_sequence_finish(seq, ut_sequence_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_seq_done == false);
+	SPDK_CU_ASSERT_FATAL(g_pending_task != NULL);
+	memset(src, 0x5a, sizeof(src));
+	spdk_accel_task_complete(g_pending_task, 0);
+	CU_ASSERT(g_seq_done == true);
+	CU_ASSERT(g_seq_status == 0);
+	CU_ASSERT(g_step_count == 2);
+	CU_ASSERT(dst[0] == 0x5a);
+	CU_ASSERT(ut_sequence_num_free_tasks() == UT_SEQ_NUM_TASKS);
+
+	g_engines_opc[ACCEL_OPC_FILL] = &g_accel_module;
+	free_threads();
+}
+
+static void
+test_crypto(void)
+{
+	/* IEEE 1619-2007 XTS-AES-128 test vectors 1 and 2 */
+	const uint8_t ct1[32] = {
+		0x91, 0x7c, 0xf6, 0x9e, 0xbd, 0x68, 0xb2, 0xec, 0x9b, 0x9f, 0xe9, 0xa3, 0xea, 0xdd, 0xa6, 0x92,
+		0xcd, 0x43, 0xd2, 0xf5, 0x95, 0x98, 0xed, 0x85, 0x8c, 0x02, 0xc2, 0x65, 0x2f, 0xbf, 0x92, 0x2e
+	};
+	const uint8_t ct2[32] = {
+		0xc4, 0x54, 0x18, 0x5e, 0x6a, 0x16, 0x93, 0x6e, 0x39, 0x33, 0x40, 0x38, 0xac, 0xef, 0x83, 0x8b,
+		0xfb, 0x18, 0x6f, 0xff, 0x74, 0x80, 0xad, 0xc4, 0x28, 0x93, 0x82, 0xec, 0xd6, 0xd3, 0x94, 0xf0
+	};
+	uint8_t key1[32] = {}, key2[32] = {};
+	uint8_t src[TEST_SUBMIT_SIZE], dst[TEST_SUBMIT_SIZE], expected[TEST_SUBMIT_SIZE];
+	struct spdk_accel_crypto_key_create_param param = {
+		.key_name = "ut_key",
+		.cipher = ACCEL_AES_XTS,
+		.key = key1,
+		.key_size = 16,
+		.key2 = key2,
+		.key2_size = 16,
+	};
+	struct spdk_accel_crypto_key *key = NULL, *key_dup;
+	struct spdk_accel_task task;
+	struct iovec src_iovs[3], dst_iov;
+	int rc;
+
+	g_accel_module.crypto_key_init = sw_accel_crypto_key_init;
+	g_accel_module.crypto_key_deinit = sw_accel_crypto_key_deinit;
+
+	/* Parameter checks */
+	param.cipher = "AES_CBC";
+	rc = spdk_accel_crypto_key_create(&param, &key);
+	CU_ASSERT(rc == -EINVAL);
+	param.cipher = ACCEL_AES_XTS;
+	param.key2_size = 32;
+	rc = spdk_accel_crypto_key_create(&param, &key);
+	CU_ASSERT(rc == -EINVAL);
+	param.key2_size = 16;
+
+	rc = spdk_accel_crypto_key_create(&param, &key);
+#ifdef SW_ACCEL_AES_NI
+	if (!__builtin_cpu_supports("aes")) {
+		CU_ASSERT(rc == -ENOTSUP);
+		goto out;
+	}
+#else
+	CU_ASSERT(rc == -ENOTSUP);
+	goto out;
+#endif
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(key != NULL);
+	CU_ASSERT(spdk_accel_crypto_key_get("ut_key") == key);
+	rc = spdk_accel_crypto_key_create(&param, &key_dup);
+	CU_ASSERT(rc == -EEXIST);
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* Vector 1: zero keys, tweak 0, 32 zero bytes, split over iovecs */
+	memset(src, 0, sizeof(src));
+	src_iovs[0].iov_base = src;
+	src_iovs[0].iov_len = 5;
+	src_iovs[1].iov_base = src + 5;
+	src_iovs[1].iov_len = 20;
+	src_iovs[2].iov_base = src + 25;
+	src_iovs[2].iov_len = 7;
+	dst_iov.iov_base = dst;
+	dst_iov.iov_len = 32;
+	rc = spdk_accel_submit_encrypt(g_ch, key, &dst_iov, 1, src_iovs, 3, 0, 32, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.op_code == ACCEL_OPC_ENCRYPT);
+	CU_ASSERT(memcmp(dst, ct1, sizeof(ct1)) == 0);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, &task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* Decrypt back in place */
+	rc = spdk_accel_submit_decrypt(g_ch, key, &dst_iov, 1, &dst_iov, 1, 0, 32, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(memcmp(dst, src, 32) == 0);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, &task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* Length that is not a multiple of the block size fails the task */
+	dst_iov.iov_len = 48;
+	src_iovs[0].iov_len = 48;
+	rc = spdk_accel_submit_encrypt(g_ch, key, &dst_iov, 1, src_iovs, 1, 0, 32, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.status == -EINVAL);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, &task, link);
+	spdk_accel_crypto_key_destroy(key);
+	CU_ASSERT(spdk_accel_crypto_key_get("ut_key") == NULL);
+
+	/* Vector 2 */
+	memset(key1, 0x11, 16);
+	memset(key2, 0x22, 16);
+	rc = spdk_accel_crypto_key_create(&param, &key);
+	CU_ASSERT(rc == 0);
+	memset(src, 0x44, 32);
+	src_iovs[0].iov_len = 32;
+	dst_iov.iov_len = 32;
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	rc = spdk_accel_submit_encrypt(g_ch, key, &dst_iov, 1, src_iovs, 1, 0x3333333333ULL, 32, 0,
+				       NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(memcmp(dst, ct2, sizeof(ct2)) == 0);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, &task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	spdk_accel_crypto_key_destroy(key);
+
+	/* AES-256 round trip over several data units, each with its own tweak */
+	memset(key1, 0x5c, sizeof(key1));
+	memset(key2, 0xa3, sizeof(key2));
+	param.key_size = param.key2_size = 32;
+	rc = spdk_accel_crypto_key_create(&param, &key);
+	CU_ASSERT(rc == 0);
+	memset(expected, 0x7e, sizeof(expected));
+	memcpy(src, expected, sizeof(src));
+	src_iovs[0].iov_len = TEST_SUBMIT_SIZE;
+	dst_iov.iov_len = TEST_SUBMIT_SIZE;
+	rc = spdk_accel_submit_encrypt(g_ch, key, &dst_iov, 1, src_iovs, 1, 10, 32, 0,
+				       NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(memcmp(dst, expected, 32) != 0);
+	/* Identical plaintext, different tweaks */
+	CU_ASSERT(memcmp(dst, dst + 32, 32) != 0);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, &task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	rc = spdk_accel_submit_decrypt(g_ch, key, src_iovs, 1, &dst_iov, 1, 10, 32, 0,
+				       NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(memcmp(src, expected, sizeof(expected)) == 0);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, &task, link);
+	spdk_accel_crypto_key_destroy(key);
+
+out:
+	g_accel_module.crypto_key_init = NULL;
+	g_accel_module.crypto_key_deinit = NULL;
+}
+
+#define UT_DIF_BLOCK_SIZE	(512 + 8)
+#define UT_DIF_NUM_BLOCKS	4
+
+static void
+ut_dif_complete_task(struct spdk_accel_task *task)
+{
+	CU_ASSERT(TAILQ_FIRST(&g_sw_ch->tasks_to_complete) == task);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, task, link);
+}
+
+static void
+test_dif(void)
+{
+	uint8_t data[512 * UT_DIF_NUM_BLOCKS], out[512 * UT_DIF_NUM_BLOCKS];
+	uint8_t ext[UT_DIF_BLOCK_SIZE * UT_DIF_NUM_BLOCKS];
+	struct iovec data_iov = { .iov_base = data, .iov_len = sizeof(data) };
+	struct iovec out_iovs[2], ext_iov = { .iov_base = ext, .iov_len = sizeof(ext) };
+	struct spdk_dif_ctx ctx;
+	struct spdk_dif_error err;
+	struct spdk_accel_task task;
+	uint32_t i;
+	int rc;
+
+	rc = spdk_dif_ctx_init(&ctx, UT_DIF_BLOCK_SIZE, 8, true, false, SPDK_DIF_TYPE1,
+			       SPDK_DIF_FLAGS_GUARD_CHECK | SPDK_DIF_FLAGS_REFTAG_CHECK,
+			       10, 0, 0, 0, 0);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	for (i = 0; i < sizeof(data); i++) {
+		data[i] = i * 7;
+	}
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_dif_generate_copy(g_ch, &ext_iov, 1, &data_iov, 1,
+			UT_DIF_NUM_BLOCKS, &ctx, NULL, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* Insert: copy the data and generate the protection information */
+	rc = spdk_accel_submit_dif_generate_copy(g_ch, &ext_iov, 1, &data_iov, 1,
+			UT_DIF_NUM_BLOCKS, &ctx, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.op_code == ACCEL_OPC_DIF_GENERATE_COPY);
+	CU_ASSERT(task.status == 0);
+	ut_dif_complete_task(&task);
+	for (i = 0; i < UT_DIF_NUM_BLOCKS; i++) {
+		CU_ASSERT(memcmp(ext + i * UT_DIF_BLOCK_SIZE, data + i * 512, 512) == 0);
+	}
+
+	/* Verify in place */
+	rc = spdk_accel_submit_dif_verify(g_ch, &ext_iov, 1, UT_DIF_NUM_BLOCKS, &ctx, &err,
+					  NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.op_code == ACCEL_OPC_DIF_VERIFY);
+	CU_ASSERT(task.status == 0);
+	ut_dif_complete_task(&task);
+
+	/* Strip into a split destination */
+	memset(out, 0, sizeof(out));
+	out_iovs[0].iov_base = out;
+	out_iovs[0].iov_len = 100;
+	out_iovs[1].iov_base = out + 100;
+	out_iovs[1].iov_len = sizeof(out) - 100;
+	rc = spdk_accel_submit_dif_verify_copy(g_ch, out_iovs, 2, &ext_iov, 1, UT_DIF_NUM_BLOCKS,
+					       &ctx, &err, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(memcmp(out, data, sizeof(data)) == 0);
+	ut_dif_complete_task(&task);
+
+	/* A corrupted block is reported through the task status and err */
+	ext[UT_DIF_BLOCK_SIZE * 2 + 3] ^= 0x1;
+	rc = spdk_accel_submit_dif_verify(g_ch, &ext_iov, 1, UT_DIF_NUM_BLOCKS, &ctx, &err,
+					  NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.status == -EIO);
+	CU_ASSERT(err.err_type == SPDK_DIF_GUARD_ERROR);
+	CU_ASSERT(err.err_offset == 2);
+	ut_dif_complete_task(&task);
+
+	/* Generate in place fixes it up again */
+	rc = spdk_accel_submit_dif_generate(g_ch, &ext_iov, 1, UT_DIF_NUM_BLOCKS, &ctx, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.op_code == ACCEL_OPC_DIF_GENERATE);
+	CU_ASSERT(task.status == 0);
+	ut_dif_complete_task(&task);
+	rc = spdk_dif_verify(&ext_iov, 1, UT_DIF_NUM_BLOCKS, &ctx, &err);
+	CU_ASSERT(rc == 0);
+
+	/* Payload shorter than num_blocks */
+	ext_iov.iov_len = UT_DIF_BLOCK_SIZE;
+	rc = spdk_accel_submit_dif_verify(g_ch, &ext_iov, 1, UT_DIF_NUM_BLOCKS, &ctx, &err,
+					  NULL, NULL);
+	CU_ASSERT(rc == 0);
+	_sw_accel_execute_tasks(g_sw_ch);
+	CU_ASSERT(task.status == -EINVAL);
+	ut_dif_complete_task(&task);
+
+	/* Missing destination */
+	rc = spdk_accel_submit_dif_verify_copy(g_ch, NULL, 0, &ext_iov, 1, UT_DIF_NUM_BLOCKS,
+					       &ctx, &err, NULL, NULL);
+	CU_ASSERT(rc == -EINVAL);
+}
+
 static void
 test_spdk_accel_module_find_by_name(void)
 {
@@ -540,9 +1274,15 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_spdk_accel_submit_dualcast);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_compare);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_fill);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_xor);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_compress);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32c);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32cv);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_copy_crc32c);
+	CU_ADD_TEST(suite, test_sw_batch);
+	CU_ADD_TEST(suite, test_sequence);
+	CU_ADD_TEST(suite, test_crypto);
+	CU_ADD_TEST(suite, test_dif);
 	CU_ADD_TEST(suite, test_spdk_accel_module_find_by_name);
 	CU_ADD_TEST(suite, test_spdk_accel_module_register);
 
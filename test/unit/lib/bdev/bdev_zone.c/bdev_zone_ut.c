@@ -8,6 +8,7 @@
 #include "spdk/env.h"
 #include "spdk_internal/mock.h"
 
+#include "common/lib/ut_multithread.c"
 #include "bdev/bdev_zone.c"
 
 DEFINE_STUB_V(bdev_io_init, (struct spdk_bdev_io *bdev_io,
@@ -15,6 +16,22 @@ DEFINE_STUB_V(bdev_io_init, (struct spdk_bdev_io *bdev_io,
 			     spdk_bdev_io_completion_cb cb));
 
 DEFINE_STUB_V(bdev_io_submit, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 64);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+
+#define ZONE_STAGE_ZONE_SIZE	64
+#define ZONE_STAGE_MAX_WRITES	16
+
+/* Writes submitted by the zone write staging */
+struct zone_stage_write {
+	void *buf;
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+};
 
 /* Construct zone_io_operation structure */
 struct zone_io_operation {
@@ -209,6 +226,12 @@ spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
 		bdev->blocklen = g_bdev_blocklen;
 	}
 
+	if (g_io_type == SPDK_BDEV_IO_TYPE_WRITE) {
+		bdev->blocklen = g_bdev_blocklen;
+		bdev->zoned = true;
+		bdev->zone_size = ZONE_STAGE_ZONE_SIZE;
+	}
+
 	g_bdev = bdev;
 
 	return bdev;
@@ -430,6 +453,219 @@ test_bdev_zone_append_with_md(void)
 	stop_operation();
 }
 
+static struct zone_stage_write g_stage_writes[ZONE_STAGE_MAX_WRITES];
+static uint32_t g_num_stage_writes;
+static int g_stage_status[ZONE_STAGE_MAX_WRITES];
+static uint32_t g_num_stage_completions;
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct zone_stage_write *write;
+
+	SPDK_CU_ASSERT_FATAL(g_num_stage_writes < ZONE_STAGE_MAX_WRITES);
+	write = &g_stage_writes[g_num_stage_writes++];
+	write->buf = buf;
+	write->offset_blocks = offset_blocks;
+	write->num_blocks = num_blocks;
+	write->cb = cb;
+	write->cb_arg = cb_arg;
+
+	return 0;
+}
+
+static void
+zone_stage_write_complete(uint32_t idx, bool success)
+{
+	struct zone_stage_write *write = &g_stage_writes[idx];
+
+	write->cb((struct spdk_bdev_io *)0x1, success, write->cb_arg);
+}
+
+static void
+zone_stage_cb(void *cb_arg, int status)
+{
+	g_stage_status[(uintptr_t)cb_arg] = status;
+	g_num_stage_completions++;
+}
+
+static void
+zone_stage_write(struct spdk_bdev_zone_stage *stage, uint64_t offset_blocks,
+		 uint64_t num_blocks, uintptr_t idx)
+{
+	char *buf;
+	int rc;
+
+	buf = calloc(num_blocks, g_bdev_blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, (int)idx + 1, num_blocks * g_bdev_blocklen);
+
+	g_stage_status[idx] = 1;
+	rc = spdk_bdev_zone_stage_write(stage, buf, offset_blocks, num_blocks, zone_stage_cb,
+					(void *)idx);
+	CU_ASSERT(rc == 0);
+	/* The data was copied, so the buffer can be reused right away */
+	free(buf);
+}
+
+static void
+test_bdev_zone_stage(void)
+{
+	struct spdk_bdev_zone_stage_opts opts;
+	struct spdk_bdev_zone_stage *stage;
+	struct spdk_bdev_desc *desc = (void *)0x1;
+	struct spdk_io_channel *ch = (void *)0x1;
+	char *data;
+	int rc;
+
+	g_io_type = SPDK_BDEV_IO_TYPE_WRITE;
+	g_num_stage_writes = 0;
+	g_num_stage_completions = 0;
+
+	spdk_bdev_zone_stage_opts_init(&opts, sizeof(opts));
+	opts.buffer_blocks = 8;
+	opts.num_buffers = 2;
+	opts.num_requests = 8;
+	opts.flush_timeout_us = 100;
+
+	stage = spdk_bdev_zone_stage_create(desc, ch, &opts);
+	SPDK_CU_ASSERT_FATAL(stage != NULL);
+
+	/* Writes crossing a zone boundary are rejected */
+	rc = spdk_bdev_zone_stage_write(stage, NULL, ZONE_STAGE_ZONE_SIZE - 1, 2, zone_stage_cb,
+					NULL);
+	CU_ASSERT(rc == -EINVAL);
+	rc = spdk_bdev_zone_stage_write(stage, NULL, 0, 0, zone_stage_cb, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Small sequential writes are coalesced into a single aligned write */
+	zone_stage_write(stage, 2, 2, 0);
+	zone_stage_write(stage, 4, 3, 1);
+	CU_ASSERT(g_num_stage_writes == 0);
+	zone_stage_write(stage, 7, 3, 2);
+	SPDK_CU_ASSERT_FATAL(g_num_stage_writes == 1);
+	CU_ASSERT(g_stage_writes[0].offset_blocks == 2);
+	CU_ASSERT(g_stage_writes[0].num_blocks == 6);
+	data = g_stage_writes[0].buf;
+	CU_ASSERT(data[0] == 1);
+	CU_ASSERT(data[2 * g_bdev_blocklen] == 2);
+	CU_ASSERT(data[5 * g_bdev_blocklen] == 3);
+
+	/* The first two writes are complete, the third one is still partially staged */
+	zone_stage_write_complete(0, true);
+	CU_ASSERT(g_num_stage_completions == 2);
+	CU_ASSERT(g_stage_status[0] == 0);
+	CU_ASSERT(g_stage_status[1] == 0);
+	CU_ASSERT(g_stage_status[2] == 1);
+
+	/* A write to another zone uses the other buffer, flushed after the timeout */
+	zone_stage_write(stage, ZONE_STAGE_ZONE_SIZE, 1, 3);
+	poll_threads();
+	CU_ASSERT(g_num_stage_writes == 1);
+	spdk_delay_us(opts.flush_timeout_us);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(g_num_stage_writes == 3);
+	CU_ASSERT(g_stage_writes[1].offset_blocks == 8);
+	CU_ASSERT(g_stage_writes[1].num_blocks == 2);
+	CU_ASSERT(g_stage_writes[2].offset_blocks == ZONE_STAGE_ZONE_SIZE);
+	CU_ASSERT(g_stage_writes[2].num_blocks == 1);
+
+	/* Failures are reported to the writes staged in the buffer */
+	zone_stage_write_complete(1, false);
+	zone_stage_write_complete(2, true);
+	CU_ASSERT(g_num_stage_completions == 4);
+	CU_ASSERT(g_stage_status[2] == -EIO);
+	CU_ASSERT(g_stage_status[3] == 0);
+
+	/* Writes to a zone are submitted one buffer at a time */
+	zone_stage_write(stage, 16, 8, 4);
+	zone_stage_write(stage, 24, 4, 5);
+	CU_ASSERT(g_num_stage_writes == 4);
+	spdk_bdev_zone_stage_flush(stage);
+	CU_ASSERT(g_num_stage_writes == 4);
+	CU_ASSERT(spdk_bdev_zone_stage_free(stage) == -EBUSY);
+	zone_stage_write_complete(3, true);
+	SPDK_CU_ASSERT_FATAL(g_num_stage_writes == 5);
+	CU_ASSERT(g_stage_writes[4].offset_blocks == 24);
+	CU_ASSERT(g_stage_writes[4].num_blocks == 4);
+	zone_stage_write_complete(4, true);
+	CU_ASSERT(g_num_stage_completions == 6);
+	CU_ASSERT(g_stage_status[4] == 0);
+	CU_ASSERT(g_stage_status[5] == 0);
+
+	/* Non-sequential writes are only complete once the buffer holding them is written */
+	zone_stage_write(stage, 42, 2, 6);
+	zone_stage_write(stage, 34, 2, 7);
+	SPDK_CU_ASSERT_FATAL(g_num_stage_writes == 6);
+	CU_ASSERT(g_stage_writes[5].offset_blocks == 42);
+	CU_ASSERT(g_stage_writes[5].num_blocks == 2);
+	spdk_bdev_zone_stage_flush(stage);
+	CU_ASSERT(g_num_stage_writes == 6);
+	zone_stage_write_complete(5, true);
+	CU_ASSERT(g_num_stage_completions == 7);
+	CU_ASSERT(g_stage_status[6] == 0);
+	CU_ASSERT(g_stage_status[7] == 1);
+	SPDK_CU_ASSERT_FATAL(g_num_stage_writes == 7);
+	CU_ASSERT(g_stage_writes[6].offset_blocks == 34);
+	CU_ASSERT(g_stage_writes[6].num_blocks == 2);
+	zone_stage_write_complete(6, false);
+	CU_ASSERT(g_num_stage_completions == 8);
+	CU_ASSERT(g_stage_status[7] == -EIO);
+
+	CU_ASSERT(spdk_bdev_zone_stage_free(stage) == 0);
+	stop_operation();
+}
+
+static void
+zone_stage_free_cb(void *cb_arg, int status)
+{
+	struct spdk_bdev_zone_stage **stage = cb_arg;
+
+	g_num_stage_completions++;
+	CU_ASSERT(spdk_bdev_zone_stage_free(*stage) == 0);
+	*stage = NULL;
+}
+
+static void
+test_bdev_zone_stage_free_on_completion(void)
+{
+	struct spdk_bdev_zone_stage_opts opts;
+	struct spdk_bdev_zone_stage *stage;
+	struct spdk_bdev_desc *desc = (void *)0x1;
+	struct spdk_io_channel *ch = (void *)0x1;
+	char *buf;
+	int rc;
+
+	g_io_type = SPDK_BDEV_IO_TYPE_WRITE;
+	g_num_stage_writes = 0;
+	g_num_stage_completions = 0;
+
+	spdk_bdev_zone_stage_opts_init(&opts, sizeof(opts));
+	opts.buffer_blocks = 8;
+	opts.num_buffers = 2;
+	opts.num_requests = 8;
+	opts.flush_timeout_us = 100;
+	buf = calloc(2, g_bdev_blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	stage = spdk_bdev_zone_stage_create(desc, ch, &opts);
+	SPDK_CU_ASSERT_FATAL(stage != NULL);
+
+	/* The stage can be freed from the callback of its last write */
+	rc = spdk_bdev_zone_stage_write(stage, buf, 0, 2, zone_stage_free_cb, &stage);
+	CU_ASSERT(rc == 0);
+	spdk_bdev_zone_stage_flush(stage);
+	SPDK_CU_ASSERT_FATAL(g_num_stage_writes == 1);
+	zone_stage_write_complete(0, true);
+	CU_ASSERT(g_num_stage_completions == 1);
+	CU_ASSERT(stage == NULL);
+
+	free(buf);
+	stop_operation();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -446,10 +682,17 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_bdev_zone_append);
 	CU_ADD_TEST(suite, test_bdev_zone_append_with_md);
 	CU_ADD_TEST(suite, test_bdev_io_get_append_location);
+	CU_ADD_TEST(suite, test_bdev_zone_stage);
+	CU_ADD_TEST(suite, test_bdev_zone_stage_free_on_completion);
+
+	allocate_threads(1);
+	set_thread(0);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
 	num_failures = CU_get_number_of_failures();
 	CU_cleanup_registry();
+
+	free_threads();
 	return num_failures;
 }
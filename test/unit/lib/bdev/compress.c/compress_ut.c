@@ -279,6 +279,8 @@ DEFINE_STUB_V(spdk_reduce_vol_load, (struct spdk_reduce_backing_dev *backing_dev
 				     spdk_reduce_vol_op_with_handle_complete cb_fn, void *cb_arg));
 DEFINE_STUB(spdk_reduce_vol_get_params, const struct spdk_reduce_vol_params *,
 	    (struct spdk_reduce_vol *vol), NULL);
+DEFINE_STUB_V(spdk_reduce_vol_compact, (struct spdk_reduce_vol *vol, uint64_t max_chunks,
+					spdk_reduce_vol_op_complete cb_fn, void *cb_arg));
 DEFINE_STUB_V(spdk_reduce_vol_init, (struct spdk_reduce_vol_params *params,
 				     struct spdk_reduce_backing_dev *backing_dev,
 				     const char *pm_file_dir,
@@ -286,6 +288,21 @@ DEFINE_STUB_V(spdk_reduce_vol_init, (struct spdk_reduce_vol_params *params,
 DEFINE_STUB_V(spdk_reduce_vol_destroy, (struct spdk_reduce_backing_dev *backing_dev,
 					spdk_reduce_vol_op_complete cb_fn, void *cb_arg));
 
+DEFINE_STUB(spdk_accel_get_io_channel, struct spdk_io_channel *, (void), NULL);
+DEFINE_STUB(spdk_accel_compress_algo_supported, bool, (enum spdk_accel_comp_algo algo), true);
+DEFINE_STUB(spdk_accel_comp_algo_get_name, const char *, (enum spdk_accel_comp_algo algo),
+	    "deflate");
+DEFINE_STUB(spdk_accel_comp_algo_get_by_name, int, (const char *name,
+		enum spdk_accel_comp_algo *algo), 0);
+DEFINE_STUB(spdk_accel_submit_compress_ext, int, (struct spdk_io_channel *ch, void *dst,
+		void *src, uint64_t nbytes_dst, uint64_t nbytes_src, uint32_t *output_size,
+		enum spdk_accel_comp_algo algo, uint32_t level, int flags,
+		spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_accel_submit_decompress_ext, int, (struct spdk_io_channel *ch, void *dst,
+		void *src, uint64_t nbytes_dst, uint64_t nbytes_src, uint32_t *output_size,
+		enum spdk_accel_comp_algo algo, int flags,
+		spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
+
 /* DPDK stubs */
 #define DPDK_DYNFIELD_OFFSET offsetof(struct rte_mbuf, dynfield1[1])
 DEFINE_STUB(rte_mbuf_dynfield_register, int, (const struct rte_mbuf_dynfield *params),
@@ -263,6 +263,60 @@ DEFINE_STUB(rte_vdev_init, int, (const char *name, const char *args), 0);
 DEFINE_STUB(rte_cryptodev_sym_session_free, int, (struct rte_cryptodev_sym_session *sess), 0);
 DEFINE_STUB(rte_vdev_uninit, int, (const char *name), 0);
 
+/* accel framework, used by the ACCEL_FW driver */
+DEFINE_STUB(spdk_accel_get_io_channel, struct spdk_io_channel *, (void), NULL);
+DEFINE_STUB(spdk_accel_crypto_key_create, int, (const struct spdk_accel_crypto_key_create_param *param,
+		struct spdk_accel_crypto_key **key), 0);
+DEFINE_STUB_V(spdk_accel_crypto_key_destroy, (struct spdk_accel_crypto_key *key));
+/* The submit mocks save the operation so that a test can complete it. */
+int ut_spdk_accel_submit = 0;
+int ut_accel_op_count = 0;
+struct iovec *ut_accel_dst_iovs;
+struct iovec *ut_accel_src_iovs;
+uint64_t ut_accel_iv;
+uint32_t ut_accel_block_size;
+spdk_accel_completion_cb ut_accel_cb_fn;
+void *ut_accel_cb_arg;
+
+static int
+ut_accel_submit(struct iovec *dst_iovs, struct iovec *src_iovs, uint64_t iv,
+		uint32_t block_size, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	if (ut_spdk_accel_submit != 0) {
+		return ut_spdk_accel_submit;
+	}
+
+	ut_accel_op_count++;
+	ut_accel_dst_iovs = dst_iovs;
+	ut_accel_src_iovs = src_iovs;
+	ut_accel_iv = iv;
+	ut_accel_block_size = block_size;
+	ut_accel_cb_fn = cb_fn;
+	ut_accel_cb_arg = cb_arg;
+
+	return 0;
+}
+
+int
+spdk_accel_submit_encrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return ut_accel_submit(dst_iovs, src_iovs, iv, block_size, cb_fn, cb_arg);
+}
+
+int
+spdk_accel_submit_decrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
+			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			  struct iovec *src_iovs, uint32_t src_iovcnt,
+			  uint64_t iv, uint32_t block_size, int flags,
+			  spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return ut_accel_submit(dst_iovs, src_iovs, iv, block_size, cb_fn, cb_arg);
+}
+
 struct rte_cryptodev *rte_cryptodevs;
 
 /* global vars and setup/cleanup functions used for all test functions */
@@ -1180,6 +1234,92 @@ test_assign_device_qp(void)
 	_clear_device_qp_lists();
 }
 
+static void
+test_accel_rw(void)
+{
+	struct spdk_accel_crypto_key *key = (struct spdk_accel_crypto_key *)0xFEEDBEEF;
+
+	/* The ACCEL_FW driver submits the whole IO as a single operation. */
+	g_crypto_bdev.accel_key = key;
+	g_crypto_ch->accel_ch = g_io_ch;
+	g_crypto_bdev.crypto_bdev.blocklen = 512;
+	g_bdev_io->u.bdev.iovcnt = 1;
+	g_bdev_io->u.bdev.num_blocks = 4;
+	g_bdev_io->u.bdev.offset_blocks = 8;
+	g_bdev_io->u.bdev.iovs[0].iov_len = 4 * 512;
+	g_bdev_io->u.bdev.iovs[0].iov_base = &test_accel_rw;
+
+	/* Write: encrypt into the aux buf, then write it out on completion. */
+	g_bdev_io->type = SPDK_BDEV_IO_TYPE_WRITE;
+	g_bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_completion_called = false;
+	ut_accel_op_count = 0;
+	vbdev_crypto_submit_request(g_io_ch, g_bdev_io);
+	CU_ASSERT(ut_accel_op_count == 1);
+	CU_ASSERT(ut_accel_src_iovs == g_bdev_io->u.bdev.iovs);
+	CU_ASSERT(ut_accel_dst_iovs == &g_io_ctx->aux_buf_iov);
+	CU_ASSERT(g_io_ctx->aux_buf_iov.iov_len == 4 * 512);
+	CU_ASSERT(g_io_ctx->aux_offset_blocks == 8);
+	CU_ASSERT(g_io_ctx->aux_num_blocks == 4);
+	CU_ASSERT(ut_accel_iv == 8);
+	CU_ASSERT(ut_accel_block_size == 512);
+	CU_ASSERT(ut_accel_cb_arg == g_bdev_io);
+	CU_ASSERT(TAILQ_FIRST(&g_crypto_ch->pending_cry_ios) == g_bdev_io);
+	CU_ASSERT(g_completion_called == false);
+
+	ut_accel_cb_fn(ut_accel_cb_arg, 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_crypto_ch->pending_cry_ios));
+	CU_ASSERT(g_io_ctx->on_pending_list == false);
+	CU_ASSERT(g_completion_called == true);
+	CU_ASSERT(g_bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Read: decrypt in place once the base read completes. */
+	g_bdev_io->type = SPDK_BDEV_IO_TYPE_READ;
+	g_bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_completion_called = false;
+	ut_accel_op_count = 0;
+	vbdev_crypto_submit_request(g_io_ch, g_bdev_io);
+	CU_ASSERT(ut_accel_op_count == 1);
+	CU_ASSERT(ut_accel_src_iovs == g_bdev_io->u.bdev.iovs);
+	CU_ASSERT(ut_accel_dst_iovs == g_bdev_io->u.bdev.iovs);
+	CU_ASSERT(ut_accel_iv == 8);
+	CU_ASSERT(g_completion_called == false);
+
+	ut_accel_cb_fn(ut_accel_cb_arg, 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_crypto_ch->pending_cry_ios));
+	CU_ASSERT(g_completion_called == true);
+	CU_ASSERT(g_bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* A failed operation fails the IO. */
+	g_bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_completion_called = false;
+	vbdev_crypto_submit_request(g_io_ch, g_bdev_io);
+	ut_accel_cb_fn(ut_accel_cb_arg, -EIO);
+	CU_ASSERT(TAILQ_EMPTY(&g_crypto_ch->pending_cry_ios));
+	CU_ASSERT(g_completion_called == true);
+	CU_ASSERT(g_bdev_io->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+
+	g_bdev_io->type = SPDK_BDEV_IO_TYPE_WRITE;
+	g_bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_completion_called = false;
+	vbdev_crypto_submit_request(g_io_ch, g_bdev_io);
+	ut_accel_cb_fn(ut_accel_cb_arg, -EIO);
+	CU_ASSERT(TAILQ_EMPTY(&g_crypto_ch->pending_cry_ios));
+	CU_ASSERT(g_completion_called == true);
+	CU_ASSERT(g_bdev_io->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+
+	/* A submission failure leaves nothing on the pending list. */
+	g_bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	ut_spdk_accel_submit = -EINVAL;
+	vbdev_crypto_submit_request(g_io_ch, g_bdev_io);
+	CU_ASSERT(TAILQ_EMPTY(&g_crypto_ch->pending_cry_ios));
+	CU_ASSERT(g_bdev_io->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+	ut_spdk_accel_submit = 0;
+
+	g_crypto_bdev.accel_key = NULL;
+	g_crypto_ch->accel_ch = NULL;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1203,6 +1343,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_reset);
 	CU_ADD_TEST(suite, test_poller);
 	CU_ADD_TEST(suite, test_assign_device_qp);
+	CU_ADD_TEST(suite, test_accel_rw);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
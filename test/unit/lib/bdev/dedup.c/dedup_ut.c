@@ -0,0 +1,552 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "common/lib/ut_multithread.c"
+#include "spdk_internal/mock.h"
+#include "unit/lib/json_mock.c"
+#include "bdev/dedup/vbdev_dedup.c"
+
+#define BLOCK_SIZE	512
+#define BLOCK_CNT	(8 * 1024)	/* 4 MiB */
+#define CHUNK_SIZE	4096
+#define CHUNK_BLOCKS	(CHUNK_SIZE / BLOCK_SIZE)
+
+static struct spdk_bdev g_base_bdev;
+static uint8_t *g_disk;
+static uint32_t g_data_writes;
+static int g_io_status;
+static int g_create_rc;
+static int g_delete_rc;
+static bool g_registered;
+static int g_base_io_device;
+static int g_accel_io_device;
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+
+static TAILQ_HEAD(, spdk_bdev_alias) g_aliases = TAILQ_HEAD_INITIALIZER(g_aliases);
+
+const struct spdk_bdev_aliases_list *
+spdk_bdev_get_aliases(const struct spdk_bdev *bdev)
+{
+	return (const struct spdk_bdev_aliases_list *)&g_aliases;
+}
+
+const char *
+spdk_bdev_get_name(const struct spdk_bdev *bdev)
+{
+	return bdev->name;
+}
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **_desc)
+{
+	*_desc = (void *)&g_base_bdev;
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (void *)desc;
+}
+
+DEFINE_RETURN_MOCK(spdk_bdev_get_io_channel, struct spdk_io_channel *);
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	HANDLE_RETURN_MOCK(spdk_bdev_get_io_channel);
+	return spdk_get_io_channel(&g_base_io_device);
+}
+
+struct spdk_io_channel *
+spdk_accel_get_io_channel(void)
+{
+	return spdk_get_io_channel(&g_accel_io_device);
+}
+
+int
+spdk_bdev_register(struct spdk_bdev *bdev)
+{
+	g_registered = true;
+	return 0;
+}
+
+void
+spdk_bdev_unregister(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	g_registered = false;
+	bdev->fn_table->destruct(bdev->ctxt);
+	if (cb_fn) {
+		cb_fn(cb_arg, 0);
+	}
+}
+
+int
+spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct iovec *iovs,
+			  uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	*crc_dst = spdk_crc32c_iov_update(iovs, iovcnt, ~seed);
+	cb_fn(cb_arg, 0);
+	return 0;
+}
+
+struct ut_base_io {
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+};
+
+static void
+ut_base_io_complete(void *arg)
+{
+	struct ut_base_io *io = arg;
+
+	io->cb(NULL, true, io->cb_arg);
+	free(io);
+}
+
+static int
+ut_base_io(bool write, struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+	   uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_base_io *io = calloc(1, sizeof(*io));
+	uint8_t *buf = g_disk + offset_blocks * BLOCK_SIZE;
+	int i;
+
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	CU_ASSERT(offset_blocks + num_blocks <= BLOCK_CNT);
+	for (i = 0; i < iovcnt; i++) {
+		if (write) {
+			memcpy(buf, iov[i].iov_base, iov[i].iov_len);
+		} else {
+			memcpy(iov[i].iov_base, buf, iov[i].iov_len);
+		}
+		buf += iov[i].iov_len;
+	}
+	CU_ASSERT(buf == g_disk + (offset_blocks + num_blocks) * BLOCK_SIZE);
+
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	spdk_thread_send_msg(spdk_get_thread(), ut_base_io_complete, io);
+	return 0;
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_base_io(false, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = TAILQ_FIRST(&g_vbdev_dedup);
+
+	if (dedup != NULL && offset_blocks >= dedup->data_offset_blocks) {
+		g_data_writes++;
+	}
+	return ut_base_io(true, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	cb(NULL, bdev_io, true);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status == SPDK_BDEV_IO_STATUS_SUCCESS ? 0 : -EIO;
+}
+
+static int
+ut_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+ut_create_cb(void *cb_arg, const char *name, int bdeverrno)
+{
+	g_create_rc = bdeverrno;
+}
+
+static void
+ut_delete_cb(void *cb_arg, int bdeverrno)
+{
+	g_delete_rc = bdeverrno;
+}
+
+static void
+ut_init(void)
+{
+	g_disk = calloc(BLOCK_CNT, BLOCK_SIZE);
+	SPDK_CU_ASSERT_FATAL(g_disk != NULL);
+	memset(&g_base_bdev, 0, sizeof(g_base_bdev));
+	g_base_bdev.name = "base";
+	g_base_bdev.product_name = "Malloc disk";
+	g_base_bdev.blocklen = BLOCK_SIZE;
+	g_base_bdev.blockcnt = BLOCK_CNT;
+	spdk_io_device_register(&g_base_io_device, ut_ch_create_cb, ut_ch_destroy_cb, 0, "base");
+	spdk_io_device_register(&g_accel_io_device, ut_ch_create_cb, ut_ch_destroy_cb, 0, "accel");
+}
+
+static void
+ut_fini(void)
+{
+	spdk_io_device_unregister(&g_base_io_device, NULL);
+	spdk_io_device_unregister(&g_accel_io_device, NULL);
+	poll_threads();
+	free(g_disk);
+	g_disk = NULL;
+}
+
+static struct vbdev_dedup *
+ut_create(uint64_t size_in_mib)
+{
+	g_create_rc = 1;
+	CU_ASSERT(create_dedup_bdev("base", CHUNK_SIZE, size_in_mib, ut_create_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_create_rc == 0);
+	CU_ASSERT(g_registered);
+
+	return TAILQ_FIRST(&g_vbdev_dedup);
+}
+
+static void
+ut_unregister(struct vbdev_dedup *dedup)
+{
+	spdk_bdev_unregister(&dedup->dedup_bdev, NULL, NULL);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&g_vbdev_dedup));
+}
+
+static int
+ut_io(struct vbdev_dedup *dedup, struct spdk_io_channel *ch, enum spdk_bdev_io_type type,
+      void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	struct iovec iov = { .iov_base = buf, .iov_len = num_blocks * BLOCK_SIZE };
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct dedup_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &dedup->dedup_bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.iovs = &iov;
+	bdev_io->u.bdev.iovcnt = 1;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	g_io_status = 1;
+	vbdev_dedup_submit_request(ch, bdev_io);
+	poll_threads();
+	free(bdev_io);
+
+	return g_io_status;
+}
+
+static void
+test_geometry(void)
+{
+	struct dedup_sb sb = {};
+	uint64_t base_size = (uint64_t)BLOCK_CNT * BLOCK_SIZE;
+
+	CU_ASSERT(_dedup_init_geometry(&sb, base_size, CHUNK_SIZE, 0) == 0);
+	CU_ASSERT(sb.num_logical_chunks == sb.num_physical_chunks);
+	CU_ASSERT(sb.map_offset == DEDUP_MD_BLOCK_SIZE);
+	CU_ASSERT(sb.fp_offset >= sb.map_offset + sb.num_logical_chunks * sizeof(uint32_t));
+	CU_ASSERT(sb.data_offset >= sb.fp_offset + sb.num_physical_chunks * sizeof(uint32_t));
+	CU_ASSERT(sb.data_offset % CHUNK_SIZE == 0);
+	CU_ASSERT(sb.data_offset + sb.num_physical_chunks * CHUNK_SIZE <= base_size);
+	/* No room for one more chunk */
+	CU_ASSERT(sb.data_offset + (sb.num_physical_chunks + 1) * CHUNK_SIZE > base_size);
+
+	/* Thin provisioned, the map grows and takes some of the physical space. */
+	CU_ASSERT(_dedup_init_geometry(&sb, base_size, CHUNK_SIZE, 4 * base_size) == 0);
+	CU_ASSERT(sb.num_logical_chunks == 4 * base_size / CHUNK_SIZE);
+	CU_ASSERT(sb.num_physical_chunks < base_size / CHUNK_SIZE);
+	CU_ASSERT(sb.data_offset + sb.num_physical_chunks * CHUNK_SIZE <= base_size);
+
+	CU_ASSERT(_dedup_init_geometry(&sb, 2 * DEDUP_MD_BLOCK_SIZE, CHUNK_SIZE, 0) == -ENOSPC);
+	CU_ASSERT(_dedup_init_geometry(&sb, DEDUP_MD_BLOCK_SIZE, CHUNK_SIZE, 0) == -ENOSPC);
+}
+
+static void
+test_index(void)
+{
+	struct vbdev_dedup *dedup;
+	uint32_t p0, p1, p2;
+
+	ut_init();
+	dedup = ut_create(0);
+	SPDK_CU_ASSERT_FATAL(dedup != NULL);
+
+	p0 = _dedup_alloc_chunk(dedup);
+	p1 = _dedup_alloc_chunk(dedup);
+	p2 = _dedup_alloc_chunk(dedup);
+	CU_ASSERT(p0 != p1 && p1 != p2 && p0 != p2);
+	CU_ASSERT(dedup->used_chunks == 3);
+
+	/* p0 and p2 share a bucket with different fingerprints, p1 collides with p0. */
+	dedup->fps[p0] = 0x1000;
+	dedup->fps[p1] = 0x1000;
+	dedup->fps[p2] = 0x1000 + dedup->bucket_mask + 1;
+	_dedup_index_insert(dedup, p0);
+	_dedup_index_insert(dedup, p1);
+	_dedup_index_insert(dedup, p2);
+	CU_ASSERT(_dedup_index_lookup(dedup, 0x1000) == p1);
+	CU_ASSERT(_dedup_index_lookup(dedup, dedup->fps[p2]) == p2);
+	CU_ASSERT(_dedup_index_lookup(dedup, 0x2000) == DEDUP_INDEX_END);
+
+	/* The last reference removes the chunk from the index and frees it. */
+	_dedup_get_chunk(dedup, p1);
+	_dedup_put_chunk(dedup, p1);
+	CU_ASSERT(_dedup_index_lookup(dedup, 0x1000) == p1);
+	_dedup_put_chunk(dedup, p1);
+	CU_ASSERT(_dedup_index_lookup(dedup, 0x1000) == p0);
+	CU_ASSERT(!spdk_bit_array_get(dedup->allocated, p1));
+	CU_ASSERT(dedup->used_chunks == 2);
+	_dedup_put_chunk(dedup, p0);
+	_dedup_put_chunk(dedup, p2);
+	CU_ASSERT(_dedup_index_lookup(dedup, 0x1000) == DEDUP_INDEX_END);
+	CU_ASSERT(_dedup_index_lookup(dedup, 0x1000 + dedup->bucket_mask + 1) == DEDUP_INDEX_END);
+	CU_ASSERT(dedup->used_chunks == 0);
+
+	ut_unregister(dedup);
+	ut_fini();
+}
+
+static void
+test_write_read(void)
+{
+	struct vbdev_dedup *dedup;
+	struct spdk_io_channel *ch;
+	uint8_t *a, *b, *buf;
+	uint32_t writes, phys;
+
+	ut_init();
+	dedup = ut_create(0);
+	SPDK_CU_ASSERT_FATAL(dedup != NULL);
+	ch = spdk_get_io_channel(dedup);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	a = malloc(CHUNK_SIZE);
+	b = malloc(CHUNK_SIZE);
+	buf = malloc(CHUNK_SIZE);
+	SPDK_CU_ASSERT_FATAL(a != NULL && b != NULL && buf != NULL);
+	memset(a, 0xA5, CHUNK_SIZE);
+	memset(b, 0x5A, CHUNK_SIZE);
+
+	/* Unwritten chunks read as zeroes. */
+	memset(buf, 0xFF, CHUNK_SIZE);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_READ, buf, 0, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(spdk_mem_all_zero(buf, CHUNK_SIZE));
+
+	/* The first copy of a chunk is written, the next ones only update the map. */
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, a, 0, CHUNK_BLOCKS) == 0);
+	writes = g_data_writes;
+	CU_ASSERT(writes == 1);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, a, CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, a, 5 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(g_data_writes == writes);
+	CU_ASSERT(dedup->map[0] == dedup->map[1]);
+	CU_ASSERT(dedup->map[0] == dedup->map[5]);
+	phys = dedup->map[0];
+	CU_ASSERT(dedup->refcnt[phys] == 3);
+	CU_ASSERT(dedup->used_chunks == 1);
+	CU_ASSERT(dedup->chunks_deduplicated == 2);
+
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_READ, buf, 5 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(memcmp(buf, a, CHUNK_SIZE) == 0);
+
+	/* A partial write makes the chunk unique again. */
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, b, CHUNK_BLOCKS + 1, 2) == 0);
+	CU_ASSERT(dedup->map[1] != phys);
+	CU_ASSERT(dedup->refcnt[phys] == 2);
+	CU_ASSERT(dedup->used_chunks == 2);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_READ, buf, CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(memcmp(buf, a, BLOCK_SIZE) == 0);
+	CU_ASSERT(memcmp(buf + BLOCK_SIZE, b, 2 * BLOCK_SIZE) == 0);
+	CU_ASSERT(memcmp(buf + 3 * BLOCK_SIZE, a, CHUNK_SIZE - 3 * BLOCK_SIZE) == 0);
+
+	/* A fingerprint match with different contents gets a chunk of its own. */
+	dedup->fps[dedup->map[1]] = spdk_crc32c_update(b, CHUNK_SIZE, ~0u);
+	_dedup_index_remove(dedup, dedup->map[1]);
+	_dedup_index_insert(dedup, dedup->map[1]);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, b, 2 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(dedup->map[2] != dedup->map[1]);
+	CU_ASSERT(dedup->used_chunks == 3);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_READ, buf, 2 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(memcmp(buf, b, CHUNK_SIZE) == 0);
+
+	/* Zeroes unmap the chunk, the last overwrite of a chunk frees it. */
+	memset(buf, 0, CHUNK_SIZE);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 2 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(dedup->map[2] == DEDUP_CHUNK_EMPTY);
+	CU_ASSERT(dedup->used_chunks == 2);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, b, 0, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, b, 5 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(dedup->refcnt[phys] == 0);
+	CU_ASSERT(!spdk_bit_array_get(dedup->allocated, phys));
+	CU_ASSERT(dedup->map[0] == dedup->map[5]);
+
+	CU_ASSERT(TAILQ_EMPTY(&dedup->executing));
+	CU_ASSERT(dedup->num_free_bufs == DEDUP_NUM_BUFS);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_unregister(dedup);
+	ut_fini();
+	free(a);
+	free(b);
+	free(buf);
+}
+
+static void
+test_examine(void)
+{
+	struct vbdev_dedup *dedup;
+	struct spdk_io_channel *ch;
+	uint32_t map[8], used;
+	uint8_t *a;
+
+	ut_init();
+	dedup = ut_create(64);
+	SPDK_CU_ASSERT_FATAL(dedup != NULL);
+	CU_ASSERT(dedup->dedup_bdev.blockcnt == 64 * 1024 * 1024 / BLOCK_SIZE);
+	ch = spdk_get_io_channel(dedup);
+
+	a = malloc(CHUNK_SIZE);
+	SPDK_CU_ASSERT_FATAL(a != NULL);
+	memset(a, 0x11, CHUNK_SIZE);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, a, 0, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, a, 3 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	memset(a, 0x22, CHUNK_SIZE);
+	/* Past the physical capacity of the base bdev */
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, a, 2000 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	memcpy(map, dedup->map, sizeof(map));
+	used = dedup->used_chunks;
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_unregister(dedup);
+
+	/* The volume is found again with the same mapping. */
+	vbdev_dedup_examine(&g_base_bdev);
+	poll_threads();
+	dedup = TAILQ_FIRST(&g_vbdev_dedup);
+	SPDK_CU_ASSERT_FATAL(dedup != NULL);
+	CU_ASSERT(memcmp(map, dedup->map, sizeof(map)) == 0);
+	CU_ASSERT(dedup->used_chunks == used);
+	CU_ASSERT(dedup->refcnt[map[0]] == 2);
+	CU_ASSERT(dedup->map[2000] != DEDUP_CHUNK_EMPTY);
+
+	/* A new copy of a chunk written before is still deduplicated. */
+	ch = spdk_get_io_channel(dedup);
+	CU_ASSERT(ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, a, 7 * CHUNK_BLOCKS, CHUNK_BLOCKS) == 0);
+	CU_ASSERT(dedup->map[7] == dedup->map[2000]);
+	spdk_put_io_channel(ch);
+	poll_threads();
+
+	/* Deleting erases the superblock. */
+	g_delete_rc = 1;
+	bdev_dedup_delete(dedup->dedup_bdev.name, ut_delete_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_delete_rc == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_vbdev_dedup));
+	vbdev_dedup_examine(&g_base_bdev);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&g_vbdev_dedup));
+
+	ut_fini();
+	free(a);
+}
+
+static void
+test_no_channel(void)
+{
+	struct vbdev_dedup *dedup;
+
+	ut_init();
+
+	/* Creating fails up front without a base bdev channel. */
+	MOCK_SET(spdk_bdev_get_io_channel, NULL);
+	CU_ASSERT(create_dedup_bdev("base", CHUNK_SIZE, 0, ut_create_cb, NULL) == -ENOMEM);
+	MOCK_CLEAR(spdk_bdev_get_io_channel);
+	CU_ASSERT(TAILQ_EMPTY(&g_vbdev_dedup));
+	CU_ASSERT(!g_registered);
+
+	dedup = ut_create(0);
+	SPDK_CU_ASSERT_FATAL(dedup != NULL);
+	ut_unregister(dedup);
+
+	/* So does examining a dedup volume, which is found once the channel is there. */
+	MOCK_SET(spdk_bdev_get_io_channel, NULL);
+	vbdev_dedup_examine(&g_base_bdev);
+	poll_threads();
+	MOCK_CLEAR(spdk_bdev_get_io_channel);
+	CU_ASSERT(TAILQ_EMPTY(&g_vbdev_dedup));
+
+	vbdev_dedup_examine(&g_base_bdev);
+	poll_threads();
+	dedup = TAILQ_FIRST(&g_vbdev_dedup);
+	SPDK_CU_ASSERT_FATAL(dedup != NULL);
+	ut_unregister(dedup);
+
+	ut_fini();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("dedup", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_geometry);
+	CU_ADD_TEST(suite, test_index);
+	CU_ADD_TEST(suite, test_write_read);
+	CU_ADD_TEST(suite, test_examine);
+	CU_ADD_TEST(suite, test_no_channel);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+
+	free_threads();
+
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -0,0 +1,747 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "common/lib/ut_multithread.c"
+#include "spdk_internal/mock.h"
+#include "unit/lib/json_mock.c"
+#include "ftl/utils/ftl_conf.c"
+#include "bdev/ftl/bdev_ftl.c"
+
+#define UT_NUM_SHARDS		3
+#define UT_BLOCK_SIZE		4096
+#define UT_STRIPE_MIB		1
+#define UT_STRIPE_BLOCKS	(UT_STRIPE_MIB * 1024 * 1024 / UT_BLOCK_SIZE)
+/* Blocks of each FTL device, the bdev only exposes whole stripes of them */
+#define UT_DEV_BLOCKS		(UT_STRIPE_BLOCKS * 9 + 5)
+#define UT_OPTIMUM_IO_SIZE	64
+#define UT_IO_SIZE		64
+#define UT_MAX_UNMAPS		FTL_BDEV_MAX_SHARDS
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB_V(spdk_bdev_destruct_done, (struct spdk_bdev *bdev, int bdeverrno));
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_ftl_init, int, (void), 0);
+DEFINE_STUB_V(spdk_ftl_fini, (void));
+DEFINE_STUB_V(spdk_ftl_dev_set_fast_shutdown, (struct spdk_ftl_dev *dev, bool fast_shutdown));
+
+/* FTL devices, each one is also registered as the io_device of its IO channels */
+static struct spdk_ftl_dev g_dev[FTL_BDEV_MAX_SHARDS];
+static struct spdk_uuid g_dev_uuid[FTL_BDEV_MAX_SHARDS];
+static uint64_t g_dev_blocks[FTL_BDEV_MAX_SHARDS];
+static struct spdk_ftl_conf g_init_conf[FTL_BDEV_MAX_SHARDS];
+static size_t g_num_inits;
+static size_t g_init_fail_idx;
+static size_t g_free_order[FTL_BDEV_MAX_SHARDS];
+static size_t g_num_frees;
+static int g_stats_rc[FTL_BDEV_MAX_SHARDS];
+static int g_unmap_rc[FTL_BDEV_MAX_SHARDS];
+
+static struct spdk_bdev g_base_bdev;
+static struct spdk_bdev *g_registered_bdev;
+static int g_create_status;
+static struct spdk_uuid g_create_uuid;
+static int g_io_status;
+static size_t g_io_completions;
+static struct spdk_io_channel *g_io_ch;
+
+struct ut_ftl_io {
+	size_t			dev_idx;
+	struct ftl_io		*io;
+	struct spdk_io_channel	*ch;
+	uint64_t		lba;
+	uint64_t		num_blocks;
+	spdk_ftl_fn		cb_fn;
+	void			*cb_arg;
+};
+
+static struct ut_ftl_io g_last_rw;
+static struct ut_ftl_io g_unmaps[UT_MAX_UNMAPS];
+static size_t g_num_unmaps;
+
+static size_t
+ut_dev_idx(const struct spdk_ftl_dev *dev)
+{
+	size_t idx = dev - g_dev;
+
+	SPDK_CU_ASSERT_FATAL(idx < FTL_BDEV_MAX_SHARDS);
+	return idx;
+}
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **_desc)
+{
+	if (g_registered_bdev && !strcmp(bdev_name, g_registered_bdev->name)) {
+		*_desc = (void *)g_registered_bdev;
+	} else {
+		*_desc = (void *)&g_base_bdev;
+	}
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (void *)desc;
+}
+
+int
+spdk_bdev_register(struct spdk_bdev *bdev)
+{
+	g_registered_bdev = bdev;
+	return 0;
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	cb(g_io_ch, bdev_io, true);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+	g_io_completions++;
+}
+
+size_t
+spdk_ftl_io_size(void)
+{
+	return UT_IO_SIZE;
+}
+
+int
+spdk_ftl_dev_init(const struct spdk_ftl_conf *conf, spdk_ftl_init_fn cb, void *cb_arg)
+{
+	size_t idx = g_num_inits++;
+
+	g_init_conf[idx] = *conf;
+	if (idx == g_init_fail_idx) {
+		cb(NULL, cb_arg, -EIO);
+		return 0;
+	}
+
+	/* The UUID of created devices is generated */
+	g_dev_uuid[idx] = conf->uuid;
+	if (conf->mode & SPDK_FTL_MODE_CREATE) {
+		spdk_uuid_generate(&g_dev_uuid[idx]);
+	}
+	g_dev[idx].conf.uuid = g_dev_uuid[idx];
+
+	cb(&g_dev[idx], cb_arg, 0);
+	return 0;
+}
+
+int
+spdk_ftl_dev_free(struct spdk_ftl_dev *dev, spdk_ftl_fn cb, void *cb_arg)
+{
+	g_free_order[g_num_frees++] = ut_dev_idx(dev);
+	cb(cb_arg, 0);
+	return 0;
+}
+
+void
+spdk_ftl_dev_get_attrs(const struct spdk_ftl_dev *dev, struct spdk_ftl_attrs *attr,
+		       size_t attrs_size)
+{
+	memset(attr, 0, attrs_size);
+	attr->num_blocks = g_dev_blocks[ut_dev_idx(dev)];
+	attr->block_size = UT_BLOCK_SIZE;
+	attr->optimum_io_size = UT_OPTIMUM_IO_SIZE;
+}
+
+struct spdk_io_channel *
+spdk_ftl_get_io_channel(struct spdk_ftl_dev *dev)
+{
+	return spdk_get_io_channel(dev);
+}
+
+static int
+ut_ftl_io(struct ut_ftl_io *ftl_io, struct spdk_ftl_dev *dev, struct ftl_io *io,
+	  struct spdk_io_channel *ch, uint64_t lba, uint64_t num_blocks, spdk_ftl_fn cb_fn,
+	  void *cb_arg)
+{
+	ftl_io->dev_idx = ut_dev_idx(dev);
+	ftl_io->io = io;
+	ftl_io->ch = ch;
+	ftl_io->lba = lba;
+	ftl_io->num_blocks = num_blocks;
+	ftl_io->cb_fn = cb_fn;
+	ftl_io->cb_arg = cb_arg;
+	return 0;
+}
+
+int
+spdk_ftl_readv(struct spdk_ftl_dev *dev, struct ftl_io *io, struct spdk_io_channel *ch,
+	       uint64_t lba, uint64_t lba_cnt, struct iovec *iov, size_t iov_cnt, spdk_ftl_fn cb_fn,
+	       void *cb_arg)
+{
+	return ut_ftl_io(&g_last_rw, dev, io, ch, lba, lba_cnt, cb_fn, cb_arg);
+}
+
+int
+spdk_ftl_writev(struct spdk_ftl_dev *dev, struct ftl_io *io, struct spdk_io_channel *ch,
+		uint64_t lba, uint64_t lba_cnt, struct iovec *iov, size_t iov_cnt,
+		spdk_ftl_fn cb_fn, void *cb_arg)
+{
+	return ut_ftl_io(&g_last_rw, dev, io, ch, lba, lba_cnt, cb_fn, cb_arg);
+}
+
+int
+spdk_ftl_unmap(struct spdk_ftl_dev *dev, struct ftl_io *io, struct spdk_io_channel *ch,
+	       uint64_t lba, uint64_t lba_cnt, spdk_ftl_fn cb_fn, void *cb_arg)
+{
+	size_t idx = ut_dev_idx(dev);
+
+	if (g_unmap_rc[idx]) {
+		return g_unmap_rc[idx];
+	}
+
+	SPDK_CU_ASSERT_FATAL(g_num_unmaps < UT_MAX_UNMAPS);
+	return ut_ftl_io(&g_unmaps[g_num_unmaps++], dev, io, ch, lba, lba_cnt, cb_fn, cb_arg);
+}
+
+int
+spdk_ftl_get_stats(struct spdk_ftl_dev *dev, struct ftl_stats *stats, spdk_ftl_stats_fn cb_fn,
+		   void *cb_arg)
+{
+	size_t idx = ut_dev_idx(dev);
+
+	if (g_stats_rc[idx]) {
+		return g_stats_rc[idx];
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	stats->entries[FTL_STATS_TYPE_USER].write.ios = idx + 1;
+	cb_fn(stats, cb_arg);
+	return 0;
+}
+
+static int
+ut_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+ut_create_cb(const struct ftl_bdev_info *info, void *ctx, int status)
+{
+	g_create_status = status;
+	if (info) {
+		g_create_uuid = info->uuid;
+	}
+}
+
+static void
+ut_reset(void)
+{
+	g_num_inits = 0;
+	g_init_fail_idx = SIZE_MAX;
+	g_num_frees = 0;
+	g_num_unmaps = 0;
+	g_io_completions = 0;
+	g_registered_bdev = NULL;
+	g_create_status = 1;
+	memset(g_stats_rc, 0, sizeof(g_stats_rc));
+	memset(g_unmap_rc, 0, sizeof(g_unmap_rc));
+}
+
+static void
+ut_init_conf(struct ftl_bdev_conf *conf, size_t num_shards)
+{
+	size_t i;
+
+	memset(conf, 0, sizeof(*conf));
+	for (i = 0; i < num_shards; i++) {
+		spdk_ftl_get_default_conf(&conf->shard[i], sizeof(conf->shard[i]));
+		conf->shard[i].name = i == 0 ? "ftl0" : NULL;
+		conf->shard[i].base_bdev = "base";
+		conf->shard[i].cache_bdev = "cache";
+		conf->shard[i].mode = SPDK_FTL_MODE_CREATE;
+	}
+	conf->num_shards = num_shards;
+	conf->shard_stripe_mib = UT_STRIPE_MIB;
+}
+
+static struct ftl_bdev *
+ut_create_bdev(size_t num_shards)
+{
+	struct ftl_bdev_conf conf;
+
+	ut_reset();
+	ut_init_conf(&conf, num_shards);
+
+	CU_ASSERT(bdev_ftl_create_bdev(&conf, ut_create_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_registered_bdev != NULL);
+
+	return g_registered_bdev->ctxt;
+}
+
+static void
+ut_destroy_bdev(struct ftl_bdev *ftl_bdev)
+{
+	CU_ASSERT(bdev_ftl_destruct(ftl_bdev) == 1);
+	poll_threads();
+	g_registered_bdev = NULL;
+}
+
+static struct spdk_bdev_io *
+ut_alloc_bdev_io(struct ftl_bdev *ftl_bdev, enum spdk_bdev_io_type type, uint64_t lba,
+		 uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + UT_IO_SIZE);
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &ftl_bdev->bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = lba;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	return bdev_io;
+}
+
+static void
+test_shard_lba(void)
+{
+	struct ftl_bdev ftl_bdev = {};
+	uint64_t shard_lbas[FTL_BDEV_MAX_SHARDS];
+	size_t num_shards[] = { 1, 2, 3, FTL_BDEV_MAX_SHARDS };
+	uint64_t stripe_blocks[] = { 1, 8, 256 };
+	uint64_t lba, row_blocks;
+	size_t i, j, idx;
+
+	for (i = 0; i < SPDK_COUNTOF(num_shards); i++) {
+		for (j = 0; j < SPDK_COUNTOF(stripe_blocks); j++) {
+			ftl_bdev.num_shards = num_shards[i];
+			ftl_bdev.stripe_blocks = stripe_blocks[j];
+			row_blocks = ftl_bdev.num_shards * ftl_bdev.stripe_blocks;
+			memset(shard_lbas, 0, sizeof(shard_lbas));
+
+			/*
+			 * Walk the LBAs in order, the LBA of each shard is the number of LBAs
+			 * already routed to it, which is also what the other shards report
+			 * for the current LBA.
+			 */
+			for (lba = 0; lba < row_blocks * 5; lba++) {
+				idx = bdev_ftl_shard_idx(&ftl_bdev, lba);
+				CU_ASSERT(idx == (lba / stripe_blocks[j]) % num_shards[i]);
+
+				for (idx = 0; idx < ftl_bdev.num_shards; idx++) {
+					CU_ASSERT(bdev_ftl_shard_lba(&ftl_bdev, idx, lba) ==
+						  shard_lbas[idx]);
+				}
+
+				shard_lbas[bdev_ftl_shard_idx(&ftl_bdev, lba)]++;
+			}
+
+			/* Each shard got the same number of whole stripes */
+			for (idx = 0; idx < ftl_bdev.num_shards; idx++) {
+				CU_ASSERT(shard_lbas[idx] == ftl_bdev.stripe_blocks * 5);
+				CU_ASSERT(bdev_ftl_shard_lba(&ftl_bdev, idx, lba) ==
+					  shard_lbas[idx]);
+			}
+		}
+	}
+}
+
+static void
+test_create(void)
+{
+	struct ftl_bdev *ftl_bdev;
+	struct ftl_bdev_conf conf;
+	size_t i;
+
+	/* The smallest shard limits the size of all of them */
+	g_dev_blocks[0] = UT_STRIPE_BLOCKS * 10 + 17;
+	g_dev_blocks[2] = UT_STRIPE_BLOCKS * 10 + 17;
+
+	ftl_bdev = ut_create_bdev(UT_NUM_SHARDS);
+	CU_ASSERT(ftl_bdev->num_shards == UT_NUM_SHARDS);
+	CU_ASSERT(ftl_bdev->stripe_blocks == UT_STRIPE_BLOCKS);
+	CU_ASSERT(ftl_bdev->bdev.blockcnt == UT_STRIPE_BLOCKS * 9 * UT_NUM_SHARDS);
+	CU_ASSERT(ftl_bdev->bdev.optimal_io_boundary == UT_OPTIMUM_IO_SIZE);
+
+	/* The bdev's UUID is the one of the first shard, which is recorded by all of them */
+	CU_ASSERT(spdk_uuid_compare(&ftl_bdev->bdev.uuid, &g_dev_uuid[0]) == 0);
+	CU_ASSERT(spdk_uuid_compare(&g_create_uuid, &g_dev_uuid[0]) == 0);
+	CU_ASSERT(g_num_inits == UT_NUM_SHARDS);
+	for (i = 0; i < UT_NUM_SHARDS; i++) {
+		CU_ASSERT(g_init_conf[i].shard.idx == i);
+		CU_ASSERT(g_init_conf[i].shard.count == UT_NUM_SHARDS);
+		CU_ASSERT(g_init_conf[i].shard.stripe_mib == UT_STRIPE_MIB);
+		if (i > 0) {
+			CU_ASSERT(spdk_uuid_compare(&g_init_conf[i].shard.set_uuid,
+						    &g_dev_uuid[0]) == 0);
+		}
+	}
+
+	/* Shards are freed in reverse order */
+	ut_destroy_bdev(ftl_bdev);
+	CU_ASSERT(g_num_frees == UT_NUM_SHARDS);
+	CU_ASSERT(g_free_order[0] == 2);
+	CU_ASSERT(g_free_order[1] == 1);
+	CU_ASSERT(g_free_order[2] == 0);
+	g_dev_blocks[0] = UT_DEV_BLOCKS;
+	g_dev_blocks[2] = UT_DEV_BLOCKS;
+
+	/* A single shard bdev isn't a set */
+	ftl_bdev = ut_create_bdev(1);
+	CU_ASSERT(ftl_bdev->bdev.blockcnt == g_dev_blocks[0]);
+	CU_ASSERT(g_init_conf[0].shard.count == 0);
+	ut_destroy_bdev(ftl_bdev);
+	CU_ASSERT(g_num_frees == 1);
+
+	/* Failure of a shard's initialization frees the ones initialized before */
+	ut_reset();
+	g_init_fail_idx = 2;
+	ut_init_conf(&conf, UT_NUM_SHARDS);
+	CU_ASSERT(bdev_ftl_create_bdev(&conf, ut_create_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == -EIO);
+	CU_ASSERT(g_registered_bdev == NULL);
+	CU_ASSERT(g_num_frees == 2);
+	CU_ASSERT(g_free_order[0] == 1);
+	CU_ASSERT(g_free_order[1] == 0);
+
+	/* Shards which don't fit a whole stripe */
+	ut_reset();
+	g_dev_blocks[1] = UT_STRIPE_BLOCKS - 1;
+	ut_init_conf(&conf, UT_NUM_SHARDS);
+	CU_ASSERT(bdev_ftl_create_bdev(&conf, ut_create_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == -EINVAL);
+	CU_ASSERT(g_registered_bdev == NULL);
+	CU_ASSERT(g_num_frees == UT_NUM_SHARDS);
+	g_dev_blocks[1] = UT_DEV_BLOCKS;
+}
+
+static void
+test_io_routing(void)
+{
+	struct ftl_bdev *ftl_bdev;
+	struct ftl_bdev_io_channel *ftl_ch;
+	struct spdk_bdev_io *bdev_io;
+	uint64_t lbas[] = { 0, 17, UT_STRIPE_BLOCKS, UT_STRIPE_BLOCKS * 2 + 5,
+			    UT_STRIPE_BLOCKS * 3 + 64, UT_STRIPE_BLOCKS * 7 + 128
+			  };
+	enum spdk_bdev_io_type types[] = { SPDK_BDEV_IO_TYPE_READ, SPDK_BDEV_IO_TYPE_WRITE };
+	size_t i, j, idx;
+
+	ftl_bdev = ut_create_bdev(UT_NUM_SHARDS);
+	g_io_ch = bdev_ftl_get_io_channel(ftl_bdev);
+	SPDK_CU_ASSERT_FATAL(g_io_ch != NULL);
+	ftl_ch = spdk_io_channel_get_ctx(g_io_ch);
+
+	for (i = 0; i < SPDK_COUNTOF(types); i++) {
+		for (j = 0; j < SPDK_COUNTOF(lbas); j++) {
+			bdev_io = ut_alloc_bdev_io(ftl_bdev, types[i], lbas[j], 8);
+			memset(&g_last_rw, 0, sizeof(g_last_rw));
+
+			bdev_ftl_submit_request(g_io_ch, bdev_io);
+
+			/* The IO goes to the shard owning the LBA, with the LBA within the shard */
+			idx = (lbas[j] / UT_STRIPE_BLOCKS) % UT_NUM_SHARDS;
+			CU_ASSERT(g_last_rw.dev_idx == idx);
+			CU_ASSERT(g_last_rw.ch == ftl_ch->shard_ch[idx]);
+			CU_ASSERT(g_last_rw.lba == (lbas[j] / (UT_STRIPE_BLOCKS * UT_NUM_SHARDS)) *
+				  UT_STRIPE_BLOCKS + lbas[j] % UT_STRIPE_BLOCKS);
+			CU_ASSERT(g_last_rw.num_blocks == 8);
+			CU_ASSERT(g_last_rw.io == (struct ftl_io *)bdev_io->driver_ctx);
+			CU_ASSERT(g_last_rw.cb_arg == bdev_io);
+
+			g_io_completions = 0;
+			g_last_rw.cb_fn(g_last_rw.cb_arg, 0);
+			CU_ASSERT(g_io_completions == 1);
+			CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			free(bdev_io);
+		}
+	}
+
+	spdk_put_io_channel(g_io_ch);
+	g_io_ch = NULL;
+	poll_threads();
+	ut_destroy_bdev(ftl_bdev);
+}
+
+/* Checks the unmaps submitted to the shards cover the LBAs of the range routed to them */
+static void
+ut_check_unmaps(struct ftl_bdev *ftl_bdev, uint64_t lba, uint64_t num_blocks)
+{
+	uint64_t first[FTL_BDEV_MAX_SHARDS], count[FTL_BDEV_MAX_SHARDS] = {};
+	uint64_t i;
+	size_t idx, num_unmaps = 0;
+
+	for (i = lba; i < lba + num_blocks; i++) {
+		idx = bdev_ftl_shard_idx(ftl_bdev, i);
+		if (count[idx]++ == 0) {
+			first[idx] = bdev_ftl_shard_lba(ftl_bdev, idx, i);
+		}
+	}
+
+	for (idx = 0; idx < ftl_bdev->num_shards; idx++) {
+		if (count[idx] == 0) {
+			continue;
+		}
+
+		SPDK_CU_ASSERT_FATAL(num_unmaps < g_num_unmaps);
+		CU_ASSERT(g_unmaps[num_unmaps].dev_idx == idx);
+		CU_ASSERT(g_unmaps[num_unmaps].lba == first[idx]);
+		CU_ASSERT(g_unmaps[num_unmaps].num_blocks == count[idx]);
+		num_unmaps++;
+	}
+
+	CU_ASSERT(num_unmaps == g_num_unmaps);
+}
+
+static void
+ut_unmap_cb(void *cb_arg, int status)
+{
+	g_io_status = status;
+	g_io_completions++;
+}
+
+static void
+test_unmap(void)
+{
+	struct ftl_bdev *ftl_bdev;
+	struct ftl_bdev_io_channel *ftl_ch;
+	struct spdk_bdev_io *bdev_io;
+	uint64_t ranges[][2] = {
+		{ 0, 8 },
+		{ 100, UT_STRIPE_BLOCKS },
+		{ UT_STRIPE_BLOCKS - 1, 2 },
+		{ 100, UT_STRIPE_BLOCKS * 5 + 50 },
+		{ 0, UT_STRIPE_BLOCKS * 9 * UT_NUM_SHARDS },
+	};
+	size_t i, j;
+
+	ftl_bdev = ut_create_bdev(UT_NUM_SHARDS);
+	g_io_ch = bdev_ftl_get_io_channel(ftl_bdev);
+	SPDK_CU_ASSERT_FATAL(g_io_ch != NULL);
+	ftl_ch = spdk_io_channel_get_ctx(g_io_ch);
+
+	for (i = 0; i < SPDK_COUNTOF(ranges); i++) {
+		bdev_io = ut_alloc_bdev_io(ftl_bdev, SPDK_BDEV_IO_TYPE_UNMAP, ranges[i][0],
+					   ranges[i][1]);
+		g_num_unmaps = 0;
+		g_io_completions = 0;
+
+		bdev_ftl_submit_request(g_io_ch, bdev_io);
+		ut_check_unmaps(ftl_bdev, ranges[i][0], ranges[i][1]);
+
+		/* The bdev IO is only completed once all the shards are done */
+		for (j = 0; j < g_num_unmaps; j++) {
+			CU_ASSERT(g_unmaps[j].ch == ftl_ch->shard_ch[g_unmaps[j].dev_idx]);
+			CU_ASSERT(g_unmaps[j].io != NULL);
+			CU_ASSERT(j == 0 || g_unmaps[j].io != g_unmaps[j - 1].io);
+			CU_ASSERT(g_io_completions == 0);
+			g_unmaps[j].cb_fn(g_unmaps[j].cb_arg, 0);
+		}
+		CU_ASSERT(g_io_completions == 1);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		free(bdev_io);
+	}
+
+	/* The unmap RPC uses the shards' management path */
+	g_num_unmaps = 0;
+	g_io_completions = 0;
+	bdev_ftl_unmap(ftl_bdev->bdev.name, 100, UT_STRIPE_BLOCKS * 2, ut_unmap_cb, NULL);
+	ut_check_unmaps(ftl_bdev, 100, UT_STRIPE_BLOCKS * 2);
+	for (j = 0; j < g_num_unmaps; j++) {
+		CU_ASSERT(g_unmaps[j].ch == NULL);
+		CU_ASSERT(g_unmaps[j].io == NULL);
+		g_unmaps[j].cb_fn(g_unmaps[j].cb_arg, 0);
+	}
+	CU_ASSERT(g_io_completions == 1);
+	CU_ASSERT(g_io_status == 0);
+
+	/* Ranges outside of the bdev are rejected */
+	g_num_unmaps = 0;
+	g_io_completions = 0;
+	bdev_ftl_unmap(ftl_bdev->bdev.name, ftl_bdev->bdev.blockcnt - 1, 2, ut_unmap_cb, NULL);
+	CU_ASSERT(g_num_unmaps == 0);
+	CU_ASSERT(g_io_completions == 1);
+	CU_ASSERT(g_io_status == -EINVAL);
+
+	spdk_put_io_channel(g_io_ch);
+	g_io_ch = NULL;
+	poll_threads();
+	ut_destroy_bdev(ftl_bdev);
+}
+
+static void
+test_unmap_error(void)
+{
+	struct ftl_bdev *ftl_bdev;
+	struct spdk_bdev_io *bdev_io;
+
+	ftl_bdev = ut_create_bdev(UT_NUM_SHARDS);
+	g_io_ch = bdev_ftl_get_io_channel(ftl_bdev);
+	SPDK_CU_ASSERT_FATAL(g_io_ch != NULL);
+
+	/* An error of one of the shards fails the whole IO once all of them are done */
+	bdev_io = ut_alloc_bdev_io(ftl_bdev, SPDK_BDEV_IO_TYPE_UNMAP, 0, UT_STRIPE_BLOCKS * 3);
+	g_num_unmaps = 0;
+	g_io_completions = 0;
+	bdev_ftl_submit_request(g_io_ch, bdev_io);
+	CU_ASSERT(g_num_unmaps == UT_NUM_SHARDS);
+	g_unmaps[0].cb_fn(g_unmaps[0].cb_arg, 0);
+	g_unmaps[1].cb_fn(g_unmaps[1].cb_arg, -EIO);
+	CU_ASSERT(g_io_completions == 0);
+	g_unmaps[2].cb_fn(g_unmaps[2].cb_arg, 0);
+	CU_ASSERT(g_io_completions == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+
+	/*
+	 * A submission failure stops submitting to the remaining shards, the IO is completed
+	 * with that error once the already submitted unmaps are done.
+	 */
+	free(bdev_io);
+	bdev_io = ut_alloc_bdev_io(ftl_bdev, SPDK_BDEV_IO_TYPE_UNMAP, 0, UT_STRIPE_BLOCKS * 3);
+	g_unmap_rc[1] = -ENOMEM;
+	g_num_unmaps = 0;
+	g_io_completions = 0;
+	bdev_ftl_submit_request(g_io_ch, bdev_io);
+	CU_ASSERT(g_num_unmaps == 1);
+	CU_ASSERT(g_unmaps[0].dev_idx == 0);
+	CU_ASSERT(g_io_completions == 0);
+	g_unmaps[0].cb_fn(g_unmaps[0].cb_arg, 0);
+	CU_ASSERT(g_io_completions == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_NOMEM);
+
+	/* Failure of the first shard completes the IO right away */
+	g_unmap_rc[0] = -EINVAL;
+	g_num_unmaps = 0;
+	g_io_completions = 0;
+	bdev_ftl_submit_request(g_io_ch, bdev_io);
+	CU_ASSERT(g_num_unmaps == 0);
+	CU_ASSERT(g_io_completions == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	free(bdev_io);
+
+	/* Same for the unmap RPC */
+	g_unmap_rc[0] = 0;
+	g_num_unmaps = 0;
+	g_io_completions = 0;
+	bdev_ftl_unmap(ftl_bdev->bdev.name, 0, UT_STRIPE_BLOCKS * 3, ut_unmap_cb, NULL);
+	CU_ASSERT(g_num_unmaps == 1);
+	CU_ASSERT(g_io_completions == 0);
+	g_unmaps[0].cb_fn(g_unmaps[0].cb_arg, 0);
+	CU_ASSERT(g_io_completions == 1);
+	CU_ASSERT(g_io_status == -ENOMEM);
+	g_unmap_rc[1] = 0;
+
+	spdk_put_io_channel(g_io_ch);
+	g_io_ch = NULL;
+	poll_threads();
+	ut_destroy_bdev(ftl_bdev);
+}
+
+static int g_stats_status;
+static uint64_t g_stats_user_write_ios;
+static size_t g_stats_completions;
+
+static void
+ut_stats_cb(void *ctx)
+{
+	struct rpc_ftl_stats_ctx *ftl_stats_ctx = ctx;
+
+	g_stats_status = ftl_stats_ctx->status;
+	g_stats_user_write_ios = ftl_stats_ctx->ftl_stats->entries[FTL_STATS_TYPE_USER].write.ios;
+	g_stats_completions++;
+}
+
+static void
+test_stats(void)
+{
+	struct ftl_bdev *ftl_bdev;
+	struct ftl_stats stats;
+
+	ftl_bdev = ut_create_bdev(UT_NUM_SHARDS);
+
+	/* Statistics of all the shards are summed up */
+	memset(&stats, 0, sizeof(stats));
+	g_stats_completions = 0;
+	CU_ASSERT(bdev_ftl_get_stats(ftl_bdev->bdev.name, ut_stats_cb, NULL, &stats) == 0);
+	poll_threads();
+	CU_ASSERT(g_stats_completions == 1);
+	CU_ASSERT(g_stats_status == 0);
+	CU_ASSERT(g_stats_user_write_ios == 1 + 2 + 3);
+
+	/* Failure of a later shard is reported instead of the partial sums */
+	memset(&stats, 0, sizeof(stats));
+	g_stats_completions = 0;
+	g_stats_rc[2] = -EAGAIN;
+	CU_ASSERT(bdev_ftl_get_stats(ftl_bdev->bdev.name, ut_stats_cb, NULL, &stats) == 0);
+	poll_threads();
+	CU_ASSERT(g_stats_completions == 1);
+	CU_ASSERT(g_stats_status == -EAGAIN);
+
+	/* Failure of the first shard is returned right away */
+	g_stats_completions = 0;
+	g_stats_rc[0] = -EAGAIN;
+	CU_ASSERT(bdev_ftl_get_stats(ftl_bdev->bdev.name, ut_stats_cb, NULL, &stats) == -EAGAIN);
+	poll_threads();
+	CU_ASSERT(g_stats_completions == 0);
+
+	ut_destroy_bdev(ftl_bdev);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+	size_t		i;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("bdev_ftl", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_shard_lba);
+	CU_ADD_TEST(suite, test_create);
+	CU_ADD_TEST(suite, test_io_routing);
+	CU_ADD_TEST(suite, test_unmap);
+	CU_ADD_TEST(suite, test_unmap_error);
+	CU_ADD_TEST(suite, test_stats);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	for (i = 0; i < FTL_BDEV_MAX_SHARDS; i++) {
+		g_dev_blocks[i] = UT_DEV_BLOCKS;
+		spdk_io_device_register(&g_dev[i], ut_ch_create_cb, ut_ch_destroy_cb, 0, NULL);
+	}
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+
+	for (i = 0; i < FTL_BDEV_MAX_SHARDS; i++) {
+		spdk_io_device_unregister(&g_dev[i], NULL);
+	}
+	poll_threads();
+
+	free_threads();
+
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -6,13 +6,136 @@
 #include "spdk/stdinc.h"
 #include "spdk_cunit.h"
 #include "spdk/env.h"
+#include "spdk/xor.h"
 #include "spdk_internal/mock.h"
 
+#include "common/lib/ut_multithread.c"
+
 #include "bdev/raid/raid5f.c"
 
 DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
-DEFINE_STUB_V(raid_bdev_io_complete, (struct raid_bdev_io *raid_io,
-				      enum spdk_bdev_io_status status));
+DEFINE_STUB_V(raid_bdev_queue_io_wait, (struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
+					struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+
+static int g_accel_dev;
+static int g_xor_enomem;
+
+static int g_io_status;
+static int g_io_completed;
+
+/* In-memory contents of the base bdevs */
+static uint8_t **g_base_bdev_data;
+static uint32_t g_blocklen;
+
+struct spdk_io_channel *
+spdk_accel_get_io_channel(void)
+{
+	return spdk_get_io_channel(&g_accel_dev);
+}
+
+int
+spdk_accel_submit_xor(struct spdk_io_channel *ch, void *dst, void **sources, uint32_t nsrcs,
+		      uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	if (g_xor_enomem > 0) {
+		g_xor_enomem--;
+		return -ENOMEM;
+	}
+
+	cb_fn(cb_arg, spdk_xor_gen(dst, sources, nsrcs, nbytes));
+
+	return 0;
+}
+
+void
+raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+	g_io_completed++;
+}
+
+bool
+raid_bdev_io_complete_part(struct raid_bdev_io *raid_io, uint64_t completed,
+			   enum spdk_bdev_io_status status)
+{
+	SPDK_CU_ASSERT_FATAL(raid_io->base_bdev_io_remaining >= completed);
+	raid_io->base_bdev_io_remaining -= completed;
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid_io->base_bdev_io_status = status;
+	}
+
+	if (raid_io->base_bdev_io_remaining == 0) {
+		raid_bdev_io_complete(raid_io, raid_io->base_bdev_io_status);
+		return true;
+	}
+
+	return false;
+}
+
+/* The base bdev descriptors hold the base bdev index + 1 */
+static uint8_t *
+base_bdev_data(struct spdk_bdev_desc *desc, uint64_t offset_blocks, uint32_t blocklen)
+{
+	return g_base_bdev_data[(uintptr_t)desc - 1] + offset_blocks * blocklen;
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	uint32_t blocklen = g_blocklen;
+	uint8_t *data = base_bdev_data(desc, offset_blocks, blocklen);
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(data + len, iov[i].iov_base, iov[i].iov_len);
+		len += iov[i].iov_len;
+	}
+	CU_ASSERT(len == num_blocks * blocklen);
+
+	cb(NULL, true, cb_arg);
+
+	return 0;
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_io_completion_cb cb, void *cb_arg,
+			   struct spdk_bdev_ext_io_opts *opts)
+{
+	uint32_t blocklen = g_blocklen;
+	uint8_t *data = base_bdev_data(desc, offset_blocks, blocklen);
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(iov[i].iov_base, data + len, iov[i].iov_len);
+		len += iov[i].iov_len;
+	}
+	CU_ASSERT(len == num_blocks * blocklen);
+
+	cb(NULL, true, cb_arg);
+
+	return 0;
+}
+
+static int
+accel_dev_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+accel_dev_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
 
 struct raid5f_params {
 	uint8_t num_base_bdevs;
@@ -83,6 +206,27 @@ test_cleanup(void)
 	return 0;
 }
 
+static int
+test_suite_init(void)
+{
+	allocate_threads(1);
+	set_thread(0);
+
+	spdk_io_device_register(&g_accel_dev, accel_dev_create_cb, accel_dev_destroy_cb, 0, NULL);
+
+	return test_setup();
+}
+
+static int
+test_suite_fini(void)
+{
+	spdk_io_device_unregister(&g_accel_dev, NULL);
+	poll_threads();
+	free_threads();
+
+	return test_cleanup();
+}
+
 static struct raid_bdev *
 create_raid_bdev(struct raid5f_params *params)
 {
@@ -104,11 +248,14 @@ create_raid_bdev(struct raid5f_params *params)
 
 		base_info->bdev->blockcnt = params->base_bdev_blockcnt;
 		base_info->bdev->blocklen = params->base_bdev_blocklen;
+		base_info->desc = (struct spdk_bdev_desc *)(uintptr_t)(base_info - raid_bdev->base_bdev_info + 1);
 	}
 
 	raid_bdev->strip_size = params->strip_size;
 	raid_bdev->strip_size_shift = spdk_u32log2(raid_bdev->strip_size);
 	raid_bdev->bdev.blocklen = params->base_bdev_blocklen;
+	raid_bdev->blocklen_shift = spdk_u32log2(params->base_bdev_blocklen);
+	g_blocklen = params->base_bdev_blocklen;
 
 	return raid_bdev;
 }
@@ -141,6 +288,7 @@ delete_raid5f(struct raid5f_info *r5f_info)
 	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
 
 	raid5f_stop(raid_bdev);
+	poll_threads();
 
 	delete_raid_bdev(raid_bdev);
 }
@@ -161,6 +309,185 @@ test_raid5f_start(void)
 				(params->base_bdev_blockcnt - params->base_bdev_blockcnt % params->strip_size) *
 				(params->num_base_bdevs - 1));
 		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.optimal_io_boundary, r5f_info->stripe_blocks);
+		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.write_unit_size, r5f_info->stripe_blocks);
+
+		delete_raid5f(r5f_info);
+	}
+}
+
+struct raid_io_info {
+	struct raid5f_info *r5f_info;
+	struct raid_bdev_io_channel raid_ch;
+	struct spdk_bdev_io *bdev_io;
+	struct iovec iovs[3];
+};
+
+static void
+submit_io(struct raid_io_info *io_info, enum spdk_bdev_io_type type, uint8_t *buf,
+	  uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct raid_bdev *raid_bdev = io_info->r5f_info->raid_bdev;
+	struct spdk_bdev_io *bdev_io = io_info->bdev_io;
+	struct raid_bdev_io *raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
+	size_t len = num_blocks * raid_bdev->bdev.blocklen;
+
+	memset(bdev_io, 0, sizeof(*bdev_io) + sizeof(*raid_io));
+	bdev_io->bdev = &raid_bdev->bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	/* Split the buffer unevenly, so that the chunks don't map to whole iovecs */
+	io_info->iovs[0].iov_base = buf;
+	io_info->iovs[0].iov_len = len / 3 + 1;
+	io_info->iovs[1].iov_base = buf + io_info->iovs[0].iov_len;
+	io_info->iovs[1].iov_len = len / 5;
+	io_info->iovs[2].iov_base = buf + io_info->iovs[0].iov_len + io_info->iovs[1].iov_len;
+	io_info->iovs[2].iov_len = len - io_info->iovs[0].iov_len - io_info->iovs[1].iov_len;
+	bdev_io->u.bdev.iovs = io_info->iovs;
+	bdev_io->u.bdev.iovcnt = len >= 5 ? 3 : 1;
+	if (bdev_io->u.bdev.iovcnt == 1) {
+		io_info->iovs[0].iov_len = len;
+	}
+
+	raid_io->raid_bdev = raid_bdev;
+	raid_io->raid_ch = &io_info->raid_ch;
+	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	g_io_completed = 0;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	raid5f_submit_rw_request(raid_io);
+	poll_threads();
+}
+
+static void
+test_raid5f_submit_rw_request(void)
+{
+	struct raid5f_params *params;
+
+	RAID5F_PARAMS_FOR_EACH(params) {
+		struct raid5f_info *r5f_info = create_raid5f(params);
+		struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+		uint64_t num_stripes = spdk_min(r5f_info->total_stripes, params->num_base_bdevs);
+		size_t strip_len = params->strip_size * params->base_bdev_blocklen;
+		size_t stripe_len = r5f_info->stripe_blocks * params->base_bdev_blocklen;
+		uint8_t data_chunks = raid5f_stripe_data_chunks_num(raid_bdev);
+		struct raid_io_info io_info = { .r5f_info = r5f_info };
+		uint8_t *data, *buf, *parity;
+		uint64_t stripe_index;
+		uint8_t i;
+		size_t j;
+
+		if (params->base_bdev_blockcnt > 1024 || num_stripes == 0) {
+			delete_raid5f(r5f_info);
+			continue;
+		}
+
+		g_base_bdev_data = calloc(params->num_base_bdevs, sizeof(*g_base_bdev_data));
+		SPDK_CU_ASSERT_FATAL(g_base_bdev_data != NULL);
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			g_base_bdev_data[i] = calloc(num_stripes, strip_len);
+			SPDK_CU_ASSERT_FATAL(g_base_bdev_data[i] != NULL);
+		}
+		data = malloc(num_stripes * stripe_len);
+		SPDK_CU_ASSERT_FATAL(data != NULL);
+		buf = malloc(stripe_len);
+		SPDK_CU_ASSERT_FATAL(buf != NULL);
+		parity = malloc(strip_len);
+		SPDK_CU_ASSERT_FATAL(parity != NULL);
+		io_info.bdev_io = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct raid_bdev_io));
+		SPDK_CU_ASSERT_FATAL(io_info.bdev_io != NULL);
+		io_info.raid_ch.module_channel = raid5f_get_io_channel(raid_bdev);
+		SPDK_CU_ASSERT_FATAL(io_info.raid_ch.module_channel != NULL);
+		io_info.raid_ch.base_channel = calloc(params->num_base_bdevs, sizeof(struct spdk_io_channel *));
+		SPDK_CU_ASSERT_FATAL(io_info.raid_ch.base_channel != NULL);
+
+		for (j = 0; j < num_stripes * stripe_len; j++) {
+			data[j] = rand();
+		}
+
+		/* Full stripe writes, the first one after a failed xor submission */
+		for (stripe_index = 0; stripe_index < num_stripes; stripe_index++) {
+			uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index);
+			uint8_t *stripe_data = data + stripe_index * stripe_len;
+			uint8_t d = 0;
+
+			g_xor_enomem = stripe_index == 0 ? 1 : 0;
+			memcpy(buf, stripe_data, stripe_len);
+			submit_io(&io_info, SPDK_BDEV_IO_TYPE_WRITE, buf,
+				  stripe_index * r5f_info->stripe_blocks, r5f_info->stripe_blocks);
+			CU_ASSERT(g_io_completed == 1);
+			CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+			/* Each data chunk ends up on its base bdev, the parity on the remaining one */
+			memset(parity, 0, strip_len);
+			for (i = 0; i < params->num_base_bdevs; i++) {
+				uint8_t *base_data = g_base_bdev_data[i] + stripe_index * strip_len;
+
+				if (i == p_idx) {
+					continue;
+				}
+				CU_ASSERT(memcmp(base_data, stripe_data + d * strip_len, strip_len) == 0);
+				for (j = 0; j < strip_len; j++) {
+					parity[j] ^= base_data[j];
+				}
+				d++;
+			}
+			CU_ASSERT(d == data_chunks);
+			CU_ASSERT(memcmp(g_base_bdev_data[p_idx] + stripe_index * strip_len, parity,
+					 strip_len) == 0);
+		}
+
+		for (stripe_index = 0; stripe_index < num_stripes; stripe_index++) {
+			uint8_t *stripe_data = data + stripe_index * stripe_len;
+			uint64_t stripe_offset = stripe_index * r5f_info->stripe_blocks;
+
+			/* Read of the whole stripe */
+			memset(buf, 0, stripe_len);
+			submit_io(&io_info, SPDK_BDEV_IO_TYPE_READ, buf, stripe_offset, r5f_info->stripe_blocks);
+			CU_ASSERT(g_io_completed == 1);
+			CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			CU_ASSERT(memcmp(buf, stripe_data, stripe_len) == 0);
+
+			/* Read of a single block in the last data chunk */
+			memset(buf, 0, stripe_len);
+			submit_io(&io_info, SPDK_BDEV_IO_TYPE_READ, buf,
+				  stripe_offset + r5f_info->stripe_blocks - 1, 1);
+			CU_ASSERT(g_io_completed == 1);
+			CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			CU_ASSERT(memcmp(buf, stripe_data + stripe_len - params->base_bdev_blocklen,
+					 params->base_bdev_blocklen) == 0);
+
+			/* Read crossing the boundary of the first two data chunks */
+			if (params->strip_size > 1) {
+				memset(buf, 0, stripe_len);
+				submit_io(&io_info, SPDK_BDEV_IO_TYPE_READ, buf,
+					  stripe_offset + params->strip_size - 1, 2);
+				CU_ASSERT(g_io_completed == 1);
+				CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+				CU_ASSERT(memcmp(buf, stripe_data + strip_len - params->base_bdev_blocklen,
+						 2 * params->base_bdev_blocklen) == 0);
+			}
+		}
+
+		/* Partial stripe writes are rejected */
+		submit_io(&io_info, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, r5f_info->stripe_blocks - 1);
+		CU_ASSERT(g_io_completed == 1);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+
+		spdk_put_io_channel(io_info.raid_ch.module_channel);
+		poll_threads();
+		free(io_info.raid_ch.base_channel);
+		free(io_info.bdev_io);
+		free(parity);
+		free(buf);
+		free(data);
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			free(g_base_bdev_data[i]);
+		}
+		free(g_base_bdev_data);
+		g_base_bdev_data = NULL;
 
 		delete_raid5f(r5f_info);
 	}
@@ -175,8 +502,9 @@ main(int argc, char **argv)
 	CU_set_error_action(CUEA_ABORT);
 	CU_initialize_registry();
 
-	suite = CU_add_suite("raid5f", test_setup, test_cleanup);
+	suite = CU_add_suite("raid5f", test_suite_init, test_suite_fini);
 	CU_ADD_TEST(suite, test_raid5f_start);
+	CU_ADD_TEST(suite, test_raid5f_submit_rw_request);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -21,6 +21,10 @@ struct io_output *g_io_output = NULL;
 uint32_t g_max_io_size;
 uint32_t g_io_output_index;
 uint32_t g_io_comp_status;
+/* Leave base bdev writes outstanding until complete_deferred_write() is called */
+bool g_io_defer;
+/* Fail base bdev write submissions with this error when it's set */
+int g_io_submit_rc;
 uint8_t g_rpc_err;
 uint8_t g_json_decode_obj_construct;
 static TAILQ_HEAD(, spdk_bdev) g_bdev_list = TAILQ_HEAD_INITIALIZER(g_bdev_list);
@@ -35,6 +39,7 @@ struct io_output {
 	spdk_bdev_io_completion_cb  cb;
 	void                        *cb_arg;
 	enum spdk_bdev_io_type      iotype;
+	struct spdk_bdev_io         *child_io;
 };
 
 DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
@@ -198,9 +203,24 @@ spdk_bdev_module_release_bdev(struct spdk_bdev *bdev)
 	bdev->internal.claim_module = NULL;
 }
 
+/* The tests keep the thread an IO was submitted on in place of its bdev channel */
+struct spdk_thread *
+spdk_bdev_io_get_thread(struct spdk_bdev_io *bdev_io)
+{
+	return (struct spdk_thread *)bdev_io->internal.ch;
+}
+
+static void
+bdev_io_set_thread(struct spdk_bdev_io *bdev_io)
+{
+	bdev_io->internal.ch = (struct spdk_bdev_channel *)spdk_get_thread();
+}
+
 void
 spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
 {
+	CU_ASSERT(spdk_bdev_io_get_thread(bdev_io) == spdk_get_thread());
+	bdev_io->internal.status = status;
 	g_io_comp_status = ((status == SPDK_BDEV_IO_STATUS_SUCCESS) ? true : false);
 }
 
@@ -346,6 +366,9 @@ spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	struct spdk_bdev_io *child_io;
 
 	SPDK_CU_ASSERT_FATAL(g_io_output_index < g_max_io_size);
+	if (g_io_submit_rc != 0) {
+		return g_io_submit_rc;
+	}
 
 	set_io_output(output, desc, ch, offset_blocks, num_blocks, cb, cb_arg,
 		      SPDK_BDEV_IO_TYPE_WRITE);
@@ -360,6 +383,10 @@ spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	child_io->u.bdev.md_buf = md;
 	child_io->u.bdev.num_blocks = num_blocks;
 	child_io->u.bdev.offset_blocks = offset_blocks;
+	if (g_io_defer) {
+		output->child_io = child_io;
+		return 0;
+	}
 	cb(child_io, true, cb_arg);
 
 	return 0;
@@ -693,6 +720,7 @@ bdev_io_zone_info_initialize(struct spdk_bdev_io *bdev_io, struct spdk_bdev *bde
 {
 	bdev_io->bdev = bdev;
 	bdev_io->type = SPDK_BDEV_IO_TYPE_GET_ZONE_INFO;
+	bdev_io_set_thread(bdev_io);
 
 	bdev_io->u.zone_mgmt.zone_id = zone_id;
 
@@ -709,6 +737,7 @@ bdev_io_zone_initialize(struct spdk_bdev_io *bdev_io, struct spdk_bdev *bdev,
 {
 	bdev_io->bdev = bdev;
 	bdev_io->type = SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT;
+	bdev_io_set_thread(bdev_io);
 
 	bdev_io->u.zone_mgmt.zone_action = zone_action;
 	bdev_io->u.zone_mgmt.zone_id = zone_id;
@@ -729,6 +758,7 @@ bdev_io_initialize(struct spdk_bdev_io *bdev_io, struct spdk_bdev *bdev,
 	bdev_io->u.bdev.offset_blocks = lba;
 	bdev_io->u.bdev.num_blocks = blocks;
 	bdev_io->type = iotype;
+	bdev_io_set_thread(bdev_io);
 
 	if (bdev_io->type == SPDK_BDEV_IO_TYPE_UNMAP || bdev_io->type == SPDK_BDEV_IO_TYPE_FLUSH) {
 		return;
@@ -1459,6 +1489,239 @@ test_append_zone(void)
 	test_cleanup();
 }
 
+static struct spdk_bdev_io *
+submit_append_zone(struct bdev_zone_block *bdev, struct spdk_io_channel *ch, uint64_t zone_id,
+		   uint64_t blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct zone_block_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io_initialize(bdev_io, &bdev->bdev, zone_id, blocks, SPDK_BDEV_IO_TYPE_ZONE_APPEND);
+
+	g_io_comp_status = false;
+	zone_block_submit_request(ch, bdev_io);
+	CU_ASSERT(!g_io_comp_status);
+
+	return bdev_io;
+}
+
+static void
+complete_deferred_write(struct io_output *output, bool success)
+{
+	SPDK_CU_ASSERT_FATAL(output->child_io != NULL);
+	output->cb(output->child_io, success, output->cb_arg);
+	output->child_io = NULL;
+}
+
+static void
+test_append_zone_inflight(void)
+{
+	struct spdk_io_channel *ch;
+	struct bdev_zone_block *bdev;
+	struct spdk_bdev_io *bdev_io[4];
+	struct io_output output[4];
+	char *name = "Nvme0n1";
+	uint32_t num_zones = 20;
+	uint64_t zone_id, i;
+
+	init_test_globals(20 * 1024ul);
+	CU_ASSERT(zone_block_init() == 0);
+
+	/* Create zone dev */
+	bdev = create_and_get_vbdev("zone_dev1", name, num_zones, 1, true);
+
+	ch = calloc(1, sizeof(struct spdk_io_channel) + sizeof(struct zone_block_io_channel));
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	zone_id = bdev->bdev.zone_size;
+	send_reset_zone(bdev, ch, zone_id, 0, true);
+
+	/* Submit several appends to the same zone without completing them */
+	memset(g_io_output, 0, (g_max_io_size * sizeof(struct io_output)));
+	g_io_output_index = 0;
+	g_io_defer = true;
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		bdev_io[i] = submit_append_zone(bdev, ch, zone_id, 8);
+	}
+	g_io_defer = false;
+
+	/* Each one got its own range of the zone */
+	CU_ASSERT(g_io_output_index == SPDK_COUNTOF(bdev_io));
+	memcpy(output, g_io_output, sizeof(output));
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		CU_ASSERT(output[i].offset_blocks == zone_id + i * 8);
+		CU_ASSERT(output[i].num_blocks == 8);
+	}
+
+	/* Zone can't be reset while writes are outstanding */
+	send_reset_zone(bdev, ch, zone_id, 0, false);
+
+	/* Completing a later append doesn't move the write pointer nor complete the IO */
+	complete_deferred_write(&output[2], true);
+	CU_ASSERT(bdev_io[2]->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	send_zone_info(bdev, ch, zone_id, zone_id, SPDK_BDEV_ZONE_STATE_OPEN, 0, true);
+
+	complete_deferred_write(&output[0], true);
+	CU_ASSERT(bdev_io[0]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io[0]->u.bdev.offset_blocks == zone_id);
+	send_zone_info(bdev, ch, zone_id, zone_id + 8, SPDK_BDEV_ZONE_STATE_OPEN, 0, true);
+
+	/* Filling the gap completes both the IOs, in order */
+	complete_deferred_write(&output[1], false);
+	CU_ASSERT(bdev_io[1]->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(bdev_io[2]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io[2]->u.bdev.offset_blocks == zone_id + 16);
+	send_zone_info(bdev, ch, zone_id, zone_id + 24, SPDK_BDEV_ZONE_STATE_OPEN, 0, true);
+
+	complete_deferred_write(&output[3], true);
+	CU_ASSERT(bdev_io[3]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io[3]->u.bdev.offset_blocks == zone_id + 24);
+	send_zone_info(bdev, ch, zone_id, zone_id + 32, SPDK_BDEV_ZONE_STATE_OPEN, 0, true);
+
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		bdev_io_cleanup(bdev_io[i]);
+	}
+
+	/* Nothing is outstanding anymore, so the reset succeeds */
+	send_reset_zone(bdev, ch, zone_id, 0, true);
+
+	/* Delete zone dev */
+	send_delete_vbdev("zone_dev1", true);
+
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	free(ch);
+
+	test_cleanup();
+}
+
+static void
+test_append_zone_multithread(void)
+{
+	struct spdk_io_channel *ch[2];
+	struct spdk_thread *thread[2];
+	struct bdev_zone_block *bdev;
+	struct spdk_bdev_io *bdev_io[2];
+	struct io_output output[2];
+	char *name = "Nvme0n1";
+	uint32_t num_zones = 20;
+	uint64_t zone_id, i;
+
+	init_test_globals(20 * 1024ul);
+	CU_ASSERT(zone_block_init() == 0);
+
+	/* Create zone dev */
+	bdev = create_and_get_vbdev("zone_dev1", name, num_zones, 1, true);
+
+	thread[0] = g_thread;
+	thread[1] = spdk_thread_create("test1", NULL);
+	SPDK_CU_ASSERT_FATAL(thread[1] != NULL);
+	for (i = 0; i < SPDK_COUNTOF(ch); i++) {
+		ch[i] = calloc(1, sizeof(struct spdk_io_channel) +
+			       sizeof(struct zone_block_io_channel));
+		SPDK_CU_ASSERT_FATAL(ch[i] != NULL);
+	}
+
+	zone_id = bdev->bdev.zone_size;
+	send_reset_zone(bdev, ch[0], zone_id, 0, true);
+
+	/* Each thread appends to the same zone */
+	memset(g_io_output, 0, (g_max_io_size * sizeof(struct io_output)));
+	g_io_output_index = 0;
+	g_io_defer = true;
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		spdk_set_thread(thread[i]);
+		bdev_io[i] = submit_append_zone(bdev, ch[i], zone_id, 8);
+	}
+	g_io_defer = false;
+	memcpy(output, g_io_output, sizeof(output));
+
+	/* The second append's base write completes first, on the first thread */
+	spdk_set_thread(thread[0]);
+	complete_deferred_write(&output[1], true);
+	CU_ASSERT(bdev_io[1]->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+
+	/*
+	 * The first one then completes on the second thread, which completes the second append
+	 * right away and sends the first one back to its own thread
+	 */
+	spdk_set_thread(thread[1]);
+	complete_deferred_write(&output[0], true);
+	CU_ASSERT(bdev_io[0]->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT(bdev_io[1]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io[1]->u.bdev.offset_blocks == zone_id + 8);
+
+	spdk_set_thread(thread[0]);
+	while (spdk_thread_poll(thread[0], 0, 0) > 0) {}
+	CU_ASSERT(bdev_io[0]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io[0]->u.bdev.offset_blocks == zone_id);
+	send_zone_info(bdev, ch[0], zone_id, zone_id + 16, SPDK_BDEV_ZONE_STATE_OPEN, 0, true);
+
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		bdev_io_cleanup(bdev_io[i]);
+		free(ch[i]);
+	}
+
+	spdk_set_thread(thread[1]);
+	spdk_thread_exit(thread[1]);
+	while (!spdk_thread_is_exited(thread[1])) {
+		spdk_thread_poll(thread[1], 0, 0);
+	}
+	spdk_thread_destroy(thread[1]);
+	spdk_set_thread(g_thread);
+
+	/* Delete zone dev */
+	send_delete_vbdev("zone_dev1", true);
+
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	test_cleanup();
+}
+
+static void
+test_write_zone_submit_fail(void)
+{
+	struct spdk_io_channel *ch;
+	struct bdev_zone_block *bdev;
+	char *name = "Nvme0n1";
+	uint32_t num_zones = 20;
+	uint64_t zone_id;
+
+	init_test_globals(20 * 1024ul);
+	CU_ASSERT(zone_block_init() == 0);
+
+	/* Create zone dev */
+	bdev = create_and_get_vbdev("zone_dev1", name, num_zones, 1, true);
+
+	ch = calloc(1, sizeof(struct spdk_io_channel) + sizeof(struct zone_block_io_channel));
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	zone_id = bdev->bdev.zone_size;
+	send_reset_zone(bdev, ch, zone_id, 0, true);
+
+	/* A first write the base bdev couldn't take leaves the zone empty */
+	g_io_submit_rc = -ENOMEM;
+	send_write_zone(bdev, ch, zone_id, 1, 0, false);
+	send_zone_info(bdev, ch, zone_id, zone_id, SPDK_BDEV_ZONE_STATE_EMPTY, 0, true);
+
+	g_io_submit_rc = 0;
+	send_write_zone(bdev, ch, zone_id, 1, 0, true);
+	send_zone_info(bdev, ch, zone_id, zone_id + 1, SPDK_BDEV_ZONE_STATE_OPEN, 0, true);
+
+	/* Later ones leave it open, with the write pointer where it was */
+	g_io_submit_rc = -ENOMEM;
+	send_write_zone(bdev, ch, zone_id + 1, 1, 0, false);
+	send_zone_info(bdev, ch, zone_id, zone_id + 1, SPDK_BDEV_ZONE_STATE_OPEN, 0, true);
+	g_io_submit_rc = 0;
+
+	/* Delete zone dev */
+	send_delete_vbdev("zone_dev1", true);
+
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	free(ch);
+
+	test_cleanup();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1481,6 +1744,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_close_zone);
 	CU_ADD_TEST(suite, test_finish_zone);
 	CU_ADD_TEST(suite, test_append_zone);
+	CU_ADD_TEST(suite, test_append_zone_inflight);
+	CU_ADD_TEST(suite, test_append_zone_multithread);
+	CU_ADD_TEST(suite, test_write_zone_submit_fail);
 
 	g_thread = spdk_thread_create("test", NULL);
 	spdk_set_thread(g_thread);
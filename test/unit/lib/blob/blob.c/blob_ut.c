@@ -16,6 +16,7 @@
 #include "blob/request.c"
 #include "blob/zeroes.c"
 #include "blob/blob_bs_dev.c"
+#include "blob/cluster_alloc.c"
 
 struct spdk_blob_store *g_bs;
 spdk_blob_id g_blobid;
@@ -4634,14 +4635,14 @@ blob_snapshot_rw(void)
 	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
 
-	/* For a clone we need to allocate and copy one cluster, update one page of metadata
-	 * and then write 10 pages of payload.
+	/* For a clone we need to allocate and copy one cluster, with the 10 pages of payload
+	 * merged into it, and update one page of metadata.
 	 */
 	if (g_use_extent_table) {
 		/* Add one more page for EXTENT_PAGE write */
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 12 + cluster_size);
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 2 + cluster_size);
 	} else {
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 11 + cluster_size);
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size + cluster_size);
 	}
 	CU_ASSERT(g_dev_read_bytes - read_bytes == cluster_size);
 
@@ -4666,6 +4667,142 @@ blob_snapshot_rw(void)
 	g_blobid = 0;
 }
 
+static void
+blob_snapshot_cow_merge(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *snapshot;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t cluster_size, io_units_per_cluster;
+	uint64_t page_size;
+	uint8_t *payload_read, *payload_write, *expected;
+	struct iovec iov[2];
+	uint64_t write_bytes;
+	uint64_t read_bytes;
+	uint64_t i;
+
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	page_size = spdk_bs_get_page_size(bs);
+	io_units_per_cluster = cluster_size / spdk_bs_get_io_unit_size(bs);
+
+	payload_read = calloc(1, cluster_size);
+	payload_write = calloc(1, cluster_size);
+	expected = calloc(1, cluster_size);
+	SPDK_CU_ASSERT_FATAL(payload_read && payload_write && expected);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 3;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* Fill the blob and take a snapshot of it */
+	memset(payload_write, 0xE5, cluster_size);
+	for (i = 0; i < 3; i++) {
+		spdk_blob_io_write(blob, channel, payload_write, i * io_units_per_cluster,
+				   io_units_per_cluster, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+
+	/* Overwriting a whole cluster does not read it from the snapshot, and the
+	 * cluster is written once, along with the metadata update. */
+	write_bytes = g_dev_write_bytes;
+	read_bytes = g_dev_read_bytes;
+	memset(payload_write, 0xAA, cluster_size);
+	spdk_blob_io_write(blob, channel, payload_write, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_dev_read_bytes - read_bytes == 0);
+	CU_ASSERT(g_dev_write_bytes - write_bytes >= cluster_size);
+	CU_ASSERT(g_dev_write_bytes - write_bytes - cluster_size <= 2 * page_size);
+	CU_ASSERT(bs_io_unit_is_allocated(blob, 0));
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, cluster_size) == 0);
+
+	/* A partial writev is merged into the copy of the cluster */
+	write_bytes = g_dev_write_bytes;
+	read_bytes = g_dev_read_bytes;
+	memset(payload_write, 0xBB, 10 * 4096);
+	iov[0].iov_base = payload_write;
+	iov[0].iov_len = 3 * 4096;
+	iov[1].iov_base = payload_write + 3 * 4096;
+	iov[1].iov_len = 7 * 4096;
+	spdk_blob_io_writev(blob, channel, iov, 2, io_units_per_cluster + 4,
+			    10 * 4096 / spdk_bs_get_io_unit_size(bs), blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_dev_read_bytes - read_bytes == cluster_size);
+	CU_ASSERT(g_dev_write_bytes - write_bytes >= cluster_size);
+	CU_ASSERT(g_dev_write_bytes - write_bytes - cluster_size <= 2 * page_size);
+
+	memset(expected, 0xE5, cluster_size);
+	memset(expected + 4 * spdk_bs_get_io_unit_size(bs), 0xBB, 10 * 4096);
+	spdk_blob_io_read(blob, channel, payload_read, io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(expected, payload_read, cluster_size) == 0);
+
+	/* So are partial write zeroes */
+	write_bytes = g_dev_write_bytes;
+	spdk_blob_io_write_zeroes(blob, channel, 2 * io_units_per_cluster + 1, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_dev_write_bytes - write_bytes - cluster_size <= 2 * page_size);
+
+	memset(expected, 0xE5, cluster_size);
+	memset(expected + spdk_bs_get_io_unit_size(bs), 0, spdk_bs_get_io_unit_size(bs));
+	spdk_blob_io_read(blob, channel, payload_read, 2 * io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(expected, payload_read, cluster_size) == 0);
+
+	/* The snapshot is left untouched */
+	memset(expected, 0xE5, cluster_size);
+	for (i = 0; i < 3; i++) {
+		spdk_blob_io_read(snapshot, channel, payload_read, i * io_units_per_cluster,
+				  io_units_per_cluster, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(expected, payload_read, cluster_size) == 0);
+	}
+
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	g_blob = NULL;
+	g_blobid = 0;
+
+	free(payload_read);
+	free(payload_write);
+	free(expected);
+}
+
 static void
 blob_snapshot_rw_iov(void)
 {
@@ -7392,6 +7529,388 @@ blob_seek_io_unit(void)
 	ut_blob_close_and_delete(bs, blob);
 }
 
+static bool
+ut_blob_is_contiguous(struct spdk_blob *blob)
+{
+	uint64_t lba_per_cluster = bs_cluster_to_lba(blob->bs, 1);
+	uint64_t i;
+
+	for (i = 1; i < blob->active.num_clusters; i++) {
+		if (blob->active.clusters[i] != blob->active.clusters[i - 1] + lba_per_cluster) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Fill the blobstore with blobs and free every other cluster of the last few,
+ * so that the free space is only made of single cluster holes. The remaining
+ * blobs are returned in fillers. */
+static uint64_t
+ut_bs_fragment_free_space(struct spdk_blob_store *bs, struct spdk_blob ***fillers)
+{
+	struct spdk_blob *blob;
+	uint64_t num_blobs = 16;
+	uint64_t num_fillers = 0;
+	uint64_t i;
+
+	*fillers = calloc(num_blobs + 1, sizeof(**fillers));
+	SPDK_CU_ASSERT_FATAL(*fillers != NULL);
+
+	blob = ut_blob_create_and_open(bs, NULL);
+	spdk_blob_resize(blob, spdk_bs_free_cluster_count(bs) - num_blobs, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	(*fillers)[num_fillers++] = blob;
+
+	for (i = 1; i <= num_blobs; i++) {
+		blob = ut_blob_create_and_open(bs, NULL);
+		spdk_blob_resize(blob, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		(*fillers)[i] = blob;
+	}
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == 0);
+
+	for (i = 1; i <= num_blobs; i++) {
+		blob = (*fillers)[i];
+		if (bs_lba_to_cluster(bs, blob->active.clusters[0]) % 2 == 0) {
+			ut_blob_close_and_delete(bs, blob);
+		} else {
+			(*fillers)[num_fillers++] = blob;
+		}
+	}
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == num_blobs + 1 - num_fillers);
+
+	return num_fillers;
+}
+
+static void
+ut_bs_delete_fillers(struct spdk_blob_store *bs, struct spdk_blob **fillers, uint64_t num_fillers)
+{
+	uint64_t i;
+
+	for (i = 0; i < num_fillers; i++) {
+		ut_blob_close_and_delete(bs, fillers[i]);
+	}
+	free(fillers);
+}
+
+static void
+ut_blob_verify_cluster_pattern(struct spdk_blob *blob, struct spdk_io_channel *channel,
+			       uint8_t *buf)
+{
+	uint64_t io_units_per_cluster = bs_io_units_per_cluster(blob);
+	uint64_t cluster_sz = spdk_bs_get_cluster_size(blob->bs);
+	uint64_t i, j;
+
+	for (i = 0; i < blob->active.num_clusters; i++) {
+		memset(buf, 0, cluster_sz);
+		spdk_blob_io_read(blob, channel, buf, i * io_units_per_cluster, io_units_per_cluster,
+				  blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		for (j = 0; j < cluster_sz; j++) {
+			if (buf[j] != (uint8_t)(i + 1)) {
+				CU_FAIL("data mismatch after defragmentation");
+				return;
+			}
+		}
+	}
+}
+
+static void
+blob_defrag(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, **fillers;
+	struct spdk_io_channel *channel;
+	spdk_blob_id blobid;
+	uint64_t free_clusters, cluster_sz, io_units_per_cluster, num_fillers;
+	uint8_t *buf;
+	uint64_t i;
+
+	cluster_sz = spdk_bs_get_cluster_size(bs);
+	buf = calloc(1, cluster_sz);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	/* Allocate the blob out of single cluster holes */
+	blob = ut_blob_create_and_open(bs, NULL);
+	blobid = spdk_blob_get_id(blob);
+	num_fillers = ut_bs_fragment_free_space(bs, &fillers);
+	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(!ut_blob_is_contiguous(blob));
+
+	io_units_per_cluster = bs_io_units_per_cluster(blob);
+	for (i = 0; i < 5; i++) {
+		memset(buf, i + 1, cluster_sz);
+		spdk_blob_io_write(blob, channel, buf, i * io_units_per_cluster, io_units_per_cluster,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	ut_bs_delete_fillers(bs, fillers, num_fillers);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	/* Defragment without a bandwidth limit */
+	spdk_bs_blob_defrag(bs, channel, blobid, 0, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(ut_blob_is_contiguous(blob));
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	ut_blob_verify_cluster_pattern(blob, channel, buf);
+
+	/* Defragmenting a contiguous blob is a no-op */
+	spdk_bs_blob_defrag(bs, channel, blobid, 0, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(ut_blob_is_contiguous(blob));
+
+	/* The new layout has to survive a reload */
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	ut_bs_reload(&bs, NULL);
+	g_bs = bs;
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(ut_blob_is_contiguous(blob));
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	ut_blob_verify_cluster_pattern(blob, channel, buf);
+
+	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	free(buf);
+}
+
+static void
+blob_defrag_bw_limit(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, **fillers;
+	struct spdk_io_channel *channel;
+	uint64_t cluster_sz, io_units_per_cluster, num_fillers;
+	uint8_t *buf;
+	uint64_t i;
+
+	cluster_sz = spdk_bs_get_cluster_size(bs);
+	buf = calloc(1, cluster_sz);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	blob = ut_blob_create_and_open(bs, NULL);
+	num_fillers = ut_bs_fragment_free_space(bs, &fillers);
+	spdk_blob_resize(blob, 4, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	ut_bs_delete_fillers(bs, fillers, num_fillers);
+
+	io_units_per_cluster = bs_io_units_per_cluster(blob);
+	for (i = 0; i < 4; i++) {
+		memset(buf, i + 1, cluster_sz);
+		spdk_blob_io_write(blob, channel, buf, i * io_units_per_cluster, io_units_per_cluster,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	/* Limit the copy to one cluster per second */
+	g_bserrno = -1;
+	spdk_bs_blob_defrag(bs, channel, spdk_blob_get_id(blob), cluster_sz / (1024 * 1024),
+			    blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -1);
+	CU_ASSERT(!ut_blob_is_contiguous(blob));
+
+	/* The blob stays usable while it is being defragmented */
+	memset(buf, 4, cluster_sz);
+	spdk_blob_io_write(blob, channel, buf, 3 * io_units_per_cluster, io_units_per_cluster,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bserrno = -1;
+
+	for (i = 0; i < 4 && g_bserrno == -1; i++) {
+		spdk_delay_us(1000000);
+		poll_threads();
+	}
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(ut_blob_is_contiguous(blob));
+	ut_blob_verify_cluster_pattern(blob, channel, buf);
+
+	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	free(buf);
+}
+
+static void
+blob_defrag_concurrent_change(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, **fillers;
+	struct spdk_blob_opts opts;
+	struct spdk_io_channel *channel;
+	uint64_t cluster_sz, io_units_per_cluster, num_fillers;
+	uint8_t *buf;
+	uint64_t i;
+
+	cluster_sz = spdk_bs_get_cluster_size(bs);
+	buf = calloc(1, cluster_sz);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	/* Thin provisioned blob with only its first two clusters allocated, out of holes */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	num_fillers = ut_bs_fragment_free_space(bs, &fillers);
+
+	io_units_per_cluster = bs_io_units_per_cluster(blob);
+	for (i = 0; i < 2; i++) {
+		memset(buf, i + 1, cluster_sz);
+		spdk_blob_io_write(blob, channel, buf, i * io_units_per_cluster, io_units_per_cluster,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	ut_bs_delete_fillers(bs, fillers, num_fillers);
+	CU_ASSERT(!ut_blob_is_contiguous(blob));
+
+	/* One cluster per second, so the blob can be changed between the moves */
+	g_bserrno = -1;
+	spdk_bs_blob_defrag(bs, channel, spdk_blob_get_id(blob), cluster_sz / (1024 * 1024),
+			    blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -1);
+
+	/* Grow the blob and allocate more clusters than were counted when defrag started */
+	spdk_blob_resize(blob, 6, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	for (i = 2; i < 6; i++) {
+		memset(buf, i + 1, cluster_sz);
+		spdk_blob_io_write(blob, channel, buf, i * io_units_per_cluster, io_units_per_cluster,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	g_bserrno = -1;
+
+	for (i = 0; i < 8 && g_bserrno == -1; i++) {
+		spdk_delay_us(1000000);
+		poll_threads();
+	}
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->active.num_clusters == 6);
+	ut_blob_verify_cluster_pattern(blob, channel, buf);
+
+	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	free(buf);
+}
+
+static void
+blob_cluster_locality(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob1, *blob2, **fillers;
+	struct spdk_blob_opts opts;
+	struct spdk_io_channel *channel;
+	uint64_t io_units_per_cluster, num_fillers;
+	uint8_t payload[4096];
+	uint64_t i;
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	/* Blobs growing in turns keep their clusters contiguous */
+	blob1 = ut_blob_create_and_open(bs, NULL);
+	blob2 = ut_blob_create_and_open(bs, NULL);
+	for (i = 1; i <= 5; i++) {
+		spdk_blob_resize(blob1, i, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		spdk_blob_resize(blob2, i, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	CU_ASSERT(ut_blob_is_contiguous(blob1));
+	CU_ASSERT(ut_blob_is_contiguous(blob2));
+	ut_blob_close_and_delete(bs, blob1);
+	ut_blob_close_and_delete(bs, blob2);
+
+	/* So do thin provisioned blobs written in turns */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 5;
+	blob1 = ut_blob_create_and_open(bs, &opts);
+	blob2 = ut_blob_create_and_open(bs, &opts);
+	io_units_per_cluster = bs_io_units_per_cluster(blob1);
+	memset(payload, 0xAA, sizeof(payload));
+	for (i = 0; i < 5; i++) {
+		spdk_blob_io_write(blob1, channel, payload, i * io_units_per_cluster, 1,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		spdk_blob_io_write(blob2, channel, payload, i * io_units_per_cluster, 1,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	CU_ASSERT(ut_blob_is_contiguous(blob1));
+	CU_ASSERT(ut_blob_is_contiguous(blob2));
+	ut_blob_close_and_delete(bs, blob1);
+	ut_blob_close_and_delete(bs, blob2);
+
+	/* A resize takes a run of free clusters it fits in rather than holes.
+	 * Leave single cluster holes and a single run of 4 free clusters. */
+	blob1 = ut_blob_create_and_open(bs, NULL);
+	num_fillers = ut_bs_fragment_free_space(bs, &fillers);
+	i = spdk_bs_free_cluster_count(bs);
+	ut_blob_close_and_delete(bs, fillers[0]);
+	fillers[0] = ut_blob_create_and_open(bs, NULL);
+	spdk_blob_resize(fillers[0], spdk_bs_free_cluster_count(bs) - i - 4, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_resize(blob1, 4, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(ut_blob_is_contiguous(blob1));
+	ut_bs_delete_fillers(bs, fillers, num_fillers);
+	ut_blob_close_and_delete(bs, blob1);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+}
+
 static void
 suite_bs_setup(void)
 {
@@ -7552,6 +8071,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, bs_load_iter_test);
 	CU_ADD_TEST(suite_bs, blob_snapshot_rw);
 	CU_ADD_TEST(suite_bs, blob_snapshot_rw_iov);
+	CU_ADD_TEST(suite_bs, blob_snapshot_cow_merge);
 	CU_ADD_TEST(suite, blob_relations);
 	CU_ADD_TEST(suite, blob_relations2);
 	CU_ADD_TEST(suite, blob_relations3);
@@ -7568,6 +8088,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite_bs, blob_persist_test);
 	CU_ADD_TEST(suite_bs, blob_decouple_snapshot);
 	CU_ADD_TEST(suite_bs, blob_seek_io_unit);
+	CU_ADD_TEST(suite_bs, blob_defrag);
+	CU_ADD_TEST(suite_bs, blob_defrag_bw_limit);
+	CU_ADD_TEST(suite_bs, blob_defrag_concurrent_change);
+	CU_ADD_TEST(suite_bs, blob_cluster_locality);
 
 	allocate_threads(2);
 	set_thread(0);
@@ -0,0 +1,374 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "spdk/bit_array.h"
+#include "spdk/bit_pool.h"
+
+#include "common/lib/test_env.c"
+#include "blob/cluster_alloc.c"
+
+static struct bs_cluster_alloc *
+ut_alloc_create(uint32_t num_clusters, const uint32_t *used, size_t num_used)
+{
+	struct spdk_bit_array *ba;
+	struct bs_cluster_alloc *alloc;
+	size_t i;
+
+	ba = spdk_bit_array_create(num_clusters);
+	SPDK_CU_ASSERT_FATAL(ba != NULL);
+	for (i = 0; i < num_used; i++) {
+		spdk_bit_array_set(ba, used[i]);
+	}
+
+	alloc = bs_cluster_alloc_create(ba);
+	SPDK_CU_ASSERT_FATAL(alloc != NULL);
+	spdk_bit_array_free(&ba);
+
+	return alloc;
+}
+
+static void
+test_create(void)
+{
+	const uint32_t used[] = { 0, 1, 5, 6, 9 };
+	struct bs_cluster_alloc *alloc;
+
+	/* Free extents: 2-4, 7-8 */
+	alloc = ut_alloc_create(10, used, SPDK_COUNTOF(used));
+	CU_ASSERT(bs_cluster_alloc_num_free(alloc) == 5);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 2);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 0) == 0);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 2) == 3);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 3) == 2);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 8) == 1);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 9) == 0);
+	bs_cluster_alloc_free(&alloc);
+	CU_ASSERT(alloc == NULL);
+
+	/* Nothing allocated */
+	alloc = ut_alloc_create(100, NULL, 0);
+	CU_ASSERT(bs_cluster_alloc_num_free(alloc) == 100);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 1);
+	bs_cluster_alloc_free(&alloc);
+}
+
+static void
+test_get(void)
+{
+	const uint32_t used[] = { 0, 1, 5, 6, 9, 10, 11, 12, 13, 14 };
+	struct bs_cluster_alloc *alloc;
+	uint32_t start, run_len;
+
+	/* Free extents: 2-4, 7-8, 15-31 */
+	alloc = ut_alloc_create(32, used, SPDK_COUNTOF(used));
+
+	/* Smallest extent that fits */
+	start = bs_cluster_alloc_get(alloc, UINT32_MAX, 2, &run_len);
+	CU_ASSERT(start == 7);
+	CU_ASSERT(run_len == 2);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 2);
+
+	/* Free hint continues the run */
+	start = bs_cluster_alloc_get(alloc, 3, 4, &run_len);
+	CU_ASSERT(start == 3);
+	CU_ASSERT(run_len == 2);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 2) == 1);
+
+	/* Single cluster after an allocated hint comes from the next extent */
+	start = bs_cluster_alloc_get(alloc, 9, 1, &run_len);
+	CU_ASSERT(start == 15);
+	CU_ASSERT(run_len == 1);
+
+	/* Longer runs after an allocated hint are a best fit */
+	start = bs_cluster_alloc_get(alloc, 0, 10, &run_len);
+	CU_ASSERT(start == 16);
+	CU_ASSERT(run_len == 10);
+
+	/* Nothing fits, the largest extent is returned */
+	start = bs_cluster_alloc_get(alloc, UINT32_MAX, 10, &run_len);
+	CU_ASSERT(start == 26);
+	CU_ASSERT(run_len == 6);
+
+	/* Single cluster without hint starts in the middle of the largest extent */
+	bs_cluster_alloc_put(alloc, 16, 10);
+	start = bs_cluster_alloc_get(alloc, UINT32_MAX, 1, &run_len);
+	CU_ASSERT(start == 21);
+	CU_ASSERT(run_len == 1);
+
+	CU_ASSERT(bs_cluster_alloc_num_free(alloc) == 10);
+	while (bs_cluster_alloc_num_free(alloc) > 0) {
+		start = bs_cluster_alloc_get(alloc, UINT32_MAX, 4, &run_len);
+		CU_ASSERT(start != UINT32_MAX);
+	}
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 0);
+	start = bs_cluster_alloc_get(alloc, UINT32_MAX, 1, &run_len);
+	CU_ASSERT(start == UINT32_MAX);
+
+	bs_cluster_alloc_free(&alloc);
+}
+
+static void
+test_get_at(void)
+{
+	struct bs_cluster_alloc *alloc;
+
+	alloc = ut_alloc_create(16, NULL, 0);
+
+	CU_ASSERT(bs_cluster_alloc_get_at(alloc, 4, 4) == true);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 2);
+	CU_ASSERT(bs_cluster_alloc_get_at(alloc, 7, 1) == false);
+	CU_ASSERT(bs_cluster_alloc_get_at(alloc, 2, 3) == false);
+	CU_ASSERT(bs_cluster_alloc_get_at(alloc, 12, 5) == false);
+	CU_ASSERT(bs_cluster_alloc_get_at(alloc, 0, 4) == true);
+	CU_ASSERT(bs_cluster_alloc_get_at(alloc, 15, 1) == true);
+	CU_ASSERT(bs_cluster_alloc_num_free(alloc) == 7);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 1);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 8) == 7);
+
+	bs_cluster_alloc_free(&alloc);
+}
+
+static void
+test_put(void)
+{
+	struct bs_cluster_alloc *alloc;
+	uint32_t start, run_len;
+
+	alloc = ut_alloc_create(16, NULL, 0);
+	start = bs_cluster_alloc_get(alloc, 0, 16, &run_len);
+	CU_ASSERT(start == 0);
+	CU_ASSERT(run_len == 16);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 0);
+
+	bs_cluster_alloc_put(alloc, 4, 2);
+	bs_cluster_alloc_put(alloc, 8, 2);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 2);
+
+	/* Merge with the previous extent */
+	bs_cluster_alloc_put(alloc, 6, 1);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 2);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 4) == 3);
+
+	/* Merge with the next extent */
+	bs_cluster_alloc_put(alloc, 2, 2);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 2);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 2) == 5);
+
+	/* Merge with both */
+	bs_cluster_alloc_put(alloc, 7, 1);
+	CU_ASSERT(bs_cluster_alloc_num_extents(alloc) == 1);
+	CU_ASSERT(bs_cluster_alloc_free_run_at(alloc, 2) == 8);
+
+	/* The size ordering follows the merges */
+	start = bs_cluster_alloc_find(alloc, 8, &run_len);
+	CU_ASSERT(start == 2);
+	CU_ASSERT(run_len == 8);
+	CU_ASSERT(bs_cluster_alloc_num_free(alloc) == 8);
+
+	bs_cluster_alloc_free(&alloc);
+}
+
+/*
+ * Benchmark of cluster allocation on a 16 TiB blobstore with 4 MiB clusters,
+ * the default cluster size of lvol stores.
+ *
+ * Thick provisioned blobs grow in chunks in turns, a quarter of them is
+ * deleted to punch holes, then thin provisioned blobs take clusters one at a
+ * time in turns until the blobstore is three quarters full. The same sequence
+ * of requests is run against the extent allocator and against claiming the
+ * lowest free bit of a bit pool one cluster at a time, which is how clusters
+ * were allocated before.
+ *
+ * Reported are the allocation rate and the fragmentation, as the average
+ * number of physically contiguous runs per blob.
+ */
+#define BENCH_NUM_CLUSTERS	(4ULL * 1024 * 1024)	/* 16 TiB / 4 MiB */
+#define BENCH_NUM_THICK		512
+#define BENCH_NUM_THIN		512
+#define BENCH_MAX_CHUNK		256
+
+struct bench_blob {
+	uint32_t	*clusters;
+	uint32_t	num_clusters;
+	uint32_t	max_clusters;
+	uint32_t	num_runs;
+};
+
+struct bench_ctx {
+	struct bs_cluster_alloc	*alloc;
+	struct spdk_bit_pool	*pool;
+	struct bench_blob	blobs[BENCH_NUM_THICK + BENCH_NUM_THIN];
+	uint64_t		num_allocated;
+	uint64_t		num_requests;
+};
+
+static void
+bench_blob_add(struct bench_blob *blob, uint32_t cluster)
+{
+	uint32_t *tmp;
+
+	if (blob->num_clusters == blob->max_clusters) {
+		blob->max_clusters = spdk_max(blob->max_clusters * 2, 64);
+		tmp = realloc(blob->clusters, blob->max_clusters * sizeof(*blob->clusters));
+		SPDK_CU_ASSERT_FATAL(tmp != NULL);
+		blob->clusters = tmp;
+	}
+
+	if (blob->num_clusters == 0 || blob->clusters[blob->num_clusters - 1] + 1 != cluster) {
+		blob->num_runs++;
+	}
+	blob->clusters[blob->num_clusters++] = cluster;
+}
+
+static void
+bench_grow(struct bench_ctx *ctx, struct bench_blob *blob, uint32_t count)
+{
+	uint32_t hint, start, run_len, i;
+
+	ctx->num_requests++;
+	ctx->num_allocated += count;
+
+	if (ctx->pool != NULL) {
+		for (i = 0; i < count; i++) {
+			bench_blob_add(blob, spdk_bit_pool_allocate_bit(ctx->pool));
+		}
+		return;
+	}
+
+	while (count > 0) {
+		hint = blob->num_clusters ? blob->clusters[blob->num_clusters - 1] + 1 : UINT32_MAX;
+		start = bs_cluster_alloc_get(ctx->alloc, hint, count, &run_len);
+		SPDK_CU_ASSERT_FATAL(start != UINT32_MAX);
+		for (i = 0; i < run_len; i++) {
+			bench_blob_add(blob, start + i);
+		}
+		count -= run_len;
+	}
+}
+
+static void
+bench_delete(struct bench_ctx *ctx, struct bench_blob *blob)
+{
+	uint32_t i;
+
+	for (i = 0; i < blob->num_clusters; i++) {
+		if (ctx->pool != NULL) {
+			spdk_bit_pool_free_bit(ctx->pool, blob->clusters[i]);
+		} else {
+			bs_cluster_alloc_put(ctx->alloc, blob->clusters[i], 1);
+		}
+	}
+	blob->num_clusters = 0;
+	blob->num_runs = 0;
+}
+
+static uint64_t
+bench_run(struct bench_ctx *ctx, const char *name)
+{
+	struct timespec t0, t1;
+	struct bench_blob *blob;
+	unsigned int seed = 0x1234;
+	uint64_t target, total_runs = 0, num_blobs = 0;
+	double secs;
+	uint32_t i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	/* Thick blobs resized in turns up to half of the capacity */
+	target = BENCH_NUM_CLUSTERS / 2;
+	while (ctx->num_allocated < target) {
+		blob = &ctx->blobs[rand_r(&seed) % BENCH_NUM_THICK];
+		bench_grow(ctx, blob, spdk_min(1 + rand_r(&seed) % BENCH_MAX_CHUNK,
+					       target - ctx->num_allocated));
+	}
+
+	/* Punch holes */
+	for (i = 0; i < BENCH_NUM_THICK; i += 4) {
+		ctx->num_allocated -= ctx->blobs[i].num_clusters;
+		bench_delete(ctx, &ctx->blobs[i]);
+	}
+
+	/* Thin blobs written in turns up to three quarters of the capacity */
+	target = BENCH_NUM_CLUSTERS / 4 * 3;
+	while (ctx->num_allocated < target) {
+		blob = &ctx->blobs[BENCH_NUM_THICK + rand_r(&seed) % BENCH_NUM_THIN];
+		bench_grow(ctx, blob, 1);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	for (i = 0; i < SPDK_COUNTOF(ctx->blobs); i++) {
+		if (ctx->blobs[i].num_clusters > 0) {
+			total_runs += ctx->blobs[i].num_runs;
+			num_blobs++;
+		}
+		free(ctx->blobs[i].clusters);
+	}
+
+	printf("\n  %-12s %10.0f requests/s %12.0f clusters/s %10.1f runs/blob",
+	       name, ctx->num_requests / secs, ctx->num_allocated / secs,
+	       (double)total_runs / num_blobs);
+
+	return total_runs;
+}
+
+static void
+test_bench_16tb(void)
+{
+	struct spdk_bit_array *ba;
+	struct bench_ctx *ctx;
+	uint64_t runs_extent, runs_bitpool;
+
+	ctx = calloc(1, sizeof(*ctx));
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+	ba = spdk_bit_array_create(BENCH_NUM_CLUSTERS);
+	SPDK_CU_ASSERT_FATAL(ba != NULL);
+	ctx->alloc = bs_cluster_alloc_create(ba);
+	SPDK_CU_ASSERT_FATAL(ctx->alloc != NULL);
+	runs_extent = bench_run(ctx, "extent");
+	bs_cluster_alloc_free(&ctx->alloc);
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->pool = spdk_bit_pool_create_from_array(ba);
+	SPDK_CU_ASSERT_FATAL(ctx->pool != NULL);
+	runs_bitpool = bench_run(ctx, "bit pool");
+	spdk_bit_pool_free(&ctx->pool);
+	printf("\n");
+
+	CU_ASSERT(runs_extent < runs_bitpool);
+
+	free(ctx);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("cluster_alloc", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_create);
+	CU_ADD_TEST(suite, test_get);
+	CU_ADD_TEST(suite, test_get_at);
+	CU_ADD_TEST(suite, test_put);
+	CU_ADD_TEST(suite, test_bench_16tb);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+
+	CU_basic_run_tests();
+
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
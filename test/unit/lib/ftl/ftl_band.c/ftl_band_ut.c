@@ -41,6 +41,8 @@ DEFINE_STUB_V(ftl_trace_write_band, (struct spdk_ftl_dev *dev, const struct ftl_
 DEFINE_STUB_V(ftl_trace_submission, (struct spdk_ftl_dev *dev, const struct ftl_io *io,
 				     ftl_addr addr, size_t addr_cnt));
 #endif
+DEFINE_STUB_V(ftl_trace_stage, (struct spdk_ftl_dev *dev, enum ftl_stats_stage stage,
+				uint64_t latency_us, uint64_t num_blocks));
 DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
 DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
 DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "test");
@@ -62,19 +64,13 @@ DEFINE_STUB(spdk_bdev_write_zeroes_blocks, int,
 DEFINE_STUB(spdk_bdev_writev_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 		struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
 		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
-DEFINE_STUB_V(ftl_io_advance, (struct ftl_io *io, size_t num_blocks));
 DEFINE_STUB(ftl_io_channel_get_ctx, struct ftl_io_channel *,
 	    (struct spdk_io_channel *ioch), NULL);
 DEFINE_STUB_V(ftl_io_complete, (struct ftl_io *io));
-DEFINE_STUB(ftl_io_current_lba, uint64_t, (const struct ftl_io *io), 0);
 DEFINE_STUB_V(ftl_io_dec_req, (struct ftl_io *io));
 DEFINE_STUB_V(ftl_io_fail, (struct ftl_io *io, int status));
 DEFINE_STUB_V(ftl_io_free, (struct ftl_io *io));
-DEFINE_STUB(ftl_io_get_lba, uint64_t,
-	    (const struct ftl_io *io, size_t offset), 0);
 DEFINE_STUB_V(ftl_io_inc_req, (struct ftl_io *io));
-DEFINE_STUB(ftl_io_iovec_addr, void *, (struct ftl_io *io), NULL);
-DEFINE_STUB(ftl_io_iovec_len_left, size_t, (struct ftl_io *io), 0);
 
 DEFINE_STUB(ftl_iovec_num_blocks, size_t,
 	    (struct iovec *iov, size_t iov_cnt), 0);
@@ -105,6 +101,13 @@ DEFINE_STUB(ftl_io_init, int, (struct spdk_io_channel *_ioch, struct ftl_io *io,
 			       struct iovec *iov, size_t iov_cnt, spdk_ftl_fn cb_fn, void *cb_ctx, int type), 0);
 DEFINE_STUB_V(ftl_mngt_next_step, (struct ftl_mngt_process *mngt));
 DEFINE_STUB_V(ftl_mngt_fail_step, (struct ftl_mngt_process *mngt));
+DEFINE_STUB(ftl_mngt_alloc_step_ctx, int, (struct ftl_mngt_process *mngt, size_t size), 0);
+DEFINE_STUB(ftl_mngt_get_dev, struct spdk_ftl_dev *, (struct ftl_mngt_process *mngt), NULL);
+DEFINE_STUB(ftl_mngt_get_step_ctx, void *, (struct ftl_mngt_process *mngt), NULL);
+DEFINE_STUB(spdk_bdev_get_max_zone_append_size, uint32_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_get_zone_info, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, uint64_t zone_id, size_t num_zones,
+		struct spdk_bdev_zone_info *info, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
 DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
 DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *, (struct spdk_bdev_desc *bdev_desc),
 	    NULL);
@@ -126,11 +129,8 @@ DEFINE_STUB_V(ftl_l2p_pin, (struct spdk_ftl_dev *dev, uint64_t lba, uint64_t cou
 			    struct ftl_l2p_pin_ctx *pin_ctx));
 DEFINE_STUB_V(ftl_l2p_pin_skip, (struct spdk_ftl_dev *dev, ftl_l2p_pin_cb cb, void *cb_ctx,
 				 struct ftl_l2p_pin_ctx *pin_ctx));
-DEFINE_STUB(ftl_nv_cache_read, int, (struct ftl_io *io, ftl_addr addr, uint32_t num_blocks,
-				     spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
 DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
 		struct spdk_bdev_io_wait_entry *entry), 0);
-DEFINE_STUB(ftl_l2p_get, ftl_addr, (struct spdk_ftl_dev *dev, uint64_t lba), 0);
 DEFINE_STUB_V(ftl_writer_run, (struct ftl_writer *writer));
 DEFINE_STUB(ftl_writer_is_halted, bool, (struct ftl_writer *writer), true);
 DEFINE_STUB(ftl_mempool_claim_df, void *, (struct ftl_mempool *mpool, ftl_df_obj_id df_obj_id),
@@ -146,6 +146,78 @@ DEFINE_STUB_V(spdk_bdev_io_get_nvme_status, (const struct spdk_bdev_io *bdev_io,
 		int *sct, int *sc));
 DEFINE_STUB(ftl_nv_cache_throttle, bool, (struct spdk_ftl_dev *dev), true);
 
+/* The read path only supports single iovec IOs, with LBAs mapped to consecutive addresses */
+static ftl_addr g_l2p_base_addr;
+
+ftl_addr
+ftl_l2p_get(struct spdk_ftl_dev *dev, uint64_t lba)
+{
+	return g_l2p_base_addr + lba;
+}
+
+uint64_t
+ftl_io_get_lba(const struct ftl_io *io, size_t offset)
+{
+	return io->lba + offset;
+}
+
+uint64_t
+ftl_io_current_lba(const struct ftl_io *io)
+{
+	return ftl_io_get_lba(io, io->pos);
+}
+
+void
+ftl_io_advance(struct ftl_io *io, size_t num_blocks)
+{
+	io->pos += num_blocks;
+}
+
+void *
+ftl_io_iovec_addr(struct ftl_io *io)
+{
+	return (char *)io->iov[0].iov_base + io->pos * FTL_BLOCK_SIZE;
+}
+
+size_t
+ftl_io_iovec_len_left(struct ftl_io *io)
+{
+	return io->num_blocks - io->pos;
+}
+
+/* Addresses in [start, end) are found in the NV cache's DRAM write cache */
+static struct {
+	ftl_addr start;
+	ftl_addr end;
+} g_wr_cache;
+
+uint32_t
+ftl_nv_cache_read_wr_cache(struct ftl_io *io, ftl_addr addr, uint32_t num_blocks)
+{
+	if (addr < g_wr_cache.start || addr >= g_wr_cache.end) {
+		return 0;
+	}
+
+	return spdk_min(num_blocks, g_wr_cache.end - addr);
+}
+
+static struct {
+	ftl_addr addr;
+	uint32_t num_blocks;
+	uint32_t count;
+} g_nv_cache_read;
+
+int
+ftl_nv_cache_read(struct ftl_io *io, ftl_addr addr, uint32_t num_blocks,
+		  spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	g_nv_cache_read.addr = addr;
+	g_nv_cache_read.num_blocks = num_blocks;
+	g_nv_cache_read.count++;
+
+	return 0;
+}
+
 static void
 adjust_bitmap(struct ftl_bitmap **bitmap, uint64_t *bit)
 {
@@ -370,6 +442,148 @@ test_next_xfer_addr(void)
 	cleanup_band();
 }
 
+static void
+test_gc_policy(void)
+{
+	struct ftl_superblock sb = {};
+	struct ftl_superblock_shm sb_shm = {};
+	struct ftl_band *band, *hot, *cold;
+	uint64_t user_blocks;
+	size_t i;
+
+	g_dev = test_init_ftl_dev(&g_geo);
+	g_dev->sb = &sb;
+	g_dev->sb_shm = &sb_shm;
+	g_dev->num_logical_bands_in_physical = 1;
+	sb.seq_id = 1000;
+
+	for (i = 0; i < ftl_get_num_bands(g_dev); i++) {
+		band = test_init_ftl_band(g_dev, i, ftl_get_num_blocks_in_band(g_dev));
+		band->phys_id = i;
+		band->p2l_map.num_valid = ftl_band_user_blocks(band);
+		band->md->close_seq_id = 500;
+	}
+
+	/* Recently closed band with most blocks invalidated vs. an old, half invalid band */
+	user_blocks = ftl_band_user_blocks(&g_dev->bands[0]);
+	hot = &g_dev->bands[1];
+	hot->p2l_map.num_valid = user_blocks / 4;
+	hot->md->close_seq_id = 990;
+	cold = &g_dev->bands[2];
+	cold->p2l_map.num_valid = user_blocks / 2;
+	cold->md->close_seq_id = 100;
+
+	ftl_band_reset_gc_iter(g_dev);
+	g_dev->conf.gc_policy = SPDK_FTL_GC_POLICY_GREEDY;
+	CU_ASSERT_EQUAL(ftl_band_search_next_to_reloc(g_dev), hot);
+	CU_ASSERT_TRUE(hot->reloc);
+	CU_ASSERT_EQUAL(g_dev->stats.gc.bands, 1);
+	CU_ASSERT_EQUAL(g_dev->stats.gc.valid_blocks, user_blocks / 4);
+	hot->reloc = false;
+	TAILQ_INSERT_TAIL(&g_dev->shut_bands, hot, queue_entry);
+
+	ftl_band_reset_gc_iter(g_dev);
+	g_dev->conf.gc_policy = SPDK_FTL_GC_POLICY_COST_BENEFIT;
+	CU_ASSERT_EQUAL(ftl_band_search_next_to_reloc(g_dev), cold);
+	CU_ASSERT_TRUE(cold->reloc);
+	CU_ASSERT_EQUAL(g_dev->stats.gc.bands, 2);
+	cold->reloc = false;
+	TAILQ_INSERT_TAIL(&g_dev->shut_bands, cold, queue_entry);
+
+	/* A band without valid blocks is picked regardless of its age */
+	hot->p2l_map.num_valid = 0;
+	ftl_band_reset_gc_iter(g_dev);
+	CU_ASSERT_EQUAL(ftl_band_search_next_to_reloc(g_dev), hot);
+
+	for (i = 0; i < ftl_get_num_bands(g_dev); i++) {
+		test_free_ftl_band(&g_dev->bands[i]);
+	}
+	test_free_ftl_dev(g_dev);
+}
+
+static void
+test_stats_stage_latency(void)
+{
+	struct ftl_stats_latency *latency;
+	uint64_t hz = spdk_get_ticks_hz();
+
+	g_dev = test_init_ftl_dev(&g_geo);
+	latency = &g_dev->stats.latency[FTL_STATS_STAGE_RELOC];
+
+	/* 1s falls into the [2^19, 2^20) us bucket */
+	ftl_stats_stage_completed(g_dev, FTL_STATS_STAGE_RELOC, spdk_get_ticks() - hz, 16);
+	CU_ASSERT_EQUAL(latency->count, 1);
+	CU_ASSERT_EQUAL(latency->blocks, 16);
+	CU_ASSERT(latency->total_us >= SPDK_SEC_TO_USEC);
+	CU_ASSERT_EQUAL(latency->max_us, latency->total_us);
+	CU_ASSERT_EQUAL(latency->buckets[20], 1);
+
+	/* Latencies beyond the histogram range end up in the last bucket */
+	ftl_stats_stage_completed(g_dev, FTL_STATS_STAGE_RELOC, spdk_get_ticks() - 100 * hz, 16);
+	CU_ASSERT_EQUAL(latency->count, 2);
+	CU_ASSERT_EQUAL(latency->blocks, 32);
+	CU_ASSERT(latency->max_us >= 100 * SPDK_SEC_TO_USEC);
+	CU_ASSERT_EQUAL(latency->buckets[FTL_STATS_LATENCY_BUCKETS - 1], 1);
+
+	/* Other stages are not affected */
+	CU_ASSERT_EQUAL(g_dev->stats.latency[FTL_STATS_STAGE_COMPACTION].count, 0);
+
+	test_free_ftl_dev(g_dev);
+}
+
+static void
+test_submit_read_wr_cache(void)
+{
+	struct ftl_io io = {};
+	ftl_addr map[8];
+	char buf[8 * FTL_BLOCK_SIZE];
+	struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+
+	g_dev = test_init_ftl_dev(&g_geo);
+	g_dev->layout.base.total_blocks = g_geo.blockcnt;
+	g_l2p_base_addr = g_geo.blockcnt + 100;
+
+	io.dev = g_dev;
+	io.lba = 8;
+	io.num_blocks = 8;
+	io.map = map;
+	io.iov = &iov;
+	io.iov_cnt = 1;
+
+	/* The leading blocks are copied from DRAM, the remaining ones read from the cache device */
+	g_wr_cache.start = g_l2p_base_addr + io.lba - 2;
+	g_wr_cache.end = g_l2p_base_addr + io.lba + 3;
+	memset(&g_nv_cache_read, 0, sizeof(g_nv_cache_read));
+	ftl_submit_read(&io);
+	CU_ASSERT_EQUAL(io.pos, io.num_blocks);
+	CU_ASSERT_EQUAL(g_nv_cache_read.count, 1);
+	CU_ASSERT_EQUAL(g_nv_cache_read.addr, g_l2p_base_addr + io.lba + 3);
+	CU_ASSERT_EQUAL(g_nv_cache_read.num_blocks, 5);
+
+	/* Without any cached block, all of them are read from the cache device at once */
+	io.pos = 0;
+	g_wr_cache.start = g_wr_cache.end = 0;
+	memset(&g_nv_cache_read, 0, sizeof(g_nv_cache_read));
+	ftl_submit_read(&io);
+	CU_ASSERT_EQUAL(io.pos, io.num_blocks);
+	CU_ASSERT_EQUAL(g_nv_cache_read.count, 1);
+	CU_ASSERT_EQUAL(g_nv_cache_read.addr, g_l2p_base_addr + io.lba);
+	CU_ASSERT_EQUAL(g_nv_cache_read.num_blocks, 8);
+
+	/* Nor is anything read when all the blocks are cached */
+	io.pos = 0;
+	g_wr_cache.start = g_l2p_base_addr;
+	g_wr_cache.end = g_l2p_base_addr + io.lba + io.num_blocks;
+	memset(&g_nv_cache_read, 0, sizeof(g_nv_cache_read));
+	ftl_submit_read(&io);
+	CU_ASSERT_EQUAL(io.pos, io.num_blocks);
+	CU_ASSERT_EQUAL(g_nv_cache_read.count, 0);
+
+	g_wr_cache.start = g_wr_cache.end = 0;
+	g_l2p_base_addr = 0;
+	test_free_ftl_dev(g_dev);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -388,6 +602,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_band_set_addr);
 	CU_ADD_TEST(suite, test_invalidate_addr);
 	CU_ADD_TEST(suite, test_next_xfer_addr);
+	CU_ADD_TEST(suite, test_gc_policy);
+	CU_ADD_TEST(suite, test_stats_stage_latency);
+	CU_ADD_TEST(suite, test_submit_read_wr_cache);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
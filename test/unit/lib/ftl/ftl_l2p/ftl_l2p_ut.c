@@ -9,9 +9,140 @@
 #include "common/lib/test_env.c"
 
 #include "ftl/ftl_core.h"
+#include "ftl/utils/ftl_bitmap.c"
+#include "ftl/utils/ftl_mempool.c"
+#include "ftl/ftl_l2p_cache.c"
 
 #define L2P_TABLE_SIZE 1024
 
+/* L2P cache of 1024 pages, a quarter of which fits in the DRAM limit of 1MiB */
+#define L2P_CACHE_NUM_PAGES	1024
+#define L2P_CACHE_LBAS_IN_PAGE	1024
+#define L2P_CACHE_OFFSET	0x1000
+
+void *g_ftl_read_buf;
+void *g_ftl_write_buf;
+
+DEFINE_STUB_V(ftl_invalidate_addr, (struct spdk_ftl_dev *dev, ftl_addr addr));
+DEFINE_STUB_V(ftl_l2p_pin_complete, (struct spdk_ftl_dev *dev, int status,
+				     struct ftl_l2p_pin_ctx *pin_ctx));
+DEFINE_STUB_V(ftl_md_clear, (struct ftl_md *md, int pattern, union ftl_md_vss *vss_pattern));
+DEFINE_STUB(ftl_md_create_shm_flags, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB(ftl_md_destroy_shm_flags, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB(ftl_nv_cache_get_ckpt_seq_id, uint64_t, (struct ftl_nv_cache *nv_cache), 0);
+DEFINE_STUB_V(ftl_stats_bdev_io_completed, (struct spdk_ftl_dev *dev, enum ftl_stats_type type,
+		struct spdk_bdev_io *bdev_io));
+DEFINE_STUB_V(ftl_stats_stage_completed, (struct spdk_ftl_dev *dev, enum ftl_stats_stage stage,
+		uint64_t start_tsc, uint64_t num_blocks));
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc), NULL);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_read_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, void *buf, void *md, uint64_t offset_blocks,
+		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+
+struct ftl_md *
+ftl_md_create(struct spdk_ftl_dev *dev, uint64_t blocks, uint64_t vss_blksz, const char *name,
+	      int flags, const struct ftl_layout_region *region)
+{
+	struct ftl_md *md;
+
+	md = calloc(1, sizeof(*md));
+	SPDK_CU_ASSERT_FATAL(md != NULL);
+	md->data_blocks = blocks;
+	md->data = calloc(blocks, FTL_BLOCK_SIZE);
+	SPDK_CU_ASSERT_FATAL(md->data != NULL);
+
+	return md;
+}
+
+void
+ftl_md_destroy(struct ftl_md *md, int flags)
+{
+	if (md) {
+		free(md->data);
+		free(md);
+	}
+}
+
+void *
+ftl_md_get_buffer(struct ftl_md *md)
+{
+	return md->data;
+}
+
+uint64_t
+ftl_md_get_buffer_size(struct ftl_md *md)
+{
+	return md->data_blocks * FTL_BLOCK_SIZE;
+}
+
+struct ut_bdev_io {
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+};
+
+#define UT_MAX_BDEV_IO 16
+static struct ut_bdev_io g_readv[UT_MAX_BDEV_IO];
+static uint32_t g_readv_cnt;
+static int g_readv_rc;
+static struct ut_bdev_io g_write[UT_MAX_BDEV_IO];
+static uint32_t g_write_cnt;
+static ftl_mngt_completion g_ckpt_record_cb;
+static void *g_ckpt_record_cb_arg;
+static int g_ckpt_record_rc;
+
+int
+spdk_bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			       struct iovec *iov, int iovcnt, void *md, uint64_t offset_blocks,
+			       uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	if (g_readv_rc) {
+		return g_readv_rc;
+	}
+
+	SPDK_CU_ASSERT_FATAL(g_readv_cnt < UT_MAX_BDEV_IO);
+	CU_ASSERT_EQUAL((uint64_t)iovcnt, num_blocks);
+	g_readv[g_readv_cnt].offset_blocks = offset_blocks;
+	g_readv[g_readv_cnt].num_blocks = num_blocks;
+	g_readv[g_readv_cnt].cb = cb;
+	g_readv[g_readv_cnt].cb_arg = cb_arg;
+	g_readv_cnt++;
+
+	return 0;
+}
+
+int
+spdk_bdev_write_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			       void *buf, void *md, uint64_t offset_blocks, uint64_t num_blocks,
+			       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	SPDK_CU_ASSERT_FATAL(g_write_cnt < UT_MAX_BDEV_IO);
+	g_write[g_write_cnt].offset_blocks = offset_blocks;
+	g_write[g_write_cnt].num_blocks = num_blocks;
+	g_write[g_write_cnt].cb = cb;
+	g_write[g_write_cnt].cb_arg = cb_arg;
+	g_write_cnt++;
+
+	return 0;
+}
+
+int
+ftl_mngt_l2p_ckpt(struct spdk_ftl_dev *dev, ftl_mngt_completion cb, void *cb_cntx)
+{
+	if (g_ckpt_record_rc) {
+		return g_ckpt_record_rc;
+	}
+
+	g_ckpt_record_cb = cb;
+	g_ckpt_record_cb_arg = cb_cntx;
+
+	return 0;
+}
+
 static struct spdk_ftl_dev *g_dev;
 
 static struct spdk_ftl_dev *
@@ -101,10 +232,415 @@ test_addr_cached(void)
 	clean_l2p();
 }
 
+static struct ftl_l2p_cache *
+test_cache_alloc(void)
+{
+	struct spdk_ftl_dev *dev;
+
+	dev = calloc(1, sizeof(*dev));
+	SPDK_CU_ASSERT_FATAL(dev != NULL);
+	dev->sb = calloc(1, sizeof(*dev->sb));
+	dev->sb_shm = calloc(1, sizeof(*dev->sb_shm));
+	SPDK_CU_ASSERT_FATAL(dev->sb != NULL && dev->sb_shm != NULL);
+
+	dev->num_lbas = L2P_CACHE_NUM_PAGES * L2P_CACHE_LBAS_IN_PAGE;
+	dev->layout.l2p.addr_size = sizeof(uint32_t);
+	dev->layout.l2p.lbas_in_page = L2P_CACHE_LBAS_IN_PAGE;
+	dev->layout.region[FTL_LAYOUT_REGION_TYPE_L2P].current.offset = L2P_CACHE_OFFSET;
+	dev->conf.l2p_dram_limit = 1;
+
+	SPDK_CU_ASSERT_FATAL(ftl_l2p_cache_init(dev) == 0);
+	g_dev = dev;
+	g_readv_cnt = 0;
+	g_readv_rc = 0;
+	g_write_cnt = 0;
+	g_ckpt_record_cb = NULL;
+	g_ckpt_record_rc = 0;
+
+	return dev->l2p;
+}
+
+static void
+test_cache_free(void)
+{
+	struct ftl_l2p_cache *cache = g_dev->l2p;
+
+	cache->state = L2P_CACHE_SHUTDOWN_DONE;
+	ftl_l2p_cache_deinit(g_dev);
+	free(g_dev->sb);
+	free(g_dev->sb_shm);
+	free(g_dev);
+	g_dev = NULL;
+}
+
+static void
+test_complete_readv(bool success)
+{
+	uint32_t i;
+
+	for (i = 0; i < g_readv_cnt; i++) {
+		g_readv[i].cb(NULL, success, g_readv[i].cb_arg);
+	}
+	g_readv_cnt = 0;
+}
+
+static void
+test_complete_write(bool success)
+{
+	uint32_t i;
+
+	for (i = 0; i < g_write_cnt; i++) {
+		g_write[i].cb(NULL, success, g_write[i].cb_arg);
+	}
+	g_write_cnt = 0;
+}
+
+static uint32_t
+test_readahead_free_ios(struct ftl_l2p_cache *cache)
+{
+	struct ftl_l2p_cache_readahead_io *io;
+	uint32_t count = 0;
+
+	TAILQ_FOREACH(io, &cache->readahead.free_list, entry) {
+		count++;
+	}
+
+	return count;
+}
+
+static struct ftl_l2p_page *
+test_page_make_resident(struct ftl_l2p_cache *cache, uint64_t page_no, uint64_t updates)
+{
+	struct ftl_l2p_page *page = page_allocate(cache, page_no);
+
+	page->state = L2P_CACHE_PAGE_READY;
+	page->updates = updates;
+	ftl_l2p_cache_lru_add_page(cache, page);
+
+	return page;
+}
+
+static void
+test_l2p_cache_readahead_window(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc();
+	struct ftl_l2p_page *page;
+	uint32_t window, num_pages;
+	uint64_t page_no;
+
+	/* A single miss isn't a stream */
+	readahead_on_miss(g_dev, cache, 10);
+	CU_ASSERT_EQUAL(g_readv_cnt, 0);
+	CU_ASSERT_EQUAL(cache->readahead.last_page_no, 10);
+
+	/* The next page missing starts one, the following pages are read at once */
+	readahead_on_miss(g_dev, cache, 11);
+	CU_ASSERT_EQUAL(g_readv_cnt, 1);
+	CU_ASSERT_EQUAL(g_readv[0].offset_blocks, L2P_CACHE_OFFSET + 12);
+	CU_ASSERT_EQUAL(g_readv[0].num_blocks, FTL_L2P_CACHE_READAHEAD_MIN);
+	CU_ASSERT_EQUAL(cache->readahead.last_page_no, 15);
+	CU_ASSERT_EQUAL(cache->readahead.next_page_no, 16);
+	CU_ASSERT_EQUAL(cache->readahead.trigger_page_no, 14);
+	CU_ASSERT_EQUAL(cache->readahead.window, FTL_L2P_CACHE_READAHEAD_MIN * 2);
+
+	/* Read-ahead pages are ready and on the LRU list, but not pinned */
+	test_complete_readv(true);
+	page = get_l2p_page_by_df_id(cache, 12);
+	SPDK_CU_ASSERT_FATAL(page != NULL);
+	CU_ASSERT_EQUAL(page->state, L2P_CACHE_PAGE_READY);
+	CU_ASSERT_TRUE(page->on_lru_list);
+	CU_ASSERT_EQUAL(page->pin_ref_cnt, 0);
+	CU_ASSERT_EQUAL(cache->ios_in_flight, 0);
+
+	/* Each window doubles the next one, up to the maximum */
+	for (window = FTL_L2P_CACHE_READAHEAD_MIN * 2; window <= FTL_L2P_CACHE_READAHEAD_MAX * 2;
+	     window *= 2) {
+		page_no = cache->readahead.next_page_no;
+		num_pages = spdk_min(window, FTL_L2P_CACHE_READAHEAD_MAX);
+		readahead_issue(g_dev, cache, page_no);
+		CU_ASSERT_EQUAL(g_readv_cnt, 1);
+		CU_ASSERT_EQUAL(g_readv[0].offset_blocks, L2P_CACHE_OFFSET + page_no);
+		CU_ASSERT_EQUAL(g_readv[0].num_blocks, num_pages);
+		CU_ASSERT_EQUAL(cache->readahead.trigger_page_no, page_no + num_pages / 2);
+		CU_ASSERT_EQUAL(cache->readahead.window,
+				spdk_min(window * 2, FTL_L2P_CACHE_READAHEAD_MAX));
+		test_complete_readv(true);
+	}
+
+	/* A miss out of the stream resets the window */
+	readahead_on_miss(g_dev, cache, 500);
+	CU_ASSERT_EQUAL(g_readv_cnt, 0);
+	CU_ASSERT_EQUAL(cache->readahead.window, FTL_L2P_CACHE_READAHEAD_MIN);
+	CU_ASSERT_EQUAL(cache->readahead.trigger_page_no, UINT64_MAX);
+
+	/* Resident pages are skipped, splitting the window into separate reads */
+	test_page_make_resident(cache, 503, 0);
+	readahead_on_miss(g_dev, cache, 501);
+	CU_ASSERT_EQUAL(g_readv_cnt, 2);
+	CU_ASSERT_EQUAL(g_readv[0].offset_blocks, L2P_CACHE_OFFSET + 502);
+	CU_ASSERT_EQUAL(g_readv[0].num_blocks, 1);
+	CU_ASSERT_EQUAL(g_readv[1].offset_blocks, L2P_CACHE_OFFSET + 504);
+	CU_ASSERT_EQUAL(g_readv[1].num_blocks, 2);
+	CU_ASSERT_EQUAL(cache->readahead.next_page_no, 506);
+	test_complete_readv(true);
+
+	/* The window stops at the end of the L2P */
+	cache->readahead.window = FTL_L2P_CACHE_READAHEAD_MAX;
+	readahead_issue(g_dev, cache, L2P_CACHE_NUM_PAGES - 2);
+	CU_ASSERT_EQUAL(g_readv_cnt, 1);
+	CU_ASSERT_EQUAL(g_readv[0].num_blocks, 2);
+	test_complete_readv(true);
+
+	/* A failed read drops the pages */
+	readahead_issue(g_dev, cache, 700);
+	SPDK_CU_ASSERT_FATAL(g_readv_cnt == 1);
+	test_complete_readv(false);
+	CU_ASSERT_PTR_NULL(get_l2p_page_by_df_id(cache, 700));
+
+	test_cache_free();
+}
+
+static void
+test_l2p_cache_readahead_qd(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc();
+	uint32_t avail, i;
+
+	/* Every other page is resident, so each missing one takes a separate IO */
+	for (i = 600; i < 600 + FTL_L2P_CACHE_READAHEAD_MAX; i += 2) {
+		test_page_make_resident(cache, i, 0);
+	}
+
+	cache->readahead.window = FTL_L2P_CACHE_READAHEAD_MAX;
+	readahead_issue(g_dev, cache, 600);
+	CU_ASSERT_EQUAL(g_readv_cnt, FTL_L2P_CACHE_READAHEAD_QD);
+	for (i = 0; i < g_readv_cnt; i++) {
+		CU_ASSERT_EQUAL(g_readv[i].offset_blocks, L2P_CACHE_OFFSET + 601 + 2 * i);
+	}
+	/* The stream continues from the first page which wasn't read */
+	CU_ASSERT_EQUAL(cache->readahead.next_page_no, 601 + 2 * FTL_L2P_CACHE_READAHEAD_QD);
+	CU_ASSERT_EQUAL(test_readahead_free_ios(cache), 0);
+	CU_ASSERT_EQUAL(cache->ios_in_flight, FTL_L2P_CACHE_READAHEAD_QD);
+
+	/* Nothing more is issued until a read-ahead IO completes */
+	readahead_issue(g_dev, cache, 800);
+	CU_ASSERT_EQUAL(g_readv_cnt, FTL_L2P_CACHE_READAHEAD_QD);
+	CU_ASSERT_PTR_NULL(get_l2p_page_by_df_id(cache, 800));
+
+	test_complete_readv(true);
+	CU_ASSERT_EQUAL(test_readahead_free_ios(cache), FTL_L2P_CACHE_READAHEAD_QD);
+	CU_ASSERT_EQUAL(cache->ios_in_flight, 0);
+
+	/* Nor when the cache IO queue is deep */
+	cache->ios_in_flight = 513;
+	readahead_issue(g_dev, cache, 800);
+	CU_ASSERT_EQUAL(g_readv_cnt, 0);
+	cache->ios_in_flight = 0;
+
+	/* A read-ahead which can't be submitted is dropped */
+	avail = cache->l2_pgs_avail;
+	cache->readahead.window = FTL_L2P_CACHE_READAHEAD_MIN;
+	g_readv_rc = -ENOMEM;
+	readahead_issue(g_dev, cache, 800);
+	g_readv_rc = 0;
+	CU_ASSERT_EQUAL(cache->l2_pgs_avail, avail);
+	CU_ASSERT_PTR_NULL(get_l2p_page_by_df_id(cache, 800));
+	CU_ASSERT_EQUAL(test_readahead_free_ios(cache), FTL_L2P_CACHE_READAHEAD_QD);
+	CU_ASSERT_EQUAL(cache->readahead.window, FTL_L2P_CACHE_READAHEAD_MIN);
+	CU_ASSERT_EQUAL(cache->ios_in_flight, 0);
+
+	test_cache_free();
+}
+
+static void
+test_l2p_cache_readahead_reserve(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc();
+	uint32_t reserve = spdk_max(cache->evict_keep / 2, L2P_MAX_PAGES_TO_PIN);
+	uint32_t avail = cache->l2_pgs_avail;
+
+	SPDK_CU_ASSERT_FATAL(avail > reserve + FTL_L2P_CACHE_READAHEAD_MAX);
+
+	/* Half of the eviction reserve is left for the demand page-ins */
+	cache->l2_pgs_avail = reserve;
+	cache->readahead.window = FTL_L2P_CACHE_READAHEAD_MAX;
+	readahead_issue(g_dev, cache, 100);
+	CU_ASSERT_EQUAL(g_readv_cnt, 0);
+	CU_ASSERT_EQUAL(cache->readahead.window, FTL_L2P_CACHE_READAHEAD_MAX);
+
+	/* Read-ahead is trimmed to the pages above the reserve */
+	cache->l2_pgs_avail = reserve + 3;
+	readahead_issue(g_dev, cache, 100);
+	CU_ASSERT_EQUAL(g_readv_cnt, 1);
+	CU_ASSERT_EQUAL(g_readv[0].num_blocks, 3);
+	CU_ASSERT_EQUAL(cache->l2_pgs_avail, reserve);
+	CU_ASSERT_EQUAL(cache->readahead.next_page_no, 103);
+	test_complete_readv(true);
+
+	cache->l2_pgs_avail = avail - 3;
+	test_cache_free();
+}
+
+static void
+test_l2p_cache_evict_clean_first(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc();
+	struct ftl_l2p_page *pages[FTL_L2P_CACHE_EVICT_CLEAN_SCAN + 1];
+	struct ftl_l2p_page *page;
+	uint64_t i;
+
+	/* From the coldest: dirty, dirty, clean, clean */
+	pages[0] = test_page_make_resident(cache, 0, 1);
+	pages[1] = test_page_make_resident(cache, 1, 2);
+	pages[2] = test_page_make_resident(cache, 2, 0);
+	pages[3] = test_page_make_resident(cache, 3, 0);
+
+	g_dev->conf.l2p_evict_policy = SPDK_FTL_L2P_EVICT_CLEAN_FIRST;
+	page = eviction_get_page(g_dev, cache);
+	CU_ASSERT_EQUAL(page, pages[2]);
+	CU_ASSERT_FALSE(page->on_lru_list);
+	CU_ASSERT_EQUAL(eviction_get_page(g_dev, cache), pages[3]);
+
+	/* No clean page left, the coldest one is evicted */
+	CU_ASSERT_EQUAL(eviction_get_page(g_dev, cache), pages[0]);
+
+	/* The LRU policy doesn't look at the updates */
+	test_page_make_resident(cache, 4, 0);
+	g_dev->conf.l2p_evict_policy = SPDK_FTL_L2P_EVICT_LRU;
+	CU_ASSERT_EQUAL(eviction_get_page(g_dev, cache), pages[1]);
+	page = eviction_get_page(g_dev, cache);
+	SPDK_CU_ASSERT_FATAL(page != NULL);
+	CU_ASSERT_EQUAL(page->page_no, 4);
+	CU_ASSERT_PTR_NULL(eviction_get_page(g_dev, cache));
+
+	/* Only the coldest pages are searched for a clean one */
+	for (i = 0; i < FTL_L2P_CACHE_EVICT_CLEAN_SCAN; i++) {
+		pages[i] = test_page_make_resident(cache, 10 + i, 1);
+	}
+	pages[i] = test_page_make_resident(cache, 10 + i, 0);
+
+	g_dev->conf.l2p_evict_policy = SPDK_FTL_L2P_EVICT_CLEAN_FIRST;
+	CU_ASSERT_EQUAL(eviction_get_page(g_dev, cache), pages[0]);
+	CU_ASSERT_EQUAL(eviction_get_page(g_dev, cache), pages[FTL_L2P_CACHE_EVICT_CLEAN_SCAN]);
+
+	test_cache_free();
+}
+
+static void
+test_l2p_cache_ckpt(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc();
+	struct ftl_l2p_page *dirty, *clean, *flushing, *pinned;
+
+	g_dev->nv_cache.chunk_count = 4;
+	MOCK_SET(ftl_nv_cache_get_ckpt_seq_id, 9);
+
+	dirty = test_page_make_resident(cache, 5, 2);
+	clean = test_page_make_resident(cache, 7, 0);
+	flushing = test_page_make_resident(cache, 9, 1);
+	ftl_l2p_cache_lru_remove_page(cache, flushing);
+	flushing->state = L2P_CACHE_PAGE_FLUSHING;
+	pinned = test_page_make_resident(cache, 11, 1);
+	ftl_l2p_cache_page_pin(cache, pinned);
+
+	/* Not enough sequence IDs allocated since the last checkpoint */
+	g_dev->sb->seq_id = 3;
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_IDLE);
+
+	/* Nor while unmaps are pending */
+	g_dev->sb->seq_id = 10;
+	g_dev->unmap_in_progress = true;
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_IDLE);
+	g_dev->unmap_in_progress = false;
+
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_SCAN);
+	CU_ASSERT_EQUAL(cache->ckpt.last_seq_id, 10);
+	CU_ASSERT_EQUAL(cache->ckpt.seq_id, 9);
+
+	/* The scan stops at a page being evicted */
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.page_no, 9);
+	SPDK_CU_ASSERT_FATAL(g_write_cnt == 1);
+	CU_ASSERT_EQUAL(g_write[0].offset_blocks, L2P_CACHE_OFFSET + 5);
+	CU_ASSERT_EQUAL(dirty->state, L2P_CACHE_PAGE_PERSISTING);
+	CU_ASSERT_FALSE(dirty->on_lru_list);
+	CU_ASSERT_EQUAL(clean->state, L2P_CACHE_PAGE_READY);
+
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.page_no, 9);
+	CU_ASSERT_EQUAL(g_write_cnt, 1);
+
+	/* The eviction left the page dirty, it's written along with the pinned one */
+	flushing->state = L2P_CACHE_PAGE_READY;
+	ftl_l2p_cache_lru_add_page(cache, flushing);
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.page_no, L2P_CACHE_NUM_PAGES);
+	SPDK_CU_ASSERT_FATAL(g_write_cnt == 3);
+	CU_ASSERT_EQUAL(g_write[1].offset_blocks, L2P_CACHE_OFFSET + 9);
+	CU_ASSERT_EQUAL(g_write[2].offset_blocks, L2P_CACHE_OFFSET + 11);
+	CU_ASSERT_EQUAL(cache->ckpt.qd, 3);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_SCAN);
+
+	/* Updates made while a page is written keep it dirty */
+	dirty->updates++;
+	test_complete_write(true);
+	CU_ASSERT_EQUAL(cache->ckpt.qd, 0);
+	CU_ASSERT_EQUAL(dirty->updates, 1);
+	CU_ASSERT_EQUAL(dirty->state, L2P_CACHE_PAGE_READY);
+	CU_ASSERT_TRUE(dirty->on_lru_list);
+	CU_ASSERT_EQUAL(flushing->updates, 0);
+	CU_ASSERT_EQUAL(pinned->updates, 0);
+	CU_ASSERT_FALSE(pinned->on_lru_list);
+	CU_ASSERT_EQUAL(g_dev->sb->ckpt_seq_id, 0);
+
+	/* All pages written, record the checkpoint */
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_RECORD);
+	CU_ASSERT_EQUAL(g_dev->sb->ckpt_seq_id, 9);
+	SPDK_CU_ASSERT_FATAL(g_ckpt_record_cb != NULL);
+	g_ckpt_record_cb(g_dev, g_ckpt_record_cb_arg, 0);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_IDLE);
+	CU_ASSERT_EQUAL(cache->ios_in_flight, 0);
+
+	/* A failed page write leaves the previous checkpoint in place */
+	g_ckpt_record_cb = NULL;
+	g_dev->sb->seq_id = 20;
+	MOCK_SET(ftl_nv_cache_get_ckpt_seq_id, 18);
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_SCAN);
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	SPDK_CU_ASSERT_FATAL(g_write_cnt == 1);
+	test_complete_write(false);
+	CU_ASSERT_EQUAL(dirty->updates, 1);
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_IDLE);
+	CU_ASSERT_EQUAL(g_dev->sb->ckpt_seq_id, 9);
+	CU_ASSERT_PTR_NULL(g_ckpt_record_cb);
+	CU_ASSERT_EQUAL(cache->ios_in_flight, 0);
+
+	/* The scan finishes also if the superblock can't be persisted */
+	g_dev->sb->seq_id = 30;
+	g_ckpt_record_rc = -ENOMEM;
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	test_complete_write(true);
+	ftl_l2p_cache_process_ckpt(g_dev, cache);
+	CU_ASSERT_EQUAL(cache->ckpt.state, L2P_CACHE_CKPT_IDLE);
+	CU_ASSERT_EQUAL(cache->ios_in_flight, 0);
+
+	MOCK_CLEAR(ftl_nv_cache_get_ckpt_seq_id);
+	ftl_l2p_cache_page_unpin(cache, pinned);
+	test_cache_free();
+}
+
 int
 main(int argc, char **argv)
 {
 	CU_pSuite suite64 = NULL;
+	CU_pSuite suite_cache = NULL;
 	unsigned int num_failures;
 
 	CU_set_error_action(CUEA_ABORT);
@@ -114,6 +650,14 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite64, test_addr_cached);
 
+	suite_cache = CU_add_suite("ftl_l2p_cache_suite", NULL, NULL);
+
+	CU_ADD_TEST(suite_cache, test_l2p_cache_readahead_window);
+	CU_ADD_TEST(suite_cache, test_l2p_cache_readahead_qd);
+	CU_ADD_TEST(suite_cache, test_l2p_cache_readahead_reserve);
+	CU_ADD_TEST(suite_cache, test_l2p_cache_evict_clean_first);
+	CU_ADD_TEST(suite_cache, test_l2p_cache_ckpt);
+
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
 	num_failures = CU_get_number_of_failures();
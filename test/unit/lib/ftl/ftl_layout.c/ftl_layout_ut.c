@@ -0,0 +1,146 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+
+#include "ftl/ftl_layout.c"
+
+#define TEST_BAND_BLOCKS	65536ULL
+#define TEST_NUM_ZONES		17
+#define TEST_NVC_BLOCKS		(5 * TEST_BAND_BLOCKS)
+#define TEST_XFER_SIZE		64
+
+const size_t ftl_bitmap_buffer_alignment = sizeof(uint64_t);
+
+DEFINE_STUB(ftl_band_user_blocks, size_t, (const struct ftl_band *band), 0);
+DEFINE_STUB(ftl_nv_cache_chunk_tail_md_num_blocks, size_t, (const struct ftl_nv_cache *nv_cache),
+	    1);
+
+/* The descriptors double as the bdevs they were opened on */
+static int g_base_bdev, g_cache_bdev;
+static int g_base_ioch, g_cache_ioch;
+static struct spdk_ftl_dev g_dev;
+static struct ftl_superblock g_sb;
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (struct spdk_bdev *)desc;
+}
+
+uint64_t
+spdk_bdev_get_num_blocks(const struct spdk_bdev *bdev)
+{
+	if (bdev == (struct spdk_bdev *)&g_cache_bdev) {
+		return TEST_NVC_BLOCKS;
+	}
+
+	CU_ASSERT_EQUAL(bdev, (struct spdk_bdev *)&g_base_bdev);
+	return TEST_NUM_ZONES * TEST_BAND_BLOCKS;
+}
+
+static void
+test_setup_dev(bool is_zoned)
+{
+	memset(&g_dev, 0, sizeof(g_dev));
+	memset(&g_sb, 0, sizeof(g_sb));
+	g_dev.sb = &g_sb;
+	g_dev.conf.mode = SPDK_FTL_MODE_CREATE;
+	g_dev.conf.overprovisioning = 20;
+	g_dev.base_bdev_desc = (struct spdk_bdev_desc *)&g_base_bdev;
+	g_dev.base_ioch = (struct spdk_io_channel *)&g_base_ioch;
+	g_dev.nv_cache.bdev_desc = (struct spdk_bdev_desc *)&g_cache_bdev;
+	g_dev.nv_cache.cache_ioch = (struct spdk_io_channel *)&g_cache_ioch;
+	g_dev.xfer_size = TEST_XFER_SIZE;
+	g_dev.num_blocks_in_band = TEST_BAND_BLOCKS;
+	g_dev.is_zoned = is_zoned;
+	/* Non-zoned devices save a band worth of space for the base device metadata */
+	g_dev.num_bands = is_zoned ? TEST_NUM_ZONES : TEST_NUM_ZONES - 1;
+}
+
+static void
+test_layout_base(void)
+{
+	struct ftl_layout *layout = &g_dev.layout;
+	struct ftl_layout_region *region;
+
+	test_setup_dev(false);
+	CU_ASSERT_EQUAL(ftl_layout_setup_superblock(&g_dev), 0);
+	CU_ASSERT_EQUAL(ftl_layout_setup(&g_dev), 0);
+
+	region = &layout->region[FTL_LAYOUT_REGION_TYPE_SB_BASE];
+	CU_ASSERT_EQUAL(region->bdev_desc, g_dev.base_bdev_desc);
+	CU_ASSERT_EQUAL(region->ioch, g_dev.base_ioch);
+	CU_ASSERT_EQUAL(region->current.offset, 0);
+
+	/* Bands start after the superblock mirror and are followed by the validity map */
+	region = &layout->region[FTL_LAYOUT_REGION_TYPE_DATA_BASE];
+	CU_ASSERT_EQUAL(region->bdev_desc, g_dev.base_bdev_desc);
+	CU_ASSERT_NOT_EQUAL(region->current.offset, 0);
+	CU_ASSERT_EQUAL(region->current.blocks, g_dev.num_bands * TEST_BAND_BLOCKS);
+
+	CU_ASSERT_EQUAL(layout->region[FTL_LAYOUT_REGION_TYPE_VALID_MAP].bdev_desc,
+			g_dev.base_bdev_desc);
+	CU_ASSERT_EQUAL(layout->region[FTL_LAYOUT_REGION_TYPE_VALID_MAP].current.offset,
+			region->current.offset + region->current.blocks);
+}
+
+static void
+test_layout_zoned(void)
+{
+	struct ftl_layout *layout = &g_dev.layout;
+	struct ftl_layout_region *region, *sb;
+
+	test_setup_dev(true);
+	CU_ASSERT_EQUAL(ftl_layout_setup_superblock(&g_dev), 0);
+	CU_ASSERT_EQUAL(ftl_layout_setup(&g_dev), 0);
+
+	/* The superblock mirror follows the superblock on the NV cache */
+	sb = &layout->region[FTL_LAYOUT_REGION_TYPE_SB];
+	region = &layout->region[FTL_LAYOUT_REGION_TYPE_SB_BASE];
+	CU_ASSERT_EQUAL(region->bdev_desc, g_dev.nv_cache.bdev_desc);
+	CU_ASSERT_EQUAL(region->ioch, g_dev.nv_cache.cache_ioch);
+	CU_ASSERT_EQUAL(region->current.offset, sb->current.offset + sb->current.blocks);
+	CU_ASSERT_EQUAL(layout->region[FTL_LAYOUT_REGION_TYPE_L2P].current.offset,
+			region->current.offset + region->current.blocks);
+
+	/* So does the validity map, right after the trim metadata mirror */
+	region = &layout->region[FTL_LAYOUT_REGION_TYPE_TRIM_MD_MIRROR];
+	CU_ASSERT_EQUAL(layout->region[FTL_LAYOUT_REGION_TYPE_VALID_MAP].bdev_desc,
+			g_dev.nv_cache.bdev_desc);
+	CU_ASSERT_EQUAL(layout->region[FTL_LAYOUT_REGION_TYPE_VALID_MAP].current.offset,
+			region->current.offset + region->current.blocks);
+
+	/* Leaving the whole base device to the bands, starting at the first zone */
+	region = &layout->region[FTL_LAYOUT_REGION_TYPE_DATA_BASE];
+	CU_ASSERT_EQUAL(region->bdev_desc, g_dev.base_bdev_desc);
+	CU_ASSERT_EQUAL(region->current.offset, 0);
+	CU_ASSERT_EQUAL(region->current.blocks, layout->base.total_blocks);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ftl_layout", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_layout_base);
+	CU_ADD_TEST(suite, test_layout_zoned);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
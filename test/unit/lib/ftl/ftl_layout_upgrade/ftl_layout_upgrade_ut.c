@@ -90,6 +90,7 @@ DEFINE_STUB_V(ftl_mngt_call_process, (struct ftl_mngt_process *mngt,
 				      const struct ftl_mngt_process_desc *process));
 DEFINE_STUB(ftl_md_get_buffer, void *, (struct ftl_md *md), NULL);
 DEFINE_STUB(ftl_layout_setup_superblock, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB(ftl_nv_cache_get_ckpt_seq_id, uint64_t, (struct ftl_nv_cache *nv_cache), 0);
 
 struct spdk_ftl_dev g_dev;
 struct ftl_superblock_shm g_sb_shm = {0};
@@ -0,0 +1,481 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+
+#include "ftl/mngt/ftl_mngt_recovery.c"
+
+#define TEST_BASE_BLOCKS	1000
+#define TEST_CKPT_SEQ_ID	50
+#define TEST_LBAS_IN_PAGE	(FTL_BLOCK_SIZE / sizeof(uint64_t))
+#define TEST_NUM_LBAS		(2 * TEST_LBAS_IN_PAGE)
+#define TEST_XFER_SIZE		4
+
+DEFINE_STUB_V(ftl_band_acquire_p2l_map, (struct ftl_band *band));
+DEFINE_STUB(ftl_band_addr_from_block_offset, ftl_addr, (struct ftl_band *band,
+		uint64_t block_off), 0);
+DEFINE_STUB(ftl_band_alloc_p2l_map, int, (struct ftl_band *band), 0);
+DEFINE_STUB(ftl_band_block_offset_from_addr, uint64_t, (struct ftl_band *band, ftl_addr addr), 0);
+DEFINE_STUB(ftl_band_filled, int, (struct ftl_band *band, size_t offset), 0);
+DEFINE_STUB_V(ftl_band_initialize_free_state, (struct ftl_band *band));
+DEFINE_STUB_V(ftl_band_release_p2l_map, (struct ftl_band *band));
+DEFINE_STUB_V(ftl_band_set_p2l, (struct ftl_band *band, uint64_t lba, ftl_addr addr,
+				 uint64_t seq_id));
+DEFINE_STUB(ftl_band_user_blocks, size_t, (const struct ftl_band *band), 0);
+DEFINE_STUB(ftl_bitmap_get, bool, (const struct ftl_bitmap *bitmap, uint64_t bit), false);
+DEFINE_STUB_V(ftl_bitmap_set, (struct ftl_bitmap *bitmap, uint64_t bit));
+DEFINE_STUB(ftl_chunk_map_get_lba, uint64_t, (struct ftl_nv_cache_chunk *chunk, uint64_t offset),
+	    0);
+DEFINE_STUB(ftl_md_create, struct ftl_md *, (struct spdk_ftl_dev *dev, uint64_t blocks,
+		uint64_t vss_blksz, const char *name, int flags,
+		const struct ftl_layout_region *region), NULL);
+DEFINE_STUB(ftl_md_create_shm_flags, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB_V(ftl_md_destroy, (struct ftl_md *md, int flags));
+DEFINE_STUB(ftl_md_get_vss_buffer, union ftl_md_vss *, (struct ftl_md *md), NULL);
+DEFINE_STUB_V(ftl_md_persist, (struct ftl_md *md));
+DEFINE_STUB_V(ftl_md_restore, (struct ftl_md *md));
+DEFINE_STUB(ftl_md_set_region, int, (struct ftl_md *md, const struct ftl_layout_region *region),
+	    0);
+DEFINE_STUB(ftl_md_unlink, int, (struct spdk_ftl_dev *dev, const char *name, int flags), 0);
+DEFINE_STUB(ftl_mngt_alloc_step_ctx, int, (struct ftl_mngt_process *mngt, size_t size), 0);
+DEFINE_STUB_V(ftl_mngt_call_process, (struct ftl_mngt_process *mngt,
+				      const struct ftl_mngt_process_desc *process));
+DEFINE_STUB_V(ftl_mngt_deinit_l2p, (struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_finalize_init_bands, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_finalize_startup, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB(ftl_mngt_get_dev, struct spdk_ftl_dev *, (struct ftl_mngt_process *mngt), NULL);
+DEFINE_STUB(ftl_mngt_get_process_ctx, void *, (struct ftl_mngt_process *mngt), NULL);
+DEFINE_STUB(ftl_mngt_get_step_ctx, void *, (struct ftl_mngt_process *mngt), NULL);
+DEFINE_STUB_V(ftl_mngt_init_l2p, (struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_nv_cache_recover_open_chunk, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_nv_cache_restore_chunk_state, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_nv_cache_restore_l2p, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt, ftl_chunk_md_cb cb, void *cb_ctx));
+DEFINE_STUB(ftl_mngt_p2l_ckpt_get_seq_id, int, (struct spdk_ftl_dev *dev, int md_region), 0);
+DEFINE_STUB(ftl_mngt_p2l_ckpt_restore, int, (struct ftl_band *band, uint32_t md_region,
+		uint64_t seq_id), 0);
+DEFINE_STUB_V(ftl_mngt_p2l_deinit_ckpt, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_p2l_free_bufs, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_p2l_init_ckpt, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_p2l_restore_ckpt, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB(ftl_mngt_process_execute, int, (struct spdk_ftl_dev *dev,
+		const struct ftl_mngt_process_desc *process, ftl_mngt_completion cb,
+		void *cb_ctx), 0);
+DEFINE_STUB_V(ftl_mngt_restore_l2p, (struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_self_test, (struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_start_core_poller, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_stop_core_poller, (struct spdk_ftl_dev *dev,
+		struct ftl_mngt_process *mngt));
+DEFINE_STUB(ftl_nv_cache_chunk_tail_md_num_blocks, size_t, (const struct ftl_nv_cache *nv_cache),
+	    0);
+DEFINE_STUB(ftl_p2l_ckpt_acquire_region_type, struct ftl_p2l_ckpt *, (struct spdk_ftl_dev *dev,
+		uint32_t region_type), NULL);
+DEFINE_STUB_V(ftl_recover_max_seq, (struct spdk_ftl_dev *dev));
+DEFINE_STUB_V(ftl_set_unmap_map, (struct spdk_ftl_dev *dev, uint64_t lba, uint64_t num_blocks,
+				  uint64_t seq_id));
+DEFINE_STUB_V(ftl_stats_crc_error, (struct spdk_ftl_dev *dev, enum ftl_stats_type type));
+DEFINE_STUB_V(ftl_valid_map_load_state, (struct spdk_ftl_dev *dev));
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+
+static struct spdk_ftl_dev g_dev;
+static struct ftl_superblock g_sb;
+static struct ftl_band_md g_band_md[2];
+static struct ftl_band g_band[2];
+static struct ftl_nv_cache_chunk_md g_chunk_md[2];
+static struct ftl_nv_cache_chunk g_chunk[2];
+static struct ftl_md g_trim_md;
+static uint64_t g_trim_map[TEST_NUM_LBAS / TEST_LBAS_IN_PAGE];
+static struct ftl_mngt_recovery_ctx g_recovery_ctx;
+static char g_band_map[TEST_XFER_SIZE * FTL_BLOCK_SIZE];
+
+enum ut_step_status {
+	UT_STEP_PENDING,
+	UT_STEP_CONTINUE,
+	UT_STEP_NEXT,
+	UT_STEP_SKIP,
+	UT_STEP_FAIL,
+};
+
+static enum ut_step_status g_step_status;
+
+void
+ftl_mngt_continue_step(struct ftl_mngt_process *mngt)
+{
+	g_step_status = UT_STEP_CONTINUE;
+}
+
+void
+ftl_mngt_next_step(struct ftl_mngt_process *mngt)
+{
+	g_step_status = UT_STEP_NEXT;
+}
+
+void
+ftl_mngt_skip_step(struct ftl_mngt_process *mngt)
+{
+	g_step_status = UT_STEP_SKIP;
+}
+
+void
+ftl_mngt_fail_step(struct ftl_mngt_process *mngt)
+{
+	g_step_status = UT_STEP_FAIL;
+}
+
+static struct {
+	uint64_t zone_id;
+	struct spdk_bdev_zone_info *info;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+} g_zone_info;
+
+int
+spdk_bdev_get_zone_info(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			uint64_t zone_id, size_t num_zones, struct spdk_bdev_zone_info *info,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	CU_ASSERT_EQUAL(num_zones, 1);
+	g_zone_info.zone_id = zone_id;
+	g_zone_info.info = info;
+	g_zone_info.cb = cb;
+	g_zone_info.cb_arg = cb_arg;
+
+	return 0;
+}
+
+static ftl_band_md_cb g_tail_md_cb;
+static void *g_tail_md_cntx;
+
+void
+ftl_band_read_tail_brq_md(struct ftl_band *band, ftl_band_md_cb cb, void *cntx)
+{
+	g_tail_md_cb = cb;
+	g_tail_md_cntx = cntx;
+}
+
+void
+ftl_mngt_p2l_ckpt_restore_zone_wp(struct ftl_band *band, uint64_t num_blocks)
+{
+	band->md->iter.offset = num_blocks;
+}
+
+/* The first band and chunk hold data from before the checkpoint, the second ones don't */
+struct ftl_band *
+ftl_band_from_addr(struct spdk_ftl_dev *dev, ftl_addr addr)
+{
+	return addr < TEST_BASE_BLOCKS / 2 ? &g_band[0] : &g_band[1];
+}
+
+struct ftl_nv_cache_chunk *
+ftl_nv_cache_get_chunk_from_addr(struct spdk_ftl_dev *dev, ftl_addr addr)
+{
+	return addr < TEST_BASE_BLOCKS * 3 / 2 ? &g_chunk[0] : &g_chunk[1];
+}
+
+void *
+ftl_md_get_buffer(struct ftl_md *md)
+{
+	CU_ASSERT_EQUAL(md, &g_trim_md);
+	return g_trim_map;
+}
+
+uint64_t
+ftl_md_get_buffer_size(struct ftl_md *md)
+{
+	CU_ASSERT_EQUAL(md, &g_trim_md);
+	return sizeof(g_trim_map);
+}
+
+void *
+ftl_mngt_get_caller_ctx(struct ftl_mngt_process *mngt)
+{
+	return &g_recovery_ctx;
+}
+
+static void
+test_setup_dev(void)
+{
+	uint32_t i;
+
+	memset(&g_dev, 0, sizeof(g_dev));
+	memset(&g_sb, 0, sizeof(g_sb));
+	g_dev.sb = &g_sb;
+	g_dev.num_lbas = TEST_NUM_LBAS;
+	g_dev.layout.base.total_blocks = TEST_BASE_BLOCKS;
+	g_dev.layout.l2p.addr_size = sizeof(uint64_t);
+	g_dev.layout.region[FTL_LAYOUT_REGION_TYPE_L2P].current.blocks = SPDK_COUNTOF(g_trim_map);
+	g_dev.layout.md[FTL_LAYOUT_REGION_TYPE_TRIM_MD] = &g_trim_md;
+	g_sb.ckpt_seq_id = TEST_CKPT_SEQ_ID;
+
+	for (i = 0; i < 2; i++) {
+		memset(&g_band_md[i], 0, sizeof(g_band_md[i]));
+		memset(&g_chunk_md[i], 0, sizeof(g_chunk_md[i]));
+		g_band[i].md = &g_band_md[i];
+		g_chunk[i].md = &g_chunk_md[i];
+	}
+
+	g_band_md[0].state = FTL_BAND_STATE_CLOSED;
+	g_band_md[0].seq = TEST_CKPT_SEQ_ID - 10;
+	g_band_md[1].state = FTL_BAND_STATE_FREE;
+	g_chunk_md[0].state = FTL_CHUNK_STATE_CLOSED;
+	g_chunk_md[0].seq_id = TEST_CKPT_SEQ_ID - 10;
+	g_chunk_md[1].state = FTL_CHUNK_STATE_OPEN;
+	g_chunk_md[1].seq_id = TEST_CKPT_SEQ_ID + 10;
+}
+
+static void
+test_ckpt_addr_valid(void)
+{
+	test_setup_dev();
+
+	CU_ASSERT_TRUE(recovery_ckpt_addr_valid(&g_dev, FTL_ADDR_INVALID));
+
+	/* Base device address */
+	CU_ASSERT_TRUE(recovery_ckpt_addr_valid(&g_dev, 10));
+	g_band_md[0].seq = TEST_CKPT_SEQ_ID;
+	CU_ASSERT_TRUE(recovery_ckpt_addr_valid(&g_dev, 10));
+	g_band_md[0].state = FTL_BAND_STATE_OPEN;
+	CU_ASSERT_TRUE(recovery_ckpt_addr_valid(&g_dev, 10));
+	/* Band reopened after the checkpoint was started */
+	g_band_md[0].seq = TEST_CKPT_SEQ_ID + 1;
+	CU_ASSERT_FALSE(recovery_ckpt_addr_valid(&g_dev, 10));
+	/* Band freed */
+	CU_ASSERT_FALSE(recovery_ckpt_addr_valid(&g_dev, TEST_BASE_BLOCKS - 1));
+
+	/* NV cache address */
+	CU_ASSERT_TRUE(recovery_ckpt_addr_valid(&g_dev, TEST_BASE_BLOCKS));
+	g_chunk_md[0].state = FTL_CHUNK_STATE_FREE;
+	CU_ASSERT_FALSE(recovery_ckpt_addr_valid(&g_dev, TEST_BASE_BLOCKS));
+	/* Chunk reopened after the checkpoint was started */
+	CU_ASSERT_FALSE(recovery_ckpt_addr_valid(&g_dev, TEST_BASE_BLOCKS * 2));
+	g_chunk_md[1].seq_id = TEST_CKPT_SEQ_ID;
+	CU_ASSERT_TRUE(recovery_ckpt_addr_valid(&g_dev, TEST_BASE_BLOCKS * 2));
+}
+
+static void
+test_iteration_init_seq_ids(void)
+{
+	struct ftl_mngt_recovery_ctx *ctx = &g_recovery_ctx;
+	uint64_t l2p[TEST_NUM_LBAS], seq_id[TEST_NUM_LBAS];
+	const uint64_t trimmed_lba = TEST_LBAS_IN_PAGE;
+	uint64_t lba;
+
+	test_setup_dev();
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->l2p_snippet.l2p = l2p;
+	ctx->l2p_snippet.seq_id = seq_id;
+	ctx->l2p_snippet.count = TEST_NUM_LBAS;
+	ctx->iter.lba_first = 0;
+	ctx->iter.lba_last = TEST_NUM_LBAS;
+
+	/* The second L2P page was unmapped after the checkpoint was started */
+	g_trim_map[0] = TEST_CKPT_SEQ_ID - 20;
+	g_trim_map[1] = TEST_CKPT_SEQ_ID + 5;
+
+	for (lba = 0; lba < TEST_NUM_LBAS; lba++) {
+		l2p[lba] = FTL_ADDR_INVALID;
+	}
+	l2p[1] = 10;
+	l2p[2] = TEST_BASE_BLOCKS - 1;
+	l2p[3] = TEST_BASE_BLOCKS;
+	l2p[4] = TEST_BASE_BLOCKS * 2;
+	l2p[trimmed_lba] = 10;
+
+	ftl_mngt_recovery_iteration_init_seq_ids(&g_dev, NULL);
+
+	/* Checkpointed entries are kept with the checkpoint's sequence ID */
+	CU_ASSERT_EQUAL(l2p[0], FTL_ADDR_INVALID);
+	CU_ASSERT_EQUAL(seq_id[0], TEST_CKPT_SEQ_ID);
+	CU_ASSERT_EQUAL(l2p[1], 10);
+	CU_ASSERT_EQUAL(seq_id[1], TEST_CKPT_SEQ_ID);
+	CU_ASSERT_EQUAL(l2p[3], TEST_BASE_BLOCKS);
+	CU_ASSERT_EQUAL(seq_id[3], TEST_CKPT_SEQ_ID);
+
+	/* The ones pointing to a freed band or a reopened chunk are dropped */
+	CU_ASSERT_EQUAL(l2p[2], FTL_ADDR_INVALID);
+	CU_ASSERT_EQUAL(seq_id[2], g_trim_map[0]);
+	CU_ASSERT_EQUAL(l2p[4], FTL_ADDR_INVALID);
+	CU_ASSERT_EQUAL(seq_id[4], g_trim_map[0]);
+
+	/* So are the ones unmapped after the checkpoint */
+	CU_ASSERT_EQUAL(l2p[trimmed_lba], FTL_ADDR_INVALID);
+	CU_ASSERT_EQUAL(seq_id[trimmed_lba], g_trim_map[1]);
+	CU_ASSERT_EQUAL(seq_id[TEST_NUM_LBAS - 1], g_trim_map[1]);
+
+	/* Without a checkpoint, the whole L2P is rebuilt */
+	g_sb.ckpt_seq_id = 0;
+	l2p[1] = 10;
+	ftl_mngt_recovery_iteration_init_seq_ids(&g_dev, NULL);
+	CU_ASSERT_EQUAL(l2p[1], FTL_ADDR_INVALID);
+	CU_ASSERT_EQUAL(seq_id[1], g_trim_map[0]);
+}
+
+static void
+test_setup_zoned_dev(struct zone_wp_ctx *sctx)
+{
+	uint32_t i;
+
+	test_setup_dev();
+	g_dev.is_zoned = true;
+	g_dev.bands = g_band;
+	g_dev.num_bands = SPDK_COUNTOF(g_band);
+	g_dev.num_blocks_in_band = TEST_BASE_BLOCKS / 2;
+	g_dev.xfer_size = TEST_XFER_SIZE;
+
+	for (i = 0; i < SPDK_COUNTOF(g_band); i++) {
+		g_band[i].dev = &g_dev;
+		g_band[i].id = i;
+		g_band[i].start_addr = i * g_dev.num_blocks_in_band;
+		g_band[i].p2l_map.band_map = (void *)g_band_map;
+		g_band[i].zone_tail_md_written = false;
+	}
+
+	memset(sctx, 0, sizeof(*sctx));
+	memset(&g_zone_info, 0, sizeof(g_zone_info));
+	g_tail_md_cb = NULL;
+	g_step_status = UT_STEP_PENDING;
+
+	MOCK_SET(ftl_mngt_get_dev, &g_dev);
+	MOCK_SET(ftl_mngt_get_step_ctx, sctx);
+	MOCK_SET(ftl_band_user_blocks, g_dev.num_blocks_in_band - TEST_XFER_SIZE);
+}
+
+static void
+test_zone_wp(void)
+{
+	struct zone_wp_ctx sctx;
+	struct ftl_band_md *md = &g_band_md[1];
+
+	/* Only zoned devices need their write pointers checked */
+	test_setup_zoned_dev(&sctx);
+	g_dev.is_zoned = false;
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_SKIP);
+	CU_ASSERT_PTR_NULL(g_zone_info.cb);
+
+	/* Bands which aren't being written are skipped */
+	test_setup_zoned_dev(&sctx);
+	md->state = FTL_BAND_STATE_OPEN;
+	md->iter.offset = 100;
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_PENDING);
+	CU_ASSERT_EQUAL(sctx.id, 1);
+	CU_ASSERT_EQUAL(g_zone_info.zone_id, g_band[1].start_addr);
+	CU_ASSERT_PTR_EQUAL(g_zone_info.info, &sctx.info);
+
+	/* Write pointer moved past the checkpointed offset, the band continues from there */
+	sctx.info.state = SPDK_BDEV_ZONE_STATE_OPEN;
+	sctx.info.write_pointer = g_band[1].start_addr + 200;
+	g_zone_info.cb(NULL, true, g_zone_info.cb_arg);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_CONTINUE);
+	CU_ASSERT_EQUAL(md->iter.offset, 200);
+	CU_ASSERT_EQUAL(md->state, FTL_BAND_STATE_OPEN);
+	CU_ASSERT_EQUAL(sctx.id, 2);
+
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_NEXT);
+
+	/* Write pointer at the checkpointed offset */
+	test_setup_zoned_dev(&sctx);
+	md->state = FTL_BAND_STATE_OPEN;
+	md->iter.offset = 100;
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	sctx.info.state = SPDK_BDEV_ZONE_STATE_OPEN;
+	sctx.info.write_pointer = g_band[1].start_addr + 100;
+	g_zone_info.cb(NULL, true, g_zone_info.cb_arg);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_CONTINUE);
+	CU_ASSERT_EQUAL(md->iter.offset, 100);
+
+	/* Band filled up by the appends */
+	test_setup_zoned_dev(&sctx);
+	md->state = FTL_BAND_STATE_OPEN;
+	md->iter.offset = 100;
+	MOCK_SET(ftl_band_filled, 1);
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	sctx.info.state = SPDK_BDEV_ZONE_STATE_OPEN;
+	sctx.info.write_pointer = g_band[1].start_addr + ftl_band_user_blocks(&g_band[1]);
+	g_zone_info.cb(NULL, true, g_zone_info.cb_arg);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_CONTINUE);
+	CU_ASSERT_EQUAL(md->iter.offset, ftl_band_user_blocks(&g_band[1]));
+	CU_ASSERT_EQUAL(md->state, FTL_BAND_STATE_FULL);
+	MOCK_CLEAR(ftl_band_filled);
+
+	/* Full zone, the tail md got written, so the P2L map is read back from it */
+	test_setup_zoned_dev(&sctx);
+	md->state = FTL_BAND_STATE_FULL;
+	md->iter.offset = 100;
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	sctx.info.state = SPDK_BDEV_ZONE_STATE_FULL;
+	g_zone_info.cb(NULL, true, g_zone_info.cb_arg);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_PENDING);
+	SPDK_CU_ASSERT_FATAL(g_tail_md_cb != NULL);
+
+	g_tail_md_cb(&g_band[1], g_tail_md_cntx, FTL_MD_SUCCESS);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_CONTINUE);
+	CU_ASSERT_EQUAL(md->iter.offset, ftl_band_user_blocks(&g_band[1]));
+	CU_ASSERT_EQUAL(md->state, FTL_BAND_STATE_FULL);
+	CU_ASSERT_TRUE(g_band[1].zone_tail_md_written);
+	CU_ASSERT_EQUAL(sctx.id, 2);
+
+	/* Tail md read failure */
+	test_setup_zoned_dev(&sctx);
+	md->state = FTL_BAND_STATE_OPEN;
+	md->iter.offset = 100;
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	sctx.info.state = SPDK_BDEV_ZONE_STATE_FULL;
+	g_zone_info.cb(NULL, true, g_zone_info.cb_arg);
+	SPDK_CU_ASSERT_FATAL(g_tail_md_cb != NULL);
+	g_tail_md_cb(&g_band[1], g_tail_md_cntx, FTL_MD_IO_FAILURE);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_FAIL);
+	CU_ASSERT_FALSE(g_band[1].zone_tail_md_written);
+
+	/* Zone info failure */
+	test_setup_zoned_dev(&sctx);
+	md->state = FTL_BAND_STATE_OPEN;
+	md->iter.offset = 100;
+	ftl_mngt_recovery_zone_wp(&g_dev, NULL);
+	g_zone_info.cb(NULL, false, g_zone_info.cb_arg);
+	CU_ASSERT_EQUAL(g_step_status, UT_STEP_FAIL);
+	CU_ASSERT_EQUAL(md->iter.offset, 100);
+
+	MOCK_CLEAR(ftl_mngt_get_dev);
+	MOCK_CLEAR(ftl_mngt_get_step_ctx);
+	MOCK_CLEAR(ftl_band_user_blocks);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ftl_mngt_recovery", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_ckpt_addr_valid);
+	CU_ADD_TEST(suite, test_iteration_init_seq_ids);
+	CU_ADD_TEST(suite, test_zone_wp);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -0,0 +1,397 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/ut_multithread.c"
+
+#include "ftl/utils/ftl_sketch.c"
+#include "ftl/ftl_nv_cache.c"
+
+#define TEST_NUM_LBAS		128
+#define TEST_RQ_BLOCKS		4
+#define TEST_CHUNK_SEQ_ID	7
+#define TEST_CACHE_ADDR		1000
+
+void *g_ftl_read_buf;
+void *g_ftl_write_buf;
+
+DEFINE_STUB(ftl_band_next_addr, ftl_addr, (struct ftl_band *band, ftl_addr addr, size_t offset),
+	    0);
+DEFINE_STUB(ftl_bitmap_find_first_clear, uint64_t, (struct ftl_bitmap *bitmap,
+		uint64_t start_bit, uint64_t end_bit), UINT64_MAX);
+DEFINE_STUB(ftl_bitmap_find_first_set, uint64_t, (struct ftl_bitmap *bitmap, uint64_t start_bit,
+		uint64_t end_bit), UINT64_MAX);
+DEFINE_STUB_V(ftl_bitmap_set, (struct ftl_bitmap *bitmap, uint64_t bit));
+DEFINE_STUB_V(ftl_io_complete, (struct ftl_io *io));
+DEFINE_STUB(ftl_io_get_lba, uint64_t, (const struct ftl_io *io, size_t offset), 0);
+DEFINE_STUB(ftl_io_iovec_addr, void *, (struct ftl_io *io), NULL);
+DEFINE_STUB_V(ftl_l2p_pin, (struct spdk_ftl_dev *dev, uint64_t lba, uint64_t count,
+			    ftl_l2p_pin_cb cb, void *cb_ctx, struct ftl_l2p_pin_ctx *pin_ctx));
+DEFINE_STUB_V(ftl_l2p_pin_skip, (struct spdk_ftl_dev *dev, ftl_l2p_pin_cb cb, void *cb_ctx,
+				 struct ftl_l2p_pin_ctx *pin_ctx));
+DEFINE_STUB_V(ftl_l2p_unpin, (struct spdk_ftl_dev *dev, uint64_t lba, uint64_t count));
+DEFINE_STUB_V(ftl_l2p_update_base, (struct spdk_ftl_dev *dev, uint64_t lba, ftl_addr new_addr,
+				    ftl_addr old_addr));
+DEFINE_STUB_V(ftl_l2p_update_cache, (struct spdk_ftl_dev *dev, uint64_t lba, ftl_addr new_addr,
+				     ftl_addr old_addr));
+DEFINE_STUB(ftl_md_get_buffer, void *, (struct ftl_md *md), NULL);
+DEFINE_STUB(ftl_md_get_buffer_size, uint64_t, (struct ftl_md *md), 0);
+DEFINE_STUB_V(ftl_md_persist_entry, (struct ftl_md *md, uint64_t start_entry, void *buffer,
+				     void *vss_buffer, ftl_md_io_entry_cb cb, void *cb_arg,
+				     struct ftl_md_io_entry_ctx *ctx));
+DEFINE_STUB_V(ftl_md_restore, (struct ftl_md *md));
+DEFINE_STUB(ftl_mempool_create, struct ftl_mempool *, (size_t count, size_t size,
+		size_t alignment, int socket_id), NULL);
+DEFINE_STUB_V(ftl_mempool_destroy, (struct ftl_mempool *mpool));
+DEFINE_STUB(ftl_mempool_get, void *, (struct ftl_mempool *mpool), NULL);
+DEFINE_STUB_V(ftl_mempool_put, (struct ftl_mempool *mpool, void *element));
+DEFINE_STUB(ftl_mngt_alloc_step_ctx, int, (struct ftl_mngt_process *mngt, size_t size), 0);
+DEFINE_STUB_V(ftl_mngt_continue_step, (struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_mngt_fail_step, (struct ftl_mngt_process *mngt));
+DEFINE_STUB(ftl_mngt_get_dev, struct spdk_ftl_dev *, (struct ftl_mngt_process *mngt), NULL);
+DEFINE_STUB(ftl_mngt_get_step_ctx, void *, (struct ftl_mngt_process *mngt), NULL);
+DEFINE_STUB_V(ftl_mngt_next_step, (struct ftl_mngt_process *mngt));
+DEFINE_STUB_V(ftl_rq_del, (struct ftl_rq *rq));
+DEFINE_STUB(ftl_rq_new, struct ftl_rq *, (struct spdk_ftl_dev *dev, uint32_t io_md_size), NULL);
+DEFINE_STUB_V(ftl_rq_unpin, (struct ftl_rq *rq));
+DEFINE_STUB_V(ftl_stats_bdev_io_completed, (struct spdk_ftl_dev *dev, enum ftl_stats_type type,
+		struct spdk_bdev_io *bdev_io));
+DEFINE_STUB_V(ftl_stats_stage_completed, (struct spdk_ftl_dev *dev, enum ftl_stats_stage stage,
+		uint64_t start_tsc, uint64_t num_blocks));
+DEFINE_STUB_V(ftl_trace_submission, (struct spdk_ftl_dev *dev, const struct ftl_io *io,
+				     ftl_addr addr, size_t addr_cnt));
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc), NULL);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_read_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, void *buf, void *md, uint64_t offset_blocks,
+		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_readv_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, struct iovec *iov, int iovcnt, void *md,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, void *buf, void *md, uint64_t offset_blocks,
+		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_writev_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, struct iovec *iov, int iovcnt, void *md,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+
+static struct spdk_ftl_dev g_dev;
+static ftl_addr g_l2p[TEST_NUM_LBAS];
+
+ftl_addr
+ftl_l2p_get(struct spdk_ftl_dev *dev, uint64_t lba)
+{
+	SPDK_CU_ASSERT_FATAL(lba < TEST_NUM_LBAS);
+	return g_l2p[lba];
+}
+
+static struct ftl_rq *
+test_alloc_rq(uint64_t num_blocks)
+{
+	struct ftl_rq *rq;
+	uint64_t i;
+
+	rq = calloc(1, sizeof(*rq) + num_blocks * sizeof(struct ftl_rq_entry));
+	SPDK_CU_ASSERT_FATAL(rq != NULL);
+	rq->io_vec = calloc(num_blocks, sizeof(*rq->io_vec));
+	rq->io_md = calloc(num_blocks, sizeof(union ftl_md_vss));
+	SPDK_CU_ASSERT_FATAL(rq->io_vec != NULL && rq->io_md != NULL);
+
+	rq->num_blocks = num_blocks;
+	rq->io_vec_size = num_blocks;
+	for (i = 0; i < num_blocks; i++) {
+		rq->io_vec[i].iov_base = (void *)(uintptr_t)(0x1000 * (i + 1));
+		rq->entries[i].io_payload = rq->io_vec[i].iov_base;
+		rq->entries[i].io_md = (union ftl_md_vss *)rq->io_md + i;
+	}
+
+	return rq;
+}
+
+static void
+test_free_rq(struct ftl_rq *rq)
+{
+	free(rq->io_vec);
+	free(rq->io_md);
+	free(rq);
+}
+
+static void
+test_compaction_stream_writer(void)
+{
+	g_dev.writer_user.limit = SPDK_FTL_LIMIT_HIGH;
+
+	g_dev.limit = SPDK_FTL_LIMIT_MAX;
+	CU_ASSERT_EQUAL(compaction_stream_writer(&g_dev, FTL_NV_CACHE_STREAM_HOT),
+			&g_dev.writer_user);
+	CU_ASSERT_EQUAL(compaction_stream_writer(&g_dev, FTL_NV_CACHE_STREAM_COLD),
+			&g_dev.writer_gc);
+
+	g_dev.limit = SPDK_FTL_LIMIT_HIGH;
+	CU_ASSERT_EQUAL(compaction_stream_writer(&g_dev, FTL_NV_CACHE_STREAM_COLD),
+			&g_dev.writer_gc);
+
+	/* User writes are stopped, keep the cold data off the bands reserved for GC */
+	g_dev.limit = SPDK_FTL_LIMIT_CRIT;
+	CU_ASSERT_EQUAL(compaction_stream_writer(&g_dev, FTL_NV_CACHE_STREAM_HOT),
+			&g_dev.writer_user);
+	CU_ASSERT_EQUAL(compaction_stream_writer(&g_dev, FTL_NV_CACHE_STREAM_COLD),
+			&g_dev.writer_user);
+}
+
+static void
+test_compaction_routing(void)
+{
+	struct ftl_nv_cache *nv_cache = &g_dev.nv_cache;
+	struct ftl_nv_cache_compactor compactor = {};
+	struct ftl_nv_cache_chunk_md chunk_md = {};
+	struct ftl_nv_cache_chunk chunk = {};
+	struct ftl_rq *rd, *hot, *cold;
+	union ftl_md_vss *md;
+	/* Hot LBAs are below 20, LBA 30 has been overwritten since it was cached */
+	const uint64_t lbas[] = { 10, 20, 11, 21, 30, 22, 12, 23, 24 };
+	const uint64_t num_lbas = SPDK_COUNTOF(lbas);
+	uint64_t i;
+
+	memset(g_l2p, 0xff, sizeof(g_l2p));
+	nv_cache->wr_freq = ftl_sketch_create(TEST_NUM_LBAS, UINT32_MAX);
+	SPDK_CU_ASSERT_FATAL(nv_cache->wr_freq != NULL);
+	TAILQ_INIT(&nv_cache->compactor_list);
+	TAILQ_INIT(&g_dev.writer_user.rq_queue);
+	TAILQ_INIT(&g_dev.writer_gc.rq_queue);
+	g_dev.writer_user.limit = SPDK_FTL_LIMIT_HIGH;
+	g_dev.limit = SPDK_FTL_LIMIT_MAX;
+
+	chunk_md.seq_id = TEST_CHUNK_SEQ_ID;
+	chunk_md.blocks_written = TEST_NUM_LBAS;
+	chunk.md = &chunk_md;
+	chunk.nv_cache = nv_cache;
+
+	rd = test_alloc_rq(num_lbas);
+	hot = test_alloc_rq(TEST_RQ_BLOCKS);
+	cold = test_alloc_rq(TEST_RQ_BLOCKS);
+	compactor.nv_cache = nv_cache;
+	compactor.rd = rd;
+	compactor.wr[FTL_NV_CACHE_STREAM_HOT] = hot;
+	compactor.wr[FTL_NV_CACHE_STREAM_COLD] = cold;
+
+	rd->io.addr = TEST_CACHE_ADDR;
+	rd->owner.priv = &chunk;
+	rd->iter.count = num_lbas;
+	for (i = 0; i < num_lbas; i++) {
+		md = rd->entries[i].io_md;
+		md->nv_cache.lba = lbas[i];
+		md->nv_cache.seq_id = TEST_CHUNK_SEQ_ID;
+		if (lbas[i] != 30) {
+			g_l2p[lbas[i]] = TEST_CACHE_ADDR + i;
+		}
+		if (lbas[i] < 20) {
+			ftl_sketch_add(nv_cache->wr_freq, lbas[i]);
+			ftl_sketch_add(nv_cache->wr_freq, lbas[i]);
+		} else {
+			ftl_sketch_add(nv_cache->wr_freq, lbas[i]);
+		}
+	}
+
+	/* The cold request fills up first and is queued to the GC writer */
+	compaction_process_finish_read(&compactor);
+	CU_ASSERT_EQUAL(rd->iter.idx, 8);
+	CU_ASSERT_EQUAL(cold->iter.idx, TEST_RQ_BLOCKS);
+	CU_ASSERT_EQUAL(TAILQ_FIRST(&g_dev.writer_gc.rq_queue), cold);
+	CU_ASSERT(TAILQ_EMPTY(&g_dev.writer_user.rq_queue));
+	for (i = 0; i < TEST_RQ_BLOCKS; i++) {
+		CU_ASSERT_EQUAL(cold->entries[i].lba, 20 + i);
+		CU_ASSERT_EQUAL(cold->entries[i].seq_id, TEST_CHUNK_SEQ_ID);
+		CU_ASSERT_EQUAL(cold->entries[i].owner.priv, &chunk);
+		CU_ASSERT_EQUAL(cold->entries[i].addr, g_l2p[20 + i]);
+	}
+	CU_ASSERT_EQUAL(hot->iter.idx, 3);
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT_EQUAL(hot->entries[i].lba, 10 + i);
+		CU_ASSERT_EQUAL(hot->entries[i].addr, g_l2p[10 + i]);
+	}
+	/* The payload of the overwritten block stays in the read request */
+	CU_ASSERT_EQUAL(rd->io_vec[4].iov_base, (void *)(uintptr_t)0x5000);
+	TAILQ_REMOVE(&g_dev.writer_gc.rq_queue, cold, qentry);
+	cold->iter.idx = 0;
+
+	/* The last hot block fills up the hot request, which goes to the user writer */
+	md = rd->entries[8].io_md;
+	md->nv_cache.lba = 13;
+	g_l2p[13] = TEST_CACHE_ADDR + 8;
+	ftl_sketch_add(nv_cache->wr_freq, 13);
+	ftl_sketch_add(nv_cache->wr_freq, 13);
+	compaction_process_finish_read(&compactor);
+	CU_ASSERT_EQUAL(rd->iter.idx, num_lbas);
+	CU_ASSERT_EQUAL(hot->iter.idx, TEST_RQ_BLOCKS);
+	CU_ASSERT_EQUAL(hot->entries[3].lba, 13);
+	CU_ASSERT_EQUAL(TAILQ_FIRST(&g_dev.writer_user.rq_queue), hot);
+	CU_ASSERT(TAILQ_EMPTY(&g_dev.writer_gc.rq_queue));
+	CU_ASSERT_EQUAL(cold->iter.idx, 0);
+
+	test_free_rq(rd);
+	test_free_rq(hot);
+	test_free_rq(cold);
+	ftl_sketch_destroy(nv_cache->wr_freq);
+	nv_cache->wr_freq = NULL;
+}
+
+static void
+test_get_ckpt_seq_id(void)
+{
+	struct ftl_nv_cache *nv_cache = &g_dev.nv_cache;
+	struct ftl_nv_cache_chunk_md chunk_md[4] = {};
+	struct ftl_nv_cache_chunk chunks[4] = {};
+	struct ftl_superblock sb = {};
+	uint64_t i;
+
+	g_dev.sb = &sb;
+	nv_cache->chunks = chunks;
+	nv_cache->chunk_count = SPDK_COUNTOF(chunks);
+	TAILQ_INIT(&nv_cache->chunk_open_list);
+	for (i = 0; i < SPDK_COUNTOF(chunks); i++) {
+		chunks[i].md = &chunk_md[i];
+		chunk_md[i].state = FTL_CHUNK_STATE_FREE;
+	}
+
+	/* Nothing open, everything up to now is in the L2P */
+	sb.seq_id = 20;
+	CU_ASSERT_EQUAL(ftl_nv_cache_get_ckpt_seq_id(nv_cache), 20);
+
+	/* Open chunks may still be written with their sequence ID */
+	chunk_md[1].state = FTL_CHUNK_STATE_OPEN;
+	chunk_md[1].seq_id = 15;
+	chunk_md[2].state = FTL_CHUNK_STATE_OPEN;
+	chunk_md[2].seq_id = 12;
+	chunk_md[3].state = FTL_CHUNK_STATE_CLOSED;
+	chunk_md[3].seq_id = 5;
+	CU_ASSERT_EQUAL(ftl_nv_cache_get_ckpt_seq_id(nv_cache), 12);
+
+	/* So may the chunks whose open state isn't persisted yet */
+	chunk_md[0].seq_id = 10;
+	TAILQ_INSERT_TAIL(&nv_cache->chunk_open_list, &chunks[0], entry);
+	CU_ASSERT_EQUAL(ftl_nv_cache_get_ckpt_seq_id(nv_cache), 10);
+
+	nv_cache->chunks = NULL;
+	nv_cache->chunk_count = 0;
+	TAILQ_INIT(&nv_cache->chunk_open_list);
+	g_dev.sb = NULL;
+}
+
+static void
+test_wr_cache(void)
+{
+	struct ftl_nv_cache *nv_cache = &g_dev.nv_cache;
+	const uint64_t num_blocks = 4;
+	char data[3 * FTL_BLOCK_SIZE], payload[4 * FTL_BLOCK_SIZE];
+	struct iovec iov[2];
+	struct ftl_io io = {};
+	uint64_t i;
+
+	memset(&g_dev.stats, 0, sizeof(g_dev.stats));
+	nv_cache->wr_cache.num_blocks = num_blocks;
+	nv_cache->wr_cache.buf = calloc(num_blocks, FTL_BLOCK_SIZE);
+	nv_cache->wr_cache.addr = calloc(num_blocks, sizeof(ftl_addr));
+	SPDK_CU_ASSERT_FATAL(nv_cache->wr_cache.buf != NULL && nv_cache->wr_cache.addr != NULL);
+	for (i = 0; i < num_blocks; i++) {
+		nv_cache->wr_cache.addr[i] = FTL_ADDR_INVALID;
+	}
+
+	for (i = 0; i < 3; i++) {
+		memset(data + i * FTL_BLOCK_SIZE, (int)i + 1, FTL_BLOCK_SIZE);
+	}
+
+	/* Copies are made block by block across the iovecs of the write */
+	iov[0].iov_base = data;
+	iov[0].iov_len = FTL_BLOCK_SIZE;
+	iov[1].iov_base = data + FTL_BLOCK_SIZE;
+	iov[1].iov_len = 2 * FTL_BLOCK_SIZE;
+	io.dev = &g_dev;
+	io.addr = TEST_CACHE_ADDR;
+	io.iov = iov;
+	io.iov_cnt = 2;
+	ftl_nv_cache_wr_cache_fill(&io);
+
+	MOCK_SET(ftl_io_iovec_addr, payload);
+
+	/* All blocks found */
+	memset(payload, 0, sizeof(payload));
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR, 3), 3);
+	CU_ASSERT_EQUAL(memcmp(payload, data, sizeof(data)), 0);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.hits, 3);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.misses, 0);
+
+	/* The slot holds a block of another address */
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR + num_blocks, 1), 0);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.hits, 3);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.misses, 1);
+
+	/* Only the leading blocks are copied, the rest is left to be read from the device */
+	memset(payload, 0, sizeof(payload));
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR + 1, 4), 2);
+	CU_ASSERT_EQUAL(memcmp(payload, data + FTL_BLOCK_SIZE, 2 * FTL_BLOCK_SIZE), 0);
+	CU_ASSERT_EQUAL(payload[2 * FTL_BLOCK_SIZE], 0);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.hits, 5);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.misses, 1);
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR + 3, 2), 0);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.misses, 3);
+
+	/* A newer write replaces the copy sharing its slot */
+	io.addr = TEST_CACHE_ADDR + num_blocks;
+	io.iov_cnt = 1;
+	ftl_nv_cache_wr_cache_fill(&io);
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR, 1), 0);
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR + num_blocks, 1), 1);
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR + 1, 1), 1);
+
+	free(nv_cache->wr_cache.buf);
+	free(nv_cache->wr_cache.addr);
+	memset(&nv_cache->wr_cache, 0, sizeof(nv_cache->wr_cache));
+	memset(&g_dev.stats, 0, sizeof(g_dev.stats));
+
+	/* Nothing is cached nor counted when the write cache is disabled */
+	io.addr = TEST_CACHE_ADDR;
+	ftl_nv_cache_wr_cache_fill(&io);
+	CU_ASSERT_EQUAL(ftl_nv_cache_read_wr_cache(&io, TEST_CACHE_ADDR, 1), 0);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.hits, 0);
+	CU_ASSERT_EQUAL(g_dev.stats.wr_cache.misses, 0);
+
+	MOCK_CLEAR(ftl_io_iovec_addr);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ftl_nv_cache", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_compaction_stream_writer);
+	CU_ADD_TEST(suite, test_compaction_routing);
+	CU_ADD_TEST(suite, test_get_ckpt_seq_id);
+	CU_ADD_TEST(suite, test_wr_cache);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
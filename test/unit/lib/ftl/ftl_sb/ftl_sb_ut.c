@@ -6,6 +6,7 @@
 #include <sys/queue.h>
 
 #include "spdk/stdinc.h"
+#include "spdk/string.h"
 
 #include "spdk_cunit.h"
 #include "common/lib/test_env.c"
@@ -15,8 +16,6 @@
 #include "ftl/upgrade/ftl_layout_upgrade.c"
 #include "ftl/mngt/ftl_mngt_md.c"
 
-DEFINE_STUB_V(ftl_mngt_fail_step, (struct ftl_mngt_process *mngt));
-DEFINE_STUB_V(ftl_mngt_next_step, (struct ftl_mngt_process *mngt));
 DEFINE_STUB_V(ftl_md_persist, (struct ftl_md *md));
 DEFINE_STUB(ftl_nv_cache_load_state, int, (struct ftl_nv_cache *nv_cache), 0);
 DEFINE_STUB_V(ftl_valid_map_load_state, (struct spdk_ftl_dev *dev));
@@ -40,6 +39,7 @@ DEFINE_STUB_V(ftl_mngt_call_process, (struct ftl_mngt_process *mngt,
 				      const struct ftl_mngt_process_desc *process));
 DEFINE_STUB(ftl_md_get_buffer, void *, (struct ftl_md *md), NULL);
 DEFINE_STUB(ftl_layout_setup_superblock, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB(ftl_nv_cache_get_ckpt_seq_id, uint64_t, (struct ftl_nv_cache *nv_cache), 0);
 
 struct spdk_ftl_dev g_dev;
 struct ftl_superblock_shm g_sb_shm = {0};
@@ -49,6 +49,20 @@ struct ftl_region_upgrade_desc p2l_upgrade_desc[0];
 struct ftl_region_upgrade_desc nvc_upgrade_desc[0];
 struct ftl_region_upgrade_desc band_upgrade_desc[0];
 
+static int g_mngt_status;
+
+void
+ftl_mngt_fail_step(struct ftl_mngt_process *mngt)
+{
+	g_mngt_status = -1;
+}
+
+void
+ftl_mngt_next_step(struct ftl_mngt_process *mngt)
+{
+	g_mngt_status = 0;
+}
+
 #define TEST_OP 0x1984
 #define TEST_REG_BLKS 0x10000
 #define TEST_NVC_BLKS 0x1000000;
@@ -298,6 +312,97 @@ test_sb_v3_md_layout(void)
 	sb->v3.md_layout_head.df_next = df_next;
 }
 
+/* Sets the fields checked on load which the default superblock leaves out */
+static void
+test_setup_sb_loadable(void)
+{
+	struct ftl_superblock *sb = (void *)g_sb_buf;
+
+	sb->lba_cnt = 1;
+	sb->overprovisioning = 20;
+	sb->header.crc = get_sb_crc(sb);
+}
+
+static int
+test_validate_sb(void)
+{
+	g_mngt_status = 1;
+	ftl_mngt_validate_sb(&g_dev, NULL);
+	CU_ASSERT(g_mngt_status != 1);
+
+	return g_mngt_status;
+}
+
+static void
+test_sb_shard(void)
+{
+	struct ftl_superblock *sb = (void *)g_sb_buf;
+	struct spdk_ftl_conf conf = g_dev.conf;
+	struct spdk_uuid set_uuid;
+
+	for (uint64_t n = 0; n < sizeof(set_uuid); n++) {
+		set_uuid.u.raw[n] = 0xa0 + n;
+	}
+
+	/* Devices which aren't part of a set have no shard recorded */
+	test_setup_sb_v3(false);
+	CU_ASSERT(spdk_mem_all_zero(&sb->shard, sizeof(sb->shard)));
+	test_setup_sb_loadable();
+	CU_ASSERT_EQUAL(test_validate_sb(), 0);
+
+	/* ...and can't be loaded as one */
+	g_dev.conf.shard.set_uuid = set_uuid;
+	g_dev.conf.shard.idx = 1;
+	g_dev.conf.shard.count = 3;
+	g_dev.conf.shard.stripe_mib = 4;
+	CU_ASSERT_NOT_EQUAL(test_validate_sb(), 0);
+
+	/* Shard of a set is only loaded in the same place of that set */
+	test_setup_sb_v3(false);
+	CU_ASSERT_EQUAL(sb->shard.idx, 1);
+	CU_ASSERT_EQUAL(sb->shard.count, 3);
+	CU_ASSERT_EQUAL(sb->shard.stripe_mib, 4);
+	CU_ASSERT_NOT_EQUAL(sb->shard.set_id, 0);
+	test_setup_sb_loadable();
+	CU_ASSERT_EQUAL(test_validate_sb(), 0);
+
+	g_dev.conf.shard.idx = 2;
+	CU_ASSERT_NOT_EQUAL(test_validate_sb(), 0);
+	g_dev.conf.shard.idx = 1;
+
+	g_dev.conf.shard.count = 4;
+	CU_ASSERT_NOT_EQUAL(test_validate_sb(), 0);
+	g_dev.conf.shard.count = 3;
+
+	g_dev.conf.shard.stripe_mib = 8;
+	CU_ASSERT_NOT_EQUAL(test_validate_sb(), 0);
+	g_dev.conf.shard.stripe_mib = 4;
+
+	g_dev.conf.shard.set_uuid.u.raw[5]++;
+	CU_ASSERT_NOT_EQUAL(test_validate_sb(), 0);
+	g_dev.conf.shard.set_uuid = set_uuid;
+
+	g_dev.conf.shard.count = 0;
+	CU_ASSERT_NOT_EQUAL(test_validate_sb(), 0);
+	g_dev.conf.shard.count = 3;
+
+	CU_ASSERT_EQUAL(test_validate_sb(), 0);
+
+	/* The first shard identifies the set with its own UUID */
+	g_dev.conf.shard.idx = 0;
+	g_dev.conf.shard.set_uuid = (struct spdk_uuid) {};
+	test_setup_sb_v3(false);
+	test_setup_sb_loadable();
+	CU_ASSERT_EQUAL(test_validate_sb(), 0);
+
+	g_dev.conf.uuid.u.raw[0]++;
+	sb->uuid = g_dev.conf.uuid;
+	sb->header.crc = get_sb_crc(sb);
+	CU_ASSERT_NOT_EQUAL(test_validate_sb(), 0);
+
+	g_dev.conf = conf;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -312,6 +417,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_sb_crc_v2);
 	CU_ADD_TEST(suite, test_sb_crc_v3);
 	CU_ADD_TEST(suite, test_sb_v3_md_layout);
+	CU_ADD_TEST(suite, test_sb_shard);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
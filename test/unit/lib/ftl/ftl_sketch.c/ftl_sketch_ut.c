@@ -0,0 +1,147 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+
+#include "ftl/utils/ftl_sketch.c"
+
+#define SKETCH_WIDTH	1024
+/* Long enough for no counter to be halved by the keys added in a test */
+#define SKETCH_WINDOW	UINT32_MAX
+
+static void
+test_ftl_sketch_create(void)
+{
+	struct ftl_sketch *sketch;
+
+	sketch = ftl_sketch_create(1000, SKETCH_WINDOW);
+	SPDK_CU_ASSERT_FATAL(sketch != NULL);
+	/* Width is rounded up to a power of two */
+	CU_ASSERT_EQUAL(sketch->width, 1024);
+	CU_ASSERT_EQUAL(sketch->width_shift, 10);
+	ftl_sketch_destroy(sketch);
+
+	sketch = ftl_sketch_create(0, 0);
+	SPDK_CU_ASSERT_FATAL(sketch != NULL);
+	CU_ASSERT_EQUAL(sketch->width, 2);
+	CU_ASSERT_EQUAL(sketch->window, 1);
+	ftl_sketch_destroy(sketch);
+}
+
+static void
+test_ftl_sketch_estimate(void)
+{
+	struct ftl_sketch *sketch;
+	uint64_t key, i;
+
+	sketch = ftl_sketch_create(SKETCH_WIDTH, SKETCH_WINDOW);
+	SPDK_CU_ASSERT_FATAL(sketch != NULL);
+
+	CU_ASSERT_EQUAL(ftl_sketch_estimate(sketch, 42), 0);
+
+	/* A hot key added many times among a set of keys written once */
+	for (key = 0; key < SKETCH_WIDTH / 2; key++) {
+		ftl_sketch_add(sketch, key * 7919);
+		if (key % 32 == 0) {
+			ftl_sketch_add(sketch, 42);
+		}
+	}
+
+	CU_ASSERT(ftl_sketch_estimate(sketch, 42) >= SKETCH_WIDTH / 2 / 32);
+
+	/* The estimate never goes below the real count */
+	for (key = 1; key < SKETCH_WIDTH / 2; key++) {
+		CU_ASSERT(ftl_sketch_estimate(sketch, key * 7919) >= 1);
+	}
+
+	/* Counters saturate instead of wrapping around */
+	for (i = 0; i < 2 * UINT8_MAX; i++) {
+		ftl_sketch_add(sketch, 1);
+	}
+	CU_ASSERT_EQUAL(ftl_sketch_estimate(sketch, 1), UINT8_MAX);
+
+	ftl_sketch_reset(sketch);
+	CU_ASSERT_EQUAL(ftl_sketch_estimate(sketch, 1), 0);
+	CU_ASSERT_EQUAL(ftl_sketch_estimate(sketch, 42), 0);
+
+	ftl_sketch_destroy(sketch);
+}
+
+static void
+test_ftl_sketch_age(void)
+{
+	struct ftl_sketch *sketch;
+	uint64_t num_counters = FTL_SKETCH_DEPTH * SKETCH_WIDTH;
+	uint64_t i, halved;
+
+	sketch = ftl_sketch_create(SKETCH_WIDTH, 16);
+	SPDK_CU_ASSERT_FATAL(sketch != NULL);
+
+	/* Each add halves the next slice of counters */
+	memset(sketch->counters, 128, num_counters);
+	ftl_sketch_add(sketch, 5);
+	CU_ASSERT_EQUAL(sketch->age_pos, num_counters / 16);
+
+	halved = 0;
+	for (i = 0; i < num_counters; i++) {
+		halved += sketch->counters[i] < 128;
+	}
+	CU_ASSERT_EQUAL(halved, num_counters / 16);
+
+	/* All counters are halved exactly once per window */
+	for (i = 1; i < 16; i++) {
+		ftl_sketch_add(sketch, 5 + i);
+	}
+	CU_ASSERT_EQUAL(sketch->age_pos, 0);
+	CU_ASSERT_EQUAL(sketch->age_credit, 0);
+	for (i = 0; i < num_counters; i++) {
+		CU_ASSERT(sketch->counters[i] >= 64 && sketch->counters[i] < 128);
+	}
+
+	/* Key no longer added eventually decays to zero */
+	for (i = 0; i < 16 * 8; i++) {
+		ftl_sketch_add(sketch, 1000 + i);
+	}
+	CU_ASSERT_EQUAL(ftl_sketch_estimate(sketch, 5), 0);
+
+	ftl_sketch_destroy(sketch);
+
+	/* Windows longer than the number of counters halve one counter every few adds */
+	sketch = ftl_sketch_create(2, 20);
+	SPDK_CU_ASSERT_FATAL(sketch != NULL);
+
+	memset(sketch->counters, 2, FTL_SKETCH_DEPTH * 2);
+	for (i = 0; i < 20; i++) {
+		ftl_sketch_add(sketch, 0);
+		CU_ASSERT_EQUAL(sketch->age_pos, (i + 1) * FTL_SKETCH_DEPTH * 2 / 20 %
+				(FTL_SKETCH_DEPTH * 2));
+	}
+
+	ftl_sketch_destroy(sketch);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ftl_sketch", NULL, NULL);
+	CU_ADD_TEST(suite, test_ftl_sketch_create);
+	CU_ADD_TEST(suite, test_ftl_sketch_estimate);
+	CU_ADD_TEST(suite, test_ftl_sketch_age);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -1198,6 +1198,494 @@ overlapped(void)
 	backing_dev_destroy(&backing_dev);
 }
 
+static void
+compact_cb(void *arg, int reduce_errno)
+{
+	g_reduce_errno = reduce_errno;
+}
+
+/* Write a chunk whose first 5000 bytes do not compress at all with the RLE used by
+ *  these tests.  It compresses to 2 whole 4KiB io units plus a fragment of 1898 bytes.
+ */
+static void
+packed_write_chunk(uint64_t chunk, uint8_t init_val, uint8_t *buf, uint32_t chunk_size)
+{
+	struct iovec iov;
+
+	memset(buf, 0, chunk_size);
+	ut_build_data_buffer(buf, 5000, init_val, 1);
+	iov.iov_base = buf;
+	iov.iov_len = chunk_size;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_writev(g_vol, &iov, 1, chunk * 32, 32, write_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+}
+
+static void
+packed_check_chunk(uint64_t chunk, uint8_t *compare_buf, uint32_t chunk_size)
+{
+	uint8_t buf[16 * 1024];
+	struct iovec iov;
+
+	memset(buf, 0xFF, sizeof(buf));
+	iov.iov_base = buf;
+	iov.iov_len = chunk_size;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_readv(g_vol, &iov, 1, chunk * 32, 32, read_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(memcmp(buf, compare_buf, chunk_size) == 0);
+}
+
+static struct spdk_reduce_chunk_map *
+packed_get_chunk_map(uint64_t chunk)
+{
+	return _reduce_vol_get_chunk_map(g_vol, g_vol->pm_logical_map[chunk]);
+}
+
+static void
+_packed(uint32_t backing_blocklen)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t chunk0[16 * 1024], chunk1[16 * 1024], chunk2[16 * 1024];
+	struct iovec iov;
+	uint64_t unit0, unit2;
+	uint32_t reserved;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	params.flags = SPDK_REDUCE_VOL_FLAG_PACKED;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, backing_blocklen);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	reserved = spdk_bit_array_count_set(g_vol->allocated_backing_io_units);
+
+	/* The fragments of the first two chunks share an io unit.  The third one does
+	 *  not fit and opens a new pack unit.
+	 */
+	packed_write_chunk(0, 1, chunk0, params.chunk_size);
+	packed_write_chunk(1, 2, chunk1, params.chunk_size);
+	packed_write_chunk(2, 3, chunk2, params.chunk_size);
+	unit0 = packed_get_chunk_map(0)->io_unit_index[2];
+	unit2 = packed_get_chunk_map(2)->io_unit_index[2];
+	CU_ASSERT(packed_get_chunk_map(0)->compressed_size == 10090);
+	CU_ASSERT(packed_get_chunk_map(0)->fragment_offset == 0);
+	CU_ASSERT(packed_get_chunk_map(1)->io_unit_index[2] == unit0);
+	CU_ASSERT(packed_get_chunk_map(1)->fragment_offset == 1898);
+	CU_ASSERT(unit2 != unit0);
+	CU_ASSERT(packed_get_chunk_map(2)->fragment_offset == 0);
+	CU_ASSERT(g_vol->io_unit_refs[unit0] == 2);
+	/* Referenced by chunk 2 and held as the open pack unit. */
+	CU_ASSERT(g_vol->io_unit_refs[unit2] == 2);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == reserved + 8);
+
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, chunk1, params.chunk_size);
+	packed_check_chunk(2, chunk2, params.chunk_size);
+
+	/* Overwrite chunk 1 with data that compresses to a fragment only.  This leaves the
+	 *  fragment of chunk 0 alone in its io unit.
+	 */
+	memset(chunk1, 0, sizeof(chunk1));
+	memset(chunk1, 0xBB, params.logical_block_size);
+	iov.iov_base = chunk1;
+	iov.iov_len = params.chunk_size;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_writev(g_vol, &iov, 1, 32, 32, write_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(packed_get_chunk_map(1)->compressed_size == 132);
+	CU_ASSERT(packed_get_chunk_map(1)->io_unit_index[0] == unit2);
+	CU_ASSERT(packed_get_chunk_map(1)->fragment_offset == 1898);
+	CU_ASSERT(g_vol->io_unit_refs[unit0] == 1);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == reserved + 6);
+
+	/* Compaction moves the fragment of chunk 0 to the open pack unit and frees its io unit. */
+	g_reduce_errno = -1;
+	spdk_reduce_vol_compact(g_vol, UINT64_MAX, compact_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(packed_get_chunk_map(0)->io_unit_index[2] == unit2);
+	CU_ASSERT(packed_get_chunk_map(0)->fragment_offset == 1898 + 132);
+	CU_ASSERT(spdk_bit_array_get(g_vol->allocated_backing_io_units, unit0) == false);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == reserved + 5);
+	CU_ASSERT(g_vol->io_unit_refs[unit2] == 4);
+
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, chunk1, params.chunk_size);
+	packed_check_chunk(2, chunk2, params.chunk_size);
+
+	/* Nothing is left to compact. */
+	g_reduce_errno = -1;
+	spdk_reduce_vol_compact(g_vol, UINT64_MAX, compact_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == reserved + 5);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	/* The references of the shared io unit are rebuilt from the chunk maps on load. */
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_load(&backing_dev, load_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	CU_ASSERT(g_vol->params.flags == SPDK_REDUCE_VOL_FLAG_PACKED);
+	CU_ASSERT(g_vol->io_unit_refs[unit2] == 3);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == reserved + 5);
+
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, chunk1, params.chunk_size);
+	packed_check_chunk(2, chunk2, params.chunk_size);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+
+	/* Volumes without the packed layout cannot be compacted. */
+	params.vol_size = 0;
+	params.flags = 0;
+	backing_dev_init(&backing_dev, &params, backing_blocklen);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_compact(g_vol, UINT64_MAX, compact_cb, NULL);
+	CU_ASSERT(g_reduce_errno == -ENOTSUP);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+}
+
+static void
+packed(void)
+{
+	_packed(512);
+	_packed(4096);
+}
+
+/* Drops the volume as a crash would, without writing anything to the backing device. */
+static void
+backing_dev_md_crash(void)
+{
+	_init_load_cleanup(g_vol, NULL);
+	if (--g_vol_count == 0) {
+		spdk_free(g_zero_buf);
+	}
+	g_vol = NULL;
+}
+
+static void
+backing_dev_md_load(struct spdk_reduce_backing_dev *backing_dev)
+{
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_load(backing_dev, load_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	SPDK_CU_ASSERT_FATAL(g_vol->md != NULL);
+	/* Loading ends with a checkpoint, there is nothing left to replay. */
+	CU_ASSERT(g_vol->md->tail_seq == g_vol->md->head_seq);
+}
+
+static void
+_backing_dev_md(uint32_t backing_blocklen)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t chunk0[16 * 1024], chunk1[16 * 1024], old_chunk1[16 * 1024];
+	struct reduce_md_log_page *page;
+	uint64_t head_seq, allocated;
+	uint32_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, backing_blocklen);
+
+	/* A pm file directory is required without the flag. */
+	g_vol = NULL;
+	g_reduce_errno = 0;
+	spdk_reduce_vol_init(&params, &backing_dev, NULL, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == -EINVAL);
+	CU_ASSERT(g_vol == NULL);
+
+	params.flags = SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, NULL, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	SPDK_CU_ASSERT_FATAL(g_vol->md != NULL);
+	CU_ASSERT(g_persistent_pm_buf == NULL);
+	CU_ASSERT(params.vol_size < _get_vol_size(params.chunk_size, 4 * 1024 * 1024));
+	CU_ASSERT(_get_backing_dev_md_offset(&params) + _get_backing_dev_md_size(&params) <=
+		  backing_dev.blockcnt * backing_dev.blocklen);
+
+	/* Each write is committed by a log page of its own, the backing device being synchronous. */
+	head_seq = g_vol->md->head_seq;
+	packed_write_chunk(0, 1, chunk0, params.chunk_size);
+	packed_write_chunk(1, 2, chunk1, params.chunk_size);
+	CU_ASSERT(g_vol->md->head_seq == head_seq + 2);
+	allocated = spdk_bit_array_count_set(g_vol->allocated_backing_io_units);
+
+	/* The maps are rebuilt from the checkpoint written at init and the log. */
+	backing_dev_md_crash();
+	backing_dev_md_load(&backing_dev);
+	CU_ASSERT(g_vol->params.flags == SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == allocated);
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, chunk1, params.chunk_size);
+
+	/* Filling half of the log starts a checkpoint.  The io units of the chunks overwritten
+	 *  are all released.
+	 */
+	head_seq = g_vol->md->head_seq;
+	for (i = 0; i < g_vol->md->log_pages; i++) {
+		packed_write_chunk(0, i, chunk0, params.chunk_size);
+	}
+	CU_ASSERT(g_vol->md->tail_seq > head_seq);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == allocated);
+
+	backing_dev_md_crash();
+	backing_dev_md_load(&backing_dev);
+	CU_ASSERT(spdk_bit_array_count_set(g_vol->allocated_backing_io_units) == allocated);
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, chunk1, params.chunk_size);
+
+	/* A torn log page ends the replay, the write it holds is lost. */
+	memcpy(old_chunk1, chunk1, sizeof(chunk1));
+	packed_write_chunk(1, 3, chunk1, params.chunk_size);
+	page = (struct reduce_md_log_page *)(g_backing_dev_buf + g_vol->md->offset +
+					     REDUCE_MD_LOG_OFFSET +
+					     ((g_vol->md->head_seq - 1) % g_vol->md->log_pages) *
+					     REDUCE_MD_PAGE_SIZE);
+	page->records[0] ^= 0xFF;
+	backing_dev_md_crash();
+	backing_dev_md_load(&backing_dev);
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, old_chunk1, params.chunk_size);
+
+	/* Unloading writes a last checkpoint. */
+	packed_write_chunk(1, 4, chunk1, params.chunk_size);
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	backing_dev_md_load(&backing_dev);
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, chunk1, params.chunk_size);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	backing_dev_destroy(&backing_dev);
+}
+
+static void
+backing_dev_md(void)
+{
+	_backing_dev_md(512);
+	_backing_dev_md(4096);
+}
+
+static void
+backing_dev_md_checkpoint_cb(void *cb_arg, int reduce_errno)
+{
+	g_reduce_errno = reduce_errno;
+}
+
+static void
+backing_dev_md_log_error(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t chunk0[16 * 1024], chunk1[16 * 1024];
+	uint64_t empty = REDUCE_EMPTY_MAP_ENTRY, failed_seq;
+	struct ut_reduce_bdev_io *ut_bdev_io;
+	struct reduce_md *md;
+	struct iovec iov;
+	uint32_t data_ios;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	params.flags = SPDK_REDUCE_VOL_FLAG_BACKING_DEV_MD;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, NULL, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+	SPDK_CU_ASSERT_FATAL(g_vol->md != NULL);
+	md = g_vol->md;
+
+	packed_write_chunk(0, 1, chunk0, params.chunk_size);
+
+	/* Checkpoint with the log at its last page, so that the next write wraps around. */
+	md->head_seq += md->log_pages - 1 - md->head_seq % md->log_pages;
+	g_reduce_errno = -1;
+	_reduce_md_checkpoint(g_vol, backing_dev_md_checkpoint_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(md->tail_seq == md->head_seq);
+
+	/* Two pages of updates unmapping chunk 0, written by one IO at each end of the log. */
+	while (md->open_buf->num_pages < 2) {
+		_reduce_md_log_append(g_vol, REDUCE_MD_LOG_LOGICAL_MAP, 0, &empty, sizeof(empty));
+	}
+	g_defer_bdev_io = true;
+	failed_seq = md->head_seq;
+	_reduce_md_log_flush(g_vol);
+	CU_ASSERT(g_pending_bdev_io_count == 2);
+
+	/* A write of chunk 1 comes in meanwhile. */
+	memset(chunk1, 0, sizeof(chunk1));
+	ut_build_data_buffer(chunk1, 5000, 2, 1);
+	iov.iov_base = chunk1;
+	iov.iov_len = params.chunk_size;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_writev(g_vol, &iov, 1, 32, 32, write_cb, NULL);
+	SPDK_CU_ASSERT_FATAL(g_pending_bdev_io_count > 2);
+	data_ios = g_pending_bdev_io_count - 2;
+
+	/* The first log IO fails, the page at the start of the log is written.  A checkpoint
+	 *  is started to get past the pages of the failed write.
+	 */
+	ut_bdev_io = TAILQ_FIRST(&g_pending_bdev_io);
+	TAILQ_REMOVE(&g_pending_bdev_io, ut_bdev_io, link);
+	g_pending_bdev_io_count--;
+	ut_bdev_io->args->cb_fn(ut_bdev_io->args->cb_arg, -EIO);
+	free(ut_bdev_io);
+	backing_dev_io_execute(1);
+	CU_ASSERT(md->log_failed == true);
+	CU_ASSERT(md->cp_running == true);
+	CU_ASSERT(md->head_seq == failed_seq + 2);
+
+	/* The update of the write is held until the checkpoint is done. */
+	backing_dev_io_execute(data_ios);
+	CU_ASSERT(md->log_full == true);
+	CU_ASSERT(md->head_seq == failed_seq + 2);
+	CU_ASSERT(g_reduce_errno == -1);
+
+	backing_dev_io_execute(0);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(md->log_failed == false);
+	CU_ASSERT(md->tail_seq == failed_seq + 2);
+	CU_ASSERT(md->head_seq == failed_seq + 3);
+	g_defer_bdev_io = false;
+
+	/* The page of the failed write left at the start of the log is not replayed. */
+	backing_dev_md_crash();
+	backing_dev_md_load(&backing_dev);
+	packed_check_chunk(0, chunk0, params.chunk_size);
+	packed_check_chunk(1, chunk1, params.chunk_size);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	backing_dev_destroy(&backing_dev);
+}
+
+static void
+read_cache_read_block(uint64_t offset, uint8_t *compare_buf)
+{
+	uint8_t buf[512];
+	struct iovec iov;
+
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf);
+	g_reduce_errno = -1;
+	spdk_reduce_vol_readv(g_vol, &iov, 1, offset, 1, read_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	CU_ASSERT(memcmp(buf, compare_buf + (offset % 32) * sizeof(buf), sizeof(buf)) == 0);
+}
+
+static void
+read_cache(void)
+{
+	struct spdk_reduce_vol_params params = {};
+	struct spdk_reduce_backing_dev backing_dev = {};
+	uint8_t chunks[10][16 * 1024];
+	uint64_t i;
+
+	params.chunk_size = 16 * 1024;
+	params.backing_io_unit_size = 4096;
+	params.logical_block_size = 512;
+	spdk_uuid_generate(&params.uuid);
+
+	backing_dev_init(&backing_dev, &params, 512);
+
+	g_vol = NULL;
+	g_reduce_errno = -1;
+	spdk_reduce_vol_init(&params, &backing_dev, TEST_MD_PATH, init_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+	SPDK_CU_ASSERT_FATAL(g_vol != NULL);
+
+	packed_write_chunk(0, 1, chunks[0], params.chunk_size);
+	CU_ASSERT(_reduce_vol_cache_lookup(g_vol, 0) == NULL);
+
+	/* The first read decompresses the chunk, the next ones in the same chunk are served
+	 *  from the cache without any backing I/O.
+	 */
+	read_cache_read_block(0, chunks[0]);
+	CU_ASSERT(_reduce_vol_cache_lookup(g_vol, 0) != NULL);
+	g_defer_bdev_io = true;
+	for (i = 1; i < 32; i++) {
+		read_cache_read_block(i, chunks[0]);
+	}
+	CU_ASSERT(g_pending_bdev_io_count == 0);
+	g_defer_bdev_io = false;
+
+	/* A write drops the cached chunk. */
+	packed_write_chunk(0, 2, chunks[0], params.chunk_size);
+	CU_ASSERT(_reduce_vol_cache_lookup(g_vol, 0) == NULL);
+	read_cache_read_block(5, chunks[0]);
+	CU_ASSERT(_reduce_vol_cache_lookup(g_vol, 0) != NULL);
+
+	/* Reading more chunks than fit evicts the least recently used one. */
+	for (i = 1; i < 10; i++) {
+		packed_write_chunk(i, i + 2, chunks[i], params.chunk_size);
+	}
+	for (i = 1; i < REDUCE_NUM_CACHE_CHUNKS; i++) {
+		read_cache_read_block(i * 32, chunks[i]);
+	}
+	read_cache_read_block(0, chunks[0]);
+	read_cache_read_block(REDUCE_NUM_CACHE_CHUNKS * 32, chunks[REDUCE_NUM_CACHE_CHUNKS]);
+	CU_ASSERT(_reduce_vol_cache_lookup(g_vol, 0) != NULL);
+	CU_ASSERT(_reduce_vol_cache_lookup(g_vol, 1) == NULL);
+	CU_ASSERT(_reduce_vol_cache_lookup(g_vol, 2) != NULL);
+
+	g_reduce_errno = -1;
+	spdk_reduce_vol_unload(g_vol, unload_cb, NULL);
+	CU_ASSERT(g_reduce_errno == 0);
+
+	persistent_pm_buf_destroy();
+	backing_dev_destroy(&backing_dev);
+}
+
 #define BUFSIZE 4096
 
 static void
@@ -1577,6 +2065,7 @@ test_reduce_decompress_chunk(void)
 	TAILQ_INIT(&vol.executing_requests);
 	TAILQ_INIT(&vol.queued_requests);
 	TAILQ_INIT(&vol.free_requests);
+	TAILQ_INIT(&vol.cache_lru);
 
 	/* Allocate 1 extra byte to test a case when buffer crosses huge page boundary */
 	SPDK_CU_ASSERT_FATAL(posix_memalign(&buf, VALUE_2MB, VALUE_2MB + 1) == 0);
@@ -1836,6 +2325,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, destroy);
 	CU_ADD_TEST(suite, defer_bdev_io);
 	CU_ADD_TEST(suite, overlapped);
+	CU_ADD_TEST(suite, packed);
+	CU_ADD_TEST(suite, backing_dev_md);
+	CU_ADD_TEST(suite, backing_dev_md_log_error);
+	CU_ADD_TEST(suite, read_cache);
 	CU_ADD_TEST(suite, compress_algorithm);
 	CU_ADD_TEST(suite, test_prepare_compress_chunk);
 	CU_ADD_TEST(suite, test_reduce_decompress_chunk);
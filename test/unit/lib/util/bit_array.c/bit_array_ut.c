@@ -317,6 +317,34 @@ test_mask_clear(void)
 	spdk_bit_array_free(&ba);
 }
 
+static void
+test_pool_allocate_bit_at(void)
+{
+	struct spdk_bit_pool *pool;
+
+	pool = spdk_bit_pool_create(64);
+	SPDK_CU_ASSERT_FATAL(pool != NULL);
+
+	/* Allocating a specific bit must not disturb the lowest free bit search */
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 10) == 0);
+	CU_ASSERT(spdk_bit_pool_is_allocated(pool, 10));
+	CU_ASSERT(spdk_bit_pool_count_free(pool) == 63);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 10) == -EEXIST);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 64) == -EINVAL);
+	CU_ASSERT(spdk_bit_pool_allocate_bit(pool) == 0);
+
+	/* Allocating the lowest free bit moves the search forward */
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 1) == 0);
+	CU_ASSERT(spdk_bit_pool_allocate_bit(pool) == 2);
+	CU_ASSERT(spdk_bit_pool_count_allocated(pool) == 4);
+
+	spdk_bit_pool_free_bit(pool, 10);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 10) == 0);
+	CU_ASSERT(spdk_bit_pool_count_free(pool) == 60);
+
+	spdk_bit_pool_free(&pool);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -336,6 +364,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_count);
 	CU_ADD_TEST(suite, test_mask_store_load);
 	CU_ADD_TEST(suite, test_mask_clear);
+	CU_ADD_TEST(suite, test_pool_allocate_bit_at);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
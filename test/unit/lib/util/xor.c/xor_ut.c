@@ -0,0 +1,117 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+
+#include "util/xor.c"
+
+#define BUF_COUNT 8
+#define SRC_BUF_COUNT (BUF_COUNT - 1)
+#define BUF_SIZE 4096
+
+static void
+ut_xor_ref(uint8_t *dest, uint8_t **sources, uint32_t n, size_t len, size_t offset)
+{
+	size_t i;
+	uint32_t j;
+
+	for (i = 0; i < len; i++) {
+		dest[i] = sources[0][offset + i];
+		for (j = 1; j < n; j++) {
+			dest[i] ^= sources[j][offset + i];
+		}
+	}
+}
+
+static void
+test_xor_gen(void)
+{
+	void *bufs[BUF_COUNT];
+	void *bufs2[SRC_BUF_COUNT];
+	uint8_t *ref, *dest;
+	uint32_t i, n;
+	size_t offset, len;
+	size_t offsets[] = { 0, 1, 8, 32 };
+	size_t lens[] = { BUF_SIZE, BUF_SIZE - 128, BUF_SIZE - 64, 100, 3 };
+	int ret;
+
+	/* alloc and fill the buffers with a pattern */
+	for (i = 0; i < BUF_COUNT; i++) {
+		ret = posix_memalign(&bufs[i], spdk_xor_get_optimal_alignment(), BUF_SIZE);
+		SPDK_CU_ASSERT_FATAL(ret == 0);
+		memset(bufs[i], i * 0x11 + 3, BUF_SIZE);
+		((uint8_t *)bufs[i])[i * 13] = 0xff - i;
+	}
+	ref = calloc(1, BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref != NULL);
+	dest = bufs[SRC_BUF_COUNT];
+
+	/* Both aligned and unaligned buffers and lengths, all take the same result */
+	for (n = 2; n <= SRC_BUF_COUNT; n++) {
+		for (offset = 0; offset < SPDK_COUNTOF(offsets); offset++) {
+			for (len = 0; len < SPDK_COUNTOF(lens); len++) {
+				if (offsets[offset] + lens[len] > BUF_SIZE) {
+					continue;
+				}
+				for (i = 0; i < n; i++) {
+					bufs2[i] = (uint8_t *)bufs[i] + offsets[offset];
+				}
+
+				ut_xor_ref(ref, (uint8_t **)bufs, n, lens[len], offsets[offset]);
+				memset(dest, 0, BUF_SIZE);
+				ret = spdk_xor_gen(dest + offsets[offset], bufs2, n, lens[len]);
+				CU_ASSERT(ret == 0);
+				CU_ASSERT(memcmp(ref, dest + offsets[offset], lens[len]) == 0);
+			}
+		}
+	}
+
+	/* The destination may be one of the sources */
+	ut_xor_ref(ref, (uint8_t **)bufs, SRC_BUF_COUNT, BUF_SIZE, 0);
+	ret = spdk_xor_gen(bufs[0], bufs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref, bufs[0], BUF_SIZE) == 0);
+
+	/* xor of the result and all but the first source gives back the first source */
+	memset(ref, 3, BUF_SIZE);
+	ref[0] = 0xff;
+	ret = spdk_xor_gen(dest, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref, dest, BUF_SIZE) == 0);
+
+	/* Not enough sources */
+	ret = spdk_xor_gen(dest, bufs, 1, BUF_SIZE);
+	CU_ASSERT(ret == -EINVAL);
+
+	for (i = 0; i < BUF_COUNT; i++) {
+		free(bufs[i]);
+	}
+	free(ref);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("xor", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_xor_gen);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+
+	CU_basic_run_tests();
+
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -23,6 +23,8 @@ function unittest_bdev() {
 	$valgrind $testdir/lib/bdev/scsi_nvme.c/scsi_nvme_ut
 	$valgrind $testdir/lib/bdev/vbdev_lvol.c/vbdev_lvol_ut
 	$valgrind $testdir/lib/bdev/vbdev_zone_block.c/vbdev_zone_block_ut
+	$valgrind $testdir/lib/bdev/dedup.c/dedup_ut
+	$valgrind $testdir/lib/bdev/ftl.c/bdev_ftl_ut
 	$valgrind $testdir/lib/bdev/mt/bdev.c/bdev_ut
 }
 
@@ -32,6 +34,8 @@ function unittest_blob() {
 	if [[ -e $testdir/lib/blob/blob.c/blob_ut ]]; then
 		$valgrind $testdir/lib/blob/blob.c/blob_ut
 	fi
+	# cluster_alloc_ut runs an allocation benchmark, too slow under valgrind
+	$testdir/lib/blob/cluster_alloc.c/cluster_alloc_ut
 	$valgrind $testdir/lib/blobfs/tree.c/tree_ut
 	$valgrind $testdir/lib/blobfs/blobfs_async_ut/blobfs_async_ut
 	# blobfs_sync_ut hangs when run under valgrind, so don't use $valgrind
@@ -49,7 +53,11 @@ function unittest_ftl() {
 	$valgrind $testdir/lib/ftl/ftl_bitmap.c/ftl_bitmap_ut
 	$valgrind $testdir/lib/ftl/ftl_io.c/ftl_io_ut
 	$valgrind $testdir/lib/ftl/ftl_mngt/ftl_mngt_ut
+	$valgrind $testdir/lib/ftl/ftl_mngt_recovery.c/ftl_mngt_recovery_ut
 	$valgrind $testdir/lib/ftl/ftl_mempool.c/ftl_mempool_ut
+	$valgrind $testdir/lib/ftl/ftl_layout.c/ftl_layout_ut
+	$valgrind $testdir/lib/ftl/ftl_sketch.c/ftl_sketch_ut
+	$valgrind $testdir/lib/ftl/ftl_nv_cache.c/ftl_nv_cache_ut
 	$valgrind $testdir/lib/ftl/ftl_l2p/ftl_l2p_ut
 	$valgrind $testdir/lib/ftl/ftl_sb/ftl_sb_ut
 	$valgrind $testdir/lib/ftl/ftl_layout_upgrade/ftl_layout_upgrade_ut
@@ -133,6 +141,7 @@ function unittest_util() {
 	$valgrind $testdir/lib/util/iov.c/iov_ut
 	$valgrind $testdir/lib/util/math.c/math_ut
 	$valgrind $testdir/lib/util/pipe.c/pipe_ut
+	$valgrind $testdir/lib/util/xor.c/xor_ut
 }
 
 function unittest_init() {